@@ -26,6 +26,12 @@ int32_t main(int32_t argc_, char** argv_) {
   //ds print loaded configuration
   parameters->command_line_parameters->print();
 
+  //ds configure logging (pending asynchronous messages are written at exit)
+  proslam::Logger::setLevel(parameters->command_line_parameters->logging_level);
+  if (parameters->command_line_parameters->option_enable_asynchronous_logging) {
+    proslam::Logger::startAsynchronous();
+  }
+
   //ds allocate SLAM system (has internal access to parameter server)
   proslam::SLAMAssembly slam_system(parameters);
 
@@ -38,6 +44,16 @@ int32_t main(int32_t argc_, char** argv_) {
     //ds load cameras
     slam_system.loadCamerasFromMessageFile();
 
+    //ds load a previously built map if desired
+    if (parameters->command_line_parameters->map_file_name_load.length() > 0) {
+      slam_system.loadMap(parameters->command_line_parameters->map_file_name_load);
+    }
+
+    //ds merge additional maps into the loaded one if desired
+    for (const std::string& map_file_name_merge: parameters->command_line_parameters->map_file_names_merge) {
+      slam_system.mergeMap(map_file_name_merge);
+    }
+
     //ds if visualization is desired
     if (parameters->command_line_parameters->option_use_gui) {
 
@@ -104,6 +120,16 @@ int32_t main(int32_t argc_, char** argv_) {
     if (parameters->command_line_parameters->option_save_pose_graph) {
       slam_system.writePoseGraphToFile("pose_graph.g2o");
     }
+
+    //ds save map to disk
+    if (parameters->command_line_parameters->map_file_name_save.length() > 0) {
+      slam_system.writeMap(parameters->command_line_parameters->map_file_name_save);
+    }
+
+    //ds save stage timings to disk
+    if (parameters->command_line_parameters->stage_trace_file_name.length() > 0) {
+      slam_system.writeStageTrace(parameters->command_line_parameters->stage_trace_file_name);
+    }
   } catch (const std::runtime_error& exception_) {
     std::cerr << DOUBLE_BAR << std::endl;
     std::cerr << "main|caught runtime exception: '" << exception_.what() << "'" << std::endl;
@@ -119,5 +145,6 @@ int32_t main(int32_t argc_, char** argv_) {
 
   //ds clean up dynamic memory
   delete parameters;
+  proslam::Logger::stopAsynchronous();
   return 0;
 }
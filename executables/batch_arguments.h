@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//ds command line handling shared by the batch evaluation tools (evaluate_batch, sweep_configuration)
+
+//! @brief options common to the batch evaluation tools
+struct BatchArguments {
+
+  //! @brief configurations (-c) and datasets (-s) in the order of appearance
+  std::vector<std::string> configuration_file_names;
+  std::vector<std::string> dataset_file_names;
+
+  //! @brief maximum number of concurrent runs (-j, at least 1)
+  size_t number_of_parallel_jobs = 1;
+
+  //! @brief report file (-o)
+  std::string report_file_name;
+
+  //! @brief arguments after '--', forwarded to the SLAM system
+  std::vector<std::string> options;
+};
+
+//! @brief parses the common batch options, defaults have to be set in arguments_ beforehand
+//! unknown arguments are skipped, a trailing option without value terminates parsing
+//! @param[in] argc_ argument count of main
+//! @param[in] argv_ argument values of main
+//! @param[in,out] arguments_ common options
+//! @param[in] handle_option_ tool specific options with a value: bool(const char* option, const char* value), return true if consumed
+template<typename OptionHandlerType_>
+void parseBatchArguments(const int32_t& argc_, char** argv_, BatchArguments& arguments_, OptionHandlerType_ handle_option_) {
+  int32_t number_of_checked_parameters = 1;
+  while (number_of_checked_parameters < argc_) {
+    const char* option = argv_[number_of_checked_parameters];
+    if (!std::strcmp(option, "--")) {
+
+      //ds all remaining arguments are forwarded to the SLAM system
+      for (++number_of_checked_parameters; number_of_checked_parameters < argc_; ++number_of_checked_parameters) {
+        arguments_.options.push_back(argv_[number_of_checked_parameters]);
+      }
+      break;
+    }
+    if (number_of_checked_parameters+1 == argc_) {
+      break;
+    }
+    const char* value = argv_[number_of_checked_parameters+1];
+    bool is_consumed  = true;
+    if (!std::strcmp(option, "-c")) {
+      arguments_.configuration_file_names.push_back(value);
+    } else if (!std::strcmp(option, "-s")) {
+      arguments_.dataset_file_names.push_back(value);
+    } else if (!std::strcmp(option, "-j")) {
+      arguments_.number_of_parallel_jobs = std::max(std::stoi(value), 1);
+    } else if (!std::strcmp(option, "-o")) {
+      arguments_.report_file_name = value;
+    } else {
+      is_consumed = handle_option_(option, value);
+    }
+    number_of_checked_parameters += (is_consumed)? 2: 1;
+  }
+}
+
+//! @brief single quoted YAML scalar (quotes in the value are doubled)
+inline const std::string quote(const std::string& value_) {
+  std::string quoted("'");
+  for (const char& character: value_) {
+    quoted += character;
+    if (character == '\'') {
+      quoted += '\'';
+    }
+  }
+  return quoted+"'";
+}
@@ -0,0 +1,135 @@
+#include <chrono>
+#include <random>
+#include "aligners/stereouv_aligner.h"
+using namespace proslam;
+
+
+
+//ds helpers
+void createSyntheticStereoScene(Frame* frame_previous_,
+                                Frame* frame_current_,
+                                const TransformMatrix3D& previous_to_current_,
+                                const Count& number_of_points_);
+
+
+
+int32_t main(int32_t argc_, char** argv_) {
+
+  //ds configuration
+  const Count number_of_measurements  = (argc_ > 1)? std::stoi(argv_[1]): 1500;
+  const Count number_of_iterations    = (argc_ > 2)? std::stoi(argv_[2]): 1000;
+  const Count number_of_threads       = (argc_ > 3)? std::stoi(argv_[3]): 1;
+  std::cerr << BAR << std::endl;
+  std::cerr << "number of measurements: " << number_of_measurements << std::endl;
+  std::cerr << "number of iterations: " << number_of_iterations << std::endl;
+  std::cerr << "number of linearization threads: " << number_of_threads << std::endl;
+  std::cerr << BAR << std::endl;
+
+  //ds KITTI like stereo setup
+  CameraMatrix camera_matrix(CameraMatrix::Identity());
+  camera_matrix << 718.856, 0, 607.1928,
+                   0, 718.856, 185.2157,
+                   0, 0, 1;
+  Camera* camera_left  = new Camera(376, 1241, camera_matrix);
+  Camera* camera_right = new Camera(376, 1241, camera_matrix);
+  camera_right->setBaselineHomogeneous(Vector3(-386.1448, 0, 0));
+
+  //ds two consecutive frames with a moderate forward motion
+  TransformMatrix3D previous_to_current(TransformMatrix3D::Identity());
+  previous_to_current.translation() = Vector3(0.01, -0.02, -0.8);
+  previous_to_current.linear()      = Eigen::AngleAxis<real>(0.02, Vector3::UnitY()).toRotationMatrix();
+  Frame* frame_previous = new Frame(0, nullptr, nullptr, nullptr, TransformMatrix3D::Identity(), 0);
+  Frame* frame_current  = new Frame(1, nullptr, frame_previous, nullptr, previous_to_current.inverse(), 0.1);
+  frame_previous->setCameraLeft(camera_left);
+  frame_previous->setCameraRight(camera_right);
+  frame_current->setCameraLeft(camera_left);
+  frame_current->setCameraRight(camera_right);
+  createSyntheticStereoScene(frame_previous, frame_current, previous_to_current, number_of_measurements);
+
+  //ds configure aligner as in the tracker
+  AlignerParameters* parameters = new AlignerParameters(LoggingLevel::Info);
+  parameters->maximum_error_kernel            = 16;
+  parameters->number_of_linearization_threads = number_of_threads;
+  WorkerPool* worker_pool = new WorkerPool(number_of_threads-1);
+  StereoUVAligner* aligner = new StereoUVAligner(parameters);
+  aligner->setWorkerPool(worker_pool);
+  aligner->configure();
+
+  //ds initialization cost (buffers are kept across calls)
+  const TransformMatrix3D initial_guess(TransformMatrix3D::Identity());
+  std::chrono::time_point<std::chrono::system_clock> time_begin = std::chrono::system_clock::now();
+  for (Count iteration = 0; iteration < number_of_iterations; ++iteration) {
+    aligner->initialize(frame_previous, frame_current, initial_guess);
+  }
+  const double duration_initialize_seconds = std::chrono::duration<double>(std::chrono::system_clock::now()-time_begin).count();
+
+  //ds linearization cost (per least squares iteration)
+  time_begin = std::chrono::system_clock::now();
+  for (Count iteration = 0; iteration < number_of_iterations; ++iteration) {
+    aligner->linearize(false);
+  }
+  const double duration_linearize_seconds = std::chrono::duration<double>(std::chrono::system_clock::now()-time_begin).count();
+
+  //ds full pose estimation
+  time_begin = std::chrono::system_clock::now();
+  aligner->initialize(frame_previous, frame_current, initial_guess);
+  aligner->converge();
+  const double duration_converge_seconds = std::chrono::duration<double>(std::chrono::system_clock::now()-time_begin).count();
+  const real translation_error = (aligner->previousToCurrent().translation()-previous_to_current.translation()).norm();
+
+  std::cerr << "initialize  (us/call): " << 1e6*duration_initialize_seconds/number_of_iterations << std::endl;
+  std::cerr << "linearize   (us/iteration): " << 1e6*duration_linearize_seconds/number_of_iterations << std::endl;
+  std::cerr << "linearize   (ns/measurement): " << 1e9*duration_linearize_seconds/number_of_iterations/number_of_measurements << std::endl;
+  std::cerr << "converge    (us): " << 1e6*duration_converge_seconds << " inliers: " << aligner->numberOfInliers()
+            << " translation error (m): " << translation_error << std::endl;
+  std::cerr << BAR << std::endl;
+
+  //ds clean up
+  delete aligner;
+  delete worker_pool;
+  delete parameters;
+  delete frame_current;
+  delete frame_previous;
+  delete camera_right;
+  delete camera_left;
+  return 0;
+}
+
+void createSyntheticStereoScene(Frame* frame_previous_,
+                                Frame* frame_current_,
+                                const TransformMatrix3D& previous_to_current_,
+                                const Count& number_of_points_) {
+  const CameraMatrix& camera_matrix = frame_current_->cameraLeft()->cameraMatrix();
+  const Vector3& baseline           = frame_current_->cameraRight()->baselineHomogeneous();
+  const cv::Mat descriptor(1, DESCRIPTOR_SIZE_BYTES, CV_8UC1, cv::Scalar(0));
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<real> distribution_lateral(-10, 10);
+  std::uniform_real_distribution<real> distribution_depth(3, 40);
+  std::normal_distribution<real> distribution_noise(0, 0.5);
+
+  //ds projects a point into the stereo camera (with optional pixel noise)
+  auto project = [&](const PointCoordinates& point_in_camera_, cv::KeyPoint& keypoint_left_, cv::KeyPoint& keypoint_right_, const real& noise_) {
+    const PointCoordinates abc_left  = camera_matrix*point_in_camera_;
+    const PointCoordinates abc_right = abc_left+baseline;
+    keypoint_left_.pt  = cv::Point2f(abc_left.x()/abc_left.z()+noise_*distribution_noise(generator), abc_left.y()/abc_left.z());
+    keypoint_right_.pt = cv::Point2f(abc_right.x()/abc_right.z()+noise_*distribution_noise(generator), abc_left.y()/abc_left.z());
+    return (keypoint_left_.pt.x >= 0 && keypoint_left_.pt.x < frame_current_->cameraLeft()->numberOfImageCols() &&
+            keypoint_left_.pt.y >= 0 && keypoint_left_.pt.y < frame_current_->cameraLeft()->numberOfImageRows() &&
+            keypoint_right_.pt.x >= 0 && keypoint_left_.pt.x-keypoint_right_.pt.x > 1);
+  };
+
+  //ds sample points visible in both frames
+  while (frame_current_->points().size() < number_of_points_) {
+    const PointCoordinates point_in_previous(distribution_lateral(generator), 0.2*distribution_lateral(generator), distribution_depth(generator));
+    const PointCoordinates point_in_current(previous_to_current_*point_in_previous);
+    cv::KeyPoint keypoint_left_previous, keypoint_right_previous, keypoint_left_current, keypoint_right_current;
+    if (point_in_current.z() > 1 &&
+        project(point_in_previous, keypoint_left_previous, keypoint_right_previous, 0) &&
+        project(point_in_current, keypoint_left_current, keypoint_right_current, 1)) {
+      FramePoint* point_previous = frame_previous_->createFramepoint(keypoint_left_previous, descriptor, keypoint_right_previous, descriptor, point_in_previous);
+      FramePoint* point_current  = frame_current_->createFramepoint(keypoint_left_current, descriptor, keypoint_right_current, descriptor, point_in_current, point_previous);
+      frame_previous_->points().push_back(point_previous);
+      frame_current_->points().push_back(point_current);
+    }
+  }
+}
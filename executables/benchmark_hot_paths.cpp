@@ -0,0 +1,406 @@
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include "framepoint_generation/stereo_framepoint_generator.h"
+#include "aligners/stereouv_aligner.h"
+#include "map_optimization/graph_optimizer.h"
+#include "kitti_utilities.h"
+using namespace proslam;
+
+
+
+//ds latency samples of a benchmarked call
+struct Samples {
+  Samples(const std::string& name_, const std::string& item_name_): name(name_), item_name(item_name_) {}
+  std::string name;
+  std::string item_name;
+  std::vector<double> durations_seconds;
+  Count number_of_items = 0;
+};
+
+//ds measures the duration of a single call
+template<typename FunctionType_>
+void measure(Samples& samples_, const Count& number_of_items_, FunctionType_ function_) {
+  const std::chrono::time_point<std::chrono::steady_clock> time_begin = std::chrono::steady_clock::now();
+  function_();
+  samples_.durations_seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now()-time_begin).count());
+  samples_.number_of_items += number_of_items_;
+}
+
+//ds helpers
+void processFrame(StereoFramePointGenerator* framepoint_generator_,
+                  StereoUVAligner* aligner_,
+                  Frame* frame_,
+                  Frame* frame_previous_,
+                  TransformMatrix3D& camera_left_previous_in_current_,
+                  const Count& minimum_track_length_for_landmark_creation_,
+                  WorldMap* world_map_ = nullptr,
+                  Samples* samples_track_ = nullptr,
+                  Samples* samples_converge_ = nullptr,
+                  Samples* samples_compute_ = nullptr);
+
+void printStatistics(const Samples& samples_);
+
+
+
+int32_t main(int32_t argc_, char** argv_) {
+
+  //ds validate input
+  if (argc_ < 5) {
+    std::cerr << "ERROR: invalid call - please use: ./benchmark_hot_paths <configuration.yaml> <file_name_initial_image_LEFT> <file_name_initial_image_RIGHT> "
+                 "<calib.txt> [<number_of_frames> [<number_of_repetitions>]]" << std::endl;
+    return 0;
+  }
+
+  //ds configuration
+  const std::string file_name_configuration       = argv_[1];
+  const std::string file_name_initial_image_left  = argv_[2];
+  const std::string file_name_initial_image_right = argv_[3];
+  const std::string file_name_calibration         = argv_[4];
+  const Count number_of_frames                    = (argc_ > 5)? std::stoi(argv_[5]): 20;
+  const Count number_of_repetitions               = (argc_ > 6)? std::stoi(argv_[6]): 10;
+  std::cerr << BAR << std::endl;
+  std::cerr << "configuration: " << file_name_configuration << std::endl;
+  std::cerr << "initial image LEFT: " << file_name_initial_image_left << std::endl;
+  std::cerr << "initial image RIGHT: " << file_name_initial_image_right << std::endl;
+  std::cerr << "calibration file (KITTI): " << file_name_calibration << std::endl;
+  std::cerr << "number of frames: " << number_of_frames << std::endl;
+  std::cerr << "number of repetitions: " << number_of_repetitions << std::endl;
+  std::cerr << BAR << std::endl;
+
+  //ds load parameters, the benchmarked units run synchronously and in their default modes
+  ParameterCollection* parameters = new ParameterCollection(LoggingLevel::Info);
+  parameters->parseFromFile(file_name_configuration);
+  if (parameters->command_line_parameters->tracker_mode != CommandLineParameters::TrackerMode::RGB_STEREO) {
+    std::cerr << "ERROR: configuration is not in RGB_STEREO mode" << std::endl;
+    delete parameters;
+    return 0;
+  }
+  parameters->world_map_parameters->number_of_frames_with_full_data                = 0;
+  parameters->graph_optimizer_parameters->enable_asynchronous_optimization           = false;
+  parameters->graph_optimizer_parameters->enable_keyframe_pose_graph                 = false;
+  parameters->graph_optimizer_parameters->number_of_local_maps_for_bundle_adjustment = 0;
+  StereoFramePointGeneratorParameters* framepoint_generator_parameters = parameters->stereo_framepoint_generator_parameters;
+  const Count minimum_track_length_for_landmark_creation = parameters->stereo_tracker_parameters->minimum_track_length_for_landmark_creation;
+
+  //ds load the recorded image sequence into memory (images are not read during the benchmarks)
+  std::vector<cv::Mat> images_left;
+  std::vector<cv::Mat> images_right;
+  for (Count index = 0; index < number_of_frames; ++index) {
+    const cv::Mat image_left  = cv::imread(getImageFileName(file_name_initial_image_left, index), CV_LOAD_IMAGE_GRAYSCALE);
+    const cv::Mat image_right = cv::imread(getImageFileName(file_name_initial_image_right, index), CV_LOAD_IMAGE_GRAYSCALE);
+    if (image_left.rows == 0 || image_left.cols == 0 || image_left.rows != image_right.rows || image_left.cols != image_right.cols) {
+      break;
+    }
+    images_left.push_back(image_left);
+    images_right.push_back(image_right);
+  }
+  if (images_left.size() < 2) {
+    std::cerr << "ERROR: unable to load at least 2 image pairs" << std::endl;
+    delete parameters;
+    return 0;
+  }
+  std::cerr << "loaded image pairs: " << images_left.size() << std::endl;
+
+  //ds allocate cameras
+  Eigen::Vector3d baseline_pixels(Eigen::Vector3d::Zero());
+  const Eigen::Matrix3d camera_calibration_matrix(getCameraCalibrationMatrixKITTI(file_name_calibration, baseline_pixels));
+  Camera* camera_left  = new Camera(images_left[0].rows, images_left[0].cols, camera_calibration_matrix.cast<real>());
+  Camera* camera_right = new Camera(images_right[0].rows, images_right[0].cols, camera_calibration_matrix.cast<real>());
+  camera_right->setBaselineHomogeneous(baseline_pixels.cast<real>());
+
+  //ds allocate the front-end units as in the SLAM system (including a worker pool for the configured parallel loops)
+  WorkerPool* worker_pool = new WorkerPool(std::max({static_cast<Count>(framepoint_generator_parameters->number_of_detection_threads),
+                                                     static_cast<Count>(framepoint_generator_parameters->enable_concurrent_stream_processing? 2: 1),
+                                                     parameters->stereo_tracker_parameters->aligner->number_of_linearization_threads})-1);
+  StereoFramePointGenerator* framepoint_generator = new StereoFramePointGenerator(framepoint_generator_parameters);
+  framepoint_generator->setCameraLeft(camera_left);
+  framepoint_generator->setCameraRight(camera_right);
+  framepoint_generator->setWorkerPool(worker_pool);
+  framepoint_generator->configure();
+  framepoint_generator->setProjectionTrackingDistancePixels(framepoint_generator_parameters->maximum_projection_tracking_distance_pixels);
+  StereoUVAligner* aligner = new StereoUVAligner(parameters->stereo_tracker_parameters->aligner);
+  aligner->setMaximumReliableDepthMeters(framepoint_generator_parameters->maximum_reliable_depth_meters);
+  aligner->setWorkerPool(worker_pool);
+  aligner->configure();
+
+  //ds build the reference map once: frames, framepoints and landmarks are the inputs of the matching and back-end benchmarks
+  WorldMap* world_map = new WorldMap(parameters->world_map_parameters);
+  TransformMatrix3D camera_left_previous_in_current(TransformMatrix3D::Identity());
+  std::vector<Frame*> frames;
+  for (Count index = 0; index < images_left.size(); ++index) {
+    Frame* frame = world_map->createFrame((frames.empty())? TransformMatrix3D::Identity(): frames.back()->robotToWorld(), index);
+    frame->setCameraLeft(camera_left);
+    frame->setCameraRight(camera_right);
+    frame->setIntensityImageLeft(images_left[index]);
+    frame->setIntensityImageRight(images_right[index]);
+    processFrame(framepoint_generator,
+                 aligner,
+                 frame,
+                 (frames.empty())? nullptr: frames.back(),
+                 camera_left_previous_in_current,
+                 minimum_track_length_for_landmark_creation,
+                 world_map);
+    frames.push_back(frame);
+  }
+  std::cerr << "reference map: frames: " << world_map->frames().size() << " landmarks: " << world_map->landmarks().size()
+            << " framepoints (last frame): " << frames.back()->points().size() << std::endl;
+  std::cerr << BAR << std::endl;
+
+  //ds benchmarks
+  Samples samples_detection("BaseFramePointGenerator::detectKeypoints", "keypoints");
+  Samples samples_matching("IntensityFeatureMatcher::getMatchingFeatureInRectangularRegion", "queries");
+  Samples samples_compute("StereoFramePointGenerator::compute", "framepoints");
+  Samples samples_track("StereoFramePointGenerator::track", "tracks");
+  Samples samples_converge("StereoUVAligner::converge", "measurements");
+  Samples samples_landmark_update("Landmark::update", "measurements");
+  Samples samples_hbst("HBSTTree::matchAndAdd", "descriptors");
+  Samples samples_pose_graph_addition("GraphOptimizer::addFrame", "frames");
+  Samples samples_pose_graph_optimization("GraphOptimizer::optimizeFrames", "frames");
+  Samples samples_bundle_adjustment_addition("GraphOptimizer::addFrameWithLandmarks", "frames");
+  Samples samples_bundle_adjustment("GraphOptimizer::optimizeFramesWithLandmarks", "frames");
+  for (Count repetition = 0; repetition < number_of_repetitions; ++repetition) {
+    std::cerr << "repetition: " << repetition+1 << "/" << number_of_repetitions << std::endl;
+
+    //ds keypoint detection on the left images
+    for (const cv::Mat& image_left: images_left) {
+      std::vector<cv::KeyPoint> keypoints;
+      measure(samples_detection, 0, [&] {framepoint_generator->detectKeypoints(image_left, keypoints);});
+      samples_detection.number_of_items += keypoints.size();
+    }
+
+    //ds projective feature matching: the framepoints of the previous frame are searched in the features of the current frame
+    IntensityFeatureMatcher feature_matcher;
+    feature_matcher.configure(camera_left->numberOfImageRows(), camera_left->numberOfImageCols());
+    const int32_t tracking_distance_pixels = framepoint_generator_parameters->maximum_projection_tracking_distance_pixels;
+    for (Count index = 1; index < frames.size(); ++index) {
+      feature_matcher.setFeatures(frames[index]->keypointsLeft(), frames[index]->descriptorsLeft());
+      const FramePointPointerVector& points_previous = frames[index-1]->points();
+      measure(samples_matching, points_previous.size(), [&] {
+        for (const FramePoint* point_previous: points_previous) {
+          const int32_t row = point_previous->keypointLeft().pt.y;
+          const int32_t col = point_previous->keypointLeft().pt.x;
+          real descriptor_distance_best = framepoint_generator_parameters->matching_distance_tracking_threshold;
+          feature_matcher.getMatchingFeatureInRectangularRegion(row,
+                                                                col,
+                                                                point_previous->descriptorLeft(),
+                                                                std::max(row-tracking_distance_pixels, 0),
+                                                                std::min(row+tracking_distance_pixels+1, camera_left->numberOfImageRows()),
+                                                                std::max(col-tracking_distance_pixels, 0),
+                                                                std::min(col+tracking_distance_pixels+1, camera_left->numberOfImageCols()),
+                                                                framepoint_generator_parameters->matching_distance_tracking_threshold,
+                                                                true,
+                                                                descriptor_distance_best);
+        }
+      });
+    }
+
+    //ds front-end replay on standalone frames (the reference map is not touched)
+    Frame* frame_previous = nullptr;
+    camera_left_previous_in_current.setIdentity();
+    for (Count index = 0; index < images_left.size(); ++index) {
+      Frame* frame = new Frame(index, nullptr, frame_previous, nullptr, (frame_previous)? frame_previous->robotToWorld(): TransformMatrix3D::Identity(), index);
+      frame->setCameraLeft(camera_left);
+      frame->setCameraRight(camera_right);
+      frame->setIntensityImageLeft(images_left[index]);
+      frame->setIntensityImageRight(images_right[index]);
+      processFrame(framepoint_generator,
+                   aligner,
+                   frame,
+                   frame_previous,
+                   camera_left_previous_in_current,
+                   minimum_track_length_for_landmark_creation,
+                   nullptr,
+                   &samples_track,
+                   &samples_converge,
+                   &samples_compute);
+
+      //ds only the previous frame is required for tracking
+      if (frame_previous) {
+        delete frame_previous->previous();
+        frame_previous->setPrevious(nullptr);
+      }
+      frame_previous = frame;
+    }
+    if (frame_previous) {
+      delete frame_previous->previous();
+      delete frame_previous;
+    }
+
+    //ds landmark updates: the tracks of the reference map are replayed on standalone landmarks
+    Identifier identifier_landmark = 0;
+    for (const FramePoint* point: frames.back()->points()) {
+      if (!point->landmark() || !point->previous()) {
+        continue;
+      }
+      FramePointPointerVector track;
+      for (const FramePoint* point_in_track = point; point_in_track; point_in_track = point_in_track->previous()) {
+        track.push_back(const_cast<FramePoint*>(point_in_track));
+      }
+      Landmark landmark(identifier_landmark++, track.back()->worldCoordinates(), 1, parameters->world_map_parameters->landmark);
+      for (FramePointPointerVector::reverse_iterator iterator = track.rbegin()+1; iterator != track.rend(); ++iterator) {
+        measure(samples_landmark_update, 1, [&] {landmark.update(*iterator);});
+      }
+    }
+
+    //ds place recognition database: every frame is matched against and added to the tree
+    {
+      HBSTTree tree;
+
+      //ds threshold as derived by Relocalizer::configure if not set
+      const real maximum_descriptor_distance = (parameters->relocalizer_parameters->maximum_descriptor_distance < 0)?
+                                               0.1*framepoint_generator->descriptorSizeBits(): parameters->relocalizer_parameters->maximum_descriptor_distance;
+      for (const Frame* frame: frames) {
+        HBSTTree::MatchableVector matchables;
+        matchables.reserve(frame->points().size());
+        for (const FramePoint* point: frame->points()) {
+          matchables.push_back(new HBSTMatchable(const_cast<Landmark*>(point->landmark()), point->descriptorLeft(), frame->identifier()));
+        }
+        HBSTTree::MatchVectorMap matches;
+        measure(samples_hbst, matchables.size(), [&] {tree.matchAndAdd(matchables, matches, maximum_descriptor_distance);});
+      }
+    }
+
+    //ds pose graph optimization over the reference trajectory
+    GraphOptimizer* graph_optimizer = new GraphOptimizer(parameters->graph_optimizer_parameters);
+    graph_optimizer->setWorkerPool(worker_pool);
+    graph_optimizer->configure();
+    for (Frame* frame: frames) {
+      measure(samples_pose_graph_addition, 1, [&] {graph_optimizer->addFrame(frame);});
+    }
+    measure(samples_pose_graph_optimization, frames.size(), [&] {graph_optimizer->optimizeFrames(world_map);});
+
+    //ds bundle adjustment over the reference trajectory and its landmarks
+    for (Frame* frame: frames) {
+      measure(samples_bundle_adjustment_addition, 1, [&] {graph_optimizer->addFrameWithLandmarks(frame);});
+    }
+    measure(samples_bundle_adjustment, frames.size(), [&] {graph_optimizer->optimizeFramesWithLandmarks(world_map);});
+    delete graph_optimizer;
+  }
+
+  //ds report
+  std::cerr << BAR << std::endl;
+  std::printf("%-62s | %8s | %10s | %10s | %10s | %10s | %10s | %10s | %12s | %14s\n",
+              "benchmark", "samples", "mean (us)", "min (us)", "p50 (us)", "p90 (us)", "p99 (us)", "max (us)", "calls/s", "items/s");
+  printStatistics(samples_detection);
+  printStatistics(samples_matching);
+  printStatistics(samples_compute);
+  printStatistics(samples_track);
+  printStatistics(samples_converge);
+  printStatistics(samples_landmark_update);
+  printStatistics(samples_hbst);
+  printStatistics(samples_pose_graph_addition);
+  printStatistics(samples_pose_graph_optimization);
+  printStatistics(samples_bundle_adjustment_addition);
+  printStatistics(samples_bundle_adjustment);
+  std::cerr << BAR << std::endl;
+
+  //ds clean up
+  delete world_map;
+  delete aligner;
+  delete framepoint_generator;
+  delete worker_pool;
+  delete camera_right;
+  delete camera_left;
+  delete parameters;
+  return 0;
+}
+
+void processFrame(StereoFramePointGenerator* framepoint_generator_,
+                  StereoUVAligner* aligner_,
+                  Frame* frame_,
+                  Frame* frame_previous_,
+                  TransformMatrix3D& camera_left_previous_in_current_,
+                  const Count& minimum_track_length_for_landmark_creation_,
+                  WorldMap* world_map_,
+                  Samples* samples_track_,
+                  Samples* samples_converge_,
+                  Samples* samples_compute_) {
+  Samples samples_unused("", "");
+
+  //ds refresh the camera poses of the frame (the cameras are set after construction)
+  frame_->setRobotToWorld(frame_->robotToWorld());
+  framepoint_generator_->initialize(frame_);
+
+  //ds tracking and pose optimization (as in the tracker, with a constant velocity motion guess)
+  if (frame_previous_) {
+    FramePointPointerVector lost_points;
+    measure((samples_track_)? *samples_track_: samples_unused, 0, [&] {
+      framepoint_generator_->track(frame_, frame_previous_, camera_left_previous_in_current_, lost_points);
+    });
+    if (samples_track_) {
+      samples_track_->number_of_items += frame_->points().size();
+    }
+    if (!frame_->points().empty()) {
+      measure((samples_converge_)? *samples_converge_: samples_unused, frame_->points().size(), [&] {
+        aligner_->initialize(frame_previous_, frame_, camera_left_previous_in_current_);
+        aligner_->converge();
+      });
+      camera_left_previous_in_current_ = aligner_->previousToCurrent();
+
+      //ds drop the points suppressed by the optimization
+      Count number_of_tracked_points = 0;
+      for (Index index_point = 0; index_point < frame_->points().size(); ++index_point) {
+        if (aligner_->errors()[index_point] != -1) {
+          frame_->points()[number_of_tracked_points] = frame_->points()[index_point];
+          ++number_of_tracked_points;
+        }
+      }
+      frame_->points().resize(number_of_tracked_points);
+    }
+    frame_->setRobotToWorld(frame_previous_->robotToWorld()*camera_left_previous_in_current_.inverse());
+  }
+
+  //ds create or update landmarks for the tracked points (reference map only)
+  if (world_map_) {
+    for (FramePoint* point: frame_->points()) {
+      point->setWorldCoordinates(frame_->robotToWorld()*point->robotCoordinates());
+      if (point->trackLength() < minimum_track_length_for_landmark_creation_) {
+        continue;
+      }
+      Landmark* landmark = point->landmark();
+      if (!landmark) {
+        landmark = world_map_->createLandmark(point);
+      }
+      landmark->update(point);
+      point->setCameraCoordinatesLeftLandmark(frame_->worldToCameraLeft()*landmark->coordinates());
+    }
+  }
+
+  //ds stereo matching for new framepoints
+  const Count number_of_points_tracked = frame_->points().size();
+  measure((samples_compute_)? *samples_compute_: samples_unused, 0, [&] {framepoint_generator_->compute(frame_);});
+  if (samples_compute_) {
+    samples_compute_->number_of_items += frame_->points().size()-number_of_points_tracked;
+  }
+}
+
+void printStatistics(const Samples& samples_) {
+  if (samples_.durations_seconds.empty()) {
+    std::printf("%-62s | %8s |\n", samples_.name.c_str(), "-");
+    return;
+  }
+
+  //ds latency distribution
+  std::vector<double> durations_seconds(samples_.durations_seconds);
+  std::sort(durations_seconds.begin(), durations_seconds.end());
+  double duration_total_seconds = 0;
+  for (const double& duration_seconds: durations_seconds) {
+    duration_total_seconds += duration_seconds;
+  }
+  auto percentile = [&durations_seconds](const double& ratio_) {
+    return durations_seconds[std::min(static_cast<size_t>(ratio_*durations_seconds.size()), durations_seconds.size()-1)];
+  };
+  std::printf("%-62s | %8zu | %10.2f | %10.2f | %10.2f | %10.2f | %10.2f | %10.2f | %12.2f | %14.2f %s\n",
+              samples_.name.c_str(),
+              durations_seconds.size(),
+              1e6*duration_total_seconds/durations_seconds.size(),
+              1e6*durations_seconds.front(),
+              1e6*percentile(0.5),
+              1e6*percentile(0.9),
+              1e6*percentile(0.99),
+              1e6*durations_seconds.back(),
+              durations_seconds.size()/duration_total_seconds,
+              samples_.number_of_items/duration_total_seconds,
+              samples_.item_name.c_str());
+}
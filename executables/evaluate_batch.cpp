@@ -0,0 +1,309 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include "system/slam_assembly.h"
+#include "batch_arguments.h"
+using namespace proslam;
+
+
+
+//ds single evaluation run: one sequence processed with one configuration
+struct Job {
+  Job(const Count& index_, const std::string& configuration_file_name_, const std::string& dataset_file_name_): index(index_),
+                                                                                                               configuration_file_name(configuration_file_name_),
+                                                                                                               dataset_file_name(dataset_file_name_) {}
+  Count index;
+  std::string configuration_file_name;
+  std::string dataset_file_name;
+  std::string log_file_name;
+
+  //ds process bookkeeping (set by the parent)
+  pid_t process_identifier       = 0;
+  int32_t pipe_file_descriptor   = -1;
+  double time_start_seconds      = 0;
+  double duration_seconds        = 0;
+  int32_t exit_status            = -1;
+  int32_t termination_signal     = 0;
+  double memory_peak_megabytes   = 0;
+
+  //ds report lines written by the child (YAML, indented as job entries)
+  std::string results;
+};
+
+//ds helpers
+const std::string runJob(const Job& job_, const std::vector<std::string>& options_);
+
+void appendTrajectoryErrors(const WorldMap* world_map_, std::ostringstream& stream_);
+
+
+
+int32_t main(int32_t argc_, char** argv_) {
+  if (argc_ < 5) {
+    std::cerr << "usage: ./evaluate_batch -c <configuration.yaml> [-c <configuration.yaml> ..] -s <dataset.txt> [-s <dataset.txt> ..] "
+              << "[-j <number of parallel jobs>] [-o <report.yaml>] [-- <srrg_proslam_app options>]" << std::endl;
+    return 0;
+  }
+
+  //ds parse configuration (no options beyond the common ones)
+  BatchArguments arguments;
+  arguments.number_of_parallel_jobs = std::max(std::thread::hardware_concurrency(), 1u);
+  arguments.report_file_name        = "evaluation.yaml";
+  parseBatchArguments(argc_, argv_, arguments, [](const char* /*option_*/, const char* /*value_*/) {return false;});
+  const std::vector<std::string>& configuration_file_names = arguments.configuration_file_names;
+  const std::vector<std::string>& dataset_file_names       = arguments.dataset_file_names;
+  const std::vector<std::string>& options                  = arguments.options;
+  const size_t& maximum_number_of_parallel_jobs            = arguments.number_of_parallel_jobs;
+  const std::string& report_file_name                      = arguments.report_file_name;
+  if (configuration_file_names.empty() || dataset_file_names.empty()) {
+    std::cerr << "ERROR: at least one configuration (-c) and one dataset (-s) are required" << std::endl;
+    return 0;
+  }
+
+  //ds every sequence is processed with every configuration
+  std::vector<Job> jobs;
+  for (const std::string& configuration_file_name: configuration_file_names) {
+    for (const std::string& dataset_file_name: dataset_file_names) {
+      jobs.push_back(Job(jobs.size(), configuration_file_name, dataset_file_name));
+      jobs.back().log_file_name = report_file_name+"."+std::to_string(jobs.back().index)+".log";
+    }
+  }
+  std::cerr << BAR << std::endl;
+  std::cerr << "number of configurations: " << configuration_file_names.size() << std::endl;
+  std::cerr << "number of datasets: " << dataset_file_names.size() << std::endl;
+  std::cerr << "number of jobs: " << jobs.size() << " (parallel: " << maximum_number_of_parallel_jobs << ")" << std::endl;
+  std::cerr << "report: " << report_file_name << std::endl;
+  std::cerr << BAR << std::endl;
+
+  //ds every job runs in a separate process (isolating failures and measuring the memory peak per job)
+  //ds the parent process does not spawn any threads, such that forking is safe
+  const double time_start_seconds = srrg_core::getTime();
+  Count index_next_job            = 0;
+  Count number_of_running_jobs    = 0;
+  while (index_next_job < jobs.size() || number_of_running_jobs > 0) {
+
+    //ds start jobs until all cores are busy
+    while (index_next_job < jobs.size() && number_of_running_jobs < maximum_number_of_parallel_jobs) {
+      Job& job = jobs[index_next_job];
+      int32_t pipe_file_descriptors[2];
+      if (pipe(pipe_file_descriptors)) {
+        std::cerr << "ERROR: unable to create pipe for job: " << job.index << std::endl;
+        return 0;
+      }
+
+      //ds flush buffered output before it is duplicated into the child
+      std::cout.flush();
+      std::cerr.flush();
+      job.process_identifier = fork();
+      if (job.process_identifier < 0) {
+        std::cerr << "ERROR: unable to fork for job: " << job.index << std::endl;
+        return 0;
+      }
+      if (job.process_identifier == 0) {
+
+        //ds child: log into the job file and report the results to the parent
+        close(pipe_file_descriptors[0]);
+        const int32_t log_file_descriptor = open(job.log_file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (log_file_descriptor >= 0) {
+          dup2(log_file_descriptor, STDOUT_FILENO);
+          dup2(log_file_descriptor, STDERR_FILENO);
+          close(log_file_descriptor);
+        }
+        int32_t exit_status = 0;
+        std::string results;
+        try {
+          results = runJob(job, options);
+        } catch (const std::runtime_error& exception_) {
+          std::cerr << "main|caught runtime exception: '" << exception_.what() << "'" << std::endl;
+          results     = "    error: "+quote(exception_.what())+"\n";
+          exit_status = 1;
+        }
+
+        //ds the results are small enough to fit into the pipe buffer (the parent reads them after the child terminated)
+        if (write(pipe_file_descriptors[1], results.data(), results.size()) != static_cast<ssize_t>(results.size())) {
+          exit_status = 1;
+        }
+        close(pipe_file_descriptors[1]);
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(exit_status);
+      }
+
+      //ds parent: keep the reading end
+      close(pipe_file_descriptors[1]);
+      job.pipe_file_descriptor = pipe_file_descriptors[0];
+      job.time_start_seconds   = srrg_core::getTime();
+      std::cerr << "main|started job " << job.index << ": " << job.dataset_file_name << " with " << job.configuration_file_name << std::endl;
+      ++index_next_job;
+      ++number_of_running_jobs;
+    }
+
+    //ds wait for any job to finish
+    int32_t status = 0;
+    struct rusage usage;
+    const pid_t process_identifier = wait4(-1, &status, 0, &usage);
+    if (process_identifier <= 0) {
+      std::cerr << "ERROR: lost track of running jobs" << std::endl;
+      return 0;
+    }
+    for (Job& job: jobs) {
+      if (job.process_identifier == process_identifier && job.pipe_file_descriptor >= 0) {
+        job.duration_seconds      = srrg_core::getTime()-job.time_start_seconds;
+        job.memory_peak_megabytes = usage.ru_maxrss/1024.0;
+        if (WIFEXITED(status)) {
+          job.exit_status = WEXITSTATUS(status);
+        } else if (WIFSIGNALED(status)) {
+          job.termination_signal = WTERMSIG(status);
+        }
+
+        //ds collect the results
+        char buffer[4096];
+        ssize_t number_of_bytes = 0;
+        while ((number_of_bytes = read(job.pipe_file_descriptor, buffer, sizeof(buffer))) > 0) {
+          job.results.append(buffer, number_of_bytes);
+        }
+        close(job.pipe_file_descriptor);
+        job.pipe_file_descriptor = -1;
+        --number_of_running_jobs;
+        std::cerr << "main|finished job " << job.index << " (exit status: " << job.exit_status << ", duration (s): " << job.duration_seconds << ")" << std::endl;
+        break;
+      }
+    }
+  }
+  const double duration_seconds = srrg_core::getTime()-time_start_seconds;
+
+  //ds write the report (YAML)
+  std::ofstream report(report_file_name, std::ofstream::out);
+  if (!report.good()) {
+    std::cerr << "ERROR: unable to open report: '" << report_file_name << "'" << std::endl;
+    return 0;
+  }
+  report << "evaluation:" << std::endl;
+  report << "  number_of_jobs: " << jobs.size() << std::endl;
+  report << "  number_of_parallel_jobs: " << maximum_number_of_parallel_jobs << std::endl;
+  report << "  duration_seconds: " << duration_seconds << std::endl;
+  report << "jobs:" << std::endl;
+  for (const Job& job: jobs) {
+    report << "  - index: " << job.index << std::endl;
+    report << "    configuration: " << quote(job.configuration_file_name) << std::endl;
+    report << "    dataset: " << quote(job.dataset_file_name) << std::endl;
+    report << "    log: " << quote(job.log_file_name) << std::endl;
+    report << "    exit_status: " << job.exit_status << std::endl;
+    if (job.termination_signal) {
+      report << "    termination_signal: " << job.termination_signal << std::endl;
+    }
+    report << "    duration_seconds: " << job.duration_seconds << std::endl;
+    report << "    memory_peak_megabytes: " << job.memory_peak_megabytes << std::endl;
+    report << job.results;
+  }
+  report.close();
+  std::cerr << "main|written report: " << report_file_name << " (duration (s): " << duration_seconds << ")" << std::endl;
+  return 0;
+}
+
+const std::string runJob(const Job& job_, const std::vector<std::string>& options_) {
+
+  //ds assemble the command line as for srrg_proslam_app (the dataset goes last)
+  std::vector<std::string> arguments = {"evaluate_batch", "-c", job_.configuration_file_name};
+  arguments.insert(arguments.end(), options_.begin(), options_.end());
+  arguments.push_back(job_.dataset_file_name);
+  std::vector<char*> argv;
+  for (std::string& argument: arguments) {
+    argv.push_back(&argument[0]);
+  }
+
+  //ds configure the system without GUI
+  ParameterCollection* parameters = new ParameterCollection(LoggingLevel::Debug);
+  parameters->parseFromCommandLine(argv.size(), argv.data());
+  parameters->command_line_parameters->option_use_gui = false;
+  parameters->command_line_parameters->print();
+  cv::setUseOptimized(true);
+  cv::setNumThreads(0);
+
+  //ds process the sequence at full speed
+  std::ostringstream results;
+  {
+    SLAMAssembly slam_system(parameters);
+    slam_system.loadCamerasFromMessageFile();
+    if (parameters->command_line_parameters->map_file_name_load.length() > 0) {
+      slam_system.loadMap(parameters->command_line_parameters->map_file_name_load);
+    }
+    slam_system.playbackMessageFile();
+    slam_system.printReport();
+
+    //ds runtime
+    const Count& number_of_processed_frames = slam_system.numberOfProcessedFrames();
+    double processing_time_maximum_seconds  = 0;
+    for (const double& processing_time_seconds: slam_system.processingTimesSeconds()) {
+      processing_time_maximum_seconds = std::max(processing_time_maximum_seconds, processing_time_seconds);
+    }
+    results << "    number_of_processed_frames: " << number_of_processed_frames << std::endl;
+    results << "    number_of_dropped_frames: " << slam_system.numberOfDroppedFrames() << std::endl;
+    results << "    processing_time_total_seconds: " << slam_system.processingTimeTotalSeconds() << std::endl;
+    results << "    processing_time_mean_seconds: " << ((number_of_processed_frames > 0)? slam_system.processingTimeTotalSeconds()/number_of_processed_frames: 0) << std::endl;
+    results << "    processing_time_maximum_seconds: " << processing_time_maximum_seconds << std::endl;
+    results << "    fps: " << slam_system.currentFPS() << std::endl;
+
+    //ds map statistics
+    results << "    number_of_landmarks: " << slam_system.worldMap()->landmarks().size() << std::endl;
+    results << "    number_of_local_maps: " << slam_system.worldMap()->localMaps().size() << std::endl;
+    results << "    number_of_closures: " << slam_system.worldMap()->numberOfClosures() << std::endl;
+
+    //ds per-stage timings (module names as in printReport)
+    results << "    time_consumption_seconds:" << std::endl;
+    for (const std::pair<std::string, double>& time_consumption: slam_system.timeConsumptionsSeconds()) {
+      std::string key(time_consumption.first);
+      std::replace(key.begin(), key.end(), ' ', '_');
+      results << "      " << key << ": " << time_consumption.second << std::endl;
+    }
+
+    //ds accuracy (if the dataset provides ground truth poses)
+    appendTrajectoryErrors(slam_system.worldMap(), results);
+  }
+  delete parameters;
+  return results.str();
+}
+
+void appendTrajectoryErrors(const WorldMap* world_map_, std::ostringstream& stream_) {
+
+  //ds collect estimated and ground truth positions (the ground truth pose is the identity if the dataset does not provide it)
+  std::vector<Vector3, Eigen::aligned_allocator<Vector3>> positions_estimated;
+  std::vector<Vector3, Eigen::aligned_allocator<Vector3>> positions_ground_truth;
+  bool has_ground_truth = false;
+  for (const FramePointerMapElement& frame: world_map_->frames()) {
+    positions_estimated.push_back(frame.second->robotToWorld().translation());
+    positions_ground_truth.push_back(frame.second->robotToWorldGroundTruth().translation());
+    if (!frame.second->robotToWorldGroundTruth().isApprox(TransformMatrix3D::Identity())) {
+      has_ground_truth = true;
+    }
+  }
+  stream_ << "    has_ground_truth: " << has_ground_truth << std::endl;
+  if (!has_ground_truth || positions_estimated.size() < 3) {
+    return;
+  }
+
+  //ds raw error: the trajectory is initialized at the first ground truth pose
+  Eigen::Matrix<double, 3, Eigen::Dynamic> points_estimated(3, positions_estimated.size());
+  Eigen::Matrix<double, 3, Eigen::Dynamic> points_ground_truth(3, positions_ground_truth.size());
+  double trajectory_length_meters = 0;
+  for (size_t index = 0; index < positions_estimated.size(); ++index) {
+    points_estimated.col(index)    = positions_estimated[index].cast<double>();
+    points_ground_truth.col(index) = positions_ground_truth[index].cast<double>();
+    if (index > 0) {
+      trajectory_length_meters += (points_ground_truth.col(index)-points_ground_truth.col(index-1)).norm();
+    }
+  }
+  const double rmse_translation_meters = std::sqrt((points_estimated-points_ground_truth).colwise().squaredNorm().mean());
+
+  //ds absolute trajectory error (ATE): after the optimal rigid alignment of the trajectories
+  const Eigen::Matrix4d estimated_to_ground_truth(Eigen::umeyama(points_estimated, points_ground_truth, false));
+  const Eigen::Matrix<double, 3, Eigen::Dynamic> points_estimated_aligned = (estimated_to_ground_truth.block<3, 3>(0, 0)*points_estimated).colwise()
+                                                                           +estimated_to_ground_truth.block<3, 1>(0, 3);
+  const double ate_rmse_meters = std::sqrt((points_estimated_aligned-points_ground_truth).colwise().squaredNorm().mean());
+  stream_ << "    trajectory_length_meters: " << trajectory_length_meters << std::endl;
+  stream_ << "    rmse_translation_meters: " << rmse_translation_meters << std::endl;
+  stream_ << "    ate_rmse_meters: " << ate_rmse_meters << std::endl;
+  stream_ << "    ate_relative: " << ate_rmse_meters/std::max(trajectory_length_meters, 1e-9) << std::endl;
+}
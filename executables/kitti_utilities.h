@@ -0,0 +1,61 @@
+#pragma once
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <Eigen/Core>
+
+//ds helpers shared by the offline tools operating directly on KITTI stereo sequences (test and benchmark executables)
+
+//! @brief parses the left camera matrix and the horizontal offset of the right camera from a KITTI calib.txt
+//! @param[in] file_name_calibration_ KITTI calibration file (P0 and P1 projection matrices in the first two lines)
+//! @param[out] baseline_pixels_ stereo offset of the right camera (pixels, only the first component is set)
+//! @return left camera calibration matrix
+inline Eigen::Matrix3d getCameraCalibrationMatrixKITTI(const std::string& file_name_calibration_, Eigen::Vector3d& baseline_pixels_) {
+
+  //ds load camera matrix - for now only KITTI parsing
+  std::ifstream file_calibration(file_name_calibration_, std::ifstream::in);
+  std::string line_buffer("");
+  std::getline(file_calibration, line_buffer);
+  if (line_buffer.empty()) {
+    throw std::runtime_error("invalid camera calibration file provided");
+  }
+  std::istringstream stream_left(line_buffer);
+  Eigen::Matrix3d camera_calibration_matrix(Eigen::Matrix3d::Identity());
+  baseline_pixels_.setZero();
+
+  //ds parse in fixed order
+  std::string filler(""); stream_left >> filler;
+  stream_left >> camera_calibration_matrix(0,0);
+  stream_left >> filler;
+  stream_left >> camera_calibration_matrix(0,2);
+  stream_left >> filler; stream_left >> filler;
+  stream_left >> camera_calibration_matrix(1,1);
+  stream_left >> camera_calibration_matrix(1,2);
+
+  //ds read second projection matrix to obtain the horizontal offset
+  std::getline(file_calibration, line_buffer);
+  std::istringstream stream_right(line_buffer);
+  stream_right >> filler; stream_right >> filler; stream_right >> filler; stream_right >> filler;
+  stream_right >> baseline_pixels_(0);
+  file_calibration.close();
+  return camera_calibration_matrix;
+}
+
+//! @brief file name of the image with the given offset in the enumeration of the initial image
+//! @param[in] file_name_initial_image_ first image of the sequence, enumerated with zero padding (e.g. KITTI: 000000.png)
+//! @param[in] offset_ image offset relative to the initial image
+//! @return file name of the image in the same directory with the same padding and extension
+inline const std::string getImageFileName(const std::string& file_name_initial_image_, const uint64_t& offset_) {
+
+  //ds UNIX only
+  const std::size_t index_delimiter_extension = file_name_initial_image_.find_last_of('.');
+  const std::size_t index_delimiter_directory = file_name_initial_image_.find_last_of('/');
+  const std::size_t index_begin_enumeration   = (index_delimiter_directory == std::string::npos)? 0: index_delimiter_directory+1;
+  const std::string enumeration               = file_name_initial_image_.substr(index_begin_enumeration, index_delimiter_extension-index_begin_enumeration);
+  std::string file_name_tail                  = std::to_string(std::stoi(enumeration)+offset_);
+  while (file_name_tail.length() < enumeration.length()) {
+    file_name_tail = "0"+file_name_tail;
+  }
+  return file_name_initial_image_.substr(0, index_begin_enumeration)+file_name_tail+file_name_initial_image_.substr(index_delimiter_extension);
+}
@@ -1,3 +1,7 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <ros/ros.h>
 #include <image_transport/image_transport.h>
 #include <cv_bridge/cv_bridge.h>
@@ -5,6 +9,7 @@
 #include <sensor_msgs/Image.h>
 #include <sensor_msgs/CameraInfo.h>
 #include <nav_msgs/Odometry.h>
+#include <nav_msgs/Path.h>
 #include <message_filters/synchronizer.h>
 #include <message_filters/sync_policies/approximate_time.h>
 #include <message_filters/subscriber.h>
@@ -22,8 +27,29 @@ proslam::TransformMatrix3D ground_truth(proslam::TransformMatrix3D::Identity());
 //ds active image buffer handles
 cv::Mat image_left;
 cv::Mat image_right;
+double timestamp_image_left_seconds = 0;
 bool found_image_pair = false;
 
+//ds real-time mode: image pairs overwritten by a newer pair before being processed
+proslam::Count number_of_dropped_image_pairs = 0;
+
+//ds processing thread mode: latest image pair queued by the callbacks (shares of the messages, overwritten by a newer pair)
+bool is_processing_thread_enabled = false;
+std::mutex mutex_queued_image_pair;
+std::condition_variable condition_queued_image_pair;
+sensor_msgs::ImageConstPtr queued_image_left;
+sensor_msgs::ImageConstPtr queued_image_right;
+
+//ds processing thread mode: state of the last processed frame handed to the publisher, the trajectory is copied on request only
+typedef std::vector<std::pair<double, Eigen::Isometry3d>> TrajectoryWithTimestamps;
+std::mutex mutex_published_state;
+bool is_pose_available = false;
+proslam::TransformMatrix3D robot_to_world_published(proslam::TransformMatrix3D::Identity());
+double timestamp_published_seconds = 0;
+std::atomic<bool> is_trajectory_requested(false);
+bool is_trajectory_available = false;
+TrajectoryWithTimestamps trajectory_published;
+
 
 
 void callbackCameraInfoLeft(const sensor_msgs::CameraInfoConstPtr& message_) {
@@ -32,10 +58,10 @@ void callbackCameraInfoLeft(const sensor_msgs::CameraInfoConstPtr& message_) {
   if (camera_left == 0) {
 
     //ds obtain eigen formatted data
-    const proslam::Matrix3 camera_matrix_transposed(message_->K.elems);
-    const proslam::Matrix4_3 projection_matrix_transposed(message_->P.elems);
-    const proslam::Matrix3 rectification_matrix_transposed(message_->R.elems);
-    const proslam::Vector5 distortion_coefficients(message_->D.data());
+    const proslam::Matrix3 camera_matrix_transposed(Eigen::Map<const Eigen::Matrix<double, 3, 3>>(message_->K.elems).cast<proslam::real>());
+    const proslam::Matrix4_3 projection_matrix_transposed(Eigen::Map<const Eigen::Matrix<double, 4, 3>>(message_->P.elems).cast<proslam::real>());
+    const proslam::Matrix3 rectification_matrix_transposed(Eigen::Map<const Eigen::Matrix<double, 3, 3>>(message_->R.elems).cast<proslam::real>());
+    const proslam::Vector5 distortion_coefficients(Eigen::Map<const Eigen::Matrix<double, 5, 1>>(message_->D.data()).cast<proslam::real>());
 
     //ds allocate a new camera
     camera_left = new proslam::Camera(message_->height, message_->width, camera_matrix_transposed.transpose());
@@ -55,10 +81,10 @@ void callbackCameraInfoRight(const sensor_msgs::CameraInfoConstPtr& message_) {
   if (camera_right == 0) {
 
     //ds obtain eigen formatted data
-    const proslam::Matrix3 camera_matrix_transposed(message_->K.elems);
-    proslam::Matrix4_3 projection_matrix_transposed(message_->P.elems);
-    const proslam::Matrix3 rectification_matrix_transposed(message_->R.elems);
-    const proslam::Vector5 distortion_coefficients(message_->D.data());
+    const proslam::Matrix3 camera_matrix_transposed(Eigen::Map<const Eigen::Matrix<double, 3, 3>>(message_->K.elems).cast<proslam::real>());
+    proslam::Matrix4_3 projection_matrix_transposed(Eigen::Map<const Eigen::Matrix<double, 4, 3>>(message_->P.elems).cast<proslam::real>());
+    const proslam::Matrix3 rectification_matrix_transposed(Eigen::Map<const Eigen::Matrix<double, 3, 3>>(message_->R.elems).cast<proslam::real>());
+    const proslam::Vector5 distortion_coefficients(Eigen::Map<const Eigen::Matrix<double, 5, 1>>(message_->D.data()).cast<proslam::real>());
 
     //ds check if camera is upside-down
     if(projection_matrix_transposed(3,0) > 0) {
@@ -79,8 +105,32 @@ void callbackCameraInfoRight(const sensor_msgs::CameraInfoConstPtr& message_) {
   }
 }
 
+//ds processing thread mode: queues the image pair for the processing thread (no copy, a pending pair is dropped)
+void queueImagePair(const sensor_msgs::ImageConstPtr& image_left_, const sensor_msgs::ImageConstPtr& image_right_) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_queued_image_pair);
+    if (queued_image_left) {
+      ++number_of_dropped_image_pairs;
+    }
+    queued_image_left  = image_left_;
+    queued_image_right = image_right_;
+  }
+  condition_queued_image_pair.notify_one();
+}
+
 //ds stereo image acquisition
 void callbackStereoImage(const sensor_msgs::ImageConstPtr& image_left_, const sensor_msgs::ImageConstPtr& image_right_){
+
+  //ds processing thread mode: conversion and processing are up to the processing thread
+  if (is_processing_thread_enabled) {
+    queueImagePair(image_left_, image_right_);
+    return;
+  }
+
+  //ds only the most recent image pair is processed
+  if (found_image_pair) {
+    ++number_of_dropped_image_pairs;
+  }
   found_image_pair = false;
 
   try {
@@ -104,12 +154,25 @@ void callbackStereoImage(const sensor_msgs::ImageConstPtr& image_left_, const se
     return;
   }
 
+  timestamp_image_left_seconds = image_left_->header.stamp.toSec();
+
   //ds enable access
   found_image_pair = true;
 }
 
 //mc monocular camera and depth image acquisition
 void callbackDepthImage(const sensor_msgs::ImageConstPtr& image_left_, const sensor_msgs::ImageConstPtr& image_right_) {
+
+  //ds processing thread mode: conversion and processing are up to the processing thread
+  if (is_processing_thread_enabled) {
+    queueImagePair(image_left_, image_right_);
+    return;
+  }
+
+  //ds only the most recent image pair is processed
+  if (found_image_pair) {
+    ++number_of_dropped_image_pairs;
+  }
   found_image_pair = false;
 
   try {
@@ -132,6 +195,8 @@ void callbackDepthImage(const sensor_msgs::ImageConstPtr& image_left_, const sen
     return;
   }
 
+  timestamp_image_left_seconds = image_left_->header.stamp.toSec();
+
   //ds enable access
   found_image_pair = true;
 
@@ -152,6 +217,124 @@ void callbackGroundTruth(const nav_msgs::OdometryConstPtr& message_) {
                                               message_->pose.pose.orientation.z).toRotationMatrix();
 }
 
+//ds processing thread: converts and processes the queued image pairs until termination is requested
+void processQueuedImagePairs(proslam::SLAMAssembly* slam_system_,
+                             const proslam::CommandLineParameters* parameters_,
+                             const std::atomic<bool>* is_termination_requested_) {
+  proslam::ImageBufferPool image_buffers(8);
+  const bool is_stereo = (parameters_->tracker_mode == proslam::CommandLineParameters::TrackerMode::RGB_STEREO);
+  while (!*is_termination_requested_) {
+
+    //ds wait for the next image pair (periodically checking for termination)
+    sensor_msgs::ImageConstPtr message_left;
+    sensor_msgs::ImageConstPtr message_right;
+    proslam::Count number_of_dropped_frames = 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex_queued_image_pair);
+      condition_queued_image_pair.wait_for(lock, std::chrono::milliseconds(100), []{return static_cast<bool>(queued_image_left);});
+      if (!queued_image_left) {
+        continue;
+      }
+      message_left.swap(queued_image_left);
+      message_right.swap(queued_image_right);
+      number_of_dropped_frames      = number_of_dropped_image_pairs;
+      number_of_dropped_image_pairs = 0;
+    }
+
+    //ds convert the shared messages into recycled buffers in a single pass (frames keep the images beyond the lifetime of the messages)
+    cv::Mat intensity_image_left;
+    cv::Mat intensity_image_right;
+    try {
+      cv_bridge::CvImageConstPtr image_left_shared = cv_bridge::toCvShare(message_left, sensor_msgs::image_encodings::MONO8);
+      intensity_image_left = image_buffers.acquire(image_left_shared->image.rows, image_left_shared->image.cols, CV_8UC1);
+      if (parameters_->option_equalize_histogram) {
+        cv::equalizeHist(image_left_shared->image, intensity_image_left);
+      } else {
+        image_left_shared->image.copyTo(intensity_image_left);
+      }
+      if (is_stereo) {
+        cv_bridge::CvImageConstPtr image_right_shared = cv_bridge::toCvShare(message_right, sensor_msgs::image_encodings::MONO8);
+        intensity_image_right = image_buffers.acquire(image_right_shared->image.rows, image_right_shared->image.cols, CV_8UC1);
+        if (parameters_->option_equalize_histogram) {
+          cv::equalizeHist(image_right_shared->image, intensity_image_right);
+        } else {
+          image_right_shared->image.copyTo(intensity_image_right);
+        }
+      } else {
+        cv_bridge::CvImageConstPtr image_depth_shared = cv_bridge::toCvShare(message_right, sensor_msgs::image_encodings::TYPE_32FC1);
+        intensity_image_right = image_buffers.acquire(image_depth_shared->image.rows, image_depth_shared->image.cols, CV_16UC1);
+        image_depth_shared->image.convertTo(intensity_image_right, CV_16UC1);
+      }
+    } catch (const cv_bridge::Exception& exception_) {
+      std::cerr << "processQueuedImagePairs|exception: " << exception_.what() << std::endl;
+      continue;
+    }
+
+    //ds process images
+    slam_system_->addDroppedFrames(number_of_dropped_frames);
+    slam_system_->process(intensity_image_left, intensity_image_right, message_left->header.stamp.toSec());
+    slam_system_->updateGUI();
+
+    //ds hand the pose over to the publisher and copy the trajectory if requested (at the publishing rate)
+    const proslam::Frame* current_frame = slam_system_->worldMap()->currentFrame();
+    if (current_frame) {
+      std::lock_guard<std::mutex> lock(mutex_published_state);
+      robot_to_world_published    = current_frame->robotToWorld();
+      timestamp_published_seconds = current_frame->timestampImageLeftSeconds();
+      is_pose_available           = true;
+    }
+    if (is_trajectory_requested) {
+      TrajectoryWithTimestamps trajectory;
+      slam_system_->writeTrajectoryWithTimestamps<double>(trajectory);
+      std::lock_guard<std::mutex> lock(mutex_published_state);
+      trajectory_published.swap(trajectory);
+      is_trajectory_available = true;
+      is_trajectory_requested = false;
+    }
+  }
+}
+
+//ds publishes a pose (odometry) and optionally a trajectory (path) in the world frame
+void publish(ros::Publisher& publisher_odometry_,
+             ros::Publisher& publisher_trajectory_,
+             const proslam::TransformMatrix3D& robot_to_world_,
+             const double& timestamp_seconds_,
+             const TrajectoryWithTimestamps* trajectory_ = nullptr) {
+  nav_msgs::Odometry message_odometry;
+  message_odometry.header.stamp    = ros::Time(timestamp_seconds_);
+  message_odometry.header.frame_id = "world";
+  message_odometry.child_frame_id  = "robot";
+  const proslam::Quaternion orientation(robot_to_world_.linear());
+  message_odometry.pose.pose.position.x    = robot_to_world_.translation().x();
+  message_odometry.pose.pose.position.y    = robot_to_world_.translation().y();
+  message_odometry.pose.pose.position.z    = robot_to_world_.translation().z();
+  message_odometry.pose.pose.orientation.w = orientation.w();
+  message_odometry.pose.pose.orientation.x = orientation.x();
+  message_odometry.pose.pose.orientation.y = orientation.y();
+  message_odometry.pose.pose.orientation.z = orientation.z();
+  publisher_odometry_.publish(message_odometry);
+  if (trajectory_) {
+    nav_msgs::Path message_trajectory;
+    message_trajectory.header = message_odometry.header;
+    message_trajectory.poses.resize(trajectory_->size());
+    for (size_t index = 0; index < trajectory_->size(); ++index) {
+      const Eigen::Isometry3d& pose = (*trajectory_)[index].second;
+      const Eigen::Quaterniond pose_orientation(pose.linear());
+      geometry_msgs::PoseStamped& message_pose = message_trajectory.poses[index];
+      message_pose.header.stamp       = ros::Time((*trajectory_)[index].first);
+      message_pose.header.frame_id    = "world";
+      message_pose.pose.position.x    = pose.translation().x();
+      message_pose.pose.position.y    = pose.translation().y();
+      message_pose.pose.position.z    = pose.translation().z();
+      message_pose.pose.orientation.w = pose_orientation.w();
+      message_pose.pose.orientation.x = pose_orientation.x();
+      message_pose.pose.orientation.y = pose_orientation.y();
+      message_pose.pose.orientation.z = pose_orientation.z();
+    }
+    publisher_trajectory_.publish(message_trajectory);
+  }
+}
+
 //ds don't allow any windoof compilation attempt!
 int32_t main(int32_t argc_, char** argv_) {
 
@@ -189,6 +372,12 @@ int32_t main(int32_t argc_, char** argv_) {
   //ds log configuration
   parameters->command_line_parameters->print();
 
+  //ds configure logging (pending asynchronous messages are written at exit)
+  proslam::Logger::setLevel(parameters->command_line_parameters->logging_level);
+  if (parameters->command_line_parameters->option_enable_asynchronous_logging) {
+    proslam::Logger::startAsynchronous();
+  }
+
   //ds initialize roscpp
   ros::init(argc_, argv_, "srrg_proslam_node");
 
@@ -259,9 +448,24 @@ int32_t main(int32_t argc_, char** argv_) {
   //ds initialize gui
   slam_system.initializeGUI(ui_server);
 
-  //ds set up subscribers
-  message_filters::Subscriber<sensor_msgs::Image> subscriber_image_left(node, parameters->command_line_parameters->topic_image_left, 5);
-  message_filters::Subscriber<sensor_msgs::Image> subscriber_image_right(node, parameters->command_line_parameters->topic_image_right, 5);
+  //ds processing thread mode: the callbacks only queue the images (to be set before subscribing)
+  is_processing_thread_enabled = parameters->command_line_parameters->option_enable_processing_thread;
+
+  //ds pose and trajectory publishers (rate limited)
+  const proslam::real& publishing_rate_hz = parameters->command_line_parameters->publishing_rate_hz;
+  ros::Publisher publisher_odometry;
+  ros::Publisher publisher_trajectory;
+  if (publishing_rate_hz > 0) {
+    publisher_odometry   = node.advertise<nav_msgs::Odometry>("/srrg_proslam/odometry", 1);
+    publisher_trajectory = node.advertise<nav_msgs::Path>("/srrg_proslam/trajectory", 1);
+  }
+  const double publishing_period_seconds = (publishing_rate_hz > 0)? 1/publishing_rate_hz: 0;
+  double time_last_publishing_seconds    = 0;
+
+  //ds set up subscribers - in real-time mode stale images are discarded by the transport in favour of the newest ones
+  const uint32_t subscriber_queue_size = (parameters->command_line_parameters->latency_budget_seconds > 0)? 1: 5;
+  message_filters::Subscriber<sensor_msgs::Image> subscriber_image_left(node, parameters->command_line_parameters->topic_image_left, subscriber_queue_size);
+  message_filters::Subscriber<sensor_msgs::Image> subscriber_image_right(node, parameters->command_line_parameters->topic_image_right, subscriber_queue_size);
 
   //ds define policy and initialize synchronizer
   typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::Image, sensor_msgs::Image> StereoImagePolicy;
@@ -281,6 +485,50 @@ int32_t main(int32_t argc_, char** argv_) {
 //                                     1, 0, 0, 0,
 //                                     0, 0, 0, 1;
 
+  //ds processing thread mode: callbacks are served by a spinner thread, the main thread only draws and publishes
+  if (is_processing_thread_enabled) {
+    std::cerr << "main|starting processing thread" << std::endl;
+    std::atomic<bool> is_termination_requested(false);
+    std::thread processing_thread([&slam_system, &parameters, &is_termination_requested] {
+      try {
+        processQueuedImagePairs(&slam_system, parameters->command_line_parameters, &is_termination_requested);
+      } catch (const std::runtime_error& exception_) {
+        std::cerr << "main|caught exception '" << exception_.what() << "'" << std::endl;
+        ros::shutdown();
+      }
+    });
+    ros::AsyncSpinner spinner(1);
+    spinner.start();
+    while (ros::ok()) {
+
+      //ds update ui
+      slam_system.draw();
+
+      //ds publish the last handed over pose and request the trajectory for the next publication
+      if (publishing_period_seconds > 0 && srrg_core::getTime()-time_last_publishing_seconds > publishing_period_seconds) {
+        std::lock_guard<std::mutex> lock(mutex_published_state);
+        if (is_pose_available) {
+          publish(publisher_odometry, publisher_trajectory, robot_to_world_published, timestamp_published_seconds,
+                  (is_trajectory_available)? &trajectory_published: nullptr);
+          is_trajectory_available = false;
+        }
+        is_trajectory_requested      = true;
+        time_last_publishing_seconds = srrg_core::getTime();
+      }
+
+      //ds breathe (maximum GUI speed: 50 fps)
+      ros::Duration(0.02).sleep();
+    }
+    spinner.stop();
+    is_termination_requested = true;
+    processing_thread.join();
+
+    //ds apply the last asynchronous relocalization and optimization results
+    slam_system.finish();
+    delete parameters;
+    return 0;
+  }
+
   //ds loop control
   proslam::Count number_of_frames_current_window = 0;
   double start_time_current_window_seconds       = srrg_core::getTime();
@@ -304,7 +552,9 @@ int32_t main(int32_t argc_, char** argv_) {
         }
 
         //ds process images
-        slam_system.process(image_left, image_right);
+        slam_system.addDroppedFrames(number_of_dropped_image_pairs);
+        number_of_dropped_image_pairs = 0;
+        slam_system.process(image_left, image_right, timestamp_image_left_seconds);
 	
         //ds add ground truth if available
 //      slam_system.addGroundTruthMeasurement(orientation_correction*ground_truth);
@@ -314,6 +564,17 @@ int32_t main(int32_t argc_, char** argv_) {
         slam_system.updateGUI();
         slam_system.draw();
         found_image_pair = false;
+
+        //ds publish pose and trajectory (rate limited)
+        if (publishing_period_seconds > 0 && srrg_core::getTime()-time_last_publishing_seconds > publishing_period_seconds) {
+          TrajectoryWithTimestamps trajectory;
+          slam_system.writeTrajectoryWithTimestamps<double>(trajectory);
+          const proslam::Frame* current_frame = slam_system.worldMap()->currentFrame();
+          if (current_frame) {
+            publish(publisher_odometry, publisher_trajectory, current_frame->robotToWorld(), current_frame->timestampImageLeftSeconds(), &trajectory);
+          }
+          time_last_publishing_seconds = srrg_core::getTime();
+        }
       } else {
         continue;
       }
@@ -335,6 +596,9 @@ int32_t main(int32_t argc_, char** argv_) {
     return 0;
   }
 
+  //ds apply the last asynchronous relocalization and optimization results
+  slam_system.finish();
+
 //  //ds print full report TODO merge into assembly
 //  slam_system.printReport();
 
@@ -1,6 +1,11 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include "framepoint_generation/stereo_framepoint_generator.h"
 #include "srrg_messages/message_reader.h"
@@ -18,8 +23,33 @@ struct ImageDescriptor {
     std::string file_name_image;
 };
 
+//ds chessboard measurement of a stereo image pair
+struct StereoMeasurement {
+    StereoMeasurement(const uint32_t& image_number_,
+                      const uint64_t& number_of_processed_stereo_images_): image_number(image_number_),
+                                                                           number_of_processed_stereo_images(number_of_processed_stereo_images_) {}
+    uint32_t image_number;
+    uint64_t number_of_processed_stereo_images;
+    bool is_loaded      = false;
+    bool measured_left  = false;
+    bool measured_right = false;
+    cv::Size image_size;
+    std::vector<cv::Point2f> image_points_left;
+    std::vector<cv::Point2f> image_points_right;
+    cv::Mat image_display_left;
+    cv::Mat image_display_right;
+};
+
 const std::vector<ImageDescriptor> getImageDescriptorsASL(const std::string& folder_images_);
 
+//ds loads a stereo image pair and locates the chessboard in both images (thread-safe for distinct measurements)
+void measureStereo(const ImageDescriptor& image_descriptor_left_,
+                   const ImageDescriptor& image_descriptor_right_,
+                   const cv::Size& board_size_,
+                   const double& square_width_meters_,
+                   const bool& create_display_images_,
+                   StereoMeasurement& measurement_);
+
 const bool measure(const cv::Mat& image_,
                    const cv::Size& board_size_,
                    const double& square_width_meters_,
@@ -36,6 +66,7 @@ int32_t main (int32_t argc_, char** argv_) {
   if (argc_ < 3) {
     std::cerr << "use: ./stereo_calibrator -srrg <messages> / -asl <folder_images_left> <folder_images_right> -o <calibration.txt>"<< std::endl;
     std::cerr << "                        [-use-gui -interspace <integer> -use-eth -check-orb -test-asl <folder_images_left_test> <folder_images_right_test>]" << std::endl;
+    std::cerr << "                        [-threads <integer> -headless]" << std::endl;
     std::cerr << "                         <folder_images_left/right> should each contain: data, data.csv (ASL format)" << std::endl;
     return EXIT_FAILURE;
   }
@@ -53,6 +84,8 @@ int32_t main (int32_t argc_, char** argv_) {
   const double maximum_timestamp_difference_seconds = 0.01;
   std::string output_file_name                      = "";
   bool option_test_orb_slam_calibration             = false;
+  uint32_t number_of_threads                        = std::max(std::thread::hardware_concurrency(), 1u);
+  bool option_headless                              = false;
 
   //ds parse parameters
   int32_t u = 1;
@@ -84,6 +117,12 @@ int32_t main (int32_t argc_, char** argv_) {
       output_file_name = argv_[u];
     } else if (!std::strcmp(argv_[u], "-check-orb")) {
       option_test_orb_slam_calibration = true;
+    } else if (!std::strcmp(argv_[u], "-threads")) {
+      ++u;
+      if (u == argc_) {break;}
+      number_of_threads = std::max(std::stoi(argv_[u]), 1);
+    } else if (!std::strcmp(argv_[u], "-headless")) {
+      option_headless = true;
     } else if (!std::strcmp(argv_[u], "-test-asl")) {
       input_format = "asl";
       ++u;
@@ -127,6 +166,11 @@ int32_t main (int32_t argc_, char** argv_) {
     }
   }
 
+  //ds without display no visualization images are created (overrides -use-gui)
+  if (option_headless) {
+    option_use_gui = false;
+  }
+
   //ds board configuration
   const uint32_t cols = 6;
   const uint32_t rows = 7;
@@ -149,6 +193,8 @@ int32_t main (int32_t argc_, char** argv_) {
   LOG_VARIABLE(option_use_eth_estimates)
   LOG_VARIABLE(output_file_name)
   LOG_VARIABLE(option_test_orb_slam_calibration)
+  LOG_VARIABLE(number_of_threads)
+  LOG_VARIABLE(option_headless)
 
   //ds load images for left and right - assuming to be synchronized
   std::vector<ImageDescriptor> image_descriptors_left;
@@ -247,7 +293,8 @@ int32_t main (int32_t argc_, char** argv_) {
   std::vector<std::vector<cv::Point2f>> image_points_per_image_left(0);
   std::vector<std::vector<cv::Point2f>> image_points_per_image_right(0);
 
-  //ds info
+  //ds select the synchronized stereo image pairs to measure (reduced number of measurements)
+  std::vector<StereoMeasurement> measurements;
   uint64_t number_of_processed_stereo_images = 0;
   for (uint32_t image_number = 0; image_number < number_of_images; ++image_number) {
 
@@ -256,65 +303,109 @@ int32_t main (int32_t argc_, char** argv_) {
 
     //ds if we have a synchronized package of sensor messages ready
     if (timestamp_difference_seconds < maximum_timestamp_difference_seconds) {
-
-      //ds grab opencv image data
-      cv::Mat image_left  = cv::imread(image_descriptors_left[image_number].file_name_image, CV_LOAD_IMAGE_GRAYSCALE);
-      cv::Mat image_right = cv::imread(image_descriptors_right[image_number].file_name_image, CV_LOAD_IMAGE_GRAYSCALE);
-      cv::Mat image_display_left, image_display_right;
-      cv::cvtColor(image_left, image_display_left, CV_GRAY2RGB);
-      cv::cvtColor(image_right, image_display_right, CV_GRAY2RGB);
-      image_size.height = image_left.rows;
-      image_size.width  = image_left.cols;
-
-      //ds reduce number of measurements
       if (number_of_processed_stereo_images % measurement_image_interspace == 0) {
+        measurements.push_back(StereoMeasurement(image_number, number_of_processed_stereo_images));
+      }
+      ++number_of_processed_stereo_images;
+    } else {
+      std::cerr << "WARNING: received high timestamp difference: " << timestamp_difference_seconds << " skipping the measurements" << std::endl;
+    }
+  }
+  std::cerr << "measuring stereo image pairs: " << measurements.size() << " (threads: " << number_of_threads << ")" << std::endl;
+  const std::chrono::steady_clock::time_point time_begin_measurements = std::chrono::steady_clock::now();
 
-        //ds locate chessboard in the left and right image
-        std::vector<cv::Point2f> image_points_left;
-        std::vector<cv::Point2f> image_points_right;
-        const bool measured_left  = measure(image_left, board_size, square_width_meters, image_points_left, image_display_left);
-        const bool measured_right = measure(image_right, board_size, square_width_meters, image_points_right, image_display_right);
-
-        //ds if both images contained the pattern
-        if (measured_left && measured_right) {
+  //ds the measurement threads already use all cores - disable the internal parallelization of OpenCV meanwhile
+  const int32_t number_of_threads_opencv = cv::getNumThreads();
+  if (number_of_threads > 1) {
+    cv::setNumThreads(1);
+  }
 
-          //ds update object and image points
-          object_points_per_image.push_back(object_points);
-          image_points_per_image_left.push_back(image_points_left);
-          image_points_per_image_right.push_back(image_points_right);
+  //ds load and measure the image pairs in parallel (workers fetch the next pair, detection times vary strongly)
+  std::atomic<size_t> index_measurement_next(0);
+  std::mutex mutex_measurements;
+  std::condition_variable measurement_completed;
+  std::vector<bool> is_measurement_completed(measurements.size(), false);
+  std::vector<std::thread> workers;
+  for (uint32_t index_thread = 0; index_thread < number_of_threads; ++index_thread) {
+    workers.push_back(std::thread([&]() {
+      while (true) {
+        const size_t index_measurement = index_measurement_next.fetch_add(1);
+        if (index_measurement >= measurements.size()) {
+          break;
         }
-
-        //ds visual info
-        if (option_use_gui) {
-          cv::Mat image_stereo;
-          cv::hconcat(image_display_left, image_display_right, image_stereo);
-          cv::imshow("calibration", image_stereo);
-          cv::waitKey(1);
+        StereoMeasurement& measurement = measurements[index_measurement];
+        measureStereo(image_descriptors_left[measurement.image_number],
+                      image_descriptors_right[measurement.image_number],
+                      board_size,
+                      square_width_meters,
+                      option_use_gui,
+                      measurement);
+        {
+          std::lock_guard<std::mutex> lock(mutex_measurements);
+          is_measurement_completed[index_measurement] = true;
         }
+        measurement_completed.notify_all();
+      }
+    }));
+  }
 
-        //ds if not checkerboard is detected
-        if (!measured_left && !measured_right) {
+  //ds collect the measurements in image order (deterministic calibration input, status and display)
+  for (size_t index_measurement = 0; index_measurement < measurements.size(); ++index_measurement) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_measurements);
+      measurement_completed.wait(lock, [&]() {return is_measurement_completed[index_measurement];});
+    }
+    StereoMeasurement& measurement = measurements[index_measurement];
+    const ImageDescriptor& image_descriptor_left  = image_descriptors_left[measurement.image_number];
+    const ImageDescriptor& image_descriptor_right = image_descriptors_right[measurement.image_number];
+    if (!measurement.is_loaded) {
+      std::cerr << "WARNING: unable to load images: " << image_descriptor_left.file_name_image << " / "
+                << image_descriptor_right.file_name_image << " skipping the measurements" << std::endl;
+      continue;
+    }
+    image_size = measurement.image_size;
 
-          //ds status: failed
-          std::printf("%06lu|L: %f|R: %f|no checkerboard detected!\n", number_of_processed_stereo_images,
-                                                                       image_descriptors_left[image_number].timestamp_seconds, image_descriptors_right[image_number].timestamp_seconds);
-        } else {
+    //ds if both images contained the pattern
+    if (measurement.measured_left && measurement.measured_right) {
 
-          //ds status
-          std::printf("%06lu|L: %f|R: %f|CL: %i CR: %i|measurements: %6lu\n", number_of_processed_stereo_images,
-                                                                              image_descriptors_left[image_number].timestamp_seconds, image_descriptors_right[image_number].timestamp_seconds,
-                                                                              measured_left, measured_right,
-                                                                              object_points_per_image.size());
-        }
-      }
+      //ds update object and image points
+      object_points_per_image.push_back(object_points);
+      image_points_per_image_left.push_back(std::move(measurement.image_points_left));
+      image_points_per_image_right.push_back(std::move(measurement.image_points_right));
+    }
 
-      //ds release processed data
-      ++number_of_processed_stereo_images;
+    //ds visual info
+    if (option_use_gui) {
+      cv::Mat image_stereo;
+      cv::hconcat(measurement.image_display_left, measurement.image_display_right, image_stereo);
+      cv::imshow("calibration", image_stereo);
+      cv::waitKey(1);
+      measurement.image_display_left.release();
+      measurement.image_display_right.release();
+    }
+
+    //ds if not checkerboard is detected
+    if (!measurement.measured_left && !measurement.measured_right) {
+
+      //ds status: failed
+      std::printf("%06lu|L: %f|R: %f|no checkerboard detected!\n", measurement.number_of_processed_stereo_images,
+                                                                   image_descriptor_left.timestamp_seconds, image_descriptor_right.timestamp_seconds);
     } else {
-      std::cerr << "WARNING: received high timestamp difference: " << timestamp_difference_seconds << " skipping the measurements" << std::endl;
+
+      //ds status
+      std::printf("%06lu|L: %f|R: %f|CL: %i CR: %i|measurements: %6lu\n", measurement.number_of_processed_stereo_images,
+                                                                          image_descriptor_left.timestamp_seconds, image_descriptor_right.timestamp_seconds,
+                                                                          measurement.measured_left, measurement.measured_right,
+                                                                          object_points_per_image.size());
     }
   }
+  for (std::thread& worker: workers) {
+    worker.join();
+  }
+  cv::setNumThreads(number_of_threads_opencv);
   cv::destroyAllWindows();
+  std::cerr << "measurement duration (s): "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now()-time_begin_measurements).count() << std::endl;
 
   //ds info
   std::cerr << "obtained measurements: " << object_points_per_image.size() << std::endl;
@@ -613,8 +704,10 @@ int32_t main (int32_t argc_, char** argv_) {
       cv::Mat image_right_undistorted_rectified;
       cv::remap(image_left, image_left_undistorted_rectified, undistort_rectify_maps_left[0], undistort_rectify_maps_left[1], cv::INTER_LINEAR);
       cv::remap(image_right, image_right_undistorted_rectified, undistort_rectify_maps_right[0], undistort_rectify_maps_right[1], cv::INTER_LINEAR);
-      cv::cvtColor(image_left_undistorted_rectified, image_display_left, CV_GRAY2RGB);
-      cv::cvtColor(image_right_undistorted_rectified, image_display_right, CV_GRAY2RGB);
+      if (option_use_gui) {
+        cv::cvtColor(image_left_undistorted_rectified, image_display_left, CV_GRAY2RGB);
+        cv::cvtColor(image_right_undistorted_rectified, image_display_right, CV_GRAY2RGB);
+      }
 
       //ds check epipolar matching - detect keypoints
       std::vector<cv::KeyPoint> keypoints_left(0);
@@ -859,15 +952,43 @@ const bool measure(const cv::Mat& image_,
   //ds refine corner locations
   cv::cornerSubPix(image_, image_points_, cv::Size(11, 11), cv::Size(-1, -1), cv::TermCriteria(cv::TermCriteria::EPS+cv::TermCriteria::COUNT, 30, 0.1));
 
-  //ds visual info
-  for (const cv::Point2f& point: image_points_) {
-    cv::circle(image_display_, point, 5, cv::Scalar(0, 255, 0), 2);
+  //ds visual info (if display images are used)
+  if (!image_display_.empty()) {
+    for (const cv::Point2f& point: image_points_) {
+      cv::circle(image_display_, point, 5, cv::Scalar(0, 255, 0), 2);
+    }
   }
 
   //ds success
   return true;
 }
 
+void measureStereo(const ImageDescriptor& image_descriptor_left_,
+                   const ImageDescriptor& image_descriptor_right_,
+                   const cv::Size& board_size_,
+                   const double& square_width_meters_,
+                   const bool& create_display_images_,
+                   StereoMeasurement& measurement_) {
+
+  //ds grab opencv image data
+  const cv::Mat image_left  = cv::imread(image_descriptor_left_.file_name_image, CV_LOAD_IMAGE_GRAYSCALE);
+  const cv::Mat image_right = cv::imread(image_descriptor_right_.file_name_image, CV_LOAD_IMAGE_GRAYSCALE);
+  if (image_left.empty() || image_right.empty()) {
+    return;
+  }
+  measurement_.is_loaded         = true;
+  measurement_.image_size.height = image_left.rows;
+  measurement_.image_size.width  = image_left.cols;
+  if (create_display_images_) {
+    cv::cvtColor(image_left, measurement_.image_display_left, CV_GRAY2RGB);
+    cv::cvtColor(image_right, measurement_.image_display_right, CV_GRAY2RGB);
+  }
+
+  //ds locate chessboard in the left and right image
+  measurement_.measured_left  = measure(image_left, board_size_, square_width_meters_, measurement_.image_points_left, measurement_.image_display_left);
+  measurement_.measured_right = measure(image_right, board_size_, square_width_meters_, measurement_.image_points_right, measurement_.image_display_right);
+}
+
 const double calibrate(const cv::Size image_size_,
                        std::vector<std::vector<cv::Point3f>>& object_points_per_image_,
                        std::vector<std::vector<cv::Point2f>>& image_points_per_image_,
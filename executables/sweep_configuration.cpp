@@ -0,0 +1,526 @@
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+#include "yaml-cpp/yaml.h"
+#include "batch_arguments.h"
+
+
+
+//ds swept configuration parameter: YAML group, name and candidate values (as written in a configuration file)
+struct Parameter {
+  std::string group;
+  std::string name;
+  std::vector<std::string> values;
+};
+
+//ds evaluated configuration: one value index per swept parameter
+struct Candidate {
+  Candidate(const size_t& index_, const std::vector<size_t>& value_indices_): index(index_), value_indices(value_indices_) {}
+  size_t index;
+  std::vector<size_t> value_indices;
+  std::string configuration_file_name;
+
+  //ds results accumulated over all datasets (set after the evaluation)
+  bool is_evaluated          = false;
+  bool is_valid              = false;
+  double fps                 = 0;
+  double ate_rmse_meters     = 0;
+  double ate_relative        = 0;
+  bool is_pareto_optimal     = false;
+};
+
+//ds selection of the configuration to emit
+struct Selection {
+  double minimum_fps             = 0; //ds most accurate configuration with at least this speed (0: unused)
+  double maximum_ate_rmse_meters = 0; //ds fastest configuration with at most this error (0: unused)
+};
+
+//ds helpers
+const bool parseParameter(const std::string& specification_, Parameter& parameter_);
+
+const bool evaluate(const std::string& evaluate_batch_file_name_,
+                    const std::string& report_file_name_,
+                    const std::vector<std::string>& dataset_file_names_,
+                    const size_t& number_of_parallel_jobs_,
+                    const std::vector<std::string>& options_,
+                    std::vector<Candidate*>& candidates_);
+
+const double getScore(const Candidate& candidate_, const std::vector<Candidate>& candidates_, const Selection& selection_);
+
+
+
+int32_t main(int32_t argc_, char** argv_) {
+  if (argc_ < 7) {
+    std::cerr << "usage: ./sweep_configuration -c <configuration.yaml> -s <dataset.txt> [-s <dataset.txt> ..] "
+              << "-p <group>.<parameter>=<value>,<value>[,..] [-p ..] [-strategy <GRID|COORDINATE>] [-rounds <integer>] "
+              << "[-min-fps <real>] [-max-error <real>] [-j <number of parallel jobs>] [-o <sweep.yaml>] [-oc <configuration_selected.yaml>] "
+              << "[-e <evaluate_batch>] [-- <srrg_proslam_app options>]" << std::endl;
+    std::cerr << "example: ./sweep_configuration -c configuration_kitti.yaml -s 00.txt -p base_framepoint_generation.bin_size_pixels=15,20,25 "
+              << "-p stereo_framepoint_generation.maximum_epipolar_search_offset_pixels=0,1 -min-fps 30" << std::endl;
+    return 0;
+  }
+
+  //ds configuration
+  BatchArguments arguments;
+  arguments.number_of_parallel_jobs            = 1;
+  arguments.report_file_name                   = "sweep.yaml";
+  std::vector<Parameter> parameters;
+  std::string strategy                         = "GRID";
+  size_t maximum_number_of_rounds              = 2;
+  Selection selection;
+  std::string selected_configuration_file_name = "configuration_selected.yaml";
+
+  //ds by default the batch evaluation next to this executable is used
+  std::string evaluate_batch_file_name(argv_[0]);
+  const size_t index_last_separator = evaluate_batch_file_name.find_last_of('/');
+  evaluate_batch_file_name = ((index_last_separator != std::string::npos)? evaluate_batch_file_name.substr(0, index_last_separator+1): "./")+"evaluate_batch";
+
+  //ds parse configuration: common batch options and the sweep specific ones
+  std::string invalid_parameter_specification;
+  parseBatchArguments(argc_, argv_, arguments, [&](const char* option_, const char* value_) {
+    if (!std::strcmp(option_, "-p")) {
+      Parameter parameter;
+      if (parseParameter(value_, parameter)) {
+        parameters.push_back(parameter);
+      } else if (invalid_parameter_specification.empty()) {
+        invalid_parameter_specification = value_;
+      }
+    } else if (!std::strcmp(option_, "-strategy")) {
+      strategy = value_;
+    } else if (!std::strcmp(option_, "-rounds")) {
+      maximum_number_of_rounds = std::max(std::stoi(value_), 1);
+    } else if (!std::strcmp(option_, "-min-fps")) {
+      selection.minimum_fps = std::stod(value_);
+    } else if (!std::strcmp(option_, "-max-error")) {
+      selection.maximum_ate_rmse_meters = std::stod(value_);
+    } else if (!std::strcmp(option_, "-oc")) {
+      selected_configuration_file_name = value_;
+    } else if (!std::strcmp(option_, "-e")) {
+      evaluate_batch_file_name = value_;
+    } else {
+      return false;
+    }
+    return true;
+  });
+  if (!invalid_parameter_specification.empty()) {
+    std::cerr << "ERROR: invalid parameter specification: '" << invalid_parameter_specification << "' (expected: <group>.<parameter>=<value>,<value>)" << std::endl;
+    return 0;
+  }
+
+  //ds a sweep starts from a single base configuration (the last one provided)
+  const std::string configuration_file_name = (arguments.configuration_file_names.empty())? "": arguments.configuration_file_names.back();
+  const std::vector<std::string>& dataset_file_names = arguments.dataset_file_names;
+  const std::vector<std::string>& options            = arguments.options;
+  const size_t& number_of_parallel_jobs              = arguments.number_of_parallel_jobs;
+  const std::string& report_file_name                = arguments.report_file_name;
+
+  //ds input validation
+  if (configuration_file_name.empty() || dataset_file_names.empty() || parameters.empty()) {
+    std::cerr << "ERROR: a configuration (-c), at least one dataset (-s) and at least one parameter (-p) are required" << std::endl;
+    return 0;
+  }
+  if (strategy != "GRID" && strategy != "COORDINATE") {
+    std::cerr << "ERROR: invalid strategy: '" << strategy << "' (select one: GRID, COORDINATE)" << std::endl;
+    return 0;
+  }
+  if (selection.minimum_fps > 0 && selection.maximum_ate_rmse_meters > 0) {
+    std::cerr << "ERROR: specify at most one selection constraint (-min-fps or -max-error)" << std::endl;
+    return 0;
+  }
+
+  //ds load the base configuration and check that all swept parameters exist (typos would be ignored by the system)
+  YAML::Node configuration_base;
+  try {
+    configuration_base = YAML::LoadFile(configuration_file_name);
+  } catch (const YAML::Exception& exception_) {
+    std::cerr << "ERROR: unable to load configuration: '" << configuration_file_name << "' (exception: '" << exception_.what() << "')" << std::endl;
+    return 0;
+  }
+  const YAML::Node& configuration_base_constant = configuration_base;
+  for (const Parameter& parameter: parameters) {
+    if (!configuration_base_constant[parameter.group] || !configuration_base_constant[parameter.group][parameter.name]) {
+      std::cerr << "ERROR: parameter not found in configuration: '" << parameter.group << "." << parameter.name << "'" << std::endl;
+      return 0;
+    }
+  }
+
+  //ds log configuration
+  size_t number_of_grid_candidates = 1;
+  std::cerr << "configuration: " << configuration_file_name << std::endl;
+  std::cerr << "number of datasets: " << dataset_file_names.size() << std::endl;
+  for (const Parameter& parameter: parameters) {
+    std::cerr << "parameter: " << parameter.group << "." << parameter.name << " (base: " << configuration_base_constant[parameter.group][parameter.name].as<std::string>()
+              << ") values: " << parameter.values.size() << std::endl;
+    number_of_grid_candidates *= parameter.values.size();
+  }
+  std::cerr << "strategy: " << strategy << " (grid size: " << number_of_grid_candidates << ")" << std::endl;
+  std::cerr << "number of parallel jobs: " << number_of_parallel_jobs << ((number_of_parallel_jobs > 1)? " (WARNING: concurrent jobs bias the measured FPS)": "") << std::endl;
+  std::cerr << "report: " << report_file_name << std::endl;
+
+  //ds all evaluated candidates, identified by their value indices
+  //ds the storage is reserved for the complete grid, such that references to candidates remain valid
+  std::vector<Candidate> candidates;
+  std::map<std::vector<size_t>, size_t> candidate_indices;
+  candidates.reserve(number_of_grid_candidates);
+
+  //ds returns the candidate for the value indices (creating its configuration file if not yet evaluated)
+  auto getCandidate = [&](const std::vector<size_t>& value_indices_) -> Candidate& {
+    std::map<std::vector<size_t>, size_t>::const_iterator iterator = candidate_indices.find(value_indices_);
+    if (iterator != candidate_indices.end()) {
+      return candidates[iterator->second];
+    }
+    candidate_indices.insert(std::make_pair(value_indices_, candidates.size()));
+    candidates.push_back(Candidate(candidates.size(), value_indices_));
+    Candidate& candidate = candidates.back();
+
+    //ds the candidate configuration is the base configuration with the swept values
+    YAML::Node configuration(YAML::Clone(configuration_base));
+    for (size_t index = 0; index < parameters.size(); ++index) {
+      configuration[parameters[index].group][parameters[index].name] = YAML::Load(parameters[index].values[value_indices_[index]]);
+    }
+    candidate.configuration_file_name = report_file_name+".configuration_"+std::to_string(candidate.index)+".yaml";
+    std::ofstream configuration_file(candidate.configuration_file_name, std::ofstream::out);
+    YAML::Emitter emitter;
+    emitter << configuration;
+    configuration_file << emitter.c_str() << std::endl;
+    return candidate;
+  };
+
+  //ds evaluates a set of value indices per batch (skipping already evaluated candidates)
+  size_t number_of_batches = 0;
+  auto evaluateBatch = [&](const std::vector<std::vector<size_t>>& value_indices_per_candidate_) -> const bool {
+    std::vector<Candidate*> batch;
+    for (const std::vector<size_t>& value_indices: value_indices_per_candidate_) {
+      Candidate& candidate = getCandidate(value_indices);
+      if (!candidate.is_evaluated && std::find(batch.begin(), batch.end(), &candidate) == batch.end()) {
+        batch.push_back(&candidate);
+      }
+    }
+    if (batch.empty()) {
+      return true;
+    }
+    const std::string batch_report_file_name = report_file_name+".batch_"+std::to_string(number_of_batches)+".yaml";
+    ++number_of_batches;
+    std::cerr << "main|evaluating candidates: " << batch.size() << " (report: " << batch_report_file_name << ")" << std::endl;
+    return evaluate(evaluate_batch_file_name, batch_report_file_name, dataset_file_names, number_of_parallel_jobs, options, batch);
+  };
+
+  //ds value indices of the base configuration (the first value of a parameter if its base value is not swept)
+  std::vector<size_t> value_indices_base(parameters.size(), 0);
+  for (size_t index = 0; index < parameters.size(); ++index) {
+    const std::string value_base = configuration_base_constant[parameters[index].group][parameters[index].name].as<std::string>();
+    for (size_t index_value = 0; index_value < parameters[index].values.size(); ++index_value) {
+      if (YAML::Load(parameters[index].values[index_value]).as<std::string>() == value_base) {
+        value_indices_base[index] = index_value;
+      }
+    }
+  }
+
+  if (strategy == "GRID") {
+
+    //ds evaluate the full cartesian product in a single batch (best utilization of parallel jobs)
+    std::vector<std::vector<size_t>> value_indices_per_candidate;
+    std::vector<size_t> value_indices(parameters.size(), 0);
+    for (size_t index_candidate = 0; index_candidate < number_of_grid_candidates; ++index_candidate) {
+      value_indices_per_candidate.push_back(value_indices);
+      for (size_t index = 0; index < parameters.size(); ++index) {
+        if (++value_indices[index] < parameters[index].values.size()) {
+          break;
+        }
+        value_indices[index] = 0;
+      }
+    }
+    if (!evaluateBatch(value_indices_per_candidate)) {
+      return 0;
+    }
+  } else {
+
+    //ds coordinate search: sweep one parameter at a time around the currently best configuration (linear in the number of values)
+    std::vector<size_t> value_indices_best(value_indices_base);
+    if (!evaluateBatch(std::vector<std::vector<size_t>>(1, value_indices_best))) {
+      return 0;
+    }
+    for (size_t round = 0; round < maximum_number_of_rounds; ++round) {
+      bool is_changed = false;
+      for (size_t index = 0; index < parameters.size(); ++index) {
+        std::vector<std::vector<size_t>> value_indices_per_candidate;
+        for (size_t index_value = 0; index_value < parameters[index].values.size(); ++index_value) {
+          value_indices_per_candidate.push_back(value_indices_best);
+          value_indices_per_candidate.back()[index] = index_value;
+        }
+        if (!evaluateBatch(value_indices_per_candidate)) {
+          return 0;
+        }
+
+        //ds move to the best value of this parameter
+        const std::vector<size_t> value_indices_previous(value_indices_best);
+        double score_best = getScore(getCandidate(value_indices_best), candidates, selection);
+        for (const std::vector<size_t>& value_indices: value_indices_per_candidate) {
+          const double score = getScore(getCandidate(value_indices), candidates, selection);
+          if (score < score_best) {
+            score_best         = score;
+            value_indices_best = value_indices;
+          }
+        }
+        is_changed |= (value_indices_best != value_indices_previous);
+      }
+      std::cerr << "main|completed round: " << round << " (evaluated candidates: " << candidates.size() << ")" << std::endl;
+      if (!is_changed) {
+        break;
+      }
+    }
+  }
+
+  //ds determine the Pareto front: no other candidate is at least as fast and accurate and strictly better in one
+  std::vector<const Candidate*> pareto_front;
+  for (Candidate& candidate: candidates) {
+    if (!candidate.is_valid) {
+      continue;
+    }
+    candidate.is_pareto_optimal = true;
+    for (const Candidate& other: candidates) {
+      if (other.is_valid && other.fps >= candidate.fps && other.ate_rmse_meters <= candidate.ate_rmse_meters &&
+          (other.fps > candidate.fps || other.ate_rmse_meters < candidate.ate_rmse_meters)) {
+        candidate.is_pareto_optimal = false;
+        break;
+      }
+    }
+    if (candidate.is_pareto_optimal) {
+      pareto_front.push_back(&candidate);
+    }
+  }
+  std::sort(pareto_front.begin(), pareto_front.end(), [](const Candidate* a_, const Candidate* b_) {return a_->fps < b_->fps;});
+  if (pareto_front.empty()) {
+    std::cerr << "ERROR: no candidate was evaluated successfully with ground truth (see the logs next to: " << report_file_name << ")" << std::endl;
+    return 0;
+  }
+
+  //ds select the configuration on the front
+  const Candidate* candidate_selected = nullptr;
+  double score_best = std::numeric_limits<double>::max();
+  for (const Candidate* candidate: pareto_front) {
+    const double score = getScore(*candidate, candidates, selection);
+    if (score < score_best) {
+      score_best         = score;
+      candidate_selected = candidate;
+    }
+  }
+  if (score_best == std::numeric_limits<double>::max()) {
+    std::cerr << "WARNING: no candidate satisfies the selection constraint - selecting the closest one" << std::endl;
+    candidate_selected = (selection.minimum_fps > 0)? pareto_front.back(): pareto_front.front();
+  }
+
+  //ds print the front, slowest first
+  std::cerr << "\nPareto front (FPS vs. ATE RMSE):" << std::endl;
+  for (const Candidate* candidate: pareto_front) {
+    std::printf("%s candidate: %4lu FPS: %8.2f ATE RMSE (m): %9.4f ATE relative: %8.5f |", (candidate == candidate_selected)? "*": " ",
+                candidate->index, candidate->fps, candidate->ate_rmse_meters, candidate->ate_relative);
+    for (size_t index = 0; index < parameters.size(); ++index) {
+      std::printf(" %s: %s", parameters[index].name.c_str(), parameters[index].values[candidate->value_indices[index]].c_str());
+    }
+    std::printf("\n");
+  }
+  std::fflush(stdout);
+
+  //ds write the selected configuration
+  {
+    YAML::Node configuration(YAML::LoadFile(candidate_selected->configuration_file_name));
+    std::ofstream configuration_file(selected_configuration_file_name, std::ofstream::out);
+    configuration_file << "#ds selected by sweep_configuration from: '" << configuration_file_name << "' (FPS: " << candidate_selected->fps
+                       << " ATE RMSE (m): " << candidate_selected->ate_rmse_meters << ")" << std::endl;
+    YAML::Emitter emitter;
+    emitter << configuration;
+    configuration_file << emitter.c_str() << std::endl;
+  }
+
+  //ds write the report (YAML)
+  std::ofstream report(report_file_name, std::ofstream::out);
+  if (!report.good()) {
+    std::cerr << "ERROR: unable to open report: '" << report_file_name << "'" << std::endl;
+    return 0;
+  }
+  report << "sweep:" << std::endl;
+  report << "  configuration: " << quote(configuration_file_name) << std::endl;
+  report << "  strategy: " << strategy << std::endl;
+  report << "  number_of_candidates: " << candidates.size() << std::endl;
+  report << "  number_of_pareto_optimal_candidates: " << pareto_front.size() << std::endl;
+  report << "  selected_candidate: " << candidate_selected->index << std::endl;
+  report << "  selected_configuration: " << quote(selected_configuration_file_name) << std::endl;
+  report << "candidates:" << std::endl;
+  for (const Candidate& candidate: candidates) {
+    report << "  - index: " << candidate.index << std::endl;
+    report << "    configuration: " << quote(candidate.configuration_file_name) << std::endl;
+    report << "    parameters:" << std::endl;
+    for (size_t index = 0; index < parameters.size(); ++index) {
+      report << "      " << parameters[index].group << "." << parameters[index].name << ": " << parameters[index].values[candidate.value_indices[index]] << std::endl;
+    }
+    report << "    is_valid: " << candidate.is_valid << std::endl;
+    if (candidate.is_valid) {
+      report << "    fps: " << candidate.fps << std::endl;
+      report << "    ate_rmse_meters: " << candidate.ate_rmse_meters << std::endl;
+      report << "    ate_relative: " << candidate.ate_relative << std::endl;
+      report << "    is_pareto_optimal: " << candidate.is_pareto_optimal << std::endl;
+    }
+  }
+  report.close();
+  std::cerr << "main|written report: " << report_file_name << " and selected configuration: " << selected_configuration_file_name << std::endl;
+  return 0;
+}
+
+const bool parseParameter(const std::string& specification_, Parameter& parameter_) {
+  const size_t index_separator  = specification_.find('.');
+  const size_t index_assignment = specification_.find('=');
+  if (index_separator == std::string::npos || index_assignment == std::string::npos || index_separator > index_assignment) {
+    return false;
+  }
+  parameter_.group = specification_.substr(0, index_separator);
+  parameter_.name  = specification_.substr(index_separator+1, index_assignment-index_separator-1);
+  size_t index_begin = index_assignment+1;
+  while (index_begin <= specification_.size()) {
+    const size_t index_end = std::min(specification_.find(',', index_begin), specification_.size());
+    if (index_end > index_begin) {
+      parameter_.values.push_back(specification_.substr(index_begin, index_end-index_begin));
+    }
+    index_begin = index_end+1;
+  }
+  return !parameter_.group.empty() && !parameter_.name.empty() && !parameter_.values.empty();
+}
+
+const bool evaluate(const std::string& evaluate_batch_file_name_,
+                    const std::string& report_file_name_,
+                    const std::vector<std::string>& dataset_file_names_,
+                    const size_t& number_of_parallel_jobs_,
+                    const std::vector<std::string>& options_,
+                    std::vector<Candidate*>& candidates_) {
+
+  //ds assemble the batch evaluation command line: all candidate configurations on all datasets
+  std::vector<std::string> arguments = {evaluate_batch_file_name_};
+  for (const Candidate* candidate: candidates_) {
+    arguments.push_back("-c");
+    arguments.push_back(candidate->configuration_file_name);
+  }
+  for (const std::string& dataset_file_name: dataset_file_names_) {
+    arguments.push_back("-s");
+    arguments.push_back(dataset_file_name);
+  }
+  arguments.push_back("-j");
+  arguments.push_back(std::to_string(number_of_parallel_jobs_));
+  arguments.push_back("-o");
+  arguments.push_back(report_file_name_);
+  if (!options_.empty()) {
+    arguments.push_back("--");
+    arguments.insert(arguments.end(), options_.begin(), options_.end());
+  }
+  std::vector<char*> argv;
+  for (std::string& argument: arguments) {
+    argv.push_back(&argument[0]);
+  }
+  argv.push_back(nullptr);
+
+  //ds run the batch evaluation and wait for it
+  std::cout.flush();
+  std::cerr.flush();
+  const pid_t process_identifier = fork();
+  if (process_identifier < 0) {
+    std::cerr << "ERROR: unable to fork for: " << evaluate_batch_file_name_ << std::endl;
+    return false;
+  }
+  if (process_identifier == 0) {
+    execv(argv[0], argv.data());
+    std::cerr << "ERROR: unable to run: " << evaluate_batch_file_name_ << " (specify it with -e)" << std::endl;
+    _exit(1);
+  }
+  int32_t status = 0;
+  if (waitpid(process_identifier, &status, 0) != process_identifier || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    std::cerr << "ERROR: batch evaluation failed: " << evaluate_batch_file_name_ << std::endl;
+    return false;
+  }
+
+  //ds collect the results per candidate (a candidate is valid if all its runs succeeded with ground truth)
+  YAML::Node report;
+  try {
+    report = YAML::LoadFile(report_file_name_);
+  } catch (const YAML::Exception& exception_) {
+    std::cerr << "ERROR: unable to load batch report: '" << report_file_name_ << "' (exception: '" << exception_.what() << "')" << std::endl;
+    return false;
+  }
+  for (Candidate* candidate: candidates_) {
+    candidate->is_evaluated = true;
+    candidate->is_valid     = true;
+    size_t number_of_runs              = 0;
+    double number_of_processed_frames  = 0;
+    double processing_time_seconds     = 0;
+    double sum_ate_rmse_meters         = 0;
+    double sum_ate_relative            = 0;
+    for (const YAML::Node& job: report["jobs"]) {
+      if (job["configuration"].as<std::string>() != candidate->configuration_file_name) {
+        continue;
+      }
+      ++number_of_runs;
+      if (job["exit_status"].as<int32_t>() != 0 || !job["ate_rmse_meters"]) {
+        candidate->is_valid = false;
+        continue;
+      }
+      number_of_processed_frames += job["number_of_processed_frames"].as<double>();
+      processing_time_seconds    += job["processing_time_total_seconds"].as<double>();
+      sum_ate_rmse_meters        += job["ate_rmse_meters"].as<double>();
+      sum_ate_relative           += job["ate_relative"].as<double>();
+    }
+    if (number_of_runs != dataset_file_names_.size() || processing_time_seconds <= 0) {
+      candidate->is_valid = false;
+    }
+
+    //ds FPS over all datasets, errors averaged per dataset
+    if (candidate->is_valid) {
+      candidate->fps             = number_of_processed_frames/processing_time_seconds;
+      candidate->ate_rmse_meters = sum_ate_rmse_meters/number_of_runs;
+      candidate->ate_relative    = sum_ate_relative/number_of_runs;
+    }
+    std::cerr << "main|candidate " << candidate->index << ": ";
+    if (candidate->is_valid) {
+      std::cerr << "FPS: " << candidate->fps << " ATE RMSE (m): " << candidate->ate_rmse_meters << std::endl;
+    } else {
+      std::cerr << "failed (see the logs next to: " << report_file_name_ << ")" << std::endl;
+    }
+  }
+  return true;
+}
+
+const double getScore(const Candidate& candidate_, const std::vector<Candidate>& candidates_, const Selection& selection_) {
+  if (!candidate_.is_valid) {
+    return std::numeric_limits<double>::max();
+  }
+
+  //ds constrained selection: most accurate above the speed, fastest below the error
+  if (selection_.minimum_fps > 0) {
+    return (candidate_.fps >= selection_.minimum_fps)? candidate_.ate_rmse_meters: std::numeric_limits<double>::max();
+  }
+  if (selection_.maximum_ate_rmse_meters > 0) {
+    return (candidate_.ate_rmse_meters <= selection_.maximum_ate_rmse_meters)? -candidate_.fps: std::numeric_limits<double>::max();
+  }
+
+  //ds balanced selection: distance to the ideal point (fastest and most accurate evaluated values) in normalized units
+  double fps_minimum   = candidate_.fps;
+  double fps_maximum   = candidate_.fps;
+  double error_minimum = candidate_.ate_rmse_meters;
+  double error_maximum = candidate_.ate_rmse_meters;
+  for (const Candidate& candidate: candidates_) {
+    if (candidate.is_valid) {
+      fps_minimum   = std::min(fps_minimum, candidate.fps);
+      fps_maximum   = std::max(fps_maximum, candidate.fps);
+      error_minimum = std::min(error_minimum, candidate.ate_rmse_meters);
+      error_maximum = std::max(error_maximum, candidate.ate_rmse_meters);
+    }
+  }
+  const double fps_deficit  = (fps_maximum-candidate_.fps)/std::max(fps_maximum-fps_minimum, 1e-9);
+  const double error_excess = (candidate_.ate_rmse_meters-error_minimum)/std::max(error_maximum-error_minimum, 1e-9);
+  return std::sqrt(fps_deficit*fps_deficit+error_excess*error_excess);
+}
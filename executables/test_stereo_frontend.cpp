@@ -1,14 +1,10 @@
 #include <fstream>
 #include "framepoint_generation/stereo_framepoint_generator.h"
+#include "kitti_utilities.h"
 using namespace proslam;
 
 
 
-//ds helpers
-Eigen::Matrix3d getCameraCalibrationMatrixKITTI(const std::string& file_name_calibration_, Eigen::Vector3d& baseline_pixels_);
-
-
-
 int32_t main(int32_t argc_, char** argv_) {
 
   //ds validate input
@@ -69,6 +65,8 @@ int32_t main(int32_t argc_, char** argv_) {
   //ds load camera matrix and stereo configuration (offset to camera right)
   Eigen::Vector3d baseline_pixels_(Eigen::Vector3d::Zero());
   const Eigen::Matrix3d camera_calibration_matrix(getCameraCalibrationMatrixKITTI(file_name_calibration, baseline_pixels_));
+  std::cerr << "loaded camera calibration matrix: \n" << camera_calibration_matrix << std::endl;
+  std::cerr << "with baseline (pixels): " << baseline_pixels_.transpose() << std::endl;
 
   //ds parse image extension from left image
   const std::size_t index_delimiter_extension = file_name_initial_image_left.find_last_of('.');
@@ -130,9 +128,11 @@ int32_t main(int32_t argc_, char** argv_) {
     const int32_t cols = image_left.cols;
 
     //ds allocate a new, empty frame
-    Frame* frame = new Frame(nullptr, frame_previous, nullptr, TransformMatrix3D::Identity(), 0);
+    const Identifier identifier_frame = (frame_previous)? frame_previous->identifier()+1: 0;
+    Frame* frame = new Frame(identifier_frame, nullptr, frame_previous, nullptr, TransformMatrix3D::Identity(), 0);
     frame->setCameraLeft(camera_left);
     frame->setCameraRight(camera_right);
+    frame->setIsVisualizationDataEnabled(true); //ds projection estimates are displayed
     frame->setIntensityImageLeft(image_left);
     frame->setIntensityImageRight(image_right);
 
@@ -255,13 +255,8 @@ int32_t main(int32_t argc_, char** argv_) {
 
     //ds compute file name for next images
     ++number_of_processed_images;
-    std::string file_name_tail             = std::to_string(number_of_processed_images);
-    const uint32_t number_of_padding_zeros = number_of_enumeration_characters-file_name_tail.length();
-    for (uint32_t u = 0; u < number_of_padding_zeros; ++u) {
-      file_name_tail = "0"+file_name_tail;
-    }
-    file_name_image_left  = directory_name_images_left+file_name_tail+extension;
-    file_name_image_right = directory_name_images_right+file_name_tail+extension;
+    file_name_image_left  = getImageFileName(file_name_initial_image_left, number_of_processed_images);
+    file_name_image_right = getImageFileName(file_name_initial_image_right, number_of_processed_images);
 
     //ds read next images
     image_left.release();
@@ -277,36 +272,3 @@ int32_t main(int32_t argc_, char** argv_) {
   delete parameters;
   return 0;
 }
-
-Eigen::Matrix3d getCameraCalibrationMatrixKITTI(const std::string& file_name_calibration_, Eigen::Vector3d& baseline_pixels_) {
-
-  //ds load camera matrix - for now only KITTI parsing
-  std::ifstream file_calibration(file_name_calibration_, std::ifstream::in);
-  std::string line_buffer("");
-  std::getline(file_calibration, line_buffer);
-  if (line_buffer.empty()) {
-    throw std::runtime_error("invalid camera calibration file provided");
-  }
-  std::istringstream stream_left(line_buffer);
-  Eigen::Matrix3d camera_calibration_matrix(Eigen::Matrix3d::Identity());
-  baseline_pixels_.setZero();
-
-  //ds parse in fixed order
-  std::string filler(""); stream_left >> filler;
-  stream_left >> camera_calibration_matrix(0,0);
-  stream_left >> filler;
-  stream_left >> camera_calibration_matrix(0,2);
-  stream_left >> filler; stream_left >> filler;
-  stream_left >> camera_calibration_matrix(1,1);
-  stream_left >> camera_calibration_matrix(1,2);
-
-  //ds read second projection matrix to obtain the horizontal offset
-  std::getline(file_calibration, line_buffer);
-  std::istringstream stream_right(line_buffer);
-  stream_right >> filler; stream_right >> filler; stream_right >> filler; stream_right >> filler;
-  stream_right >> baseline_pixels_(0);
-  file_calibration.close();
-  std::cerr << "loaded camera calibration matrix: \n" << camera_calibration_matrix << std::endl;
-  std::cerr << "with baseline (pixels): " << baseline_pixels_.transpose() << std::endl;
-  return camera_calibration_matrix;
-}
@@ -1,29 +1,84 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <cstring>
 #include <Eigen/Geometry>
 
 #include "srrg_types/types.hpp"
+#include "types/mapped_text_file.h"
 
 using namespace srrg_core;
+using namespace proslam;
+
+//ds orientation storage without alignment requirements (measurements are kept in plain std::vectors)
+typedef Eigen::Quaternion<double, Eigen::DontAlign> Orientation;
 
 struct PositionMeasurement {
     PositionMeasurement(const double& timestamp_seconds_,
-                        const Eigen::Vector3d& position_): timestamp_seconds(timestamp_seconds_),
-                                                           position(position_) {}
-    PositionMeasurement(): timestamp_seconds(0), position(Eigen::Vector3d::Zero()) {}
+                        const Eigen::Vector3d& position_,
+                        const Orientation& orientation_ = Orientation::Identity()): timestamp_seconds(timestamp_seconds_),
+                                                                                    position(position_),
+                                                                                    orientation(orientation_) {}
+    PositionMeasurement(): timestamp_seconds(0), position(Eigen::Vector3d::Zero()), orientation(Orientation::Identity()) {}
     double timestamp_seconds;
     Eigen::Vector3d position;
+    Orientation orientation;
+};
+
+//ds relative pose error statistics for a segment length
+struct SegmentError {
+    double length_meters           = 0;
+    double sum_translation_errors  = 0;
+    double sum_rotation_errors     = 0;
+    uint64_t number_of_segments    = 0;
 };
 
-const double getAbsoluteTranslationRootMeanSquaredError(const std::vector<std::pair<PositionMeasurement, PositionMeasurement>> position_correspondences_);
+const bool parseTrajectoryTUM(const std::string& file_name_, std::vector<PositionMeasurement>& measurements_);
+
+const bool parseTrajectoryASL(const std::string& file_name_, std::vector<PositionMeasurement>& measurements_);
+
+const double getAbsoluteTranslationRootMeanSquaredError(const std::vector<std::pair<PositionMeasurement, PositionMeasurement>>& position_correspondences_);
 
 const Eigen::Vector3d getInterpolatedPositionLinear(const PositionMeasurement& ground_truth_previous_,
                                                     const PositionMeasurement& ground_truth_next_,
                                                     const PositionMeasurement& measurement_);
 
+void getRelativePoseErrors(const std::vector<std::pair<PositionMeasurement, PositionMeasurement>>& pose_correspondences_,
+                           const uint32_t& step_,
+                           const uint32_t& number_of_threads_,
+                           std::vector<SegmentError>& segment_errors_);
+
+//ds wall time for the duration reports
+const double getTimeSeconds() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//ds runs function_(index_thread, index_begin, index_end) on contiguous blocks of the items in parallel
+template<typename FunctionType_>
+void parallelFor(const uint64_t& number_of_items_, const uint32_t& number_of_threads_, FunctionType_ function_) {
+  const uint64_t number_of_threads = std::max(static_cast<uint64_t>(1), std::min(static_cast<uint64_t>(number_of_threads_), number_of_items_));
+  const uint64_t number_of_items_per_thread = (number_of_items_+number_of_threads-1)/number_of_threads;
+  std::vector<std::thread> workers;
+  workers.reserve(number_of_threads-1);
+  for (uint32_t index_thread = 1; index_thread < number_of_threads; ++index_thread) {
+    workers.push_back(std::thread(function_,
+                                  index_thread,
+                                  std::min(index_thread*number_of_items_per_thread, number_of_items_),
+                                  std::min((index_thread+1)*number_of_items_per_thread, number_of_items_)));
+  }
+  function_(0, 0, std::min(number_of_items_per_thread, number_of_items_));
+  for (std::thread& worker: workers) {
+    worker.join();
+  }
+}
+
 int32_t main (int32_t argc_, char** argv_) {
   if (argc_ < 5) {
-    std::cerr << "usage: ./trajectory_analyzer -tum <trajectory.txt> -asl <ground_truth.txt> [-skip <integer>]" << std::endl;
+    std::cerr << "usage: ./trajectory_analyzer -tum <trajectory.txt> -asl <ground_truth.txt> [-skip <integer>] "
+                 "[-rpe <segment lengths in meters, e.g. 1,2,5,10>] [-rpe-step <integer>] [-threads <integer>]" << std::endl;
     return 0;
   }
 
@@ -31,6 +86,9 @@ int32_t main (int32_t argc_, char** argv_) {
   std::string file_name_trajectory_slam = argv_[1];
   std::string file_name_trajectory_ground_truth = argv_[2];
   uint32_t number_of_poses_to_skip = 0;
+  std::vector<double> segment_lengths_meters;
+  uint32_t segment_step = 1;
+  uint32_t number_of_threads = std::max(std::thread::hardware_concurrency(), 1u);
 
   //ds parse configuration
   int32_t number_of_checked_parameters = 1;
@@ -47,6 +105,28 @@ int32_t main (int32_t argc_, char** argv_) {
       ++number_of_checked_parameters;
       if (number_of_checked_parameters == argc_) {break;}
       number_of_poses_to_skip = std::stoi(argv_[number_of_checked_parameters]);
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-rpe")) {
+      ++number_of_checked_parameters;
+      if (number_of_checked_parameters == argc_) {break;}
+      const char* cursor = argv_[number_of_checked_parameters];
+      const char* end    = cursor+std::strlen(cursor);
+      double segment_length_meters = 0;
+      while (parseNumber(cursor, end, segment_length_meters)) {
+        if (segment_length_meters > 0) {
+          segment_lengths_meters.push_back(segment_length_meters);
+        }
+        if (cursor < end && *cursor == ',') {
+          ++cursor;
+        }
+      }
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-rpe-step")) {
+      ++number_of_checked_parameters;
+      if (number_of_checked_parameters == argc_) {break;}
+      segment_step = std::max(std::stoi(argv_[number_of_checked_parameters]), 1);
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-threads")) {
+      ++number_of_checked_parameters;
+      if (number_of_checked_parameters == argc_) {break;}
+      number_of_threads = std::max(std::stoi(argv_[number_of_checked_parameters]), 1);
     }
     ++number_of_checked_parameters;
   }
@@ -55,142 +135,79 @@ int32_t main (int32_t argc_, char** argv_) {
   std::cerr << "file_name_trajectory_slam: " << file_name_trajectory_slam << std::endl;
   std::cerr << "file_name_trajectory_ground_truth: " << file_name_trajectory_ground_truth << std::endl;
   std::cerr << "number_of_poses_to_skip: " << number_of_poses_to_skip << std::endl;
-
-  //ds parse SLAM trajectory
-  std::ifstream input_stream_trajectory_slam(file_name_trajectory_slam);
-  if (!input_stream_trajectory_slam.good() || !input_stream_trajectory_slam.is_open()) {
-    std::cerr << "ERROR: unable to open: '" << file_name_trajectory_slam << "'" << std::endl;
-    return 0;
-  }
+  std::cerr << "number_of_segment_lengths: " << segment_lengths_meters.size() << " (step: " << segment_step << ")" << std::endl;
+  std::cerr << "number_of_threads: " << number_of_threads << std::endl;
+  const double time_begin_seconds = getTimeSeconds();
 
   //ds load SLAM trajectory poses
   std::vector<PositionMeasurement> positions_slam;
-  std::string buffer_line;
-  uint32_t skipped_poses = 0;
-  while (std::getline(input_stream_trajectory_slam, buffer_line)) {
-
-    //ds get line to a string stream object
-    std::istringstream stringstream(buffer_line);
-
-    //ds possible values
-    double timestamp_seconds = 0;
-    double translation_x = 0;
-    double translation_y = 0;
-    double translation_z = 0;
-    double quaternion_w  = 0;
-    double quaternion_x  = 0;
-    double quaternion_y  = 0;
-    double quaternion_z  = 0;
-
-    //ds parse the full line and check for failure
-    if (!(stringstream >> timestamp_seconds >> translation_x >> translation_y >> translation_z
-                                            >> quaternion_x >> quaternion_y >> quaternion_z >> quaternion_w)) {
-      std::cerr << "ERROR: unable to parse pose lines" << std::endl;
-      input_stream_trajectory_slam.close();
-      return 0;
-    }
-
-    //ds set pose value
-    Eigen::Isometry3d parsed_pose(Eigen::Isometry3d::Identity());
-    parsed_pose.translation() = Eigen::Vector3d(translation_x, translation_y, translation_z);
-    parsed_pose.linear()      = Eigen::Quaterniond(quaternion_w, quaternion_x, quaternion_y, quaternion_z).toRotationMatrix();
-
-    if (skipped_poses >= number_of_poses_to_skip) {
-      positions_slam.push_back(PositionMeasurement(timestamp_seconds, parsed_pose.translation()));
-    } else {
-      ++skipped_poses;
-    }
+  if (!parseTrajectoryTUM(file_name_trajectory_slam, positions_slam)) {
+    return 0;
   }
-  input_stream_trajectory_slam.close();
 
   //ds check skip
-  if (number_of_poses_to_skip >= positions_slam.size()) {
+  if (2*number_of_poses_to_skip >= positions_slam.size()) {
     std::cerr << "ERROR: insufficient number of measurements for number_of_poses_to_skip: " << number_of_poses_to_skip << std::endl;
     return 0;
   }
 
-  //ds also cut skipped poses from the end
+  //ds cut skipped poses from the beginning and the end
+  positions_slam.erase(positions_slam.begin(), positions_slam.begin()+number_of_poses_to_skip);
   positions_slam.resize(positions_slam.size()-number_of_poses_to_skip);
   std::cerr << "loaded trajectory SLAM positions: " << positions_slam.size() << " for: " << file_name_trajectory_slam << std::endl;
 
-  //ds parse ground truth trajectory
-  std::ifstream input_stream_trajectory_ground_truth(file_name_trajectory_ground_truth);
-  if (!input_stream_trajectory_ground_truth.good() || !input_stream_trajectory_ground_truth.is_open()) {
-    std::cerr << "ERROR: unable to open: '" << file_name_trajectory_ground_truth << "'" << std::endl;
-    return 0;
-  }
-
   //ds load ground truth poses
   std::vector<PositionMeasurement> positions_ground_truth;
-  while (std::getline(input_stream_trajectory_ground_truth, buffer_line)) {
-
-    //ds skip comment lines
-    if (buffer_line[0] == '#') {
-      continue;
-    }
-
-    //ds parse control
-    std::string::size_type index_begin_item = 0;
-    std::string::size_type index_end_item   = 0;
-
-    //ds parse timestamp
-    index_end_item = buffer_line.find(",", index_begin_item);
-    const uint64_t timestamp_nanoseconds = std::atol(buffer_line.substr(index_begin_item, index_end_item).c_str());
-    const double timestamp_seconds       = timestamp_nanoseconds/1e9;
-    index_begin_item = index_end_item+1;
-
-    //ds position buffer
-    Eigen::Isometry3d leica_to_world(Eigen::Isometry3d::Identity());
-    for (uint32_t row = 0; row < 3; ++row) {
-      index_end_item = buffer_line.find(",", index_begin_item);
-      leica_to_world.translation()(row) = std::strtod(buffer_line.substr(index_begin_item, index_end_item-index_begin_item).c_str(), 0);
-      index_begin_item = index_end_item+1;
-    }
-
-    //ds add to buffer
-    positions_ground_truth.push_back(PositionMeasurement(timestamp_seconds, leica_to_world.translation()));
+  if (!parseTrajectoryASL(file_name_trajectory_ground_truth, positions_ground_truth)) {
+    return 0;
   }
-  input_stream_trajectory_ground_truth.close();
   std::cerr << "loaded trajectory ground truth positions: " << positions_ground_truth.size() << " for: " << file_name_trajectory_ground_truth << std::endl;
+  std::cerr << "parsing duration (s): " << getTimeSeconds()-time_begin_seconds << std::endl;
+
+  //ds the association sweeps both trajectories in timestamp order
+  auto is_earlier = [](const PositionMeasurement& a_, const PositionMeasurement& b_) {return a_.timestamp_seconds < b_.timestamp_seconds;};
+  if (!std::is_sorted(positions_slam.begin(), positions_slam.end(), is_earlier)) {
+    std::stable_sort(positions_slam.begin(), positions_slam.end(), is_earlier);
+  }
+  if (!std::is_sorted(positions_ground_truth.begin(), positions_ground_truth.end(), is_earlier)) {
+    std::stable_sort(positions_ground_truth.begin(), positions_ground_truth.end(), is_earlier);
+  }
 
   //ds corresponding measurements
   std::vector<std::pair<PositionMeasurement, PositionMeasurement>> position_correspondences;
+  position_correspondences.reserve(positions_slam.size());
   Eigen::Vector3d position_shift(Eigen::Vector3d::Zero());
 
-  //ds for each measurement
+  //ds for each measurement - advance to the last ground truth measurement not after it
+  uint64_t index_ground_truth = 0;
   for (uint64_t index_slam = 0; index_slam < positions_slam.size(); ++index_slam) {
     PositionMeasurement& measurement = positions_slam[index_slam];
-
-    //ds find closest ground truth point - bruteforce
-    double timestamp_difference_seconds_best = 1;
-    uint32_t index_best                      = 0;
-    for (uint64_t index_ground_truth = 0; index_ground_truth < positions_ground_truth.size(); ++index_ground_truth) {
-      const double timestamp_difference_seconds = std::fabs(measurement.timestamp_seconds-positions_ground_truth[index_ground_truth].timestamp_seconds);
-      if (timestamp_difference_seconds < timestamp_difference_seconds_best) {
-        timestamp_difference_seconds_best = timestamp_difference_seconds;
-        index_best = index_ground_truth;
-      }
+    while (index_ground_truth+1 < positions_ground_truth.size() &&
+           positions_ground_truth[index_ground_truth+1].timestamp_seconds <= measurement.timestamp_seconds) {
+      ++index_ground_truth;
     }
 
-    //ds skip until we arrive at the ground truth timestamp
-    if (index_best == 0) {
+    //ds skip measurements outside of the ground truth
+    if (index_ground_truth+1 >= positions_ground_truth.size() ||
+        positions_ground_truth[index_ground_truth].timestamp_seconds > measurement.timestamp_seconds) {
       continue;
     }
+    const PositionMeasurement& ground_truth_previous = positions_ground_truth[index_ground_truth];
+    const PositionMeasurement& ground_truth_next     = positions_ground_truth[index_ground_truth+1];
 
-    //ds solution
-    PositionMeasurement ground_truth_interpolated(measurement.timestamp_seconds, measurement.position);
-
-    //ds interpolation: check if before the system
-    if (positions_ground_truth[index_best].timestamp_seconds < measurement.timestamp_seconds) {
-
-      //ds interpolate to next
-      ground_truth_interpolated.position = getInterpolatedPositionLinear(positions_ground_truth[index_best], positions_ground_truth[index_best+1], measurement);
-    } else {
-
-      //ds interpolate from previous
-      ground_truth_interpolated.position = getInterpolatedPositionLinear(positions_ground_truth[index_best-1], positions_ground_truth[index_best], measurement);
+    //ds skip measurements without ground truth in the vicinity (1 second to the closest ground truth measurement)
+    if (std::min(measurement.timestamp_seconds-ground_truth_previous.timestamp_seconds,
+                 ground_truth_next.timestamp_seconds-measurement.timestamp_seconds) >= 1) {
+      continue;
     }
 
+    //ds solution: interpolated between the enclosing ground truth measurements
+    const double ratio = (measurement.timestamp_seconds-ground_truth_previous.timestamp_seconds)/
+                         (ground_truth_next.timestamp_seconds-ground_truth_previous.timestamp_seconds);
+    PositionMeasurement ground_truth_interpolated(measurement.timestamp_seconds,
+                                                  getInterpolatedPositionLinear(ground_truth_previous, ground_truth_next, measurement),
+                                                  ground_truth_previous.orientation.slerp(ratio, ground_truth_next.orientation));
+
     //ds for the first measurement - compute starting point offset
     if (index_slam == 0) {
       position_shift = ground_truth_interpolated.position;
@@ -203,6 +220,10 @@ int32_t main (int32_t argc_, char** argv_) {
     position_correspondences.push_back(std::make_pair(measurement, ground_truth_interpolated));
   }
   std::cerr << "\ninterpolated positions: " << position_correspondences.size() << " for: " << file_name_trajectory_ground_truth << std::endl;
+  if (position_correspondences.empty()) {
+    std::cerr << "ERROR: no corresponding measurements found" << std::endl;
+    return 0;
+  }
 
   std::cerr << "\nraw RMSE: " << getAbsoluteTranslationRootMeanSquaredError(position_correspondences) << "\n" << std::endl;
 
@@ -213,51 +234,72 @@ int32_t main (int32_t argc_, char** argv_) {
   const uint32_t number_of_iterations = 100;
   const double maximum_error_kernel   = 1; //ds (m^2)
 
-  //ds ICP running variables
-  Matrix6d H(Matrix6d::Zero());
-  Vector6d b(Vector6d::Zero());
+  //ds ICP running variables (per thread)
+  std::vector<Matrix6d, Eigen::aligned_allocator<Matrix6d>> Hs(number_of_threads);
+  std::vector<Vector6d, Eigen::aligned_allocator<Vector6d>> bs(number_of_threads);
+  std::vector<uint64_t> numbers_of_inliers(number_of_threads);
+  std::vector<double> total_errors_squared(number_of_threads);
 
   //ds perform least squares optimization
   std::cerr << "optimizing transform .." << std::endl;
   for (uint32_t iteration = 0; iteration < number_of_iterations; ++iteration) {
 
-    //ds initialize setup
-    H.setZero();
-    b.setZero();
-    uint32_t number_of_inliers = 0;
-    double total_error_squared = 0;
-
-    //ds for all SLAM trajectory poses
-    for (const std::pair<PositionMeasurement, PositionMeasurement>& position_correspondence: position_correspondences) {
-
-      //ds compute current error
-      const Eigen::Vector3d& measured_point_in_reference = position_correspondence.second.position;
-      const Eigen::Vector3d sampled_point_in_reference   = transform_slam_to_ground_truth*position_correspondence.first.position;
-      const Eigen::Vector3d error                        = sampled_point_in_reference-measured_point_in_reference;
-
-      //ds update chi
-      const double error_squared = error.transpose()*error;
-
-      //ds check if outlier
-      double weight = 1.0;
-      if (error_squared > maximum_error_kernel) {
-        weight = maximum_error_kernel/error_squared;
-      } else {
-        ++number_of_inliers;
+    //ds for all SLAM trajectory poses (accumulated in blocks)
+    parallelFor(position_correspondences.size(), number_of_threads, [&](const uint32_t& index_thread_, const uint64_t& index_begin_, const uint64_t& index_end_) {
+
+      //ds initialize setup
+      Matrix6d& H = Hs[index_thread_];
+      Vector6d& b = bs[index_thread_];
+      H.setZero();
+      b.setZero();
+      uint64_t number_of_inliers = 0;
+      double total_error_squared = 0;
+      for (uint64_t index = index_begin_; index < index_end_; ++index) {
+        const std::pair<PositionMeasurement, PositionMeasurement>& position_correspondence = position_correspondences[index];
+
+        //ds compute current error
+        const Eigen::Vector3d& measured_point_in_reference = position_correspondence.second.position;
+        const Eigen::Vector3d sampled_point_in_reference   = transform_slam_to_ground_truth*position_correspondence.first.position;
+        const Eigen::Vector3d error                        = sampled_point_in_reference-measured_point_in_reference;
+
+        //ds update chi
+        const double error_squared = error.transpose()*error;
+
+        //ds check if outlier
+        double weight = 1.0;
+        if (error_squared > maximum_error_kernel) {
+          weight = maximum_error_kernel/error_squared;
+        } else {
+          ++number_of_inliers;
+        }
+        total_error_squared += error_squared;
+
+        //ds get the jacobian of the transform part = [I -2*skew(T*modelPoint)]
+        Matrix3_6d jacobian;
+        jacobian.block<3,3>(0,0).setIdentity();
+        jacobian.block<3,3>(0,3) = -2*skew(sampled_point_in_reference);
+
+        //ds precompute transposed
+        const Matrix6_3d jacobian_transposed(jacobian.transpose());
+
+        //ds accumulate
+        H += weight*jacobian_transposed*jacobian;
+        b += weight*jacobian_transposed*error;
       }
-      total_error_squared += error_squared;
-
-      //ds get the jacobian of the transform part = [I -2*skew(T*modelPoint)]
-      Matrix3_6d jacobian;
-      jacobian.block<3,3>(0,0).setIdentity();
-      jacobian.block<3,3>(0,3) = -2*skew(sampled_point_in_reference);
-
-      //ds precompute transposed
-      const Matrix6_3d jacobian_transposed(jacobian.transpose());
-
-      //ds accumulate
-      H += weight*jacobian_transposed*jacobian;
-      b += weight*jacobian_transposed*error;
+      numbers_of_inliers[index_thread_]   = number_of_inliers;
+      total_errors_squared[index_thread_] = total_error_squared;
+    });
+
+    //ds reduce the blocks (fixed order for reproducible results)
+    Matrix6d H(Matrix6d::Zero());
+    Vector6d b(Vector6d::Zero());
+    uint64_t number_of_inliers = 0;
+    double total_error_squared = 0;
+    for (uint32_t index_thread = 0; index_thread < std::min(static_cast<uint64_t>(number_of_threads), static_cast<uint64_t>(position_correspondences.size())); ++index_thread) {
+      H                   += Hs[index_thread];
+      b                   += bs[index_thread];
+      number_of_inliers   += numbers_of_inliers[index_thread];
+      total_error_squared += total_errors_squared[index_thread];
     }
 
     //ds solve the system and update the estimate
@@ -270,39 +312,146 @@ int32_t main (int32_t argc_, char** argv_) {
     transform_slam_to_ground_truth.linear() -= 0.5*rotation*rotation_squared;
 
     //ds status
-    std::printf("iteration: %03u total error (m^2): %12.3f (inliers: %4u/%4lu=%4.2f)\n",
+    std::printf("iteration: %03u total error (m^2): %12.3f (inliers: %4lu/%4lu=%4.2f)\n",
                 iteration, total_error_squared, number_of_inliers, position_correspondences.size(), static_cast<double>(number_of_inliers)/position_correspondences.size());
   }
 
+  //ds relative pose errors (invariant to the alignment, computed on the original estimates)
+  if (!segment_lengths_meters.empty()) {
+    std::vector<SegmentError> segment_errors(segment_lengths_meters.size());
+    for (uint64_t index = 0; index < segment_lengths_meters.size(); ++index) {
+      segment_errors[index].length_meters = segment_lengths_meters[index];
+    }
+    const double time_begin_rpe_seconds = getTimeSeconds();
+    getRelativePoseErrors(position_correspondences, segment_step, number_of_threads, segment_errors);
+    std::cerr << "\nrelative pose errors (duration (s): " << getTimeSeconds()-time_begin_rpe_seconds << "):" << std::endl;
+    double sum_translation_errors = 0;
+    double sum_rotation_errors    = 0;
+    uint64_t number_of_segments   = 0;
+    for (const SegmentError& segment_error: segment_errors) {
+      if (segment_error.number_of_segments > 0) {
+        std::printf("segment length (m): %8.2f segments: %8lu translation error (%%): %7.3f rotation error (deg/m): %8.5f\n",
+                    segment_error.length_meters,
+                    segment_error.number_of_segments,
+                    100*segment_error.sum_translation_errors/segment_error.number_of_segments,
+                    180/M_PI*segment_error.sum_rotation_errors/segment_error.number_of_segments);
+      } else {
+        std::printf("segment length (m): %8.2f segments: %8lu (trajectory too short)\n", segment_error.length_meters, segment_error.number_of_segments);
+      }
+      sum_translation_errors += segment_error.sum_translation_errors;
+      sum_rotation_errors    += segment_error.sum_rotation_errors;
+      number_of_segments     += segment_error.number_of_segments;
+    }
+    if (number_of_segments > 0) {
+      std::printf("average                      segments: %8lu translation error (%%): %7.3f rotation error (deg/m): %8.5f\n",
+                  number_of_segments, 100*sum_translation_errors/number_of_segments, 180/M_PI*sum_rotation_errors/number_of_segments);
+    }
+  }
+
   //ds compute optimal poses
   for (std::pair<PositionMeasurement, PositionMeasurement>& position_correspondence: position_correspondences) {
     position_correspondence.first.position = transform_slam_to_ground_truth*position_correspondence.first.position;
   }
-  std::cerr << "done" << std::endl;
+  std::cerr << "done (duration (s): " << getTimeSeconds()-time_begin_seconds << ")" << std::endl;
 
   //ds done
   std::cerr << "\noptimal RMSE: " << getAbsoluteTranslationRootMeanSquaredError(position_correspondences) << std::endl;
   return 0;
 }
 
-const double getAbsoluteTranslationRootMeanSquaredError(const std::vector<std::pair<PositionMeasurement, PositionMeasurement>> position_correspondences_) {
+const bool parseTrajectoryTUM(const std::string& file_name_, std::vector<PositionMeasurement>& measurements_) {
+  const MappedFile file(file_name_);
+  if (!file.isOpen()) {
+    std::cerr << "ERROR: unable to open: '" << file_name_ << "'" << std::endl;
+    return false;
+  }
 
-  //ds compute absolute squared errors
-  std::vector<double> squared_errors_translation_absolute(0);
-  for (const std::pair<PositionMeasurement, PositionMeasurement>& position_correspondence: position_correspondences_) {
+  //ds the file size bounds the number of lines
+  const char* cursor = file.begin();
+  const char* end    = file.end();
+  uint64_t number_of_lines = 0;
+  while (cursor < end) {
+    const char* end_of_line = static_cast<const char*>(std::memchr(cursor, '\n', end-cursor));
+    const char* next_line   = (end_of_line)? end_of_line+1: end;
+
+    //ds skip comment and empty lines
+    const char* item = cursor;
+    while (item < next_line && (*item == ' ' || *item == '\t' || *item == '\r')) {
+      ++item;
+    }
+    if (item < next_line && *item != '#' && *item != '\n') {
+
+      //ds parse the full line (timestamp tx ty tz qx qy qz qw) and check for failure
+      double values[8];
+      for (uint32_t index = 0; index < 8; ++index) {
+        skipSpaces(item, next_line);
+        if (!parseNumber(item, next_line, values[index])) {
+          std::cerr << "ERROR: unable to parse pose line: " << number_of_lines+1 << " of: '" << file_name_ << "'" << std::endl;
+          return false;
+        }
+      }
+      measurements_.push_back(PositionMeasurement(values[0],
+                                                  Eigen::Vector3d(values[1], values[2], values[3]),
+                                                  Orientation(values[7], values[4], values[5], values[6]).normalized()));
+    }
+    cursor = next_line;
+    ++number_of_lines;
+  }
+  return true;
+}
 
-    //ds compute squared errors between frames
-    squared_errors_translation_absolute.push_back((position_correspondence.first.position-position_correspondence.second.position).squaredNorm());
+const bool parseTrajectoryASL(const std::string& file_name_, std::vector<PositionMeasurement>& measurements_) {
+  const MappedFile file(file_name_);
+  if (!file.isOpen()) {
+    std::cerr << "ERROR: unable to open: '" << file_name_ << "'" << std::endl;
+    return false;
   }
+  const char* cursor = file.begin();
+  const char* end    = file.end();
+  uint64_t number_of_lines = 0;
+  while (cursor < end) {
+    const char* end_of_line = static_cast<const char*>(std::memchr(cursor, '\n', end-cursor));
+    const char* next_line   = (end_of_line)? end_of_line+1: end;
+
+    //ds skip comment and empty lines
+    if (*cursor != '#' && *cursor != '\n' && *cursor != '\r') {
+
+      //ds parse timestamp (nanoseconds), position and orientation (w x y z), further columns are ignored
+      const char* item = cursor;
+      uint64_t timestamp_nanoseconds = 0;
+      double values[7];
+      bool is_valid = parseInteger(item, next_line, timestamp_nanoseconds);
+      for (uint32_t index = 0; index < 7 && is_valid; ++index) {
+        is_valid = (item < next_line && *item == ',');
+        ++item;
+        while (is_valid && item < next_line && *item == ' ') {
+          ++item;
+        }
+        is_valid = is_valid && parseNumber(item, next_line, values[index]);
+      }
+      if (!is_valid) {
+        std::cerr << "ERROR: unable to parse ground truth line: " << number_of_lines+1 << " of: '" << file_name_ << "'" << std::endl;
+        return false;
+      }
+      measurements_.push_back(PositionMeasurement(timestamp_nanoseconds/1e9,
+                                                  Eigen::Vector3d(values[0], values[1], values[2]),
+                                                  Orientation(values[3], values[4], values[5], values[6]).normalized()));
+    }
+    cursor = next_line;
+    ++number_of_lines;
+  }
+  return true;
+}
 
-  //ds compute RMSE
+const double getAbsoluteTranslationRootMeanSquaredError(const std::vector<std::pair<PositionMeasurement, PositionMeasurement>>& position_correspondences_) {
+
+  //ds compute RMSE of the absolute squared errors
   double root_mean_squared_error_translation_absolute = 0;
-  for (const double& squared_error: squared_errors_translation_absolute) {
-    root_mean_squared_error_translation_absolute += squared_error;
+  for (const std::pair<PositionMeasurement, PositionMeasurement>& position_correspondence: position_correspondences_) {
+    root_mean_squared_error_translation_absolute += (position_correspondence.first.position-position_correspondence.second.position).squaredNorm();
   }
-  root_mean_squared_error_translation_absolute /= squared_errors_translation_absolute.size();
+  root_mean_squared_error_translation_absolute /= position_correspondences_.size();
   root_mean_squared_error_translation_absolute = std::sqrt(root_mean_squared_error_translation_absolute);
-  squared_errors_translation_absolute.clear();
 
   //ds done
   return root_mean_squared_error_translation_absolute;
@@ -315,18 +464,78 @@ const Eigen::Vector3d getInterpolatedPositionLinear(const PositionMeasurement& g
   //ds interpolate to next
   const double timestamp_difference_seconds_ground_truth = ground_truth_next_.timestamp_seconds-ground_truth_previous_.timestamp_seconds;
   const double timestamp_difference_seconds = measurement_.timestamp_seconds-ground_truth_previous_.timestamp_seconds;
-//  std::printf("interpolating timestamps: [%f, %f, %f\n", ground_truth_previous_.timestamp_seconds,
-//                                                         measurement_.timestamp_seconds,
-//                                                         ground_truth_next_.timestamp_seconds);
 
   //ds compute interpolated reference measurement
   const Eigen::Vector3d position_interpolated = ground_truth_previous_.position +
                                                 timestamp_difference_seconds/timestamp_difference_seconds_ground_truth*
                                                 (ground_truth_next_.position-ground_truth_previous_.position);
+  return position_interpolated;
+}
 
-//  std::cerr << ground_truth_previous_.position.transpose() << std::endl;
-//  std::cerr << position_interpolated.transpose() << std::endl;
-//  std::cerr << ground_truth_next_.position.transpose() << std::endl;
+void getRelativePoseErrors(const std::vector<std::pair<PositionMeasurement, PositionMeasurement>>& pose_correspondences_,
+                           const uint32_t& step_,
+                           const uint32_t& number_of_threads_,
+                           std::vector<SegmentError>& segment_errors_) {
+  const uint64_t number_of_poses = pose_correspondences_.size();
 
-  return position_interpolated;
+  //ds traveled ground truth distance up to each pose (defines the segments)
+  std::vector<double> distances_meters(number_of_poses, 0);
+  for (uint64_t index = 1; index < number_of_poses; ++index) {
+    distances_meters[index] = distances_meters[index-1]+(pose_correspondences_[index].second.position-pose_correspondences_[index-1].second.position).norm();
+  }
+
+  //ds poses in the original frames (the shift applied for the absolute error does not affect relative motions)
+  auto getPoses = [&pose_correspondences_](const uint64_t& index_, Eigen::Isometry3d& estimate_, Eigen::Isometry3d& ground_truth_) {
+    estimate_.setIdentity();
+    estimate_.linear()          = pose_correspondences_[index_].first.orientation.toRotationMatrix();
+    estimate_.translation()     = pose_correspondences_[index_].first.position;
+    ground_truth_.setIdentity();
+    ground_truth_.linear()      = pose_correspondences_[index_].second.orientation.toRotationMatrix();
+    ground_truth_.translation() = pose_correspondences_[index_].second.position;
+  };
+
+  //ds segments start at every step-th pose, the start poses are evaluated in parallel blocks for all lengths
+  const uint64_t number_of_start_poses = (number_of_poses+step_-1)/step_;
+  std::vector<std::vector<SegmentError>> segment_errors_per_thread(number_of_threads_, segment_errors_);
+  parallelFor(number_of_start_poses, number_of_threads_, [&](const uint32_t& index_thread_, const uint64_t& index_begin_, const uint64_t& index_end_) {
+    std::vector<SegmentError>& segment_errors = segment_errors_per_thread[index_thread_];
+    Eigen::Isometry3d estimate_first, ground_truth_first, estimate_last, ground_truth_last;
+    for (uint64_t index_start = index_begin_; index_start < index_end_; ++index_start) {
+      const uint64_t index_first = index_start*step_;
+      getPoses(index_first, estimate_first, ground_truth_first);
+      const Eigen::Isometry3d estimate_first_inverse     = estimate_first.inverse();
+      const Eigen::Isometry3d ground_truth_first_inverse = ground_truth_first.inverse();
+      for (SegmentError& segment_error: segment_errors) {
+
+        //ds first pose that completes the segment length
+        const std::vector<double>::const_iterator iterator_last = std::lower_bound(distances_meters.begin()+index_first,
+                                                                                   distances_meters.end(),
+                                                                                   distances_meters[index_first]+segment_error.length_meters);
+        if (iterator_last == distances_meters.end()) {
+          continue;
+        }
+        getPoses(iterator_last-distances_meters.begin(), estimate_last, ground_truth_last);
+
+        //ds error of the estimated relative motion
+        const Eigen::Isometry3d error((ground_truth_first_inverse*ground_truth_last).inverse()*(estimate_first_inverse*estimate_last));
+        segment_error.sum_translation_errors += error.translation().norm()/segment_error.length_meters;
+        segment_error.sum_rotation_errors    += Eigen::AngleAxisd(error.linear()).angle()/segment_error.length_meters;
+        ++segment_error.number_of_segments;
+      }
+    }
+  });
+
+  //ds reduce the thread results (fixed order for reproducible results)
+  for (SegmentError& segment_error: segment_errors_) {
+    segment_error.sum_translation_errors = 0;
+    segment_error.sum_rotation_errors    = 0;
+    segment_error.number_of_segments     = 0;
+  }
+  for (const std::vector<SegmentError>& segment_errors: segment_errors_per_thread) {
+    for (uint64_t index = 0; index < segment_errors.size(); ++index) {
+      segment_errors_[index].sum_translation_errors += segment_errors[index].sum_translation_errors;
+      segment_errors_[index].sum_rotation_errors    += segment_errors[index].sum_rotation_errors;
+      segment_errors_[index].number_of_segments     += segment_errors[index].number_of_segments;
+    }
+  }
 }
@@ -1,7 +1,12 @@
 #include <iostream>
-#include <fstream>
-#include <vector>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <string>
 #include <Eigen/Geometry>
+#include "types/mapped_text_file.h"
+
+using namespace proslam;
 
 int32_t main(int32_t argc_, char** argv_) {
   if (argc_ < 3) {
@@ -39,100 +44,113 @@ int32_t main(int32_t argc_, char** argv_) {
     std::cerr << "with pose keyword: '" << pose_keyword << "'" << std::endl;
   }
 
-  //ds parse g2o file by hand (avoiding to link against it)
-  std::ifstream input_stream(input_file);
-  if (!input_stream.good() || !input_stream.is_open()) {
+  //ds parse g2o file by hand (avoiding to link against it), streaming through the mapped file
+  MappedFile input(input_file);
+  if (!input.isOpen()) {
     std::cerr << "ERROR: unable to open: '" << input_file << "'" << std::endl;
     return 0;
   }
 
-  //ds parsing buffers
-  std::vector<Eigen::Isometry3d> poses(0);
-  std::string line;
+  //ds the output is written while parsing (assuming continuous, sequential indexing)
+  std::FILE* output_stream = std::fopen(output_file.c_str(), "w");
+  if (!output_stream) {
+    std::cerr << "ERROR: unable to open: '" << output_file << "'" << std::endl;
+    return 0;
+  }
 
-  //ds parse the complete input file (assuming continuous, sequential indexing)
-  while (std::getline(input_stream, line)) {
+  //ds formatting buffer, flushed in blocks
+  const size_t maximum_buffer_size_bytes = 1 << 20;
+  std::string buffer;
+  buffer.reserve(maximum_buffer_size_bytes+1024);
+
+  //ds release the processed input in blocks
+  const size_t release_interval_bytes = 64 << 20;
+  const char* cursor_released         = input.begin();
+
+  //ds parse the complete input file line by line
+  uint64_t number_of_poses = 0;
+  const char* cursor = input.begin();
+  const char* end    = input.end();
+  while (cursor < end) {
+    const char* end_of_line = static_cast<const char*>(std::memchr(cursor, '\n', end-cursor));
+    const char* next_line   = (end_of_line)? end_of_line+1: end;
+    const char* item        = cursor;
+    skipSpaces(item, next_line);
+
+    //ds possible values (translation, quaternion x y z w)
+    double values[7];
+    bool is_pose = false;
 
     //ds for g2o
     if (input_format == "g2o") {
 
-      //ds check if the current line contains pose information
-      if (line.find(pose_keyword) != std::string::npos) {
-
-        //ds get line to a string stream object
-        std::istringstream stringstream(line);
-
-        //ds possible values
-        std::string entry_name;
-        uint64_t entry_identifier = 0;
-        double translation_x = 0;
-        double translation_y = 0;
-        double translation_z = 0;
-        double quaternion_w  = 0;
-        double quaternion_x  = 0;
-        double quaternion_y  = 0;
-        double quaternion_z  = 0;
-
-        //ds parse the full line and check for failure
-        if (!(stringstream >> entry_name >> entry_identifier >> translation_x >> translation_y >> translation_z
-                                                             >> quaternion_x >> quaternion_y >> quaternion_z >> quaternion_w)) {
+      //ds check if the current line contains pose information (other records are skipped without parsing)
+      if (static_cast<size_t>(next_line-item) > pose_keyword.size() &&
+          std::memcmp(item, pose_keyword.data(), pose_keyword.size()) == 0 &&
+          (item[pose_keyword.size()] == ' ' || item[pose_keyword.size()] == '\t')) {
+        item += pose_keyword.size();
+
+        //ds parse the full line (identifier, pose) and check for failure
+        double entry_identifier = 0;
+        skipSpaces(item, next_line);
+        is_pose = parseNumber(item, next_line, entry_identifier);
+        for (uint32_t index = 0; index < 7 && is_pose; ++index) {
+          skipSpaces(item, next_line);
+          is_pose = parseNumber(item, next_line, values[index]);
+        }
+        if (!is_pose) {
           std::cerr << "ERROR: unable to parse pose lines with keyword: '" << pose_keyword << "'" << std::endl;
-          input_stream.close();
+          std::fclose(output_stream);
           return 0;
         }
-
-        //ds set pose value
-        Eigen::Isometry3d parsed_pose(Eigen::Isometry3d::Identity());
-        parsed_pose.translation() = Eigen::Vector3d(translation_x, translation_y, translation_z);
-        parsed_pose.linear()      = Eigen::Quaterniond(quaternion_w, quaternion_x, quaternion_y, quaternion_z).toRotationMatrix();
-        poses.push_back(parsed_pose);
       }
-    } else if (input_format == "tum") {
-
-      //ds get line to a string stream object
-      std::istringstream stringstream(line);
+    } else if (input_format == "tum" && item < next_line && *item != '#' && *item != '\n' && *item != '\r') {
 
-      //ds possible values
+      //ds parse the full line (timestamp, pose) and check for failure
       double time_stamp = 0;
-      double translation_x = 0;
-      double translation_y = 0;
-      double translation_z = 0;
-      double quaternion_w  = 0;
-      double quaternion_x  = 0;
-      double quaternion_y  = 0;
-      double quaternion_z  = 0;
-
-      //ds parse the full line and check for failure
-      if (!(stringstream >> time_stamp >> translation_x >> translation_y >> translation_z
-                                       >> quaternion_x >> quaternion_y >> quaternion_z >> quaternion_w)) {
+      is_pose = parseNumber(item, next_line, time_stamp);
+      for (uint32_t index = 0; index < 7 && is_pose; ++index) {
+        skipSpaces(item, next_line);
+        is_pose = parseNumber(item, next_line, values[index]);
+      }
+      if (!is_pose) {
         std::cerr << "ERROR: unable to parse pose lines" << std::endl;
-        input_stream.close();
+        std::fclose(output_stream);
         return 0;
       }
-
-      //ds set pose value
-      Eigen::Isometry3d parsed_pose(Eigen::Isometry3d::Identity());
-      parsed_pose.translation() = Eigen::Vector3d(translation_x, translation_y, translation_z);
-      parsed_pose.linear()      = Eigen::Quaterniond(quaternion_w, quaternion_x, quaternion_y, quaternion_z).toRotationMatrix();
-      poses.push_back(parsed_pose);
     }
-  }
-  input_stream.close();
-  std::cerr << "parsed poses: " << poses.size() << std::endl;
-
-  //ds open output file (assuming continuous, sequential indexing)
-  std::ofstream output_stream(output_file, std::ifstream::out);
-  for (const Eigen::Isometry3d& pose: poses) {
 
     //ds dump transform according to KITTI format
-    for (uint8_t u = 0; u < 3; ++u) {
-      for (uint8_t v = 0; v < 4; ++v) {
-        output_stream << pose(u,v) << " ";
+    if (is_pose) {
+      Eigen::Isometry3d parsed_pose(Eigen::Isometry3d::Identity());
+      parsed_pose.translation() = Eigen::Vector3d(values[0], values[1], values[2]);
+      parsed_pose.linear()      = Eigen::Quaterniond(values[6], values[3], values[4], values[5]).toRotationMatrix();
+      char line_output[512];
+      int32_t length = 0;
+      for (uint8_t u = 0; u < 3; ++u) {
+        for (uint8_t v = 0; v < 4; ++v) {
+          length += std::snprintf(line_output+length, sizeof(line_output)-length, "%g ", parsed_pose(u,v));
+        }
+      }
+      buffer.append(line_output, length);
+      buffer.push_back('\n');
+      ++number_of_poses;
+      if (buffer.size() >= maximum_buffer_size_bytes) {
+        std::fwrite(buffer.data(), 1, buffer.size(), output_stream);
+        buffer.clear();
       }
     }
-    output_stream << "\n";
+    cursor = next_line;
+
+    //ds keep the memory footprint bounded for large graphs
+    if (static_cast<size_t>(cursor-cursor_released) >= release_interval_bytes) {
+      input.release(cursor);
+      cursor_released = cursor;
+    }
   }
-  output_stream.close();
+  std::fwrite(buffer.data(), 1, buffer.size(), output_stream);
+  std::fclose(output_stream);
+  std::cerr << "parsed poses: " << number_of_poses << std::endl;
   std::cerr << "to trajectory of format '" << output_format << "' to: '" << output_file << "'" << std::endl;
   return 0;
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "types/definitions.h"
+#include "types/worker_pool.h"
 
 namespace proslam {
 
@@ -35,7 +36,7 @@ public:
 public:
 
   inline const std::vector<real>& errors() const {return _errors;}
-  inline const std::vector<bool>& inliers() const {return _inliers;}
+  inline const std::vector<uint8_t>& inliers() const {return _inliers;}
   inline const uint64_t numberOfInliers() const {return _number_of_inliers;}
   inline const uint64_t numberOfOutliers() const {return _number_of_outliers;}
   inline const uint64_t numberOfCorrespondences() const {return _number_of_inliers+_number_of_outliers;}
@@ -43,12 +44,15 @@ public:
   inline const bool hasSystemConverged() const {return _has_system_converged;}
   inline AlignerParameters* parameters() {return _parameters;}
 
+  //! @brief worker pool distributing the linearization (serial linearization without a pool)
+  void setWorkerPool(WorkerPool* worker_pool_) {_worker_pool = worker_pool_;}
+
 //ds aligner specific
 protected:
 
-  //ds control
+  //ds control (inlier flags are stored as bytes to allow concurrent writes during parallel linearization)
   std::vector<real> _errors;
-  std::vector<bool> _inliers;
+  std::vector<uint8_t> _inliers;
   uint64_t _number_of_inliers  = 0;
   uint64_t _number_of_outliers = 0;
 
@@ -59,6 +63,9 @@ protected:
   //! @brief configurable parameters
   AlignerParameters* _parameters = 0;
 
+  //! @brief worker pool of the assembly (not owned)
+  WorkerPool* _worker_pool = nullptr;
+
 };
 
 //ds class that holds all generic (running) variables used in an aligner - to be used in conjunction with an aligner
@@ -81,14 +88,123 @@ public:
   typedef Eigen::Matrix<real, states_, 1> StateVector;
   typedef Eigen::Matrix<real, dimension_, dimension_> DimensionMatrix;
   typedef Eigen::Matrix<real, dimension_, states_> JacobianMatrix;
+  typedef Eigen::Matrix<real, dimension_, 1> DimensionVector;
+
+  //! @brief measurement storage in struct-of-arrays layout (one column per measurement)
+  typedef Eigen::Matrix<real, 3, Eigen::Dynamic> MovingMatrix;
+  typedef Eigen::Matrix<real, dimension_, Eigen::Dynamic> FixedMatrix;
+
+  //! @brief partial linear system and statistics of a range of measurements (one per linearization thread)
+  struct Accumulator {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    void clear() {H.setZero(); b.setZero(); number_of_inliers = 0; number_of_outliers = 0; total_error = 0;}
+    StateMatrix H;
+    StateVector b;
+    Count number_of_inliers;
+    Count number_of_outliers;
+    real total_error;
+  };
+
+//ds helpers
+protected:
+
+  //! @brief ensures capacity for a number of measurements in the measurement buffers (buffers grow geometrically and are never shrunk)
+  //! @param[in] number_of_measurements_ number of measurements of the upcoming alignment
+  void _reserveMeasurements(const Count& number_of_measurements_) {
+    if (number_of_measurements_ > static_cast<Count>(_moving.cols())) {
+      const Count capacity = std::max(number_of_measurements_, static_cast<Count>(1.5*_moving.cols()));
+      _moving.resize(3, capacity);
+      _fixed.resize(dimension_, capacity);
+      _information_weights.resize(capacity);
+      _weights_translation.resize(capacity);
+    }
+  }
+
+  //! @brief fused accumulation of a measurement with isotropic information matrix (omega = information_*I) into H and b
+  //! @param[in,out] accumulator_ target system
+  //! @param[in] jacobian_ measurement jacobian
+  //! @param[in] error_ measurement error
+  //! @param[in] information_ scalar information (including robust kernel weighting)
+  static inline void _accumulate(Accumulator& accumulator_, const JacobianMatrix& jacobian_, const DimensionVector& error_, const real& information_) {
+    const Eigen::Matrix<real, states_, dimension_> jacobian_transposed_weighted(information_*jacobian_.transpose());
+    accumulator_.H.noalias() += jacobian_transposed_weighted*jacobian_;
+    accumulator_.b.noalias() += jacobian_transposed_weighted*error_;
+  }
+
+  //! @brief fused accumulation of a measurement with diagonal information matrix (omega = information_.asDiagonal()) into H and b
+  //! @param[in,out] accumulator_ target system
+  //! @param[in] jacobian_ measurement jacobian
+  //! @param[in] error_ measurement error
+  //! @param[in] information_ diagonal of the information matrix (including robust kernel weighting)
+  static inline void _accumulate(Accumulator& accumulator_, const JacobianMatrix& jacobian_, const DimensionVector& error_, const DimensionVector& information_) {
+    const Eigen::Matrix<real, states_, dimension_> jacobian_transposed_weighted(jacobian_.transpose()*information_.asDiagonal());
+    accumulator_.H.noalias() += jacobian_transposed_weighted*jacobian_;
+    accumulator_.b.noalias() += jacobian_transposed_weighted*error_;
+  }
+
+  //! @brief linearizes all measurements into _H and _b, optionally distributed over multiple threads
+  //! each thread accumulates a contiguous range of measurements, ranges are merged in order for a reproducible result
+  //! @param[in] number_of_measurements_ total number of measurements
+  //! @param[in] parameters_ aligner parameters (thread configuration)
+  //! @param[in] worker_pool_ pool the ranges are distributed over (serial without a pool)
+  //! @param[in] linearize_range_ callable linearizing the measurements [index_begin, index_end) into the provided accumulator
+  //! @return merged statistics of all measurements
+  template<typename LinearizeRange_>
+  const Accumulator& _linearizeMeasurements(const Count& number_of_measurements_,
+                                            const AlignerParameters* parameters_,
+                                            WorkerPool* worker_pool_,
+                                            const LinearizeRange_& linearize_range_) {
+
+    //ds determine number of threads - small problems are not worth the thread overhead
+    const Count number_of_threads = std::max(static_cast<Count>(1),
+                                             std::min(parameters_->number_of_linearization_threads,
+                                                      number_of_measurements_/std::max(static_cast<Count>(1), parameters_->minimum_number_of_measurements_per_thread)));
+    _accumulators.resize(number_of_threads);
+    for (Accumulator& accumulator: _accumulators) {
+      accumulator.clear();
+    }
+
+    if (number_of_threads == 1) {
+      linearize_range_(0, number_of_measurements_, _accumulators[0]);
+    } else {
+
+      //ds contiguous ranges, the last range takes the remaining measurements
+      const Count number_of_measurements_per_thread = number_of_measurements_/number_of_threads;
+      runTasks(worker_pool_, number_of_threads, [&](const Index& index_thread_) {
+        const Count index_begin = index_thread_*number_of_measurements_per_thread;
+        const Count index_end   = (index_thread_ == number_of_threads-1)? number_of_measurements_: index_begin+number_of_measurements_per_thread;
+        linearize_range_(index_begin, index_end, _accumulators[index_thread_]);
+      });
+
+      //ds merge partial systems in range order
+      for (Count index_thread = 1; index_thread < number_of_threads; ++index_thread) {
+        const Accumulator& accumulator = _accumulators[index_thread];
+        _accumulators[0].H                  += accumulator.H;
+        _accumulators[0].b                  += accumulator.b;
+        _accumulators[0].number_of_inliers  += accumulator.number_of_inliers;
+        _accumulators[0].number_of_outliers += accumulator.number_of_outliers;
+        _accumulators[0].total_error        += accumulator.total_error;
+      }
+    }
+    _H = _accumulators[0].H;
+    _b = _accumulators[0].b;
+    return _accumulators[0];
+  }
 
 //ds workspace variables
 protected:
 
   StateMatrix _H                  = StateMatrix::Zero();
   StateVector _b                  = StateVector::Zero();
-  DimensionMatrix _omega          = DimensionMatrix::Identity();
-  JacobianMatrix _jacobian        = JacobianMatrix::Zero();
   StateMatrix _information_matrix = StateMatrix::Identity();
+
+  //! @brief measurement buffers (capacity is kept across alignments, only the first _number_of_measurements columns are valid)
+  MovingMatrix _moving;
+  FixedMatrix _fixed;
+  std::vector<real> _information_weights;
+  std::vector<real> _weights_translation;
+
+  //! @brief linearization accumulators (one per thread)
+  std::vector<Accumulator, Eigen::aligned_allocator<Accumulator> > _accumulators;
 };
 }
@@ -1,4 +1,6 @@
 #include "stereouv_aligner.h"
+
+#include <algorithm>
 #include "types/landmark.h"
 
 namespace proslam {
@@ -20,49 +22,53 @@ namespace proslam {
     _number_of_measurements = _frame_current->points().size();
     _errors.resize(_number_of_measurements);
     _inliers.resize(_number_of_measurements);
-    _information_vector.resize(_number_of_measurements);
-    _weights_translation.resize(_number_of_measurements, 1);
-    _moving.resize(_number_of_measurements);
-    _fixed.resize(_number_of_measurements);
+    _reserveMeasurements(_number_of_measurements);
+    _active_measurements.resize(_number_of_measurements);
+    _number_of_rejected_measurements = 0;
 
     //ds fill buffers
     for (Index u = 0; u < _number_of_measurements; ++u) {
       const FramePoint* frame_point = _frame_current->points()[u];
-      _information_vector[u].setIdentity();
+      _information_weights[u] = 1;
+      _active_measurements[u] = u;
+      _errors[u]              = -1;
+      _inliers[u]             = false;
 
       assert(_frame_current->cameraLeft()->isInFieldOfView(frame_point->imageCoordinatesLeft()));
       assert(_frame_current->cameraRight()->isInFieldOfView(frame_point->imageCoordinatesRight()));
       assert(frame_point->previous());
 
       //ds set fixed part (image coordinates)
-      _fixed[u](0) = frame_point->imageCoordinatesLeft().x();
-      _fixed[u](1) = frame_point->imageCoordinatesLeft().y();
-      _fixed[u](2) = frame_point->imageCoordinatesRight().x();
-      _fixed[u](3) = frame_point->imageCoordinatesRight().y();
+      _fixed(0,u) = frame_point->imageCoordinatesLeft().x();
+      _fixed(1,u) = frame_point->imageCoordinatesLeft().y();
+      _fixed(2,u) = frame_point->imageCoordinatesRight().x();
+      _fixed(3,u) = frame_point->imageCoordinatesRight().y();
 
       //ds if we have a landmark
       if (frame_point->landmark()) {
 
         //ds prefer landmark estimate
-        _moving[u] = frame_point->previous()->cameraCoordinatesLeftLandmark();
+        _moving.col(u) = frame_point->previous()->cameraCoordinatesLeftLandmark();
 
         //ds increase weight linear in the number of updates
-        _information_vector[u] *= (1+frame_point->landmark()->numberOfUpdates());
+        _information_weights[u] *= (1+frame_point->landmark()->numberOfUpdates());
       } else {
 
         //ds set moving part (3D point coordinates)
-        _moving[u] = frame_point->previous()->cameraCoordinatesLeft();
+        _moving.col(u) = frame_point->previous()->cameraCoordinatesLeft();
       }
 
       //ds scale information proportional to disparity of the measurement (the bigger, the closer, the better the triangulation)
-      _information_vector[u] *= std::log(1+frame_point->disparityPixels())/(1+std::fabs(frame_point->epipolarOffset()));
+      _information_weights[u] *= std::log(1+frame_point->disparityPixels())/(1+std::fabs(frame_point->epipolarOffset()));
     }
 
     //ds if individual weighting is desired
     if (_enable_weights_translation) {
       for (Index u = 0; u < _number_of_measurements; ++u) {
-        _weights_translation[u] = _maximum_reliable_depth_meters/_moving[u].z();
+        _weights_translation[u] = _maximum_reliable_depth_meters/_moving(2,u);
       }
+    } else {
+      std::fill(_weights_translation.begin(), _weights_translation.begin()+_number_of_measurements, 1);
     }
 
     //ds wrappers for optimization
@@ -75,29 +81,37 @@ namespace proslam {
   //ds linearize the system: to be called inside oneRound
   void StereoUVAligner::linearize(const bool& ignore_outliers_) {
 
-    //ds initialize setup
-    _H.setZero();
-    _b.setZero();
-    _number_of_inliers = 0;
-    _total_error       = 0;
+    //ds linearize all measurements (optionally in parallel) and update the statistics
+    const Accumulator& result = _linearizeMeasurements(_active_measurements.size(), _parameters, _worker_pool,
+                                                       [this, &ignore_outliers_](const Count& index_begin_, const Count& index_end_, Accumulator& accumulator_) {
+      _linearizeRange(index_begin_, index_end_, ignore_outliers_, accumulator_);
+    });
+    _number_of_inliers  = result.number_of_inliers;
+    _number_of_outliers = _active_measurements.size()-_number_of_inliers+_number_of_rejected_measurements;
+    _total_error        = result.total_error;
+  }
+
+  //ds linearize a range of measurements into a (thread local) accumulator
+  void StereoUVAligner::_linearizeRange(const Count& index_begin_,
+                                        const Count& index_end_,
+                                        const bool& ignore_outliers_,
+                                        Accumulator& accumulator_) {
+    JacobianMatrix jacobian;
 
-    //ds loop over all current framepoints (assuming that each of them has a previous one)
-    for (Index u = 0; u < _number_of_measurements; ++u) {
+    //ds loop over all active framepoints in the range (assuming that each of them has a previous one)
+    for (Index index = index_begin_; index < index_end_; ++index) {
+      const Index& u = _active_measurements[index];
       _errors[u]  = -1;
       _inliers[u] = false;
-      _omega      = _information_vector[u];
+      real information = _information_weights[u];
 
       //ds compute the point in the camera frame - prefering a landmark estimate if available
-      const PointCoordinates sampled_point_in_camera_left = _previous_to_current*_moving[u];
+      const PointCoordinates sampled_point_in_camera_left = _previous_to_current*_moving.col(u);
       if (sampled_point_in_camera_left.z() <= _minimum_depth) {
         continue;
       }
 
       //ds retrieve homogeneous projections
-      const Vector4 sampled_point_in_camera_left_homogeneous(sampled_point_in_camera_left.x(),
-                                                             sampled_point_in_camera_left.y(),
-                                                             sampled_point_in_camera_left.z(),
-                                                             1);
       const PointCoordinates sampled_abc_in_camera_left  = _camera_calibration_matrix*sampled_point_in_camera_left;
       const PointCoordinates sampled_abc_in_camera_right = sampled_abc_in_camera_left+_offset_camera_right;
       const real& sampled_c_left  = sampled_abc_in_camera_left.z();
@@ -120,10 +134,10 @@ namespace proslam {
       assert(_frame_current->cameraRight()->isInFieldOfView(sampled_point_in_image_right));
 
       //ds compute error (we compute the vertical error only once, since we assume rectified cameras)
-      const Vector4 error(sampled_point_in_image_left.x()-_fixed[u](0),
-                          sampled_point_in_image_left.y()-_fixed[u](1),
-                          sampled_point_in_image_right.x()-_fixed[u](2),
-                          sampled_point_in_image_right.y()-_fixed[u](3));
+      const Vector4 error(sampled_point_in_image_left.x()-_fixed(0,u),
+                          sampled_point_in_image_left.y()-_fixed(1,u),
+                          sampled_point_in_image_right.x()-_fixed(2,u),
+                          sampled_point_in_image_right.y()-_fixed(3,u));
 
       //ds weight all measurements proportional to their distance to the sensor (squared to damp the effect)
       //const real weight_translation = 1/std::sqrt(depth_meters);
@@ -131,8 +145,8 @@ namespace proslam {
       //const real weight_translation = exp(-depth_meters/_maximum_reliable_depth_meters);
       //const real weight_translation = 1; //std::sqrt(frame_point->disparityPixels());
 
-      //ds compute squared error
-      const real chi = error.transpose()*_omega*error;
+      //ds compute squared error (isotropic information)
+      const real chi = information*error.squaredNorm();
 
       //ds update error stats
       _errors[u] = chi;
@@ -144,19 +158,19 @@ namespace proslam {
         }
 
         //ds proportionally reduce information value of the measurement
-        _omega *= _parameters->maximum_error_kernel/chi;
+        information *= _parameters->maximum_error_kernel/chi;
       } else {
         _inliers[u] = true;
-        ++_number_of_inliers;
+        ++accumulator_.number_of_inliers;
       }
 
       //ds update total error
-      _total_error += _errors[u];
+      accumulator_.total_error += _errors[u];
 
       //ds compute the jacobian of the transformation
       Matrix3_6 jacobian_transform;
 
-      //ds translation contribution (will be scaled with omega)
+      //ds translation contribution (will be scaled with the information)
 //      const real translation_weight = _maximum_reliable_depth_meters/sampled_point_in_camera_left.z();
       jacobian_transform.block<3,3>(0,0) = _weights_translation[u]*Matrix3::Identity();
 
@@ -185,25 +199,16 @@ namespace proslam {
       //ds the last rows of jacobian_left and jacobian_right are identical for perfect, horizontally triangulated points
       //ds in a horizontal stereo camera configuration
 
-      //ds assemble final jacobian
-      _jacobian.setZero();
-
+      //ds assemble final jacobian (both blocks cover all rows)
       //ds we have to compute the full block
-      _jacobian.block<2,6>(0,0) = jacobian_left*camera_matrix_per_jacobian_transform;
+      jacobian.block<2,6>(0,0) = jacobian_left*camera_matrix_per_jacobian_transform;
 
       //ds we only have to compute the horizontal block
-      _jacobian.block<2,6>(2,0) = jacobian_right*camera_matrix_per_jacobian_transform;
-
-      //ds precompute transposed
-      const Matrix6_4 jacobian_transposed(_jacobian.transpose());
+      jacobian.block<2,6>(2,0) = jacobian_right*camera_matrix_per_jacobian_transform;
 
-      //ds update H and b
-      _H += jacobian_transposed*_omega*_jacobian;
-      _b += jacobian_transposed*_omega*error;
+      //ds update H and b (fused, fixed-size kernel)
+      _accumulate(accumulator_, jacobian, error, information);
     }
-
-    //ds update statistics
-    _number_of_outliers = _number_of_measurements-_number_of_inliers;
   }
 
   //ds solve alignment problem for one round
@@ -213,7 +218,7 @@ namespace proslam {
     linearize(ignore_outliers_);
 
     //ds damping
-    _H += _parameters->damping*_number_of_measurements*Matrix6::Identity();
+    _H += _parameters->damping*_active_measurements.size()*Matrix6::Identity();
 
     //ds compute solution transformation after perturbation
     const Vector6 dx     = _H.fullPivLu().solve(-_b);
@@ -228,6 +233,27 @@ namespace proslam {
 
   //ds solve alignment problem until convergence is reached
   void StereoUVAligner::converge() {
+    _has_system_converged = false;
+
+    //ds estimate a coarse pose on a subset first if desired and worth it (rejects gross outliers for the full optimization)
+    if (_parameters->enable_coarse_to_fine_estimation && _number_of_measurements > 2*_parameters->coarse_number_of_measurements) {
+      _estimateCoarse();
+    }
+
+    //ds optimize on all (remaining) measurements
+    _optimize();
+
+    //ds VISUALIZATION ONLY
+    for (Index u = 0; u < _number_of_measurements; ++u) {
+      FramePoint* frame_point = _frame_current->points()[u];
+      ImageCoordinates image_coordinates(_camera_calibration_matrix*_previous_to_current*_moving.col(u));
+      image_coordinates /= image_coordinates.z();
+      frame_point->setProjectionEstimateLeftOptimized(cv::Point2f(image_coordinates.x(), image_coordinates.y()));
+    }
+  }
+
+  //ds solve for the pose on the active measurements until convergence
+  void StereoUVAligner::_optimize() {
 
     //ds previous error to check for convergence
     real total_error_previous = 0;
@@ -268,18 +294,124 @@ namespace proslam {
       //ds check last iteration
       if(iteration == _parameters->maximum_number_of_iterations-1) {
         _has_system_converged = false;
-        LOG_WARNING(std::cerr << "StereoUVAligner::converge|system did not converge - total error: "  << _total_error
+        LOG_WARNING(std::cerr << "StereoUVAligner::_optimize|system did not converge - total error: "  << _total_error
                   << " average error: " << _total_error/(_number_of_inliers+_number_of_outliers)
                   << " inliers: " << _number_of_inliers << " outliers: " << _number_of_outliers << std::endl)
       }
     }
+  }
 
-    //ds VISUALIZATION ONLY
+  //ds coarse pose estimate on a distributed subset with minimal set hypotheses
+  void StereoUVAligner::_estimateCoarse() {
+    const TransformMatrix3D previous_to_current_prior(_previous_to_current);
+
+    //ds select a spatially well-distributed subset of measurements
+    _selectDistributedMeasurements(_parameters->coarse_number_of_measurements, _coarse_measurements);
+    //ds skip coarse estimation if the subset is too small for a meaningful hypothesis scoring
+    if (_coarse_measurements.size() < 10) {
+      return;
+    }
+
+    //ds evaluate the prior (motion model) as first hypothesis
+    _active_measurements = _coarse_measurements;
+    linearize(true);
+    TransformMatrix3D previous_to_current_best(_previous_to_current);
+    Count number_of_inliers_best = _number_of_inliers;
+
+    //ds generate hypotheses from minimal sets of 3 stereo correspondences (constraining all 6 degrees of freedom)
+    std::uniform_int_distribution<Index> distribution(0, _coarse_measurements.size()-1);
+    for (Count index_hypothesis = 0; index_hypothesis < _parameters->coarse_number_of_hypotheses; ++index_hypothesis) {
+
+      //ds sample distinct measurements of the subset
+      _minimal_set.clear();
+      while (_minimal_set.size() < 3) {
+        const Index measurement = _coarse_measurements[distribution(_random_number_generator)];
+        if (std::find(_minimal_set.begin(), _minimal_set.end(), measurement) == _minimal_set.end()) {
+          _minimal_set.push_back(measurement);
+        }
+      }
+
+      //ds solve the minimal problem starting from the prior (few iterations are sufficient)
+      _previous_to_current = previous_to_current_prior;
+      _active_measurements = _minimal_set;
+      for (Count iteration = 0; iteration < 10; ++iteration) {
+        oneRound(false);
+      }
+
+      //ds score the hypothesis on the subset
+      _active_measurements = _coarse_measurements;
+      linearize(true);
+      if (_number_of_inliers > number_of_inliers_best) {
+        number_of_inliers_best   = _number_of_inliers;
+        previous_to_current_best = _previous_to_current;
+      }
+    }
+
+    //ds refine the best hypothesis on the whole subset
+    _previous_to_current = previous_to_current_best;
+    _active_measurements = _coarse_measurements;
+    _optimize();
+
+    //ds evaluate all measurements at the coarse pose and deactivate gross outliers (they remain marked as invalid)
+    _active_measurements.resize(_number_of_measurements);
     for (Index u = 0; u < _number_of_measurements; ++u) {
-      FramePoint* frame_point = _frame_current->points()[u];
-      ImageCoordinates image_coordinates(_camera_calibration_matrix*_previous_to_current*_moving[u]);
-      image_coordinates /= image_coordinates.z();
-      frame_point->setProjectionEstimateLeftOptimized(cv::Point2f(image_coordinates.x(), image_coordinates.y()));
+      _active_measurements[u] = u;
+    }
+    linearize(false);
+    const real maximum_error = _parameters->coarse_outlier_rejection_factor*_parameters->maximum_error_kernel;
+    Count number_of_active_measurements = 0;
+    for (Index u = 0; u < _number_of_measurements; ++u) {
+      if (_errors[u] != -1 && _errors[u] < maximum_error) {
+        _active_measurements[number_of_active_measurements] = u;
+        ++number_of_active_measurements;
+      } else {
+        _errors[u]  = -1;
+        _inliers[u] = false;
+      }
+    }
+    _active_measurements.resize(number_of_active_measurements);
+    _number_of_rejected_measurements = _number_of_measurements-number_of_active_measurements;
+
+    //ds fall back to all measurements if the coarse estimate is not supported (errors are recomputed in the full optimization)
+    if (number_of_active_measurements < std::max(_parameters->minimum_number_of_inliers, static_cast<Count>(10))) {
+      LOG_WARNING(std::cerr << "StereoUVAligner::_estimateCoarse|coarse estimate rejected, remaining measurements: "
+                            << number_of_active_measurements << "/" << _number_of_measurements << std::endl)
+      _previous_to_current = previous_to_current_prior;
+      _number_of_rejected_measurements = 0;
+      _active_measurements.resize(_number_of_measurements);
+      for (Index u = 0; u < _number_of_measurements; ++u) {
+        _active_measurements[u] = u;
+      }
+    }
+  }
+
+  //ds selects the most informative measurement per cell of a regular image grid
+  void StereoUVAligner::_selectDistributedMeasurements(const Count& number_of_cells_, std::vector<Index>& measurements_) const {
+
+    //ds compute grid dimensions with approximately square cells
+    const Count number_of_rows_grid = std::max(static_cast<Count>(std::round(std::sqrt(static_cast<real>(number_of_cells_)*_number_of_rows_image/_number_of_cols_image))),
+                                               static_cast<Count>(1));
+    const Count number_of_cols_grid = std::max(number_of_cells_/number_of_rows_grid, static_cast<Count>(1));
+    const real cell_height_pixels   = static_cast<real>(_number_of_rows_image)/number_of_rows_grid;
+    const real cell_width_pixels    = static_cast<real>(_number_of_cols_image)/number_of_cols_grid;
+
+    //ds keep the measurement with the highest information in each cell
+    std::vector<int64_t> measurement_per_cell(number_of_rows_grid*number_of_cols_grid, -1);
+    for (Index u = 0; u < _number_of_measurements; ++u) {
+      const Count row = std::min(static_cast<Count>(_fixed(1,u)/cell_height_pixels), number_of_rows_grid-1);
+      const Count col = std::min(static_cast<Count>(_fixed(0,u)/cell_width_pixels), number_of_cols_grid-1);
+      int64_t& measurement = measurement_per_cell[row*number_of_cols_grid+col];
+      if (measurement == -1 || _information_weights[u] > _information_weights[measurement]) {
+        measurement = u;
+      }
+    }
+
+    //ds collect selected measurements
+    measurements_.clear();
+    for (const int64_t& measurement: measurement_per_cell) {
+      if (measurement != -1) {
+        measurements_.push_back(measurement);
+      }
     }
   }
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include <random>
 #include "base_frame_aligner.h"
 
 namespace proslam {
@@ -29,6 +30,27 @@ public:
   //ds set maximum reliable depth for registration
   void setMaximumReliableDepthMeters(const double& maximum_reliable_depth_meters_) {_maximum_reliable_depth_meters = maximum_reliable_depth_meters_;}
 
+//ds helpers
+protected:
+
+  //! @brief linearizes the measurements [index_begin_, index_end_) into the provided accumulator (thread safe for disjoint ranges)
+  void _linearizeRange(const Count& index_begin_,
+                       const Count& index_end_,
+                       const bool& ignore_outliers_,
+                       Accumulator& accumulator_);
+
+  //! @brief solves for the pose on the active measurements until convergence (standard and inlier only runs)
+  void _optimize();
+
+  //! @brief estimates a coarse pose on a spatially distributed subset of measurements (minimal set hypotheses and refinement)
+  //! and deactivates all measurements that are gross outliers with respect to the coarse pose
+  void _estimateCoarse();
+
+  //! @brief selects the most informative measurement in each cell of a regular image grid
+  //! @param[in] number_of_cells_ approximate number of grid cells (= maximum number of selected measurements)
+  //! @param[out] measurements_ selected measurement indices
+  void _selectDistributedMeasurements(const Count& number_of_cells_, std::vector<Index>& measurements_) const;
+
 //ds aligner specific
 protected:
 
@@ -41,9 +63,16 @@ protected:
   real _maximum_reliable_depth_meters = 15;
 
   Count _number_of_measurements = 0;
-  std::vector<DimensionMatrix, Eigen::aligned_allocator<DimensionMatrix> > _information_vector;
-  std::vector<Vector3, Eigen::aligned_allocator<Vector3> > _moving;
-  std::vector<Vector4, Eigen::aligned_allocator<Vector4> > _fixed;
-  std::vector<real> _weights_translation;
+
+  //! @brief measurements considered in the current optimization (all measurements unless coarse to fine estimation is active)
+  std::vector<Index> _active_measurements;
+
+  //! @brief measurements deactivated as gross outliers by the coarse estimate (counted as outliers of the full optimization)
+  Count _number_of_rejected_measurements = 0;
+
+  //! @brief coarse to fine estimation buffers
+  std::vector<Index> _coarse_measurements;
+  std::vector<Index> _minimal_set;
+  std::mt19937 _random_number_generator;
 };
 }
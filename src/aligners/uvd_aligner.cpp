@@ -34,19 +34,29 @@ namespace proslam {
   //ds linearize the system: to be called inside oneRound
   void UVDAligner::linearize(const bool& ignore_outliers_) {
 
-    //ds initialize setup
-    _H.setZero();
-    _b.setZero();
-    _number_of_inliers  = 0;
-    _number_of_outliers = 0;
-    _total_error        = 0;
-
-    //ds loop over all points (assumed to have previous points)
-    for (Index index_point = 0; index_point < _frame_current->points().size(); index_point++) {
+    //ds linearize all measurements (optionally in parallel) and update the statistics
+    const Accumulator& result = _linearizeMeasurements(_frame_current->points().size(), _parameters, _worker_pool,
+                                                       [this, &ignore_outliers_](const Count& index_begin_, const Count& index_end_, Accumulator& accumulator_) {
+      _linearizeRange(index_begin_, index_end_, ignore_outliers_, accumulator_);
+    });
+    _number_of_inliers  = result.number_of_inliers;
+    _number_of_outliers = result.number_of_outliers;
+    _total_error        = result.total_error;
+  }
+
+  //ds linearize a range of measurements into a (thread local) accumulator
+  void UVDAligner::_linearizeRange(const Count& index_begin_,
+                                   const Count& index_end_,
+                                   const bool& ignore_outliers_,
+                                   Accumulator& accumulator_) {
+    DimensionVector information;
+    JacobianMatrix jacobian;
+
+    //ds loop over all points in the range (assumed to have previous points)
+    for (Index index_point = index_begin_; index_point < index_end_; index_point++) {
       _errors[index_point]  = -1;
       _inliers[index_point] = false;
-      _omega.setIdentity();
-      _omega(2,2)*=10;
+      information << 1, 1, 10;
       
       //ds buffer framepoint
       FramePoint* frame_point = _frame_current->points()[index_point];
@@ -60,7 +70,7 @@ namespace proslam {
       PointCoordinates predicted_point_in_camera = PointCoordinates::Zero();
       if (landmark) {
 //        predicted_point_in_camera = _world_to_camera*landmark->coordinates();
-        _omega *= 1.5;
+        information *= 1.5;
       } else {
 //        predicted_point_in_camera = _world_to_camera*frame_point->previous()->worldCoordinates();
       }
@@ -102,20 +112,20 @@ namespace proslam {
 
       //ds if outlier
       if (chi > _parameters->maximum_error_kernel) {
-        ++_number_of_outliers;
+        ++accumulator_.number_of_outliers;
         if (ignore_outliers_) {
           continue;
         }
 
-        //ds include kernel in omega
-        _omega *= _parameters->maximum_error_kernel/chi;
+        //ds include kernel in information
+        information *= _parameters->maximum_error_kernel/chi;
       } else {
         _inliers[index_point] = true;
-        ++_number_of_inliers;
+        ++accumulator_.number_of_inliers;
       }
 
       //ds update total error
-      _total_error += _errors[index_point];
+      accumulator_.total_error += _errors[index_point];
 
       //ds compute the jacobian of the transformation
       Matrix3_6 jacobian_transform;
@@ -137,20 +147,16 @@ namespace proslam {
       0, 0, 1;
 
       //ds assemble final jacobian
-      _jacobian = jacobian_projection*_camera_matrix*jacobian_transform;
-
-      //ds precompute transposed
-      const Matrix6_3 jacobian_transposed(_jacobian.transpose());
+      jacobian = jacobian_projection*_camera_matrix*jacobian_transform;
 
       if (depth_meters < _maximum_depth_near_meters) {
-        _omega *= (_maximum_depth_near_meters-depth_meters)/_maximum_depth_near_meters;
+        information *= (_maximum_depth_near_meters-depth_meters)/_maximum_depth_near_meters;
       } else {
-        _omega *= (_maximum_depth_far_meters-depth_meters)/_maximum_depth_far_meters;
+        information *= (_maximum_depth_far_meters-depth_meters)/_maximum_depth_far_meters;
       }
 
-      //ds update H and b
-      _H += jacobian_transposed*_omega*_jacobian;
-      _b += jacobian_transposed*_omega*error;
+      //ds update H and b (fused, fixed-size kernel with diagonal information)
+      _accumulate(accumulator_, jacobian, error, information);
     }
   }
 
@@ -26,6 +26,15 @@ public:
   //ds solve alignment problem until convergence is reached
   virtual void converge();
 
+//ds helpers
+protected:
+
+  //! @brief linearizes the measurements [index_begin_, index_end_) into the provided accumulator (thread safe for disjoint ranges)
+  void _linearizeRange(const Count& index_begin_,
+                       const Count& index_end_,
+                       const bool& ignore_outliers_,
+                       Accumulator& accumulator_);
+
 //ds aligner specific
 protected:
 
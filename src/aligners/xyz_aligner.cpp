@@ -10,81 +10,87 @@ namespace proslam {
     //ds nothing to do
   }
 
+  void XYZAligner::configure() {
+
+    //ds no damping for point cloud registration - set once since the parameters are shared by all registration threads
+    _parameters->damping = 0;
+  }
+
   void XYZAligner::initialize(Closure* context_, const TransformMatrix3D& current_to_reference_) {
 
     //ds initialize base components
     _context              = context_;
     _current_to_reference = current_to_reference_;
-    _parameters->damping = 0;
     _number_of_measurements = _context->correspondences.size();
     _errors.resize(_number_of_measurements);
     _inliers.resize(_number_of_measurements);
 
-    //ds construct point cloud registration problem - compute landmark coordinates in local maps
-    _information_vector.resize(_number_of_measurements);
-    _moving.resize(_number_of_measurements);
-    _fixed.resize(_number_of_measurements);
-    const TransformMatrix3D& world_to_reference_local_map(context_->local_map_reference->worldToLocalMap());
-    const TransformMatrix3D& world_to_query_local_map(context_->local_map_query->worldToLocalMap());
+    //ds construct point cloud registration problem - landmark coordinates in the local maps
+    _reserveMeasurements(_number_of_measurements);
     for (Index u = 0; u < _number_of_measurements; ++u) {
       const Closure::Correspondence* correspondence = _context->correspondences[u];
 
-      //ds point coordinates to register
-      _fixed[u]  = world_to_reference_local_map*correspondence->reference->coordinates();
-      _moving[u] = world_to_query_local_map*correspondence->query->coordinates();
+      //ds point coordinates to register (snapshots taken with the correspondence, no access to the live landmarks)
+      _fixed.col(u)  = correspondence->coordinates_in_reference;
+      _moving.col(u) = correspondence->coordinates_in_query;
 
-      //ds set information matrix
-      _information_vector[u].setIdentity();
-      _information_vector[u] *= correspondence->matching_ratio;
+      //ds set information (isotropic)
+      _information_weights[u] = correspondence->matching_ratio;
     }
   }
 
   void XYZAligner::linearize(const bool& ignore_outliers_) {
 
-    //ds initialize setup
-    _H.setZero();
-    _b.setZero();
-    _number_of_inliers  = 0;
-    _number_of_outliers = 0;
-    _total_error        = 0;
+    //ds linearize all measurements (optionally in parallel) and update the statistics
+    const Accumulator& result = _linearizeMeasurements(_number_of_measurements, _parameters, _worker_pool,
+                                                       [this, &ignore_outliers_](const Count& index_begin_, const Count& index_end_, Accumulator& accumulator_) {
+      _linearizeRange(index_begin_, index_end_, ignore_outliers_, accumulator_);
+    });
+    _number_of_inliers  = result.number_of_inliers;
+    _number_of_outliers = result.number_of_outliers;
+    _total_error        = result.total_error;
+  }
 
-    //ds for all the points
-    for (Index u = 0; u < _number_of_measurements; ++u) {
-      _omega = _information_vector[u];
+  //ds linearize a range of measurements into a (thread local) accumulator
+  void XYZAligner::_linearizeRange(const Count& index_begin_,
+                                   const Count& index_end_,
+                                   const bool& ignore_outliers_,
+                                   Accumulator& accumulator_) {
+    JacobianMatrix jacobian;
+    jacobian.block<3,3>(0,0).setIdentity();
+
+    //ds for all the points in the range
+    for (Index u = index_begin_; u < index_end_; ++u) {
+      real information = _information_weights[u];
 
       //ds compute error based on items: local map merging
-      const PointCoordinates sampled_point_in_reference   = _current_to_reference*_moving[u];
-      const Vector3 error                                 = sampled_point_in_reference-_fixed[u];
+      const PointCoordinates sampled_point_in_reference   = _current_to_reference*_moving.col(u);
+      const Vector3 error                                 = sampled_point_in_reference-_fixed.col(u);
 
       //ds update chi
-      const real error_squared = error.transpose()*_omega*error;
+      const real error_squared = information*error.squaredNorm();
 
       //ds check if outlier
       if (error_squared > _parameters->maximum_error_kernel) {
         _inliers[u] = false;
-        ++_number_of_outliers;
+        ++accumulator_.number_of_outliers;
         if (ignore_outliers_) {
           continue;
         }
 
         //ds proportionally reduce information value of the measurement
-        _omega *= _parameters->maximum_error_kernel/error_squared;
+        information *= _parameters->maximum_error_kernel/error_squared;
       } else {
         _inliers[u] = true;
-        ++_number_of_inliers;
+        ++accumulator_.number_of_inliers;
       }
-      _total_error += error_squared;
-
-      //ds get the jacobian of the transform part = [I -2*skew(T*modelPoint)]
-      _jacobian.block<3,3>(0,0).setIdentity();
-      _jacobian.block<3,3>(0,3) = -2*srrg_core::skew(sampled_point_in_reference);
+      accumulator_.total_error += error_squared;
 
-      //ds precompute transposed
-      const Matrix6_3 jacobian_transposed(_jacobian.transpose( ));
+      //ds get the jacobian of the transform part = [I -2*skew(T*modelPoint)] (the translation block is constant)
+      jacobian.block<3,3>(0,3) = -2*srrg_core::skew(sampled_point_in_reference);
 
-      //ds accumulate
-      _H += jacobian_transposed*_omega*_jacobian;
-      _b += jacobian_transposed*_omega*error;
+      //ds accumulate (fused, fixed-size kernel)
+      _accumulate(accumulator_, jacobian, error, information);
     }
   }
 
@@ -134,7 +140,7 @@ namespace proslam {
 
         //ds if the solution is acceptable
         if (_number_of_inliers > _parameters->minimum_number_of_inliers && inlier_ratio > _parameters->minimum_inlier_ratio) {
-          LOG_INFO(std::printf("XYZAligner::converge|registered local maps [%06lu:{%06lu-%06lu}] > [%06lu:{%06lu-%06lu}] "
+          LOG_INFO(Logger::print("XYZAligner::converge|registered local maps [%06lu:{%06lu-%06lu}] > [%06lu:{%06lu-%06lu}] "
                                "(correspondences: %3lu, iterations: %2lu, inlier ratio: %5.3f, inliers: %2lu)\n",
           _context->local_map_query->identifier(),
           _context->local_map_query->frames().front()->identifier(), _context->local_map_query->frames().back()->identifier(),
@@ -152,7 +158,7 @@ namespace proslam {
 
           break;
         } else {
-          LOG_DEBUG(std::printf("XYZAligner::converge|dropped registration for local maps [%06lu:{%06lu-%06lu}] > [%06lu:{%06lu-%06lu}] "
+          LOG_DEBUG(Logger::print("XYZAligner::converge|dropped registration for local maps [%06lu:{%06lu-%06lu}] > [%06lu:{%06lu-%06lu}] "
                                "(correspondences: %3lu, iterations: %2lu, inlier ratio: %5.3f, inliers: %2lu)\n",
           _context->local_map_query->identifier(),
           _context->local_map_query->frames().front()->identifier(), _context->local_map_query->frames().back()->identifier(),
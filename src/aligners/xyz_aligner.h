@@ -12,6 +12,9 @@ PROSLAM_MAKE_PROCESSING_SUBCLASS(XYZAligner, AlignerParameters)
 //ds functionality
 public:
 
+  //ds configure the (shared) aligner parameters - to be called before any registration thread is started
+  virtual void configure();
+
   //ds initialize aligner with minimal entity
   virtual void initialize(Closure* context_, const TransformMatrix3D& current_to_reference_ = TransformMatrix3D::Identity());
 
@@ -24,14 +27,20 @@ public:
   //ds solve alignment problem until convergence is reached
   virtual void converge();
 
+//ds helpers
+protected:
+
+  //! @brief linearizes the measurements [index_begin_, index_end_) into the provided accumulator (thread safe for disjoint ranges)
+  void _linearizeRange(const Count& index_begin_,
+                       const Count& index_end_,
+                       const bool& ignore_outliers_,
+                       Accumulator& accumulator_);
+
 //ds attributes
 protected:
 
   //ds solver setup (TODO port solver)
   Count _number_of_measurements = 0;
-  std::vector<DimensionMatrix, Eigen::aligned_allocator<DimensionMatrix> > _information_vector;
-  std::vector<Vector3> _moving;
-  std::vector<Vector3> _fixed;
 
 };
 
@@ -27,95 +27,123 @@ void  BaseFramePointGenerator::configure(){
   _principal_point_offset_v_pixels = _camera_left->cameraMatrix()(1,2);
   LOG_INFO(std::cerr << "BaseFramePointGenerator::configure|focal length (pixels): " << _focal_length_pixels << std::endl)
 
-  //ds initialize feature matcher
-  _feature_matcher_left.configure(_number_of_rows_image, _number_of_cols_image);
-
   //ds configure tracking window
   _projection_tracking_distance_pixels = _parameters->maximum_projection_tracking_distance_pixels;
 
-  //ds allocate descriptor extractor TODO enable further support and check BIT SIZES
-#if CV_MAJOR_VERSION == 2
-  if (_parameters->descriptor_type == "BRIEF-256") {
-    _descriptor_extractor = new cv::BriefDescriptorExtractor(DESCRIPTOR_SIZE_BYTES);
-  } else if (_parameters->descriptor_type == "ORB-256") {
-    _descriptor_extractor        = new cv::OrbDescriptorExtractor();
-    _parameters->descriptor_type = "ORB-256";
-  } else {
-    LOG_WARNING(std::cerr << "BaseFramePointGenerator::configure|descriptor_type: " << _parameters->descriptor_type
-                          << " is not implemented, defaulting to ORB-256" << std::endl)
-    _descriptor_extractor        = new cv::OrbDescriptorExtractor();
-    _parameters->descriptor_type = "ORB-256";
+  //ds allocate a descriptor extractor for each image stream (extractors are not shared between concurrently processed streams)
+  _descriptor_extractors.resize(_parameters->number_of_cameras);
+  for (cv::Ptr<cv::DescriptorExtractor>& descriptor_extractor: _descriptor_extractors) {
+    descriptor_extractor = _createDescriptorExtractor();
   }
-#elif CV_MAJOR_VERSION == 3
-  if (_parameters->descriptor_type == "BRIEF-256") {
-    #ifdef SRRG_PROSLAM_HAS_OPENCV_CONTRIB
-      _descriptor_extractor = cv::xfeatures2d::BriefDescriptorExtractor::create(DESCRIPTOR_SIZE_BYTES);
-    #else
-      LOG_WARNING(std::cerr << "BaseFramePointGenerator::configure|descriptor_type: BRIEF-256"
-                            << " is not available in current build, defaulting to ORB-256" << std::endl)
-      _descriptor_extractor        = cv::ORB::create();
-      _parameters->descriptor_type = "ORB-256";
-    #endif
-  } else if (_parameters->descriptor_type == "ORB-256") {
-    _descriptor_extractor = cv::ORB::create();
-  } else if (_parameters->descriptor_type == "BRISK-512") {
-    _descriptor_extractor = cv::BRISK::create();
-  } else if (_parameters->descriptor_type == "FREAK-512") {
-    #ifdef SRRG_PROSLAM_HAS_OPENCV_CONTRIB
-        _descriptor_extractor = cv::xfeatures2d::FREAK::create();
-    #else
-        LOG_WARNING(std::cerr << "BaseFramePointGenerator::configure|descriptor_type: FREAK-512"
-                              << " is not available in current build, defaulting to ORB-256" << std::endl)
-        _descriptor_extractor        = cv::ORB::create();
-        _parameters->descriptor_type = "ORB-256";
-    #endif
-  } else {
-    LOG_WARNING(std::cerr << "BaseFramePointGenerator::configure|descriptor_type: " << _parameters->descriptor_type
-                          << " is not implemented, defaulting to ORB-256" << std::endl)
-    _descriptor_extractor        = cv::ORB::create();
-    _parameters->descriptor_type = "ORB-256";
+
+  //ds the descriptor width is determined by the extractor and selects the matching kernels (the storage width is fixed at compile time)
+  _descriptor_size_bits = 8*_descriptor_extractors[0]->descriptorSize();
+  if (!isSupportedDescriptorSize(_descriptor_size_bits)) {
+    LOG_ERROR(std::cerr << "BaseFramePointGenerator::configure|descriptor_type: " << _parameters->descriptor_type
+                        << " has an unsupported size: " << _descriptor_size_bits << "b (supported: 256b, 512b up to the storage size: "
+                        << SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS << "b, see SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS)" << std::endl)
+    throw std::runtime_error("BaseFramePointGenerator::configure|unsupported descriptor size");
+  }
+
+  //ds derive unset matching thresholds from the extracted descriptor width (not the storage width)
+  if (_parameters->matching_distance_tracking_threshold < 0) {
+    _parameters->matching_distance_tracking_threshold = 0.2*_descriptor_size_bits;
   }
-#endif
 
   //ds log chosen descriptor type and size
   LOG_INFO(std::cerr << "BaseFramePointGenerator::configure|descriptor_type: " << _parameters->descriptor_type
-                     << " (memory: " << SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS << "b)" << std::endl)
+                     << " (size: " << _descriptor_size_bits << "b, memory: " << SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS << "b)" << std::endl)
+
+  //ds configure detection resolution (pyramid level 0: full resolution, each level halves the image dimensions)
+  _pyramid_scale            = 1 << _parameters->detection_pyramid_level;
+  _number_of_rows_detection = _number_of_rows_image;
+  _number_of_cols_detection = _number_of_cols_image;
+  for (uint32_t level = 0; level < _parameters->detection_pyramid_level; ++level) {
+    _number_of_rows_detection = (_number_of_rows_detection+1)/2;
+    _number_of_cols_detection = (_number_of_cols_detection+1)/2;
+  }
+  _image_pyramids.resize(_parameters->number_of_cameras, std::vector<cv::Mat>(_parameters->detection_pyramid_level));
+  LOG_INFO(std::cerr << "BaseFramePointGenerator::configure|detection resolution: " << _number_of_cols_detection << "x" << _number_of_rows_detection
+                     << " (pyramid level: " << _parameters->detection_pyramid_level << ")" << std::endl)
 
-  //ds allocate and initialize detector grid structure
-  _detectors           = new cv::Ptr<cv::FastFeatureDetector>*[_parameters->number_of_detectors_vertical];
+  //ds initialize feature matcher - the lattice is laid out at detection resolution, such that a projective tracking search
+  //ds (window scaled to full resolution) visits as many cells and candidates as on the pyramid level
+  _feature_matcher_left.cell_size_pixels *= _pyramid_scale;
+  _feature_matcher_left.configure(_number_of_rows_image, _number_of_cols_image);
+
+  //ds allocate and initialize detector grid structure (detectors and thresholds per image stream, regions are shared)
+  _detectors           = new cv::Ptr<cv::FastFeatureDetector>**[_parameters->number_of_cameras];
+  _detector_thresholds = new real**[_parameters->number_of_cameras];
   _detector_regions    = new cv::Rect*[_parameters->number_of_detectors_vertical];
-  _detector_thresholds = new real*[_parameters->number_of_detectors_vertical];
-  const real pixel_rows_per_detector = static_cast<real>(_number_of_rows_image)/_parameters->number_of_detectors_vertical;
-  const real pixel_cols_per_detector = static_cast<real>(_number_of_cols_image)/_parameters->number_of_detectors_horizontal;
+  const real pixel_rows_per_detector = static_cast<real>(_number_of_rows_detection)/_parameters->number_of_detectors_vertical;
+  const real pixel_cols_per_detector = static_cast<real>(_number_of_cols_detection)/_parameters->number_of_detectors_horizontal;
   for (uint32_t r = 0; r < _parameters->number_of_detectors_vertical; ++r) {
-    _detectors[r]           = new cv::Ptr<cv::FastFeatureDetector>[_parameters->number_of_detectors_horizontal];
-    _detector_regions[r]    = new cv::Rect[_parameters->number_of_detectors_horizontal];
-    _detector_thresholds[r] = new real[_parameters->number_of_detectors_horizontal];
+    _detector_regions[r] = new cv::Rect[_parameters->number_of_detectors_horizontal];
     for (uint32_t c = 0; c < _parameters->number_of_detectors_horizontal; ++c) {
-#if CV_MAJOR_VERSION == 2
-      _detectors[r][c] = new cv::FastFeatureDetector(_parameters->detector_threshold_minimum);
-#else
-      _detectors[r][c] = cv::FastFeatureDetector::create(_parameters->detector_threshold_minimum);
-#endif
       _detector_regions[r][c] = cv::Rect(std::round(c*pixel_cols_per_detector),
                                          std::round(r*pixel_rows_per_detector),
                                          pixel_cols_per_detector,
                                          pixel_rows_per_detector);
-      _detector_thresholds[r][c] = _parameters->detector_threshold_minimum;
+    }
+  }
+  for (uint32_t stream = 0; stream < _parameters->number_of_cameras; ++stream) {
+    _detectors[stream]           = new cv::Ptr<cv::FastFeatureDetector>*[_parameters->number_of_detectors_vertical];
+    _detector_thresholds[stream] = new real*[_parameters->number_of_detectors_vertical];
+    for (uint32_t r = 0; r < _parameters->number_of_detectors_vertical; ++r) {
+      _detectors[stream][r]           = new cv::Ptr<cv::FastFeatureDetector>[_parameters->number_of_detectors_horizontal];
+      _detector_thresholds[stream][r] = new real[_parameters->number_of_detectors_horizontal];
+      for (uint32_t c = 0; c < _parameters->number_of_detectors_horizontal; ++c) {
+#if CV_MAJOR_VERSION == 2
+        _detectors[stream][r][c] = new cv::FastFeatureDetector(_parameters->detector_threshold_minimum);
+#else
+        _detectors[stream][r][c] = cv::FastFeatureDetector::create(_parameters->detector_threshold_minimum);
+#endif
+        _detector_thresholds[stream][r][c] = _parameters->detector_threshold_minimum;
+      }
     }
   }
   _number_of_detectors = _parameters->number_of_detectors_vertical*_parameters->number_of_detectors_horizontal;
+  _keypoints_per_detector.resize(_parameters->number_of_cameras, std::vector<std::vector<cv::KeyPoint>>(_number_of_detectors));
+  _number_of_predicted_tracks_per_detector.resize(_parameters->number_of_cameras, std::vector<Count>(_number_of_detectors, 0));
+  _track_neighborhoods.resize(_parameters->number_of_cameras);
+  _deferred_keypoints.resize(_parameters->number_of_cameras);
+  LOG_INFO(std::cerr << "BaseFramePointGenerator::configure|number of detection threads: " << _parameters->number_of_detection_threads << std::endl)
+
+  //ds configure keypoint detection backend (the detector grid thresholds are shared by all backends)
+  if (_parameters->keypoint_detection_backend == "CUDA") {
+#ifdef SRRG_PROSLAM_HAS_OPENCV_CUDA
+    delete _cuda_keypoint_detector;
+    _cuda_keypoint_detector = new CudaKeypointDetector(_parameters->number_of_cameras,
+                                                       _number_of_rows_image,
+                                                       _number_of_cols_image,
+                                                       _parameters->detection_pyramid_level,
+                                                       _detector_regions,
+                                                       _parameters->number_of_detectors_vertical,
+                                                       _parameters->number_of_detectors_horizontal);
+    _detection_on_device = true;
+#else
+    LOG_WARNING(std::cerr << "BaseFramePointGenerator::configure|keypoint_detection_backend: CUDA"
+                          << " is not available in current build, defaulting to CPU" << std::endl)
+    _parameters->keypoint_detection_backend = "CPU";
+#endif
+  } else if (_parameters->keypoint_detection_backend != "CPU") {
+    LOG_WARNING(std::cerr << "BaseFramePointGenerator::configure|keypoint_detection_backend: " << _parameters->keypoint_detection_backend
+                          << " is not implemented, defaulting to CPU" << std::endl)
+    _parameters->keypoint_detection_backend = "CPU";
+  }
+  LOG_INFO(std::cerr << "BaseFramePointGenerator::configure|keypoint detection backend: " << _parameters->keypoint_detection_backend << std::endl)
 
-  //ds compute binning configuration
-  _number_of_cols_bin = std::floor(static_cast<real>(_camera_left->numberOfImageCols())/_parameters->bin_size_pixels)+1;
-  _number_of_rows_bin = std::floor(static_cast<real>(_camera_left->numberOfImageRows())/_parameters->bin_size_pixels)+1;
+  //ds compute binning configuration (bin size is defined at detection resolution)
+  _bin_size_pixels    = _parameters->bin_size_pixels*_pyramid_scale;
+  _number_of_cols_bin = std::floor(static_cast<real>(_camera_left->numberOfImageCols())/_bin_size_pixels)+1;
+  _number_of_rows_bin = std::floor(static_cast<real>(_camera_left->numberOfImageRows())/_bin_size_pixels)+1;
 
   //ds compute target number of points
   _target_number_of_keypoints = _number_of_cols_bin*_number_of_rows_bin;
   LOG_INFO(std::cerr << "BaseFramePointGenerator::configure|current target number of points: " << _target_number_of_keypoints << std::endl)
 
   //ds compute target points per detector region
-  _target_number_of_keypoints_per_detector = static_cast<real>(_target_number_of_keypoints)/_number_of_detectors;
+  setKeypointTargetScale(_keypoint_target_scale);
   LOG_INFO(std::cerr << "BaseFramePointGenerator::configure|current target number of points per image region: " << _target_number_of_keypoints_per_detector << std::endl)
 
   //ds allocate and initialize bin grid
@@ -126,8 +154,8 @@ void  BaseFramePointGenerator::configure(){
       _bin_map_left[row][col] = nullptr;
     }
   }
-  LOG_INFO(std::cerr << "BaseTracker::configure|number of horizontal bins: " << _number_of_cols_bin << " size: " << _parameters->bin_size_pixels << std::endl)
-  LOG_INFO(std::cerr << "BaseTracker::configure|number of vertical bins: " << _number_of_rows_bin << " size: " << _parameters->bin_size_pixels << std::endl)
+  LOG_INFO(std::cerr << "BaseTracker::configure|number of horizontal bins: " << _number_of_cols_bin << " size: " << _bin_size_pixels << std::endl)
+  LOG_INFO(std::cerr << "BaseTracker::configure|number of vertical bins: " << _number_of_rows_bin << " size: " << _bin_size_pixels << std::endl)
 
   //ds clear buffers
   _keypoints_with_descriptors_left.clear();
@@ -139,16 +167,26 @@ BaseFramePointGenerator::~BaseFramePointGenerator() {
 
   //ds deallocate dynamic data structures: detectors
   if (_detectors && _detector_regions && _detector_thresholds) {
+    for (uint32_t stream = 0; stream < _parameters->number_of_cameras; ++stream) {
+      for (uint32_t r = 0; r < _parameters->number_of_detectors_vertical; ++r) {
+        delete[] _detectors[stream][r];
+        delete[] _detector_thresholds[stream][r];
+      }
+      delete[] _detectors[stream];
+      delete[] _detector_thresholds[stream];
+    }
     for (uint32_t r = 0; r < _parameters->number_of_detectors_vertical; ++r) {
-      delete[] _detectors[r];
       delete[] _detector_regions[r];
-      delete[] _detector_thresholds[r];
     }
     delete [] _detectors;
     delete [] _detector_regions;
     delete [] _detector_thresholds;
   }
 
+#ifdef SRRG_PROSLAM_HAS_OPENCV_CUDA
+  delete _cuda_keypoint_detector;
+#endif
+
   //ds free bin map
   for (Count row = 0; row < _number_of_rows_bin; ++row) {
     delete[] _bin_map_left[row];
@@ -157,95 +195,370 @@ BaseFramePointGenerator::~BaseFramePointGenerator() {
   LOG_INFO(std::cerr << "BaseFramePointGenerator::~BaseFramePointGenerator|destroyed" << std::endl)
 }
 
-void BaseFramePointGenerator::detectKeypoints(const cv::Mat& intensity_image_, std::vector<cv::KeyPoint>& keypoints_) {
+void BaseFramePointGenerator::detectKeypoints(const cv::Mat& intensity_image_, std::vector<cv::KeyPoint>& keypoints_, const uint32_t& stream_) {
   CHRONOMETER_START(keypoint_detection)
 
-  //ds detect new keypoints in each image region
-  for (uint32_t r = 0; r < _parameters->number_of_detectors_vertical; ++r) {
-    for (uint32_t c = 0; c < _parameters->number_of_detectors_horizontal; ++c) {
+  //ds the GPU backend processes all image streams in one batch - single stream setups (e.g. depth) can use it here directly
+  if (_detection_on_device && _parameters->number_of_cameras == 1) {
+    _detectKeypointsOnDevice({&intensity_image_}, {&keypoints_});
+  } else {
+    _detectKeypoints(intensity_image_, keypoints_, stream_);
+  }
+  _number_of_detected_keypoints = keypoints_.size();
+  CHRONOMETER_STOP(keypoint_detection)
+}
+
+void BaseFramePointGenerator::computeDescriptors(const cv::Mat& intensity_image_,
+                                                 std::vector<cv::KeyPoint>& keypoints_,
+                                                 cv::Mat& descriptors_,
+                                                 const uint32_t& stream_) {
+  CHRONOMETER_START(descriptor_extraction)
+  _computeDescriptors(intensity_image_, keypoints_, descriptors_, stream_);
+  CHRONOMETER_STOP(descriptor_extraction)
+}
+
+void BaseFramePointGenerator::track(Frame* frame_,
+                                    Frame* frame_previous_,
+                                    const TransformMatrix3D& camera_left_previous_in_current_,
+                                    FramePointPointerVector& previous_framepoints_without_tracks_,
+                                    const bool track_by_appearance_) {
+  throw std::runtime_error("default monocular tracking not implemented yet");
+}
 
-      //ds detect keypoints in current region
-      std::vector<cv::KeyPoint> keypoints_per_detector(0);
-      _detectors[r][c]->detect(intensity_image_(_detector_regions[r][c]), keypoints_per_detector);
+void BaseFramePointGenerator::setKeypointTargetScale(const real& scale_) {
+  _keypoint_target_scale                   = scale_;
+  _target_number_of_keypoints_per_detector = std::max(static_cast<Count>(_keypoint_target_scale*_target_number_of_keypoints/_number_of_detectors), static_cast<Count>(1));
+}
 
-      //ds current threshold for this detector
+void BaseFramePointGenerator::adjustDetectorThresholds() {
+  for (uint32_t stream = 0; stream < _parameters->number_of_cameras; ++stream) {
+    for (uint32_t r = 0; r < _parameters->number_of_detectors_vertical; ++r) {
+      for (uint32_t c = 0; c < _parameters->number_of_detectors_horizontal; ++c) {
 #if CV_MAJOR_VERSION == 2
-      real detector_threshold = _detectors[r][c]->getInt("threshold");
+        _detectors[stream][r][c]->setInt("threshold", _detector_thresholds[stream][r][c]);
 #else
-      real detector_threshold = _detectors[r][c]->getThreshold();
+        _detectors[stream][r][c]->setThreshold(_detector_thresholds[stream][r][c]);
 #endif
+      }
+    }
+  }
+}
 
-      //ds compute point delta: 100% loss > -1, 100% gain > +1
-      const real delta = (static_cast<real>(keypoints_per_detector.size())-_target_number_of_keypoints_per_detector)/_target_number_of_keypoints_per_detector;
-
-      //ds check if there's a significant loss of target points (delta is negative)
-      if (delta < -_parameters->target_number_of_keypoints_tolerance) {
-
-        //ds compute new, lower threshold, capped and damped
-        const real change = std::max(delta, -_parameters->detector_threshold_maximum_change);
+void BaseFramePointGenerator::_detectKeypoints(const cv::Mat& intensity_image_, std::vector<cv::KeyPoint>& keypoints_, const uint32_t& stream_) {
+  assert(stream_ < _parameters->number_of_cameras);
 
-        //ds always lower threshold by at least 1
-        detector_threshold += std::min(change*detector_threshold, -1.0);
+  //ds select detection image: full resolution or a downsampled pyramid level
+  const cv::Mat* detection_image = &intensity_image_;
+  if (_parameters->detection_pyramid_level > 0) {
+    std::vector<cv::Mat>& pyramid = _image_pyramids[stream_];
+    cv::pyrDown(intensity_image_, pyramid[0]);
+    for (uint32_t level = 1; level < _parameters->detection_pyramid_level; ++level) {
+      cv::pyrDown(pyramid[level-1], pyramid[level]);
+    }
+    detection_image = &pyramid.back();
+  }
 
-        //ds check minimum threshold
-        if (detector_threshold < _parameters->detector_threshold_minimum) {
-          detector_threshold = _parameters->detector_threshold_minimum;
-        }
-      }
+  //ds number of tasks to spread the detector grid over
+  const uint32_t number_of_workers = std::max(std::min(_parameters->number_of_detection_threads, _number_of_detectors), 1u);
+  std::vector<std::vector<cv::KeyPoint>>& keypoints_per_detector = _keypoints_per_detector[stream_];
+
+  //ds detect new keypoints in each image region - each worker processes every number_of_workers-th region
+  //ds regions are fully independent (own detector, threshold and output buffer), which keeps the result deterministic
+  auto detect = [&](const Index& worker_index_) {
+    for (uint32_t index = worker_index_; index < _number_of_detectors; index += number_of_workers) {
+      _detectKeypointsInRegion(*detection_image,
+                               stream_,
+                               index/_parameters->number_of_detectors_horizontal,
+                               index%_parameters->number_of_detectors_horizontal,
+                               keypoints_per_detector[index]);
+    }
+  };
+  runTasks(_worker_pool, number_of_workers, detect);
 
-      //ds or if there's a significant gain of target points (delta is positive)
-      else if (delta > _parameters->target_number_of_keypoints_tolerance) {
+  //ds add to complete vector in region order (identical to serial detection)
+  _mergeKeypoints(intensity_image_, stream_, keypoints_);
+}
 
-        //ds compute new, higher threshold - capped and damped
-        const real change = std::min(delta, _parameters->detector_threshold_maximum_change);
+void BaseFramePointGenerator::_detectKeypointsOnDevice(const std::vector<const cv::Mat*>& intensity_images_,
+                                                       const std::vector<std::vector<cv::KeyPoint>*>& keypoints_) {
+#ifdef SRRG_PROSLAM_HAS_OPENCV_CUDA
+  assert(_cuda_keypoint_detector);
+  assert(intensity_images_.size() == _parameters->number_of_cameras);
+  assert(keypoints_.size() == _parameters->number_of_cameras);
+
+  //ds detect keypoints in all regions of all streams in one batch
+  _cuda_keypoint_detector->detect(intensity_images_, _detector_thresholds, _keypoints_per_detector);
+
+  //ds adapt region thresholds and shift keypoint coordinates to whole image region (same as for CPU detection)
+  for (uint32_t stream = 0; stream < _parameters->number_of_cameras; ++stream) {
+    for (uint32_t index = 0; index < _number_of_detectors; ++index) {
+      const uint32_t row = index/_parameters->number_of_detectors_horizontal;
+      const uint32_t col = index%_parameters->number_of_detectors_horizontal;
+      std::vector<cv::KeyPoint>& keypoints = _keypoints_per_detector[stream][index];
+      _adaptDetectorThreshold(stream, row, col, _detector_thresholds[stream][row][col], keypoints.size());
+      const cv::Point2f& offset = _detector_regions[row][col].tl();
+      std::for_each(keypoints.begin(), keypoints.end(), [&offset](cv::KeyPoint& keypoint_) {keypoint_.pt += offset;});
+    }
+    _mergeKeypoints(*intensity_images_[stream], stream, *keypoints_[stream]);
+  }
+#else
+  throw std::runtime_error("BaseFramePointGenerator::_detectKeypointsOnDevice|CUDA keypoint detection is not available in current build");
+#endif
+}
 
-        //ds always increase threshold by at least 1
-        detector_threshold += std::max(change*detector_threshold, 1.0);
+void BaseFramePointGenerator::_mergeKeypoints(const cv::Mat& intensity_image_, const uint32_t& stream_, std::vector<cv::KeyPoint>& keypoints_) {
+  const size_t number_of_keypoints_previous = keypoints_.size();
+  for (const std::vector<cv::KeyPoint>& keypoints: _keypoints_per_detector[stream_]) {
+    keypoints_.insert(keypoints_.end(), keypoints.begin(), keypoints.end());
+  }
 
-        //ds check maximum threshold
-        if (detector_threshold > _parameters->detector_threshold_maximum) {
-          detector_threshold = _parameters->detector_threshold_maximum;
-        }
-      }
+  //ds if detection was performed on a pyramid level - map the new keypoints to full resolution and refine them there
+  if (_parameters->detection_pyramid_level > 0) {
+    _refineKeypoints(intensity_image_, keypoints_, number_of_keypoints_previous);
+  }
+}
 
-      //ds set treshold (no effect if not changed)
-      _detector_thresholds[r][c] = detector_threshold;
+void BaseFramePointGenerator::_refineKeypoints(const cv::Mat& intensity_image_, std::vector<cv::KeyPoint>& keypoints_, const size_t& index_begin_) const {
+  if (index_begin_ >= keypoints_.size()) {
+    return;
+  }
 
-      //ds shift keypoint coordinates to whole image region
-      const cv::Point2f& offset = _detector_regions[r][c].tl();
-      std::for_each(keypoints_per_detector.begin(), keypoints_per_detector.end(), [&offset](cv::KeyPoint& keypoint_) {keypoint_.pt += offset;});
+  //ds map keypoints to pixel centers at full resolution: u = (u_level+0.5)*scale-0.5
+  const float scale  = _pyramid_scale;
+  const float offset = (scale-1)/2;
+  std::vector<cv::Point2f> image_coordinates(keypoints_.size()-index_begin_);
+  for (size_t index = index_begin_; index < keypoints_.size(); ++index) {
+    cv::KeyPoint& keypoint = keypoints_[index];
+    keypoint.pt     = keypoint.pt*scale+cv::Point2f(offset, offset);
+    keypoint.size  *= scale;
+    keypoint.octave = _parameters->detection_pyramid_level;
+    image_coordinates[index-index_begin_] = keypoint.pt;
+  }
 
-      //ds add to complete vector
-      keypoints_.insert(keypoints_.end(), keypoints_per_detector.begin(), keypoints_per_detector.end());
+  //ds refine locations at full resolution (subpixel accuracy for triangulation), search window covers the downsampling footprint
+  cv::cornerSubPix(intensity_image_,
+                   image_coordinates,
+                   cv::Size(_pyramid_scale, _pyramid_scale),
+                   cv::Size(-1, -1),
+                   cv::TermCriteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 10, 0.01));
+
+  //ds accept refined locations only if they stay in the footprint of the coarse pixel and inside the image
+  for (size_t index = index_begin_; index < keypoints_.size(); ++index) {
+    const cv::Point2f& refined = image_coordinates[index-index_begin_];
+    if (std::fabs(refined.x-keypoints_[index].pt.x) <= scale && std::fabs(refined.y-keypoints_[index].pt.y) <= scale &&
+        refined.x >= 0 && refined.x <= _number_of_cols_image-1 && refined.y >= 0 && refined.y <= _number_of_rows_image-1) {
+      keypoints_[index].pt = refined;
     }
   }
-  _number_of_detected_keypoints = keypoints_.size();
-  CHRONOMETER_STOP(keypoint_detection)
 }
 
-void BaseFramePointGenerator::computeDescriptors(const cv::Mat& intensity_image_, std::vector<cv::KeyPoint>& keypoints_, cv::Mat& descriptors_) {
-  CHRONOMETER_START(descriptor_extraction)
-  _descriptor_extractor->compute(intensity_image_, keypoints_, descriptors_);
-  CHRONOMETER_STOP(descriptor_extraction)
+void BaseFramePointGenerator::_computeDescriptors(const cv::Mat& intensity_image_,
+                                                  std::vector<cv::KeyPoint>& keypoints_,
+                                                  cv::Mat& descriptors_,
+                                                  const uint32_t& stream_) {
+  assert(stream_ < _descriptor_extractors.size());
+  _descriptor_extractors[stream_]->compute(intensity_image_, keypoints_, descriptors_);
 }
 
-void BaseFramePointGenerator::track(Frame* frame_,
-                                    Frame* frame_previous_,
-                                    const TransformMatrix3D& camera_left_previous_in_current_,
-                                    FramePointPointerVector& previous_framepoints_without_tracks_,
-                                    const bool track_by_appearance_) {
-  throw std::runtime_error("default monocular tracking not implemented yet");
-}
+void BaseFramePointGenerator::_detectKeypointsInRegion(const cv::Mat& intensity_image_,
+                                                       const uint32_t& stream_,
+                                                       const uint32_t& row_,
+                                                       const uint32_t& col_,
+                                                       std::vector<cv::KeyPoint>& keypoints_) {
 
-void BaseFramePointGenerator::adjustDetectorThresholds() {
-  for (uint32_t r = 0; r < _parameters->number_of_detectors_vertical; ++r) {
-    for (uint32_t c = 0; c < _parameters->number_of_detectors_horizontal; ++c) {
+  //ds detect keypoints in current region
+  keypoints_.clear();
+  _detectors[stream_][row_][col_]->detect(intensity_image_(_detector_regions[row_][col_]), keypoints_);
+
+  //ds current threshold for this detector
 #if CV_MAJOR_VERSION == 2
-      _detectors[r][c]->setInt("threshold", _detector_thresholds[r][c]);
+  const real detector_threshold = _detectors[stream_][row_][col_]->getInt("threshold");
 #else
-      _detectors[r][c]->setThreshold(_detector_thresholds[r][c]);
+  const real detector_threshold = _detectors[stream_][row_][col_]->getThreshold();
 #endif
+  _adaptDetectorThreshold(stream_, row_, col_, detector_threshold, keypoints_.size());
+
+  //ds shift keypoint coordinates to whole image region
+  const cv::Point2f& offset = _detector_regions[row_][col_].tl();
+  std::for_each(keypoints_.begin(), keypoints_.end(), [&offset](cv::KeyPoint& keypoint_) {keypoint_.pt += offset;});
+}
+
+void BaseFramePointGenerator::_resetPredictedTracks() {
+  for (std::vector<Count>& number_of_predicted_tracks: _number_of_predicted_tracks_per_detector) {
+    std::fill(number_of_predicted_tracks.begin(), number_of_predicted_tracks.end(), 0);
+  }
+
+  //ds neighborhood cells span the current tracking window (the window changes at runtime)
+  _track_neighborhood_cell_size_pixels = std::max(_projection_tracking_distance_pixels*_pyramid_scale, 1);
+  _number_of_rows_track_neighborhoods  = _number_of_rows_image/_track_neighborhood_cell_size_pixels+1;
+  _number_of_cols_track_neighborhoods  = _number_of_cols_image/_track_neighborhood_cell_size_pixels+1;
+  for (std::vector<bool>& track_neighborhoods: _track_neighborhoods) {
+    track_neighborhoods.assign(_number_of_rows_track_neighborhoods*_number_of_cols_track_neighborhoods, false);
+  }
+}
+
+void BaseFramePointGenerator::_addPredictedTrack(const uint32_t& stream_, const cv::Point2f& image_coordinates_, const int32_t& radius_cells_) {
+  if (image_coordinates_.x < 0 || image_coordinates_.x >= _number_of_cols_image ||
+      image_coordinates_.y < 0 || image_coordinates_.y >= _number_of_rows_image) {
+    return;
+  }
+  ++_number_of_predicted_tracks_per_detector[stream_][_getDetectorIndex(image_coordinates_)];
+
+  //ds mark all cells overlapping with the tracking window around the prediction
+  const int32_t row_cell = image_coordinates_.y/_track_neighborhood_cell_size_pixels;
+  const int32_t col_cell = image_coordinates_.x/_track_neighborhood_cell_size_pixels;
+  std::vector<bool>& track_neighborhoods = _track_neighborhoods[stream_];
+  for (int32_t row = std::max(row_cell-radius_cells_, 0); row <= std::min(row_cell+radius_cells_, _number_of_rows_track_neighborhoods-1); ++row) {
+    for (int32_t col = std::max(col_cell-radius_cells_, 0); col <= std::min(col_cell+radius_cells_, _number_of_cols_track_neighborhoods-1); ++col) {
+      track_neighborhoods[row*_number_of_cols_track_neighborhoods+col] = true;
+    }
+  }
+}
+
+void BaseFramePointGenerator::_deferKeypointsInSaturatedRegions(const uint32_t& stream_, std::vector<cv::KeyPoint>& keypoints_) {
+  const std::vector<bool>& track_neighborhoods = _track_neighborhoods[stream_];
+  std::vector<cv::KeyPoint>& deferred_keypoints = _deferred_keypoints[stream_];
+
+  //ds compact keypoints in place, preserving their order
+  size_t number_of_keypoints = 0;
+  for (const cv::KeyPoint& keypoint: keypoints_) {
+    const int32_t row_cell = keypoint.pt.y/_track_neighborhood_cell_size_pixels;
+    const int32_t col_cell = keypoint.pt.x/_track_neighborhood_cell_size_pixels;
+    if (_isSaturated(stream_, _getDetectorIndex(keypoint.pt)) && !track_neighborhoods[row_cell*_number_of_cols_track_neighborhoods+col_cell]) {
+      deferred_keypoints.push_back(keypoint);
+    } else {
+      keypoints_[number_of_keypoints] = keypoint;
+      ++number_of_keypoints;
     }
   }
+  keypoints_.resize(number_of_keypoints);
+}
+
+void BaseFramePointGenerator::_getAdaptiveTrackingDistances(const PointCoordinates& point_in_camera_left_,
+                                                            const int32_t& maximum_distance_pixels_,
+                                                            int32_t& distance_rows_pixels_,
+                                                            int32_t& distance_cols_pixels_) const {
+  const Matrix3& camera_matrix = _camera_left->cameraMatrix();
+  const real inverse_depth     = 1/point_in_camera_left_.z();
+
+  //ds jacobian of the projection with respect to the point in the camera frame (closer points move more in the image)
+  Matrix2_3 jacobian_projection;
+  jacobian_projection << camera_matrix(0,0)*inverse_depth, 0, -camera_matrix(0,0)*point_in_camera_left_.x()*inverse_depth*inverse_depth,
+                         0, camera_matrix(1,1)*inverse_depth, -camera_matrix(1,1)*point_in_camera_left_.y()*inverse_depth*inverse_depth;
+
+  //ds jacobian of the point with respect to a perturbation of the motion guess = [I -skew(p)]
+  Matrix3_6 jacobian_transform;
+  jacobian_transform.block<3,3>(0,0).setIdentity();
+  jacobian_transform.block<3,3>(0,3) = -srrg_core::skew(point_in_camera_left_);
+
+  //ds propagate the motion guess uncertainty into the image plane
+  const Matrix2_6 jacobian(jacobian_projection*jacobian_transform);
+  const Eigen::Matrix<real, 2, 2> covariance_image(jacobian*_motion_guess_covariance*jacobian.transpose());
+
+  //ds window half sizes (bounded by the minimum and the currently active tracking distance)
+  const int32_t minimum_distance_pixels = std::min(_parameters->minimum_projection_tracking_distance_pixels*_pyramid_scale, maximum_distance_pixels_);
+  distance_cols_pixels_ = std::ceil(_parameters->adaptive_tracking_window_sigma_factor*std::sqrt(covariance_image(0,0)));
+  distance_rows_pixels_ = std::ceil(_parameters->adaptive_tracking_window_sigma_factor*std::sqrt(covariance_image(1,1)));
+  distance_cols_pixels_ = std::min(std::max(distance_cols_pixels_, minimum_distance_pixels), maximum_distance_pixels_);
+  distance_rows_pixels_ = std::min(std::max(distance_rows_pixels_, minimum_distance_pixels), maximum_distance_pixels_);
+}
+
+void BaseFramePointGenerator::_adaptDetectorThreshold(const uint32_t& stream_,
+                                                      const uint32_t& row_,
+                                                      const uint32_t& col_,
+                                                      const real& detector_threshold_current_,
+                                                      const Count& number_of_keypoints_) {
+  real detector_threshold = detector_threshold_current_;
+
+  //ds regions saturated by predicted tracks only need to re-detect the tracked keypoints (fewer, stronger corners)
+  const uint32_t index = row_*_parameters->number_of_detectors_horizontal+col_;
+  const real target_number_of_keypoints = (_isSaturated(stream_, index))? std::max(static_cast<real>(_number_of_predicted_tracks_per_detector[stream_][index]), static_cast<real>(1)):
+                                                                           _target_number_of_keypoints_per_detector;
+
+  //ds compute point delta: 100% loss > -1, 100% gain > +1
+  const real delta = (static_cast<real>(number_of_keypoints_)-target_number_of_keypoints)/target_number_of_keypoints;
+
+  //ds check if there's a significant loss of target points (delta is negative)
+  if (delta < -_parameters->target_number_of_keypoints_tolerance) {
+
+    //ds compute new, lower threshold, capped and damped
+    const real change = std::max(delta, -_parameters->detector_threshold_maximum_change);
+
+    //ds always lower threshold by at least 1
+    detector_threshold += std::min(change*detector_threshold, static_cast<real>(-1));
+
+    //ds check minimum threshold
+    if (detector_threshold < _parameters->detector_threshold_minimum) {
+      detector_threshold = _parameters->detector_threshold_minimum;
+    }
+  }
+
+  //ds or if there's a significant gain of target points (delta is positive)
+  else if (delta > _parameters->target_number_of_keypoints_tolerance) {
+
+    //ds compute new, higher threshold - capped and damped
+    const real change = std::min(delta, _parameters->detector_threshold_maximum_change);
+
+    //ds always increase threshold by at least 1
+    detector_threshold += std::max(change*detector_threshold, static_cast<real>(1));
+
+    //ds check maximum threshold
+    if (detector_threshold > _parameters->detector_threshold_maximum) {
+      detector_threshold = _parameters->detector_threshold_maximum;
+    }
+  }
+
+  //ds set treshold (no effect if not changed)
+  _detector_thresholds[stream_][row_][col_] = detector_threshold;
+}
+
+cv::Ptr<cv::DescriptorExtractor> BaseFramePointGenerator::_createDescriptorExtractor() {
+  cv::Ptr<cv::DescriptorExtractor> descriptor_extractor;
+
+  //ds allocate descriptor extractor TODO enable further support and check BIT SIZES
+  //ds the extractor sizes are fixed by the descriptor type (BRIEF-256: 32 bytes), DESCRIPTOR_SIZE_BYTES is only the storage width
+#if CV_MAJOR_VERSION == 2
+  if (_parameters->descriptor_type == "BRIEF-256") {
+    descriptor_extractor = new cv::BriefDescriptorExtractor(32);
+  } else if (_parameters->descriptor_type == "ORB-256") {
+    descriptor_extractor         = new cv::OrbDescriptorExtractor();
+    _parameters->descriptor_type = "ORB-256";
+  } else {
+    LOG_WARNING(std::cerr << "BaseFramePointGenerator::_createDescriptorExtractor|descriptor_type: " << _parameters->descriptor_type
+                          << " is not implemented, defaulting to ORB-256" << std::endl)
+    descriptor_extractor         = new cv::OrbDescriptorExtractor();
+    _parameters->descriptor_type = "ORB-256";
+  }
+#elif CV_MAJOR_VERSION == 3
+  if (_parameters->descriptor_type == "BRIEF-256") {
+    #ifdef SRRG_PROSLAM_HAS_OPENCV_CONTRIB
+      descriptor_extractor = cv::xfeatures2d::BriefDescriptorExtractor::create(32);
+    #else
+      LOG_WARNING(std::cerr << "BaseFramePointGenerator::_createDescriptorExtractor|descriptor_type: BRIEF-256"
+                            << " is not available in current build, defaulting to ORB-256" << std::endl)
+      descriptor_extractor         = cv::ORB::create();
+      _parameters->descriptor_type = "ORB-256";
+    #endif
+  } else if (_parameters->descriptor_type == "ORB-256") {
+    descriptor_extractor = cv::ORB::create();
+  } else if (_parameters->descriptor_type == "BRISK-512") {
+    descriptor_extractor = cv::BRISK::create();
+  } else if (_parameters->descriptor_type == "FREAK-512") {
+    #ifdef SRRG_PROSLAM_HAS_OPENCV_CONTRIB
+        descriptor_extractor = cv::xfeatures2d::FREAK::create();
+    #else
+        LOG_WARNING(std::cerr << "BaseFramePointGenerator::_createDescriptorExtractor|descriptor_type: FREAK-512"
+                              << " is not available in current build, defaulting to ORB-256" << std::endl)
+        descriptor_extractor         = cv::ORB::create();
+        _parameters->descriptor_type = "ORB-256";
+    #endif
+  } else {
+    LOG_WARNING(std::cerr << "BaseFramePointGenerator::_createDescriptorExtractor|descriptor_type: " << _parameters->descriptor_type
+                          << " is not implemented, defaulting to ORB-256" << std::endl)
+    descriptor_extractor         = cv::ORB::create();
+    _parameters->descriptor_type = "ORB-256";
+  }
+#endif
+  return descriptor_extractor;
 }
 }
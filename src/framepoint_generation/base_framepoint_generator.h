@@ -1,6 +1,8 @@
 #pragma once
 #include "types/frame.h"
+#include "types/worker_pool.h"
 #include "intensity_feature_matcher.h"
+#include "cuda_keypoint_detector.h"
 
 
 
@@ -21,11 +23,14 @@ public:
   //ds computes framepoints stored in a image-like matrix (_framepoints_in_image)
   virtual void compute(Frame* frame_) = 0;
 
-  //ds detects keypoints and stores them in a vector (called within compute)
-  void detectKeypoints(const cv::Mat& intensity_image_, std::vector<cv::KeyPoint>& keypoints_);
+  //ds detects keypoints and stores them in a vector (called within compute) - stream_ selects the detector set (e.g. 0: left, 1: right)
+  void detectKeypoints(const cv::Mat& intensity_image_, std::vector<cv::KeyPoint>& keypoints_, const uint32_t& stream_ = 0);
 
-  //ds extracts the defined descriptors for the given keypoints (called within compute)
-  void computeDescriptors(const cv::Mat& intensity_image_, std::vector<cv::KeyPoint>& keypoints_, cv::Mat& descriptors_);
+  //ds extracts the defined descriptors for the given keypoints (called within compute) - stream_ selects the descriptor extractor
+  void computeDescriptors(const cv::Mat& intensity_image_,
+                          std::vector<cv::KeyPoint>& keypoints_,
+                          cv::Mat& descriptors_,
+                          const uint32_t& stream_ = 0);
 
   //@ brief computes tracks between current and previous image points based on appearance
   //! @param[out] previous_points_without_tracks_ lost points
@@ -41,17 +46,30 @@ public:
 //ds getters/setters
 public:
 
-  //ds enable external access to descriptor extractor
-  cv::Ptr<cv::DescriptorExtractor> descriptorExtractor() const {return _descriptor_extractor;}
+  //ds enable external access to descriptor extractor (of the first image stream)
+  cv::Ptr<cv::DescriptorExtractor> descriptorExtractor() const {return _descriptor_extractors[0];}
 
   //ds other properties
   void setCameraLeft(const Camera* camera_left_) {_camera_left = camera_left_;}
+
+  //! @brief worker pool the detection (and stream processing) is distributed over (serial processing without a pool)
+  void setWorkerPool(WorkerPool* worker_pool_) {_worker_pool = worker_pool_;}
   const int32_t& numberOfRowsImage() const {return _number_of_rows_image;}
   const int32_t& numberOfColsImage() const {return _number_of_cols_image;}
   const Count& targetNumberOfKeypoints() const {return _target_number_of_keypoints;}
+
+  //! @brief scales the number of keypoints the detector thresholds are adapted to (e.g. 0.5 to detect half of the target keypoints, 1 by default)
+  //! @brief the triangulation and binning heuristics relate the available points to the scaled target
+  void setKeypointTargetScale(const real& scale_);
+  const real& keypointTargetScale() const {return _keypoint_target_scale;}
+  const real& minimumKeypointTargetScale() const {return _parameters->minimum_keypoint_target_scale;}
+  const real scaledTargetNumberOfKeypoints() const {return std::max(_keypoint_target_scale*_target_number_of_keypoints, static_cast<real>(1));}
   void setProjectionTrackingDistancePixels(const int32_t& projection_tracking_distance_pixels_) {_projection_tracking_distance_pixels = projection_tracking_distance_pixels_;}
+  void setMotionGuess(const TransformMatrix3D& camera_left_previous_in_current_) {_camera_left_previous_in_current_guess = camera_left_previous_in_current_;}
+  void setMotionGuessCovariance(const Matrix6& motion_guess_covariance_) {_motion_guess_covariance = motion_guess_covariance_;}
 
   const int32_t matchingDistanceTrackingThreshold() const {return _parameters->matching_distance_tracking_threshold;}
+  const uint32_t& descriptorSizeBits() const {return _descriptor_size_bits;}
   const Count& numberOfDetectedKeypoints() const {return _number_of_detected_keypoints;}
   const Count& numberOfTrackedLandmarks() const {return _number_of_tracked_landmarks;}
   const Count& numberOfAvailablePoints() const {return _number_of_available_points;}
@@ -61,6 +79,9 @@ protected:
 
   const Camera* _camera_left = nullptr;
 
+  //! @brief worker pool of the assembly (not owned)
+  WorkerPool* _worker_pool = nullptr;
+
   //ds image dimensions
   int32_t _number_of_rows_image;
   int32_t _number_of_cols_image;
@@ -68,6 +89,7 @@ protected:
   //ds point detection properties
   Count _target_number_of_keypoints;
   Count _target_number_of_keypoints_per_detector;
+  real _keypoint_target_scale = 1;
   Count _number_of_detected_keypoints;
   Count _number_of_available_points;
 
@@ -77,8 +99,9 @@ protected:
   real _principal_point_offset_v_pixels;
 
   //! @brief grid of detectors (equally distributed over the image with size=number_of_detectors_per_dimension*number_of_detectors_per_dimension)
-  cv::Ptr<cv::FastFeatureDetector>** _detectors = nullptr;
-  real** _detector_thresholds                   = nullptr;
+  //! @brief one grid per image stream, such that streams can be processed concurrently
+  cv::Ptr<cv::FastFeatureDetector>*** _detectors = nullptr;
+  real*** _detector_thresholds                   = nullptr;
 
   //! @brief number of detectors
   //! @brief the same for all image streams
@@ -88,10 +111,19 @@ protected:
   //! @brief the same for all image streams
   cv::Rect** _detector_regions = nullptr;
 
-  //ds descriptor extraction
-  cv::Ptr<cv::DescriptorExtractor> _descriptor_extractor;
+  //ds descriptor extraction (one extractor per image stream)
+  std::vector<cv::Ptr<cv::DescriptorExtractor>> _descriptor_extractors;
+
+  //! @brief width of the extracted descriptors in bits (256 or 512, selects the fixed-width matching kernels)
+  uint32_t _descriptor_size_bits = SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS;
+
+  //! @brief detection resolution (image pyramid level for detection and projective tracking, scale = 2^detection_pyramid_level)
+  int32_t _pyramid_scale            = 1;
+  int32_t _number_of_rows_detection = 0;
+  int32_t _number_of_cols_detection = 0;
 
-  //ds feature density regularization
+  //ds feature density regularization (bin size in full resolution pixels)
+  Count _bin_size_pixels         = 0;
   Count _number_of_rows_bin      = 0;
   Count _number_of_cols_bin      = 0;
   FramePointMatrix _bin_map_left = nullptr;
@@ -106,11 +138,141 @@ protected:
   //! @brief status
   Count _number_of_tracked_landmarks = 0;
 
-private:
-
-  //ds informative only
+  //! @brief motion guess of the upcoming frame, used to predict track locations for lazy detection
+  TransformMatrix3D _camera_left_previous_in_current_guess = TransformMatrix3D::Identity();
+
+  //! @brief motion guess uncertainty (translation, rotation - perturbation in the current camera frame), used for adaptive tracking windows
+  Matrix6 _motion_guess_covariance = Matrix6::Zero();
+
+  //! @brief lazy detection: predicted number of tracks per image stream and detector region (row-major)
+  std::vector<std::vector<Count>> _number_of_predicted_tracks_per_detector;
+
+  //! @brief lazy detection: coarse grid per image stream marking the neighborhoods of predicted tracks (cell size: tracking distance)
+  std::vector<std::vector<bool>> _track_neighborhoods;
+  int32_t _track_neighborhood_cell_size_pixels = 1;
+  int32_t _number_of_rows_track_neighborhoods  = 0;
+  int32_t _number_of_cols_track_neighborhoods  = 0;
+
+  //! @brief lazy detection: keypoints of saturated regions that have not been described, per image stream
+  std::vector<std::vector<cv::KeyPoint>> _deferred_keypoints;
+
+  //! @brief clears all track predictions (no detector region is saturated afterwards)
+  void _resetPredictedTracks();
+
+  //! @brief registers a predicted track location - increments the track count of its detector region and marks its neighborhood
+  //! @param[in] stream_ image stream index
+  //! @param[in] image_coordinates_ predicted location at full resolution
+  //! @param[in] radius_cells_ neighborhood radius in tracking distance cells
+  void _addPredictedTrack(const uint32_t& stream_, const cv::Point2f& image_coordinates_, const int32_t& radius_cells_);
+
+  //! @brief moves keypoints of saturated detector regions which are not close to any predicted track to the deferred keypoints
+  //! @param[in] stream_ image stream index
+  //! @param[in,out] keypoints_ detected keypoints
+  void _deferKeypointsInSaturatedRegions(const uint32_t& stream_, std::vector<cv::KeyPoint>& keypoints_);
+
+  //! @brief checks if a detector region is saturated by predicted tracks
+  inline bool _isSaturated(const uint32_t& stream_, const uint32_t& index_) const {
+    return _number_of_predicted_tracks_per_detector[stream_][index_] >= _parameters->lazy_detection_saturation_ratio*_target_number_of_keypoints_per_detector;
+  }
+
+  //! @brief returns the row-major index of the detector region containing a location at full resolution
+  inline uint32_t _getDetectorIndex(const cv::Point2f& image_coordinates_) const {
+    const int32_t row = std::min(static_cast<int32_t>(image_coordinates_.y/_pyramid_scale*_parameters->number_of_detectors_vertical/_number_of_rows_detection),
+                                 static_cast<int32_t>(_parameters->number_of_detectors_vertical)-1);
+    const int32_t col = std::min(static_cast<int32_t>(image_coordinates_.x/_pyramid_scale*_parameters->number_of_detectors_horizontal/_number_of_cols_detection),
+                                 static_cast<int32_t>(_parameters->number_of_detectors_horizontal)-1);
+    return std::max(row, 0)*_parameters->number_of_detectors_horizontal+std::max(col, 0);
+  }
+
+  //! @brief computes an adaptive projective tracking window for a predicted point by propagating the motion guess uncertainty into the image
+  //! @param[in] point_in_camera_left_ predicted point in the current left camera frame
+  //! @param[in] maximum_distance_pixels_ maximum window half size at full resolution
+  //! @param[out] distance_rows_pixels_ window half height at full resolution
+  //! @param[out] distance_cols_pixels_ window half width at full resolution
+  void _getAdaptiveTrackingDistances(const PointCoordinates& point_in_camera_left_,
+                                     const int32_t& maximum_distance_pixels_,
+                                     int32_t& distance_rows_pixels_,
+                                     int32_t& distance_cols_pixels_) const;
+
+  //! @brief detects keypoints over the complete detector grid of an image stream without timing (safe to call concurrently for different streams)
+  //! @param[in] intensity_image_ complete image
+  //! @param[out] keypoints_ detected keypoints (appended)
+  //! @param[in] stream_ image stream index
+  void _detectKeypoints(const cv::Mat& intensity_image_, std::vector<cv::KeyPoint>& keypoints_, const uint32_t& stream_);
+
+  //! @brief extracts descriptors for an image stream without timing (safe to call concurrently for different streams)
+  //! @param[in] intensity_image_ complete image
+  //! @param[in,out] keypoints_ keypoints to describe (keypoints without descriptor are removed)
+  //! @param[out] descriptors_ extracted descriptors
+  //! @param[in] stream_ image stream index
+  void _computeDescriptors(const cv::Mat& intensity_image_,
+                           std::vector<cv::KeyPoint>& keypoints_,
+                           cv::Mat& descriptors_,
+                           const uint32_t& stream_);
+
+  //! @brief detects keypoints in all image streams at once with the GPU backend, without timing
+  //! @param[in] intensity_images_ complete images, one per image stream
+  //! @param[out] keypoints_ detected keypoints per image stream (appended)
+  void _detectKeypointsOnDevice(const std::vector<const cv::Mat*>& intensity_images_,
+                                const std::vector<std::vector<cv::KeyPoint>*>& keypoints_);
+
+  //! @brief true if keypoint detection is performed by the GPU backend (all image streams in one batch)
+  bool _detection_on_device = false;
+
+  //ds informative only (the stage timings may be measured by subclasses processing streams concurrently)
   CREATE_CHRONOMETER(keypoint_detection)
   CREATE_CHRONOMETER(descriptor_extraction)
 
+private:
+
+  //! @brief detects keypoints in a single detector region and adapts the region's detector threshold
+  //! @param[in] intensity_image_ complete image
+  //! @param[in] stream_ image stream index
+  //! @param[in] row_ detector grid row
+  //! @param[in] col_ detector grid column
+  //! @param[out] keypoints_ detected keypoints in whole image coordinates
+  void _detectKeypointsInRegion(const cv::Mat& intensity_image_,
+                                const uint32_t& stream_,
+                                const uint32_t& row_,
+                                const uint32_t& col_,
+                                std::vector<cv::KeyPoint>& keypoints_);
+
+  //! @brief adapts the threshold of a detector region to the number of keypoints it detected
+  //! @param[in] stream_ image stream index
+  //! @param[in] row_ detector grid row
+  //! @param[in] col_ detector grid column
+  //! @param[in] detector_threshold_current_ threshold used for the detection
+  //! @param[in] number_of_keypoints_ number of keypoints detected in the region
+  void _adaptDetectorThreshold(const uint32_t& stream_,
+                               const uint32_t& row_,
+                               const uint32_t& col_,
+                               const real& detector_threshold_current_,
+                               const Count& number_of_keypoints_);
+
+  //! @brief appends the keypoints of all detector regions of an image stream (in region order) and refines them if required
+  //! @param[in] intensity_image_ full resolution image
+  //! @param[in] stream_ image stream index
+  //! @param[in,out] keypoints_ complete keypoint vector
+  void _mergeKeypoints(const cv::Mat& intensity_image_, const uint32_t& stream_, std::vector<cv::KeyPoint>& keypoints_);
+
+  //! @brief maps keypoints detected on a pyramid level to full resolution and refines their location
+  //! @param[in] intensity_image_ full resolution image
+  //! @param[in,out] keypoints_ keypoints to refine
+  //! @param[in] index_begin_ first keypoint to refine (previous keypoints are already at full resolution)
+  void _refineKeypoints(const cv::Mat& intensity_image_, std::vector<cv::KeyPoint>& keypoints_, const size_t& index_begin_) const;
+
+  //! @brief image pyramid buffers per image stream (levels 1 to detection_pyramid_level)
+  std::vector<std::vector<cv::Mat>> _image_pyramids;
+
+  //! @brief factory for the configured descriptor extractor
+  cv::Ptr<cv::DescriptorExtractor> _createDescriptorExtractor();
+
+  //! @brief keypoint buffers per image stream and detector region (row-major, filled concurrently in detectKeypoints)
+  std::vector<std::vector<std::vector<cv::KeyPoint>>> _keypoints_per_detector;
+
+#ifdef SRRG_PROSLAM_HAS_OPENCV_CUDA
+  //! @brief GPU keypoint detection backend (owned, allocated in configure if selected)
+  CudaKeypointDetector* _cuda_keypoint_detector = nullptr;
+#endif
 };
 } //namespace proslam
@@ -0,0 +1,99 @@
+#include "cuda_keypoint_detector.h"
+
+#ifdef SRRG_PROSLAM_HAS_OPENCV_CUDA
+namespace proslam {
+
+CudaKeypointDetector::CudaKeypointDetector(const uint32_t& number_of_streams_,
+                                           const int32_t& number_of_rows_image_,
+                                           const int32_t& number_of_cols_image_,
+                                           const uint32_t& pyramid_level_,
+                                           cv::Rect** detector_regions_,
+                                           const uint32_t& number_of_detectors_vertical_,
+                                           const uint32_t& number_of_detectors_horizontal_): _number_of_streams(number_of_streams_),
+                                                                                              _number_of_rows_image(number_of_rows_image_),
+                                                                                              _number_of_cols_image(number_of_cols_image_),
+                                                                                              _pyramid_level(pyramid_level_),
+                                                                                              _detector_regions(detector_regions_),
+                                                                                              _number_of_detectors_vertical(number_of_detectors_vertical_),
+                                                                                              _number_of_detectors_horizontal(number_of_detectors_horizontal_) {
+  LOG_INFO(std::cerr << "CudaKeypointDetector::CudaKeypointDetector|constructing" << std::endl)
+  if (cv::cuda::getCudaEnabledDeviceCount() == 0) {
+    throw std::runtime_error("CudaKeypointDetector::CudaKeypointDetector|no CUDA capable device available");
+  }
+
+  //ds allocate stacked image buffers once (all streams are transferred together)
+  _images_host.create(_number_of_streams*_number_of_rows_image, _number_of_cols_image, CV_8UC1);
+  _images_device.create(_number_of_streams*_number_of_rows_image, _number_of_cols_image, CV_8UC1);
+  _image_pyramids_device.resize(_number_of_streams, std::vector<cv::cuda::GpuMat>(_pyramid_level));
+
+  //ds allocate a detector for each region of each stream (thresholds are set before every detection)
+  const uint32_t number_of_detectors = _number_of_detectors_vertical*_number_of_detectors_horizontal;
+  _detectors.resize(_number_of_streams, std::vector<cv::Ptr<cv::cuda::FastFeatureDetector>>(number_of_detectors));
+  _keypoints_device.resize(_number_of_streams, std::vector<cv::cuda::GpuMat>(number_of_detectors));
+  _keypoints_host.resize(_number_of_streams, std::vector<cv::Mat>(number_of_detectors));
+  for (std::vector<cv::Ptr<cv::cuda::FastFeatureDetector>>& detectors: _detectors) {
+    for (cv::Ptr<cv::cuda::FastFeatureDetector>& detector: detectors) {
+      detector = cv::cuda::FastFeatureDetector::create();
+    }
+  }
+  LOG_INFO(std::cerr << "CudaKeypointDetector::CudaKeypointDetector|device: " << cv::cuda::DeviceInfo().name() << std::endl)
+  LOG_INFO(std::cerr << "CudaKeypointDetector::CudaKeypointDetector|constructed" << std::endl)
+}
+
+CudaKeypointDetector::~CudaKeypointDetector() {
+  LOG_INFO(std::cerr << "CudaKeypointDetector::~CudaKeypointDetector|destroying" << std::endl)
+  _stream.waitForCompletion();
+  LOG_INFO(std::cerr << "CudaKeypointDetector::~CudaKeypointDetector|destroyed" << std::endl)
+}
+
+void CudaKeypointDetector::detect(const std::vector<const cv::Mat*>& intensity_images_,
+                                  real*** detector_thresholds_,
+                                  std::vector<std::vector<std::vector<cv::KeyPoint>>>& keypoints_per_detector_) {
+  assert(intensity_images_.size() == _number_of_streams);
+  assert(keypoints_per_detector_.size() == _number_of_streams);
+
+  //ds stack all images in page-locked memory and upload them in a single transfer
+  cv::Mat images_host(_images_host.createMatHeader());
+  for (uint32_t stream = 0; stream < _number_of_streams; ++stream) {
+    intensity_images_[stream]->copyTo(images_host.rowRange(stream*_number_of_rows_image, (stream+1)*_number_of_rows_image));
+  }
+  _images_device.upload(_images_host, _stream);
+
+  //ds enqueue detection in all regions of all streams
+  for (uint32_t stream = 0; stream < _number_of_streams; ++stream) {
+
+    //ds select detection image: full resolution or a downsampled pyramid level (computed on the device)
+    cv::cuda::GpuMat detection_image(_images_device.rowRange(stream*_number_of_rows_image, (stream+1)*_number_of_rows_image));
+    if (_pyramid_level > 0) {
+      std::vector<cv::cuda::GpuMat>& pyramid = _image_pyramids_device[stream];
+      cv::cuda::pyrDown(detection_image, pyramid[0], _stream);
+      for (uint32_t level = 1; level < _pyramid_level; ++level) {
+        cv::cuda::pyrDown(pyramid[level-1], pyramid[level], _stream);
+      }
+      detection_image = pyramid.back();
+    }
+
+    for (uint32_t r = 0; r < _number_of_detectors_vertical; ++r) {
+      for (uint32_t c = 0; c < _number_of_detectors_horizontal; ++c) {
+        const uint32_t index = r*_number_of_detectors_horizontal+c;
+        _detectors[stream][index]->setThreshold(detector_thresholds_[stream][r][c]);
+        _detectors[stream][index]->detectAsync(detection_image(_detector_regions[r][c]), _keypoints_device[stream][index], cv::noArray(), _stream);
+        if (!_keypoints_device[stream][index].empty()) {
+          _keypoints_device[stream][index].download(_keypoints_host[stream][index], _stream);
+        } else {
+          _keypoints_host[stream][index].release();
+        }
+      }
+    }
+  }
+
+  //ds wait for all downloads and convert to OpenCV keypoints
+  _stream.waitForCompletion();
+  for (uint32_t stream = 0; stream < _number_of_streams; ++stream) {
+    for (uint32_t index = 0; index < _detectors[stream].size(); ++index) {
+      _detectors[stream][index]->convert(_keypoints_host[stream][index], keypoints_per_detector_[stream][index]);
+    }
+  }
+}
+} //namespace proslam
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+#include "types/definitions.h"
+
+#ifdef SRRG_PROSLAM_HAS_OPENCV_CUDA
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudafeatures2d.hpp>
+#include <opencv2/cudawarping.hpp>
+
+namespace proslam {
+
+//! @class GPU keypoint detection backend (cv::cuda::FastFeatureDetector) for the detector grid of a framepoint generator
+//! all image streams are uploaded in a single transfer and all detector regions are processed in one CUDA stream
+//! thresholds are owned by the framepoint generator, which keeps the grid-based threshold adaptation independent of the backend
+class CudaKeypointDetector {
+
+//ds object handling
+public:
+
+  //! @brief constructor
+  //! @param[in] number_of_streams_ number of image streams processed in one batch (e.g. 2 for stereo)
+  //! @param[in] number_of_rows_image_ full resolution image rows
+  //! @param[in] number_of_cols_image_ full resolution image cols
+  //! @param[in] pyramid_level_ image pyramid level on which detection is performed (0: full resolution)
+  //! @param[in] detector_regions_ detector regions (at detection resolution)
+  //! @param[in] number_of_detectors_vertical_ detector grid rows
+  //! @param[in] number_of_detectors_horizontal_ detector grid cols
+  CudaKeypointDetector(const uint32_t& number_of_streams_,
+                       const int32_t& number_of_rows_image_,
+                       const int32_t& number_of_cols_image_,
+                       const uint32_t& pyramid_level_,
+                       cv::Rect** detector_regions_,
+                       const uint32_t& number_of_detectors_vertical_,
+                       const uint32_t& number_of_detectors_horizontal_);
+
+  //! @brief destructor
+  ~CudaKeypointDetector();
+
+  //! @brief prohibit copying (owns device memory)
+  CudaKeypointDetector(const CudaKeypointDetector&) = delete;
+  CudaKeypointDetector& operator=(const CudaKeypointDetector&) = delete;
+
+//ds functionality
+public:
+
+  //! @brief detects keypoints in all detector regions of all image streams
+  //! @param[in] intensity_images_ full resolution images, one per stream
+  //! @param[in] detector_thresholds_ FAST thresholds per stream and detector region
+  //! @param[out] keypoints_per_detector_ keypoints per stream and detector region (row-major) in region coordinates
+  void detect(const std::vector<const cv::Mat*>& intensity_images_,
+              real*** detector_thresholds_,
+              std::vector<std::vector<std::vector<cv::KeyPoint>>>& keypoints_per_detector_);
+
+//ds attributes
+protected:
+
+  //! @brief configuration
+  const uint32_t _number_of_streams;
+  const int32_t _number_of_rows_image;
+  const int32_t _number_of_cols_image;
+  const uint32_t _pyramid_level;
+  cv::Rect** _detector_regions;
+  const uint32_t _number_of_detectors_vertical;
+  const uint32_t _number_of_detectors_horizontal;
+
+  //! @brief CUDA stream in which all transfers and detections are enqueued
+  cv::cuda::Stream _stream;
+
+  //! @brief page-locked host image buffer holding all streams stacked vertically (single upload)
+  cv::cuda::HostMem _images_host;
+
+  //! @brief device image buffer holding all streams stacked vertically
+  cv::cuda::GpuMat _images_device;
+
+  //! @brief device image pyramids per stream (levels 1 to pyramid level)
+  std::vector<std::vector<cv::cuda::GpuMat>> _image_pyramids_device;
+
+  //! @brief detectors per stream and region (row-major), each detector owns its keypoint buffers
+  std::vector<std::vector<cv::Ptr<cv::cuda::FastFeatureDetector>>> _detectors;
+
+  //! @brief device and host keypoint buffers per stream and region (row-major)
+  std::vector<std::vector<cv::cuda::GpuMat>> _keypoints_device;
+  std::vector<std::vector<cv::Mat>> _keypoints_host;
+};
+} //namespace proslam
+#endif
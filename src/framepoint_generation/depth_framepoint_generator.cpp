@@ -16,6 +16,29 @@ void DepthFramePointGenerator::configure(){
   //ds update base
   BaseFramePointGenerator::configure();
 
+  //ds precompute depth registration constants: a right pixel [c,r] with depth d maps to d*_rays_right_in_left*[c,r,1]+t in the left camera
+  const TransformMatrix3D right_to_left_transform = _camera_left->robotToCamera()*_camera_right->cameraToRobot();
+  _camera_matrix_left         = _camera_left->cameraMatrix().cast<float>();
+  _inverse_camera_matrix_left = _camera_left->cameraMatrix().inverse().cast<float>();
+  _rays_right_in_left         = (right_to_left_transform.linear()*_camera_right->cameraMatrix().inverse()).cast<float>();
+  _translation_right_to_left  = right_to_left_transform.translation().cast<float>();
+  _col_coordinates            = ArrayRowFloat::LinSpaced(_number_of_cols_image, 0, _number_of_cols_image-1);
+
+  //ds allocate registration buffers once
+  _space_map_left_meters.create(_number_of_rows_image, _number_of_cols_image, CV_32FC3);
+  _row_map.create(_number_of_rows_image, _number_of_cols_image, CV_16SC1);
+  _col_map.create(_number_of_rows_image, _number_of_cols_image, CV_16SC1);
+  if (!_parameters->enable_registered_depth) {
+    _points_x.resize(_number_of_rows_image, _number_of_cols_image);
+    _points_y.resize(_number_of_rows_image, _number_of_cols_image);
+    _points_z.resize(_number_of_rows_image, _number_of_cols_image);
+    _projections_u.resize(_number_of_rows_image, _number_of_cols_image);
+    _projections_v.resize(_number_of_rows_image, _number_of_cols_image);
+    _projection_indices.resize(_number_of_rows_image, _number_of_cols_image);
+  }
+  LOG_INFO(std::cerr << "DepthFramePointGenerator::configure|registered depth: " << _parameters->enable_registered_depth
+                     << " (registration threads: " << _parameters->number_of_registration_threads << ")" << std::endl)
+
   //ds info
   LOG_INFO(std::cerr << "DepthFramePointGenerator::configure|configured" << std::endl)
 }
@@ -29,69 +52,123 @@ void DepthFramePointGenerator::_computeDepthMap(const cv::Mat& right_depth_image
   if (right_depth_image.type()!=CV_16UC1){
     throw std::runtime_error("depth tracker requires a 16bit mono image to encode depth");
   }
-
-  //ds allocate new space map and initialize fields
-  _space_map_left_meters.create(_number_of_rows_image,_number_of_cols_image, CV_32FC3);
-  for (int32_t row = 0; row < _number_of_rows_image; ++row) {
-    for (int32_t col = 0; col < _number_of_cols_image; ++col) {
-      _space_map_left_meters.at<cv::Vec3f>(row, col) = cv::Vec3f(0,0,_maximum_reliable_depth_far_meters);
-    }
+  if (right_depth_image.rows != _number_of_rows_image || right_depth_image.cols != _number_of_cols_image) {
+    throw std::runtime_error("DepthFramePointGenerator::_computeDepthMap|depth image dimensions do not match the intensity image");
   }
 
-  _row_map.create(_number_of_rows_image,_number_of_cols_image, CV_16SC1);
-  _row_map=-1;
-
-  _col_map.create(_number_of_rows_image,_number_of_cols_image, CV_16SC1);
-  _col_map=-1;
-
-  const Matrix3 inverse_camera_matrix_right=_camera_right->cameraMatrix().inverse();
-  const float _depth_pixel_to_meters=1e-3;
+  //ds if the depth image is registered to the left image - every pixel maps onto itself, no reprojection and z-buffering required
+  if (_parameters->enable_registered_depth) {
+    _processRowsInParallel([&](const int32_t& row_begin_, const int32_t& row_end_) {
+      _backprojectRegisteredDepthRows(right_depth_image, row_begin_, row_end_);
+    });
+    return;
+  }
 
-  TransformMatrix3D right_to_left_transform=_camera_left->robotToCamera()*_camera_right->cameraToRobot();
-  for (int32_t r=0; r<_number_of_rows_image; ++r){
-    const unsigned short* raw_depth=right_depth_image.ptr<const unsigned short>(r);
-    for (int32_t c=0; c<_number_of_cols_image; ++c, raw_depth++){
-      if (!*raw_depth)
+  //ds reproject all depth pixels into the left image (independent for each row)
+  _processRowsInParallel([&](const int32_t& row_begin_, const int32_t& row_end_) {
+    _reprojectDepthRows(right_depth_image, row_begin_, row_end_);
+  });
+
+  //ds initialize fields
+  _space_map_left_meters.setTo(cv::Scalar(0, 0, _maximum_reliable_depth_far_meters));
+  _row_map.setTo(-1);
+  _col_map.setTo(-1);
+
+  //ds do z buffering and update indices (sequential in source pixel order, identical to a serial registration)
+  cv::Vec3f* space_map = _space_map_left_meters.ptr<cv::Vec3f>(0);
+  int16_t* row_map     = _row_map.ptr<int16_t>(0);
+  int16_t* col_map     = _col_map.ptr<int16_t>(0);
+  for (int32_t r = 0; r < _number_of_rows_image; ++r) {
+    for (int32_t c = 0; c < _number_of_cols_image; ++c) {
+      const int32_t index = _projection_indices(r, c);
+      if (index < 0) {
         continue;
-      // retrieve depth
-      const float depth_right_meters=(*raw_depth)*_depth_pixel_to_meters;
-      // retrieve point in right camers, meters
-      Vector3 point_in_right_camera_meters=inverse_camera_matrix_right*Vector3(c*depth_right_meters, r*depth_right_meters,depth_right_meters);
-      // map the point to the left camera
-      Vector3 point_in_left_camera_meters=right_to_left_transform*point_in_right_camera_meters;
-      // if beyond camera, discard
-      const real depth_left_meters=point_in_left_camera_meters.z();
-      if (depth_left_meters<=0)
+      }
+      cv::Vec3f& dest_space = space_map[index];
+      if (dest_space[2] > _points_z(r, c)) {
+        dest_space     = cv::Vec3f(_points_x(r, c), _points_y(r, c), _points_z(r, c));
+        row_map[index] = r;
+        col_map[index] = c;
+      }
+    }
+  }
+}
+
+void DepthFramePointGenerator::_reprojectDepthRows(const cv::Mat& right_depth_image, const int32_t& row_begin_, const int32_t& row_end_) {
+  const Eigen::Matrix3f& A = _rays_right_in_left;
+  const Eigen::Vector3f& t = _translation_right_to_left;
+  const Eigen::Matrix3f& K = _camera_matrix_left;
+  ArrayRowFloat depths_meters(_number_of_cols_image);
+  ArrayRowFloat projections_z(_number_of_cols_image);
+  for (int32_t r = row_begin_; r < row_end_; ++r) {
+    const uint16_t* raw_depths = right_depth_image.ptr<const uint16_t>(r);
+    depths_meters = Eigen::Map<const Eigen::Array<uint16_t, 1, Eigen::Dynamic>>(raw_depths, _number_of_cols_image).cast<float>()*_depth_pixel_to_meters;
+
+    //ds points in the left camera, meters (vectorized over the row)
+    _points_x.row(r) = depths_meters*(A(0,0)*_col_coordinates+(A(0,1)*r+A(0,2)))+t(0);
+    _points_y.row(r) = depths_meters*(A(1,0)*_col_coordinates+(A(1,1)*r+A(1,2)))+t(1);
+    _points_z.row(r) = depths_meters*(A(2,0)*_col_coordinates+(A(2,1)*r+A(2,2)))+t(2);
+
+    //ds project to image coordinates
+    projections_z         = K(2,0)*_points_x.row(r)+K(2,1)*_points_y.row(r)+K(2,2)*_points_z.row(r);
+    _projections_u.row(r) = (K(0,0)*_points_x.row(r)+K(0,1)*_points_y.row(r)+K(0,2)*_points_z.row(r))/projections_z;
+    _projections_v.row(r) = (K(1,0)*_points_x.row(r)+K(1,1)*_points_y.row(r)+K(1,2)*_points_z.row(r))/projections_z;
+
+    //ds round to int and discard pixels without depth, beyond the camera or outside the image
+    for (int32_t c = 0; c < _number_of_cols_image; ++c) {
+      _projection_indices(r, c) = -1;
+      if (!raw_depths[c] || _points_z(r, c) <= 0 || projections_z(c) <= 0) {
         continue;
-      // project to image coordinates
-      Vector3 point_in_left_camera_pixels=_camera_left->cameraMatrix()*point_in_left_camera_meters;
-      point_in_left_camera_pixels *= 1./point_in_left_camera_pixels.z();
-
-      // round to int
-      const int32_t dest_r=round(point_in_left_camera_pixels.y());
-      const int32_t dest_c=round(point_in_left_camera_pixels.x());
-
-      // if outside skip
-      if (dest_r<0 ||
-          dest_r>=_number_of_rows_image ||
-          dest_c<0 ||
-          dest_c>=_number_of_cols_image)
+      }
+      const int32_t dest_r = std::round(_projections_v(r, c));
+      const int32_t dest_c = std::round(_projections_u(r, c));
+      if (dest_r < 0 || dest_r >= _number_of_rows_image || dest_c < 0 || dest_c >= _number_of_cols_image) {
         continue;
-
-      // do z buffering and update indices
-      cv::Vec3f& dest_space=_space_map_left_meters.at<cv::Vec3f>(dest_r, dest_c);
-
-      if (dest_space[2] > depth_left_meters){
-        dest_space=cv::Vec3f(point_in_left_camera_meters.x(),
-                             point_in_left_camera_meters.y(),
-                             point_in_left_camera_meters.z());
-        _row_map.at<unsigned short>(dest_r, dest_c)=r;
-        _col_map.at<unsigned short>(dest_r, dest_c)=c;
       }
+      _projection_indices(r, c) = dest_r*_number_of_cols_image+dest_c;
     }
   }
 }
 
+void DepthFramePointGenerator::_backprojectRegisteredDepthRows(const cv::Mat& right_depth_image, const int32_t& row_begin_, const int32_t& row_end_) {
+  typedef Eigen::Map<ArrayRowFloat, 0, Eigen::InnerStride<3>> ChannelMap;
+  typedef Eigen::Array<int16_t, 1, Eigen::Dynamic> ArrayRowIndex;
+  const Eigen::Matrix3f& K_inverse = _inverse_camera_matrix_left;
+  const ArrayRowIndex col_indices  = _col_coordinates.cast<int16_t>();
+  ArrayRowFloat depths_meters(_number_of_cols_image);
+  Eigen::Array<bool, 1, Eigen::Dynamic> valid(_number_of_cols_image);
+  for (int32_t r = row_begin_; r < row_end_; ++r) {
+    const Eigen::Map<const Eigen::Array<uint16_t, 1, Eigen::Dynamic>> raw_depths(right_depth_image.ptr<const uint16_t>(r), _number_of_cols_image);
+    depths_meters = raw_depths.cast<float>()*_depth_pixel_to_meters;
+    valid         = (depths_meters > 0.0f);
+
+    //ds write the space map channels directly (pixels without depth are set to the far plane as in the reprojection)
+    float* space_map = _space_map_left_meters.ptr<float>(r);
+    ChannelMap(space_map, _number_of_cols_image)   = valid.select(depths_meters*(K_inverse(0,0)*_col_coordinates+(K_inverse(0,1)*r+K_inverse(0,2))), 0.0f);
+    ChannelMap(space_map+1, _number_of_cols_image) = valid.select(depths_meters*(K_inverse(1,0)*_col_coordinates+(K_inverse(1,1)*r+K_inverse(1,2))), 0.0f);
+    ChannelMap(space_map+2, _number_of_cols_image) = valid.select(depths_meters*(K_inverse(2,0)*_col_coordinates+(K_inverse(2,1)*r+K_inverse(2,2))),
+                                                                              static_cast<float>(_maximum_reliable_depth_far_meters));
+
+    //ds every valid pixel corresponds to itself
+    Eigen::Map<ArrayRowIndex>(_row_map.ptr<int16_t>(r), _number_of_cols_image) = valid.select(ArrayRowIndex::Constant(_number_of_cols_image, r), -1);
+    Eigen::Map<ArrayRowIndex>(_col_map.ptr<int16_t>(r), _number_of_cols_image) = valid.select(col_indices, -1);
+  }
+}
+
+void DepthFramePointGenerator::_processRowsInParallel(const std::function<void(const int32_t&, const int32_t&)>& process_rows_) {
+  const int32_t number_of_workers = std::max(std::min(static_cast<int32_t>(_parameters->number_of_registration_threads), _number_of_rows_image), 1);
+  if (number_of_workers == 1) {
+    process_rows_(0, _number_of_rows_image);
+    return;
+  }
+
+  //ds each task processes a contiguous band of rows
+  runTasks(_worker_pool, number_of_workers, [&](const Index& index_task_) {
+    const int32_t worker_index = index_task_;
+    process_rows_(worker_index*_number_of_rows_image/number_of_workers, (worker_index+1)*_number_of_rows_image/number_of_workers);
+  });
+}
+
 void DepthFramePointGenerator::initialize(Frame* frame_, const bool& extract_features_) {
   //ds TODO
 }
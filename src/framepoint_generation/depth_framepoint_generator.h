@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include "base_framepoint_generator.h"
 
 namespace proslam {
@@ -25,10 +26,33 @@ public:
 
   inline void setCameraRight(const Camera* camera_right_) {_camera_right = camera_right_;}
 
+//ds exported types
+public:
+
+  //! @brief row-major float and index buffers for the depth registration (contiguous rows for SIMD processing)
+  typedef Eigen::Array<float, 1, Eigen::Dynamic> ArrayRowFloat;
+  typedef Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> ArrayFloat;
+  typedef Eigen::Array<int32_t, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> ArrayIndex;
+
 protected:
 
   void _computeDepthMap(const cv::Mat& right_depth_image);
 
+  //! @brief reprojects a band of depth image rows into the left camera (no z-buffering, safe to call concurrently for disjoint bands)
+  //! @param[in] right_depth_image depth image
+  //! @param[in] row_begin_ first row of the band
+  //! @param[in] row_end_ end of the band (exclusive)
+  void _reprojectDepthRows(const cv::Mat& right_depth_image, const int32_t& row_begin_, const int32_t& row_end_);
+
+  //! @brief computes the space map for a band of rows of a depth image that is registered to the left image (no reprojection)
+  //! @param[in] right_depth_image registered depth image
+  //! @param[in] row_begin_ first row of the band
+  //! @param[in] row_end_ end of the band (exclusive)
+  void _backprojectRegisteredDepthRows(const cv::Mat& right_depth_image, const int32_t& row_begin_, const int32_t& row_end_);
+
+  //! @brief distributes a row band function over the configured number of registration threads (bands run on the worker pool)
+  void _processRowsInParallel(const std::function<void(const int32_t&, const int32_t&)>& process_rows_);
+
 //ds settings
 protected:
 
@@ -41,6 +65,22 @@ protected:
   cv::Mat _row_map;               // row index in the depth image(right) corresponding to the pixel ar [r,c] in left image
   cv::Mat _col_map;               // col index in the depth image(right) corresponding to the pixel ar [r,c] in left image
 
+  //ds depth registration constants (single precision for vectorized processing)
+  const float _depth_pixel_to_meters = 1e-3;
+  Eigen::Matrix3f _camera_matrix_left;
+  Eigen::Matrix3f _inverse_camera_matrix_left;
+  Eigen::Matrix3f _rays_right_in_left;        // rotation right to left times inverse right camera matrix
+  Eigen::Vector3f _translation_right_to_left;
+  ArrayRowFloat _col_coordinates;             // 0, 1, .., number of image cols-1
+
+  //ds depth registration buffers for every pixel of the depth image (reused between frames)
+  ArrayFloat _points_x;
+  ArrayFloat _points_y;
+  ArrayFloat _points_z;
+  ArrayFloat _projections_u;
+  ArrayFloat _projections_v;
+  ArrayIndex _projection_indices; // linear pixel index in the left image (-1 if invalid)
+
 private:
 
   //ds informative only
@@ -12,14 +12,8 @@ IntensityFeatureMatcher::IntensityFeatureMatcher() {
 
 IntensityFeatureMatcher::~IntensityFeatureMatcher() {
   LOG_INFO(std::cerr << "IntensityFeatureMatcher::~IntensityFeatureMatcher|destroying" << std::endl)
-  for (int32_t r = 0; r < number_of_rows; ++r) {
-    delete[] feature_lattice[r];
-  }
-  delete[] feature_lattice;
-  for (IntensityFeature* feature: feature_vector) {
-    delete feature;
-  }
   feature_vector.clear();
+  _feature_pool.clear();
   LOG_INFO(std::cerr << "IntensityFeatureMatcher::~IntensityFeatureMatcher|destroyed" << std::endl)
 }
 
@@ -28,20 +22,23 @@ void IntensityFeatureMatcher::configure(const int32_t& rows_, const int32_t& col
   if (rows_ <= 0 || cols_ <= 0) {
     throw std::runtime_error("KeypointWithDescriptorLattice::configure|invalid image dimensions");
   }
-  if (feature_lattice) {
+  if (!_feature_cells.empty()) {
     throw std::runtime_error("KeypointWithDescriptorLattice::configure|lattice already allocated");
   }
+  if (cell_size_pixels <= 0) {
+    throw std::runtime_error("KeypointWithDescriptorLattice::configure|invalid cell size");
+  }
 
   //ds initialize empty lattice
-  feature_lattice = new IntensityFeature**[rows_];
-  for (int32_t r = 0; r < rows_; ++r) {
-    feature_lattice[r] = new IntensityFeature*[cols_];
-    for (int32_t c = 0; c < cols_; ++c) {
-      feature_lattice[r][c] = nullptr;
-    }
-  }
-  number_of_rows = rows_;
-  number_of_cols = cols_;
+  number_of_rows        = rows_;
+  number_of_cols        = cols_;
+  _number_of_rows_cells = (rows_+cell_size_pixels-1)/cell_size_pixels;
+  _number_of_cols_cells = (cols_+cell_size_pixels-1)/cell_size_pixels;
+  _feature_cells.resize(_number_of_rows_cells*_number_of_cols_cells);
+  _occupied_cells.clear();
+  _row_offsets.resize(number_of_rows+1, 0);
+  LOG_INFO(std::cerr << "IntensityFeatureMatcher::configure|lattice cells: " << _number_of_rows_cells << "x" << _number_of_cols_cells
+                     << " (size: " << cell_size_pixels << " pixels)" << std::endl)
   LOG_INFO(std::cerr << "IntensityFeatureMatcher::configure|configured" << std::endl)
 }
 
@@ -50,29 +47,87 @@ void IntensityFeatureMatcher::setFeatures(const std::vector<cv::KeyPoint>& keypo
     throw std::runtime_error("KeypointWithDescriptorLattice::setFeatures|mismatching keypoints and descriptor numbers");
   }
 
-  //ds clear the lattice - freeing remaining features
-  for (int32_t r = 0; r < number_of_rows; ++r) {
-    for (int32_t c = 0; c < number_of_cols; ++c) {
-      feature_lattice[r][c] = nullptr;
-    }
+  //ds clear the lattice (only occupied cells)
+  for (const size_t& index_cell: _occupied_cells) {
+    _feature_cells[index_cell].clear();
   }
-  for (IntensityFeature* feature: feature_vector) {
-    delete feature;
+  _occupied_cells.clear();
+
+  //ds recycle features of the previous call - the pool only grows if more keypoints than ever before are provided
+  if (_feature_pool.size() < keypoints_.size()) {
+    _feature_pool.resize(keypoints_.size());
   }
 
   //ds fill in features
   feature_vector.resize(keypoints_.size());
   for (uint32_t index = 0; index < keypoints_.size(); ++index) {
-    IntensityFeature* feature = new IntensityFeature(keypoints_[index], descriptors_.row(index), index);
-    feature_vector[index] = feature;
-    feature_lattice[feature->row][feature->col] = feature;
+    IntensityFeature* feature = &_feature_pool[index];
+    feature->keypoint         = keypoints_[index];
+    feature->descriptor       = descriptors_.row(index);
+    feature->row              = keypoints_[index].pt.y;
+    feature->col              = keypoints_[index].pt.x;
+    feature->index_in_vector  = index;
+    feature->matched          = false;
+    feature_vector[index]     = feature;
+
+    //ds add the feature to its lattice cell - a feature at an already occupied pixel replaces the previous one
+    IntensityFeaturePointerVector& cell = _feature_cells[_getCellIndex(feature->row, feature->col)];
+    if (cell.empty()) {
+      _occupied_cells.push_back(_getCellIndex(feature->row, feature->col));
+    }
+    bool replaced = false;
+    for (IntensityFeature*& feature_in_cell: cell) {
+      if (feature_in_cell->row == feature->row && feature_in_cell->col == feature->col) {
+        feature_in_cell = feature;
+        replaced        = true;
+        break;
+      }
+    }
+    if (!replaced) {
+      cell.push_back(feature);
+    }
   }
+
+  //ds pack descriptors for fast distance computation
+  descriptors.setDescriptors(descriptors_);
 }
 
 void IntensityFeatureMatcher::sortFeatureVector() {
   std::sort(feature_vector.begin(), feature_vector.end(),  [](const IntensityFeature* a_, const IntensityFeature* b_){
     return ((a_->row < b_->row) || (a_->row == b_->row && a_->col < b_->col));
   });
+
+  //ds reorder descriptors to match the sorted vector (enables contiguous scans over a row) and update the inverted indices
+  _descriptors_buffer.setDescriptorSizeBits(descriptors.descriptorSizeBits());
+  _descriptors_buffer.resize(feature_vector.size());
+  const size_t descriptor_size_bytes = descriptors.descriptorSizeBits()/8;
+  for (size_t index = 0; index < feature_vector.size(); ++index) {
+    std::memcpy(_descriptors_buffer.descriptor(index), descriptors.descriptor(feature_vector[index]->index_in_vector), descriptor_size_bytes);
+    feature_vector[index]->index_in_vector = index;
+  }
+  descriptors.swap(_descriptors_buffer);
+
+  //ds build row index over the sorted vector
+  uint32_t index_feature = 0;
+  for (int32_t row = 0; row <= number_of_rows; ++row) {
+    _row_offsets[row] = index_feature;
+    while (index_feature < feature_vector.size() && feature_vector[index_feature]->row == row) {
+      ++index_feature;
+    }
+  }
+}
+
+void IntensityFeatureMatcher::removeFeatureFromLattice(const IntensityFeature* feature_) {
+  IntensityFeaturePointerVector& cell = _feature_cells[_getCellIndex(feature_->row, feature_->col)];
+  for (size_t index = 0; index < cell.size(); ++index) {
+    if (cell[index] == feature_) {
+
+      //ds order inside a cell is irrelevant for the search (ties are resolved by location)
+      cell[index] = cell.back();
+      cell.pop_back();
+      return;
+    }
+  }
 }
 
 IntensityFeature* IntensityFeatureMatcher::getMatchingFeatureInRectangularRegion(const int32_t& row_reference_,
@@ -86,22 +141,42 @@ IntensityFeature* IntensityFeatureMatcher::getMatchingFeatureInRectangularRegion
                                                                                  const bool track_by_appearance_,
                                                                                  real& descriptor_distance_best_) {
   descriptor_distance_best_ = maximum_descriptor_distance_tracking_;
-  int32_t row_best = -1;
-  int32_t col_best = -1;
+  IntensityFeature* feature_best = nullptr;
+  if (row_start_point >= row_end_point || col_start_point >= col_end_point) {
+    return feature_best;
+  }
+
+  //ds raw reference descriptor for packed distance computations against the arena
+  const uint8_t* descriptor_reference = descriptor_reference_.ptr<uint8_t>(0);
+
+  //ds lattice cells overlapping with the search region
+  const int32_t row_start_cell = row_start_point/cell_size_pixels;
+  const int32_t row_end_cell   = (row_end_point-1)/cell_size_pixels+1;
+  const int32_t col_start_cell = col_start_point/cell_size_pixels;
+  const int32_t col_end_cell   = (col_end_point-1)/cell_size_pixels+1;
+
+  //ds ties are resolved in favor of the first feature in row-major pixel order (identical to an exhaustive pixel scan)
+  auto isBefore = [](const IntensityFeature* a_, const IntensityFeature* b_) {
+    return (a_->row < b_->row || (a_->row == b_->row && a_->col < b_->col));
+  };
 
   //ds locate best match in appearance
   if (track_by_appearance_) {
-    for (int32_t row = row_start_point; row < row_end_point; ++row) {
-      for (int32_t col = col_start_point; col < col_end_point; ++col) {
-        if (feature_lattice[row][col]) {
-          const real descriptor_distance = cv::norm(descriptor_reference_,
-                                                    feature_lattice[row][col]->descriptor,
-                                                    SRRG_PROSLAM_DESCRIPTOR_NORM);
-
-          if (descriptor_distance < descriptor_distance_best_) {
+    for (int32_t row_cell = row_start_cell; row_cell < row_end_cell; ++row_cell) {
+      for (int32_t col_cell = col_start_cell; col_cell < col_end_cell; ++col_cell) {
+        for (IntensityFeature* feature: _feature_cells[row_cell*_number_of_cols_cells+col_cell]) {
+
+          //ds skip features outside of the search region
+          if (feature->row < row_start_point || feature->row >= row_end_point ||
+              feature->col < col_start_point || feature->col >= col_end_point) {
+            continue;
+          }
+          const real descriptor_distance = descriptors.getDistance(descriptor_reference, feature->index_in_vector);
+
+          if (descriptor_distance < descriptor_distance_best_ ||
+             (feature_best && descriptor_distance == descriptor_distance_best_ && isBefore(feature, feature_best))) {
             descriptor_distance_best_ = descriptor_distance;
-            row_best = row;
-            col_best = col;
+            feature_best              = feature;
           }
         }
       }
@@ -109,55 +184,56 @@ IntensityFeature* IntensityFeatureMatcher::getMatchingFeatureInRectangularRegion
 
   //ds locate best match in projection error, within maximum appearance distance
   } else {
-    uint32_t projection_distance_pixels_best = 10000;
-    for (int32_t row = row_start_point; row < row_end_point; ++row) {
-      for (int32_t col = col_start_point; col < col_end_point; ++col) {
-        if (feature_lattice[row][col]) {
-          const real descriptor_distance = cv::norm(descriptor_reference_,
-                                                    feature_lattice[row][col]->descriptor,
-                                                    SRRG_PROSLAM_DESCRIPTOR_NORM);
+    int32_t projection_distance_pixels_best = 10000;
+    for (int32_t row_cell = row_start_cell; row_cell < row_end_cell; ++row_cell) {
+      for (int32_t col_cell = col_start_cell; col_cell < col_end_cell; ++col_cell) {
+        for (IntensityFeature* feature: _feature_cells[row_cell*_number_of_cols_cells+col_cell]) {
+
+          //ds skip features outside of the search region
+          if (feature->row < row_start_point || feature->row >= row_end_point ||
+              feature->col < col_start_point || feature->col >= col_end_point) {
+            continue;
+          }
+          const real descriptor_distance = descriptors.getDistance(descriptor_reference, feature->index_in_vector);
           if (descriptor_distance < maximum_descriptor_distance_tracking_) {
 
             //ds compute projection distance
-            const uint32_t row_distance_pixels        = row_reference_-row;
-            const uint32_t col_distance_pixels        = col_reference_-col;
-            const uint32_t projection_distance_pixels = row_distance_pixels*row_distance_pixels+col_distance_pixels*col_distance_pixels;
+            const int32_t row_distance_pixels        = row_reference_-feature->row;
+            const int32_t col_distance_pixels        = col_reference_-feature->col;
+            const int32_t projection_distance_pixels = row_distance_pixels*row_distance_pixels+col_distance_pixels*col_distance_pixels;
 
             //ds if better than best so far
-            if (projection_distance_pixels < projection_distance_pixels_best) {
+            if (projection_distance_pixels < projection_distance_pixels_best ||
+               (feature_best && projection_distance_pixels == projection_distance_pixels_best && isBefore(feature, feature_best))) {
               projection_distance_pixels_best = projection_distance_pixels;
               descriptor_distance_best_       = descriptor_distance;
-              row_best = row;
-              col_best = col;
+              feature_best                    = feature;
             }
           }
         }
       }
     }
   }
-
-  //ds if we found a match
-  if (row_best != -1) {
-    return feature_lattice[row_best][col_best];
-  } else {
-    return nullptr;
-  }
+  return feature_best;
 }
 
-void IntensityFeatureMatcher::prune(const std::set<uint32_t>& matched_indices_) {
+void IntensityFeatureMatcher::prune() {
 
-  //ds remove matched indices from candidate pools
+  //ds remove matched features from candidate pools
   size_t number_of_unmatched_elements = 0;
   for (size_t index = 0; index < feature_vector.size(); ++index) {
 
-    //ds if we haven't matched this index yet
-    if (matched_indices_.count(index) == 0) {
+    //ds if we haven't matched this feature yet
+    if (!feature_vector[index]->matched) {
 
       //ds keep the element (this operation is not problemenatic since we do not loop reversely here)
       feature_vector[number_of_unmatched_elements] = feature_vector[index];
+      feature_vector[number_of_unmatched_elements]->index_in_vector = number_of_unmatched_elements;
+      descriptors.copy(index, number_of_unmatched_elements);
       ++number_of_unmatched_elements;
     }
   }
   feature_vector.resize(number_of_unmatched_elements);
+  descriptors.resize(number_of_unmatched_elements);
 }
 } //namespace proslam
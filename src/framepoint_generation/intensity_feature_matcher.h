@@ -1,6 +1,7 @@
 #pragma once
 #include "intensity_feature_extractor.h"
 #include "types/frame_point.h"
+#include "types/descriptor_arena.h"
 
 
 
@@ -21,9 +22,23 @@ public:
   //ds create features from keypoints and descriptors
   void setFeatures(const std::vector<cv::KeyPoint>& keypoints_, const cv::Mat& descriptors_);
 
-  //ds sort all input vectors by ascending row positions (preparation for stereo matching)
+  //ds sort all input vectors by ascending row positions and build the row index (preparation for stereo matching) - the descriptor arena is reordered accordingly
   void sortFeatureVector();
 
+  //ds obtains the range [index_begin_, index_end_) of features located in row_ in the sorted feature vector (valid until the next prune)
+  inline void getRowRange(const int32_t& row_, uint32_t& index_begin_, uint32_t& index_end_) const {
+    if (row_ < 0 || row_ >= number_of_rows) {
+      index_begin_ = 0;
+      index_end_   = 0;
+    } else {
+      index_begin_ = _row_offsets[row_];
+      index_end_   = _row_offsets[row_+1];
+    }
+  }
+
+  //ds removes a feature from the feature lattice (e.g. after a successful match) - it remains in the feature vector until prune
+  void removeFeatureFromLattice(const IntensityFeature* feature_);
+
   //ds performs a local search in a rectangular area on the feature lattice
   IntensityFeature* getMatchingFeatureInRectangularRegion(const int32_t& row_reference_,
                                                           const int32_t& col_reference_,
@@ -36,8 +51,8 @@ public:
                                                           const bool track_by_appearance_,
                                                           real& descriptor_distance_best_);
 
-  //ds prunes features from feature vector if existing
-  void prune(const std::set<uint32_t>& matched_indices_);
+  //ds prunes matched features from feature vector (compacts the descriptor arena)
+  void prune();
 
 //ds attributes
 public:
@@ -45,7 +60,36 @@ public:
   int32_t number_of_rows = 0;
   int32_t number_of_cols = 0;
   IntensityFeaturePointerVector feature_vector;
-  IntensityFeature*** feature_lattice = nullptr;
 
+  //! @brief edge length of a feature lattice cell in pixels (set before configure)
+  int32_t cell_size_pixels = 8;
+
+  //! @brief packed descriptors in feature vector order: descriptors.descriptor(i) belongs to feature_vector[i] (i = index_in_vector)
+  DescriptorArena descriptors;
+
+private:
+
+  //! @brief returns the lattice cell index for a pixel
+  inline const size_t _getCellIndex(const int32_t& row_, const int32_t& col_) const {
+    return (row_/cell_size_pixels)*_number_of_cols_cells+col_/cell_size_pixels;
+  }
+
+  //! @brief sparse feature lattice: coarse grid of cells (row-major) holding the features located in the cell
+  //! cell buffers keep their capacity, such that a steady state does not allocate
+  std::vector<IntensityFeaturePointerVector> _feature_cells;
+  int32_t _number_of_rows_cells = 0;
+  int32_t _number_of_cols_cells = 0;
+
+  //! @brief indices of all non-empty cells (clearing the lattice is proportional to the number of features, not the image size)
+  std::vector<size_t> _occupied_cells;
+
+  //! @brief feature storage, recycled in each setFeatures call (features are valid until the next call)
+  std::vector<IntensityFeature> _feature_pool;
+
+  //! @brief row index of the sorted feature vector: features of row r are located in [_row_offsets[r], _row_offsets[r+1])
+  std::vector<uint32_t> _row_offsets;
+
+  //! @brief reordering buffer for sortFeatureVector
+  DescriptorArena _descriptors_buffer;
 };
 } //namespace proslam
@@ -16,6 +16,12 @@ void StereoFramePointGenerator::configure(){
   _parameters->number_of_cameras = 2;
   BaseFramePointGenerator::configure();
 
+  //ds derive unset triangulation thresholds from the extracted descriptor width
+  if (_parameters->maximum_matching_distance_triangulation < 0) {
+    _parameters->maximum_matching_distance_triangulation = 0.2*_descriptor_size_bits;
+  }
+  _current_maximum_descriptor_distance_triangulation = 0.1*_descriptor_size_bits;
+
   //ds set initial tracking distance (changes at runtime)
   _projection_tracking_distance_pixels = _parameters->maximum_projection_tracking_distance_pixels;
 
@@ -34,7 +40,8 @@ void StereoFramePointGenerator::configure(){
   _c_y = _camera_right->cameraMatrix()(1,2);
   _b_x = _baseline_pixelsmeters;
 
-  //ds initialize feature matcher
+  //ds initialize feature matcher (lattice at detection resolution, see BaseFramePointGenerator::configure)
+  _feature_matcher_right.cell_size_pixels *= _pyramid_scale;
   _feature_matcher_right.configure(_number_of_rows_image, _number_of_cols_image);
 
   //ds configure epipolar search ranges (minimum 0)
@@ -66,20 +73,37 @@ void StereoFramePointGenerator::initialize(Frame* frame_, const bool& extract_fe
   //ds check if a new feature extraction is desired (the frame might already be set up)
   if (extract_features_) {
 
-    //ds detect new features to generate frame points from (fixed thresholds)
-    detectKeypoints(frame_->intensityImageLeft(), frame_->keypointsLeft());
-    detectKeypoints(frame_->intensityImageRight(), frame_->keypointsRight());
-
-    //ds adjust detector thresholds for next frame
-    adjustDetectorThresholds();
+    _deferred_keypoints[0].clear();
+    _deferred_keypoints[1].clear();
+
+    //ds pipelined processing: take over the features that have been extracted ahead (the detection state belongs to the extracting thread)
+    if (_precomputed_features) {
+      frame_->keypointsLeft().swap(_precomputed_features->keypoints_left);
+      frame_->keypointsRight().swap(_precomputed_features->keypoints_right);
+      frame_->descriptorsLeft()  = _precomputed_features->descriptors_left;
+      frame_->descriptorsRight() = _precomputed_features->descriptors_right;
+      _precomputed_features->descriptors_left.release();
+      _precomputed_features->descriptors_right.release();
+      _number_of_detected_keypoints = _precomputed_features->number_of_detected_keypoints;
+      _precomputed_features = nullptr;
+    } else {
 
-    //ds overwrite with average
-    _number_of_detected_keypoints = (frame_->keypointsLeft().size()+frame_->keypointsRight().size())/2.0;
+      //ds lazy detection: predict track locations in both images to determine saturated detector regions (affects threshold adaptation)
+      const bool lazy_detection = (_parameters->enable_lazy_detection && frame_->status() == Frame::Tracking && frame_->previous());
+      _resetPredictedTracks();
+      if (lazy_detection) {
+        _predictTracks(frame_->previous());
+      }
+      _extractFeatures(frame_->intensityImageLeft(),
+                       frame_->intensityImageRight(),
+                       frame_->keypointsLeft(),
+                       frame_->keypointsRight(),
+                       frame_->descriptorsLeft(),
+                       frame_->descriptorsRight(),
+                       _number_of_detected_keypoints,
+                       lazy_detection);
+    }
     frame_->_number_of_detected_keypoints = _number_of_detected_keypoints;
-
-    //ds extract descriptors for detected features
-    computeDescriptors(frame_->intensityImageLeft(), frame_->keypointsLeft(), frame_->descriptorsLeft());
-    computeDescriptors(frame_->intensityImageRight(), frame_->keypointsRight(), frame_->descriptorsRight());
     LOG_DEBUG(std::cerr << "StereoFramePointGenerator::initialize|extracted features L: " << frame_->keypointsLeft().size()
                         << " R: " << frame_->keypointsRight().size() << std::endl)
 
@@ -87,20 +111,139 @@ void StereoFramePointGenerator::initialize(Frame* frame_, const bool& extract_fe
     if (frame_->status() == Frame::Localizing) {
 
       //ds be conservative while localizing
-      _current_maximum_descriptor_distance_triangulation = 0.1*SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS;
+      _current_maximum_descriptor_distance_triangulation = 0.1*_descriptor_size_bits;
     } else {
 
       //ds adjust triangulation distance: few point > narrow window as we cannot permit invalid triangulations
-      const real ratio_available_points = std::min(static_cast<real>(_number_of_detected_keypoints)/_target_number_of_keypoints, 1.0);
-      _current_maximum_descriptor_distance_triangulation = std::max(ratio_available_points*_parameters->maximum_matching_distance_triangulation, 0.1*SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS);
+      const real ratio_available_points = std::min(static_cast<real>(_number_of_detected_keypoints)/scaledTargetNumberOfKeypoints(), static_cast<real>(1));
+      _current_maximum_descriptor_distance_triangulation = std::max(ratio_available_points*_parameters->maximum_matching_distance_triangulation, static_cast<real>(0.1*_descriptor_size_bits));
     }
   }
 
+  //ds if the frame is set up again (e.g. for tracking by appearance) - all deferred keypoints are required
+  else if (!_deferred_keypoints[0].empty() || !_deferred_keypoints[1].empty()) {
+    _describeDeferredKeypoints(frame_->intensityImageLeft(), 0, frame_->keypointsLeft(), frame_->descriptorsLeft());
+    _describeDeferredKeypoints(frame_->intensityImageRight(), 1, frame_->keypointsRight(), frame_->descriptorsRight());
+  }
+
   //ds initialize matchers for left and right frame
   _feature_matcher_left.setFeatures(frame_->keypointsLeft(), frame_->descriptorsLeft());
   _feature_matcher_right.setFeatures(frame_->keypointsRight(), frame_->descriptorsRight());
 }
 
+void StereoFramePointGenerator::extractFeatures(const cv::Mat& intensity_image_left_,
+                                                const cv::Mat& intensity_image_right_,
+                                                StereoFeatures& features_) {
+  features_.keypoints_left.clear();
+  features_.keypoints_right.clear();
+  const double time_consumption_seconds_keypoint_detection    = _time_consumption_seconds_keypoint_detection;
+  const double time_consumption_seconds_descriptor_extraction = _time_consumption_seconds_descriptor_extraction;
+  _extractFeatures(intensity_image_left_,
+                   intensity_image_right_,
+                   features_.keypoints_left,
+                   features_.keypoints_right,
+                   features_.descriptors_left,
+                   features_.descriptors_right,
+                   features_.number_of_detected_keypoints,
+                   false);
+  features_.duration_keypoint_detection_seconds    = _time_consumption_seconds_keypoint_detection-time_consumption_seconds_keypoint_detection;
+  features_.duration_descriptor_extraction_seconds = _time_consumption_seconds_descriptor_extraction-time_consumption_seconds_descriptor_extraction;
+}
+
+void StereoFramePointGenerator::_extractFeatures(const cv::Mat& intensity_image_left_,
+                                                 const cv::Mat& intensity_image_right_,
+                                                 std::vector<cv::KeyPoint>& keypoints_left_,
+                                                 std::vector<cv::KeyPoint>& keypoints_right_,
+                                                 cv::Mat& descriptors_left_,
+                                                 cv::Mat& descriptors_right_,
+                                                 Count& number_of_detected_keypoints_,
+                                                 const bool& lazy_detection_) {
+
+  //ds detect new features to generate frame points from (fixed thresholds)
+  CHRONOMETER_START(keypoint_detection)
+  if (_detection_on_device) {
+
+    //ds both images are uploaded and processed in one batch on the GPU
+    _detectKeypointsOnDevice({&intensity_image_left_, &intensity_image_right_}, {&keypoints_left_, &keypoints_right_});
+  } else if (_parameters->enable_concurrent_stream_processing) {
+
+    //ds one task per stream (each stream has its own detectors)
+    runTasks(_worker_pool, 2, [&](const Index& stream_) {
+      _detectKeypoints((stream_ == 0)? intensity_image_left_: intensity_image_right_, (stream_ == 0)? keypoints_left_: keypoints_right_, stream_);
+    });
+  } else {
+    _detectKeypoints(intensity_image_left_, keypoints_left_, 0);
+    _detectKeypoints(intensity_image_right_, keypoints_right_, 1);
+  }
+  CHRONOMETER_STOP(keypoint_detection)
+
+  //ds adjust detector thresholds for next frame
+  adjustDetectorThresholds();
+
+  //ds overwrite with average
+  number_of_detected_keypoints_ = (keypoints_left_.size()+keypoints_right_.size())/2.0;
+
+  //ds lazy detection: keypoints in saturated regions far from any predicted track are not described
+  if (lazy_detection_) {
+    _deferKeypointsInSaturatedRegions(0, keypoints_left_);
+    _deferKeypointsInSaturatedRegions(1, keypoints_right_);
+    LOG_DEBUG(std::cerr << "StereoFramePointGenerator::_extractFeatures|deferred keypoints L: " << _deferred_keypoints[0].size()
+                        << " R: " << _deferred_keypoints[1].size() << std::endl)
+  }
+
+  //ds extract descriptors for detected features
+  CHRONOMETER_START(descriptor_extraction)
+  if (_parameters->enable_concurrent_stream_processing) {
+
+    //ds one task per stream (each stream has its own descriptor extractor)
+    runTasks(_worker_pool, 2, [&](const Index& stream_) {
+      _computeDescriptors((stream_ == 0)? intensity_image_left_: intensity_image_right_,
+                          (stream_ == 0)? keypoints_left_: keypoints_right_,
+                          (stream_ == 0)? descriptors_left_: descriptors_right_,
+                          stream_);
+    });
+  } else {
+    _computeDescriptors(intensity_image_left_, keypoints_left_, descriptors_left_, 0);
+    _computeDescriptors(intensity_image_right_, keypoints_right_, descriptors_right_, 1);
+  }
+  CHRONOMETER_STOP(descriptor_extraction)
+}
+
+void StereoFramePointGenerator::_predictTracks(const Frame* frame_previous_) {
+  const Matrix3& camera_calibration_matrix = _camera_left->cameraMatrix();
+
+  //ds project all previous points with the motion guess (as done for tracking)
+  for (const FramePoint* point_previous: frame_previous_->points()) {
+    const Vector3 point_in_camera_left_prediction(_camera_left_previous_in_current_guess*point_previous->cameraCoordinatesLeft());
+    if (point_in_camera_left_prediction.z() <= 0) {
+      continue;
+    }
+    const Vector3 point_in_image_left(camera_calibration_matrix*point_in_camera_left_prediction);
+    const Vector3 point_in_image_right(point_in_image_left+_baseline);
+
+    //ds the right search window is additionally shifted by the left prediction error (up to one tracking distance)
+    _addPredictedTrack(0, cv::Point2f(point_in_image_left.x()/point_in_image_left.z(), point_in_image_left.y()/point_in_image_left.z()), 1);
+    _addPredictedTrack(1, cv::Point2f(point_in_image_right.x()/point_in_image_right.z(), point_in_image_right.y()/point_in_image_right.z()), 2);
+  }
+}
+
+void StereoFramePointGenerator::_describeDeferredKeypoints(const cv::Mat& intensity_image_,
+                                                           const uint32_t& stream_,
+                                                           std::vector<cv::KeyPoint>& keypoints_,
+                                                           cv::Mat& descriptors_) {
+  std::vector<cv::KeyPoint>& deferred_keypoints = _deferred_keypoints[stream_];
+  if (deferred_keypoints.empty()) {
+    return;
+  }
+
+  //ds extract descriptors and append them (keypoints without descriptor are dropped by the extractor)
+  cv::Mat deferred_descriptors;
+  computeDescriptors(intensity_image_, deferred_keypoints, deferred_descriptors, stream_);
+  keypoints_.insert(keypoints_.end(), deferred_keypoints.begin(), deferred_keypoints.end());
+  descriptors_.push_back(deferred_descriptors);
+  deferred_keypoints.clear();
+}
+
 void StereoFramePointGenerator::track(Frame* frame_,
                                       Frame* frame_previous_,
                                       const TransformMatrix3D& camera_left_previous_in_current_,
@@ -120,13 +263,19 @@ void StereoFramePointGenerator::track(Frame* frame_,
   //ds store points for which we couldn't find a track candidate
   previous_framepoints_without_tracks_.resize(framepoints_previous.size());
 
-  //ds tracked and triangulated features (to not consider them in the exhaustive stereo matching)
-  std::set<uint32_t> matched_indices_left;
-  std::set<uint32_t> matched_indices_right;
   Count number_of_points       = 0;
   Count number_of_points_lost  = 0;
   _number_of_tracked_landmarks = 0;
 
+  //ds projective tracking window, defined at detection resolution: the search runs over the lattice cells of the pyramid level,
+  //ds candidates are compared by descriptor and projection error of their keypoints refined at full resolution
+  const int32_t projection_tracking_distance_pixels = _projection_tracking_distance_pixels*_pyramid_scale;
+
+  //ds per point tracking windows from the motion guess uncertainty (the full window is used when tracking by appearance)
+  const bool enable_adaptive_tracking_windows = _parameters->enable_adaptive_tracking_windows && !track_by_appearance_;
+  int32_t projection_tracking_distance_rows_pixels = projection_tracking_distance_pixels;
+  int32_t projection_tracking_distance_cols_pixels = projection_tracking_distance_pixels;
+
   //ds for each previous point
   for (FramePoint* point_previous: framepoints_previous) {
 
@@ -148,10 +297,16 @@ void StereoFramePointGenerator::track(Frame* frame_,
     real descriptor_distance_best = _parameters->matching_distance_tracking_threshold;
 
     //ds define search region (rectangular ROI)
-    int32_t row_start_point = std::max(row_projection_left-_projection_tracking_distance_pixels, 0);
-    int32_t row_end_point   = std::min(row_projection_left+_projection_tracking_distance_pixels+1, _number_of_rows_image);
-    int32_t col_start_point = std::max(col_projection_left-_projection_tracking_distance_pixels, 0);
-    int32_t col_end_point   = std::min(col_projection_left+_projection_tracking_distance_pixels+1, _number_of_cols_image);
+    if (enable_adaptive_tracking_windows) {
+      _getAdaptiveTrackingDistances(point_in_camera_left_prediction,
+                                    projection_tracking_distance_pixels,
+                                    projection_tracking_distance_rows_pixels,
+                                    projection_tracking_distance_cols_pixels);
+    }
+    int32_t row_start_point = std::max(row_projection_left-projection_tracking_distance_rows_pixels, 0);
+    int32_t row_end_point   = std::min(row_projection_left+projection_tracking_distance_rows_pixels+1, _number_of_rows_image);
+    int32_t col_start_point = std::max(col_projection_left-projection_tracking_distance_cols_pixels, 0);
+    int32_t col_end_point   = std::min(col_projection_left+projection_tracking_distance_cols_pixels+1, _number_of_cols_image);
 
     //ds find the best match for the previous left feature (i.e. track it)
     IntensityFeature* feature_left = _feature_matcher_left.getMatchingFeatureInRectangularRegion(row_projection_left,
@@ -187,8 +342,8 @@ void StereoFramePointGenerator::track(Frame* frame_,
       const int32_t epipolar_offset_previous = std::fabs(point_previous->epipolarOffset());
       row_start_point = std::max(row_projection_right_corrected-epipolar_offset_previous, 0);
       row_end_point   = std::min(row_projection_right_corrected+epipolar_offset_previous+1, _number_of_rows_image);
-      col_start_point = std::max(col_projection_right_corrected-_projection_tracking_distance_pixels, 0);
-      col_end_point   = std::min(col_projection_right_corrected+_projection_tracking_distance_pixels+1, feature_left->col);
+      col_start_point = std::max(col_projection_right_corrected-projection_tracking_distance_pixels, 0);
+      col_end_point   = std::min(col_projection_right_corrected+projection_tracking_distance_pixels+1, feature_left->col);
 
       //ds we might increase the matching tolerance (maximum_matching_distance_triangulation) since we have a strong prior on location
       IntensityFeature* feature_right = _feature_matcher_right.getMatchingFeatureInRectangularRegion(row_projection_right_corrected,
@@ -216,11 +371,9 @@ void StereoFramePointGenerator::track(Frame* frame_,
           continue;
         }
 
-        //ds create a stereo match
-        FramePoint* framepoint = frame_->createFramepoint(feature_left,
-                                                          feature_right,
-                                                          getPointInLeftCamera(feature_left->keypoint.pt, feature_right->keypoint.pt),
-                                                          point_previous);
+        //ds create a stereo match (triangulated in a batch after tracking)
+        FramePoint* framepoint = frame_->createFramepoint(feature_left, feature_right, point_previous);
+        _triangulation_batch.push_back(framepoint);
         framepoint->setEpipolarOffset(feature_right->row-feature_left->row);
         framepoint->setDescriptorDistanceTriangulation(descriptor_distance_best);
 
@@ -234,12 +387,12 @@ void StereoFramePointGenerator::track(Frame* frame_,
         ++number_of_points;
 
         //ds block matching in exhaustive matching (later)
-        matched_indices_left.insert(feature_left->index_in_vector);
-        matched_indices_right.insert(feature_right->index_in_vector);
+        feature_left->matched  = true;
+        feature_right->matched = true;
 
         //ds remove feature from lattices
-        _feature_matcher_left.feature_lattice[feature_left->row][feature_left->col]    = nullptr;
-        _feature_matcher_right.feature_lattice[feature_right->row][feature_right->col] = nullptr;
+        _feature_matcher_left.removeFeatureFromLattice(feature_left);
+        _feature_matcher_right.removeFeatureFromLattice(feature_right);
 
         if (framepoint->landmark()) {
           ++_number_of_tracked_landmarks;
@@ -256,9 +409,12 @@ void StereoFramePointGenerator::track(Frame* frame_,
   framepoints.resize(number_of_points);
   previous_framepoints_without_tracks_.resize(number_of_points_lost);
 
-  //ds remove matched indices from candidate pools
-  _feature_matcher_left.prune(matched_indices_left);
-  _feature_matcher_right.prune(matched_indices_right);
+  //ds triangulate all tracked points at once
+  _triangulateBatch(frame_);
+
+  //ds remove matched features from candidate pools
+  _feature_matcher_left.prune();
+  _feature_matcher_right.prune();
   LOG_DEBUG(std::cerr << "StereoFramePointGenerator::track|tracked and triangulated points: " << number_of_points
                       << "/" << framepoints_previous.size() << " (landmarks: " << _number_of_tracked_landmarks << ")" << std::endl)
   LOG_DEBUG(std::cerr << "StereoFramePointGenerator::track|lost points: " << number_of_points_lost
@@ -270,7 +426,7 @@ const PointCoordinates StereoFramePointGenerator::getPointInLeftCamera(const cv:
   assert(image_coordinates_left_.x-image_coordinates_right_.x >= _parameters->minimum_disparity_pixels);
 
   //ds point coordinates in camera frame
-  PointCoordinates position_in_left_camera(Eigen::Vector3d::Zero());
+  PointCoordinates position_in_left_camera(PointCoordinates::Zero());
 
   //ds triangulate point (assuming non-zero disparity)
   position_in_left_camera.z() = _b_x/(image_coordinates_right_.x-image_coordinates_left_.x);
@@ -283,6 +439,48 @@ const PointCoordinates StereoFramePointGenerator::getPointInLeftCamera(const cv:
   return position_in_left_camera;
 }
 
+void StereoFramePointGenerator::_triangulateBatch(const Frame* frame_) {
+  CHRONOMETER_START(point_triangulation)
+  const int64_t number_of_points = _triangulation_batch.size();
+  _u_left.resize(number_of_points);
+  _v_left.resize(number_of_points);
+  _u_right.resize(number_of_points);
+  _v_right.resize(number_of_points);
+  _camera_coordinates_batch.resize(3, number_of_points);
+
+  //ds gather image coordinates of all stereo matches
+  for (int64_t index = 0; index < number_of_points; ++index) {
+    const FramePoint* framepoint = _triangulation_batch[index];
+    assert(framepoint->keypointLeft().pt.x-framepoint->keypointRight().pt.x >= _parameters->minimum_disparity_pixels);
+    _u_left(index)  = framepoint->keypointLeft().pt.x;
+    _v_left(index)  = framepoint->keypointLeft().pt.y;
+    _u_right(index) = framepoint->keypointRight().pt.x;
+    _v_right(index) = framepoint->keypointRight().pt.y;
+  }
+
+  //ds triangulate all points in one vectorized pass (identical to getPointInLeftCamera)
+  _camera_coordinates_batch.row(2) = (static_cast<batch_real>(_b_x)/(_u_right-_u_left)).matrix();
+  _camera_coordinates_batch.row(0) = (1/static_cast<batch_real>(_f_x)*(_u_left-static_cast<batch_real>(_c_x))*_camera_coordinates_batch.row(2).array()).matrix();
+  _camera_coordinates_batch.row(1) = (1/static_cast<batch_real>(_f_y)*((_v_left+_v_right)/2-static_cast<batch_real>(_c_y))*_camera_coordinates_batch.row(2).array()).matrix();
+
+  //ds transform all points into robot and world frame
+  const TransformMatrix3D& camera_to_robot = _camera_left->cameraToRobot();
+  const TransformMatrix3D& robot_to_world  = frame_->robotToWorld();
+  _robot_coordinates_batch = (camera_to_robot.linear().cast<batch_real>()*_camera_coordinates_batch).colwise()+camera_to_robot.translation().cast<batch_real>();
+  _world_coordinates_batch = (robot_to_world.linear().cast<batch_real>()*_robot_coordinates_batch).colwise()+robot_to_world.translation().cast<batch_real>();
+
+  //ds scatter geometry to the framepoints
+  for (int64_t index = 0; index < number_of_points; ++index) {
+    FramePoint* framepoint = _triangulation_batch[index];
+    framepoint->setCameraCoordinatesLeft(_camera_coordinates_batch.col(index).cast<real>());
+    framepoint->setRobotCoordinates(_robot_coordinates_batch.col(index).cast<real>());
+    framepoint->setWorldCoordinates(_world_coordinates_batch.col(index).cast<real>());
+    framepoint->setDepthMeters(_camera_coordinates_batch(2, index));
+  }
+  _triangulation_batch.clear();
+  CHRONOMETER_STOP(point_triangulation)
+}
+
 void StereoFramePointGenerator::compute(Frame* frame_) {
   if (!frame_) {
     throw std::runtime_error("StereoFramePointGenerator::compute|called with empty frame");
@@ -293,8 +491,8 @@ void StereoFramePointGenerator::compute(Frame* frame_) {
   //ds store already present points for optional binning
   if (_parameters->enable_keypoint_binning) {
     for (FramePoint* point: frame_->points()) {
-      const Index row_bin = std::rint(static_cast<real>(point->row)/_parameters->bin_size_pixels);
-      const Index col_bin = std::rint(static_cast<real>(point->col)/_parameters->bin_size_pixels);
+      const Index row_bin = std::rint(static_cast<real>(point->row)/_bin_size_pixels);
+      const Index col_bin = std::rint(static_cast<real>(point->col)/_bin_size_pixels);
       _bin_map_left[row_bin][col_bin] = point;
     }
   }
@@ -309,57 +507,48 @@ void StereoFramePointGenerator::compute(Frame* frame_) {
   FramePointPointerVector framepoints_new(features_left.size());
   Count number_of_new_points = 0;
 
-  //ds start stereo matching for all epipolar offsets
+  //ds start stereo matching for all epipolar offsets - matched features are flagged and skipped on consecutive offsets
   for (const int32_t& epipolar_offset: _epipolar_search_offsets_pixel) {
 
-    //ds matched features (to not consider them for the next offset search)
-    std::set<uint32_t> matched_indices_left;
-    std::set<uint32_t> matched_indices_right;
-
-    //ds running variable
-    uint32_t index_R = 0;
+    //ds running variables: current epipolar line (row in the right image) and its remaining candidate range
+    int32_t row_R        = -1;
+    uint32_t index_R     = 0;
+    uint32_t index_end_R = 0;
 
-    //ds loop over all left keypoints
+    //ds loop over all unmatched left keypoints
     for (uint32_t index_L = 0; index_L < features_left.size(); index_L++) {
-
-      //ds if there are no more points on the right to match against - stop
-      if (index_R == features_right.size()) {break;}
-
-      //ds the right keypoints are on an lower row - skip left
-      while (features_left[index_L]->row < features_right[index_R]->row+epipolar_offset) {
-        index_L++; if (index_L == features_left.size()) {break;}
-      }
-      if (index_L == features_left.size()) {break;}
       IntensityFeature* feature_left = features_left[index_L];
+      if (feature_left->matched) {continue;}
 
-      //ds the right keypoints are on an upper row - skip right
-      while (feature_left->row > features_right[index_R]->row+epipolar_offset) {
-        index_R++; if (index_R == features_right.size()) {break;}
+      //ds move to the epipolar line of the current left keypoint using the row index of the right image
+      if (feature_left->row-epipolar_offset != row_R) {
+        row_R = feature_left->row-epipolar_offset;
+        _feature_matcher_right.getRowRange(row_R, index_R, index_end_R);
       }
-      if (index_R == features_right.size()) {break;}
 
       //ds search bookkeeping
-      uint32_t index_search_R       = index_R;
-      real descriptor_distance_best = _current_maximum_descriptor_distance_triangulation;
-      uint32_t index_best_R         = 0;
+      const uint8_t* descriptor_left    = _feature_matcher_left.descriptors.descriptor(index_L);
+      uint32_t descriptor_distance_best = std::ceil(_current_maximum_descriptor_distance_triangulation);
+      uint32_t index_best_R             = index_end_R;
 
-      //ds scan epipolar line for current keypoint at idx_L - exhaustive
-      while (feature_left->row == features_right[index_search_R]->row+epipolar_offset) {
+      //ds scan epipolar line for current keypoint at idx_L - exhaustive over unmatched candidates
+      for (uint32_t index_search_R = index_R; index_search_R < index_end_R; ++index_search_R) {
+        const IntensityFeature* feature_candidate = features_right[index_search_R];
 
-        //ds invalid disparity stop condition
-        if (feature_left->col-features_right[index_search_R]->col < 0) {break;}
+        //ds invalid disparity stop condition (features in a row are sorted by column)
+        if (feature_left->col-feature_candidate->col < 0) {break;}
+        if (feature_candidate->matched) {continue;}
 
         //ds compute descriptor distance for the stereo match candidates
-        const real descriptor_distance = cv::norm(feature_left->descriptor, features_right[index_search_R]->descriptor, SRRG_PROSLAM_DESCRIPTOR_NORM);
-        if(descriptor_distance < descriptor_distance_best) {
+        const uint32_t descriptor_distance = _feature_matcher_right.descriptors.getDistance(descriptor_left, index_search_R);
+        if (descriptor_distance < descriptor_distance_best) {
           descriptor_distance_best = descriptor_distance;
           index_best_R             = index_search_R;
         }
-        index_search_R++; if (index_search_R == features_right.size()) {break;}
       }
 
       //ds check if something was found
-      if (descriptor_distance_best < _current_maximum_descriptor_distance_triangulation) {
+      if (index_best_R < index_end_R) {
         IntensityFeature* feature_right = features_right[index_best_R];
 
         //ds skip points with insufficient stereo disparity
@@ -367,17 +556,15 @@ void StereoFramePointGenerator::compute(Frame* frame_) {
           continue;
         }
 
-        //ds compute a new framepoint without track
-        FramePoint* framepoint = frame_->createFramepoint(feature_left,
-                                                          feature_right,
-                                                          getPointInLeftCamera(feature_left->keypoint.pt, feature_right->keypoint.pt));
+        //ds compute a new framepoint without track (triangulated in a batch if it survives binning)
+        FramePoint* framepoint = frame_->createFramepoint(feature_left, feature_right);
         framepoint->setEpipolarOffset(epipolar_offset);
         framepoint->setDescriptorDistanceTriangulation(descriptor_distance_best);
 
         //ds store point for optional binning
         if (_parameters->enable_keypoint_binning) {
-          const Index row_bin = std::rint(static_cast<real>(feature_left->row)/_parameters->bin_size_pixels);
-          const Index col_bin = std::rint(static_cast<real>(feature_left->col)/_parameters->bin_size_pixels);
+          const Index row_bin = std::rint(static_cast<real>(feature_left->row)/_bin_size_pixels);
+          const Index col_bin = std::rint(static_cast<real>(feature_left->col)/_bin_size_pixels);
 
           //ds if there is already a point in the bin
           if (_bin_map_left[row_bin][col_bin]) {
@@ -402,25 +589,22 @@ void StereoFramePointGenerator::compute(Frame* frame_) {
         ++number_of_new_points;
 
         //ds block further matching against features_right[index_best_R] in a search on offset epipolar lines
-        matched_indices_left.insert(index_L);
-        matched_indices_right.insert(index_best_R);
+        feature_left->matched  = true;
+        feature_right->matched = true;
 
         //ds reduce search space (this eliminates all structurally conflicting matches)
         index_R = index_best_R+1;
       }
     }
 
-    //ds remove matched indices from candidate pools
-    _feature_matcher_left.prune(matched_indices_left);
-    _feature_matcher_right.prune(matched_indices_right);
     LOG_DEBUG(std::cerr << "StereoFramePointGenerator::compute|epipolar offset: " << epipolar_offset << " number of unmatched features L: "
-              << features_left.size() << " R: " << features_right.size() << std::endl)
+              << features_left.size()-number_of_new_points << " R: " << features_right.size()-number_of_new_points << std::endl)
   }
   framepoints_new.resize(number_of_new_points);
   LOG_DEBUG(std::cerr << "StereoFramePointGenerator::compute|number of new stereo points: " << number_of_new_points << std::endl)
 
   //ds update framepoints - checking for the available points to optionally disable binning in very sparse scenarios
-  const real available_point_ratio = static_cast<real>(number_of_points_tracked+framepoints_new.size())/_target_number_of_keypoints;
+  const real available_point_ratio = static_cast<real>(number_of_points_tracked+framepoints_new.size())/scaledTargetNumberOfKeypoints();
   if (_parameters->enable_keypoint_binning && available_point_ratio > 0.1) {
 
     //ds reserve space for the best case (all points can be added)
@@ -455,6 +639,11 @@ void StereoFramePointGenerator::compute(Frame* frame_) {
     }
   }
 
+  //ds triangulate all new points at once and update the contiguous frame geometry
+  _triangulation_batch.insert(_triangulation_batch.end(), framepoints.begin()+number_of_points_tracked, framepoints.end());
+  _triangulateBatch(frame_);
+  frame_->updatePointCoordinatesBatch();
+
 //  //ds compute final triangulation ratio
 //  const real triangulation_ratio = static_cast<real>(framepoints.size())/_number_of_detected_keypoints;
 //
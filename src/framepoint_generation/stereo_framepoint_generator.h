@@ -6,6 +6,22 @@ namespace proslam {
 //ds this class computes potential framepoints in a stereo image pair by triangulation
 class StereoFramePointGenerator : public BaseFramePointGenerator {
 
+//ds exported types
+public:
+
+  //! @brief features of a stereo image pair, extracted ahead of tracking (pipelined processing)
+  struct StereoFeatures {
+    std::vector<cv::KeyPoint> keypoints_left;
+    std::vector<cv::KeyPoint> keypoints_right;
+    cv::Mat descriptors_left;
+    cv::Mat descriptors_right;
+    Count number_of_detected_keypoints = 0;
+
+    //! @brief extraction durations, measured by the extracting thread (e.g. for the per frame statistics of a pipelined extraction)
+    double duration_keypoint_detection_seconds    = 0;
+    double duration_descriptor_extraction_seconds = 0;
+  };
+
 //ds object handling
 PROSLAM_MAKE_PROCESSING_CLASS(StereoFramePointGenerator)
 
@@ -15,6 +31,13 @@ public:
   //ds initializes the framepoint generator (e.g. detects keypoints and computes descriptors in the left and right camera image)
   virtual void initialize(Frame* frame_, const bool& extract_features_ = true);
 
+  //! @brief detects keypoints and computes descriptors in a stereo image pair, adapting the detector thresholds for the next pair
+  //! @brief only touches the detection state of the generator and can run concurrently to tracking (image pairs must be passed in processing order)
+  //! @param[in] intensity_image_left_ left image
+  //! @param[in] intensity_image_right_ right image
+  //! @param[out] features_ extracted features, to be passed to setPrecomputedFeatures before tracking the frame
+  void extractFeatures(const cv::Mat& intensity_image_left_, const cv::Mat& intensity_image_right_, StereoFeatures& features_);
+
   //! @brief computes framepoints based on exhaustive, rigid stereo matching on multiple epipolar lines without prior
   //! @param[in, out] frame_ frame that will be filled with framepoints
   virtual void compute(Frame* frame_);
@@ -38,6 +61,9 @@ public:
 public:
 
   inline void setCameraRight(const Camera* camera_right_) {_camera_right = camera_right_;}
+
+  //! @brief features that are moved into the frame by the next initialize call instead of extracting them (lazy detection is not applied)
+  inline void setPrecomputedFeatures(StereoFeatures* features_) {_precomputed_features = features_;}
   const real& meanTriangulationSuccessRatio() const {return _mean_triangulation_success_ratio;}
 
 //ds settings
@@ -59,8 +85,8 @@ protected:
   //! @brief current epipolar search range
   int32_t _maximum_epipolar_search_offset_pixels = 0;
 
-  //! @brief current triangulation distance
-  real _current_maximum_descriptor_distance_triangulation = 0.1*SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS;
+  //! @brief current triangulation distance (initialized in configure)
+  real _current_maximum_descriptor_distance_triangulation = 0;
 
   //! @brief information only: average triangulation success ratio
   real _mean_triangulation_success_ratio = 1;
@@ -72,9 +98,54 @@ protected:
   //! @brief feature matching class (maintains features in a 2D lattice corresponding to the image and a vector)
   IntensityFeatureMatcher _feature_matcher_right;
 
+  //! @brief triangulates all queued stereo matches in one vectorized pass and sets camera, robot and world coordinates of the framepoints
+  //! @param[in] frame_ frame of the queued framepoints (provides the world pose)
+  void _triangulateBatch(const Frame* frame_);
+
+  //! @brief framepoints queued for batched triangulation
+  FramePointPointerVector _triangulation_batch;
+
+  //! @brief batched triangulation buffers (reused between frames)
+  ImageCoordinatesBatch _u_left;
+  ImageCoordinatesBatch _v_left;
+  ImageCoordinatesBatch _u_right;
+  ImageCoordinatesBatch _v_right;
+  PointCoordinatesBatch _camera_coordinates_batch;
+  PointCoordinatesBatch _robot_coordinates_batch;
+  PointCoordinatesBatch _world_coordinates_batch;
+
+  //! @brief detects and describes keypoints in both images (shared by initialize and extractFeatures)
+  //! @param[out] number_of_detected_keypoints_ average number of detected keypoints per image (before lazy detection and description)
+  //! @param[in] lazy_detection_ defers the description of keypoints in saturated regions (requires predicted tracks)
+  void _extractFeatures(const cv::Mat& intensity_image_left_,
+                        const cv::Mat& intensity_image_right_,
+                        std::vector<cv::KeyPoint>& keypoints_left_,
+                        std::vector<cv::KeyPoint>& keypoints_right_,
+                        cv::Mat& descriptors_left_,
+                        cv::Mat& descriptors_right_,
+                        Count& number_of_detected_keypoints_,
+                        const bool& lazy_detection_);
+
+  //! @brief pipelined processing: features to use for the next frame (not owned)
+  StereoFeatures* _precomputed_features = nullptr;
+
+  //! @brief predicts track locations of the previous framepoints in both images using the current motion guess (lazy detection)
+  //! @param[in] frame_previous_ previous frame
+  void _predictTracks(const Frame* frame_previous_);
+
+  //! @brief extracts descriptors for the deferred keypoints of an image stream and appends them to the frame features
+  //! @param[in] intensity_image_ image of the stream
+  //! @param[in] stream_ image stream index
+  //! @param[in,out] keypoints_ frame keypoints of the stream
+  //! @param[in,out] descriptors_ frame descriptors of the stream
+  void _describeDeferredKeypoints(const cv::Mat& intensity_image_,
+                                  const uint32_t& stream_,
+                                  std::vector<cv::KeyPoint>& keypoints_,
+                                  cv::Mat& descriptors_);
+
 private:
 
-  //ds informative only
+  //ds informative only (batched triangulation)
   CREATE_CHRONOMETER(point_triangulation)
 };
 }
@@ -20,96 +20,40 @@ namespace proslam {
 
 GraphOptimizer::GraphOptimizer(GraphOptimizerParameters* parameters_): _parameters(parameters_),
                                                                        _optimizer(nullptr),
-                                                                       _vertex_frame_last_added(nullptr) {
+                                                                       _vertex_frame_last_added(nullptr),
+                                                                       _is_optimization_running(false) {
   LOG_INFO(std::cerr << "GraphOptimizer::GraphOptimizer|constructed" << std::endl)
 }
 
 void GraphOptimizer::configure() {
   LOG_INFO(std::cerr << "GraphOptimizer::configure|configuring" << std::endl)
 
-  //ds solver setup
-  g2o::OptimizationAlgorithm* solver = nullptr;
-
-  //ds allocate an optimizable graph - depending on chosen parameters
-  if (_parameters->optimization_algorithm == "GAUSS_NEWTON" &&
-      _parameters->linear_solver_type == "CHOLMOD" &&
-      !_parameters->enable_full_bundle_adjustment) {
-    ALLOCATE_SOLVER(OptimizerGaussNewton, LinearSolverCholmod6x3, BlockSolver6x3)
-  }
-  else if (_parameters->optimization_algorithm == "GAUSS_NEWTON" &&
-      _parameters->linear_solver_type == "CSPARSE" &&
-      !_parameters->enable_full_bundle_adjustment) {
-    ALLOCATE_SOLVER(OptimizerGaussNewton, LinearSolverCSparse6x3, BlockSolver6x3)
-  }
-
-  else if (_parameters->optimization_algorithm == "GAUSS_NEWTON" &&
-      _parameters->linear_solver_type == "CHOLMOD" &&
-      _parameters->enable_full_bundle_adjustment) {
-    ALLOCATE_SOLVER(OptimizerGaussNewton, LinearSolverCholmodVariable, BlockSolverVariable)
-  }
-  else if (_parameters->optimization_algorithm == "GAUSS_NEWTON" &&
-      _parameters->linear_solver_type == "CSPARSE" &&
-      _parameters->enable_full_bundle_adjustment) {
-    ALLOCATE_SOLVER(OptimizerGaussNewton, LinearSolverCSparseVariable, BlockSolverVariable)
-  }
-
-  else if (_parameters->optimization_algorithm == "LEVENBERG" &&
-      _parameters->linear_solver_type == "CHOLMOD" &&
-      !_parameters->enable_full_bundle_adjustment) {
-    ALLOCATE_SOLVER(OptimizerLevenberg, LinearSolverCholmod6x3, BlockSolver6x3)
-  }
-  else if (_parameters->optimization_algorithm == "LEVENBERG" &&
-      _parameters->linear_solver_type == "CSPARSE" &&
-      !_parameters->enable_full_bundle_adjustment) {
-    ALLOCATE_SOLVER(OptimizerLevenberg, LinearSolverCSparse6x3, BlockSolver6x3)
-  }
-
-  else if (_parameters->optimization_algorithm == "LEVENBERG" &&
-      _parameters->linear_solver_type == "CHOLMOD" &&
-      _parameters->enable_full_bundle_adjustment) {
-    ALLOCATE_SOLVER(OptimizerLevenberg, LinearSolverCholmodVariable, BlockSolverVariable)
-  }
-  else if (_parameters->optimization_algorithm == "LEVENBERG" &&
-      _parameters->linear_solver_type == "CSPARSE" &&
-      _parameters->enable_full_bundle_adjustment) {
-    ALLOCATE_SOLVER(OptimizerLevenberg, LinearSolverCSparseVariable, BlockSolverVariable)
-  }
-
-  //ds if we couldn't allocate a solver
-  if (!solver) {
-
-    //ds critical
-    throw std::runtime_error("GraphOptimizer::configure|unable to set solver, please check configuration");
-  }
-
   //ds allocate optimizer (deleting a previous one)
+  if (_optimization_worker.joinable()) {_optimization_worker.join();}
   if (_optimizer) {delete _optimizer;}
-  _optimizer = new g2o::SparseOptimizer();
+  _optimizer = _createOptimizer();
 
-  //ds set the solver
-  _optimizer->setAlgorithm(solver);
+  //ds the background optimization runs on a second graph, which is swapped with the current one
+  if (_optimizer_background) {delete _optimizer_background; _optimizer_background = nullptr;}
+  if (_parameters->enable_asynchronous_optimization) {
+    _optimizer_background = _createOptimizer();
+  }
 
   //ds clean bookkeeping
-  _vertex_frame_last_added = 0;
-  _frames_in_pose_graph.clear();
-  _local_maps_in_graph.clear();
-  _landmarks_in_pose_graph.clear();
-
-  //ds clean pose graph
-  _optimizer->clear();
-  _optimizer->setVerbose(false);
-
-  //ds set world offset
-  g2o::ParameterSE3Offset* parameter_world_offset = new g2o::ParameterSE3Offset();
-  parameter_world_offset->setId(G2oParameter::WORLD_OFFSET);
-  _optimizer->addParameter(parameter_world_offset);
+  clear();
   LOG_INFO(std::cerr << "GraphOptimizer::configure|allocated optimization algorithm: " << _parameters->optimization_algorithm
-                     << " with solver: " << _parameters->linear_solver_type << std::endl)
+                     << " with solver: " << _parameters->linear_solver_type
+                     << " (asynchronous: " << _parameters->enable_asynchronous_optimization << ")" << std::endl)
   LOG_INFO(std::cerr << "GraphOptimizer::configure|configured" << std::endl)
 }
 
 GraphOptimizer::~GraphOptimizer(){
   LOG_INFO(std::cerr << "GraphOptimizer::~GraphOptimizer|destroying" << std::endl)
+
+  //ds a running background optimization is awaited and discarded
+  if (_optimization_worker.joinable()) {
+    _optimization_worker.join();
+  }
   _frames_in_pose_graph.clear();
   _landmarks_in_pose_graph.clear();
   if (_optimizer) {
@@ -117,9 +61,52 @@ GraphOptimizer::~GraphOptimizer(){
     _optimizer->clearParameters();
     delete _optimizer;
   }
+  if (_optimizer_background) {
+    _optimizer_background->clear();
+    _optimizer_background->clearParameters();
+    delete _optimizer_background;
+  }
+  if (_optimizer_map) {
+    _optimizer_map->clear();
+    _optimizer_map->clearParameters();
+    delete _optimizer_map;
+  }
   LOG_INFO(std::cerr << "GraphOptimizer::~GraphOptimizer|destroyed" << std::endl)
 }
 
+void GraphOptimizer::clear() {
+  if (_optimization_worker.joinable()) {_optimization_worker.join();}
+  _is_optimization_running = false;
+
+  //ds empty the graphs, the configured solvers are kept
+  if (_optimizer) {_optimizer->clear();}
+  if (_optimizer_background) {_optimizer_background->clear();}
+  _vertex_frame_last_added = 0;
+  _keyframe_last_added     = nullptr;
+  _frames_in_pose_graph.clear();
+  _local_maps_in_graph.clear();
+  _landmarks_in_pose_graph.clear();
+  _frames_in_background_graph.clear();
+  _local_maps_in_background_graph.clear();
+  _landmarks_in_background_graph.clear();
+  _frame_last_in_background_graph          = nullptr;
+  _robot_to_world_last_in_background_graph = TransformMatrix3D::Identity();
+  _identifier_first_landmark_after_snapshot = 0;
+  _is_background_graph_with_landmarks      = false;
+  _is_background_graph_outdated            = false;
+  _memory_background_graph_bytes           = 0;
+
+  //ds the map graph is rebuilt on the next map optimization
+  if (_optimizer_map) {
+    _optimizer_map->clear();
+    _optimizer_map->clearParameters();
+    delete _optimizer_map;
+    _optimizer_map = nullptr;
+  }
+  _frame_last_in_map_graph = nullptr;
+  _number_of_closures_in_map_graph.clear();
+}
+
 void GraphOptimizer::writePoseGraphToFile(const WorldMap* world_map_, const std::string& file_name_) const {
   if (world_map_->frames().empty()) {
     return;
@@ -226,6 +213,19 @@ void GraphOptimizer::writePoseGraphToFile(const WorldMap* world_map_, const std:
 void GraphOptimizer::addFrame(Frame* frame_) {
   CHRONOMETER_START(addition)
 
+  //ds keyframe pose graph: only keyframes become vertices, intermediate frames follow their keyframe in closed form
+  //ds a local map created after the addition of its keyframe (asynchronous relocalization) is caught with the next frame
+  if (_parameters->enable_keyframe_pose_graph) {
+    if (frame_->previous() && frame_->previous() != frame_ && frame_->previous()->isKeyframe()) {
+      _addKeyframe(frame_->previous());
+    }
+    if (frame_->isKeyframe()) {
+      _addKeyframe(frame_);
+    }
+    CHRONOMETER_STOP(addition)
+    return;
+  }
+
   //ds get the frames pose to g2o representation
   g2o::VertexSE3* vertex_frame_current = new g2o::VertexSE3();
   vertex_frame_current->setId(frame_->identifier());
@@ -265,48 +265,8 @@ void GraphOptimizer::addFrame(Frame* frame_) {
   }
 
   //ds if the frame is part of a local map
-  LocalMap* local_map = frame_->localMap();
-  if (local_map) {
-
-    //ds if the local map has not been checked in a previous frame
-    if (_local_maps_in_graph.find(local_map->identifier()) == _local_maps_in_graph.end()) {
-      _local_maps_in_graph.insert(std::make_pair(local_map->identifier(), local_map));
-
-      //ds for all linked loop closures
-      for (const LocalMap::ClosureConstraint& closure: local_map->closures()) {
-
-        //ds reference frame
-        Frame* reference_frame = closure.local_map->keyframe();
-
-        //ds check if the reference frame is not contained in the current graph
-        if (_frames_in_pose_graph.find(reference_frame) == _frames_in_pose_graph.end()) {
-
-          //ds the vertex was not found - we have to add it to the graph again and fix it
-          g2o::VertexSE3* vertex_reference = new g2o::VertexSE3();
-          vertex_reference->setId(reference_frame->identifier());
-          vertex_reference->setEstimate(reference_frame->robotToWorld().cast<double>());
-          vertex_reference->setFixed(true);
-          _optimizer->addVertex(vertex_reference);
-          _frames_in_pose_graph.insert(std::make_pair(reference_frame, vertex_reference));
-        } else {
-
-          //ds fix reference vertex
-          _optimizer->vertex(reference_frame->identifier())->setFixed(true);
-        }
-
-        //ds compute information value
-        const real information_factor = _parameters->base_information_frame*closure.omega;
-
-        //ds retrieve closure edge
-        _setPoseEdge(_optimizer,
-                     _optimizer->vertex(local_map->keyframe()->identifier()),
-                     _optimizer->vertex(reference_frame->identifier()),
-                     closure.relation,
-                     information_factor,
-                     _parameters->free_translation_for_poses,
-                     _parameters->enable_robust_kernel_for_poses);
-      }
-    }
+  if (frame_->localMap()) {
+    _addClosures(frame_->localMap());
   }
 
   //ds bookkeep the added frame
@@ -406,7 +366,25 @@ void GraphOptimizer::addFrameWithLandmarks(Frame* frame_) {
   CHRONOMETER_STOP(addition)
 }
 
+void GraphOptimizer::updateEstimates() {
+
+  //ds a running background optimization started from the previous estimates, its result is discarded
+  if (_optimization_worker.joinable()) {
+    _is_background_graph_outdated = true;
+  }
+  for(std::pair<Frame*, g2o::VertexSE3*> frame_in_pose_graph: _frames_in_pose_graph) {
+    frame_in_pose_graph.second->setEstimate(frame_in_pose_graph.first->robotToWorld().cast<double>());
+  }
+  for(std::pair<Landmark*, g2o::VertexPointXYZ*> landmark_in_pose_graph: _landmarks_in_pose_graph) {
+    landmark_in_pose_graph.second->setEstimate(landmark_in_pose_graph.first->coordinates().cast<double>());
+  }
+}
+
 void GraphOptimizer::optimizeFrames(WorldMap* world_map_) {
+  if (_parameters->enable_asynchronous_optimization) {
+    _startOptimization(world_map_, false);
+    return;
+  }
   CHRONOMETER_START(optimization)
 
   //ds optimize graph (uncomment lines below for g2o graph dumping)
@@ -415,17 +393,26 @@ void GraphOptimizer::optimizeFrames(WorldMap* world_map_) {
   _optimizer->initializeOptimization();
   _optimizer->optimize(_parameters->maximum_number_of_iterations);
 
+  //ds keyframe pose graph: remember the estimate of the most recent keyframe, its correction is applied to all newer frames
+  const TransformMatrix3D robot_to_world_keyframe_last = (_keyframe_last_added)? _keyframe_last_added->robotToWorld(): TransformMatrix3D::Identity();
+
   //ds directly backpropagate solution to frames - without updating the local maps (we want to keep the fine-grained, frame-wise g2o estimate)
   for(std::pair<Frame*, g2o::VertexSE3*> frame_in_pose_graph: _frames_in_pose_graph) {
     frame_in_pose_graph.first->setRobotToWorld(frame_in_pose_graph.second->estimate().cast<real>());
   }
 
-  //ds update all active landmark positions based on their last local map presence TODO make this more efficient
+  //ds update all active landmark positions based on their last local map presence
+  std::vector<LocalMap*> local_maps;
+  local_maps.reserve(_local_maps_in_graph.size());
   for (std::pair<const Identifier, LocalMap*>& local_map_entry: _local_maps_in_graph) {
-    LocalMap* local_map = local_map_entry.second;
-    local_map->setLocalMapToWorld(local_map->keyframe()->robotToWorld(), true);
+    local_maps.push_back(local_map_entry.second);
+  }
+  _updateLocalMaps(local_maps);
+  if (_parameters->enable_keyframe_pose_graph && _keyframe_last_added) {
+    _updateIntermediateFrames(world_map_, _local_maps_in_graph, _keyframe_last_added, robot_to_world_keyframe_last);
   }
   world_map_->setRobotToWorld(world_map_->currentFrame()->robotToWorld());
+  world_map_->increaseRevision();
   ++_number_of_optimizations;
 
   //ds reset graph for next optimization
@@ -438,8 +425,18 @@ void GraphOptimizer::optimizeFrames(WorldMap* world_map_) {
 }
 
 void GraphOptimizer::optimizeFramesWithLandmarks(WorldMap* world_map_) {
+  const bool is_windowed = (_parameters->number_of_local_maps_for_bundle_adjustment > 0);
+  if (_parameters->enable_asynchronous_optimization && !is_windowed) {
+    _startOptimization(world_map_, true);
+    return;
+  }
   CHRONOMETER_START(optimization)
 
+  //ds local bundle adjustment: the retained window starts from the current estimates (landmarks have been updated by tracking)
+  if (is_windowed) {
+    updateEstimates();
+  }
+
   //ds optimize graph (uncomment lines below for g2o graph dumping)
 //  const std::string file_name = "pose_graph_"+std::to_string(world_map_->currentFrame()->identifier())+".g2o";
 //  _optimizer->save(file_name.c_str());
@@ -454,14 +451,542 @@ void GraphOptimizer::optimizeFramesWithLandmarks(WorldMap* world_map_) {
     landmark_in_pose_graph.first->setCoordinates(landmark_in_pose_graph.second->estimate().cast<real>());
   }
   world_map_->setRobotToWorld(world_map_->currentFrame()->robotToWorld());
+  world_map_->increaseRevision();
   ++_number_of_optimizations;
 
-  //ds reset graph for next optimization
-  _optimizer->clear();
-  _vertex_frame_last_added = 0;
-  _frames_in_pose_graph.clear();
-  _landmarks_in_pose_graph.clear();
+  //ds local bundle adjustment: drop everything that left the window, otherwise reset graph for next optimization
+  if (is_windowed) {
+    _pruneGraph(world_map_);
+  } else {
+    _optimizer->clear();
+    _vertex_frame_last_added = 0;
+    _frames_in_pose_graph.clear();
+    _landmarks_in_pose_graph.clear();
+  }
+  CHRONOMETER_STOP(optimization)
+}
+
+void GraphOptimizer::optimizeMap(WorldMap* world_map_) {
+  CHRONOMETER_START(optimization)
+  if (!_optimizer_map) {
+    _optimizer_map = _createOptimizer();
+  }
+  const FramePointerMap& frames = world_map_->frames();
+
+  //ds extend the map graph by all frames added since the last call, chained by their odometry (the first frame of each track is fixed)
+  FramePointerMap::const_iterator iterator_frame = frames.begin();
+  if (_frame_last_in_map_graph) {
+    iterator_frame = frames.find(_frame_last_in_map_graph->identifier());
+    ++iterator_frame;
+  }
+  Count number_of_added_frames = 0;
+  for (; iterator_frame != frames.end(); ++iterator_frame) {
+    Frame* frame = iterator_frame->second;
+    g2o::VertexSE3* vertex_frame = new g2o::VertexSE3();
+    vertex_frame->setId(frame->identifier());
+    vertex_frame->setEstimate(frame->robotToWorld().cast<double>());
+    _optimizer_map->addVertex(vertex_frame);
+    const Frame* frame_previous = frame->previous();
+    if (!frame_previous || frame_previous == frame || !_optimizer_map->vertex(frame_previous->identifier())) {
+      vertex_frame->setFixed(true);
+    } else {
+      _setPoseEdge(_optimizer_map,
+                   vertex_frame,
+                   _optimizer_map->vertex(frame_previous->identifier()),
+                   frame_previous->worldToRobot()*frame->robotToWorld(),
+                   (frame->isTrackBroken())? 1: _parameters->base_information_frame,
+                   _parameters->free_translation_for_poses,
+                   _parameters->enable_robust_kernel_for_poses);
+    }
+    _frame_last_in_map_graph = frame;
+    ++number_of_added_frames;
+  }
+
+  //ds add the loop closures registered since the last call - the oldest keyframe involved bounds the part of the map that is affected
+  Identifier identifier_boundary = std::numeric_limits<Identifier>::max();
+  for (const LocalMap* local_map: world_map_->localMaps()) {
+    Count& number_of_closures_in_graph = _number_of_closures_in_map_graph[local_map->identifier()];
+    for (Index index = number_of_closures_in_graph; index < local_map->closures().size(); ++index) {
+      const LocalMap::ClosureConstraint& closure = local_map->closures()[index];
+      _setPoseEdge(_optimizer_map,
+                   _optimizer_map->vertex(local_map->keyframe()->identifier()),
+                   _optimizer_map->vertex(closure.local_map->keyframe()->identifier()),
+                   closure.relation,
+                   _parameters->base_information_frame*closure.omega,
+                   _parameters->free_translation_for_poses,
+                   _parameters->enable_robust_kernel_for_poses);
+      identifier_boundary = std::min(identifier_boundary, std::min(local_map->keyframe()->identifier(), closure.local_map->keyframe()->identifier()));
+    }
+    number_of_closures_in_graph = local_map->closures().size();
+  }
+  if (identifier_boundary == std::numeric_limits<Identifier>::max()) {
+    CHRONOMETER_STOP(optimization)
+    LOG_INFO(std::cerr << "GraphOptimizer::optimizeMap|no new loop closures (added frames: " << number_of_added_frames << ")" << std::endl)
+    return;
+  }
+
+  //ds only the subgraph spanned by the new closures is initialized and optimized, warm started from the current frame estimates
+  //ds the boundary keyframe is fixed, everything older is not affected by the correction
+  g2o::HyperGraph::EdgeSet edges_active;
+  Count number_of_active_frames = 0;
+  for (iterator_frame = frames.find(identifier_boundary); iterator_frame != frames.end(); ++iterator_frame) {
+    g2o::VertexSE3* vertex_frame = static_cast<g2o::VertexSE3*>(_optimizer_map->vertex(iterator_frame->first));
+    vertex_frame->setEstimate(iterator_frame->second->robotToWorld().cast<double>());
+    for (g2o::HyperGraph::Edge* edge: vertex_frame->edges()) {
+      if (static_cast<Identifier>(edge->vertex(0)->id()) >= identifier_boundary &&
+          static_cast<Identifier>(edge->vertex(1)->id()) >= identifier_boundary) {
+        edges_active.insert(edge);
+      }
+    }
+    ++number_of_active_frames;
+  }
+  g2o::OptimizableGraph::Vertex* vertex_boundary = _optimizer_map->vertex(identifier_boundary);
+  const bool is_boundary_fixed = vertex_boundary->fixed();
+  vertex_boundary->setFixed(true);
+  _optimizer_map->initializeOptimization(edges_active);
+  _optimizer_map->optimize(_parameters->maximum_number_of_iterations);
+  vertex_boundary->setFixed(is_boundary_fixed);
+
+  //ds backpropagate solution to the affected frames and move the landmarks with their local maps
+  for (iterator_frame = frames.find(identifier_boundary); iterator_frame != frames.end(); ++iterator_frame) {
+    iterator_frame->second->setRobotToWorld(static_cast<g2o::VertexSE3*>(_optimizer_map->vertex(iterator_frame->first))->estimate().cast<real>());
+  }
+  std::vector<LocalMap*> local_maps;
+  for (LocalMap* local_map: world_map_->localMaps()) {
+    if (local_map->keyframe()->identifier() >= identifier_boundary) {
+      local_maps.push_back(local_map);
+    }
+  }
+  _updateLocalMaps(local_maps);
+  if (world_map_->currentFrame()) {
+    world_map_->setRobotToWorld(world_map_->currentFrame()->robotToWorld());
+  }
+  world_map_->increaseRevision();
+  ++_number_of_optimizations;
+
+  //ds the window graph continues from the corrected estimates
+  updateEstimates();
   CHRONOMETER_STOP(optimization)
+  LOG_INFO(std::cerr << "GraphOptimizer::optimizeMap|optimized frames: " << number_of_active_frames << "/" << frames.size()
+                     << " (added frames: " << number_of_added_frames << ")" << std::endl)
+}
+
+void GraphOptimizer::collectOptimization(WorldMap* world_map_) {
+  if (!_optimization_worker.joinable()) {
+    return;
+  }
+  _optimization_worker.join();
+  if (_is_background_graph_outdated) {
+    LOG_WARNING(std::cerr << "GraphOptimizer::collectOptimization|discarding outdated optimization result" << std::endl)
+  } else {
+    _applyBackgroundOptimization(world_map_);
+  }
+
+  //ds reset background graph for the next optimization
+  _optimizer_background->clear();
+  _frames_in_background_graph.clear();
+  _local_maps_in_background_graph.clear();
+  _landmarks_in_background_graph.clear();
+  _frame_last_in_background_graph = nullptr;
+  _memory_background_graph_bytes  = 0;
+}
+
+const size_t GraphOptimizer::memoryUsageBytes() const {
+  size_t bytes = _getMemoryUsageBytes(_optimizer)+_getMemoryUsageBytes(_optimizer_map)+_memory_background_graph_bytes;
+
+  //ds bookkeeping (tree nodes)
+  const size_t bytes_per_node = 4*sizeof(void*);
+  bytes += (_frames_in_pose_graph.size()+_frames_in_background_graph.size())*(sizeof(std::pair<Frame*, g2o::VertexSE3*>)+bytes_per_node);
+  bytes += (_landmarks_in_pose_graph.size()+_landmarks_in_background_graph.size())*(sizeof(std::pair<Landmark*, g2o::VertexPointXYZ*>)+bytes_per_node);
+  bytes += (_local_maps_in_graph.size()+_local_maps_in_background_graph.size())*(sizeof(std::pair<const Identifier, LocalMap*>)+bytes_per_node);
+  bytes += _number_of_closures_in_map_graph.size()*(sizeof(std::pair<Identifier, Count>)+bytes_per_node);
+  return bytes;
+}
+
+const size_t GraphOptimizer::_getMemoryUsageBytes(const g2o::SparseOptimizer* optimizer_) {
+  if (!optimizer_) {
+    return 0;
+  }
+
+  //ds vertices and edges are held in hash maps and sets (one node each)
+  return sizeof(g2o::SparseOptimizer)+optimizer_->vertices().size()*(sizeof(g2o::VertexSE3)+4*sizeof(void*))+
+                                      optimizer_->edges().size()*(sizeof(g2o::EdgeSE3)+3*sizeof(void*));
+}
+
+void GraphOptimizer::_startOptimization(WorldMap* world_map_, const bool& with_landmarks_) {
+
+  //ds only a single background optimization at a time: apply a pending one first
+  collectOptimization(world_map_);
+  assert(_frames_in_background_graph.empty());
+
+  //ds the most recent frame of the snapshot (the current frame, or the last keyframe for a keyframe pose graph)
+  Frame* frame_last = nullptr;
+  for (std::pair<Frame*, g2o::VertexSE3*> frame_in_pose_graph: _frames_in_pose_graph) {
+    if (!frame_last || frame_in_pose_graph.first->identifier() > frame_last->identifier()) {
+      frame_last = frame_in_pose_graph.first;
+    }
+  }
+  assert(frame_last);
+
+  //ds move the current graph into the background and continue with an empty graph (as after a synchronous optimization)
+  std::swap(_optimizer, _optimizer_background);
+  _frames_in_pose_graph.swap(_frames_in_background_graph);
+  _local_maps_in_graph.swap(_local_maps_in_background_graph);
+  _landmarks_in_pose_graph.swap(_landmarks_in_background_graph);
+  _vertex_frame_last_added = 0;
+  _memory_background_graph_bytes = _getMemoryUsageBytes(_optimizer_background);
+
+  //ds remember the snapshot state of the most recent frame and landmark, the correction of the frame is applied to everything newer
+  _frame_last_in_background_graph           = frame_last;
+  _robot_to_world_last_in_background_graph  = frame_last->robotToWorld();
+  _identifier_first_landmark_after_snapshot = world_map_->numberOfCreatedLandmarks();
+  _is_background_graph_with_landmarks       = with_landmarks_;
+  _is_background_graph_outdated             = false;
+
+  //ds optimize the snapshot, the worker thread only accesses the background graph
+  _is_optimization_running = true;
+  _optimization_worker     = std::thread([this] {
+    CHRONOMETER_START(optimization)
+    _optimizer_background->initializeOptimization();
+    _optimizer_background->optimize(_parameters->maximum_number_of_iterations);
+    CHRONOMETER_STOP(optimization)
+    _is_optimization_running = false;
+  });
+}
+
+void GraphOptimizer::_applyBackgroundOptimization(WorldMap* world_map_) {
+
+  //ds backpropagate solution to the frames (and landmarks) of the snapshot
+  for(std::pair<Frame*, g2o::VertexSE3*> frame_in_pose_graph: _frames_in_background_graph) {
+    frame_in_pose_graph.first->setRobotToWorld(frame_in_pose_graph.second->estimate().cast<real>());
+  }
+  if (_is_background_graph_with_landmarks) {
+    for(std::pair<Landmark*, g2o::VertexPointXYZ*> landmark_in_pose_graph: _landmarks_in_background_graph) {
+      landmark_in_pose_graph.first->setCoordinates(landmark_in_pose_graph.second->estimate().cast<real>());
+    }
+  }
+
+  //ds correction of the most recent optimized frame
+  const TransformMatrix3D correction = _frame_last_in_background_graph->robotToWorld()*_robot_to_world_last_in_background_graph.inverse();
+  const Identifier& identifier_frame_last = _frame_last_in_background_graph->identifier();
+  const Frame* root_frame_last            = _frame_last_in_background_graph->root();
+
+  //ds keyframe pose graph: all frames of the optimized local maps follow their keyframes and all newer frames follow the last keyframe
+  if (_parameters->enable_keyframe_pose_graph) {
+    std::vector<LocalMap*> local_maps;
+    local_maps.reserve(_local_maps_in_background_graph.size());
+    for (std::pair<const Identifier, LocalMap*>& local_map_entry: _local_maps_in_background_graph) {
+      local_maps.push_back(local_map_entry.second);
+    }
+    _updateLocalMaps(local_maps);
+    _updateIntermediateFrames(world_map_, _local_maps_in_background_graph, _frame_last_in_background_graph, _robot_to_world_last_in_background_graph);
+  } else {
+
+    //ds propagate it rigidly to the frames of the track that have been added since the snapshot (fixed closure references are older)
+    for(std::pair<Frame*, g2o::VertexSE3*> frame_in_pose_graph: _frames_in_pose_graph) {
+      Frame* frame = frame_in_pose_graph.first;
+      if (frame->identifier() > identifier_frame_last && frame->root() == root_frame_last) {
+        frame->setRobotToWorld(correction*frame->robotToWorld());
+      }
+    }
+    Frame* frame_current = world_map_->currentFrame();
+    if (frame_current                                               &&
+        frame_current->identifier() > identifier_frame_last         &&
+        frame_current->root() == root_frame_last                    &&
+        _frames_in_pose_graph.find(frame_current) == _frames_in_pose_graph.end()) {
+      frame_current->setRobotToWorld(correction*frame_current->robotToWorld());
+    }
+  }
+
+  //ds and to the landmarks that have been created since the snapshot
+  Frame* frame_current = world_map_->currentFrame();
+  std::set<Landmark*> landmarks_corrected;
+  for(std::pair<Landmark*, g2o::VertexPointXYZ*> landmark_in_pose_graph: _landmarks_in_pose_graph) {
+    if (landmark_in_pose_graph.first->identifier() >= _identifier_first_landmark_after_snapshot) {
+      landmarks_corrected.insert(landmark_in_pose_graph.first);
+    }
+  }
+  if (frame_current) {
+    for (FramePoint* point: frame_current->points()) {
+      if (point->landmark() && point->landmark()->identifier() >= _identifier_first_landmark_after_snapshot) {
+        landmarks_corrected.insert(point->landmark());
+      }
+    }
+  }
+  for (Landmark* landmark: landmarks_corrected) {
+    landmark->transform(correction);
+  }
+
+  //ds pose graph only: update all active landmark positions based on their last local map presence
+  if (!_is_background_graph_with_landmarks) {
+    std::vector<LocalMap*> local_maps;
+    local_maps.reserve(_local_maps_in_background_graph.size()+_local_maps_in_graph.size());
+    for (std::pair<const Identifier, LocalMap*>& local_map_entry: _local_maps_in_background_graph) {
+      local_maps.push_back(local_map_entry.second);
+    }
+    for (std::pair<const Identifier, LocalMap*>& local_map_entry: _local_maps_in_graph) {
+      if (local_map_entry.second->keyframe()->identifier() > identifier_frame_last) {
+        local_maps.push_back(local_map_entry.second);
+      }
+    }
+    _updateLocalMaps(local_maps);
+  }
+  world_map_->setRobotToWorld(correction*world_map_->robotToWorld());
+  world_map_->increaseRevision();
+  ++_number_of_optimizations;
+
+  //ds the graph that has been built meanwhile continues from the corrected estimates
+  updateEstimates();
+}
+
+void GraphOptimizer::_updateLocalMaps(const std::vector<LocalMap*>& local_maps_) const {
+
+  //ds move the local maps and select the ones with a significant correction (the others keep pose and landmark coordinates)
+  std::vector<LocalMap*> local_maps_corrected;
+  local_maps_corrected.reserve(local_maps_.size());
+  for (LocalMap* local_map: local_maps_) {
+    const TransformMatrix3D correction(local_map->worldToLocalMap()*local_map->keyframe()->robotToWorld());
+    if (correction.translation().norm() < _parameters->minimum_local_map_correction_translation_meters &&
+        Eigen::AngleAxis<real>(correction.linear()).angle() < _parameters->minimum_local_map_correction_rotation_radians) {
+      continue;
+    }
+    local_map->setLocalMapToWorld(local_map->keyframe()->robotToWorld(), false);
+    local_maps_corrected.push_back(local_map);
+  }
+
+  //ds determine number of threads - each thread updates at least a few local maps
+  const Count number_of_threads = std::max(static_cast<Count>(1),
+                                           std::min(_parameters->number_of_local_map_update_threads, static_cast<Count>(local_maps_corrected.size()/2)));
+
+  //ds local maps are assigned in an interleaved fashion, every landmark is written by its most recent local map only
+  auto update = [&local_maps_corrected, &number_of_threads](const Index& index_thread_) {
+    for (Index index = index_thread_; index < local_maps_corrected.size(); index += number_of_threads) {
+      local_maps_corrected[index]->updateLandmarkCoordinatesInWorld();
+    }
+  };
+  runTasks(_worker_pool, number_of_threads, update);
+}
+
+void GraphOptimizer::_addKeyframe(Frame* keyframe_) {
+
+  //ds skip keyframes that have already been added (also to a meanwhile optimized and cleared graph)
+  if (_keyframe_last_added && keyframe_->identifier() <= _keyframe_last_added->identifier()) {
+    return;
+  }
+  g2o::VertexSE3* vertex_keyframe = new g2o::VertexSE3();
+  vertex_keyframe->setId(keyframe_->identifier());
+  vertex_keyframe->setEstimate(keyframe_->robotToWorld().cast<double>());
+  _optimizer->addVertex(vertex_keyframe);
+
+  //ds the first keyframe (start or recently cleared pose graph) is fixed, others are connected to the preceding keyframe
+  if (!_vertex_frame_last_added) {
+    vertex_keyframe->setFixed(true);
+  } else {
+
+    //ds the relative motion between the keyframes summarizes the odometry of the intermediate frames (minimum information across track breaks)
+    const real information_factor = (keyframe_->root() == _keyframe_last_added->root())? _parameters->base_information_frame: 1;
+    _setPoseEdge(_optimizer,
+                 vertex_keyframe,
+                 _vertex_frame_last_added,
+                 _keyframe_last_added->worldToRobot()*keyframe_->robotToWorld(),
+                 information_factor,
+                 _parameters->free_translation_for_poses,
+                 _parameters->enable_robust_kernel_for_poses);
+  }
+  _addClosures(keyframe_->localMap());
+
+  //ds bookkeep the added keyframe
+  _vertex_frame_last_added = vertex_keyframe;
+  _keyframe_last_added     = keyframe_;
+  _frames_in_pose_graph.insert(std::make_pair(keyframe_, vertex_keyframe));
+}
+
+void GraphOptimizer::_updateIntermediateFrames(WorldMap* world_map_,
+                                               const std::map<const Identifier, LocalMap*>& local_maps_,
+                                               const Frame* keyframe_last_,
+                                               const TransformMatrix3D& robot_to_world_keyframe_last_previous_) {
+
+  //ds frames of the optimized local maps are placed relative to their keyframe
+  for (const std::pair<const Identifier, LocalMap*>& local_map_entry: local_maps_) {
+    const LocalMap* local_map = local_map_entry.second;
+    for (Frame* frame: local_map->frames()) {
+      if (frame != local_map->keyframe() && frame->localMap() == local_map) {
+        frame->setRobotToWorld(local_map->localMapToWorld()*frame->frameToLocalMap());
+      }
+    }
+  }
+
+  //ds frames after the most recent keyframe (not in a local map yet) are moved rigidly with it
+  const TransformMatrix3D correction = keyframe_last_->robotToWorld()*robot_to_world_keyframe_last_previous_.inverse();
+  FramePointerMap::const_iterator iterator = world_map_->frames().find(keyframe_last_->identifier());
+  if (iterator != world_map_->frames().end()) {
+    for (++iterator; iterator != world_map_->frames().end(); ++iterator) {
+      Frame* frame = iterator->second;
+      if (frame->root() == keyframe_last_->root()) {
+        frame->setRobotToWorld(correction*frame->robotToWorld());
+      }
+    }
+  }
+}
+
+void GraphOptimizer::_addClosures(LocalMap* local_map_) {
+
+  //ds if the local map has not been checked in a previous frame
+  if (_local_maps_in_graph.find(local_map_->identifier()) == _local_maps_in_graph.end()) {
+    _local_maps_in_graph.insert(std::make_pair(local_map_->identifier(), local_map_));
+
+    //ds for all linked loop closures
+    for (const LocalMap::ClosureConstraint& closure: local_map_->closures()) {
+
+      //ds reference frame
+      Frame* reference_frame = closure.local_map->keyframe();
+
+      //ds check if the reference frame is not contained in the current graph
+      if (_frames_in_pose_graph.find(reference_frame) == _frames_in_pose_graph.end()) {
+
+        //ds the vertex was not found - we have to add it to the graph again and fix it
+        g2o::VertexSE3* vertex_reference = new g2o::VertexSE3();
+        vertex_reference->setId(reference_frame->identifier());
+        vertex_reference->setEstimate(reference_frame->robotToWorld().cast<double>());
+        vertex_reference->setFixed(true);
+        _optimizer->addVertex(vertex_reference);
+        _frames_in_pose_graph.insert(std::make_pair(reference_frame, vertex_reference));
+      } else {
+
+        //ds fix reference vertex
+        _optimizer->vertex(reference_frame->identifier())->setFixed(true);
+      }
+
+      //ds compute information value
+      const real information_factor = _parameters->base_information_frame*closure.omega;
+
+      //ds retrieve closure edge
+      _setPoseEdge(_optimizer,
+                   _optimizer->vertex(local_map_->keyframe()->identifier()),
+                   _optimizer->vertex(reference_frame->identifier()),
+                   closure.relation,
+                   information_factor,
+                   _parameters->free_translation_for_poses,
+                   _parameters->enable_robust_kernel_for_poses);
+    }
+  }
+}
+
+void GraphOptimizer::_pruneGraph(const WorldMap* world_map_) {
+  const Count& number_of_local_maps = _parameters->number_of_local_maps_for_bundle_adjustment;
+  const LocalMapPointerVector& local_maps = world_map_->localMaps();
+  if (local_maps.size() < number_of_local_maps || local_maps[local_maps.size()-number_of_local_maps]->frames().empty()) {
+    return;
+  }
+
+  //ds the window begins with the first frame of the oldest local map
+  const Identifier identifier_frame_first = local_maps[local_maps.size()-number_of_local_maps]->frames().front()->identifier();
+
+  //ds remove older frames including their measurements
+  for (std::map<Frame*, g2o::VertexSE3*>::iterator iterator = _frames_in_pose_graph.begin(); iterator != _frames_in_pose_graph.end();) {
+    if (iterator->first->identifier() < identifier_frame_first) {
+      if (iterator->second == _vertex_frame_last_added) {
+        _vertex_frame_last_added = 0;
+      }
+      _optimizer->removeVertex(iterator->second);
+      iterator = _frames_in_pose_graph.erase(iterator);
+    } else {
+      ++iterator;
+    }
+  }
+
+  //ds remove landmarks that are not measured in the window anymore
+  for (std::map<Landmark*, g2o::VertexPointXYZ*>::iterator iterator = _landmarks_in_pose_graph.begin(); iterator != _landmarks_in_pose_graph.end();) {
+    if (iterator->second->edges().empty()) {
+      _optimizer->removeVertex(iterator->second);
+      iterator = _landmarks_in_pose_graph.erase(iterator);
+    } else {
+      ++iterator;
+    }
+  }
+
+  //ds the oldest remaining frame is fixed as boundary of the window
+  g2o::VertexSE3* vertex_frame_oldest = nullptr;
+  Identifier identifier_frame_oldest  = 0;
+  for (std::pair<Frame*, g2o::VertexSE3*> frame_in_pose_graph: _frames_in_pose_graph) {
+    if (!vertex_frame_oldest || frame_in_pose_graph.first->identifier() < identifier_frame_oldest) {
+      vertex_frame_oldest     = frame_in_pose_graph.second;
+      identifier_frame_oldest = frame_in_pose_graph.first->identifier();
+    }
+  }
+  if (vertex_frame_oldest) {
+    vertex_frame_oldest->setFixed(true);
+  }
+}
+
+g2o::SparseOptimizer* GraphOptimizer::_createOptimizer() const {
+
+  //ds solver setup
+  g2o::OptimizationAlgorithm* solver = nullptr;
+
+  //ds allocate an optimizable graph - depending on chosen parameters
+  if (_parameters->optimization_algorithm == "GAUSS_NEWTON" &&
+      _parameters->linear_solver_type == "CHOLMOD" &&
+      !_parameters->enable_full_bundle_adjustment) {
+    ALLOCATE_SOLVER(OptimizerGaussNewton, LinearSolverCholmod6x3, BlockSolver6x3)
+  }
+  else if (_parameters->optimization_algorithm == "GAUSS_NEWTON" &&
+      _parameters->linear_solver_type == "CSPARSE" &&
+      !_parameters->enable_full_bundle_adjustment) {
+    ALLOCATE_SOLVER(OptimizerGaussNewton, LinearSolverCSparse6x3, BlockSolver6x3)
+  }
+
+  else if (_parameters->optimization_algorithm == "GAUSS_NEWTON" &&
+      _parameters->linear_solver_type == "CHOLMOD" &&
+      _parameters->enable_full_bundle_adjustment) {
+    ALLOCATE_SOLVER(OptimizerGaussNewton, LinearSolverCholmodVariable, BlockSolverVariable)
+  }
+  else if (_parameters->optimization_algorithm == "GAUSS_NEWTON" &&
+      _parameters->linear_solver_type == "CSPARSE" &&
+      _parameters->enable_full_bundle_adjustment) {
+    ALLOCATE_SOLVER(OptimizerGaussNewton, LinearSolverCSparseVariable, BlockSolverVariable)
+  }
+
+  else if (_parameters->optimization_algorithm == "LEVENBERG" &&
+      _parameters->linear_solver_type == "CHOLMOD" &&
+      !_parameters->enable_full_bundle_adjustment) {
+    ALLOCATE_SOLVER(OptimizerLevenberg, LinearSolverCholmod6x3, BlockSolver6x3)
+  }
+  else if (_parameters->optimization_algorithm == "LEVENBERG" &&
+      _parameters->linear_solver_type == "CSPARSE" &&
+      !_parameters->enable_full_bundle_adjustment) {
+    ALLOCATE_SOLVER(OptimizerLevenberg, LinearSolverCSparse6x3, BlockSolver6x3)
+  }
+
+  else if (_parameters->optimization_algorithm == "LEVENBERG" &&
+      _parameters->linear_solver_type == "CHOLMOD" &&
+      _parameters->enable_full_bundle_adjustment) {
+    ALLOCATE_SOLVER(OptimizerLevenberg, LinearSolverCholmodVariable, BlockSolverVariable)
+  }
+  else if (_parameters->optimization_algorithm == "LEVENBERG" &&
+      _parameters->linear_solver_type == "CSPARSE" &&
+      _parameters->enable_full_bundle_adjustment) {
+    ALLOCATE_SOLVER(OptimizerLevenberg, LinearSolverCSparseVariable, BlockSolverVariable)
+  }
+
+  //ds if we couldn't allocate a solver
+  if (!solver) {
+
+    //ds critical
+    throw std::runtime_error("GraphOptimizer::_createOptimizer|unable to set solver, please check configuration");
+  }
+
+  //ds allocate optimizer and set the solver
+  g2o::SparseOptimizer* optimizer = new g2o::SparseOptimizer();
+  optimizer->setAlgorithm(solver);
+  optimizer->clear();
+  optimizer->setVerbose(false);
+
+  //ds set world offset
+  g2o::ParameterSE3Offset* parameter_world_offset = new g2o::ParameterSE3Offset();
+  parameter_world_offset->setId(G2oParameter::WORLD_OFFSET);
+  optimizer->addParameter(parameter_world_offset);
+  return optimizer;
 }
 
 void GraphOptimizer::_setPoseEdge(g2o::OptimizableGraph* optimizer_,
@@ -477,7 +1002,7 @@ void GraphOptimizer::_setPoseEdge(g2o::OptimizableGraph* optimizer_,
   edge_pose->setMeasurement(transform_from_to_.cast<double>());
 
   //ds information value
-  Eigen::Matrix<double, 6, 6> information(information_factor_*Eigen::Matrix<double, 6, 6>::Identity());
+  Eigen::Matrix<double, 6, 6> information(static_cast<double>(information_factor_)*Eigen::Matrix<double, 6, 6>::Identity());
   if (free_translation_) {
     information.block<3,3>(0,0) *= _parameters->base_information_frame_factor_for_translation;
   }
@@ -496,8 +1021,8 @@ void GraphOptimizer::_setPointEdge(g2o::OptimizableGraph* optimizer_,
   //ds set 3d point measurement
   landmark_edge->setVertex(0, vertex_frame_);
   landmark_edge->setVertex(1, vertex_landmark_);
-  landmark_edge->setMeasurement(framepoint_robot_coordinates);
-  landmark_edge->setInformation(information_factor_*Eigen::Matrix<double, 3, 3>::Identity());
+  landmark_edge->setMeasurement(framepoint_robot_coordinates.cast<double>());
+  landmark_edge->setInformation(static_cast<double>(information_factor_)*Eigen::Matrix<double, 3, 3>::Identity());
   landmark_edge->setParameterId(0, G2oParameter::WORLD_OFFSET);
   if (_parameters->enable_robust_kernel_for_landmarks) {landmark_edge->setRobustKernel(new g2o::RobustKernelCauchy());}
   optimizer_->addEdge(landmark_edge);
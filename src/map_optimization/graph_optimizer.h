@@ -1,4 +1,6 @@
 #pragma once
+#include <atomic>
+#include <thread>
 
 //ds g2o
 #include "g2o/core/optimizable_graph.h"
@@ -14,6 +16,7 @@
 
 //ds proslam
 #include "types/world_map.h"
+#include "types/worker_pool.h"
 #include "relocalization/closure.h"
 
 namespace proslam {
@@ -52,12 +55,16 @@ PROSLAM_MAKE_PROCESSING_CLASS(GraphOptimizer)
 //ds interface
 public:
 
+  //! @brief empties all graphs and their bookkeeping (required before the frames and landmarks of the world map are deleted)
+  //! @brief waits for a running background optimization without applying it
+  void clear();
+
   //! @brief saves a g2o graph of the provided world map to a file
   //! @param[in] world_map_ world map for which the pose graph is constructed
   //! @param[in] file_name_ desired file name for the g2o outfile
   void writePoseGraphToFile(const WorldMap* world_map_, const std::string& file_name_) const;
 
-  //! @brief adds a new frame to the pose graph
+  //! @brief adds a new frame to the pose graph (only keyframes are added for enable_keyframe_pose_graph)
   //! @param[in] frame_ the frame to add
   void addFrame(Frame* frame_);
 
@@ -65,6 +72,10 @@ public:
   //! @param[in] frame_ the frame to add including its captured landmarks
   void addFrameWithLandmarks(Frame* frame_);
 
+  //! @brief refreshes the initial guesses of all vertices in the pose graph from the current frame and landmark estimates
+  //! @brief required if estimates have been changed outside of the optimization (e.g. after merging tracks)
+  void updateEstimates();
+
   //! @brief triggers an adjustment of poses only
   //! @param[in] world_map_ map in which the optimization takes place
   void optimizeFrames(WorldMap* world_map_);
@@ -73,14 +84,67 @@ public:
   //! @param[in] world_map_ map in which the optimization takes place
   void optimizeFramesWithLandmarks(WorldMap* world_map_);
 
+  //! @brief triggers a pose graph optimization over all frames and loop closures of the map, landmarks are moved with their local maps
+  //! @brief used to distribute a loop closure correction in local bundle adjustment mode (the window graph is kept)
+  //! @brief the map graph persists and is extended incrementally, only the part spanned by the new loop closures is optimized
+  //! @param[in] world_map_ map in which the optimization takes place
+  void optimizeMap(WorldMap* world_map_);
+
+  //! @brief waits for a background optimization (enable_asynchronous_optimization) and applies its result to the world map
+  //! @brief the correction of the most recent optimized frame is propagated to all frames and landmarks added since the snapshot
+  //! @param[in] world_map_ map in which the optimization takes place
+  void collectOptimization(WorldMap* world_map_);
+
 //ds getters/setters
 public:
 
   const Count numberOfOptimizations() const {return _number_of_optimizations;}
 
+  //! @brief worker pool the post-optimization local map updates are distributed over (serial updates without a pool)
+  void setWorkerPool(WorkerPool* worker_pool_) {_worker_pool = worker_pool_;}
+
+  //! @brief true if a background optimization has finished and its result can be collected without waiting
+  const bool isOptimizationFinished() const {return _optimization_worker.joinable() && !_is_optimization_running;}
+
+  //! @brief estimated memory footprint of all graphs (window, background and map graph) including their bookkeeping
+  //! @brief the background graph is estimated when it is handed to the worker, thus this can be queried while an optimization is running
+  const size_t memoryUsageBytes() const;
+
 //ds g2o wrapper functions
 protected:
 
+  //! @brief allocates an empty graph with the configured solver
+  g2o::SparseOptimizer* _createOptimizer() const;
+
+  //! @brief estimated memory footprint of the vertices and edges of a graph (upper bound: the largest added types are assumed)
+  static const size_t _getMemoryUsageBytes(const g2o::SparseOptimizer* optimizer_);
+
+  //! @brief adds the loop closure constraints of a local map (once per graph), fixing the reference keyframes
+  void _addClosures(LocalMap* local_map_);
+
+  //! @brief keyframe pose graph: adds a keyframe vertex connected to the previously added keyframe
+  void _addKeyframe(Frame* keyframe_);
+
+  //! @brief keyframe pose graph: places the intermediate frames of the local maps relative to their optimized keyframes (Frame::frameToLocalMap)
+  //! @brief and moves all frames newer than the last keyframe rigidly with it
+  void _updateIntermediateFrames(WorldMap* world_map_,
+                                 const std::map<const Identifier, LocalMap*>& local_maps_,
+                                 const Frame* keyframe_last_,
+                                 const TransformMatrix3D& robot_to_world_keyframe_last_previous_);
+
+  //! @brief moves the local maps to their optimized keyframe poses and updates the landmark world coordinates in parallel (number_of_local_map_update_threads)
+  //! @brief local maps with a correction below the minimum_local_map_correction thresholds are skipped
+  void _updateLocalMaps(const std::vector<LocalMap*>& local_maps_) const;
+
+  //! @brief local bundle adjustment: removes frames older than the window of local maps and unobserved landmarks, fixing the new boundary frame
+  void _pruneGraph(const WorldMap* world_map_);
+
+  //! @brief moves the current graph into the background and optimizes it there, a pending background result is applied first
+  void _startOptimization(WorldMap* world_map_, const bool& with_landmarks_);
+
+  //! @brief applies the result of the background optimization (the worker must be joined)
+  void _applyBackgroundOptimization(WorldMap* world_map_);
+
   void _setPoseEdge(g2o::OptimizableGraph* optimizer_,
                     g2o::OptimizableGraph::Vertex* vertex_from_,
                     g2o::OptimizableGraph::Vertex* vertex_to_,
@@ -104,6 +168,9 @@ protected:
   //! @brief last frame vertex added (to be locked for optimization)
   g2o::VertexSE3* _vertex_frame_last_added;
 
+  //! @brief keyframe pose graph: last added keyframe (kept across optimizations to not add keyframes twice)
+  Frame* _keyframe_last_added = nullptr;
+
   //! @brief bookkeeping: added frames
   std::map<Frame*, g2o::VertexSE3*> _frames_in_pose_graph;
 
@@ -113,6 +180,30 @@ protected:
   //! @brief bookkeeping: added landmarks
   std::map<Landmark*, g2o::VertexPointXYZ*> _landmarks_in_pose_graph;
 
+  //! @brief background optimization: swapped graph with its bookkeeping, optimized by the worker while the current graph grows
+  g2o::SparseOptimizer* _optimizer_background = nullptr;
+  std::map<Frame*, g2o::VertexSE3*> _frames_in_background_graph;
+  std::map<const Identifier, LocalMap*> _local_maps_in_background_graph;
+  std::map<Landmark*, g2o::VertexPointXYZ*> _landmarks_in_background_graph;
+  std::thread _optimization_worker;
+  std::atomic<bool> _is_optimization_running;
+
+  //! @brief worker pool of the assembly (not owned)
+  WorkerPool* _worker_pool = nullptr;
+
+  //! @brief background optimization: snapshot state, used to propagate the correction to newer frames and landmarks
+  Frame* _frame_last_in_background_graph = nullptr;
+  TransformMatrix3D _robot_to_world_last_in_background_graph = TransformMatrix3D::Identity();
+  Identifier _identifier_first_landmark_after_snapshot = 0;
+  bool _is_background_graph_with_landmarks = false;
+  bool _is_background_graph_outdated = false;
+  size_t _memory_background_graph_bytes = 0;
+
+  //! @brief map optimization: persistent pose graph over all frames and loop closures with its bookkeeping (added frames and closures per local map)
+  g2o::SparseOptimizer* _optimizer_map = nullptr;
+  const Frame* _frame_last_in_map_graph = nullptr;
+  std::map<Identifier, Count> _number_of_closures_in_map_graph;
+
   //ds informative only
   CREATE_CHRONOMETER(addition)
   CREATE_CHRONOMETER(optimization)
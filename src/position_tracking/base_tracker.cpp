@@ -26,6 +26,11 @@ BaseTracker::~BaseTracker() {
   LOG_INFO(std::cerr << "BaseTracker::~BaseTracker|destroying" << std::endl)
   _lost_points.clear();
 
+  //ds wait for pending landmark updates (they are discarded)
+  if (_deferred_landmark_update_worker.joinable()) {
+    _deferred_landmark_update_worker.join();
+  }
+
   //ds free dynamics
   delete _framepoint_generator;
   delete _pose_optimizer;
@@ -42,8 +47,13 @@ void BaseTracker::compute() {
   _number_of_recovered_points = 0;
   _context->currentlyTrackedLandmarks().clear();
 
-  //ds relative camera motion guess
+  //ds relative camera motion guess and its uncertainty (configured default)
   TransformMatrix3D previous_to_current = TransformMatrix3D::Identity();
+  Matrix6 motion_guess_covariance(Matrix6::Zero());
+  motion_guess_covariance.block<3,3>(0,0).diagonal().setConstant(_parameters->motion_guess_standard_deviation_translation_meters*
+                                                                 _parameters->motion_guess_standard_deviation_translation_meters);
+  motion_guess_covariance.block<3,3>(3,3).diagonal().setConstant(_parameters->motion_guess_standard_deviation_rotation_radians*
+                                                                 _parameters->motion_guess_standard_deviation_rotation_radians);
 
   //ds check if initial guess can be refined with a motion model or other input
   switch(_parameters->motion_model) {
@@ -62,6 +72,9 @@ void BaseTracker::compute() {
       TransformMatrix3D odom_delta = _odometry.inverse()*_previous_odometry;
       _previous_odometry           = _odometry;
       previous_to_current          = odom_delta;
+      if (_has_odometry_covariance) {
+        motion_guess_covariance = _odometry_covariance;
+      }
       break;
     }
 
@@ -82,7 +95,9 @@ void BaseTracker::compute() {
   current_frame->setStatus(_status);
   Frame* previous_frame = current_frame->previous();
 
-  //ds initialize framepoint generator
+  //ds initialize framepoint generator (the motion guess is used to predict track locations)
+  _framepoint_generator->setMotionGuess(previous_to_current);
+  _framepoint_generator->setMotionGuessCovariance(motion_guess_covariance);
   _framepoint_generator->initialize(current_frame);
 
   //ds if possible - attempt to track the points from the previous frame
@@ -109,7 +124,7 @@ void BaseTracker::compute() {
       if (_number_of_tracked_points < _parameters->minimum_number_of_landmarks_to_track) {
 
         //ds reset state and stick to previous solution
-        LOG_WARNING(std::printf("BaseTracker::compute|skipping position tracking due to insufficient number of tracks: %lu\n", _number_of_tracked_points))
+        LOG_WARNING(Logger::print("BaseTracker::compute|skipping position tracking due to insufficient number of tracks: %lu\n", _number_of_tracked_points))
         _previous_to_current_camera = TransformMatrix3D::Identity();
         break;
       }
@@ -334,7 +349,7 @@ void BaseTracker::_registerRecursive(Frame* frame_previous_,
     assert(_number_of_tracked_points >= number_of_inliers);
 
     //ds recover lost points based on refined pose
-    if (_parameters->enable_landmark_recovery) {
+    if (_parameters->enable_landmark_recovery && !_is_point_recovery_suspended) {
       CHRONOMETER_START(point_recovery)
       _recoverPoints(frame_current_);
       CHRONOMETER_STOP(point_recovery)
@@ -371,7 +386,7 @@ void BaseTracker::_registerRecursive(Frame* frame_previous_,
 void BaseTracker::breakTrack(Frame* frame_) {
 
   //ds reset state
-  LOG_WARNING(std::printf("BaseTracker::breakTrack|LOST TRACK at frame [%06lu] with tracks: %lu\n", frame_->identifier(), _number_of_tracked_points))
+  LOG_WARNING(Logger::print("BaseTracker::breakTrack|LOST TRACK at frame [%06lu] with tracks: %lu\n", frame_->identifier(), _number_of_tracked_points))
   _status_previous = Frame::Localizing;
   _status          = Frame::Localizing;
 
@@ -416,11 +431,15 @@ void BaseTracker::_prunePoints(Frame* frame_) {
 void BaseTracker::_updatePoints(WorldMap* context_, Frame* frame_) {
   CHRONOMETER_START(landmark_optimization)
 
+  //ds incorporate landmark refinements computed in the background since the last update
+  _applyDeferredLandmarkUpdates(context_);
+
   //ds buffer current pose
   const TransformMatrix3D& robot_to_world = frame_->robotToWorld();
 
   //ds start landmark generation/update
   _number_of_active_landmarks = 0;
+  _landmarks_to_update.clear();
   for (FramePoint* point: frame_->points()) {
     point->setWorldCoordinates(robot_to_world*point->robotCoordinates());
 
@@ -439,8 +458,50 @@ void BaseTracker::_updatePoints(WorldMap* context_, Frame* frame_) {
       landmark = context_->createLandmark(point);
     }
 
-    //ds update landmark position based on current point (triggered as we linked the landmark to the point)
-    landmark->update(point);
+    //ds register the measurement (triggered as we linked the landmark to the point)
+    landmark->addMeasurement(point);
+
+    //ds schedule every landmark once per frame: merged landmarks can be observed by multiple points of the frame
+    //ds and must not be refined by two update threads at the same time
+    if (landmark->identifierFrameScheduledUpdate() == frame_->identifier()) {
+      continue;
+    }
+    landmark->setIdentifierFrameScheduledUpdate(frame_->identifier());
+
+    //ds well constrained landmarks may be refined in the background (snapshot of the current measurements)
+    if (_parameters->enable_deferred_landmark_updates && landmark->numberOfUpdates() >= _parameters->minimum_number_of_updates_for_deferral) {
+      if (_number_of_deferred_landmark_updates == _deferred_landmark_updates.size()) {
+        _deferred_landmark_updates.push_back(Landmark::PositionUpdate());
+      }
+      landmark->getPositionUpdate(_deferred_landmark_updates[_number_of_deferred_landmark_updates]);
+      ++_number_of_deferred_landmark_updates;
+    } else {
+      _landmarks_to_update.push_back(landmark);
+    }
+  }
+
+  //ds refine the remaining landmark positions for the current frame
+  _optimizeLandmarks(_landmarks_to_update);
+
+  //ds launch the background refinement of the deferred snapshots (tracking of the next frame uses the current estimates)
+  if (_number_of_deferred_landmark_updates > 0) {
+    _deferred_landmark_update_worker = std::thread([this] {
+      for (Index index = 0; index < _number_of_deferred_landmark_updates; ++index) {
+        Landmark::PositionUpdate& position_update = _deferred_landmark_updates[index];
+        Landmark::optimizePosition(position_update.measurements,
+                                   position_update.accumulated_information,
+                                   position_update.world_coordinates,
+                                   position_update.number_of_updates);
+      }
+    });
+  }
+
+  //ds update framepoints with the (current) landmark estimates
+  for (FramePoint* point: frame_->points()) {
+    Landmark* landmark = point->landmark();
+    if (!landmark || point->trackLength() < _parameters->minimum_track_length_for_landmark_creation) {
+      continue;
+    }
     point->setCameraCoordinatesLeftLandmark(frame_->worldToCameraLeft()*landmark->coordinates());
     ++_number_of_active_landmarks;
 
@@ -448,6 +509,41 @@ void BaseTracker::_updatePoints(WorldMap* context_, Frame* frame_) {
     landmark->setIsCurrentlyTracked(true);
     context_->currentlyTrackedLandmarks().push_back(landmark);
   }
+
+  //ds move the updated landmarks in the spatial index
+  context_->updateLandmarkIndex();
   CHRONOMETER_STOP(landmark_optimization)
 }
+
+void BaseTracker::_optimizeLandmarks(const LandmarkPointerVector& landmarks_) {
+
+  //ds determine number of threads - each thread refines at least a few landmarks
+  const Count number_of_threads = std::max(static_cast<Count>(1),
+                                           std::min(_parameters->number_of_landmark_update_threads, static_cast<Count>(landmarks_.size()/10)));
+
+  //ds landmarks are assigned in an interleaved fashion, balancing the load of long and short tracks
+  auto optimize = [&landmarks_, &number_of_threads](const Index& index_thread_) {
+    for (Index index = index_thread_; index < landmarks_.size(); index += number_of_threads) {
+      landmarks_[index]->optimizePosition();
+    }
+  };
+  runTasks(_worker_pool, number_of_threads, optimize);
+}
+
+void BaseTracker::_applyDeferredLandmarkUpdates(WorldMap* context_) {
+  if (!_deferred_landmark_update_worker.joinable()) {
+    return;
+  }
+  _deferred_landmark_update_worker.join();
+
+  //ds apply snapshots of landmarks which still exist and did not change in the meantime (e.g. merged or moved by map optimization)
+  for (Index index = 0; index < _number_of_deferred_landmark_updates; ++index) {
+    const Landmark::PositionUpdate& position_update = _deferred_landmark_updates[index];
+    LandmarkPointerMap::const_iterator iterator = context_->landmarks().find(position_update.identifier);
+    if (iterator != context_->landmarks().end() && iterator->second->applyPositionUpdate(position_update)) {
+      context_->landmarkIndex().update(iterator->second);
+    }
+  }
+  _number_of_deferred_landmark_updates = 0;
+}
 }
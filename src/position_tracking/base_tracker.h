@@ -27,9 +27,13 @@ public:
   const uint64_t& numberOfRecursiveRegistrations() const {return _number_of_recursive_registrations;}
   void setCameraLeft(const Camera* camera_left_) {_camera_left = camera_left_; _has_odometry = false;}
   void setOdometry(const TransformMatrix3D& odometry_) {_odometry = odometry_; _has_odometry = true;}
+  void setOdometry(const TransformMatrix3D& odometry_, const Matrix6& odometry_covariance_) {setOdometry(odometry_); _odometry_covariance = odometry_covariance_; _has_odometry_covariance = true;}
   void setAligner(BaseFrameAligner* pose_optimizer_) {_pose_optimizer = pose_optimizer_;}
   void setFramePointGenerator(BaseFramePointGenerator * framepoint_generator_) {_framepoint_generator = framepoint_generator_;}
   void setWorldMap(WorldMap* context_) {_context = context_;}
+
+  //! @brief worker pool the landmark updates are distributed over (serial updates without a pool)
+  void setWorkerPool(WorkerPool* worker_pool_) {_worker_pool = worker_pool_;}
   void setIntensityImageLeft(const cv::Mat& intensity_image_left_) {_intensity_image_left = intensity_image_left_;}
   BaseFrameAligner* aligner() {return _pose_optimizer;}
   void setMotionPreviousToCurrent(const TransformMatrix3D& motion_previous_to_current_) {_previous_to_current_camera = motion_previous_to_current_;}
@@ -41,6 +45,10 @@ public:
   const real meanNumberOfKeypoints() const {return _mean_number_of_keypoints;}
   const real meanNumberOfFramepoints() const {return _mean_number_of_framepoints;}
 
+  //! @brief real-time mode: suspends the framepoint track recovery (if enabled) until resumed
+  void setIsPointRecoverySuspended(const bool& is_point_recovery_suspended_) {_is_point_recovery_suspended = is_point_recovery_suspended_;}
+  const bool& isPointRecoverySuspended() const {return _is_point_recovery_suspended;}
+
 //ds helpers
 protected:
 
@@ -64,6 +72,14 @@ protected:
   //ds updates existing or creates new landmarks for framepoints of the provided frame
   void _updatePoints(WorldMap* context_, Frame* frame_);
 
+  //! @brief refines the positions of the provided landmarks, distributed over the configured number of threads
+  //! @param[in] landmarks_ landmarks to refine (each landmark is refined by exactly one thread)
+  void _optimizeLandmarks(const LandmarkPointerVector& landmarks_);
+
+  //! @brief waits for the background worker and applies all deferred landmark updates that are still valid
+  //! @param[in] context_ world map containing the landmarks
+  void _applyDeferredLandmarkUpdates(WorldMap* context_);
+
   //ds attempts to recover framepoints in the current image using the more precise pose estimate, retrieved after pose optimization
   virtual void _recoverPoints(Frame* current_frame_) = 0;
 
@@ -100,6 +116,9 @@ protected:
   BaseFrameAligner* _pose_optimizer              = nullptr;
   BaseFramePointGenerator* _framepoint_generator = nullptr;
 
+  //! @brief worker pool of the assembly (not owned)
+  WorkerPool* _worker_pool = nullptr;
+
   //! @brief position tracking bookkeeping
   TransformMatrix3D _previous_to_current_camera = TransformMatrix3D::Identity();
 
@@ -107,6 +126,15 @@ protected:
   Count _number_of_lost_points      = 0;
   Count _number_of_recovered_points = 0;
   FramePointPointerVector _lost_points;
+  bool _is_point_recovery_suspended = false;
+
+  //! @brief landmark position updates: landmarks refined synchronously in the current frame
+  LandmarkPointerVector _landmarks_to_update;
+
+  //! @brief landmark position updates: snapshots refined by the background worker (valid until the next update)
+  Landmark::PositionUpdateVector _deferred_landmark_updates;
+  Count _number_of_deferred_landmark_updates = 0;
+  std::thread _deferred_landmark_update_worker;
 
   //ds stats only
   real _mean_number_of_keypoints   = 0;
@@ -125,5 +153,9 @@ private:
   bool _has_odometry;
   TransformMatrix3D _odometry;
   TransformMatrix3D _previous_odometry;
+
+  //! @brief uncertainty of the odometry increment (translation, rotation), if provided by the odometry source
+  bool _has_odometry_covariance = false;
+  Matrix6 _odometry_covariance  = Matrix6::Zero();
 };
 }
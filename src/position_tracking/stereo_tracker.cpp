@@ -52,33 +52,16 @@ namespace proslam {
     //ds buffers
     const cv::Mat& intensity_image_left  = current_frame_->intensityImageLeft();
     const cv::Mat& intensity_image_right = current_frame_->intensityImageRight();
-    std::vector<cv::KeyPoint> keypoint_buffer_left(1);
-    std::vector<cv::KeyPoint> keypoint_buffer_right(1);
+    _recovery_candidates.clear();
+    _recovery_keypoints_left.clear();
+    _recovery_keypoints_right.clear();
+    _number_of_map_recovery_candidates = 0;
 
-    //ds recover lost landmarks
-    Index index_lost_point_recovered = _number_of_tracked_points;
-    current_frame_->points().resize(_number_of_tracked_points+_number_of_lost_points);
-    for (FramePoint* point_previous: _lost_points) {
-
-      //ds skip non landmarks for now (TODO parametrize)
-      if (!point_previous->landmark()) {
-        continue;
-      }
+    //ds collect recovery candidates: projections of landmarks with sufficient search range in both images
+    auto add_candidate = [&](FramePoint* point_previous_, const Landmark* landmark_) {
 
-      //ds get point into current camera - based on last track
-      PointCoordinates point_in_camera_homogeneous(Vector3::Zero());
-
-      //ds if we have a landmark at hand
-      if (point_previous->landmark()) {
-        point_previous->landmark()->incrementNumberOfRecoveries();
-
-        //ds get point in camera frame based on landmark coordinates
-        point_in_camera_homogeneous = world_to_camera_left*point_previous->landmark()->coordinates();
-      } else {
-
-        //ds get point in camera frame based on point coordinates
-        point_in_camera_homogeneous = world_to_camera_left*point_previous->worldCoordinates();
-      }
+      //ds get point in camera frame based on landmark coordinates
+      const PointCoordinates point_in_camera_homogeneous(world_to_camera_left*landmark_->coordinates());
 
       //ds obtain point projection on camera image plane
       PointCoordinates point_in_image_left  = camera_calibration_matrix*point_in_camera_homogeneous;
@@ -94,7 +77,7 @@ namespace proslam {
           point_in_image_left.y() < 0 || point_in_image_left.y() > _camera_left->numberOfImageRows()  ) {
 
         //ds out of FOV
-        continue;
+        return;
       }
       assert(point_in_image_left.y() == point_in_image_right.y());
 
@@ -102,12 +85,8 @@ namespace proslam {
       const cv::Point2f projection_left(point_in_image_left.x(), point_in_image_left.y());
       const cv::Point2f projection_right(point_in_image_right.x(), point_in_image_right.y());
 
-      //ds this can be moved outside of the loop if keypoint sizes are constant
-      const float regional_border_center = 5*point_previous->keypointLeft().size;
-      const cv::Point2f offset_keypoint_half(regional_border_center, regional_border_center);
-      const float regional_full_height = regional_border_center+regional_border_center+1;
-
-      //ds if available search range is insufficient
+      //ds if available search range is insufficient (same border as for a regional extraction around the projection)
+      const float regional_border_center = 5*point_previous_->keypointLeft().size;
       if (projection_left.x <= regional_border_center+1                                   ||
           projection_left.x >= _camera_left->numberOfImageCols()-regional_border_center-1 ||
           projection_left.y <= regional_border_center+1                                   ||
@@ -116,64 +95,112 @@ namespace proslam {
           projection_right.x >= _camera_left->numberOfImageCols()-regional_border_center-1) {
 
         //ds skip complete tracking
-        continue;
+        return;
       }
 
-      //ds left search regions
-      const cv::Point2f corner_left(projection_left-offset_keypoint_half);
-      const cv::Rect_<float> region_of_interest_left(corner_left.x, corner_left.y, regional_full_height, regional_full_height);
-
-      //ds extract descriptors at this position: LEFT
-      keypoint_buffer_left[0]    = point_previous->keypointLeft();
-      keypoint_buffer_left[0].pt = offset_keypoint_half;
-      cv::Mat descriptor_left;
-      const cv::Mat roi_left(intensity_image_left(region_of_interest_left));
-      _framepoint_generator->descriptorExtractor()->compute(roi_left, keypoint_buffer_left, descriptor_left);
+      //ds buffer keypoints at the projections - the candidate index is carried in the class id (extractors may drop keypoints)
+      cv::KeyPoint keypoint_left(point_previous_->keypointLeft());
+      keypoint_left.pt       = projection_left;
+      keypoint_left.class_id = _recovery_candidates.size();
+      cv::KeyPoint keypoint_right(point_previous_->keypointRight());
+      keypoint_right.pt       = projection_right;
+      keypoint_right.class_id = _recovery_candidates.size();
+      _recovery_keypoints_left.push_back(keypoint_left);
+      _recovery_keypoints_right.push_back(keypoint_right);
+      _recovery_candidates.push_back(point_previous_);
+    };
+    for (FramePoint* point_previous: _lost_points) {
 
-      //ds if no descriptor could be computed
-      if (descriptor_left.rows == 0) {
+      //ds skip non landmarks for now (TODO parametrize)
+      if (!point_previous->landmark()) {
         continue;
       }
+      point_previous->landmark()->incrementNumberOfRecoveries();
+      add_candidate(point_previous, point_previous->landmark());
+    }
 
-      //ds if descriptor distance is to high
-      if (cv::norm(point_previous->descriptorLeft(), descriptor_left, SRRG_PROSLAM_DESCRIPTOR_NORM) > maximum_descriptor_distance) {
-        continue;
+    //ds map recovery: landmarks in view whose tracks ended in an earlier frame (e.g. short occlusions)
+    //ds the recovered point continues the track of the last framepoint of the landmark that is still in memory
+    if (_parameters->maximum_number_of_frames_for_map_recovery > 0 && _context->landmarkIndex().isEnabled()) {
+      _context->updateLandmarkIndex();
+      _context->landmarkIndex().getLandmarksInFrustum(world_to_camera_left,
+                                                      camera_calibration_matrix,
+                                                      _camera_left->numberOfImageRows(),
+                                                      _camera_left->numberOfImageCols(),
+                                                      _framepoint_generator->parameters()->maximum_reliable_depth_meters,
+                                                      _map_recovery_landmarks);
+      const Count number_of_candidates_lost_points = _recovery_candidates.size();
+      for (Landmark* landmark: _map_recovery_landmarks) {
+        FramePoint* point_previous = landmark->lastUpdate();
+
+        //ds skip landmarks tracked into the current frame, lost in the previous frame (see above) or lost for too long
+        if (!point_previous || point_previous->next() || point_previous->frame() == current_frame_->previous() ||
+            current_frame_->identifier()-point_previous->frame()->identifier() > _parameters->maximum_number_of_frames_for_map_recovery) {
+          continue;
+        }
+        landmark->incrementNumberOfRecoveries();
+        add_candidate(point_previous, landmark);
       }
-      keypoint_buffer_left[0].pt += corner_left;
+      _number_of_map_recovery_candidates = _recovery_candidates.size()-number_of_candidates_lost_points;
+    }
 
-      //ds right search region
-      const cv::Point2f corner_right(projection_right-offset_keypoint_half);
-      const cv::Rect_<float> region_of_interest_right(corner_right.x, corner_right.y, regional_full_height, regional_full_height);
+    //ds extract all left descriptors in one call
+    const uint32_t& descriptor_size_bits = _framepoint_generator->descriptorSizeBits();
+    cv::Mat descriptors_left;
+    _framepoint_generator->descriptorExtractor()->compute(intensity_image_left, _recovery_keypoints_left, descriptors_left);
+
+    //ds keep right keypoints only for candidates with a matching left descriptor
+    _recovery_indices_left.assign(_recovery_candidates.size(), -1);
+    for (int32_t index = 0; index < static_cast<int32_t>(_recovery_keypoints_left.size()); ++index) {
+      const int32_t index_candidate = _recovery_keypoints_left[index].class_id;
+      if (getHammingDistance(_recovery_candidates[index_candidate]->descriptorLeftData(), descriptors_left.ptr<uint8_t>(index), descriptor_size_bits) <= maximum_descriptor_distance) {
+        _recovery_indices_left[index_candidate] = index;
+      }
+    }
+    size_t number_of_keypoints_right = 0;
+    for (const cv::KeyPoint& keypoint_right: _recovery_keypoints_right) {
+      if (_recovery_indices_left[keypoint_right.class_id] >= 0) {
+        _recovery_keypoints_right[number_of_keypoints_right] = keypoint_right;
+        ++number_of_keypoints_right;
+      }
+    }
+    _recovery_keypoints_right.resize(number_of_keypoints_right);
 
-      //ds extract descriptors at this position: RIGHT
-      keypoint_buffer_right[0] = point_previous->keypointRight();
-      keypoint_buffer_right[0].pt = offset_keypoint_half;
-      cv::Mat descriptor_right;
-      const cv::Mat roi_right(intensity_image_right(region_of_interest_right));
-      _framepoint_generator->descriptorExtractor()->compute(roi_right, keypoint_buffer_right, descriptor_right);
+    //ds extract all right descriptors in one call
+    cv::Mat descriptors_right;
+    _framepoint_generator->descriptorExtractor()->compute(intensity_image_right, _recovery_keypoints_right, descriptors_right);
 
-      //ds if no descriptor could be computed
-      if (descriptor_right.rows == 0) {
-        continue;
-      }
+    //ds recover lost landmarks
+    Index index_lost_point_recovered = _number_of_tracked_points;
+    current_frame_->points().resize(_number_of_tracked_points+_number_of_lost_points);
+    for (int32_t index_right = 0; index_right < static_cast<int32_t>(_recovery_keypoints_right.size()); ++index_right) {
+      const int32_t index_candidate = _recovery_keypoints_right[index_right].class_id;
+      const int32_t index_left      = _recovery_indices_left[index_candidate];
+      FramePoint* point_previous    = _recovery_candidates[index_candidate];
 
       //ds if descriptor distance is to high
-      if (cv::norm(point_previous->descriptorRight(), descriptor_right, SRRG_PROSLAM_DESCRIPTOR_NORM) > maximum_descriptor_distance) {
+      const cv::Mat descriptor_right(descriptors_right.row(index_right));
+      if (getHammingDistance(point_previous->descriptorRightData(), descriptor_right.ptr<uint8_t>(0), descriptor_size_bits) > maximum_descriptor_distance) {
         continue;
       }
-      keypoint_buffer_right[0].pt += corner_right;
+
+      //ds restore keypoint properties
+      cv::KeyPoint keypoint_left(_recovery_keypoints_left[index_left]);
+      cv::KeyPoint keypoint_right(_recovery_keypoints_right[index_right]);
+      keypoint_left.class_id  = point_previous->keypointLeft().class_id;
+      keypoint_right.class_id = point_previous->keypointRight().class_id;
 
       //ds skip points with insufficient stereo disparity
-      if (keypoint_buffer_left[0].pt.x-keypoint_buffer_right[0].pt.x < _stereo_framepoint_generator->parameters()->minimum_disparity_pixels) {
+      if (keypoint_left.pt.x-keypoint_right.pt.x < _stereo_framepoint_generator->parameters()->minimum_disparity_pixels) {
         continue;
       }
 
       //ds allocate a new point connected to the previous one
-      FramePoint* current_point = current_frame_->createFramepoint(keypoint_buffer_left[0],
-                                                                   descriptor_left,
-                                                                   keypoint_buffer_right[0],
+      FramePoint* current_point = current_frame_->createFramepoint(keypoint_left,
+                                                                   descriptors_left.row(index_left),
+                                                                   keypoint_right,
                                                                    descriptor_right,
-                                                                   _stereo_framepoint_generator->getPointInLeftCamera(keypoint_buffer_left[0].pt, keypoint_buffer_right[0].pt),
+                                                                   _stereo_framepoint_generator->getPointInLeftCamera(keypoint_left.pt, keypoint_right.pt),
                                                                    point_previous);
 
       //ds set the point to the control structure
@@ -183,6 +210,7 @@ namespace proslam {
     _number_of_recovered_points = index_lost_point_recovered-_number_of_tracked_points;
     _number_of_tracked_points = index_lost_point_recovered;
     current_frame_->points().resize(_number_of_tracked_points);
-    LOG_DEBUG(std::cerr << "StereoTracker::_recoverPoints|recovered points: " << _number_of_recovered_points << "/" << _number_of_lost_points << std::endl)
+    LOG_DEBUG(std::cerr << "StereoTracker::_recoverPoints|recovered points: " << _number_of_recovered_points << "/" << _number_of_lost_points
+                        << " (candidates: " << _recovery_candidates.size() << ", from map: " << _number_of_map_recovery_candidates << ")" << std::endl)
   }
 }
@@ -42,5 +42,15 @@ protected:
 
   //ds specified generator instance
   StereoFramePointGenerator* _stereo_framepoint_generator = nullptr;
+
+  //! @brief batched landmark recovery buffers (reused between frames, descriptors are referenced by the recovered framepoints and allocated per call)
+  FramePointPointerVector _recovery_candidates;
+  std::vector<cv::KeyPoint> _recovery_keypoints_left;
+  std::vector<cv::KeyPoint> _recovery_keypoints_right;
+  std::vector<int32_t> _recovery_indices_left;
+
+  //! @brief map recovery: landmarks in the camera frustum (spatial landmark index query buffer) and the resulting number of candidates
+  LandmarkPointerVector _map_recovery_landmarks;
+  Count _number_of_map_recovery_candidates = 0;
 };
 }
@@ -20,26 +20,34 @@ public: EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
     Landmark* query;
     Landmark* reference;
-    const Count matching_distance_hamming;
+    Count matching_distance_hamming;
   };
 
+  //ds flat candidate buffer, grouped by query landmark before correspondence retrieval
   typedef std::vector<Candidate, Eigen::aligned_allocator<Candidate>> CandidateVector;
-  typedef std::pair<const Identifier, CandidateVector> CandidateMapElement;
-  typedef std::map<const Identifier, CandidateVector, std::less<Identifier>, Eigen::aligned_allocator<CandidateMapElement>> CandidateMap;
 
   //ds container for a single correspondence pair (produced by the relocalization module)
   struct Correspondence {
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     Correspondence(Landmark* landmark_query_,
                    Landmark* landmark_reference_,
+                   const PointCoordinates& coordinates_in_query_,
+                   const PointCoordinates& coordinates_in_reference_,
                    const Count& matching_count_,
                    const real& matching_ratio_): query(landmark_query_),
                                                  reference(landmark_reference_),
+                                                 coordinates_in_query(coordinates_in_query_),
+                                                 coordinates_in_reference(coordinates_in_reference_),
                                                  matching_count(matching_count_),
                                                  matching_ratio(matching_ratio_) {}
 
     Landmark* query;
     Landmark* reference;
+
+    //! @brief landmark snapshots in the query and reference local map (see LocalMap::LandmarkState), registered instead of the
+    //! @brief live landmark estimates - those are refined by the tracking while a relocalization may run in the background
+    const PointCoordinates coordinates_in_query;
+    const PointCoordinates coordinates_in_reference;
     const Count matching_count;
     const real matching_ratio;
 
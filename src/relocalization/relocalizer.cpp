@@ -4,6 +4,7 @@ namespace proslam {
 
 Relocalizer::Relocalizer(RelocalizerParameters* parameters_): _parameters(parameters_) {
   _added_local_maps.clear();
+  _number_of_stored_appearances = 0;
   clear();
   LOG_INFO(std::cerr << "Relocalizer::Relocalizer|constructed" << std::endl)
 }
@@ -13,132 +14,304 @@ void Relocalizer::configure() {
   _added_local_maps.clear();
   clear();
 
-  //ds allocate and configure aligner unit
-  _aligner = XYZAlignerPtr(new XYZAligner(_parameters->aligner));
-  _aligner->configure();
+  //ds derive an unset matching threshold from the extracted descriptor width (HBST compares the zero padded storage width)
+  if (_parameters->maximum_descriptor_distance < 0) {
+    _parameters->maximum_descriptor_distance = 0.1*_descriptor_size_bits;
+  }
+  LOG_INFO(std::cerr << "Relocalizer::configure|maximum descriptor distance: " << _parameters->maximum_descriptor_distance
+                     << " (descriptor size: " << _descriptor_size_bits << "b)" << std::endl)
+
+  //ds allocate and configure aligner units (one for each registration thread)
+  _aligners.clear();
+  for (Index index_thread = 0; index_thread < std::max(static_cast<Count>(1), _parameters->number_of_registration_threads); ++index_thread) {
+    XYZAlignerPtr aligner(new XYZAligner(_parameters->aligner));
+    aligner->configure();
+    aligner->setWorkerPool(_worker_pool);
+    _aligners.push_back(aligner);
+  }
+  _aligner = _aligners.front();
   LOG_INFO(std::cerr << "Relocalizer::configure|configured" << std::endl)
 }
 
+void Relocalizer::setWorkerPool(WorkerPool* worker_pool_) {
+  _worker_pool = worker_pool_;
+  for (XYZAlignerPtr& aligner: _aligners) {
+    aligner->setWorkerPool(_worker_pool);
+  }
+}
+
 Relocalizer::~Relocalizer() {
   LOG_INFO(std::cerr << "Relocalizer::~Relocalizer|destroying" << std::endl)
   _added_local_maps.clear();
   clear();
+  for (const Closure::Correspondence* correspondence: _correspondence_pool) {
+    delete correspondence;
+  }
+  _correspondence_pool.clear();
+  for (const PlaceDatabase* place_database: _place_databases) {
+    delete place_database;
+  }
+  _place_databases.clear();
   LOG_INFO(std::cerr << "Relocalizer::~Relocalizer|destroyed" << std::endl)
 }
 
 //ds retrieve loop closure candidates for the given cloud
-void Relocalizer::detectClosures(LocalMap* local_map_query_) {
+void Relocalizer::detectClosures(LocalMap* local_map_query_, const bool& add_to_database_) {
   CHRONOMETER_START(overall)
   if (!local_map_query_) {
     return;
   }
-
-  //ds always add the entry (only matching is optional)
-  _added_local_maps.push_back(local_map_query_);
   const Count number_of_query_matchables = local_map_query_->appearances().size();
 
-  //ds if we are not yet in query range - only add matchables and nothing else to do
-  if (_place_database.size() < _parameters->preliminary_minimum_interspace_queries) {
-
-    //ds add matchables
-    _place_database.add(local_map_query_->appearances(), srrg_hbst::SplittingStrategy::SplitEven);
-    local_map_query_->appearances().clear();
+  //ds always add the entry (only matching is optional), the query is integrated into the database of its track
+  PlaceDatabase* place_database_query = nullptr;
+  if (add_to_database_) {
+    _added_local_maps.push_back(local_map_query_);
+    place_database_query = _getPlaceDatabase(local_map_query_->root());
   }
 
-  //ds we want to add and match against past places
-  else {
+  //ds addition to the database after registration (commitQuery)
+  const bool is_addition_deferred = (add_to_database_ && _isDatabaseAdditionDeferred());
+  const bool is_addition_immediate = (add_to_database_ && !is_addition_deferred);
+
+  //ds if there is no eligible reference yet (no other track and not in query range) - only add matchables and nothing else to do
+  const bool has_references = (add_to_database_)? (_place_databases.size() > 1 || _added_local_maps.size() > _parameters->preliminary_minimum_interspace_queries):
+                                                  !_place_databases.empty();
+  if (!has_references || number_of_query_matchables == 0) {
+    if (is_addition_immediate) {
+      place_database_query->tree.add(local_map_query_->appearances(), srrg_hbst::SplittingStrategy::SplitEven);
+      local_map_query_->appearances().clear();
+      _updateMergedAppearances(place_database_query, number_of_query_matchables);
+    }
+    CHRONOMETER_STOP(overall)
+    return;
+  }
 
-    //ds matching result container: a map that contains a vector of matches to the current image for each reference image
-    HBSTTree::MatchVectorMap matches_per_reference_image;
+  //ds single database: query and integrate current image simultaneously
+  if (_place_databases.size() == 1) {
+    PlaceDatabase* place_database = _place_databases.front();
+    place_database->matches.clear();
+    if (is_addition_immediate) {
+      place_database->tree.matchAndAdd(local_map_query_->appearances(), place_database->matches, _parameters->maximum_descriptor_distance);
+    } else {
+      place_database->tree.match(local_map_query_->appearances(), place_database->matches, _parameters->maximum_descriptor_distance);
+    }
+  } else {
+
+    //ds multiple tracks: query all databases in parallel (read-only), databases are assigned in an interleaved fashion to the threads
+    const Count number_of_databases = _place_databases.size();
+    const Count number_of_threads   = std::max(static_cast<Count>(1), std::min(_parameters->number_of_query_threads, number_of_databases));
+    auto query = [this, &local_map_query_, &number_of_databases, &number_of_threads](const Index& index_thread_) {
+      for (Index index = index_thread_; index < number_of_databases; index += number_of_threads) {
+        _place_databases[index]->matches.clear();
+        _place_databases[index]->tree.match(local_map_query_->appearances(), _place_databases[index]->matches, _parameters->maximum_descriptor_distance);
+      }
+    };
+    runTasks(_worker_pool, number_of_threads, query);
 
-    //ds query database for current matchables and integrate current image simultaneously
-    _place_database.matchAndAdd(local_map_query_->appearances(), matches_per_reference_image, _parameters->maximum_descriptor_distance);
+    //ds integrate the query once no other thread accesses its matchables anymore (merging in the tree may free them)
+    if (is_addition_immediate) {
+      place_database_query->tree.add(local_map_query_->appearances(), srrg_hbst::SplittingStrategy::SplitEven);
+    }
+  }
+  if (is_addition_immediate) {
     local_map_query_->appearances().clear();
+  }
 
-    //ds evaluate matches for each reference image in the range
-    const Count maximum_index_reference = _place_database.size()-_parameters->preliminary_minimum_interspace_queries;
-    for (Count index_reference_local_map = 0; index_reference_local_map < maximum_index_reference; ++index_reference_local_map) {
-      HBSTTree::MatchVector& multiple_matches_mixed = matches_per_reference_image.at(index_reference_local_map);
-
-      //ds compute relative matching ratio (how many of the query matchables were matched)
-      const real relative_number_of_matches = static_cast<real>(multiple_matches_mixed.size())/number_of_query_matchables;
+  //ds evaluate matches for each eligible reference image
+  for (PlaceDatabase* place_database: _place_databases) {
+    for (HBSTTree::MatchVectorMap::iterator iterator = place_database->matches.begin(); iterator != place_database->matches.end(); ++iterator) {
+      const Identifier& identifier_reference = iterator->first;
+      if (identifier_reference >= _added_local_maps.size()) {
+        continue;
+      }
+      const LocalMap* local_map_reference = _added_local_maps[identifier_reference];
 
-      //ds skip this reference image if matching ratio is insufficient
-      if (relative_number_of_matches < _parameters->preliminary_minimum_matching_ratio) {
+      //ds local maps of the same track are only considered beyond the minimum query interspace (all other tracks are eligible)
+      if (local_map_reference == local_map_query_ || (local_map_reference->root() == local_map_query_->root() &&
+          (!add_to_database_ || identifier_reference+_parameters->preliminary_minimum_interspace_queries > local_map_query_->identifier()))) {
         continue;
       }
+      _evaluateReference(local_map_query_, local_map_reference, iterator->second, number_of_query_matchables);
+    }
+    place_database->matches.clear();
+  }
 
-      //ds loop over all matches to organize them per landmark
-      Closure::CandidateMap multiple_matches_per_landmark;
-      for (const HBSTTree::Match& match: multiple_matches_mixed) {
-
-        //ds we need to evaluate matches that have several candidates with the same distance
-        if (match.object_references.size() > 1) {
-
-          //ds check if all candidates belong NOT to the same landmark (otherwise we keep the match!)
-          bool has_multiple_landmarks = false;
-          for (Landmark* landmark_reference: match.object_references) {
-            if (landmark_reference != match.object_references[0]) {
-              has_multiple_landmarks = true;
-              break;
-            }
-          }
-
-          //ds we skip matches that have multiple candidates (with same distance) due to ambiguity
-          if (has_multiple_landmarks) {
-            continue;
-          }
-        }
+  //ds always check for absorbed matchables (we need to update our bookkeeping) of the last add call (this local map)
+  if (is_addition_immediate) {
+    _updateMergedAppearances(place_database_query, number_of_query_matchables);
+  }
+  CHRONOMETER_STOP(overall)
+}
+
+void Relocalizer::_evaluateReference(const LocalMap* local_map_query_,
+                                     const LocalMap* local_map_reference_,
+                                     const HBSTTree::MatchVector& matches_,
+                                     const Count& number_of_query_matchables_) {
 
-        //ds buffer landmark identifier
-        Landmark* landmark_query                    = match.object_query;
-        Landmark* landmark_reference                = match.object_references[0];
-        const Identifier& query_landmark_identifier = landmark_query->identifier();
+  //ds compute relative matching ratio (how many of the query matchables were matched)
+  const real relative_number_of_matches = static_cast<real>(matches_.size())/number_of_query_matchables_;
 
-        //ds update match map (adding a new entry if not existing yet)
-        try {
+  //ds skip this reference image if matching ratio is insufficient
+  if (relative_number_of_matches < _parameters->preliminary_minimum_matching_ratio) {
+    return;
+  }
 
-          //ds add a new match to the given query point
-          multiple_matches_per_landmark.at(query_landmark_identifier).push_back(Closure::Candidate(landmark_query, landmark_reference, match.distance));
-        } catch(const std::out_of_range& /*exception*/) {
+  //ds loop over all matches to collect the unambiguous candidates
+  _candidates.clear();
+  for (const HBSTTree::Match& match: matches_) {
 
-          //ds initialize the first match for the given query point
-          multiple_matches_per_landmark.insert(std::make_pair(query_landmark_identifier,
-                                                              Closure::CandidateVector(1, Closure::Candidate(landmark_query, landmark_reference, match.distance))));
+    //ds we need to evaluate matches that have several candidates with the same distance
+    if (match.object_references.size() > 1) {
+
+      //ds check if all candidates belong NOT to the same landmark (otherwise we keep the match!)
+      bool has_multiple_landmarks = false;
+      for (Landmark* landmark_reference: match.object_references) {
+        if (landmark_reference != match.object_references[0]) {
+          has_multiple_landmarks = true;
+          break;
         }
       }
 
-      //ds skip further processing if number of matching landmarks is insufficient
-      if (multiple_matches_per_landmark.size() < _parameters->minimum_number_of_matched_landmarks) {
+      //ds we skip matches that have multiple candidates (with same distance) due to ambiguity
+      if (has_multiple_landmarks) {
         continue;
       }
+    }
 
-      //ds prepare point to point correspondence search
-      Closure::CorrespondencePointerVector correspondences;
-      _mask_id_references_for_correspondences.clear();
+    _candidates.push_back(Closure::Candidate(match.object_query, match.object_references[0], match.distance));
+  }
 
-      //ds compute the best point to point correspondences from multiple match candidates
-      for(const Closure::CandidateMapElement& multiple_matches: multiple_matches_per_landmark) {
+  //ds group the candidates per query landmark in identifier order (in place), closest matches first within a group
+  std::sort(_candidates.begin(), _candidates.end(), [](const Closure::Candidate& a_, const Closure::Candidate& b_) {
+    if (a_.query->identifier() != b_.query->identifier()) {
+      return a_.query->identifier() < b_.query->identifier();
+    }
+    if (a_.matching_distance_hamming != b_.matching_distance_hamming) {
+      return a_.matching_distance_hamming < b_.matching_distance_hamming;
+    }
+    return a_.reference->identifier() < b_.reference->identifier();
+  });
+  Count number_of_matched_landmarks = 0;
+  for (Index index = 0; index < _candidates.size(); ++index) {
+    if (index == 0 || _candidates[index].query != _candidates[index-1].query) {
+      ++number_of_matched_landmarks;
+    }
+  }
 
-        //ds retrieve best correspondence for the multiple matches
-        Closure::Correspondence* correspondence = _getCorrespondenceNN(multiple_matches.second);
-        if (correspondence) {
-          correspondences.push_back(correspondence);
-        }
+  //ds skip further processing if number of matching landmarks is insufficient
+  if (number_of_matched_landmarks < _parameters->minimum_number_of_matched_landmarks) {
+    return;
+  }
+
+  //ds prepare point to point correspondence search
+  Closure::CorrespondencePointerVector correspondences;
+  correspondences.reserve(number_of_matched_landmarks);
+  _mask_id_references_for_correspondences.clear();
+
+  //ds compute the best point to point correspondences from multiple match candidates (one group per query landmark)
+  Closure::CandidateVector::const_iterator iterator_begin = _candidates.begin();
+  while (iterator_begin != _candidates.end()) {
+    Closure::CandidateVector::const_iterator iterator_end = iterator_begin+1;
+    while (iterator_end != _candidates.end() && iterator_end->query == iterator_begin->query) {
+      ++iterator_end;
+    }
+
+    //ds retrieve best correspondence for the multiple matches
+    Closure::Correspondence* correspondence = _getCorrespondenceNN(iterator_begin, iterator_end, local_map_query_, local_map_reference_);
+    if (correspondence) {
+      correspondences.push_back(correspondence);
+    }
+    iterator_begin = iterator_end;
+  }
+
+  //ds add to closure buffer
+  _closures.push_back(new Closure(local_map_query_,
+                                  local_map_reference_,
+                                  number_of_matched_landmarks,
+                                  relative_number_of_matches,
+                                  correspondences));
+}
+
+void Relocalizer::commitQuery(LocalMap* local_map_query_) {
+  if (!local_map_query_ || !_isDatabaseAdditionDeferred() || local_map_query_->appearances().empty()) {
+    return;
+  }
+  CHRONOMETER_START(overall)
+
+  //ds a query that closed a loop is already represented in the database
+  bool is_redundant = false;
+  if (_parameters->enable_place_pruning) {
+    for (const Closure* closure: _closures) {
+      if (closure->is_valid && closure->local_map_query == local_map_query_) {
+        is_redundant = true;
+        break;
       }
+    }
+  }
+  const bool is_full = (_parameters->maximum_number_of_places > 0 && numberOfPlaces() >= _parameters->maximum_number_of_places);
+
+  //ds drop the appearances - the local map stays in the world map
+  if (is_redundant || is_full) {
+    LOG_DEBUG(std::cerr << "Relocalizer::commitQuery|not adding local map: " << local_map_query_->identifier()
+                        << " (redundant: " << is_redundant << ", capacity reached: " << is_full << ")" << std::endl)
+    if (_query_result) {
+      _query_result->is_place_rejected = true;
+    } else {
+      local_map_query_->releaseAppearances();
+    }
+    ++_number_of_rejected_places;
+  } else {
+    const Count number_of_matchables = local_map_query_->appearances().size();
+    PlaceDatabase* place_database    = _getPlaceDatabase(local_map_query_->root());
+    place_database->tree.add(local_map_query_->appearances(), srrg_hbst::SplittingStrategy::SplitEven);
+    local_map_query_->appearances().clear();
+    _updateMergedAppearances(place_database, number_of_matchables);
+  }
+  CHRONOMETER_STOP(overall)
+}
+
+void Relocalizer::add(LocalMap* local_map_) {
+  CHRONOMETER_START(overall)
+  assert(local_map_->identifier() == _added_local_maps.size());
+  _added_local_maps.push_back(local_map_);
+
+  //ds local maps without appearances (e.g. rejected places) are only registered
+  const Count number_of_matchables = local_map_->appearances().size();
+  if (number_of_matchables > 0) {
+    PlaceDatabase* place_database = _getPlaceDatabase(local_map_->root());
+    place_database->tree.add(local_map_->appearances(), srrg_hbst::SplittingStrategy::SplitEven);
+    local_map_->appearances().clear();
+    _updateMergedAppearances(place_database, number_of_matchables);
+  }
+  CHRONOMETER_STOP(overall)
+}
+
+const Count Relocalizer::numberOfPlaces() const {
+  Count number_of_places = 0;
+  for (const PlaceDatabase* place_database: _place_databases) {
+    number_of_places += place_database->tree.size();
+  }
+  return number_of_places;
+}
 
-      //ds add to closure buffer
-      _closures.push_back(new Closure(local_map_query_,
-                                      _added_local_maps[index_reference_local_map],
-                                      multiple_matches_per_landmark.size(),
-                                      relative_number_of_matches,
-                                      correspondences));
+Relocalizer::PlaceDatabase* Relocalizer::_getPlaceDatabase(const LocalMap* local_map_root_) {
+  for (PlaceDatabase* place_database: _place_databases) {
+    if (place_database->local_map_root == local_map_root_) {
+      return place_database;
     }
   }
+  LOG_INFO(std::cerr << "Relocalizer::_getPlaceDatabase|creating place database for track with root local map: "
+                     << ((local_map_root_)? std::to_string(local_map_root_->identifier()): "none") << std::endl)
+  PlaceDatabase* place_database = new PlaceDatabase(local_map_root_);
+  _place_databases.push_back(place_database);
+  return place_database;
+}
 
+void Relocalizer::_updateMergedAppearances(PlaceDatabase* place_database_, const Count& number_of_added_matchables_) {
+  _number_of_stored_appearances += number_of_added_matchables_;
 #ifdef SRRG_MERGE_DESCRIPTORS
-  //ds always check for absorbed matchables (we need to update our bookkeeping) of the last add call (this local map)
-  HBSTTree::MatchableMergeVector merges = _place_database.getMerges();
+  HBSTTree::MatchableMergeVector merges = place_database_->tree.getMerges();
   if (!merges.empty()) {
 
     //ds evaluate each merge
@@ -149,25 +322,87 @@ void Relocalizer::detectClosures(LocalMap* local_map_query_) {
       Landmark* landmark = merge.query_object;
 
       //ds replace the matchable in the landmark list, note that the memory for query is already freed
-      landmark->replace(merge.query, merge.reference);
+      if (_query_result) {
+        _query_result->appearance_merges.push_back(AppearanceMerge(landmark, merge.query, merge.reference));
+      } else {
+        landmark->replace(merge.query, merge.reference);
+      }
     }
-    LOG_DEBUG(std::cerr << "Relocalizer::detectClosures|merged appearances: " << merges.size()
-                        << " (" << static_cast<real>(merges.size())/number_of_query_matchables << ")" << std::endl)
+    _number_of_stored_appearances -= merges.size();
+    LOG_DEBUG(std::cerr << "Relocalizer::_updateMergedAppearances|merged appearances: " << merges.size()
+                        << " (" << static_cast<real>(merges.size())/number_of_added_matchables_ << ")" << std::endl)
   }
 #endif
-  CHRONOMETER_STOP(overall)
 }
 
 //ds geometric verification and determination of spatial relation between a set of closures
 void Relocalizer::registerClosures() {
   CHRONOMETER_START(overall)
-  for(Closure* closure: _closures) {
-    _aligner->initialize(closure);
-    _aligner->converge();
+  if (_closures.empty()) {
+    CHRONOMETER_STOP(overall)
+    return;
+  }
+
+  //ds if we stop at the first valid closure - try the most promising candidates first
+  const bool& stop_at_first_valid_closure = _parameters->stop_at_first_valid_closure;
+  if (stop_at_first_valid_closure) {
+    std::stable_sort(_closures.begin(), _closures.end(), [](const Closure* a_, const Closure* b_) {
+      return a_->relative_number_of_matches > b_->relative_number_of_matches;
+    });
   }
+
+  //ds candidates are assigned in an interleaved fashion to the registration threads, each thread owning an aligner
+  const Count number_of_threads = std::min(static_cast<Count>(_aligners.size()), static_cast<Count>(_closures.size()));
+  std::atomic<bool> found_valid_closure(false);
+  auto verify = [this, &number_of_threads, &stop_at_first_valid_closure, &found_valid_closure](const Index& index_thread_) {
+    XYZAlignerPtr& aligner = _aligners[index_thread_];
+    for (Index index = index_thread_; index < _closures.size(); index += number_of_threads) {
+
+      //ds skip remaining candidates (left invalid) if another thread already succeeded
+      if (stop_at_first_valid_closure && found_valid_closure) {
+        break;
+      }
+      aligner->initialize(_closures[index]);
+      aligner->converge();
+      if (_closures[index]->is_valid) {
+        found_valid_closure = true;
+      }
+    }
+  };
+  runTasks(_worker_pool, number_of_threads, verify);
   CHRONOMETER_STOP(overall)
 }
 
+void Relocalizer::relocalize(LocalMap* local_map_query_, QueryResult& result_) {
+  result_.local_map_query = local_map_query_;
+  _query_result = &result_;
+  detectClosures(local_map_query_);
+  registerClosures();
+  commitQuery(local_map_query_);
+  _query_result = nullptr;
+
+  //ds hand over the closures (released by the caller after their application)
+  result_.closures.insert(result_.closures.end(), _closures.begin(), _closures.end());
+  _closures.clear();
+  _mask_id_references_for_correspondences.clear();
+}
+
+void Relocalizer::applyAppearanceUpdates(const QueryResult& result_) const {
+  for (const AppearanceMerge& merge: result_.appearance_merges) {
+    merge.landmark->replace(merge.matchable_absorbed, merge.matchable);
+  }
+  if (result_.is_place_rejected) {
+    result_.local_map_query->releaseAppearances();
+  }
+}
+
+void Relocalizer::releaseClosures(ClosurePointerVector& closures_) {
+  for (Closure* closure: closures_) {
+    _releaseClosure(closure);
+  }
+  closures_.clear();
+}
+
 void Relocalizer::prune() {
   CHRONOMETER_START(overall)
   Closure* closure_best = nullptr;
@@ -179,7 +414,7 @@ void Relocalizer::prune() {
         if (closure->icp_inlier_ratio > closure_best->icp_inlier_ratio &&
             closure->relative_number_of_matches > closure_best->relative_number_of_matches) {
           closure_best->is_valid = false;
-          delete closure_best;
+          _releaseClosure(closure_best);
 
           //ds update
           closure_best = closure;
@@ -188,7 +423,7 @@ void Relocalizer::prune() {
         closure_best = closure;
       }
     } else {
-      delete closure;
+      _releaseClosure(closure);
     }
   }
 
@@ -202,8 +437,8 @@ void Relocalizer::prune() {
 
 void Relocalizer::clear() {
   CHRONOMETER_START(overall)
-  for(const Closure* closure: _closures) {
-    delete closure;
+  for(Closure* closure: _closures) {
+    _releaseClosure(closure);
   }
   _closures.clear();
   _mask_id_references_for_correspondences.clear();
@@ -211,28 +446,42 @@ void Relocalizer::clear() {
 }
 
 //ds retrieve correspondences from matches
-Closure::Correspondence* Relocalizer::_getCorrespondenceNN(const Closure::CandidateVector& matches_) {
-  assert(0 < matches_.size());
+Closure::Correspondence* Relocalizer::_getCorrespondenceNN(const Closure::CandidateVector::const_iterator& begin_,
+                                                           const Closure::CandidateVector::const_iterator& end_,
+                                                           const LocalMap* local_map_query_,
+                                                           const LocalMap* local_map_reference_) {
+  assert(begin_ != end_);
 
-  //ds point counts
-  std::multiset<Count> counts;
+  //ds point counts (few candidates per query landmark: linear search)
+  _reference_counts.clear();
 
   //ds best match and count so far
   const Closure::Candidate* match_best = nullptr;
   Count count_best = 0;
 
   //ds loop over the list and count entries
-  for (const Closure::Candidate& match: matches_) {
+  for (Closure::CandidateVector::const_iterator match = begin_; match != end_; ++match) {
+    const Identifier& identifier_reference = match->reference->identifier();
 
     //ds update count - if not in the mask
-    if (0 == _mask_id_references_for_correspondences.count(match.reference->identifier())) {
-      counts.insert(match.reference->identifier());
-      const Count count_current = counts.count(match.reference->identifier());
+    if (!std::binary_search(_mask_id_references_for_correspondences.begin(), _mask_id_references_for_correspondences.end(), identifier_reference)) {
+      Count count_current = 1;
+      bool is_counted = false;
+      for (std::pair<Identifier, Count>& reference_count: _reference_counts) {
+        if (reference_count.first == identifier_reference) {
+          count_current = ++reference_count.second;
+          is_counted    = true;
+          break;
+        }
+      }
+      if (!is_counted) {
+        _reference_counts.push_back(std::make_pair(identifier_reference, count_current));
+      }
 
       //ds if we get a better count
       if (count_best < count_current) {
         count_best = count_current;
-        match_best = &match;
+        match_best = &(*match);
       }
     }
   }
@@ -240,16 +489,53 @@ Closure::Correspondence* Relocalizer::_getCorrespondenceNN(const Closure::Candid
   //ds if a match was found with sufficient confidence
   if (match_best && count_best > _parameters->minimum_matches_per_correspondence) {
 
+    //ds registration operates on the landmark snapshots of both local maps
+    LocalMap::LandmarkStateMap::const_iterator state_query     = local_map_query_->landmarks().find(match_best->query->identifier());
+    LocalMap::LandmarkStateMap::const_iterator state_reference = local_map_reference_->landmarks().find(match_best->reference->identifier());
+    if (state_query == local_map_query_->landmarks().end() || state_reference == local_map_reference_->landmarks().end()) {
+      return nullptr;
+    }
+
     //ds block matching against this point by adding it to the mask
-    _mask_id_references_for_correspondences.insert(match_best->reference->identifier());
+    const Identifier& identifier_reference = match_best->reference->identifier();
+    _mask_id_references_for_correspondences.insert(std::lower_bound(_mask_id_references_for_correspondences.begin(),
+                                                                    _mask_id_references_for_correspondences.end(), identifier_reference), identifier_reference);
 
     //ds return the found correspondence
-    return new Closure::Correspondence(match_best->query,
-                                       match_best->reference,
-                                       count_best, static_cast<real>(count_best)/matches_.size());
+    return _createCorrespondence(match_best->query,
+                                 match_best->reference,
+                                 state_query->second.coordinates_in_local_map,
+                                 state_reference->second.coordinates_in_local_map,
+                                 count_best, static_cast<real>(count_best)/(end_-begin_));
   }
 
   //ds no match was found
   return nullptr;
 }
+
+Closure::Correspondence* Relocalizer::_createCorrespondence(Landmark* landmark_query_,
+                                                            Landmark* landmark_reference_,
+                                                            const PointCoordinates& coordinates_in_query_,
+                                                            const PointCoordinates& coordinates_in_reference_,
+                                                            const Count& matching_count_,
+                                                            const real& matching_ratio_) {
+  if (_correspondence_pool.empty()) {
+    return new Closure::Correspondence(landmark_query_, landmark_reference_, coordinates_in_query_, coordinates_in_reference_, matching_count_, matching_ratio_);
+  }
+
+  //ds reconstruct a recycled correspondence in place (trivially destructible)
+  Closure::Correspondence* correspondence = _correspondence_pool.back();
+  _correspondence_pool.pop_back();
+  return new (correspondence) Closure::Correspondence(landmark_query_, landmark_reference_, coordinates_in_query_, coordinates_in_reference_, matching_count_, matching_ratio_);
+}
+
+void Relocalizer::_releaseClosure(Closure* closure_) {
+
+  //ds correspondences of valid closures are owned by the world map
+  if (!closure_->is_valid) {
+    _correspondence_pool.insert(_correspondence_pool.end(), closure_->correspondences.begin(), closure_->correspondences.end());
+    closure_->correspondences.clear();
+  }
+  delete closure_;
+}
 }
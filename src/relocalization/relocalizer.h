@@ -1,12 +1,58 @@
 #pragma once
+#include <atomic>
 #include "aligners/xyz_aligner.h"
 #include "closure.h"
 
 namespace proslam {
 
 //ds this class computes potential loop closures for a given local map query (the extent of computed detail can be steered easily using the different methods)
+//ds each track (local maps sharing a root, e.g. a loaded map or a track fragment after a track break) has its own place database
 class Relocalizer {
 
+//ds exported types
+public:
+
+  //! @brief place database of a single track
+  struct PlaceDatabase {
+    PlaceDatabase(const LocalMap* local_map_root_): local_map_root(local_map_root_) {}
+
+    //! @brief root local map of the track at the time of creation (later local maps of the track are added to this database)
+    const LocalMap* local_map_root;
+
+    //! @brief visited places (= local maps), storing a descriptor vector for each place
+    HBSTTree tree;
+
+    //! @brief match buffer of the current query
+    HBSTTree::MatchVectorMap matches;
+  };
+
+  //! @brief appearance replaced by the place database when merging matchables (the absorbed matchable is already freed)
+  struct AppearanceMerge {
+    AppearanceMerge(Landmark* landmark_,
+                    const HBSTMatchable* matchable_absorbed_,
+                    HBSTMatchable* matchable_): landmark(landmark_),
+                                                matchable_absorbed(matchable_absorbed_),
+                                                matchable(matchable_) {}
+
+    Landmark* landmark;
+    const HBSTMatchable* matchable_absorbed;
+    HBSTMatchable* matchable;
+  };
+
+  //! @brief outcome of a query processed on a background thread (see relocalize), applied on the thread owning the world map
+  struct QueryResult {
+
+    //! @brief the query local map
+    LocalMap* local_map_query = nullptr;
+
+    //! @brief registered closures of the query, to be handed back through releaseClosures after their application
+    ClosurePointerVector closures;
+
+    //! @brief landmark appearance bookkeeping of the place database addition (see applyAppearanceUpdates)
+    std::vector<AppearanceMerge> appearance_merges;
+    bool is_place_rejected = false;
+  };
+
 //ds object management
 PROSLAM_MAKE_PROCESSING_CLASS(Relocalizer)
 
@@ -14,9 +60,22 @@ PROSLAM_MAKE_PROCESSING_CLASS(Relocalizer)
 public:
 
   //ds retrieve loop closure candidates for the given local map, containing descriptors for its landmarks
-  void detectClosures(LocalMap* local_map_query_);
+  //! @brief local maps of other tracks are always eligible references, the place databases are queried in parallel (number_of_query_threads)
+  //! @param[in] local_map_query_ the query local map
+  //! @param[in] add_to_database_ if false the local map is only matched against all database entries and its appearances are kept (e.g. localization only)
+  void detectClosures(LocalMap* local_map_query_, const bool& add_to_database_ = true);
+
+  //! @brief adds the appearances of the last query to the place database if the addition was deferred until after registration (place pruning or capacity)
+  //! @brief redundant places (valid closure to a database entry) and places beyond the capacity are not added and their appearances are freed
+  //! @param[in] local_map_query_ the query of the last detectClosures and registerClosures calls
+  void commitQuery(LocalMap* local_map_query_);
+
+  //! @brief adds a local map to the place database without querying for closures (e.g. local maps loaded from a map file)
+  //! @param[in] local_map_ local map with its appearances (consumed), must be added in order of local map identifiers
+  void add(LocalMap* local_map_);
 
   //ds geometric verification and determination of spatial relation between closure set
+  //! @brief candidates are distributed over the configured number of registration threads (one aligner per thread)
   void registerClosures();
 
   //ds clear currently available closure buffer
@@ -25,17 +84,76 @@ public:
   //! @brief keeps only a single closure, based on the maximum relative number of correspodences TODO add proper constraints
   void prune();
 
+  //! @brief detects, registers and commits a query without modifying any landmark (can run concurrently to the tracking)
+  //! @brief the landmark appearance bookkeeping is returned in the result instead, the closure buffer is moved into the result
+  //! @param[in] local_map_query_ the query local map (only its landmark snapshots and appearances are accessed)
+  //! @param[out] result_ closures and appearance updates of the query
+  void relocalize(LocalMap* local_map_query_, QueryResult& result_);
+
+  //! @brief applies the appearance bookkeeping of a query processed by relocalize, must be called by the thread owning the landmarks
+  void applyAppearanceUpdates(const QueryResult& result_) const;
+
+  //! @brief frees closures taken from the relocalizer (see relocalize), correspondences of invalid closures are reused
+  void releaseClosures(ClosurePointerVector& closures_);
+
 //ds getters/setters
 public:
 
   inline const ClosurePointerVector& closures() const {return _closures;}
+  inline const Count& numberOfRejectedPlaces() const {return _number_of_rejected_places;}
+
+  //! @brief number of places (local maps) in all place databases
+  const Count numberOfPlaces() const;
+  inline const Count numberOfPlaceDatabases() const {return _place_databases.size();}
+
+  //! @brief estimated memory footprint of the appearances stored in all place databases (can be queried while a relocalization is running)
+  inline const size_t memoryUsageBytes() const {return _number_of_stored_appearances*sizeof(HBSTMatchable);}
   XYZAlignerPtr aligner() {return _aligner;}
 
+  //! @brief worker pool the database queries and registrations are distributed over (serial processing without a pool)
+  void setWorkerPool(WorkerPool* worker_pool_);
+
+  //! @brief width of the extracted descriptors (see BaseFramePointGenerator::descriptorSizeBits), has to be set before configure
+  void setDescriptorSizeBits(const uint32_t& descriptor_size_bits_) {_descriptor_size_bits = descriptor_size_bits_;}
+
 //ds helpers
 protected:
 
   //ds retrieve correspondences from matches
-  inline Closure::Correspondence* _getCorrespondenceNN(const Closure::CandidateVector& matches_);
+  //! @param[in] begin_ first candidate of a query landmark
+  //! @param[in] end_ end of the candidates of the query landmark
+  //! @param[in] local_map_query_ query local map, providing the landmark snapshot of the query
+  //! @param[in] local_map_reference_ reference local map, providing the landmark snapshot of the reference
+  inline Closure::Correspondence* _getCorrespondenceNN(const Closure::CandidateVector::const_iterator& begin_,
+                                                       const Closure::CandidateVector::const_iterator& end_,
+                                                       const LocalMap* local_map_query_,
+                                                       const LocalMap* local_map_reference_);
+
+  //! @brief allocates a correspondence, reusing the memory of correspondences of rejected closures if available
+  inline Closure::Correspondence* _createCorrespondence(Landmark* landmark_query_,
+                                                        Landmark* landmark_reference_,
+                                                        const PointCoordinates& coordinates_in_query_,
+                                                        const PointCoordinates& coordinates_in_reference_,
+                                                        const Count& matching_count_,
+                                                        const real& matching_ratio_);
+
+  //! @brief true if queries are only matched in detectClosures and added in commitQuery
+  inline const bool _isDatabaseAdditionDeferred() const {return _parameters->enable_place_pruning || _parameters->maximum_number_of_places > 0;}
+
+  //! @brief frees a closure, recycling its correspondences if the closure has not been consumed by the world map
+  void _releaseClosure(Closure* closure_);
+
+  //! @brief evaluates the matches of a query against a single reference, adding a closure candidate if sufficient
+  void _evaluateReference(const LocalMap* local_map_query_,
+                          const LocalMap* local_map_reference_,
+                          const HBSTTree::MatchVector& matches_,
+                          const Count& number_of_query_matchables_);
+
+  //! @brief place database of the track with the given root local map (created if not existing)
+  PlaceDatabase* _getPlaceDatabase(const LocalMap* local_map_root_);
+
+  //ds updates the landmark appearances for matchables that were merged in the last addition to the place database
+  void _updateMergedAppearances(PlaceDatabase* place_database_, const Count& number_of_added_matchables_);
 
 protected:
 
@@ -45,14 +163,39 @@ protected:
   //ds local map to local map alignment
   XYZAlignerPtr _aligner = nullptr;
 
-  //ds database of visited places (= local maps), storing a descriptor vector for each place
-  HBSTTree _place_database;
+  //! @brief aligners of the registration threads (the first one is _aligner)
+  std::vector<XYZAlignerPtr> _aligners;
+
+  //! @brief worker pool of the assembly (not owned)
+  WorkerPool* _worker_pool = nullptr;
 
-  //ds local maps that have been added to the place database (in order of calls)
+  //! @brief result of the query processed by relocalize (appearance bookkeeping is collected instead of applied if set)
+  QueryResult* _query_result = nullptr;
+
+  //! @brief width of the extracted descriptors (defaults to the storage width)
+  uint32_t _descriptor_size_bits = SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS;
+
+  //! @brief place databases, one per track (in order of creation)
+  std::vector<PlaceDatabase*> _place_databases;
+
+  //ds local maps that have been queried or added (in order of calls, indexed by local map identifier - not all of them are in the place database)
   ConstLocalMapPointerVector _added_local_maps;
 
-  //ds correspondence retrieval buffer
-  std::set<Identifier> _mask_id_references_for_correspondences;
+  //! @brief number of local maps whose appearances were not added to the place database (redundant or capacity reached)
+  Count _number_of_rejected_places = 0;
+
+  //! @brief number of appearances in all place databases (merged appearances are counted once)
+  std::atomic<Count> _number_of_stored_appearances;
+
+  //ds correspondence retrieval buffer (sorted)
+  std::vector<Identifier> _mask_id_references_for_correspondences;
+
+  //! @brief candidate aggregation buffers, reused for all references and queries
+  Closure::CandidateVector _candidates;
+  std::vector<std::pair<Identifier, Count>> _reference_counts;
+
+  //! @brief correspondences of rejected closures available for reuse
+  Closure::CorrespondencePointerVector _correspondence_pool;
 
 private:
 
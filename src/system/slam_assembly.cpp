@@ -1,3 +1,5 @@
+#include <fstream>
+#include <algorithm>
 #include "slam_assembly.h"
 
 #include "srrg_messages/pinhole_image_message.h"
@@ -21,26 +23,40 @@ SLAMAssembly::SLAMAssembly(ParameterCollection* parameters_): _parameters(parame
                                                               _minimap_viewer(0),
 //                                                              _new_image_available(false),
                                                               _is_termination_requested(false),
-                                                              _is_viewer_open(false) {
+                                                              _is_viewer_open(false),
+                                                              _frames_to_extract(2),
+                                                              _frames_to_track(2),
+                                                              _is_pipeline_running(false),
+                                                              _is_prefetching_running(false),
+                                                              _is_prefetching_done(false),
+                                                              _image_buffers(64) {
   _synchronizer.reset();
   _processing_times_seconds.clear();
-
-  //ds reset all static object counters
-  Frame::reset();
-  FramePoint::reset();
-  LocalMap::reset();
-  Landmark::reset();
+  if (!_parameters->command_line_parameters->trajectory_stream_file_name.empty()) {
+    _trajectory_writer = new TrajectoryWriter(_parameters->command_line_parameters->trajectory_stream_file_name,
+                                              toTrajectoryFormat(_parameters->command_line_parameters->trajectory_stream_format));
+  }
   LOG_INFO(std::cerr << "SLAMAssembly::SLAMAssembly|constructed" << std::endl)
 }
 
 SLAMAssembly::~SLAMAssembly() {
   LOG_INFO(std::cerr << "SLAMAssembly::~SLAMAssembly|destroying assembly" << std::endl)
+  _stopPrefetching();
+  _stopPipeline();
+  _stopRelocalization();
+  try {
+    flushTrajectoryStream();
+  } catch (const std::runtime_error& exception_) {
+    LOG_ERROR(std::cerr << "SLAMAssembly::~SLAMAssembly|unable to complete the trajectory stream: " << exception_.what() << std::endl)
+  }
+  delete _trajectory_writer;
   delete _tracker;
   delete _graph_optimizer;
   delete _relocalizer;
   delete _world_map;
   delete _camera_left;
   delete _camera_right;
+  delete _worker_pool;
   _message_reader.close();
   _synchronizer.reset();
   LOG_INFO(std::cerr << "SLAMAssembly::~SLAMAssembly|destroyed" << std::endl)
@@ -58,15 +74,23 @@ void SLAMAssembly::_createStereoTracker(Camera* camera_left_, Camera* camera_rig
   camera_left_->setCameraMatrix(camera_left_->projectionMatrix().block<3,3>(0,0));
   camera_right_->setCameraMatrix(camera_left_->cameraMatrix());
 
+  //ds allocate the workers for concurrent streams, detection, linearization and landmark updates
+  _createWorkerPool(std::max({static_cast<Count>(_parameters->stereo_framepoint_generator_parameters->number_of_detection_threads),
+                              static_cast<Count>(_parameters->stereo_framepoint_generator_parameters->enable_concurrent_stream_processing? 2: 1),
+                              _parameters->stereo_tracker_parameters->aligner->number_of_linearization_threads,
+                              _parameters->stereo_tracker_parameters->number_of_landmark_update_threads}));
+
   //ds allocate and configure the framepoint generator
   StereoFramePointGenerator* framepoint_generator = new StereoFramePointGenerator(_parameters->stereo_framepoint_generator_parameters);
   framepoint_generator->setCameraLeft(camera_left_);
   framepoint_generator->setCameraRight(camera_right_);
+  framepoint_generator->setWorkerPool(_worker_pool);
   framepoint_generator->configure();
 
   //ds allocate and configure the aligner for motion estimation
   StereoUVAligner* pose_optimizer = new StereoUVAligner(_parameters->stereo_tracker_parameters->aligner);
   pose_optimizer->setMaximumReliableDepthMeters(_parameters->stereo_framepoint_generator_parameters->maximum_reliable_depth_meters);
+  pose_optimizer->setWorkerPool(_worker_pool);
   pose_optimizer->configure();
 
   //ds allocate and configure the tracker
@@ -75,12 +99,14 @@ void SLAMAssembly::_createStereoTracker(Camera* camera_left_, Camera* camera_rig
   tracker->setCameraRight(camera_right_);
   tracker->setFramePointGenerator(framepoint_generator);
   tracker->setAligner(pose_optimizer);
+  tracker->setWorkerPool(_worker_pool);
   tracker->configure();
   _tracker = tracker;
   _tracker->setWorldMap(_world_map);
 
   //ds configure components
   _graph_optimizer->configure();
+  _relocalizer->setDescriptorSizeBits(framepoint_generator->descriptorSizeBits());
   _relocalizer->configure();
 }
 
@@ -89,13 +115,21 @@ void SLAMAssembly::_createDepthTracker(Camera* camera_left_, Camera* camera_righ
   //ds allocate and configure the framepoint generator
   _camera_left = camera_left_;
   _camera_right = camera_right_;
+
+  //ds allocate the workers for registration, detection, linearization and landmark updates
+  _createWorkerPool(std::max({static_cast<Count>(_parameters->depth_framepoint_generator_parameters->number_of_detection_threads),
+                              static_cast<Count>(_parameters->depth_framepoint_generator_parameters->number_of_registration_threads),
+                              _parameters->depth_tracker_parameters->aligner->number_of_linearization_threads,
+                              _parameters->depth_tracker_parameters->number_of_landmark_update_threads}));
   DepthFramePointGenerator* framepoint_generator = new DepthFramePointGenerator(_parameters->depth_framepoint_generator_parameters);
   framepoint_generator->setCameraLeft(camera_left_);
   framepoint_generator->setCameraRight(camera_right_);
+  framepoint_generator->setWorkerPool(_worker_pool);
   framepoint_generator->configure();
 
   //ds allocate and configure the aligner for motion estimation
   UVDAligner* pose_optimizer = new UVDAligner(_parameters->depth_tracker_parameters->aligner);
+  pose_optimizer->setWorkerPool(_worker_pool);
   pose_optimizer->configure();
 
   //ds allocate and configure the tracker
@@ -104,15 +138,35 @@ void SLAMAssembly::_createDepthTracker(Camera* camera_left_, Camera* camera_righ
   tracker->setDepthCamera(camera_right_);
   tracker->setFramePointGenerator(framepoint_generator);
   tracker->setAligner(pose_optimizer);
+  tracker->setWorkerPool(_worker_pool);
   tracker->configure();
   _tracker = tracker;
   _tracker->setWorldMap(_world_map);
 
   //ds configure components
   _graph_optimizer->configure();
+  _relocalizer->setDescriptorSizeBits(framepoint_generator->descriptorSizeBits());
   _relocalizer->configure();
 }
 
+void SLAMAssembly::_createWorkerPool(const Count& maximum_number_of_tasks_front_end_) {
+  if (_worker_pool) {
+    return;
+  }
+
+  //ds the submitting thread always processes tasks of its own loop, hence one worker less than the widest loop
+  const Count maximum_number_of_tasks = std::max({maximum_number_of_tasks_front_end_,
+                                                  _parameters->relocalizer_parameters->number_of_query_threads,
+                                                  _parameters->relocalizer_parameters->number_of_registration_threads,
+                                                  _parameters->relocalizer_parameters->aligner->number_of_linearization_threads,
+                                                  _parameters->graph_optimizer_parameters->number_of_local_map_update_threads,
+                                                  static_cast<Count>(1)});
+  _worker_pool = new WorkerPool(maximum_number_of_tasks-1);
+  _relocalizer->setWorkerPool(_worker_pool);
+  _graph_optimizer->setWorkerPool(_worker_pool);
+  LOG_INFO(std::cerr << "SLAMAssembly::_createWorkerPool|number of workers: " << _worker_pool->numberOfWorkers() << std::endl)
+}
+
 void SLAMAssembly::loadCamerasFromMessageFile() {
 
   //ds configure sensor message source
@@ -194,9 +248,9 @@ void SLAMAssembly::loadCamerasFromMessageFile() {
     //ds set left
     _camera_left->setProjectionMatrix(projection_matrix);
     LOG_DEBUG(std::cerr << "projection matrix LEFT: " << std::endl;)
-    LOG_DEBUG(std::printf("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(0,0), projection_matrix(0,1), projection_matrix(0,2), projection_matrix(0,3)))
-    LOG_DEBUG(std::printf("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(1,0), projection_matrix(1,1), projection_matrix(1,2), projection_matrix(1,3)))
-    LOG_DEBUG(std::printf("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(2,0), projection_matrix(2,1), projection_matrix(2,2), projection_matrix(2,3)))
+    LOG_DEBUG(Logger::print("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(0,0), projection_matrix(0,1), projection_matrix(0,2), projection_matrix(0,3)))
+    LOG_DEBUG(Logger::print("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(1,0), projection_matrix(1,1), projection_matrix(1,2), projection_matrix(1,3)))
+    LOG_DEBUG(Logger::print("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(2,0), projection_matrix(2,1), projection_matrix(2,2), projection_matrix(2,3)))
 
     //ds sanity check
     if ((_camera_left->cameraMatrix()-_camera_right->cameraMatrix()).squaredNorm() != 0) {
@@ -209,9 +263,9 @@ void SLAMAssembly::loadCamerasFromMessageFile() {
     _camera_right->setProjectionMatrix(projection_matrix);
     _camera_right->setBaselineHomogeneous(projection_matrix.col(3));
     LOG_DEBUG(std::cerr << "projection matrix RIGHT: " << std::endl;)
-    LOG_DEBUG(std::printf("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(0,0), projection_matrix(0,1), projection_matrix(0,2), projection_matrix(0,3) ))
-    LOG_DEBUG(std::printf("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(1,0), projection_matrix(1,1), projection_matrix(1,2), projection_matrix(1,3)))
-    LOG_DEBUG(std::printf("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(2,0), projection_matrix(2,1), projection_matrix(2,2), projection_matrix(2,3)))
+    LOG_DEBUG(Logger::print("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(0,0), projection_matrix(0,1), projection_matrix(0,2), projection_matrix(0,3) ))
+    LOG_DEBUG(Logger::print("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(1,0), projection_matrix(1,1), projection_matrix(1,2), projection_matrix(1,3)))
+    LOG_DEBUG(Logger::print("%11.6f %11.6f %11.6f %11.6f\n", projection_matrix(2,0), projection_matrix(2,1), projection_matrix(2,2), projection_matrix(2,3)))
   }
 
   //ds load cameras to assembly
@@ -254,6 +308,9 @@ void SLAMAssembly::initializeGUI(std::shared_ptr<QApplication> ui_server_) {
   if (_parameters->command_line_parameters->option_use_gui) {
     _ui_server = ui_server_;
 
+    //ds framepoint projection estimates are only stored for display
+    _world_map->setIsVisualizationDataEnabled(true);
+
     //ds allocate internal viewers (with new to keep Eigen's memory sane)
     _image_viewer = std::shared_ptr<ImageViewer>(new ImageViewer(_parameters->image_viewer_parameters));
     _map_viewer   = std::shared_ptr<MapViewer>(new MapViewer(_parameters->map_viewer_parameters));
@@ -351,6 +408,257 @@ void SLAMAssembly::writePoseGraphToFile(const std::string& file_name_) const {
   }
 }
 
+void SLAMAssembly::writeMap(const std::string& file_name_) const {
+  if (_world_map) {
+    _world_map->writeMap(file_name_);
+  }
+}
+
+void SLAMAssembly::_applyClosures(LocalMap* local_map_query_, const ClosurePointerVector& closures_) {
+
+  //ds closures of a query that is not connected to the current track anymore (track broke while matching or postponed query) are dropped
+  const bool is_on_current_track = (local_map_query_ && local_map_query_->keyframe()->root() == _world_map->currentFrame()->root());
+  const Count number_of_merged_tracks = _world_map->numberOfMergedTracks();
+
+  //ds check the closures
+  for(Closure* closure: closures_) {
+    if (closure->is_valid && !is_on_current_track) {
+      closure->is_valid = false;
+    }
+    if (closure->is_valid) {
+      assert(local_map_query_ == closure->local_map_query);
+
+      //ds add loop closure constraint (merging corresponding landmarks)
+      _world_map->addLoopClosure(local_map_query_,
+                                 closure->local_map_reference,
+                                 closure->query_to_reference,
+                                 closure->correspondences,
+                                 closure->icp_inlier_ratio);
+      _local_map_last_relocalized = local_map_query_;
+      if (_parameters->command_line_parameters->option_use_gui) {
+        for (const Closure::Correspondence* match: closure->correspondences) {
+          _world_map->landmarks().at(match->query->identifier())->setIsInLoopClosureQuery(true);
+          _world_map->landmarks().at(match->reference->identifier())->setIsInLoopClosureReference(true);
+        }
+      }
+    }
+  }
+
+  //ds a merged track moved frames and landmarks that are already contained in the pose graph
+  if (_world_map->numberOfMergedTracks() != number_of_merged_tracks) {
+    _graph_optimizer->updateEstimates();
+  }
+}
+
+void SLAMAssembly::_queueRelocalization(LocalMap* local_map_query_) {
+  if (!_relocalization_worker.joinable()) {
+    _relocalization_worker = std::thread([this] {_relocalizeQueuedLocalMaps();});
+  }
+  std::lock_guard<std::mutex> lock(_mutex_relocalization);
+  _local_maps_to_relocalize.push_back(local_map_query_);
+  _condition_relocalization.notify_all();
+}
+
+void SLAMAssembly::_relocalizeQueuedLocalMaps() {
+  std::unique_lock<std::mutex> lock(_mutex_relocalization);
+  while (true) {
+    _condition_relocalization.wait(lock, [this] {return _is_relocalization_stopped || !_local_maps_to_relocalize.empty();});
+    if (_is_relocalization_stopped) {
+      return;
+    }
+    LocalMap* local_map_query = _local_maps_to_relocalize.front();
+    _local_maps_to_relocalize.pop_front();
+    ClosurePointerVector closures_to_release;
+    closures_to_release.swap(_closures_to_release);
+    _is_relocalization_running = true;
+    lock.unlock();
+
+    //ds localize in database - the landmarks are not modified, the closures and appearance updates are applied by the processing thread
+    _relocalizer->releaseClosures(closures_to_release);
+    Relocalizer::QueryResult result;
+    _relocalizer->relocalize(local_map_query, result);
+
+    lock.lock();
+    _relocalization_results.push_back(std::move(result));
+    _is_relocalization_running = false;
+    _condition_relocalization.notify_all();
+  }
+}
+
+const bool SLAMAssembly::_collectRelocalization(const bool& wait_) {
+  std::deque<Relocalizer::QueryResult> results;
+  {
+    std::unique_lock<std::mutex> lock(_mutex_relocalization);
+    if (wait_) {
+      _condition_relocalization.wait(lock, [this] {return _local_maps_to_relocalize.empty() && !_is_relocalization_running;});
+    } else if (!_local_maps_to_relocalize.empty() || _is_relocalization_running) {
+
+      //ds applying closures may merge tracks (re-rooting local maps), which a running query reads
+      return false;
+    }
+    results.swap(_relocalization_results);
+  }
+
+  //ds the worker is idle until the next local map is queued by this thread: apply the results in creation order
+  ClosurePointerVector closures_applied;
+  for (Relocalizer::QueryResult& result: results) {
+    _relocalizer->applyAppearanceUpdates(result);
+    _applyClosures(result.local_map_query, result.closures);
+    closures_applied.insert(closures_applied.end(), result.closures.begin(), result.closures.end());
+  }
+  if (!closures_applied.empty()) {
+    std::lock_guard<std::mutex> lock(_mutex_relocalization);
+    _closures_to_release.insert(_closures_to_release.end(), closures_applied.begin(), closures_applied.end());
+  }
+  return true;
+}
+
+void SLAMAssembly::_stopRelocalization() {
+  if (!_relocalization_worker.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_mutex_relocalization);
+    _is_relocalization_stopped = true;
+    _condition_relocalization.notify_all();
+  }
+  _relocalization_worker.join();
+  _is_relocalization_stopped = false;
+
+  //ds queued local maps are not added to the place database anymore
+  for (LocalMap* local_map: _local_maps_to_relocalize) {
+    local_map->releaseAppearances();
+  }
+  _local_maps_to_relocalize.clear();
+
+  //ds discard the results: closures are not consumed by the world map, appearances are still kept consistent
+  for (Relocalizer::QueryResult& result: _relocalization_results) {
+    _relocalizer->applyAppearanceUpdates(result);
+    for (Closure* closure: result.closures) {
+      closure->is_valid = false;
+    }
+    _relocalizer->releaseClosures(result.closures);
+  }
+  _relocalization_results.clear();
+  _relocalizer->releaseClosures(_closures_to_release);
+}
+
+void SLAMAssembly::_localize() {
+
+  //ds generate a query local map from the current track
+  if (_map_viewer) {_map_viewer->lock();}
+  const bool created_local_map = _world_map->createLocalMap(_parameters->command_line_parameters->option_drop_framepoints);
+  if (_map_viewer) {_map_viewer->unlock();}
+  if (!created_local_map) {
+    return;
+  }
+  LocalMap* local_map_query = _world_map->currentLocalMap();
+
+  //ds match the query against the loaded map only (the query is not added to the database)
+  _relocalizer->detectClosures(local_map_query, false);
+  _relocalizer->registerClosures();
+
+  //ds pick the best closure
+  const Closure* closure_best = nullptr;
+  for (Closure* closure: _relocalizer->closures()) {
+    if (closure->is_valid && (!closure_best || closure->icp_inlier_ratio > closure_best->icp_inlier_ratio)) {
+      closure_best = closure;
+    }
+  }
+
+  if (_map_viewer) {_map_viewer->lock();}
+
+  //ds anchor the track in the loaded map
+  if (closure_best) {
+    const TransformMatrix3D query_to_world = closure_best->local_map_reference->localMapToWorld()*closure_best->query_to_reference;
+    _world_map->anchorTrack(query_to_world*local_map_query->worldToLocalMap());
+    LOG_INFO(std::cerr << "SLAMAssembly::_localize|localized in local map: " << closure_best->local_map_reference->identifier()
+                       << " (inlier ratio: " << closure_best->icp_inlier_ratio << ")" << std::endl)
+  }
+
+  //ds closures are not consumed by the world map: invalidate them to free their correspondences
+  for (Closure* closure: _relocalizer->closures()) {
+    closure->is_valid = false;
+  }
+  _relocalizer->clear();
+
+  //ds discard the query
+  _world_map->removeCurrentLocalMap();
+  if (_map_viewer) {_map_viewer->unlock();}
+}
+
+void SLAMAssembly::loadMap(const std::string& file_name_) {
+  if (!_camera_left || !_camera_right) {
+    throw std::runtime_error("SLAMAssembly::loadMap|cameras have to be loaded before loading a map");
+  }
+
+  //ds local map identifiers must match the place database indices - only a fresh system can load a map
+  if (!_world_map->localMaps().empty() || _number_of_processed_frames > 0) {
+    throw std::runtime_error("SLAMAssembly::loadMap|a map can only be loaded before processing");
+  }
+  _world_map->readMap(file_name_, _camera_left, _camera_right);
+  _world_map->setIsLocalizationOnly(_parameters->command_line_parameters->option_localization_only);
+
+  //ds populate the place database with the loaded local maps (without querying)
+  if (!_parameters->command_line_parameters->option_disable_relocalization) {
+    for (LocalMap* local_map: _world_map->localMaps()) {
+      _relocalizer->add(local_map);
+    }
+  }
+}
+
+void SLAMAssembly::mergeMap(const std::string& file_name_) {
+  if (_world_map->localMaps().empty()) {
+    throw std::runtime_error("SLAMAssembly::mergeMap|a map has to be loaded before merging");
+  }
+  if (_number_of_processed_frames > 0) {
+    throw std::runtime_error("SLAMAssembly::mergeMap|a map can only be merged before processing");
+  }
+  const Count number_of_local_maps_present = _world_map->localMaps().size();
+  const Count number_of_merged_tracks      = _world_map->numberOfMergedTracks();
+  _world_map->readMap(file_name_, _camera_left, _camera_right);
+
+  //ds query each new local map against all present tracks before adding it (only references on other tracks are eligible)
+  for (Index index = number_of_local_maps_present; index < _world_map->localMaps().size(); ++index) {
+    LocalMap* local_map_query = _world_map->localMaps()[index];
+    _relocalizer->detectClosures(local_map_query, false);
+    _relocalizer->registerClosures();
+
+    //ds pick the best closure
+    Closure* closure_best = nullptr;
+    for (Closure* closure: _relocalizer->closures()) {
+      if (closure->is_valid && (!closure_best || closure->icp_inlier_ratio > closure_best->icp_inlier_ratio)) {
+        closure_best = closure;
+      }
+    }
+
+    //ds merge the tracks (the new track is moved into the reference track) and the corresponding landmarks
+    if (closure_best) {
+      _world_map->addLoopClosure(local_map_query,
+                                 closure_best->local_map_reference,
+                                 closure_best->query_to_reference,
+                                 closure_best->correspondences,
+                                 closure_best->icp_inlier_ratio);
+      _world_map->mergeLandmarks(local_map_query->closures());
+      LOG_INFO(std::cerr << "SLAMAssembly::mergeMap|merged local map: " << local_map_query->identifier()
+                         << " with local map: " << closure_best->local_map_reference->identifier()
+                         << " (inlier ratio: " << closure_best->icp_inlier_ratio << ")" << std::endl)
+    }
+
+    //ds only the best closure is consumed by the world map: invalidate the others to free their correspondences
+    for (Closure* closure: _relocalizer->closures()) {
+      if (closure != closure_best) {
+        closure->is_valid = false;
+      }
+    }
+    _relocalizer->clear();
+    _relocalizer->add(local_map_query);
+  }
+  if (_world_map->numberOfMergedTracks() == number_of_merged_tracks) {
+    LOG_WARNING(std::cerr << "SLAMAssembly::mergeMap|no loop closure found to the present map, keeping separate track: " << file_name_ << std::endl)
+  }
+}
+
 void SLAMAssembly::playbackMessageFile() {
 
   //ds restart stream
@@ -367,7 +675,181 @@ void SLAMAssembly::playbackMessageFile() {
   //ds visualization/start point
   const TransformMatrix3D robot_to_camera_left(_camera_left->robotToCamera());
 
+  //ds pipelined processing: the next frames are preprocessed and described by the pipeline worker while the current frame is tracked
+  const bool enable_pipelining = _parameters->command_line_parameters->option_enable_pipelining;
+  Count number_of_frames_in_pipeline = 0;
+  if (enable_pipelining) {
+    _startPipeline();
+  }
+
+  //ds processes a frame with preprocessed images (the features are already available in pipelined mode)
+  auto process_frame = [&](PipelineFrame& frame_) {
+
+    //ds check if first frame and odometry is available
+    if (_world_map->frames().size() == 0 && frame_.has_odometry) {
+      _world_map->setRobotToWorld(frame_.odometry*robot_to_camera_left);
+      if (_parameters->command_line_parameters->option_use_gui) {
+        _map_viewer->setWorldToRobotOrigin(_world_map->robotToWorld().inverse());
+      }
+    }
+
+    //ds start measuring time
+    const double time_start_seconds = srrg_core::getTime();
+
+    //ds progress SLAM with the new images
+    process(frame_.intensity_image_left,
+            frame_.intensity_image_right,
+            frame_.timestamp_image_left_seconds,
+            frame_.has_odometry && _parameters->command_line_parameters->option_use_odometry,
+            frame_.odometry,
+            (enable_pipelining)? &frame_.features: nullptr);
+
+    //ds update timing stats
+    const double processing_time_seconds = srrg_core::getTime()-time_start_seconds;
+    _processing_times_seconds.push_back(processing_time_seconds);
+    _processing_time_total_seconds  += processing_time_seconds;
+    processing_time_seconds_current += processing_time_seconds;
+    ++_number_of_processed_frames;
+    ++number_of_processed_frames_current;
+    _current_fps = _number_of_processed_frames/_processing_time_total_seconds;
+
+    //ds record ground truth history for error computation
+    if (frame_.has_odometry) {
+      _world_map->setRobotToWorldGroundTruth(frame_.odometry*robot_to_camera_left);
+    }
+
+    //ds runtime info
+    if (processing_time_seconds_current > runtime_info_update_frequency_seconds) {
+
+      //ds runtime info - depending on set modes and available information
+      updateMemoryUsage();
+      if (!_parameters->command_line_parameters->option_disable_relocalization && !_world_map->localMaps().empty()) {
+        LOG_INFO(Logger::print("SLAMAssembly::playbackMessageFile|frames: %5lu <FPS: %6.2f>|memory (MB): %7.1f|landmarks: %6lu|local maps: %4lu (%3.2f)|closures: %3lu (%3.2f)\n",
+                    _number_of_processed_frames,
+                    number_of_processed_frames_current/processing_time_seconds_current,
+                    _memory_usage.total()/1e6,
+                    _world_map->landmarks().size(),
+                    _world_map->localMaps().size(),
+                    _world_map->localMaps().size()/static_cast<real>(_number_of_processed_frames),
+                    _world_map->numberOfClosures(),
+                    _world_map->numberOfClosures()/static_cast<real>(_world_map->localMaps().size())))
+      } else {
+        LOG_INFO(Logger::print("SLAMAssembly::playbackMessageFile|frames: %5lu <FPS: %6.2f>|memory (MB): %7.1f|landmarks: %6lu|map updates: %3lu\n",
+                    _number_of_processed_frames,
+                    number_of_processed_frames_current/processing_time_seconds_current,
+                    _memory_usage.total()/1e6,
+                    _world_map->landmarks().size(),
+                    _graph_optimizer->numberOfOptimizations()))
+      }
+
+      //ds reset stats for new measurement window
+      processing_time_seconds_current    = 0;
+      number_of_processed_frames_current = 0;
+    }
+
+    //ds update gui (no effect if no GUI is active)
+    updateGUI();
+  };
+
+  //ds prefetching: a reader thread decodes and preprocesses the next frames
+  const Count& number_of_prefetched_frames = _parameters->command_line_parameters->number_of_prefetched_frames;
+  if (number_of_prefetched_frames > 0) {
+    _startPrefetching(number_of_prefetched_frames);
+  }
+
+  //ds real-time mode: the frames are played back at the rate they were recorded, frames delayed beyond the latency budget are dropped
+  const real& latency_budget_seconds = _parameters->command_line_parameters->latency_budget_seconds;
+  double time_playback_start_seconds = 0;
+  double timestamp_playback_start_seconds = 0;
+  bool is_playback_clock_started = false;
+
   //ds start playback
+  PipelineFrame frame;
+  while (!_is_termination_requested) {
+
+    //ds obtain the next synchronized image pair (already preprocessed if prefetched)
+    if (number_of_prefetched_frames > 0) {
+
+      //ds sleep until the reader delivers the next frame or has read all frames
+      if (!_frames_prefetched->waitAndPop(frame, [this] {return !_is_prefetching_done.load();})) {
+        break;
+      }
+    } else if (!_readFrame(frame)) {
+      break;
+    }
+
+    //ds real-time mode: delay of the frame with respect to its recording time (negative if the frame is not yet due)
+    if (latency_budget_seconds > 0) {
+      if (!is_playback_clock_started) {
+        time_playback_start_seconds      = srrg_core::getTime();
+        timestamp_playback_start_seconds = frame.timestamp_image_left_seconds;
+        is_playback_clock_started        = true;
+      }
+      const double delay_seconds = (srrg_core::getTime()-time_playback_start_seconds)
+                                  -(frame.timestamp_image_left_seconds-timestamp_playback_start_seconds);
+      if (delay_seconds < 0) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(-delay_seconds));
+      } else if (delay_seconds > latency_budget_seconds) {
+
+        //ds drop the stale frame in favour of the next one
+        ++_number_of_dropped_frames;
+        continue;
+      }
+    }
+
+    if (enable_pipelining) {
+
+      //ds hand the frame over to the pipeline worker - tracking extracted frames while the pipeline is full
+      //ds a full pipeline always delivers an extracted frame, hence we can sleep until it is ready
+      PipelineFrame frame_extracted;
+      while (!_frames_to_extract.push(std::move(frame))) {
+        if (_frames_to_track.waitAndPop(frame_extracted, [this] {return _is_pipeline_running.load();})) {
+          process_frame(frame_extracted);
+          --number_of_frames_in_pipeline;
+        }
+      }
+      ++number_of_frames_in_pipeline;
+
+      //ds track all frames whose features are ready (in image order)
+      while (_frames_to_track.pop(frame_extracted)) {
+        process_frame(frame_extracted);
+        --number_of_frames_in_pipeline;
+      }
+    } else {
+      if (!frame.is_preprocessed) {
+        _preprocessImages(frame);
+      }
+      process_frame(frame);
+    }
+  }
+  _stopPrefetching();
+
+  //ds track the frames remaining in the pipeline
+  if (enable_pipelining) {
+    PipelineFrame frame_extracted;
+    while (number_of_frames_in_pipeline > 0 && !_is_termination_requested) {
+      if (_frames_to_track.waitAndPop(frame_extracted, [this] {return _is_pipeline_running.load();})) {
+        process_frame(frame_extracted);
+        --number_of_frames_in_pipeline;
+      }
+    }
+    _stopPipeline();
+  }
+  _message_reader.close();
+  finish();
+  LOG_INFO(std::cerr << "SLAMAssembly::playbackMessageFile|dataset completed" << std::endl)
+}
+
+void SLAMAssembly::finish() {
+
+  //ds apply the last asynchronous relocalization and optimization results (if any)
+  _collectRelocalization(true);
+  _graph_optimizer->collectOptimization(_world_map);
+  updateMemoryUsage();
+  flushTrajectoryStream();
+}
+
+const bool SLAMAssembly::_readFrame(PipelineFrame& frame_) {
   srrg_core::BaseMessage* message = 0;
   while ((message = _message_reader.readMessage())) {
     srrg_core::BaseSensorMessage* sensor_message = dynamic_cast<srrg_core::BaseSensorMessage*>(message);
@@ -386,115 +868,285 @@ void SLAMAssembly::playbackMessageFile() {
     //ds if we have a synchronized package of sensor messages ready
     if (_synchronizer.messagesReady()) {
 
-      //ds check if termination is requested
-      if (_is_termination_requested) {
-        break;
-      }
-
-      //ds buffer sensor data
+      //ds buffer sensor data (the frame keeps references to the images)
       srrg_core::PinholeImageMessage* image_message_left  = dynamic_cast<srrg_core::PinholeImageMessage*>(_synchronizer.messages()[0].get());
       srrg_core::PinholeImageMessage* image_message_right = dynamic_cast<srrg_core::PinholeImageMessage*>(_synchronizer.messages()[1].get());
+      frame_.intensity_image_left         = image_message_left->image();
+      frame_.intensity_image_right        = image_message_right->image();
+      frame_.timestamp_image_left_seconds = image_message_left->timestamp();
+      frame_.has_odometry                 = image_message_left->hasOdom();
+      frame_.odometry                     = image_message_left->odometry().cast<real>();
+      frame_.is_preprocessed              = false;
+      image_message_left->release();
+      image_message_right->release();
+      _synchronizer.reset();
+      return true;
+    }
+  }
+  return false;
+}
 
-      //ds buffer images
-      cv::Mat intensity_image_left_rectified;
-      if(image_message_left->image().type() == CV_8UC3){
-        cvtColor(image_message_left->image(), intensity_image_left_rectified, CV_BGR2GRAY);
-      } else {
-        intensity_image_left_rectified = image_message_left->image();
-      }
-      cv::Mat intensity_image_right_rectified;
-      if (_parameters->command_line_parameters->tracker_mode == CommandLineParameters::TrackerMode::RGB_STEREO && image_message_right->image().type() == CV_8UC3) {
-        cvtColor(image_message_right->image(), intensity_image_right_rectified, CV_BGR2GRAY);
-      } else {
-        intensity_image_right_rectified = image_message_right->image();
-      }
+void SLAMAssembly::_preprocessImages(PipelineFrame& frame_) {
+  const bool is_stereo = (_parameters->command_line_parameters->tracker_mode == CommandLineParameters::TrackerMode::RGB_STEREO);
 
-      //ds preprocess the images if desired
-      if (_parameters->command_line_parameters->option_equalize_histogram) {
-        cv::equalizeHist(intensity_image_left_rectified, intensity_image_left_rectified);
-        if (_parameters->command_line_parameters->tracker_mode == CommandLineParameters::TrackerMode::RGB_STEREO) {
-          cv::equalizeHist(intensity_image_right_rectified, intensity_image_right_rectified);
-        }
-      }
+  //ds convert color images (into recycled buffers)
+  if (frame_.intensity_image_left.type() == CV_8UC3) {
+    cv::Mat intensity_image_left_gray(_image_buffers.acquire(frame_.intensity_image_left.rows, frame_.intensity_image_left.cols, CV_8UC1));
+    cvtColor(frame_.intensity_image_left, intensity_image_left_gray, CV_BGR2GRAY);
+    frame_.intensity_image_left = intensity_image_left_gray;
+  }
+  if (is_stereo && frame_.intensity_image_right.type() == CV_8UC3) {
+    cv::Mat intensity_image_right_gray(_image_buffers.acquire(frame_.intensity_image_right.rows, frame_.intensity_image_right.cols, CV_8UC1));
+    cvtColor(frame_.intensity_image_right, intensity_image_right_gray, CV_BGR2GRAY);
+    frame_.intensity_image_right = intensity_image_right_gray;
+  }
 
-      //ds check if first frame and odometry is available
-      if (_world_map->frames().size() == 0 && image_message_left->hasOdom()) {
-        _world_map->setRobotToWorld(image_message_left->odometry().cast<real>()*robot_to_camera_left);
-        if (_parameters->command_line_parameters->option_use_gui) {
-          _map_viewer->setWorldToRobotOrigin(_world_map->robotToWorld().inverse());
-        }
-      }
+  //ds preprocess the images if desired
+  if (_parameters->command_line_parameters->option_equalize_histogram) {
+    cv::equalizeHist(frame_.intensity_image_left, frame_.intensity_image_left);
+    if (is_stereo) {
+      cv::equalizeHist(frame_.intensity_image_right, frame_.intensity_image_right);
+    }
+  }
+  frame_.is_preprocessed = true;
+}
 
-      //ds start measuring time
-      const double time_start_seconds = srrg_core::getTime();
-
-      //ds progress SLAM with the new images
-      process(intensity_image_left_rectified,
-              intensity_image_right_rectified,
-              image_message_left->timestamp(),
-              image_message_left->hasOdom() && _parameters->command_line_parameters->option_use_odometry,
-              image_message_left->odometry().cast<real>());
-
-      //ds update timing stats
-      const double processing_time_seconds = srrg_core::getTime()-time_start_seconds;
-      _processing_times_seconds.push_back(processing_time_seconds);
-      _processing_time_total_seconds  += processing_time_seconds;
-      processing_time_seconds_current += processing_time_seconds;
-      ++_number_of_processed_frames;
-      ++number_of_processed_frames_current;
-      _current_fps = _number_of_processed_frames/_processing_time_total_seconds;
-
-      //ds record ground truth history for error computation
-      if (image_message_left->hasOdom()) {
-        _world_map->setRobotToWorldGroundTruth(image_message_left->odometry().cast<real>()*robot_to_camera_left);
+void SLAMAssembly::_startPrefetching(const Count& number_of_frames_) {
+  _frames_prefetched      = new PipelineFrameQueue(number_of_frames_);
+  _is_prefetching_running = true;
+  _is_prefetching_done    = false;
+  _prefetching_worker     = std::thread([this] {
+    PipelineFrame frame;
+    while (_is_prefetching_running && _readFrame(frame)) {
+      _preprocessImages(frame);
+
+      //ds sleep while the queue is full
+      if (!_frames_prefetched->waitAndPush(std::move(frame), [this] {return _is_prefetching_running.load();})) {
+        break;
       }
+    }
+    _is_prefetching_done = true;
+    _frames_prefetched->wakeUp();
+  });
+  LOG_INFO(std::cerr << "SLAMAssembly::_startPrefetching|prefetching frames: " << number_of_frames_ << std::endl)
+}
 
-      //ds runtime info
-      if (processing_time_seconds_current > runtime_info_update_frequency_seconds) {
-
-        //ds runtime info - depending on set modes and available information
-        if (!_parameters->command_line_parameters->option_disable_relocalization && !_world_map->localMaps().empty()) {
-          LOG_INFO(std::printf("SLAMAssembly::playbackMessageFile|frames: %5lu <FPS: %6.2f>|landmarks: %6lu|local maps: %4lu (%3.2f)|closures: %3lu (%3.2f)\n",
-                      _number_of_processed_frames,
-                      number_of_processed_frames_current/processing_time_seconds_current,
-                      _world_map->landmarks().size(),
-                      _world_map->localMaps().size(),
-                      _world_map->localMaps().size()/static_cast<real>(_number_of_processed_frames),
-                      _world_map->numberOfClosures(),
-                      _world_map->numberOfClosures()/static_cast<real>(_world_map->localMaps().size())))
-        } else {
-          LOG_INFO(std::printf("SLAMAssembly::playbackMessageFile|frames: %5lu <FPS: %6.2f>|landmarks: %6lu|map updates: %3lu\n",
-                      _number_of_processed_frames,
-                      number_of_processed_frames_current/processing_time_seconds_current,
-                      _world_map->landmarks().size(),
-                      _graph_optimizer->numberOfOptimizations()))
-        }
+void SLAMAssembly::_stopPrefetching() {
+  if (!_prefetching_worker.joinable()) {
+    return;
+  }
+  _is_prefetching_running = false;
+  _frames_prefetched->wakeUp();
+  _prefetching_worker.join();
+  delete _frames_prefetched;
+  _frames_prefetched = nullptr;
+}
 
-        //ds reset stats for new measurement window
-        processing_time_seconds_current    = 0;
-        number_of_processed_frames_current = 0;
-      }
-      image_message_left->release();
-      image_message_right->release();
-      _synchronizer.reset();
+void SLAMAssembly::_startPipeline() {
+  StereoFramePointGenerator* framepoint_generator = dynamic_cast<StereoFramePointGenerator*>(_tracker->framepointGenerator());
+  if (!framepoint_generator) {
+    throw std::runtime_error("SLAMAssembly::_startPipeline|pipelined processing requires a stereo framepoint generator");
+  }
+  _is_pipeline_running = true;
+  _pipeline_worker     = std::thread([this, framepoint_generator] {
+    PipelineFrame frame;
+    auto is_running = [this] {return _is_pipeline_running.load();};
 
-      //ds update gui (no effect if no GUI is active)
-      updateGUI();
+    //ds sleep while there is nothing to extract or the extracted frames are not yet consumed (remaining frames are discarded on stop)
+    while (_frames_to_extract.waitAndPop(frame, is_running) && _is_pipeline_running) {
 
-      //ds free image references (GUI gets copies)
-      intensity_image_left_rectified.release();
-      intensity_image_right_rectified.release();
+      //ds the detector thresholds are adapted in image order, as during sequential processing
+      if (!frame.is_preprocessed) {
+        _preprocessImages(frame);
+      }
+      framepoint_generator->extractFeatures(frame.intensity_image_left, frame.intensity_image_right, frame.features);
+      if (!_frames_to_track.waitAndPush(std::move(frame), is_running)) {
+        break;
+      }
     }
+  });
+  LOG_INFO(std::cerr << "SLAMAssembly::_startPipeline|started pipelined processing" << std::endl)
+}
+
+void SLAMAssembly::_stopPipeline() {
+  if (!_pipeline_worker.joinable()) {
+    return;
   }
-  _message_reader.close();
-  LOG_INFO(std::cerr << "SLAMAssembly::playbackMessageFile|dataset completed" << std::endl)
+  _is_pipeline_running = false;
+  _frames_to_extract.wakeUp();
+  _frames_to_track.wakeUp();
+  _pipeline_worker.join();
+
+  //ds discard remaining frames (termination)
+  PipelineFrame frame;
+  while (_frames_to_extract.pop(frame)) {}
+  while (_frames_to_track.pop(frame)) {}
 }
 
 void SLAMAssembly::process(const cv::Mat& intensity_image_left_,
                            const cv::Mat& intensity_image_right_,
                            const double& timestamp_image_left_seconds_,
                            const bool& use_odometry_,
-                           const TransformMatrix3D& odometry_) {
+                           const TransformMatrix3D& odometry_,
+                           StereoFramePointGenerator::StereoFeatures* features_) {
+  const double time_start_seconds = srrg_core::getTime();
+  _process(intensity_image_left_, intensity_image_right_, timestamp_image_left_seconds_, use_odometry_, odometry_, features_);
+
+  //ds stream the finalized and moved poses
+  if (_trajectory_writer) {
+    _trajectory_writer->update(_world_map);
+  }
+  const double processing_time_seconds = srrg_core::getTime()-time_start_seconds;
+  _addToStageTrace(timestamp_image_left_seconds_, processing_time_seconds, features_);
+
+  //ds real-time mode: adjust the keypoint budget for the next frame (before the load shedding changes the applied scale)
+  if (_parameters->command_line_parameters->target_frame_rate_hz > 0) {
+    _updateKeypointBudget(processing_time_seconds);
+  }
+
+  //ds real-time mode: adjust the degradations for the next frame
+  if (_parameters->command_line_parameters->latency_budget_seconds > 0) {
+    _updateLoadShedding(processing_time_seconds);
+  }
+}
+
+void SLAMAssembly::_addToStageTrace(const double& timestamp_image_left_seconds_,
+                                    const double& processing_time_seconds_,
+                                    const StereoFramePointGenerator::StereoFeatures* features_) {
+  _getTimeConsumptionsSeconds(_time_consumptions_seconds_current, nullptr, true);
+  if (_time_consumptions_seconds_last.size() != _time_consumptions_seconds_current.size()) {
+    _time_consumptions_seconds_last.assign(_time_consumptions_seconds_current.size(), 0);
+  }
+
+  //ds the durations of the frame are the increments of the accumulated module durations
+  const Index index_first_stage = _stage_trace_seconds.size();
+  for (Index index = 0; index < _time_consumptions_seconds_current.size(); ++index) {
+    _stage_trace_seconds.push_back(_time_consumptions_seconds_current[index]-_time_consumptions_seconds_last[index]);
+  }
+  _time_consumptions_seconds_last.swap(_time_consumptions_seconds_current);
+
+  //ds pipelined processing: the extraction durations of this frame have been measured by the pipeline worker (first two modules)
+  if (features_) {
+    _stage_trace_seconds[index_first_stage]   = features_->duration_keypoint_detection_seconds;
+    _stage_trace_seconds[index_first_stage+1] = features_->duration_descriptor_extraction_seconds;
+  }
+  _stage_trace.push_back(StageTraceEntry((_world_map->currentFrame())? _world_map->currentFrame()->identifier(): 0,
+                                         timestamp_image_left_seconds_,
+                                         processing_time_seconds_));
+}
+
+void SLAMAssembly::_updateLoadShedding(const double& processing_time_seconds_) {
+  const real& latency_budget_seconds = _parameters->command_line_parameters->latency_budget_seconds;
+
+  //ds keypoint targets are not adjusted while the pipeline worker is detecting
+  const LoadSheddingLevel maximum_level = (_parameters->command_line_parameters->option_enable_pipelining)? SuspendPointRecovery: ReduceKeypoints;
+
+  //ds escalate by one level per exceeded budget, relax by one level per frame well within the budget (hysteresis against oscillation)
+  LoadSheddingLevel level = _load_shedding_level;
+  if (processing_time_seconds_ > latency_budget_seconds && level < maximum_level) {
+    level = static_cast<LoadSheddingLevel>(level+1);
+  } else if (processing_time_seconds_ < 0.75*latency_budget_seconds && level > Nominal) {
+    level = static_cast<LoadSheddingLevel>(level-1);
+  }
+  if (level == _load_shedding_level) {
+    return;
+  }
+  LOG_DEBUG(std::cerr << "SLAMAssembly::_updateLoadShedding|processing time (s): " << processing_time_seconds_
+                      << " level: " << _load_shedding_level << " > " << level << std::endl)
+  _load_shedding_level = level;
+
+  //ds apply the tracking degradations (postponing is evaluated during processing)
+  _tracker->setIsPointRecoverySuspended(_load_shedding_level >= SuspendPointRecovery);
+  _applyKeypointTargetScale();
+}
+
+void SLAMAssembly::_updateKeypointBudget(const double& processing_time_seconds_) {
+  const double time_consumption_front_end_seconds = _getTimeConsumptionSecondsFrontEnd();
+  const double frame_time_front_end_seconds       = time_consumption_front_end_seconds-_time_consumption_front_end_last_seconds;
+  _time_consumption_front_end_last_seconds        = time_consumption_front_end_seconds;
+
+  //ds informative only: scale applied to the last frame
+  _keypoint_budget_scale_accumulated += _keypoint_budget_scale;
+  _keypoint_budget_scale_minimum      = std::min(_keypoint_budget_scale_minimum, _keypoint_budget_scale);
+
+  //ds split the frame time into a part scaling with the keypoint target and a remainder (local maps, relocalization, ..)
+  //ds the keypoint dependent part is normalized to full scale, assuming a linear workload in the number of keypoints
+  const real& scale_applied                 = _tracker->framepointGenerator()->keypointTargetScale();
+  const double frame_time_fixed_seconds     = std::max(processing_time_seconds_-frame_time_front_end_seconds, 0.0);
+  const double frame_time_per_scale_seconds = frame_time_front_end_seconds/scale_applied;
+  if (_is_keypoint_budget_initialized) {
+
+    //ds smooth the measurements against single outliers (e.g. a pose graph optimization)
+    const double smoothing = 0.1;
+    _frame_time_fixed_seconds     += smoothing*(frame_time_fixed_seconds-_frame_time_fixed_seconds);
+    _frame_time_per_scale_seconds += smoothing*(frame_time_per_scale_seconds-_frame_time_per_scale_seconds);
+  } else {
+    _frame_time_fixed_seconds       = frame_time_fixed_seconds;
+    _frame_time_per_scale_seconds   = frame_time_per_scale_seconds;
+    _is_keypoint_budget_initialized = true;
+  }
+  if (_frame_time_per_scale_seconds <= 0) {
+    return;
+  }
+
+  //ds scale that fits the smoothed frame time into the target period (with a safety margin)
+  const real& minimum_scale          = _tracker->framepointGenerator()->minimumKeypointTargetScale();
+  const double target_period_seconds = 0.9/_parameters->command_line_parameters->target_frame_rate_hz;
+  const real load_shedding_scale     = (_load_shedding_level >= ReduceKeypoints)? 0.5: 1;
+  const real scale_desired = std::max(std::min(static_cast<real>((target_period_seconds-_frame_time_fixed_seconds)/_frame_time_per_scale_seconds/load_shedding_scale),
+                                               static_cast<real>(1)), minimum_scale);
+
+  //ds reduce the workload immediately under load, recover it slowly when there is headroom again (no oscillation)
+  const real scale = (scale_desired < _keypoint_budget_scale)? scale_desired: std::min(scale_desired, _keypoint_budget_scale+static_cast<real>(0.02));
+  const bool is_bounded = (scale == 1 || scale == minimum_scale);
+  if (scale == _keypoint_budget_scale || (std::fabs(scale-_keypoint_budget_scale) < 0.01 && !is_bounded)) {
+    return;
+  }
+  LOG_DEBUG(std::cerr << "SLAMAssembly::_updateKeypointBudget|processing time (s): " << processing_time_seconds_
+                      << " keypoint target scale: " << _keypoint_budget_scale << " > " << scale << std::endl)
+  _keypoint_budget_scale = scale;
+  ++_number_of_keypoint_budget_adjustments;
+  _applyKeypointTargetScale();
+}
+
+void SLAMAssembly::_applyKeypointTargetScale() {
+  const real load_shedding_scale = (_load_shedding_level >= ReduceKeypoints)? 0.5: 1;
+  real scale = load_shedding_scale;
+
+  //ds never go below the minimum required for stable tracking when both degradations are active
+  if (_parameters->command_line_parameters->target_frame_rate_hz > 0) {
+    scale = std::max(load_shedding_scale*_keypoint_budget_scale, std::min(load_shedding_scale, _tracker->framepointGenerator()->minimumKeypointTargetScale()));
+  }
+  _tracker->framepointGenerator()->setKeypointTargetScale(scale);
+}
+
+const double SLAMAssembly::_getTimeConsumptionSecondsFrontEnd() const {
+  double time_consumption_seconds = _tracker->framepointGenerator()->getTimeConsumptionSeconds_keypoint_detection()+
+                                    _tracker->framepointGenerator()->getTimeConsumptionSeconds_descriptor_extraction();
+  if (_parameters->command_line_parameters->tracker_mode == CommandLineParameters::TrackerMode::RGB_STEREO) {
+    time_consumption_seconds += dynamic_cast<const StereoFramePointGenerator*>(_tracker->framepointGenerator())->getTimeConsumptionSeconds_point_triangulation();
+  }
+  return time_consumption_seconds+
+         _tracker->getTimeConsumptionSeconds_tracking()+
+         _tracker->getTimeConsumptionSeconds_pose_optimization()+
+         _tracker->getTimeConsumptionSeconds_landmark_optimization()+
+         _tracker->getTimeConsumptionSeconds_point_recovery();
+}
+
+void SLAMAssembly::_process(const cv::Mat& intensity_image_left_,
+                            const cv::Mat& intensity_image_right_,
+                            const double& timestamp_image_left_seconds_,
+                            const bool& use_odometry_,
+                            const TransformMatrix3D& odometry_,
+                            StereoFramePointGenerator::StereoFeatures* features_) {
+
+  //ds informative only: degradations applied to this frame
+  if (_load_shedding_level >= SuspendPointRecovery && _parameters->command_line_parameters->option_recover_landmarks) {
+    ++_number_of_frames_without_point_recovery;
+  }
+  if (_load_shedding_level >= ReduceKeypoints) {
+    ++_number_of_frames_with_reduced_keypoints;
+  }
 
   //ds call the tracker
   _tracker->setIntensityImageLeft(intensity_image_left_);
@@ -505,6 +1157,9 @@ void SLAMAssembly::process(const cv::Mat& intensity_image_left_,
       StereoTracker* stereo_tracker = dynamic_cast<StereoTracker*>(_tracker);
       assert(stereo_tracker);
       stereo_tracker->setIntensityImageRight(intensity_image_right_);
+      if (features_) {
+        static_cast<StereoFramePointGenerator*>(stereo_tracker->framepointGenerator())->setPrecomputedFeatures(features_);
+      }
       break;
     }
     case CommandLineParameters::TrackerMode::RGB_DEPTH: {
@@ -530,44 +1185,63 @@ void SLAMAssembly::process(const cv::Mat& intensity_image_left_,
     //ds set additional fields
     _world_map->currentFrame()->setTimestampImageLeftSeconds(timestamp_image_left_seconds_);
 
+    //ds localization only: the loaded map is not modified
+    if (_world_map->isLocalizationOnly()) {
+      if (!_parameters->command_line_parameters->option_disable_relocalization) {
+        _localize();
+      }
+      return;
+    }
+
     //ds if relocalization is not disabled
     if (!_parameters->command_line_parameters->option_disable_relocalization) {
 
-      //ds local map generation - regardless of tracker state
+      //ds local map generation - regardless of tracker state and relocalization mode
       if (_map_viewer) {_map_viewer->lock();}
       const bool created_local_map = _world_map->createLocalMap(_parameters->command_line_parameters->option_drop_framepoints);
       if (_map_viewer) {_map_viewer->unlock();}
 
-      //ds if we successfully created a local map
-      if (created_local_map) {
-
-        //ds localize in database (not yet optimizing the graph)
-        _relocalizer->detectClosures(_world_map->currentLocalMap());
-        _relocalizer->registerClosures();
-//        _relocalizer->prune();
-
-        //ds check the closures
-        for(Closure* closure: _relocalizer->closures()) {
-          if (closure->is_valid) {
-            assert(_world_map->currentLocalMap() == closure->local_map_query);
-
-            //ds add loop closure constraint (merging corresponding landmarks)
-            _world_map->addLoopClosure(_world_map->currentLocalMap(),
-                                       closure->local_map_reference,
-                                       closure->query_to_reference,
-                                       closure->correspondences,
-                                       closure->icp_inlier_ratio);
-            if (_parameters->command_line_parameters->option_use_gui) {
-              for (const Closure::Correspondence* match: closure->correspondences) {
-                _world_map->landmarks().at(match->query->identifier())->setIsInLoopClosureQuery(true);
-                _world_map->landmarks().at(match->reference->identifier())->setIsInLoopClosureReference(true);
-              }
-            }
+      //ds asynchronous relocalization: every new local map is queried in the background (it does not access the tracked landmarks)
+      const bool& enable_asynchronous_relocalization = _parameters->relocalizer_parameters->enable_asynchronous_relocalization;
+      if (enable_asynchronous_relocalization) {
+        if (created_local_map) {
+          _queueRelocalization(_world_map->currentLocalMap());
+        }
+
+        //ds apply the closures of all processed queries if the worker is idle (safe point)
+        _collectRelocalization(false);
+      } else {
+
+        //ds if we successfully created a local map
+        if (created_local_map) {
+          _local_maps_to_query.push_back(_world_map->currentLocalMap());
+          if (_load_shedding_level != Nominal) {
+            ++_number_of_postponed_relocalizations;
           }
         }
 
-        //ds clear buffer (automatically purges invalidated closures)
-        _relocalizer->clear();
+        //ds real-time mode: queries are postponed under overload and caught up one per frame (in creation order) afterwards
+        if (!_local_maps_to_query.empty() && _load_shedding_level == Nominal) {
+          LocalMap* local_map_query = _local_maps_to_query.front();
+          _local_maps_to_query.pop_front();
+
+          //ds localize in database (not yet optimizing the graph)
+          _relocalizer->detectClosures(local_map_query);
+          _relocalizer->registerClosures();
+          _relocalizer->commitQuery(local_map_query);
+//          _relocalizer->prune();
+
+          //ds add the closures to the world map and clear the buffer (automatically purges invalidated closures)
+          _applyClosures(local_map_query, _relocalizer->closures());
+          _relocalizer->clear();
+        }
+      }
+
+      //ds background optimization: apply a finished result if the relocalization is idle (safe point)
+      if (_graph_optimizer->isOptimizationFinished() && _collectRelocalization(false)) {
+        if (_map_viewer) {_map_viewer->lock();}
+        _graph_optimizer->collectOptimization(_world_map);
+        if (_map_viewer) {_map_viewer->unlock();}
       }
 
       //ds if bundle-adjustment is desired
@@ -576,8 +1250,43 @@ void SLAMAssembly::process(const cv::Mat& intensity_image_left_,
         //ds add frame and its landmarks to the pose graph
         _graph_optimizer->addFrameWithLandmarks(_world_map->currentFrame());
 
-        //ds check if a periodic bundle adjustment is required
-        if (_world_map->frames().size() % _parameters->graph_optimizer_parameters->number_of_frames_per_bundle_adjustment == 0) {
+        //ds check if a bundle adjustment is required: periodic or for every new local map of the current track (local bundle adjustment)
+        const bool is_windowed = (_parameters->graph_optimizer_parameters->number_of_local_maps_for_bundle_adjustment > 0);
+        bool is_bundle_adjustment_required = false;
+        if (is_windowed) {
+          const LocalMap* local_map = _world_map->currentLocalMap();
+          is_bundle_adjustment_required = (local_map                                                           &&
+                                           local_map != _local_map_last_bundle_adjusted                        &&
+                                           local_map->keyframe()->root() == _world_map->currentFrame()->root());
+        } else {
+          is_bundle_adjustment_required = (_world_map->frames().size() % _parameters->graph_optimizer_parameters->number_of_frames_per_bundle_adjustment == 0);
+        }
+
+        //ds real-time mode: bundle adjustments are postponed under overload until the load is nominal again
+        //ds (a window bundle adjustment remains required for the current local map, a periodic one has to be remembered)
+        if (_load_shedding_level != Nominal) {
+          if (is_bundle_adjustment_required && !_is_bundle_adjustment_postponed) {
+            ++_number_of_postponed_bundle_adjustments;
+          }
+          _is_bundle_adjustment_postponed = (_is_bundle_adjustment_postponed || is_bundle_adjustment_required);
+          is_bundle_adjustment_required   = false;
+        } else if (_is_bundle_adjustment_postponed) {
+          is_bundle_adjustment_required   = (is_bundle_adjustment_required || !is_windowed);
+          _is_bundle_adjustment_postponed = false;
+        }
+
+        //ds local bundle adjustment: a loop closure is distributed over the complete map first
+        if (is_windowed && _world_map->relocalized()) {
+          _collectRelocalization(true);
+          if (_map_viewer) {_map_viewer->lock();}
+          _graph_optimizer->optimizeMap(_world_map);
+          if (_map_viewer) {_map_viewer->unlock();}
+        }
+        if (is_bundle_adjustment_required) {
+          _local_map_last_bundle_adjusted = _world_map->currentLocalMap();
+
+          //ds the optimization moves landmarks and local maps: wait for a running relocalization
+          _collectRelocalization(true);
 
           //ds check if we're running with a GUI and lock the GUI before the critical phase
           if (_map_viewer) {_map_viewer->lock();}
@@ -596,6 +1305,9 @@ void SLAMAssembly::process(const cv::Mat& intensity_image_left_,
         //ds if we closed a local map - otherwise there is no need to optimize the pose graph
         if (_world_map->relocalized()) {
 
+          //ds the optimization moves landmarks and local maps: wait for a running relocalization
+          _collectRelocalization(true);
+
           //ds check if we're running with a GUI and lock the GUI before the critical phase
           if (_map_viewer) {_map_viewer->lock();}
 
@@ -603,7 +1315,7 @@ void SLAMAssembly::process(const cv::Mat& intensity_image_left_,
           _graph_optimizer->optimizeFrames(_world_map);
 
           //ds merge landmarks for the current local map and its closures
-          _world_map->mergeLandmarks(_world_map->currentLocalMap()->closures());
+          _world_map->mergeLandmarks(_local_map_last_relocalized->closures());
 
           //ds re-enable the GUI
           if (_map_viewer) {_map_viewer->unlock();}
@@ -619,6 +1331,99 @@ void SLAMAssembly::process(const cv::Mat& intensity_image_left_,
   }
 }
 
+const std::vector<std::pair<std::string, double>> SLAMAssembly::timeConsumptionsSeconds() const {
+  std::vector<double> time_consumptions_seconds;
+  std::vector<std::string> names;
+  _getTimeConsumptionsSeconds(time_consumptions_seconds, &names);
+  std::vector<std::pair<std::string, double>> time_consumptions;
+  for (Index index = 0; index < names.size(); ++index) {
+    time_consumptions.push_back(std::make_pair(names[index], time_consumptions_seconds[index]));
+  }
+  return time_consumptions;
+}
+
+void SLAMAssembly::_getTimeConsumptionsSeconds(std::vector<double>& time_consumptions_seconds_,
+                                               std::vector<std::string>* names_,
+                                               const bool& is_stage_trace_) const {
+  time_consumptions_seconds_.clear();
+  if (names_) {
+    names_->clear();
+  }
+  auto add = [&time_consumptions_seconds_, &names_](const char* name_, const double& time_consumption_seconds_) {
+    time_consumptions_seconds_.push_back(time_consumption_seconds_);
+    if (names_) {
+      names_->push_back(name_);
+    }
+  };
+
+  //ds the stage trace is sampled during processing: accumulators written by background threads must not be read
+  const bool is_extraction_pipelined         = (is_stage_trace_ && _parameters->command_line_parameters->option_enable_pipelining);
+  const bool is_relocalization_in_background = (is_stage_trace_ && _parameters->relocalizer_parameters->enable_asynchronous_relocalization);
+  const bool is_optimization_in_background   = (is_stage_trace_ && _parameters->graph_optimizer_parameters->enable_asynchronous_optimization);
+  add("keypoint detection", is_extraction_pipelined? 0: _tracker->framepointGenerator()->getTimeConsumptionSeconds_keypoint_detection());
+  add("descriptor extraction", is_extraction_pipelined? 0: _tracker->framepointGenerator()->getTimeConsumptionSeconds_descriptor_extraction());
+
+  //ds further modules depending on tracking mode
+  switch (_parameters->command_line_parameters->tracker_mode){
+    case CommandLineParameters::TrackerMode::RGB_STEREO: {
+      const StereoFramePointGenerator* stereo_framepoint_generator = dynamic_cast<const StereoFramePointGenerator*>(_tracker->framepointGenerator());
+      add("stereo keypoint search", stereo_framepoint_generator->getTimeConsumptionSeconds_point_triangulation());
+      break;
+    }
+    case CommandLineParameters::TrackerMode::RGB_DEPTH: {
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+  add("tracking", _tracker->getTimeConsumptionSeconds_tracking());
+  add("pose optimization", _tracker->getTimeConsumptionSeconds_pose_optimization());
+  add("landmark optimization", _tracker->getTimeConsumptionSeconds_landmark_optimization());
+  add("point recovery", _tracker->getTimeConsumptionSeconds_point_recovery());
+  add("local map generation", _world_map->getTimeConsumptionSeconds_local_map_generation());
+  if (!is_relocalization_in_background) {
+    add("relocalization", _relocalizer->getTimeConsumptionSeconds_overall());
+  }
+  add("pose graph addition", _graph_optimizer->getTimeConsumptionSeconds_addition());
+  if (!is_optimization_in_background) {
+    add("pose graph optimization", _graph_optimizer->getTimeConsumptionSeconds_optimization());
+  }
+  add("landmark merging", _world_map->getTimeConsumptionSeconds_landmark_merging());
+}
+
+void SLAMAssembly::writeStageTrace(const std::string& file_name_) const {
+  std::ofstream outfile_trace(file_name_, std::ofstream::out);
+  if (!outfile_trace.good()) {
+    LOG_WARNING(std::cerr << "SLAMAssembly::writeStageTrace|unable to open file: '" << file_name_ << "'" << std::endl)
+    return;
+  }
+
+  //ds header: module names without spaces
+  std::vector<double> time_consumptions_seconds;
+  std::vector<std::string> names;
+  _getTimeConsumptionsSeconds(time_consumptions_seconds, &names, true);
+  outfile_trace << "frame_identifier,timestamp_seconds,processing_time_seconds";
+  for (std::string& name: names) {
+    std::replace(name.begin(), name.end(), ' ', '_');
+    outfile_trace << "," << name << "_seconds";
+  }
+  outfile_trace << "\n";
+
+  //ds one line per processed frame
+  outfile_trace.precision(9);
+  for (Index index_entry = 0; index_entry < _stage_trace.size(); ++index_entry) {
+    const StageTraceEntry& entry = _stage_trace[index_entry];
+    outfile_trace << entry.frame_identifier << "," << std::fixed << entry.timestamp_image_left_seconds << "," << entry.processing_time_seconds;
+    for (Index index_stage = 0; index_stage < names.size(); ++index_stage) {
+      outfile_trace << "," << _stage_trace_seconds[index_entry*names.size()+index_stage];
+    }
+    outfile_trace << "\n";
+  }
+  outfile_trace.close();
+  LOG_INFO(std::cerr << "SLAMAssembly::writeStageTrace|saved stage timings of " << _stage_trace.size() << " frames to: '" << file_name_ << "'" << std::endl)
+}
+
 void SLAMAssembly::printReport() const {
 
   //ds header
@@ -665,10 +1470,30 @@ void SLAMAssembly::printReport() const {
   std::cerr << "              mean tracks per frame: " << _tracker->totalNumberOfTrackedPoints()/_number_of_processed_frames << std::endl;
   std::cerr << "             mean tracks per second: " << _tracker->totalNumberOfTrackedPoints()/_processing_time_total_seconds << std::endl;
   std::cerr << "            number of loop closures: " << _world_map->numberOfClosures() << std::endl;
+  std::cerr << "   number of rejected place entries: " << _relocalizer->numberOfRejectedPlaces() << std::endl;
+  std::cerr << "            number of merged tracks: " << _world_map->numberOfMergedTracks()
+            << " (place databases: " << _relocalizer->numberOfPlaceDatabases() << ")" << std::endl;
   std::cerr << "         number of merged landmarks: " << _world_map->numberOfMergedLandmarks()
             << " (of total landmarks: " << static_cast<real>(_world_map->numberOfMergedLandmarks())/_world_map->landmarks().size() <<  ")" << std::endl;
   std::cerr << "  number of recursive registrations: " << _tracker->numberOfRecursiveRegistrations() << std::endl;
 
+  //ds real-time mode: frame dropping and load shedding
+  if (_parameters->command_line_parameters->latency_budget_seconds > 0) {
+    std::cerr << "           number of dropped frames: " << _number_of_dropped_frames
+              << " (of total frames: " << static_cast<real>(_number_of_dropped_frames)/(_number_of_dropped_frames+_number_of_processed_frames) << ")" << std::endl;
+    std::cerr << "   postponed relocalization queries: " << _number_of_postponed_relocalizations << std::endl;
+    std::cerr << "       postponed bundle adjustments: " << _number_of_postponed_bundle_adjustments << std::endl;
+    std::cerr << "   frames without landmark recovery: " << _number_of_frames_without_point_recovery << std::endl;
+    std::cerr << "      frames with reduced keypoints: " << _number_of_frames_with_reduced_keypoints << std::endl;
+  }
+
+  //ds real-time mode: keypoint budget control
+  if (_parameters->command_line_parameters->target_frame_rate_hz > 0 && _number_of_processed_frames > 0) {
+    std::cerr << "      average keypoint target scale: " << _keypoint_budget_scale_accumulated/_number_of_processed_frames
+              << " (minimum: " << _keypoint_budget_scale_minimum << ")" << std::endl;
+    std::cerr << "  keypoint target scale adjustments: " << _number_of_keypoint_budget_adjustments << std::endl;
+  }
+
   //ds display further information depending on tracking mode
   switch (_parameters->command_line_parameters->tracker_mode){
     case CommandLineParameters::TrackerMode::RGB_STEREO: {
@@ -691,41 +1516,112 @@ void SLAMAssembly::printReport() const {
   std::cerr << BAR << std::endl;
   std::cerr << "            module name | relative | absolute (s)" << std::endl;
   std::cerr << BAR << std::endl;
-  std::printf("     keypoint detection | %f | %f\n", _tracker->framepointGenerator()->getTimeConsumptionSeconds_keypoint_detection()/_processing_time_total_seconds,
-                                                         _tracker->framepointGenerator()->getTimeConsumptionSeconds_keypoint_detection());
-  std::printf("  descriptor extraction | %f | %f\n", _tracker->framepointGenerator()->getTimeConsumptionSeconds_descriptor_extraction()/_processing_time_total_seconds,
-                                                         _tracker->framepointGenerator()->getTimeConsumptionSeconds_descriptor_extraction());
+  const std::vector<std::pair<std::string, double>> time_consumptions = timeConsumptionsSeconds();
+  for (const std::pair<std::string, double>& time_consumption: time_consumptions) {
+    std::printf("%23s | %f | %f\n", time_consumption.first.c_str(), time_consumption.second/_processing_time_total_seconds, time_consumption.second);
+  }
 
-  //ds display further information depending on tracking mode
-  switch (_parameters->command_line_parameters->tracker_mode){
-    case CommandLineParameters::TrackerMode::RGB_STEREO: {
-      StereoFramePointGenerator* stereo_framepoint_generator = dynamic_cast<StereoFramePointGenerator*>(_tracker->framepointGenerator());
-      std::printf(" stereo keypoint search | %f | %f\n", stereo_framepoint_generator->getTimeConsumptionSeconds_point_triangulation()/_processing_time_total_seconds,
-                                                             stereo_framepoint_generator->getTimeConsumptionSeconds_point_triangulation());
-      break;
+  //ds tail latencies per module (from the stage trace)
+  if (!_stage_trace.empty()) {
+    auto print_percentiles = [](const char* name_, std::vector<double>& durations_seconds_) {
+      std::sort(durations_seconds_.begin(), durations_seconds_.end());
+      auto percentile = [&durations_seconds_](const double& ratio_) {
+        return 1e3*durations_seconds_[std::min(static_cast<size_t>(ratio_*durations_seconds_.size()), durations_seconds_.size()-1)];
+      };
+      std::printf("%23s | %f | %f | %f | %f\n", name_, percentile(0.5), percentile(0.95), percentile(0.99), 1e3*durations_seconds_.back());
+    };
+    std::cerr << BAR << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "time consumption per frame - processing units" << std::endl;
+    std::cerr << BAR << std::endl;
+    std::cerr << "            module name | p50 (ms) | p95 (ms) | p99 (ms) | max (ms)" << std::endl;
+    std::cerr << BAR << std::endl;
+
+    //ds modules running in background threads are not traced per frame
+    std::vector<double> time_consumptions_seconds_traced;
+    std::vector<std::string> names_traced;
+    _getTimeConsumptionsSeconds(time_consumptions_seconds_traced, &names_traced, true);
+    std::vector<double> durations_seconds(_stage_trace.size());
+    const Count number_of_stages = _stage_trace_seconds.size()/_stage_trace.size();
+    for (Index index_stage = 0; index_stage < number_of_stages && index_stage < names_traced.size(); ++index_stage) {
+      for (Index index_entry = 0; index_entry < _stage_trace.size(); ++index_entry) {
+        durations_seconds[index_entry] = _stage_trace_seconds[index_entry*number_of_stages+index_stage];
+      }
+      print_percentiles(names_traced[index_stage].c_str(), durations_seconds);
     }
-    case CommandLineParameters::TrackerMode::RGB_DEPTH: {
-      break;
-    }
-    default: {
-      break;
+    for (Index index_entry = 0; index_entry < _stage_trace.size(); ++index_entry) {
+      durations_seconds[index_entry] = _stage_trace[index_entry].processing_time_seconds;
     }
+    print_percentiles("complete frame", durations_seconds);
   }
 
-  std::printf("               tracking | %f | %f\n", _tracker->getTimeConsumptionSeconds_tracking()/_processing_time_total_seconds, _tracker->getTimeConsumptionSeconds_tracking());
-  std::printf("      pose optimization | %f | %f\n", _tracker->getTimeConsumptionSeconds_pose_optimization()/_processing_time_total_seconds, _tracker->getTimeConsumptionSeconds_pose_optimization());
-  std::printf("  landmark optimization | %f | %f\n", _tracker->getTimeConsumptionSeconds_landmark_optimization()/_processing_time_total_seconds, _tracker->getTimeConsumptionSeconds_landmark_optimization());
-  std::printf("         point recovery | %f | %f\n", _tracker->getTimeConsumptionSeconds_point_recovery()/_processing_time_total_seconds, _tracker->getTimeConsumptionSeconds_point_recovery());
-  std::printf("         relocalization | %f | %f\n", _relocalizer->getTimeConsumptionSeconds_overall()/_processing_time_total_seconds, _relocalizer->getTimeConsumptionSeconds_overall());
-  std::printf("    pose graph addition | %f | %f\n", _graph_optimizer->getTimeConsumptionSeconds_addition()/_processing_time_total_seconds, _graph_optimizer->getTimeConsumptionSeconds_addition());
-  std::printf("pose graph optimization | %f | %f\n", _graph_optimizer->getTimeConsumptionSeconds_optimization()/_processing_time_total_seconds, _graph_optimizer->getTimeConsumptionSeconds_optimization());
-  std::printf("       landmark merging | %f | %f\n", _world_map->getTimeConsumptionSeconds_landmark_merging()/_processing_time_total_seconds, _world_map->getTimeConsumptionSeconds_landmark_merging());
+  //ds memory footprint (at the last update)
+  if (_memory_usage.total() > 0) {
+    const std::vector<std::pair<std::string, size_t>> memory_usages = {{"frames", _memory_usage.frames},
+                                                                       {"images", _memory_usage.images},
+                                                                       {"framepoints", _memory_usage.framepoints},
+                                                                       {"landmarks", _memory_usage.landmarks},
+                                                                       {"local maps", _memory_usage.local_maps},
+                                                                       {"appearances", _memory_usage.appearances},
+                                                                       {"place databases", _memory_usage.place_databases},
+                                                                       {"pose graph", _memory_usage.pose_graph}};
+    std::cerr << BAR << std::endl;
+    std::cerr << std::endl;
+    std::cerr << "memory consumption overview - subsystems" << std::endl;
+    std::cerr << BAR << std::endl;
+    std::cerr << "            module name | relative | absolute (MB)" << std::endl;
+    std::cerr << BAR << std::endl;
+    for (const std::pair<std::string, size_t>& memory_usage: memory_usages) {
+      std::printf("%23s | %f | %f\n", memory_usage.first.c_str(), static_cast<double>(memory_usage.second)/_memory_usage.total(), memory_usage.second/1e6);
+    }
+    std::printf("%23s | %f | %f\n", "total", 1.0, _memory_usage.total()/1e6);
+  }
   std::cerr << DOUBLE_BAR << std::endl;
 }
 
+void SLAMAssembly::updateMemoryUsage() {
+  if (!_world_map) {
+    return;
+  }
+
+  //ds the appearances of the queried local maps are consumed by the relocalization worker - keep the last estimate while it is busy
+  bool include_appearances = true;
+  {
+    std::lock_guard<std::mutex> lock(_mutex_relocalization);
+    include_appearances = (_local_maps_to_relocalize.empty() && !_is_relocalization_running);
+  }
+  const size_t appearances_bytes = _memory_usage.appearances;
+  _memory_usage = MemoryUsage();
+  _world_map->getMemoryUsage(_memory_usage, include_appearances);
+  if (!include_appearances) {
+    _memory_usage.appearances = appearances_bytes;
+  }
+  _memory_usage.place_databases = _relocalizer->memoryUsageBytes();
+  _memory_usage.pose_graph      = _graph_optimizer->memoryUsageBytes();
+}
+
 void SLAMAssembly::reset() {
+  _stopRelocalization();
+  _graph_optimizer->collectOptimization(_world_map);
+  _graph_optimizer->clear();
+  _local_map_last_bundle_adjusted = nullptr;
+  _local_map_last_relocalized     = nullptr;
+  _local_maps_to_query.clear();
+  _is_bundle_adjustment_postponed = false;
+  _relocalizer->clear();
   _synchronizer.reset();
   _processing_times_seconds.clear();
+  _stage_trace.clear();
+  _stage_trace_seconds.clear();
+  _memory_usage = MemoryUsage();
   _world_map->clear();
+
+  //ds restart the trajectory stream for the cleared map
+  if (_trajectory_writer) {
+    const std::string file_name = _trajectory_writer->fileName();
+    const TrajectoryWriter::Format format = _trajectory_writer->format();
+    delete _trajectory_writer;
+    _trajectory_writer = new TrajectoryWriter(file_name, format);
+  }
 }
 }
@@ -1,6 +1,10 @@
 #include "qapplication.h"
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
 
 #include "srrg_messages/message_reader.h"
 #include "srrg_messages/message_timestamp_synchronizer.h"
@@ -11,6 +15,9 @@
 #include "visualization/image_viewer.h"
 #include "visualization/map_viewer.h"
 #include "framepoint_generation/stereo_framepoint_generator.h"
+#include "types/bounded_queue.h"
+#include "types/image_buffer_pool.h"
+#include "types/trajectory_writer.h"
 
 namespace proslam {
 
@@ -26,6 +33,15 @@ public: EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   //ds default destructor
   ~SLAMAssembly();
 
+//ds exported types
+public:
+
+  //! @brief real-time mode: processing degradations, which are applied cumulatively with increasing overload (latency_budget_seconds)
+  enum LoadSheddingLevel {Nominal               = 0, //ds complete processing
+                          PostponeOptimization  = 1, //ds relocalization queries (synchronous relocalization only) and bundle adjustments are postponed
+                          SuspendPointRecovery  = 2, //ds framepoint track recovery is skipped
+                          ReduceKeypoints       = 3}; //ds detector thresholds are adapted to fewer keypoints (not available in pipelined processing)
+
 //ds functionality
 public:
 
@@ -48,6 +64,19 @@ public:
   //! @param[in] file_name_ desired file name for the g2o outfile
   void writePoseGraphToFile(const std::string& file_name_ = "pose_graph.g2o") const;
 
+  //! @brief saves the current map to a binary map file
+  //! @param[in] file_name_ desired file name for the map file
+  void writeMap(const std::string& file_name_) const;
+
+  //! @brief loads a binary map file before processing (requires loaded cameras), subsequent tracking is localized in the map at the first loop closure
+  //! @param[in] file_name_ map file to load
+  void loadMap(const std::string& file_name_);
+
+  //! @brief loads another binary map file as separate track and merges it into the present map at the best loop closure between them
+  //! @brief the local maps of the new track are queried against the place databases of all present tracks before being added
+  //! @param[in] file_name_ map file to merge
+  void mergeMap(const std::string& file_name_);
+
   //! @brief playback txt_io message file
   void playbackMessageFile();
 
@@ -57,15 +86,35 @@ public:
   }
 
   //! @brief process a pair of rectified and undistorted stereo images
+  //! @brief in real-time mode the processing is degraded for subsequent calls if the duration of the call exceeds the latency budget
+  //! @param[in] features_ stereo features of the image pair extracted ahead (pipelined processing), extracted during tracking if not set
   void process(const cv::Mat& intensity_image_left_,
                const cv::Mat& intensity_image_right_,
                const double& timestamp_image_left_seconds_ = 0,
                const bool& use_odometry_ = false,
-               const TransformMatrix3D& odometry_ = TransformMatrix3D::Identity());
+               const TransformMatrix3D& odometry_ = TransformMatrix3D::Identity(),
+               StereoFramePointGenerator::StereoFeatures* features_ = nullptr);
+
+  //! @brief completes the processing of a sequence: waits for and applies the last asynchronous relocalization and optimization results,
+  //! @brief refreshes the memory usage and flushes the trajectory stream (called by playbackMessageFile, to be called after the last process)
+  void finish();
 
   //ds prints extensive run summary
   void printReport() const;
 
+  //! @brief accumulated processing time per module (module name, duration), as listed by printReport
+  const std::vector<std::pair<std::string, double>> timeConsumptionsSeconds() const;
+
+  //! @brief saves the per-frame processing time of every module to a CSV file (one line per processed frame)
+  //! @brief modules running in background threads (asynchronous relocalization and optimization) are not part of the trace,
+  //! @brief the pipelined feature extraction is reported with the durations measured by the pipeline worker for the frame
+  //! @param[in] file_name_ desired file name for the CSV file
+  void writeStageTrace(const std::string& file_name_) const;
+
+  //! @brief refreshes the estimated memory footprint per subsystem (see memoryUsage), must be called from the processing thread
+  //! @brief while an asynchronous relocalization is running the appearances are not accessed and their last estimate is kept
+  void updateMemoryUsage();
+
   //! @brief dump trajectory to file (in KITTI benchmark format: 4x4 isometries per line)
   //! @param[in] file_name_ text file path in which the poses are saved to
   void writeTrajectoryKITTI(const std::string& file_name_ = "") const {if (_world_map) {_world_map->writeTrajectoryKITTI(file_name_);}}
@@ -84,7 +133,10 @@ public:
   template<typename RealType>
   void writeTrajectoryWithTimestamps(std::vector<std::pair<RealType, Eigen::Transform<RealType, 3, Eigen::Isometry>>>& poses_) const {if (_world_map) {_world_map->writeTrajectoryWithTimestamps<RealType>(poses_);}}
 
-  //! @brief resets the complete pipeline, releasing memory
+  //! @brief writes all frames including the current one to the trajectory stream (no effect if no stream is set)
+  void flushTrajectoryStream() {if (_trajectory_writer) {_trajectory_writer->update(_world_map, true);}}
+
+  //! @brief resets the complete pipeline, releasing memory (the trajectory stream is restarted)
   void reset();
 
 //ds getters/setters
@@ -93,12 +145,22 @@ public:
   void requestTermination() {_is_termination_requested = true;}
   const bool isViewerOpen() const {return _is_viewer_open;}
   const double currentFPS() const {return _current_fps;}
+  const double& processingTimeTotalSeconds() const {return _processing_time_total_seconds;}
+  const std::vector<double>& processingTimesSeconds() const {return _processing_times_seconds;}
+  const Count& numberOfProcessedFrames() const {return _number_of_processed_frames;}
+  const Count& numberOfDroppedFrames() const {return _number_of_dropped_frames;}
+  const WorldMap* worldMap() const {return _world_map;}
+  const MemoryUsage& memoryUsage() const {return _memory_usage;}
   const double averageNumberOfLandmarksPerFrame() const {return _tracker->totalNumberOfLandmarks()/_number_of_processed_frames;}
   const double averageNumberOfTracksPerFrame() const {return _tracker->totalNumberOfTrackedPoints()/_number_of_processed_frames;}
   const Count numberOfRecursiveRegistrations() const {return _tracker->numberOfRecursiveRegistrations();}
   const real meanTrackingRatio() const {return _tracker->meanTrackingRatio();}
   const real meanTriangulationRatio() const {return dynamic_cast<StereoFramePointGenerator*>(_tracker->framepointGenerator())->meanTriangulationSuccessRatio();}
 
+  //! @brief real-time mode: registers input frames that were discarded before processing (e.g. overwritten by a newer image pair)
+  void addDroppedFrames(const Count& number_of_frames_) {_number_of_dropped_frames += number_of_frames_;}
+  const LoadSheddingLevel& loadSheddingLevel() const {return _load_shedding_level;}
+
 //ds helpers:
 protected:
 
@@ -106,6 +168,94 @@ protected:
 
   void _createDepthTracker(Camera* camera_left_, Camera* camera_right_);
 
+  //! @brief allocates the worker pool shared by all units, wide enough for the widest parallel loop of the configuration
+  //! @param[in] maximum_number_of_tasks_front_end_ widest loop of the framepoint generator and tracker
+  void _createWorkerPool(const Count& maximum_number_of_tasks_front_end_);
+
+  //! @brief processing of a single image pair (see process)
+  void _process(const cv::Mat& intensity_image_left_,
+                const cv::Mat& intensity_image_right_,
+                const double& timestamp_image_left_seconds_,
+                const bool& use_odometry_,
+                const TransformMatrix3D& odometry_,
+                StereoFramePointGenerator::StereoFeatures* features_);
+
+  //! @brief real-time mode: raises the load shedding level if the frame exceeded the latency budget, lowers it if the frame was well within
+  //! @param[in] processing_time_seconds_ processing duration of the last frame
+  void _updateLoadShedding(const double& processing_time_seconds_);
+
+  //! @brief real-time mode: adapts the keypoint target scale to the measured frame time, aiming at the target frame rate
+  //! @param[in] processing_time_seconds_ processing duration of the last frame
+  void _updateKeypointBudget(const double& processing_time_seconds_);
+
+  //! @brief applies the combined keypoint target scale of load shedding and keypoint budget to the framepoint generator
+  void _applyKeypointTargetScale();
+
+  //! @brief accumulated processing time of the modules whose workload scales with the number of keypoints
+  const double _getTimeConsumptionSecondsFrontEnd() const;
+
+  //! @brief collects the accumulated processing time per module, in the order of timeConsumptionsSeconds
+  //! @param[out] time_consumptions_seconds_ durations (overwritten)
+  //! @param[out] names_ optional module names (overwritten)
+  //! @param[in] is_stage_trace_ stage trace layout: modules running in background threads (asynchronous relocalization and optimization)
+  //! are skipped and the pipelined feature extraction is reported as 0 - their accumulators are written concurrently
+  void _getTimeConsumptionsSeconds(std::vector<double>& time_consumptions_seconds_,
+                                   std::vector<std::string>* names_ = nullptr,
+                                   const bool& is_stage_trace_ = false) const;
+
+  //! @brief appends the module durations of the last processed frame to the stage trace
+  //! @param[in] timestamp_image_left_seconds_ image timestamp of the frame
+  //! @param[in] processing_time_seconds_ processing duration of the frame
+  //! @param[in] features_ pipelined processing: features carrying the extraction durations measured by the pipeline worker
+  void _addToStageTrace(const double& timestamp_image_left_seconds_,
+                        const double& processing_time_seconds_,
+                        const StereoFramePointGenerator::StereoFeatures* features_);
+
+  //! @brief adds the valid closures for the query local map to the world map (invalid ones are left to be released by the caller)
+  //! @param[in] local_map_query_ local map the relocalizer has been queried with
+  //! @param[in] closures_ registered closures of the query
+  void _applyClosures(LocalMap* local_map_query_, const ClosurePointerVector& closures_);
+
+  //! @brief asynchronous relocalization: queues a new local map for the worker (started on first use)
+  void _queueRelocalization(LocalMap* local_map_query_);
+
+  //! @brief asynchronous relocalization: worker loop processing the queued local maps in creation order
+  void _relocalizeQueuedLocalMaps();
+
+  //! @brief asynchronous relocalization: applies the results of all processed queries in creation order
+  //! @param[in] wait_ blocks until all queued local maps have been processed if set, otherwise nothing is applied while the worker is busy
+  //! @return true if the worker is idle (it remains idle until the next local map is queued)
+  const bool _collectRelocalization(const bool& wait_);
+
+  //! @brief asynchronous relocalization: stops the worker after its current query, queued local maps and results are discarded
+  void _stopRelocalization();
+
+  //! @brief synchronized image pair of the playback (defined below)
+  struct PipelineFrame;
+
+  //! @brief reads messages until the next synchronized image pair is available
+  //! @param[out] frame_ image pair with timestamp and odometry (not preprocessed)
+  //! @return false if the end of the message file is reached
+  const bool _readFrame(PipelineFrame& frame_);
+
+  //! @brief converts the images to grayscale (into recycled buffers) and equalizes their histograms if desired (option_equalize_histogram)
+  void _preprocessImages(PipelineFrame& frame_);
+
+  //! @brief starts the reader thread decoding and preprocessing up to number_of_frames_ frames ahead of processing
+  void _startPrefetching(const Count& number_of_frames_);
+
+  //! @brief stops the reader thread and discards the prefetched frames
+  void _stopPrefetching();
+
+  //! @brief pipelined processing: starts the worker preprocessing the queued frames and extracting their features
+  void _startPipeline();
+
+  //! @brief pipelined processing: stops the worker and discards the frames remaining in the pipeline
+  void _stopPipeline();
+
+  //! @brief localization only: matches a query local map of the current track against the loaded map, re-anchors the track and discards the query
+  void _localize();
+
 //ds SLAM modules
 protected:
 
@@ -128,6 +278,12 @@ protected:
   Camera* _camera_left;
   Camera* _camera_right;
 
+  //! @brief streaming trajectory output (only allocated if a trajectory stream file is set)
+  TrajectoryWriter* _trajectory_writer = nullptr;
+
+  //! @brief persistent workers executing the parallel loops of all units (allocated with the tracker, released last)
+  WorkerPool* _worker_pool = nullptr;
+
 //ds visualization only
 protected:
 
@@ -158,6 +314,101 @@ protected:
   //! @brief flag that is checked if an OpenGL or OpenCV window is currently active
   std::atomic<bool> _is_viewer_open;
 
+//ds asynchronous relocalization
+protected:
+
+  //! @brief background worker matching and registering the queued local maps, it only reads the landmark snapshots and appearances
+  //! @brief of the local maps and owns the relocalizer while running - the landmarks are only modified when a result is applied
+  std::thread _relocalization_worker;
+  std::mutex _mutex_relocalization;
+  std::condition_variable _condition_relocalization;
+
+  //! @brief local maps to query and results of processed queries (both in creation order, guarded by the mutex)
+  std::deque<LocalMap*> _local_maps_to_relocalize;
+  std::deque<Relocalizer::QueryResult> _relocalization_results;
+
+  //! @brief applied closures handed back to the worker, which recycles their correspondences (guarded by the mutex)
+  ClosurePointerVector _closures_to_release;
+
+  //! @brief worker state (guarded by the mutex)
+  bool _is_relocalization_running = false;
+  bool _is_relocalization_stopped = false;
+
+//ds pipelined processing
+protected:
+
+  //! @brief synchronized image pair passing through the playback, the features are extracted by the pipeline worker
+  struct PipelineFrame {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    cv::Mat intensity_image_left;
+    cv::Mat intensity_image_right;
+    double timestamp_image_left_seconds = 0;
+    bool has_odometry                   = false;
+    TransformMatrix3D odometry          = TransformMatrix3D::Identity();
+    bool is_preprocessed                = false;
+    StereoFramePointGenerator::StereoFeatures features;
+  };
+  typedef BoundedQueue<PipelineFrame, Eigen::aligned_allocator<PipelineFrame>> PipelineFrameQueue;
+
+  //! @brief frames waiting for preprocessing and feature extraction, and frames ready for tracking (both in image order)
+  PipelineFrameQueue _frames_to_extract;
+  PipelineFrameQueue _frames_to_track;
+
+  //! @brief worker preprocessing and describing the next frames while the main thread tracks the current one
+  std::thread _pipeline_worker;
+  std::atomic<bool> _is_pipeline_running;
+
+  //! @brief prefetching: reader thread filling the queue of decoded and preprocessed frames (number_of_prefetched_frames)
+  PipelineFrameQueue* _frames_prefetched = nullptr;
+  std::thread _prefetching_worker;
+  std::atomic<bool> _is_prefetching_running;
+  std::atomic<bool> _is_prefetching_done;
+
+  //! @brief recycled grayscale image buffers (used by the thread preprocessing the images)
+  ImageBufferPool _image_buffers;
+
+//ds local bundle adjustment
+protected:
+
+  //! @brief most recent local map for which a window bundle adjustment was triggered
+  const LocalMap* _local_map_last_bundle_adjusted = nullptr;
+
+  //! @brief most recent query local map for which loop closures were added (its closures are merged after pose graph optimization)
+  LocalMap* _local_map_last_relocalized = nullptr;
+
+//ds real-time mode
+protected:
+
+  //! @brief currently applied processing degradations
+  LoadSheddingLevel _load_shedding_level = Nominal;
+
+  //! @brief local maps waiting for their relocalization query (in creation order), caught up one per frame at nominal load
+  std::deque<LocalMap*> _local_maps_to_query;
+
+  //! @brief set if a required bundle adjustment was postponed
+  bool _is_bundle_adjustment_postponed = false;
+
+  //! @brief informative only: number of dropped input frames and number of applied degradations
+  Count _number_of_dropped_frames                  = 0;
+  Count _number_of_postponed_relocalizations       = 0;
+  Count _number_of_postponed_bundle_adjustments    = 0;
+  Count _number_of_frames_without_point_recovery   = 0;
+  Count _number_of_frames_with_reduced_keypoints   = 0;
+
+  //! @brief keypoint budget control: currently applied keypoint target scale
+  real _keypoint_budget_scale = 1;
+
+  //! @brief keypoint budget control: smoothed frame time independent of the keypoints and smoothed keypoint dependent time at full scale
+  double _frame_time_fixed_seconds                = 0;
+  double _frame_time_per_scale_seconds            = 0;
+  double _time_consumption_front_end_last_seconds = 0;
+  bool _is_keypoint_budget_initialized            = false;
+
+  //! @brief informative only: number of keypoint budget adjustments and accumulated scale (for the average)
+  Count _number_of_keypoint_budget_adjustments = 0;
+  double _keypoint_budget_scale_accumulated    = 0;
+  real _keypoint_budget_scale_minimum          = 1;
+
 //ds informative only
 protected:
 
@@ -167,6 +418,31 @@ protected:
   //! @brief frame-wise processing times
   std::vector<double> _processing_times_seconds;
 
+  //! @brief stage trace: one entry per processed frame
+  struct StageTraceEntry {
+    StageTraceEntry(const Identifier& frame_identifier_,
+                    const double& timestamp_image_left_seconds_,
+                    const double& processing_time_seconds_): frame_identifier(frame_identifier_),
+                                                             timestamp_image_left_seconds(timestamp_image_left_seconds_),
+                                                             processing_time_seconds(processing_time_seconds_) {}
+    Identifier frame_identifier;
+    double timestamp_image_left_seconds;
+    double processing_time_seconds;
+  };
+  std::vector<StageTraceEntry> _stage_trace;
+
+  //! @brief stage trace: module durations per processed frame (row-major, one row of stage trace modules per entry)
+  //! @brief obtained as increments of the accumulated module chronometers of the processing thread, such that the modules are not instrumented further
+  //! @brief modules running in background threads are not part of the trace (see _getTimeConsumptionsSeconds)
+  std::vector<double> _stage_trace_seconds;
+
+  //! @brief stage trace: accumulated module durations after the last frame and buffer for the current frame
+  std::vector<double> _time_consumptions_seconds_last;
+  std::vector<double> _time_consumptions_seconds_current;
+
+  //! @brief estimated memory footprint per subsystem at the last call of updateMemoryUsage
+  MemoryUsage _memory_usage;
+
   //! @brief total number of processed frames
   Count _number_of_processed_frames = 0;
 
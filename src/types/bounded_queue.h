@@ -0,0 +1,138 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "definitions.h"
+
+namespace proslam {
+
+//! @class bounded, lock-free queue for a single producer and a single consumer thread (e.g. connecting two pipeline stages)
+//! elements are moved through a ring buffer of fixed capacity, push and pop never block and fail if the queue is full or empty
+//! waitAndPush and waitAndPop sleep on a condition variable instead (signaled after every push and pop, which briefly takes its mutex)
+template<typename ElementType_, typename AllocatorType_ = std::allocator<ElementType_>>
+class BoundedQueue {
+
+//ds object handling
+public:
+
+  //! @brief allocates the ring buffer
+  //! @param[in] capacity_ maximum number of queued elements
+  BoundedQueue(const size_t& capacity_): _elements(capacity_+1),
+                                         _index_push(0),
+                                         _index_pop(0) {}
+
+  //! @brief prohibit copying (the indices are shared between threads)
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+//ds functionality
+public:
+
+  //! @brief moves an element into the queue (producer thread only)
+  //! @param[in] element_ element to enqueue, left untouched if the queue is full
+  //! @return true if the element has been enqueued
+  bool push(ElementType_&& element_) {
+    const size_t index      = _index_push.load(std::memory_order_relaxed);
+    const size_t index_next = (index+1)%_elements.size();
+    if (index_next == _index_pop.load(std::memory_order_acquire)) {
+      return false;
+    }
+    _elements[index] = std::move(element_);
+    _index_push.store(index_next, std::memory_order_release);
+    _notifyWaitingThread();
+    return true;
+  }
+
+  //! @brief moves the oldest element out of the queue (consumer thread only)
+  //! @param[out] element_ dequeued element
+  //! @return true if an element has been dequeued
+  bool pop(ElementType_& element_) {
+    const size_t index = _index_pop.load(std::memory_order_relaxed);
+    if (index == _index_push.load(std::memory_order_acquire)) {
+      return false;
+    }
+    element_ = std::move(_elements[index]);
+    _index_pop.store((index+1)%_elements.size(), std::memory_order_release);
+    _notifyWaitingThread();
+    return true;
+  }
+
+  //! @brief moves an element into the queue, sleeping while the queue is full (producer thread only)
+  //! @param[in] element_ element to enqueue, left untouched if waiting has been stopped
+  //! @param[in] is_waiting_ callable returning false if waiting should be stopped (changes have to be followed by wakeUp)
+  //! @return true if the element has been enqueued
+  template<typename IsWaiting_>
+  bool waitAndPush(ElementType_&& element_, IsWaiting_ is_waiting_) {
+    while (!push(std::move(element_))) {
+      if (!_wait([this] {return !full();}, is_waiting_)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //! @brief moves the oldest element out of the queue, sleeping while the queue is empty (consumer thread only)
+  //! @param[out] element_ dequeued element
+  //! @param[in] is_waiting_ callable returning false if waiting should be stopped (changes have to be followed by wakeUp)
+  //! @return true if an element has been dequeued, false if waiting has been stopped and the queue is empty
+  template<typename IsWaiting_>
+  bool waitAndPop(ElementType_& element_, IsWaiting_ is_waiting_) {
+    while (!pop(element_)) {
+      if (!_wait([this] {return !empty();}, is_waiting_)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //! @brief wakes up a waiting thread to re-evaluate its waiting condition (any thread)
+  void wakeUp() {
+    {std::lock_guard<std::mutex> lock(_mutex_waiting);}
+    _condition_waiting.notify_all();
+  }
+
+//ds getters/setters
+public:
+
+  inline const bool empty() const {return _index_pop.load(std::memory_order_acquire) == _index_push.load(std::memory_order_acquire);}
+  inline const bool full() const {return (_index_push.load(std::memory_order_acquire)+1)%_elements.size() == _index_pop.load(std::memory_order_acquire);}
+  inline const size_t capacity() const {return _elements.size()-1;}
+
+//ds helpers
+protected:
+
+  //! @brief sleeps until is_ready_ or not is_waiting_
+  //! @return is_ready_ at wake up
+  template<typename IsReady_, typename IsWaiting_>
+  bool _wait(IsReady_ is_ready_, IsWaiting_ is_waiting_) {
+    std::unique_lock<std::mutex> lock(_mutex_waiting);
+    ++_number_of_waiting_threads;
+    _condition_waiting.wait(lock, [&is_ready_, &is_waiting_] {return is_ready_() || !is_waiting_();});
+    --_number_of_waiting_threads;
+    return is_ready_();
+  }
+
+  //! @brief signals a waiting thread after a push or pop (the mutex orders the signal after a concurrent condition check)
+  void _notifyWaitingThread() {
+    std::lock_guard<std::mutex> lock(_mutex_waiting);
+    if (_number_of_waiting_threads > 0) {
+      _condition_waiting.notify_all();
+    }
+  }
+
+//ds attributes
+protected:
+
+  //! @brief ring buffer (one slot stays free to distinguish a full from an empty queue)
+  std::vector<ElementType_, AllocatorType_> _elements;
+
+  //! @brief next slot to write (owned by the producer) and next slot to read (owned by the consumer)
+  std::atomic<size_t> _index_push;
+  std::atomic<size_t> _index_pop;
+
+  //! @brief sleeping support for waitAndPush and waitAndPop
+  std::mutex _mutex_waiting;
+  std::condition_variable _condition_waiting;
+  Count _number_of_waiting_threads = 0;
+};
+} //namespace proslam
@@ -2,15 +2,14 @@
 
 namespace proslam {
 
-Count Camera::_instances = 0;
+std::atomic<Count> Camera::_instances(0);
 
 Camera::Camera(const Count& image_rows_,
                const Count& image_cols_,
                const CameraMatrix& camera_matrix_,
-               const TransformMatrix3D& camera_to_robot_): _identifier(_instances),
+               const TransformMatrix3D& camera_to_robot_): _identifier(_instances++),
                                                            _number_of_image_rows(image_rows_),
                                                            _number_of_image_cols(image_cols_) {
-  ++_instances;
   setCameraMatrix(camera_matrix_);
   setCameraToRobot(camera_to_robot_);
   LOG_INFO(std::cerr << "Camera::Camera|constructed" << std::endl)
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include "definitions.h"
 
 namespace proslam {
@@ -96,7 +97,7 @@ protected:
 //ds class specific
 private:
 
-  //! @brief object instance count (used for identifier generation)
-  static Count _instances;
+  //! @brief object instance count (used for identifier generation, shared by all SLAM instances in the process)
+  static std::atomic<Count> _instances;
 };
 }
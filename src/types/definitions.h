@@ -18,6 +18,7 @@
 
 #include "srrg_system_utils/system_utils.h"
 #include "srrg_types/types.hpp"
+#include "logger.h"
 
 namespace proslam {
 
@@ -45,8 +46,20 @@ namespace proslam {
   #define DESCRIPTOR_SIZE_BYTES SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS/8
   #define SRRG_PROSLAM_DESCRIPTOR_NORM cv::NORM_HAMMING
 
-  //ds adjust floating point precision
+  //ds adjust floating point precision (single precision halves the memory of all geometry and doubles the SIMD width)
+  //ds the g2o interface and the trajectory output always operate in double precision
+#ifdef SRRG_PROSLAM_SINGLE_PRECISION
+  typedef float real;
+#else
   typedef double real;
+#endif
+
+  //ds precision of batched point geometry (contiguous coordinate arrays), single precision doubles the SIMD width
+#if defined(SRRG_PROSLAM_BATCH_GEOMETRY_FLOAT) || defined(SRRG_PROSLAM_SINGLE_PRECISION)
+  typedef float batch_real;
+#else
+  typedef double batch_real;
+#endif
 
   //ds existential types
   typedef Eigen::Matrix<real, 3, 1> PointCoordinates;
@@ -67,6 +80,8 @@ namespace proslam {
   typedef cv::Mat DepthImage;
   typedef std::vector<DepthImage> DepthImageVector;
   typedef std::pair<PointCoordinates, PointColorRGB> PointDrawable;
+  typedef Eigen::Matrix<batch_real, 3, Eigen::Dynamic> PointCoordinatesBatch;
+  typedef Eigen::Array<batch_real, 1, Eigen::Dynamic> ImageCoordinatesBatch;
 
   //ds generic types
   typedef Eigen::Matrix<real, 2, 1> Vector2;  
@@ -104,12 +119,6 @@ namespace proslam {
   #define CV_COLOR_CODE_VIOLETT cv::Scalar(255, 0, 255)
   #define CV_COLOR_CODE_DARKVIOLETT cv::Scalar(150, 0, 150)
 
-  //ds log levels
-  enum LoggingLevel {Debug   = 0,
-                     Info    = 1,
-                     Warning = 2,
-                     Error   = 3};
-
   //ds timing
   #define CREATE_CHRONOMETER(NAME) \
   protected: double _time_consumption_seconds_##NAME = 0; \
@@ -130,10 +139,12 @@ namespace proslam {
   #define SRRG_PROSLAM_LOG_LEVEL 2
 #endif
 
-  //ds generic logging macro - called by each implemented logging function
+  //ds generic logging macro - called by each implemented logging function (filtered at runtime, see Logger)
   #define LOG_GENERIC(LOGGING_LEVEL, LOGGING_LEVEL_DESCRIPTION, EXPRESSION) \
-    std::cerr << srrg_core::getTimestamp() << "|" << LOGGING_LEVEL_DESCRIPTION << "|"; \
-    EXPRESSION;
+    if (proslam::Logger::isEnabled(LOGGING_LEVEL)) { \
+      const proslam::Logger::Record logger_record(LOGGING_LEVEL_DESCRIPTION); \
+      EXPRESSION; \
+    }
 
   //ds log levels (defined at compile time)
 #if SRRG_PROSLAM_LOG_LEVEL > 2
@@ -0,0 +1,240 @@
+#pragma once
+#include <cstring>
+#include "definitions.h"
+
+//ds SIMD popcount kernels (selected at compile time, e.g. through -march=native or -mfpu=neon)
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+#endif
+
+namespace proslam {
+
+static_assert(SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS == 256 || SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS == 512,
+              "SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS must be 256 or 512");
+
+//! @brief computes the Hamming distance between two binary descriptors of a fixed width
+//! the loop bounds are compile-time constants, such that the kernel unrolls completely for each width
+//! @param[in] descriptor_a_ first descriptor (no alignment required)
+//! @param[in] descriptor_b_ second descriptor (no alignment required)
+//! @return number of differing bits
+template<uint32_t descriptor_size_bytes_>
+inline uint32_t getHammingDistance(const uint8_t* descriptor_a_, const uint8_t* descriptor_b_) {
+  uint32_t distance   = 0;
+  uint32_t index_byte = 0;
+
+#if defined(__AVX2__)
+
+  //ds 32 byte blocks: nibble lookup popcount, horizontally summed with sad against zero
+  const __m256i lookup   = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i mask_low = _mm256_set1_epi8(0x0f);
+  __m256i accumulator    = _mm256_setzero_si256();
+  for (; index_byte+32 <= descriptor_size_bytes_; index_byte += 32) {
+    const __m256i difference = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(descriptor_a_+index_byte)),
+                                                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(descriptor_b_+index_byte)));
+    const __m256i count_low  = _mm256_shuffle_epi8(lookup, _mm256_and_si256(difference, mask_low));
+    const __m256i count_high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(difference, 4), mask_low));
+    accumulator = _mm256_add_epi64(accumulator, _mm256_sad_epu8(_mm256_add_epi8(count_low, count_high), _mm256_setzero_si256()));
+  }
+  distance += _mm256_extract_epi64(accumulator, 0)+_mm256_extract_epi64(accumulator, 1)+
+              _mm256_extract_epi64(accumulator, 2)+_mm256_extract_epi64(accumulator, 3);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+  //ds 16 byte blocks: byte-wise popcount, pairwise widened
+  uint32x4_t accumulator = vdupq_n_u32(0);
+  for (; index_byte+16 <= descriptor_size_bytes_; index_byte += 16) {
+    const uint8x16_t difference = veorq_u8(vld1q_u8(descriptor_a_+index_byte), vld1q_u8(descriptor_b_+index_byte));
+    accumulator = vaddq_u32(accumulator, vpaddlq_u16(vpaddlq_u8(vcntq_u8(difference))));
+  }
+  distance += vgetq_lane_u32(accumulator, 0)+vgetq_lane_u32(accumulator, 1)+
+              vgetq_lane_u32(accumulator, 2)+vgetq_lane_u32(accumulator, 3);
+#endif
+
+  //ds remaining 8 byte words (complete descriptor if no SIMD support is available)
+  for (; index_byte+8 <= descriptor_size_bytes_; index_byte += 8) {
+    uint64_t word_a, word_b;
+    std::memcpy(&word_a, descriptor_a_+index_byte, 8);
+    std::memcpy(&word_b, descriptor_b_+index_byte, 8);
+    distance += __builtin_popcountll(word_a^word_b);
+  }
+
+  //ds remaining bytes
+  for (; index_byte < descriptor_size_bytes_; ++index_byte) {
+    distance += __builtin_popcount(descriptor_a_[index_byte]^descriptor_b_[index_byte]);
+  }
+  return distance;
+}
+
+//! @brief descriptor widths with a dedicated kernel (selected at runtime from the descriptor extractor)
+//! the storage of framepoints, landmark appearances and HBST is dimensioned for SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS,
+//! narrower descriptors are zero padded (padding bits neither contribute to distances nor are they chosen as HBST split bits)
+inline bool isSupportedDescriptorSize(const uint32_t& descriptor_size_bits_) {
+  return (descriptor_size_bits_ == 256 || descriptor_size_bits_ == 512) && descriptor_size_bits_ <= SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS;
+}
+
+//! @brief computes the Hamming distance between two binary descriptors of DESCRIPTOR_SIZE_BYTES (full storage width)
+inline uint32_t getHammingDistance(const uint8_t* descriptor_a_, const uint8_t* descriptor_b_) {
+  return getHammingDistance<DESCRIPTOR_SIZE_BYTES>(descriptor_a_, descriptor_b_);
+}
+
+//! @brief computes the Hamming distance between two binary descriptors of a width selected at runtime (see isSupportedDescriptorSize)
+inline uint32_t getHammingDistance(const uint8_t* descriptor_a_, const uint8_t* descriptor_b_, const uint32_t& descriptor_size_bits_) {
+  assert(isSupportedDescriptorSize(descriptor_size_bits_));
+  return (descriptor_size_bits_ == 512)? getHammingDistance<64>(descriptor_a_, descriptor_b_): getHammingDistance<32>(descriptor_a_, descriptor_b_);
+}
+
+//! @brief convenience overload for descriptors stored in OpenCV matrices (single row of CV_8U, width given by the columns)
+inline uint32_t getHammingDistance(const cv::Mat& descriptor_a_, const cv::Mat& descriptor_b_) {
+  assert(descriptor_a_.cols == descriptor_b_.cols);
+  return getHammingDistance(descriptor_a_.ptr<uint8_t>(0), descriptor_b_.ptr<uint8_t>(0), 8*descriptor_a_.cols);
+}
+
+//! @class contiguous storage for binary descriptors in a struct-of-arrays layout
+//! each descriptor occupies a fixed stride of DESCRIPTOR_SIZE_BYTES rounded up to 32 bytes (one AVX2 register),
+//! which enables batched, cache friendly distance computations - the kernels use unaligned loads (no alignment is assumed)
+//! the descriptor width is taken from the imported descriptors, distances are dispatched once per call to the fixed-width kernel
+class DescriptorArena {
+
+//ds exported types
+public:
+
+  //! @brief descriptor stride in bytes (multiple of the widest SIMD register width, not an alignment guarantee)
+  static constexpr size_t stride_bytes = (((DESCRIPTOR_SIZE_BYTES)+31)/32)*32;
+
+//ds object handling
+public:
+
+  DescriptorArena() {}
+
+//ds functionality
+public:
+
+  //! @brief resizes the arena (content of surviving descriptors is preserved)
+  //! @param[in] number_of_descriptors_ new number of descriptors
+  void resize(const size_t& number_of_descriptors_) {
+    _data.resize(number_of_descriptors_*stride_bytes, 0);
+    _number_of_descriptors = number_of_descriptors_;
+  }
+
+  //! @brief imports all rows of a descriptor matrix (e.g. the output of a cv::DescriptorExtractor)
+  //! @param[in] descriptors_ descriptor matrix with one descriptor per row (256 or 512 bits, at most DESCRIPTOR_SIZE_BYTES)
+  void setDescriptors(const cv::Mat& descriptors_) {
+    if (descriptors_.rows > 0) {
+      setDescriptorSizeBits(8*descriptors_.cols);
+    }
+    resize(descriptors_.rows);
+    for (int32_t row = 0; row < descriptors_.rows; ++row) {
+      std::memcpy(descriptor(row), descriptors_.ptr<uint8_t>(row), descriptors_.cols);
+    }
+  }
+
+  //! @brief sets the width of the stored descriptors
+  //! @param[in] descriptor_size_bits_ descriptor width in bits (see isSupportedDescriptorSize)
+  void setDescriptorSizeBits(const uint32_t& descriptor_size_bits_) {
+    if (!isSupportedDescriptorSize(descriptor_size_bits_)) {
+      throw std::runtime_error("DescriptorArena::setDescriptorSizeBits|unsupported descriptor size: " + std::to_string(descriptor_size_bits_) +
+                               " bits (supported: 256, 512 up to SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS: " + std::to_string(SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS) + ")");
+    }
+    _descriptor_size_bits = descriptor_size_bits_;
+  }
+
+  //! @brief copies a descriptor between two slots of the arena (used for compaction and reordering)
+  void copy(const size_t& index_from_, const size_t& index_to_) {
+    if (index_from_ != index_to_) {
+      std::memcpy(descriptor(index_to_), descriptor(index_from_), _descriptor_size_bits/8);
+    }
+  }
+
+  //! @brief exchanges the content of two arenas (without copying descriptors)
+  void swap(DescriptorArena& other_) {
+    _data.swap(other_._data);
+    std::swap(_number_of_descriptors, other_._number_of_descriptors);
+    std::swap(_descriptor_size_bits, other_._descriptor_size_bits);
+  }
+
+  //! @brief computes the Hamming distance between a query and a single stored descriptor
+  uint32_t getDistance(const uint8_t* query_, const size_t& index_) const {
+    assert(index_ < _number_of_descriptors);
+    return getHammingDistance(query_, descriptor(index_), _descriptor_size_bits);
+  }
+
+  //! @brief computes the Hamming distances between a query and a contiguous range of stored descriptors
+  //! @param[in] query_ query descriptor
+  //! @param[in] index_begin_ first descriptor index of the range
+  //! @param[in] index_end_ end of the range (exclusive)
+  //! @param[out] distances_ output buffer with at least index_end_-index_begin_ elements
+  void getDistances(const uint8_t* query_, const size_t& index_begin_, const size_t& index_end_, uint32_t* distances_) const {
+    assert(index_end_ <= _number_of_descriptors);
+    if (_descriptor_size_bits == 512) {
+      _getDistances<64>(query_, index_begin_, index_end_, distances_);
+    } else {
+      _getDistances<32>(query_, index_begin_, index_end_, distances_);
+    }
+  }
+
+  //! @brief finds the closest descriptor to a query in a contiguous range of stored descriptors
+  //! @param[in] query_ query descriptor
+  //! @param[in] index_begin_ first descriptor index of the range
+  //! @param[in] index_end_ end of the range (exclusive)
+  //! @param[in,out] distance_best_ maximum accepted distance (exclusive) on input, best distance on output
+  //! @return index of the closest descriptor or index_end_ if no descriptor is closer than distance_best_
+  size_t getBestMatch(const uint8_t* query_, const size_t& index_begin_, const size_t& index_end_, uint32_t& distance_best_) const {
+    assert(index_end_ <= _number_of_descriptors);
+    if (_descriptor_size_bits == 512) {
+      return _getBestMatch<64>(query_, index_begin_, index_end_, distance_best_);
+    } else {
+      return _getBestMatch<32>(query_, index_begin_, index_end_, distance_best_);
+    }
+  }
+
+//ds getters/setters
+public:
+
+  inline uint8_t* descriptor(const size_t& index_) {return _data.data()+index_*stride_bytes;}
+  inline const uint8_t* descriptor(const size_t& index_) const {return _data.data()+index_*stride_bytes;}
+  inline const size_t& size() const {return _number_of_descriptors;}
+  inline const uint32_t& descriptorSizeBits() const {return _descriptor_size_bits;}
+
+//ds helpers
+protected:
+
+  //! @brief fixed-width implementation of getDistances
+  template<uint32_t descriptor_size_bytes_>
+  void _getDistances(const uint8_t* query_, const size_t& index_begin_, const size_t& index_end_, uint32_t* distances_) const {
+    const uint8_t* candidate = descriptor(index_begin_);
+    for (size_t index = index_begin_; index < index_end_; ++index, candidate += stride_bytes) {
+      *distances_ = getHammingDistance<descriptor_size_bytes_>(query_, candidate);
+      ++distances_;
+    }
+  }
+
+  //! @brief fixed-width implementation of getBestMatch
+  template<uint32_t descriptor_size_bytes_>
+  size_t _getBestMatch(const uint8_t* query_, const size_t& index_begin_, const size_t& index_end_, uint32_t& distance_best_) const {
+    size_t index_best        = index_end_;
+    const uint8_t* candidate = descriptor(index_begin_);
+    for (size_t index = index_begin_; index < index_end_; ++index, candidate += stride_bytes) {
+      const uint32_t distance = getHammingDistance<descriptor_size_bytes_>(query_, candidate);
+      if (distance < distance_best_) {
+        distance_best_ = distance;
+        index_best     = index;
+      }
+    }
+    return index_best;
+  }
+
+//ds attributes
+protected:
+
+  //! @brief descriptor memory (Eigen's allocator only guarantees 16 byte alignment without AVX, sufficient for the unaligned SIMD loads)
+  std::vector<uint8_t, Eigen::aligned_allocator<uint8_t>> _data;
+
+  //! @brief number of stored descriptors
+  size_t _number_of_descriptors = 0;
+
+  //! @brief width of the stored descriptors (at most the stride)
+  uint32_t _descriptor_size_bits = SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS;
+};
+} //namespace proslam
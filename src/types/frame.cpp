@@ -1,23 +1,23 @@
 #include "frame.h"
 
+#include <cstring>
 #include "world_map.h"
 
 namespace proslam {
 
-Count Frame::_instances = 0;
-
-Frame::Frame(const WorldMap* context_,
+Frame::Frame(const Identifier& identifier_,
+             const WorldMap* context_,
              Frame* previous_,
              Frame* next_,
              const TransformMatrix3D& robot_to_world_,
-             const double& timestamp_image_left_seconds_): _identifier(_instances),
+             const double& timestamp_image_left_seconds_): _identifier(identifier_),
                                                            _timestamp_image_left_seconds(timestamp_image_left_seconds_),
                                                            _previous(previous_),
                                                            _next(next_),
                                                            _local_map(nullptr) {
-  ++_instances;
   if (context_) {
     _root = context_->rootFrame();
+    _is_visualization_data_enabled = context_->isVisualizationDataEnabled();
   } else {
     _root = this;
   }
@@ -62,12 +62,10 @@ FramePoint* Frame::createFramepoint(const cv::KeyPoint& keypoint_left_,
                                     FramePoint* previous_point_) {
   assert(_camera_left != 0);
 
+  assert(descriptor_left_.cols == descriptor_right_.cols && descriptor_left_.cols <= DESCRIPTOR_SIZE_BYTES);
+
   //ds allocate a new point connected to the previous one
-  FramePoint* frame_point = new FramePoint(keypoint_left_,
-                                           descriptor_left_,
-                                           keypoint_right_,
-                                           descriptor_right_,
-                                           this);
+  FramePoint* frame_point = _createFramepoint(keypoint_left_, descriptor_left_.ptr<uint8_t>(0), keypoint_right_, descriptor_right_.ptr<uint8_t>(0), descriptor_left_.cols);
   frame_point->setCameraCoordinatesLeft(camera_coordinates_left_);
   frame_point->setRobotCoordinates(_camera_left->cameraToRobot()*camera_coordinates_left_);
   frame_point->setWorldCoordinates(this->robotToWorld()*frame_point->robotCoordinates());
@@ -101,7 +99,9 @@ FramePoint* Frame::createFramepoint(const IntensityFeature* feature_left_,
   assert(_camera_left != 0);
 
   //ds allocate a new point connected to the previous one
-  FramePoint* frame_point = new FramePoint(feature_left_, feature_right_, this);
+  FramePoint* frame_point = _createFramepoint(feature_left_->keypoint, feature_left_->descriptor.ptr<uint8_t>(0),
+                                              feature_right_->keypoint, feature_right_->descriptor.ptr<uint8_t>(0),
+                                              feature_left_->descriptor.cols);
   frame_point->setCameraCoordinatesLeft(camera_coordinates_left_);
   frame_point->setRobotCoordinates(_camera_left->cameraToRobot()*camera_coordinates_left_);
   frame_point->setWorldCoordinates(this->robotToWorld()*frame_point->robotCoordinates());
@@ -128,17 +128,134 @@ FramePoint* Frame::createFramepoint(const IntensityFeature* feature_left_,
   return frame_point;
 }
 
-void Frame::clear() {
-  for (const FramePoint* frame_point: _created_points) {
-    delete frame_point;
+FramePoint* Frame::createFramepoint(const IntensityFeature* feature_left_,
+                                    const IntensityFeature* feature_right_,
+                                    FramePoint* previous_point_) {
+
+  //ds allocate a new point connected to the previous one
+  FramePoint* frame_point = _createFramepoint(feature_left_->keypoint, feature_left_->descriptor.ptr<uint8_t>(0),
+                                              feature_right_->keypoint, feature_right_->descriptor.ptr<uint8_t>(0),
+                                              feature_left_->descriptor.cols);
+
+  //ds if there is a previous point
+  if (previous_point_) {
+
+    //ds connect the framepoints
+    frame_point->setPrevious(previous_point_);
+  } else {
+
+    //ds this point has no predecessor
+    frame_point->setOrigin(frame_point);
   }
+
+  //ds bookkeep each generated point for resize immune memory management (TODO remove costly bookkeeping)
+  _created_points.push_back(frame_point);
+  return frame_point;
+}
+
+FramePoint* Frame::_createFramepoint(const cv::KeyPoint& keypoint_left_,
+                                     const uint8_t* descriptor_left_,
+                                     const cv::KeyPoint& keypoint_right_,
+                                     const uint8_t* descriptor_right_,
+                                     const size_t& descriptor_size_bytes_) {
+
+  //ds copy descriptors into frame storage (the source buffers are recycled or temporary)
+  //ds narrower descriptors are zero padded to the storage width (recycled storage may contain previous content)
+  FramePointDescriptors* descriptors = _descriptor_arena.create();
+  std::memcpy(descriptors->left, descriptor_left_, descriptor_size_bytes_);
+  std::memcpy(descriptors->right, descriptor_right_, descriptor_size_bytes_);
+  if (descriptor_size_bytes_ < DESCRIPTOR_SIZE_BYTES) {
+    std::memset(descriptors->left+descriptor_size_bytes_, 0, DESCRIPTOR_SIZE_BYTES-descriptor_size_bytes_);
+    std::memset(descriptors->right+descriptor_size_bytes_, 0, DESCRIPTOR_SIZE_BYTES-descriptor_size_bytes_);
+  }
+  FramePointVisualizationData* visualization_data = nullptr;
+  if (_is_visualization_data_enabled) {
+    visualization_data = _visualization_arena.create();
+  }
+  return _framepoint_arena.create(_number_of_created_framepoints++, keypoint_left_, keypoint_right_, descriptors, visualization_data, this);
+}
+
+void Frame::clear() {
+  _framepoint_arena.clear();
+  _descriptor_arena.clear();
+  _visualization_arena.clear();
   _created_points.clear();
   _active_points.clear();
 }
 
+void Frame::reduce() {
+  if (_is_reduced) {
+    return;
+  }
+
+  //ds cut all links to the framepoints of this frame
+  for (FramePoint* frame_point: _created_points) {
+    if (frame_point->_next) {
+      frame_point->_next->_previous = nullptr;
+    }
+    if (frame_point->_previous) {
+      frame_point->_previous->_next = nullptr;
+    }
+    if (frame_point->_landmark) {
+      frame_point->_landmark->releaseFramepoint(frame_point);
+    }
+  }
+
+  //ds free all memory (capacities included)
+  _framepoint_arena.release();
+  _descriptor_arena.release();
+  _visualization_arena.release();
+  FramePointPointerVector().swap(_created_points);
+  FramePointPointerVector().swap(_active_points);
+  std::vector<cv::KeyPoint>().swap(_keypoints_left);
+  std::vector<cv::KeyPoint>().swap(_keypoints_right);
+  _descriptors_left.release();
+  _descriptors_right.release();
+  _intensity_image_left.release();
+  _intensity_image_right.release();
+  _camera_coordinates_left_batch.resize(3, 0);
+  _robot_coordinates_batch.resize(3, 0);
+  _world_coordinates_batch.resize(3, 0);
+  _is_reduced = true;
+}
+
+const size_t Frame::memoryUsageBytes() const {
+  size_t bytes = 0;
+  getMemoryUsage(bytes, bytes, bytes);
+  return bytes;
+}
+
+void Frame::getMemoryUsage(size_t& frame_bytes_, size_t& image_bytes_, size_t& framepoint_bytes_) const {
+  frame_bytes_ += sizeof(Frame);
+  frame_bytes_ += _descriptors_left.total()*_descriptors_left.elemSize()+_descriptors_right.total()*_descriptors_right.elemSize();
+  frame_bytes_ += (_keypoints_left.capacity()+_keypoints_right.capacity())*sizeof(cv::KeyPoint);
+  frame_bytes_ += (_created_points.capacity()+_active_points.capacity())*sizeof(FramePoint*);
+  frame_bytes_ += 3*3*_robot_coordinates_batch.cols()*sizeof(batch_real);
+  image_bytes_ += _intensity_image_left.total()*_intensity_image_left.elemSize()+_intensity_image_right.total()*_intensity_image_right.elemSize();
+  framepoint_bytes_ += _framepoint_arena.capacity()*sizeof(FramePoint)+_descriptor_arena.capacity()*sizeof(FramePointDescriptors)+
+                       _visualization_arena.capacity()*sizeof(FramePointVisualizationData);
+}
+
 void Frame::updateActivePoints() {
   for (FramePoint* point: _active_points) {
     point->setWorldCoordinates(_robot_to_world*point->robotCoordinates());
   }
+
+  //ds update contiguous world coordinates in one pass if they correspond to the active points
+  if (_robot_coordinates_batch.cols() == static_cast<int64_t>(_active_points.size())) {
+    _world_coordinates_batch = (_robot_to_world.linear().cast<batch_real>()*_robot_coordinates_batch).colwise()+
+                               _robot_to_world.translation().cast<batch_real>();
+  }
+}
+
+void Frame::updatePointCoordinatesBatch() {
+  _camera_coordinates_left_batch.resize(3, _active_points.size());
+  _robot_coordinates_batch.resize(3, _active_points.size());
+  _world_coordinates_batch.resize(3, _active_points.size());
+  for (size_t index = 0; index < _active_points.size(); ++index) {
+    _camera_coordinates_left_batch.col(index) = _active_points[index]->cameraCoordinatesLeft().cast<batch_real>();
+    _robot_coordinates_batch.col(index)       = _active_points[index]->robotCoordinates().cast<batch_real>();
+    _world_coordinates_batch.col(index)       = _active_points[index]->worldCoordinates().cast<batch_real>();
+  }
 }
 }
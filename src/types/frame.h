@@ -2,6 +2,7 @@
 #include "parameters.h"
 #include "camera.h"
 #include "frame_point.h"
+#include "identifier_map.h"
 
 namespace proslam {
   
@@ -25,7 +26,9 @@ public: EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 public: //ds TODO protect for factory
 
   //ds frame construction in the WorldMap context
-  Frame(const WorldMap* context_,
+  //! @param[in] identifier_ identifier of the frame, unique in its WorldMap (see WorldMap::createFrame)
+  Frame(const Identifier& identifier_,
+        const WorldMap* context_,
         Frame* previous_,
         Frame* next_,
         const TransformMatrix3D& robot_to_world_,
@@ -100,9 +103,18 @@ public:
                                const PointCoordinates& camera_coordinates_left_,
                                FramePoint* previous_point_ = 0);
 
+  //! @brief request a new framepoint instance without coordinates (set later by a batched triangulation of the framepoint generator)
+  FramePoint* createFramepoint(const IntensityFeature* feature_left_,
+                               const IntensityFeature* feature_right_,
+                               FramePoint* previous_point_ = 0);
+
   //! @brief created framepoints by this factory
   inline const FramePointPointerVector& createdPoints() const {return _created_points;}
 
+  //! @brief visualization data allocation switch for framepoints created from now on (frames without context, e.g. in tests)
+  void setIsVisualizationDataEnabled(const bool& is_visualization_data_enabled_) {_is_visualization_data_enabled = is_visualization_data_enabled_;}
+  const bool& isVisualizationDataEnabled() const {return _is_visualization_data_enabled;}
+
   inline const cv::Mat& intensityImageLeft() const {return _intensity_image_left;}
   void setIntensityImageLeft(const cv::Mat intensity_image_)  {_intensity_image_left = intensity_image_;}
 
@@ -122,13 +134,45 @@ public:
   //ds free all point instances
   void clear();
 
+  //! @brief releases all data except pose, timestamp and links (images, keypoints, descriptors and framepoints)
+  //! @brief tracks and landmarks referencing the released framepoints are cut at this frame
+  void reduce();
+
+  //! @brief true if the frame has been reduced
+  inline const bool isReduced() const {return _is_reduced;}
+
+  //! @brief estimated memory footprint of the frame including its images, features and framepoints
+  const size_t memoryUsageBytes() const;
+
+  //! @brief estimated memory footprint of the frame split into its components
+  //! @param[in,out] frame_bytes_ incremented by the frame structure, keypoints, descriptors and point bookkeeping
+  //! @param[in,out] image_bytes_ incremented by the retained intensity images
+  //! @param[in,out] framepoint_bytes_ incremented by the framepoint arenas (including descriptors and visualization data)
+  void getMemoryUsage(size_t& frame_bytes_, size_t& image_bytes_, size_t& framepoint_bytes_) const;
+
   //ds update framepoint world coordinates
   void updateActivePoints();
 
+  //! @brief rebuilds the contiguous geometry of the active points (column i corresponds to points()[i])
+  void updatePointCoordinatesBatch();
+
+  //! @brief contiguous geometry of the active points (valid after updatePointCoordinatesBatch, world coordinates follow pose updates)
+  inline const PointCoordinatesBatch& cameraCoordinatesLeftBatch() const {return _camera_coordinates_left_batch;}
+  inline const PointCoordinatesBatch& robotCoordinatesBatch() const {return _robot_coordinates_batch;}
+  inline const PointCoordinatesBatch& worldCoordinatesBatch() const {return _world_coordinates_batch;}
+
   Count _number_of_detected_keypoints = 0;
 
-  //ds reset allocated object counter
-  static void reset() {_instances = 0;}
+//ds helpers
+protected:
+
+  //! @brief allocates a framepoint with its descriptors (copied into the descriptor arena) and optional visualization data
+  //! @param[in] descriptor_size_bytes_ width of both descriptors (at most DESCRIPTOR_SIZE_BYTES)
+  FramePoint* _createFramepoint(const cv::KeyPoint& keypoint_left_,
+                                const uint8_t* descriptor_left_,
+                                const cv::KeyPoint& keypoint_right_,
+                                const uint8_t* descriptor_right_,
+                                const size_t& descriptor_size_bytes_);
 
 //ds attributes
 protected:
@@ -149,6 +193,9 @@ protected:
   //! @brief flag, set if track broke during processing this
   bool _is_track_broken =  false;
 
+  //! @brief flag, set if the frame data has been released (see reduce)
+  bool _is_reduced = false;
+
   //! @brief pixel tracking distance used for this frame
   uint32_t _projection_tracking_distance_pixels = 0;
 
@@ -163,9 +210,23 @@ protected:
   //! @brief bookkeeping: all created framepoints for this frame (create function)
   FramePointPointerVector _created_points;
 
+  //! @brief framepoint storage: points are created contiguously and released in bulk (memory is reused after clear)
+  ObjectArena<FramePoint> _framepoint_arena;
+
+  //! @brief framepoint descriptor storage (in creation order of the framepoints)
+  ObjectArena<FramePointDescriptors> _descriptor_arena;
+
+  //! @brief framepoint visualization data storage (only used if enabled)
+  ObjectArena<FramePointVisualizationData> _visualization_arena;
+
   //! @brief bookkeeping: active (used) framepoints in the pipeline (a subset of _created_points)
   FramePointPointerVector _active_points;
 
+  //! @brief contiguous geometry of the active points (one column per point)
+  PointCoordinatesBatch _camera_coordinates_left_batch;
+  PointCoordinatesBatch _robot_coordinates_batch;
+  PointCoordinatesBatch _world_coordinates_batch;
+
   //ds spatials
   TransformMatrix3D _frame_to_local_map = TransformMatrix3D::Identity();
   TransformMatrix3D _local_map_to_frame = TransformMatrix3D::Identity();
@@ -194,14 +255,14 @@ protected:
   TransformMatrix3D _robot_to_world_ground_truth = TransformMatrix3D::Identity();
   const Frame* _root;
 
-  //ds class specific
-  private:
+  //! @brief number of framepoints created by this frame (framepoint identifiers are unique within their frame)
+  Count _number_of_created_framepoints = 0;
 
-    //ds inner instance count - incremented upon constructor call (also unsuccessful calls)
-    static Count _instances;
+  //! @brief visualization data allocation switch for the framepoints of this frame (see WorldMap::setIsVisualizationDataEnabled)
+  bool _is_visualization_data_enabled = false;
 };
 
 typedef std::vector<Frame*> FramePointerVector;
-typedef std::pair<const Identifier, Frame*> FramePointerMapElement;
-typedef std::map<const Identifier, Frame*> FramePointerMap;
+typedef IdentifierMap<Frame*> FramePointerMap;
+typedef FramePointerMap::Element FramePointerMapElement;
 }
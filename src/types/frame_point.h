@@ -1,5 +1,6 @@
 #pragma once
 #include "definitions.h"
+#include "object_arena.h"
 #include "srrg_hbst/types/binary_tree.hpp"
 
 namespace proslam {
@@ -17,7 +18,7 @@ typedef srrg_hbst::BinaryTree<HBSTNode> HBSTTree;
 //! @struct container holding spatial and appearance information (used in findStereoKeypoints)
 struct IntensityFeature {
 
-  IntensityFeature(): row(0), col(0), index_in_vector(0) {}
+  IntensityFeature(): row(0), col(0), index_in_vector(0), matched(false) {}
 
   IntensityFeature(const cv::KeyPoint& keypoint_,
                    const cv::Mat& descriptor_,
@@ -25,16 +26,32 @@ struct IntensityFeature {
                                                     descriptor(descriptor_),
                                                     row(keypoint_.pt.y),
                                                     col(keypoint_.pt.x),
-                                                    index_in_vector(index_in_vector_) {}
+                                                    index_in_vector(index_in_vector_),
+                                                    matched(false) {}
   cv::KeyPoint keypoint;  //ds geometric: feature location in 2D
   cv::Mat descriptor;     //ds appearance: feature descriptor
   int32_t row;            //ds pixel column coordinate (v)
   int32_t col;            //ds pixel row coordinate (u)
   size_t index_in_vector; //ds inverted index for vector containing this
+  bool matched;           //ds matching status (blocks the feature for further matching)
 
 };
 typedef std::vector<IntensityFeature*> IntensityFeaturePointerVector;
 
+//! @struct stereo descriptor pair of a framepoint, stored in the descriptor arena of the owning frame
+struct FramePointDescriptors {
+  uint8_t left[DESCRIPTOR_SIZE_BYTES];
+  uint8_t right[DESCRIPTOR_SIZE_BYTES];
+};
+
+//! @struct framepoint projection estimates for visualization only (allocated only if enabled, see WorldMap::setIsVisualizationDataEnabled)
+struct FramePointVisualizationData {
+  cv::Point2f projection_estimate_left;
+  cv::Point2f projection_estimate_right;
+  cv::Point2f projection_estimate_right_corrected;
+  cv::Point2f projection_estimate_left_optimized;
+};
+
 //ds this class encapsulates the triangulation information of a salient point in the image and can be linked to a previous FramePoint instance and a Landmark
 class FramePoint {
 public: EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -45,16 +62,12 @@ public: EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 //ds object handling: specific instantiation controlled by Frame class (factory)
 protected:
 
-  //ds construct a new framepoint, owned by the provided Frame
-  FramePoint(const cv::KeyPoint& keypoint_left_,
-             const cv::Mat& descriptor_left_,
+  //ds construct a new framepoint, owned by the provided Frame (descriptors and visualization data are stored in the arenas of the frame)
+  FramePoint(const Identifier& identifier_,
+             const cv::KeyPoint& keypoint_left_,
              const cv::KeyPoint& keypoint_right_,
-             const cv::Mat& descriptor_right_,
-             Frame* frame_);
-
-  //ds construct a new framepoint, owned by the provided Frame
-  FramePoint(const IntensityFeature* feature_left_,
-             const IntensityFeature* feature_right_,
+             const FramePointDescriptors* descriptors_,
+             FramePointVisualizationData* visualization_data_,
              Frame* frame_);
 
   ~FramePoint();
@@ -62,7 +75,7 @@ protected:
 //ds getters/setters
 public:
 
-  //ds unique identifier for a framepoint (exists once in memory)
+  //ds identifier for a framepoint, unique within its frame
   inline const Index identifier() const {return _identifier;}
 
   //ds FramePoint in the previous image
@@ -115,22 +128,22 @@ public:
   //ds measured properties
   inline const cv::KeyPoint& keypointLeft() const {return _keypoint_left;}
   inline const cv::KeyPoint& keypointRight() const {return _keypoint_right;}
-  inline const cv::Mat& descriptorLeft() const {return _descriptor_left;}
-  inline const cv::Mat& descriptorRight() const {return _descriptor_right;}
+  //! @brief descriptor headers referencing the descriptor arena of the frame (no ownership, valid as long as the framepoint)
+  inline const cv::Mat descriptorLeft() const {return cv::Mat(1, DESCRIPTOR_SIZE_BYTES, CV_8UC1, const_cast<uint8_t*>(_descriptors->left));}
+  inline const cv::Mat descriptorRight() const {return cv::Mat(1, DESCRIPTOR_SIZE_BYTES, CV_8UC1, const_cast<uint8_t*>(_descriptors->right));}
+  inline const uint8_t* descriptorLeftData() const {return _descriptors->left;}
+  inline const uint8_t* descriptorRightData() const {return _descriptors->right;}
   inline const real& disparityPixels() const {return _disparity_pixels;}
 
-  //ds reset allocated object counter
-  static void reset() {_instances = 0;}
-
-  //ds visualization only
-  inline const cv::Point2f projectionEstimateLeft() const {return _projection_estimate_left;}
-  inline const cv::Point2f projectionEstimateRight() const {return _projection_estimate_right;}
-  inline const cv::Point2f projectionEstimateRightCorrected() const {return _projection_estimate_right_corrected;}
-  inline const cv::Point2f projectionEstimateLeftOptimized() const {return _projection_estimate_left_optimized;}
-  void setProjectionEstimateLeft(const cv::Point2f& projection_estimate_) {_projection_estimate_left = projection_estimate_;}
-  void setProjectionEstimateRight(const cv::Point2f& projection_estimate_) {_projection_estimate_right = projection_estimate_;}
-  void setProjectionEstimateRightCorrected(const cv::Point2f& projection_estimate_) {_projection_estimate_right_corrected = projection_estimate_;}
-  void setProjectionEstimateLeftOptimized(const cv::Point2f& projection_estimate_left_optimized_) {_projection_estimate_left_optimized = projection_estimate_left_optimized_;}
+  //ds visualization only (setters have no effect and getters return the origin if visualization data is disabled)
+  inline const cv::Point2f projectionEstimateLeft() const {return (_visualization_data)? _visualization_data->projection_estimate_left: cv::Point2f();}
+  inline const cv::Point2f projectionEstimateRight() const {return (_visualization_data)? _visualization_data->projection_estimate_right: cv::Point2f();}
+  inline const cv::Point2f projectionEstimateRightCorrected() const {return (_visualization_data)? _visualization_data->projection_estimate_right_corrected: cv::Point2f();}
+  inline const cv::Point2f projectionEstimateLeftOptimized() const {return (_visualization_data)? _visualization_data->projection_estimate_left_optimized: cv::Point2f();}
+  void setProjectionEstimateLeft(const cv::Point2f& projection_estimate_) {if (_visualization_data) {_visualization_data->projection_estimate_left = projection_estimate_;}}
+  void setProjectionEstimateRight(const cv::Point2f& projection_estimate_) {if (_visualization_data) {_visualization_data->projection_estimate_right = projection_estimate_;}}
+  void setProjectionEstimateRightCorrected(const cv::Point2f& projection_estimate_) {if (_visualization_data) {_visualization_data->projection_estimate_right_corrected = projection_estimate_;}}
+  void setProjectionEstimateLeftOptimized(const cv::Point2f& projection_estimate_left_optimized_) {if (_visualization_data) {_visualization_data->projection_estimate_left_optimized = projection_estimate_left_optimized_;}}
 
 //ds constant properties
 public:
@@ -139,32 +152,20 @@ public:
   const uint32_t row;
   const uint32_t col;
 
-//ds attributes
+//ds attributes (grouped by access: tracking and optimization first, measurement properties afterwards)
 protected:
 
-  //ds unique identifier for a framepoint (exists once in memory)
-  const Identifier _identifier;
-
   //ds connections to temporal and ownership elements
   FramePoint* _previous = nullptr; //ds FramePoint in the previous image
   FramePoint* _next     = nullptr; //ds FramePoint in the next image (updated as soon as previous is called)
   FramePoint* _origin   = nullptr; //ds FramePoint in the image where it was first detected (track start)
   Frame* _frame         = nullptr; //ds Frame to which the point belongs
 
-  //ds triangulation information (set by StereoFramePointGenerator)
-  const cv::KeyPoint _keypoint_left;
-  const cv::KeyPoint _keypoint_right;
-  const cv::Mat _descriptor_left;
-  const cv::Mat _descriptor_right;
-  const real _disparity_pixels;
-  real _descriptor_distance_triangulation;
-
-  //! @brief epipolar offset at triangulation (0 for regular, horizontal triangulation)
-  int32_t _epipolar_offset = 0;
+  //ds connected landmark (if any)
+  Landmark* _landmark = nullptr;
 
-  //! @brief feature objects
-  const IntensityFeature* _feature_left  = nullptr;
-  const IntensityFeature* _feature_right = nullptr;
+  //ds frame point track length (number of previous elements)
+  Count _track_length = 0;
 
   //ds spatial properties
   PointCoordinates _image_coordinates_left;
@@ -172,31 +173,34 @@ protected:
   PointCoordinates _camera_coordinates_left = PointCoordinates::Zero(); //ds 3D point in left camera coordinate frame
   PointCoordinates _robot_coordinates       = PointCoordinates::Zero(); //ds 3D point in robot coordinate frame
   PointCoordinates _world_coordinates       = PointCoordinates::Zero(); //ds 3D point in world coordinate frame (make sure they are updated!)
-  real _depth_meters = -1;
 
   //! @brief associated landmark coordinates in local camera frame (if any - CHECK)
   PointCoordinates _camera_coordinates_left_landmark = PointCoordinates::Zero();
+  real _depth_meters = -1;
 
-  //ds connected landmark (if any)
-  Landmark* _landmark = nullptr;
+  //ds triangulation information (set by StereoFramePointGenerator)
+  const real _disparity_pixels;
+  real _descriptor_distance_triangulation;
 
-  //ds frame point track length (number of previous elements)
-  Count _track_length = 0;
+  //! @brief epipolar offset at triangulation (0 for regular, horizontal triangulation)
+  int32_t _epipolar_offset = 0;
 
-  //ds grant access to factory for constructor calls
-  friend Frame;
+  //ds identifier for a framepoint, unique within its frame
+  const Identifier _identifier;
 
-  //ds visualization only
-  cv::Point2f _projection_estimate_left;
-  cv::Point2f _projection_estimate_right;
-  cv::Point2f _projection_estimate_right_corrected;
-  cv::Point2f _projection_estimate_left_optimized;
+  //ds measured keypoints
+  const cv::KeyPoint _keypoint_left;
+  const cv::KeyPoint _keypoint_right;
 
-//ds class specific
-private:
+  //! @brief descriptors, owned by the descriptor arena of the frame
+  const FramePointDescriptors* _descriptors;
 
-  //ds inner instance count - incremented upon constructor call (also unsuccessful calls)
-  static Count _instances;
+  //! @brief optional visualization data, owned by the visualization arena of the frame (nullptr if disabled)
+  FramePointVisualizationData* _visualization_data;
+
+  //ds grant access to factory for constructor calls (framepoints are stored in the arena of their frame)
+  friend Frame;
+  friend ObjectArena<FramePoint>;
 };
 
 typedef std::vector<FramePoint*> FramePointPointerVector;
@@ -0,0 +1,212 @@
+#pragma once
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include "definitions.h"
+
+namespace proslam {
+
+//! @class contiguous, identifier-indexed associative container (drop-in for the std::map usage in the map structures)
+//! elements are stored in a single vector sorted by identifier, removed elements are marked with tombstones
+//! for monotonically increasing identifiers (frames, landmarks) element access degenerates to direct indexing,
+//! otherwise a binary search is performed - iteration skips tombstones and runs in identifier order
+template<typename ValueType_, typename AllocatorType_ = std::allocator<std::pair<Identifier, ValueType_>>>
+class IdentifierMap {
+
+//ds exported types
+public:
+
+  typedef std::pair<Identifier, ValueType_> Element;
+  typedef std::vector<Element, AllocatorType_> ElementVector;
+
+  //! @brief forward iterator skipping tombstones
+  template<typename ContainerType_, typename ElementType_>
+  class IteratorBase: public std::iterator<std::forward_iterator_tag, ElementType_> {
+  public:
+    IteratorBase(ContainerType_* container_, const size_t& index_): _container(container_), _index(index_) {_skipTombstones();}
+
+    //ds allow conversion from iterator to const_iterator
+    template<typename OtherContainerType_, typename OtherElementType_>
+    IteratorBase(const IteratorBase<OtherContainerType_, OtherElementType_>& other_): _container(other_._container), _index(other_._index) {}
+
+    inline ElementType_& operator*() const {return _container->_elements[_index];}
+    inline ElementType_* operator->() const {return &_container->_elements[_index];}
+    inline IteratorBase& operator++() {++_index; _skipTombstones(); return *this;}
+    inline IteratorBase operator++(int) {IteratorBase iterator(*this); ++(*this); return iterator;}
+    template<typename OtherContainerType_, typename OtherElementType_>
+    inline bool operator==(const IteratorBase<OtherContainerType_, OtherElementType_>& other_) const {return _index == other_._index;}
+    template<typename OtherContainerType_, typename OtherElementType_>
+    inline bool operator!=(const IteratorBase<OtherContainerType_, OtherElementType_>& other_) const {return _index != other_._index;}
+
+  protected:
+    inline void _skipTombstones() {
+      while (_index < _container->_elements.size() && !_container->_is_valid[_index]) {
+        ++_index;
+      }
+    }
+    ContainerType_* _container;
+    size_t _index;
+    template<typename, typename> friend class IteratorBase;
+    friend class IdentifierMap;
+  };
+  typedef IteratorBase<IdentifierMap, Element> iterator;
+  typedef IteratorBase<const IdentifierMap, const Element> const_iterator;
+
+//ds object handling
+public:
+
+  IdentifierMap() {}
+
+//ds functionality
+public:
+
+  //! @brief inserts an element if its identifier is not present yet (constant time for increasing identifiers)
+  //! @param[in] element_ identifier and value
+  //! @return iterator to the element with the identifier and true if the element has been inserted
+  std::pair<iterator, bool> insert(const Element& element_) {
+
+    //ds fast path: appending (the common case for frames and landmarks)
+    if (_elements.empty() || element_.first > _elements.back().first) {
+      _elements.push_back(element_);
+      _is_valid.push_back(true);
+      ++_number_of_elements;
+      return std::make_pair(iterator(this, _elements.size()-1), true);
+    }
+
+    //ds locate insertion point
+    const size_t index = _getIndex(element_.first);
+    if (index < _elements.size() && _elements[index].first == element_.first) {
+      if (_is_valid[index]) {
+        return std::make_pair(iterator(this, index), false);
+      }
+
+      //ds revive tombstone
+      _elements[index].second = element_.second;
+      _is_valid[index] = true;
+      ++_number_of_elements;
+      return std::make_pair(iterator(this, index), true);
+    }
+    _elements.insert(_elements.begin()+index, element_);
+    _is_valid.insert(_is_valid.begin()+index, true);
+    ++_number_of_elements;
+    return std::make_pair(iterator(this, index), true);
+  }
+
+  //! @brief removes an element by leaving a tombstone (iterators stay valid, storage is reclaimed only by an explicit compact())
+  //! @param[in] identifier_ identifier of the element to remove
+  //! @return number of removed elements (0 or 1)
+  size_t erase(const Identifier& identifier_) {
+    const size_t index = _getIndex(identifier_);
+    if (index == _elements.size() || _elements[index].first != identifier_ || !_is_valid[index]) {
+      return 0;
+    }
+    _is_valid[index] = false;
+    --_number_of_elements;
+    return 1;
+  }
+
+  //! @brief element access with bounds check
+  //! @throws std::out_of_range if the identifier is not present (identical to std::map::at)
+  ValueType_& at(const Identifier& identifier_) {
+    const size_t index = _getValidIndex(identifier_);
+    if (index == _elements.size()) {
+      throw std::out_of_range("IdentifierMap::at|identifier not present: " + std::to_string(identifier_));
+    }
+    return _elements[index].second;
+  }
+  const ValueType_& at(const Identifier& identifier_) const {
+    return const_cast<IdentifierMap*>(this)->at(identifier_);
+  }
+
+  //! @brief element lookup
+  //! @return iterator to the element or end() if the identifier is not present
+  iterator find(const Identifier& identifier_) {return iterator(this, _getValidIndex(identifier_));}
+  const_iterator find(const Identifier& identifier_) const {return const_iterator(this, _getValidIndex(identifier_));}
+  size_t count(const Identifier& identifier_) const {return (_getValidIndex(identifier_) == _elements.size())? 0: 1;}
+
+  //! @brief first element with an identifier not smaller than the provided one (e.g. to visit elements appended since a given identifier)
+  //! @return iterator to the element or end() if all identifiers are smaller
+  iterator lower_bound(const Identifier& identifier_) {return iterator(this, _getIndex(identifier_));}
+  const_iterator lower_bound(const Identifier& identifier_) const {return const_iterator(this, _getIndex(identifier_));}
+
+  //! @brief removes all tombstones (invalidates iterators - call only at points where no iteration is in progress)
+  void compact() {
+    size_t index_valid = 0;
+    for (size_t index = 0; index < _elements.size(); ++index) {
+      if (_is_valid[index]) {
+        if (index != index_valid) {
+          _elements[index_valid] = std::move(_elements[index]);
+        }
+        ++index_valid;
+      }
+    }
+    _elements.erase(_elements.begin()+index_valid, _elements.end());
+    _is_valid.assign(index_valid, true);
+  }
+
+  void reserve(const size_t& number_of_elements_) {
+    _elements.reserve(number_of_elements_);
+    _is_valid.reserve(number_of_elements_);
+  }
+
+  void clear() {
+    _elements.clear();
+    _is_valid.clear();
+    _number_of_elements = 0;
+  }
+
+//ds getters/setters
+public:
+
+  iterator begin() {return iterator(this, 0);}
+  iterator end() {return iterator(this, _elements.size());}
+  const_iterator begin() const {return const_iterator(this, 0);}
+  const_iterator end() const {return const_iterator(this, _elements.size());}
+
+  //! @brief number of valid elements (tombstones excluded)
+  inline const size_t& size() const {return _number_of_elements;}
+  inline const bool empty() const {return _number_of_elements == 0;}
+
+  //! @brief true if tombstones dominate the element storage and a compact() is worthwhile
+  inline const bool isSparse() const {return _elements.size() > 2*_number_of_elements+64;}
+
+//ds helpers
+protected:
+
+  //! @brief position of the identifier in the element vector (or of the first larger identifier)
+  inline const size_t _getIndex(const Identifier& identifier_) const {
+    if (_elements.empty() || identifier_ < _elements.front().first) {
+      return 0;
+    }
+
+    //ds direct indexing if no identifiers were skipped up to the desired one
+    const size_t index_direct = identifier_-_elements.front().first;
+    if (index_direct < _elements.size() && _elements[index_direct].first == identifier_) {
+      return index_direct;
+    }
+    return std::lower_bound(_elements.begin(), _elements.end(), identifier_,
+                            [](const Element& element_, const Identifier& identifier_) {return element_.first < identifier_;})-_elements.begin();
+  }
+
+  //! @brief position of a valid element with the identifier (or the number of elements if not present)
+  inline const size_t _getValidIndex(const Identifier& identifier_) const {
+    const size_t index = _getIndex(identifier_);
+    if (index < _elements.size() && _elements[index].first == identifier_ && _is_valid[index]) {
+      return index;
+    }
+    return _elements.size();
+  }
+
+//ds attributes
+protected:
+
+  //! @brief elements sorted by identifier (including tombstones)
+  ElementVector _elements;
+
+  //! @brief tombstone markers (false for removed elements)
+  std::vector<bool> _is_valid;
+
+  //! @brief number of valid elements
+  size_t _number_of_elements = 0;
+};
+} //namespace proslam
@@ -0,0 +1,73 @@
+#pragma once
+#include "definitions.h"
+
+namespace proslam {
+
+//! @class recycles image buffers (e.g. for converted camera images) to avoid an allocation per frame
+//! a buffer is handed out again once all other references to it (e.g. held by frames or viewers) have been released
+//! the pool is not thread-safe and must be used by a single thread (the buffers themselves can be passed on)
+class ImageBufferPool {
+
+//ds object handling
+public:
+
+  //! @brief constructor
+  //! @param[in] maximum_number_of_buffers_ buffers beyond this number are allocated without being recycled
+  ImageBufferPool(const size_t& maximum_number_of_buffers_): _maximum_number_of_buffers(maximum_number_of_buffers_) {
+    _buffers.reserve(_maximum_number_of_buffers);
+  }
+
+//ds functionality
+public:
+
+  //! @brief returns an unreferenced buffer of the desired format or allocates a new one
+  //! @param[in] rows_ image rows
+  //! @param[in] cols_ image columns
+  //! @param[in] type_ OpenCV image type (e.g. CV_8UC1)
+  //! @return image buffer (content undefined)
+  cv::Mat acquire(const int32_t& rows_, const int32_t& cols_, const int32_t& type_) {
+    for (const cv::Mat& buffer: _buffers) {
+      if (buffer.rows == rows_ && buffer.cols == cols_ && buffer.type() == type_ && _isUnreferenced(buffer)) {
+        return buffer;
+      }
+    }
+    cv::Mat buffer(rows_, cols_, type_);
+    if (_buffers.size() < _maximum_number_of_buffers) {
+      _buffers.push_back(buffer);
+    }
+    ++_number_of_allocations;
+    return buffer;
+  }
+
+//ds getters/setters
+public:
+
+  inline const size_t numberOfBuffers() const {return _buffers.size();}
+  inline const Count& numberOfAllocations() const {return _number_of_allocations;}
+
+//ds helpers
+protected:
+
+  //! @brief true if the pool holds the only reference to the buffer
+  //! the reference count is read atomically, since other threads (e.g. the tracking thread) release their references concurrently
+  static inline const bool _isUnreferenced(const cv::Mat& buffer_) {
+#if CV_MAJOR_VERSION == 2
+    return buffer_.refcount && CV_XADD(buffer_.refcount, 0) == 1;
+#else
+    return buffer_.u && CV_XADD(&buffer_.u->refcount, 0) == 1;
+#endif
+  }
+
+//ds attributes
+protected:
+
+  //! @brief recycled buffers
+  std::vector<cv::Mat> _buffers;
+
+  //! @brief maximum number of recycled buffers
+  const size_t _maximum_number_of_buffers;
+
+  //! @brief informative only: number of allocated buffers
+  Count _number_of_allocations = 0;
+};
+} //namespace proslam
@@ -1,17 +1,17 @@
 #include "landmark.h"
 #include "local_map.h"
+#include "descriptor_arena.h"
 
 namespace proslam {
 
-Count Landmark::_instances = 0;
-
-Landmark::Landmark(FramePoint* origin_, const LandmarkParameters* parameters_): _identifier(_instances),
-                                                                                _origin(origin_),
-                                                                                _parameters(parameters_) {
-  ++_instances;
+Landmark::Landmark(const Identifier& identifier_,
+                   FramePoint* origin_,
+                   const LandmarkParameters* parameters_): _identifier(identifier_),
+                                                           _origin(origin_),
+                                                           _parameters(parameters_) {
   _measurements.clear();
   _appearance_map.clear();
-  _descriptors.clear();
+  _descriptors.release();
   _local_maps.clear();
 
   //ds compute initial position estimate as rude average of the track
@@ -28,35 +28,98 @@ Landmark::Landmark(FramePoint* origin_, const LandmarkParameters* parameters_):
   }
   _world_coordinates /= _measurements.size();
   _number_of_updates = _measurements.size();
+  _accumulateMeasurements();
 }
 
+Landmark::Landmark(const Identifier& identifier_,
+                   const PointCoordinates& world_coordinates_,
+                   const Count& number_of_updates_,
+                   const LandmarkParameters* parameters_): _identifier(identifier_),
+                                                           _world_coordinates(world_coordinates_),
+                                                           _number_of_updates(number_of_updates_),
+                                                           _parameters(parameters_) {}
+
 Landmark::~Landmark() {
   _appearance_map.clear();
   _measurements.clear();
-  _descriptors.clear();
+  _descriptors.release();
   _local_maps.clear();
 }
 
 void Landmark::replace(const HBSTMatchable* matchable_old_, HBSTMatchable* matchable_new_) {
 
   //ds remove the old matchable and check for failure
-  if (_appearance_map.erase(matchable_old_) != 1) {
+  HBSTMatchableMemoryMap::iterator iterator = _appearance_map.find(matchable_old_);
+  if (iterator == _appearance_map.end()) {
     LOG_WARNING(std::cerr << "Landmark::replace|" << _identifier << "|unable to erase old HBSTMatchable: " << matchable_old_ << std::endl)
+    return;
   }
+  const Identifier local_map_identifier = iterator->second.local_map_identifier;
+  _appearance_map.erase(iterator);
 
   //ds insert new matchable - not critical if already present (same landmark in subsequent local maps)
-  _appearance_map.insert(std::make_pair(matchable_new_, matchable_new_));
+  _appearance_map.insert(std::make_pair(matchable_new_, Appearance(matchable_new_, local_map_identifier)));
+}
+
+const cv::Mat Landmark::selectDescriptors(const Count& maximum_number_of_descriptors_) const {
+  const Count number_of_descriptors = _descriptors.rows;
+  if (maximum_number_of_descriptors_ == 0 || number_of_descriptors <= maximum_number_of_descriptors_) {
+    return _descriptors;
+  }
+
+  //ds medoid: descriptor with the minimum total distance to all others (each pairwise distance is computed once)
+  std::vector<uint64_t> total_distances(number_of_descriptors, 0);
+  for (Count index_a = 0; index_a < number_of_descriptors; ++index_a) {
+    const uint8_t* descriptor_a = _descriptors.ptr<uint8_t>(index_a);
+    for (Count index_b = index_a+1; index_b < number_of_descriptors; ++index_b) {
+      const uint32_t distance = getHammingDistance(descriptor_a, _descriptors.ptr<uint8_t>(index_b));
+      total_distances[index_a] += distance;
+      total_distances[index_b] += distance;
+    }
+  }
+  const Count index_medoid = std::min_element(total_distances.begin(), total_distances.end())-total_distances.begin();
+  cv::Mat descriptors_selected;
+  descriptors_selected.push_back(_descriptors.row(index_medoid));
+
+  //ds add the most diverse exemplars: descriptor farthest from its closest selected descriptor
+  std::vector<uint32_t> distances_to_selection(number_of_descriptors);
+  const uint8_t* descriptor_medoid = _descriptors.ptr<uint8_t>(index_medoid);
+  for (Count index = 0; index < number_of_descriptors; ++index) {
+    distances_to_selection[index] = getHammingDistance(descriptor_medoid, _descriptors.ptr<uint8_t>(index));
+  }
+  while (static_cast<Count>(descriptors_selected.rows) < maximum_number_of_descriptors_) {
+    const Count index_farthest = std::max_element(distances_to_selection.begin(), distances_to_selection.end())-distances_to_selection.begin();
+
+    //ds stop if all remaining descriptors are identical to a selected one
+    if (distances_to_selection[index_farthest] == 0) {
+      break;
+    }
+    descriptors_selected.push_back(_descriptors.row(index_farthest));
+    const uint8_t* descriptor_farthest = _descriptors.ptr<uint8_t>(index_farthest);
+    for (Count index = 0; index < number_of_descriptors; ++index) {
+      distances_to_selection[index] = std::min(distances_to_selection[index], getHammingDistance(descriptor_farthest, _descriptors.ptr<uint8_t>(index)));
+    }
+  }
+  return descriptors_selected;
 }
 
-void Landmark::update(FramePoint* point_) {
+void Landmark::addMeasurement(FramePoint* point_) {
   _last_update = point_;
 
   //ds update appearance history (left descriptors only)
   _descriptors.push_back(point_->descriptorLeft());
   _measurements.push_back(Measurement(point_));
+  _accumulateMeasurements();
+  ++_revision;
+}
+
+void Landmark::optimizePosition(const MeasurementVector& measurements_,
+                                const AccumulatedInformation& accumulated_information_,
+                                PointCoordinates& world_coordinates_,
+                                Count& number_of_updates_) {
 
   //ds trigger classic ICP in camera update of landmark coordinates - setup
-  Vector3 world_coordinates(_world_coordinates);
+  Vector3 world_coordinates(world_coordinates_);
   Matrix3 H(Matrix3::Zero());
   Vector3 b(Vector3::Zero());
   Matrix3 jacobian;
@@ -67,13 +130,17 @@ void Landmark::update(FramePoint* point_) {
 
   //ds gauss newton descent
   for (uint32_t iteration = 0; iteration < 1000; ++iteration) {
-    H.setZero();
-    b.setZero();
     real total_error_squared    = 0;
-    uint32_t number_of_outliers = 0;
+    uint32_t number_of_outliers = accumulated_information_.number_of_measurements-accumulated_information_.number_of_inliers;
+
+    //ds accumulated measurements contribute with their fixed weights
+    H = accumulated_information_.H;
+    b = accumulated_information_.H*world_coordinates-accumulated_information_.b;
+    total_error_squared += world_coordinates.dot(accumulated_information_.H*world_coordinates-2*accumulated_information_.b);
+    total_error_squared += accumulated_information_.error_squared;
 
     //ds for each measurement
-    for (const Measurement& measurement: _measurements) {
+    for (const Measurement& measurement: measurements_) {
       omega.setIdentity();
 
       //ds sample current state in measurement context
@@ -115,26 +182,26 @@ void Landmark::update(FramePoint* point_) {
 
     //ds check convergence
     if (std::fabs(total_error_squared-total_error_squared_previous) < 1e-5 || iteration == 999) {
-      const uint32_t number_of_inliers = _measurements.size()-number_of_outliers;
+      const uint32_t number_of_inliers = measurements_.size()+accumulated_information_.number_of_measurements-number_of_outliers;
 
       //ds if the number of inliers is higher than the best so far
-      if (number_of_inliers > _number_of_updates) {
+      if (number_of_inliers > number_of_updates_) {
 
         //ds update landmark state
-        _world_coordinates = world_coordinates;
-        _number_of_updates        = number_of_inliers;
+        world_coordinates_ = world_coordinates;
+        number_of_updates_ = number_of_inliers;
 
       //ds if optimization failed and we have less inliers than outliers - reset initial guess
       } else if (number_of_inliers < number_of_outliers) {
 
         //ds reset estimate based on overall average
-        PointCoordinates world_coordinates_accumulated(PointCoordinates::Zero());
-        for (const Measurement& measurement: _measurements) {
+        PointCoordinates world_coordinates_accumulated(accumulated_information_.world_coordinates_sum);
+        for (const Measurement& measurement: measurements_) {
           world_coordinates_accumulated += measurement.world_coordinates;
         }
 
         //ds set landmark state without increasing update count
-        _world_coordinates = world_coordinates_accumulated/_measurements.size();
+        world_coordinates_ = world_coordinates_accumulated/(measurements_.size()+accumulated_information_.number_of_measurements);
       }
       break;
     }
@@ -144,6 +211,48 @@ void Landmark::update(FramePoint* point_) {
   }
 }
 
+void Landmark::getPositionUpdate(PositionUpdate& position_update_) const {
+  position_update_.identifier        = _identifier;
+  position_update_.revision          = _revision;
+  position_update_.measurements            = _measurements;
+  position_update_.accumulated_information = _accumulated_information;
+  position_update_.world_coordinates = _world_coordinates;
+  position_update_.number_of_updates = _number_of_updates;
+}
+
+bool Landmark::applyPositionUpdate(const PositionUpdate& position_update_) {
+  assert(position_update_.identifier == _identifier);
+
+  //ds discard the update if the landmark changed in the meantime (e.g. new measurements, map optimization or merging)
+  if (position_update_.revision != _revision) {
+    return false;
+  }
+  _world_coordinates = position_update_.world_coordinates;
+  _number_of_updates = position_update_.number_of_updates;
+  ++_revision;
+  return true;
+}
+
+void Landmark::transform(const TransformMatrix3D& transform_) {
+  const TransformMatrix3D transform_inverse(transform_.inverse());
+  _world_coordinates = transform_*_world_coordinates;
+  for (Measurement& measurement: _measurements) {
+    measurement.world_to_camera   = measurement.world_to_camera*transform_inverse;
+    measurement.world_coordinates = transform_*measurement.world_coordinates;
+  }
+
+  //ds the accumulated error x'*H*x-2*x'*b+error_squared in the new frame (x = R'*(y-t)) has the same form
+  const Matrix3& rotation = transform_.linear();
+  const Vector3& translation = transform_.translation();
+  AccumulatedInformation& information = _accumulated_information;
+  information.H                      = rotation*information.H*rotation.transpose();
+  const Vector3 b_rotated            = rotation*information.b;
+  information.error_squared         += translation.dot(information.H*translation)+2*translation.dot(b_rotated);
+  information.b                      = information.H*translation+b_rotated;
+  information.world_coordinates_sum  = rotation*information.world_coordinates_sum+information.number_of_measurements*translation;
+  ++_revision;
+}
+
 void Landmark::merge(Landmark* landmark_) {
   if (landmark_ == this) {
     LOG_WARNING(std::cerr << "Landmark::merge|" << _identifier << "|received merge request to itself: " << landmark_ << std::endl)
@@ -152,7 +261,7 @@ void Landmark::merge(Landmark* landmark_) {
 
   //ds merge landmark appearances
   for (auto& appearance: landmark_->_appearance_map) {
-    appearance.second->setObjects(this);
+    appearance.second.matchable->setObjects(this);
   }
   _appearance_map.insert(landmark_->_appearance_map.begin(), landmark_->_appearance_map.end());
   landmark_->_appearance_map.clear();
@@ -165,8 +274,8 @@ void Landmark::merge(Landmark* landmark_) {
   landmark_->_local_maps.clear();
 
   //ds merge descriptors
-  _descriptors.insert(_descriptors.end(), landmark_->_descriptors.begin(), landmark_->_descriptors.end());
-  landmark_->_descriptors.clear();
+  _descriptors.push_back(landmark_->_descriptors);
+  landmark_->_descriptors.release();
 
   //ds compute new merged world coordinates
   _world_coordinates = (_number_of_updates*_world_coordinates+
@@ -174,21 +283,93 @@ void Landmark::merge(Landmark* landmark_) {
                        /(_number_of_updates+landmark_->_number_of_updates);
 
   //ds update measurements
+  ++_revision;
   _number_of_updates    += landmark_->_number_of_updates;
   _number_of_recoveries += landmark_->_number_of_recoveries;
   _measurements.insert(_measurements.end(), landmark_->_measurements.begin(), landmark_->_measurements.end());
   landmark_->_measurements.clear();
+  _accumulated_information.add(landmark_->_accumulated_information);
+  _accumulateMeasurements();
+
+  //ds if the framepoint histories of both landmarks are complete (frames might have been reduced)
+  if (landmark_->_origin && _last_update) {
+
+    //ds connect framepoint history (last update of this with origin of absorbed landmark)
+    landmark_->_origin->setPrevious(_last_update);
+
+    //ds update track lengths and landmark references until we arrive in the last framepoint of the absorbed landmark
+    //ds which will replace the _last_update of this landmark
+    while (_last_update->next()) {
+      _last_update = _last_update->next();
+      _last_update->setLandmark(this);
+      _last_update->setTrackLength(_last_update->previous()->trackLength()+1);
+      _last_update->setOrigin(_origin);
+    }
+  } else if (landmark_->_last_update) {
+
+    //ds relink the remaining framepoints of the absorbed landmark without connecting the histories
+    _last_update = landmark_->_last_update;
+    for (FramePoint* framepoint = _last_update; framepoint; framepoint = framepoint->previous()) {
+      framepoint->setLandmark(this);
+    }
+  }
+}
+
+const size_t Landmark::memoryUsageBytes() const {
+  size_t bytes = sizeof(Landmark);
+  bytes += _measurements.capacity()*sizeof(Measurement);
+  bytes += _descriptors.total()*_descriptors.elemSize();
+  bytes += _local_maps.size()*(sizeof(LocalMap*)+4*sizeof(void*));
+  return bytes;
+}
+
+void Landmark::_accumulateMeasurements() {
+  if (!_parameters->enable_incremental_estimation || _measurements.size() <= _parameters->maximum_number_of_measurements) {
+    return;
+  }
+
+  //ds accumulate the oldest measurements with their robust weight at the current estimate
+  const Count number_of_measurements_to_accumulate = _measurements.size()-_parameters->maximum_number_of_measurements;
+  for (Index index = 0; index < number_of_measurements_to_accumulate; ++index) {
+    _accumulated_information.add(_measurements[index], _world_coordinates);
+  }
+  _measurements.erase(_measurements.begin(), _measurements.begin()+number_of_measurements_to_accumulate);
+}
+
+void Landmark::AccumulatedInformation::add(const Measurement& measurement_, const PointCoordinates& world_coordinates_) {
+  world_coordinates_sum += measurement_.world_coordinates;
+  ++number_of_measurements;
 
-  //ds connect framepoint history (last update of this with origin of absorbed landmark)
-  landmark_->_origin->setPrevious(_last_update);
+  //ds measurements behind the camera do not contribute (as in the optimization)
+  const PointCoordinates camera_coordinates_sampled = measurement_.world_to_camera*world_coordinates_;
+  if (camera_coordinates_sampled.z() <= 0) {
+    return;
+  }
 
-  //ds update track lengths and landmark references until we arrive in the last framepoint of the absorbed landmark
-  //ds which will replace the _last_update of this landmark
-  while (_last_update->next()) {
-    _last_update = _last_update->next();
-    _last_update->setLandmark(this);
-    _last_update->setTrackLength(_last_update->previous()->trackLength()+1);
-    _last_update->setOrigin(_origin);
+  //ds robust weight at the current estimate (same kernel as in the optimization)
+  const real maximum_error_squared_meters = 5*5;
+  real omega = measurement_.inverse_depth_meters;
+  const real error_squared_measurement = omega*(camera_coordinates_sampled-measurement_.camera_coordinates).squaredNorm();
+  if (error_squared_measurement > maximum_error_squared_meters) {
+    omega *= maximum_error_squared_meters/error_squared_measurement;
+  } else {
+    ++number_of_inliers;
   }
+
+  //ds accumulate the linear system (the error is linear in the landmark position: R*x+t-c)
+  const Matrix3& rotation = measurement_.world_to_camera.linear();
+  const Vector3 offset(measurement_.camera_coordinates-measurement_.world_to_camera.translation());
+  H             += omega*rotation.transpose()*rotation;
+  b             += omega*rotation.transpose()*offset;
+  error_squared += omega*offset.squaredNorm();
+}
+
+void Landmark::AccumulatedInformation::add(const AccumulatedInformation& information_) {
+  H                      += information_.H;
+  b                      += information_.b;
+  error_squared          += information_.error_squared;
+  world_coordinates_sum  += information_.world_coordinates_sum;
+  number_of_measurements += information_.number_of_measurements;
+  number_of_inliers      += information_.number_of_inliers;
 }
 }
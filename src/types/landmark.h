@@ -1,4 +1,5 @@
 #pragma once
+#include <limits>
 #include "frame.h"
 
 namespace proslam {
@@ -14,7 +15,15 @@ public: EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 //ds exported types
 public:
 
-  typedef std::map<const HBSTMatchable*, HBSTMatchable*> HBSTMatchableMemoryMap;
+  //ds an appearance of the landmark in the place database, with the local map it has been captured in
+  struct Appearance {
+    Appearance(HBSTMatchable* matchable_, const Identifier& local_map_identifier_): matchable(matchable_),
+                                                                                   local_map_identifier(local_map_identifier_) {}
+    HBSTMatchable* matchable;
+    Identifier local_map_identifier;
+  };
+
+  typedef std::map<const HBSTMatchable*, Appearance> HBSTMatchableMemoryMap;
 
   //ds a landmark measurement (used for position optimization)
   struct Measurement {
@@ -37,11 +46,50 @@ public:
 
   typedef std::vector<Measurement, Eigen::aligned_allocator<Measurement>> MeasurementVector;
 
+  //ds accumulated information of measurements that are no longer kept individually (incremental estimation)
+  //ds the squared error of an accumulated measurement at x is: x'*H*x-2*x'*b+error_squared
+  struct AccumulatedInformation {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    //ds accumulates a measurement with its robust weight at the provided position estimate
+    void add(const Measurement& measurement_, const PointCoordinates& world_coordinates_);
+
+    //ds accumulates the information of another landmark (merging)
+    void add(const AccumulatedInformation& information_);
+
+    Matrix3 H                              = Matrix3::Zero();
+    Vector3 b                              = Vector3::Zero();
+    real error_squared                     = 0;
+    PointCoordinates world_coordinates_sum = PointCoordinates::Zero();
+    Count number_of_measurements           = 0;
+    Count number_of_inliers                = 0;
+  };
+
+  //ds a snapshot of the position estimation problem of a landmark (refined independently of the landmark, e.g. in a background worker)
+  struct PositionUpdate {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Identifier identifier = 0;
+    Count revision        = 0;
+    MeasurementVector measurements;
+    AccumulatedInformation accumulated_information;
+    PointCoordinates world_coordinates = PointCoordinates::Zero();
+    Count number_of_updates            = 0;
+  };
+
+  typedef std::vector<PositionUpdate, Eigen::aligned_allocator<PositionUpdate>> PositionUpdateVector;
+
 //ds object handling: specific instantiation controlled by WorldMap class (factory)
 protected:
 
   //ds initial landmark coordinates must be provided
-  Landmark(FramePoint* origin_, const LandmarkParameters* parameters_);
+  Landmark(const Identifier& identifier_, FramePoint* origin_, const LandmarkParameters* parameters_);
+
+  //! @brief constructs a landmark without measurement history (e.g. loaded from a map file)
+  //! @param[in] identifier_ identifier of the landmark, unique in its WorldMap
+  //! @param[in] world_coordinates_ landmark position estimate
+  //! @param[in] number_of_updates_ number of inliers of the position estimate
+  //! @param[in] parameters_ landmark parameters
+  Landmark(const Identifier& identifier_, const PointCoordinates& world_coordinates_, const Count& number_of_updates_, const LandmarkParameters* parameters_);
 
   //ds cleanup of dynamic structures
   ~Landmark();
@@ -58,14 +106,29 @@ public:
   //ds framepoint in an image at the time when the landmark was created
   inline FramePoint* origin() const {return _origin;}
 
+  //! @brief most recent framepoint of the landmark that is still in memory (nullptr if released)
+  inline FramePoint* lastUpdate() const {return _last_update;}
+
   inline const PointCoordinates& coordinates() const {return _world_coordinates;}
-  void setCoordinates(const PointCoordinates& coordinates_) {_world_coordinates = coordinates_;}
+  void setCoordinates(const PointCoordinates& coordinates_) {_world_coordinates = coordinates_; ++_revision;}
 
   //! @brief replaces a matchable in the appearance map
   void replace(const HBSTMatchable* matchable_old_, HBSTMatchable* matchable_new_);
 
   const HBSTMatchableMemoryMap& appearances() const {return _appearance_map;}
 
+  //! @brief estimated memory footprint of the landmark including its measurements and pending descriptors (without appearances)
+  const size_t memoryUsageBytes() const;
+
+  //! @brief estimated memory footprint of the appearance bookkeeping (the matchables themselves are owned by the local map or place database)
+  inline const size_t appearancesMemoryUsageBytes() const {return _appearance_map.size()*(sizeof(HBSTMatchableMemoryMap::value_type)+4*sizeof(void*));}
+
+  //! @brief selects a bounded set of representative descriptors from the pending appearance history
+  //! @brief the medoid is selected first, followed by the descriptors farthest (Hamming) from the selection (k-center)
+  //! @param[in] maximum_number_of_descriptors_ maximum number of selected descriptors (0: all descriptors)
+  //! @return selected descriptors, one row per descriptor
+  const cv::Mat selectDescriptors(const Count& maximum_number_of_descriptors_) const;
+
   //ds position related
   const Count numberOfUpdates() const {return _number_of_updates;}
 
@@ -73,20 +136,65 @@ public:
   inline const bool isCurrentlyTracked() const {return _is_currently_tracked;}
   inline void setIsCurrentlyTracked(const bool& is_currently_tracked_) {_is_currently_tracked = is_currently_tracked_;}
 
+  //! @brief identifier of the last frame in which the landmark has been scheduled for a position update (each landmark is refined once per frame)
+  inline const Identifier& identifierFrameScheduledUpdate() const {return _identifier_frame_scheduled_update;}
+  inline void setIdentifierFrameScheduledUpdate(const Identifier& identifier_frame_) {_identifier_frame_scheduled_update = identifier_frame_;}
+
   //ds landmark coordinates update with visual information (tracking)
-  void update(FramePoint* point_);
+  void update(FramePoint* point_) {addMeasurement(point_); optimizePosition();}
+
+  //! @brief adds a measurement (and appearance) of the landmark without refining its position
+  //! @param[in] point_ framepoint observing the landmark
+  void addMeasurement(FramePoint* point_);
+
+  //! @brief refines the landmark position over all measurements (safe to call concurrently for different landmarks)
+  void optimizePosition() {optimizePosition(_measurements, _accumulated_information, _world_coordinates, _number_of_updates); ++_revision;}
+
+  //! @brief refines a landmark position estimate over the provided measurements without touching any landmark
+  //! @param[in] measurements_ landmark measurements (robustly re-weighted)
+  //! @param[in] accumulated_information_ information of measurements that are not stored individually (fixed weights)
+  //! @param[in,out] world_coordinates_ landmark position estimate
+  //! @param[in,out] number_of_updates_ number of inliers of the current estimate (only improved estimates are accepted)
+  static void optimizePosition(const MeasurementVector& measurements_,
+                               const AccumulatedInformation& accumulated_information_,
+                               PointCoordinates& world_coordinates_,
+                               Count& number_of_updates_);
+
+  //! @brief captures the current position estimation problem (measurements are copied)
+  //! @param[out] position_update_ snapshot (buffers are reused)
+  void getPositionUpdate(PositionUpdate& position_update_) const;
+
+  //! @brief applies a refined snapshot, if the landmark did not change since the snapshot was taken
+  //! @param[in] position_update_ refined snapshot of this landmark
+  //! @return true if the snapshot was applied
+  bool applyPositionUpdate(const PositionUpdate& position_update_);
+
+  //! @brief state revision, incremented on every change of the landmark position or measurements
+  inline const Count& revision() const {return _revision;}
 
   const Count& numberOfRecoveries() const {return _number_of_recoveries;}
   void incrementNumberOfRecoveries() {++_number_of_recoveries;}
   void setNumberOfRecoveries(const Count& number_of_recoveries_) {_number_of_recoveries = number_of_recoveries_;}
 
+  //! @brief drops references to a framepoint that is released with its frame (sliding window)
+  //! @brief the last update moves on to a subsequent framepoint of the track if present (e.g. pruned in pose optimization)
+  //! @param[in] point_ released framepoint of this landmark
+  void releaseFramepoint(const FramePoint* point_) {
+    if (_origin == point_) {_origin = nullptr;}
+    if (_last_update == point_) {_last_update = (point_->next() && point_->next()->landmark() == this)? point_->next(): nullptr;}
+  }
+
+  //! @brief true if no framepoint in memory references this landmark anymore and it is not part of a local map
+  inline const bool isReleased() const {return !_origin && !_last_update && _local_maps.empty();}
+
+  //! @brief moves the landmark including its measurements into another coordinate frame (e.g. when re-anchoring a track)
+  //! @param[in] transform_ transform from the current to the new coordinate frame
+  void transform(const TransformMatrix3D& transform_);
+
   //! @brief incorporates another landmark into this (e.g. used when relocalizing)
   //! @param[in] landmark_ the landmark to absorbed, landmark_ will be freed and its memory location will point to this
   void merge(Landmark* landmark_);
 
-  //ds reset allocated object counter
-  static void reset() {_instances = 0;}
-
   //ds visualization only
   inline const bool isInLoopClosureQuery() const {return _is_in_loop_closure_query;}
   inline const bool isInLoopClosureReference() const {return _is_in_loop_closure_reference;}
@@ -108,8 +216,8 @@ protected:
   //ds world coordinates of the landmark
   PointCoordinates _world_coordinates;
 
-  //ds descriptors of this landmark which have not been converted to appearances yet
-  std::vector<cv::Mat> _descriptors;
+  //ds descriptors of this landmark which have not been converted to appearances yet (one row per descriptor, copied from the framepoints)
+  cv::Mat _descriptors;
 
   //ds appearances of this landmark that are captured in a local map (previously contained in _descriptors)
   HBSTMatchableMemoryMap _appearance_map;
@@ -122,8 +230,11 @@ protected:
 
   //ds landmark coordinates optimization
   MeasurementVector _measurements;
+  AccumulatedInformation _accumulated_information;
   Count _number_of_updates    = 0;
   Count _number_of_recoveries = 0;
+  Count _revision             = 0;
+  Identifier _identifier_frame_scheduled_update = std::numeric_limits<Identifier>::max();
 
   //ds grant access to landmark factory and helpers
   friend WorldMap;
@@ -136,17 +247,16 @@ protected:
 //ds class specific
 private:
 
+  //! @brief incremental estimation: accumulates the oldest measurements until the bounded history size is met
+  void _accumulateMeasurements();
+
   //! @brief configurable parameters
   const LandmarkParameters* _parameters;
-
-  //ds inner instance count - incremented upon constructor call (also unsuccessful calls)
-  static Count _instances;
-
 };
 
 typedef std::vector<Landmark*> LandmarkPointerVector;
-typedef std::pair<const Identifier, Landmark*> LandmarkPointerMapElement;
-typedef std::map<const Identifier, Landmark*> LandmarkPointerMap;
+typedef IdentifierMap<Landmark*> LandmarkPointerMap;
+typedef LandmarkPointerMap::Element LandmarkPointerMapElement;
 typedef std::set<const Landmark*> LandmarkPointerSet;
 
 }
@@ -0,0 +1,182 @@
+#include "landmark_index.h"
+
+namespace proslam {
+
+constexpr int32_t LandmarkIndex::_voxel_offset;
+constexpr LandmarkIndex::VoxelKey LandmarkIndex::_voxel_mask;
+
+LandmarkIndex::LandmarkIndex(const real& voxel_size_meters_): _voxel_size_meters(voxel_size_meters_) {}
+
+void LandmarkIndex::clear() {
+  _voxels.clear();
+  _entries.clear();
+  _number_of_landmarks = 0;
+}
+
+void LandmarkIndex::update(Landmark* landmark_) {
+  assert(landmark_);
+  if (!isEnabled()) {
+    return;
+  }
+  if (landmark_->identifier() >= _entries.size()) {
+    _entries.resize(landmark_->identifier()+1);
+  }
+
+  //ds skip unchanged landmarks
+  Entry& entry = _entries[landmark_->identifier()];
+  if (entry.landmark == landmark_ && entry.revision == landmark_->revision()) {
+    return;
+  }
+  int32_t voxel[3];
+  _getVoxel(landmark_->coordinates(), voxel);
+  const VoxelKey key = _getKey(voxel);
+
+  //ds the landmark stays in its voxel
+  if (entry.landmark == landmark_ && entry.key == key) {
+    entry.revision = landmark_->revision();
+    return;
+  }
+
+  //ds move the landmark into its new voxel
+  if (entry.landmark) {
+    remove(entry.landmark);
+  }
+  LandmarkPointerVector& landmarks = _voxels[key];
+  entry.landmark       = landmark_;
+  entry.key            = key;
+  entry.index_in_voxel = landmarks.size();
+  entry.revision       = landmark_->revision();
+  landmarks.push_back(landmark_);
+  ++_number_of_landmarks;
+}
+
+void LandmarkIndex::remove(const Landmark* landmark_) {
+  assert(landmark_);
+  if (landmark_->identifier() >= _entries.size()) {
+    return;
+  }
+  Entry& entry = _entries[landmark_->identifier()];
+  if (entry.landmark != landmark_) {
+    return;
+  }
+
+  //ds swap the landmark with the last one of its voxel
+  VoxelMap::iterator iterator = _voxels.find(entry.key);
+  assert(iterator != _voxels.end());
+  LandmarkPointerVector& landmarks = iterator->second;
+  assert(landmarks[entry.index_in_voxel] == landmark_);
+  Landmark* landmark_moved = landmarks.back();
+  landmarks[entry.index_in_voxel] = landmark_moved;
+  _entries[landmark_moved->identifier()].index_in_voxel = entry.index_in_voxel;
+  landmarks.pop_back();
+  if (landmarks.empty()) {
+    _voxels.erase(iterator);
+  }
+  entry = Entry();
+  --_number_of_landmarks;
+}
+
+template<typename Visitor_>
+void LandmarkIndex::_visitBox(const PointCoordinates& minimum_, const PointCoordinates& maximum_, Visitor_ visitor_) const {
+  int32_t voxel_minimum[3];
+  int32_t voxel_maximum[3];
+  _getVoxel(minimum_, voxel_minimum);
+  _getVoxel(maximum_, voxel_maximum);
+  double number_of_voxels_in_box = 1;
+  for (uint32_t u = 0; u < 3; ++u) {
+    number_of_voxels_in_box *= voxel_maximum[u]-voxel_minimum[u]+1;
+  }
+
+  //ds large boxes (e.g. far planes): scan the occupied voxels
+  if (number_of_voxels_in_box > _voxels.size()) {
+    int32_t voxel[3];
+    for (const VoxelMap::value_type& occupied_voxel: _voxels) {
+      _getVoxel(occupied_voxel.first, voxel);
+      if (voxel[0] < voxel_minimum[0] || voxel[0] > voxel_maximum[0] ||
+          voxel[1] < voxel_minimum[1] || voxel[1] > voxel_maximum[1] ||
+          voxel[2] < voxel_minimum[2] || voxel[2] > voxel_maximum[2]) {
+        continue;
+      }
+      for (Landmark* landmark: occupied_voxel.second) {
+        visitor_(landmark);
+      }
+    }
+    return;
+  }
+
+  //ds small boxes: look up each voxel of the box
+  int32_t voxel[3];
+  for (voxel[0] = voxel_minimum[0]; voxel[0] <= voxel_maximum[0]; ++voxel[0]) {
+    for (voxel[1] = voxel_minimum[1]; voxel[1] <= voxel_maximum[1]; ++voxel[1]) {
+      for (voxel[2] = voxel_minimum[2]; voxel[2] <= voxel_maximum[2]; ++voxel[2]) {
+        VoxelMap::const_iterator iterator = _voxels.find(_getKey(voxel));
+        if (iterator != _voxels.end()) {
+          for (Landmark* landmark: iterator->second) {
+            visitor_(landmark);
+          }
+        }
+      }
+    }
+  }
+}
+
+void LandmarkIndex::getLandmarksInRadius(const PointCoordinates& center_, const real& radius_meters_, LandmarkPointerVector& landmarks_) const {
+  landmarks_.clear();
+  if (!isEnabled() || _number_of_landmarks == 0) {
+    return;
+  }
+  const PointCoordinates radius(radius_meters_, radius_meters_, radius_meters_);
+  const real radius_squared = radius_meters_*radius_meters_;
+  _visitBox(center_-radius, center_+radius, [&](Landmark* landmark_) {
+    if ((landmark_->coordinates()-center_).squaredNorm() <= radius_squared) {
+      landmarks_.push_back(landmark_);
+    }
+  });
+}
+
+void LandmarkIndex::getLandmarksInFrustum(const TransformMatrix3D& world_to_camera_,
+                                          const CameraMatrix& camera_matrix_,
+                                          const int32_t& number_of_rows_image_,
+                                          const int32_t& number_of_cols_image_,
+                                          const real& maximum_depth_meters_,
+                                          LandmarkPointerVector& landmarks_) const {
+  landmarks_.clear();
+  if (!isEnabled() || _number_of_landmarks == 0) {
+    return;
+  }
+
+  //ds bounding box of the frustum in world coordinates: camera center and image corners at the far plane
+  const TransformMatrix3D camera_to_world = world_to_camera_.inverse();
+  const CameraMatrix camera_matrix_inverse = camera_matrix_.inverse();
+  PointCoordinates minimum(camera_to_world.translation());
+  PointCoordinates maximum(camera_to_world.translation());
+  for (const int32_t& row: {0, number_of_rows_image_}) {
+    for (const int32_t& col: {0, number_of_cols_image_}) {
+      const PointCoordinates corner(camera_to_world*(maximum_depth_meters_*camera_matrix_inverse*PointCoordinates(col, row, 1)));
+      minimum = minimum.cwiseMin(corner);
+      maximum = maximum.cwiseMax(corner);
+    }
+  }
+
+  //ds keep landmarks in front of the camera projecting into the image
+  _visitBox(minimum, maximum, [&](Landmark* landmark_) {
+    const PointCoordinates point_in_camera(world_to_camera_*landmark_->coordinates());
+    if (point_in_camera.z() <= 0 || point_in_camera.z() > maximum_depth_meters_) {
+      return;
+    }
+    const PointCoordinates point_in_image(camera_matrix_*point_in_camera);
+    const real u = point_in_image.x()/point_in_image.z();
+    const real v = point_in_image.y()/point_in_image.z();
+    if (u >= 0 && u < number_of_cols_image_ && v >= 0 && v < number_of_rows_image_) {
+      landmarks_.push_back(landmark_);
+    }
+  });
+}
+
+void LandmarkIndex::_getVoxel(const PointCoordinates& coordinates_, int32_t* voxel_) const {
+  for (uint32_t u = 0; u < 3; ++u) {
+    const real voxel = std::floor(coordinates_(u)/_voxel_size_meters);
+    voxel_[u] = (voxel < -_voxel_offset)? -_voxel_offset: ((voxel > _voxel_offset-1)? _voxel_offset-1: static_cast<int32_t>(voxel));
+  }
+}
+} //namespace proslam
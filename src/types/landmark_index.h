@@ -0,0 +1,122 @@
+#pragma once
+#include <unordered_map>
+#include "landmark.h"
+
+namespace proslam {
+
+//! @class spatial index over the landmark world coordinates: sparse voxel hash with a bucket of landmarks per occupied voxel
+//! landmarks are only re-binned on update if their revision changed since they have been indexed
+//! supports radius and camera frustum queries without scanning all landmarks of the map
+class LandmarkIndex {
+
+//ds object management
+public:
+
+  //! @brief constructs an empty index
+  //! @param[in] voxel_size_meters_ edge length of a voxel (0: index disabled)
+  LandmarkIndex(const real& voxel_size_meters_ = 0);
+
+//ds functionality
+public:
+
+  //! @brief removes all landmarks (the voxel size is kept)
+  void clear();
+
+  //! @brief inserts a landmark or moves it to its current voxel (no effect if the landmark did not change since its last update)
+  //! @param[in] landmark_ landmark to index
+  void update(Landmark* landmark_);
+
+  //! @brief removes a landmark from the index (no effect if the landmark is not indexed)
+  //! @param[in] landmark_ landmark to remove
+  void remove(const Landmark* landmark_);
+
+  //! @brief collects all indexed landmarks within a sphere
+  //! @param[in] center_ sphere center in world coordinates
+  //! @param[in] radius_meters_ sphere radius
+  //! @param[out] landmarks_ landmarks inside the sphere (overwritten, unordered)
+  void getLandmarksInRadius(const PointCoordinates& center_, const real& radius_meters_, LandmarkPointerVector& landmarks_) const;
+
+  //! @brief collects all indexed landmarks that project into a camera image
+  //! @param[in] world_to_camera_ camera pose
+  //! @param[in] camera_matrix_ camera intrinsics
+  //! @param[in] number_of_rows_image_ image height in pixels
+  //! @param[in] number_of_cols_image_ image width in pixels
+  //! @param[in] maximum_depth_meters_ far plane of the frustum
+  //! @param[out] landmarks_ landmarks inside the frustum (overwritten, unordered)
+  void getLandmarksInFrustum(const TransformMatrix3D& world_to_camera_,
+                             const CameraMatrix& camera_matrix_,
+                             const int32_t& number_of_rows_image_,
+                             const int32_t& number_of_cols_image_,
+                             const real& maximum_depth_meters_,
+                             LandmarkPointerVector& landmarks_) const;
+
+//ds getters/setters
+public:
+
+  //! @brief sets the voxel size and clears the index
+  void setVoxelSizeMeters(const real& voxel_size_meters_) {_voxel_size_meters = voxel_size_meters_; clear();}
+  const real& voxelSizeMeters() const {return _voxel_size_meters;}
+  const bool isEnabled() const {return _voxel_size_meters > 0;}
+  const size_t& size() const {return _number_of_landmarks;}
+  const size_t numberOfVoxels() const {return _voxels.size();}
+
+  //! @brief estimated memory footprint of the index
+  const size_t memoryUsageBytes() const {
+    return _entries.capacity()*sizeof(Entry)+_voxels.size()*(sizeof(VoxelMap::value_type)+2*sizeof(void*))+_number_of_landmarks*sizeof(Landmark*);
+  }
+
+//ds helpers
+protected:
+
+  //! @brief packed voxel coordinates (21 bits per axis)
+  typedef uint64_t VoxelKey;
+  typedef std::unordered_map<VoxelKey, LandmarkPointerVector> VoxelMap;
+
+  //! @brief indexed state of a landmark (addressed by landmark identifier)
+  struct Entry {
+    Landmark* landmark      = nullptr;
+    VoxelKey key            = 0;
+    uint32_t index_in_voxel = 0;
+    Count revision          = 0;
+  };
+
+  //! @brief voxel coordinates of a point (clamped to the representable range)
+  void _getVoxel(const PointCoordinates& coordinates_, int32_t* voxel_) const;
+
+  //! @brief key of voxel coordinates and its inverse
+  static inline const VoxelKey _getKey(const int32_t* voxel_) {
+    return (static_cast<VoxelKey>(voxel_[0]+_voxel_offset) << 42) |
+           (static_cast<VoxelKey>(voxel_[1]+_voxel_offset) << 21) |
+            static_cast<VoxelKey>(voxel_[2]+_voxel_offset);
+  }
+  static inline void _getVoxel(const VoxelKey& key_, int32_t* voxel_) {
+    voxel_[0] = static_cast<int32_t>((key_ >> 42) & _voxel_mask)-_voxel_offset;
+    voxel_[1] = static_cast<int32_t>((key_ >> 21) & _voxel_mask)-_voxel_offset;
+    voxel_[2] = static_cast<int32_t>(key_ & _voxel_mask)-_voxel_offset;
+  }
+
+  //! @brief calls visitor_ for each landmark in the voxels of an axis aligned box
+  //! the occupied voxels are scanned instead of the box if the box contains more voxels than are occupied
+  template<typename Visitor_>
+  void _visitBox(const PointCoordinates& minimum_, const PointCoordinates& maximum_, Visitor_ visitor_) const;
+
+  //! @brief voxel coordinate range: [-_voxel_offset, _voxel_offset)
+  static constexpr int32_t _voxel_offset = 1 << 20;
+  static constexpr VoxelKey _voxel_mask  = (1 << 21)-1;
+
+//ds attributes
+protected:
+
+  //! @brief voxel edge length
+  real _voxel_size_meters;
+
+  //! @brief occupied voxels with their landmarks
+  VoxelMap _voxels;
+
+  //! @brief indexed state per landmark identifier (landmark identifiers are dense)
+  std::vector<Entry> _entries;
+
+  //! @brief number of indexed landmarks
+  size_t _number_of_landmarks = 0;
+};
+} //namespace proslam
@@ -2,18 +2,16 @@
 
 namespace proslam {
 
-Count LocalMap::_instances = 0;
-
-LocalMap::LocalMap(FramePointerVector& frames_,
+LocalMap::LocalMap(const Identifier& identifier_,
+                   FramePointerVector& frames_,
                    const LocalMapParameters* parameters_,
                    LocalMap* local_map_root_,
-                   LocalMap* local_map_previous_): _identifier(_instances),
+                   LocalMap* local_map_previous_): _identifier(identifier_),
                                                    _root(local_map_root_),
                                                    _previous(local_map_previous_),
                                                    _next(nullptr),
                                                    _parameters(parameters_) {
   assert(!frames_.empty());
-  ++_instances;
 
   //ds clear structures
   clear();
@@ -33,11 +31,9 @@ LocalMap::LocalMap(FramePointerVector& frames_,
   //ds define local map position relative in the world (currently using last frame's pose)
   setLocalMapToWorld(_keyframe->robotToWorld(), false);
 
-  //ds keep track of added landmarks in order to add them only once
-  std::set<Identifier> landmarks_added;
-
   //ds preallocate bookkeeping with maximum allowed landmarks
   const Count maximum_number_of_landmarks = _parameters->maximum_number_of_landmarks;
+  _landmarks.reserve(maximum_number_of_landmarks);
 
   //ds create item context for this local map: loop over all frames
   for (Frame* frame: frames_) {
@@ -52,16 +48,18 @@ LocalMap::LocalMap(FramePointerVector& frames_,
       Landmark* landmark = frame_point->landmark();
 
       //ds if we have a landmark and it has not been added yet
-      if (landmark && landmarks_added.count(landmark->identifier()) == 0) {
+      if (landmark && _landmarks.count(landmark->identifier()) == 0) {
 
-        //ds create HBST matchables based on available landmark descriptors TODO move this operation into a method of the landmark
-        HBSTTree::MatchableVector matchables(landmark->_descriptors.size());
+        //ds create HBST matchables based on a bounded selection of the available landmark descriptors
+        const cv::Mat descriptors(landmark->selectDescriptors(_parameters->maximum_number_of_appearances_per_landmark));
+        HBSTTree::MatchableVector matchables(descriptors.rows);
         for (Count u = 0; u < matchables.size(); ++u) {
-          HBSTMatchable* matchable = new HBSTMatchable(landmark, landmark->_descriptors[u], _identifier);
+          const cv::Mat descriptor(descriptors.row(u));
+          HBSTMatchable* matchable = new HBSTMatchable(landmark, descriptor, _identifier);
           matchables[u]            = matchable;
-          landmark->_appearance_map.insert(std::make_pair(matchable, matchable));
+          landmark->_appearance_map.insert(std::make_pair(matchable, Landmark::Appearance(matchable, _identifier)));
         }
-        landmark->_descriptors.clear();
+        landmark->_descriptors.release();
         landmark->_local_maps.insert(this);
 
         //ds create a landmark snapshot and add it to the local map
@@ -70,9 +68,6 @@ LocalMap::LocalMap(FramePointerVector& frames_,
 
         //ds we're only interested in the appearances generated in this local map
         _appearances.insert(_appearances.end(), matchables.begin(), matchables.end());
-
-        //ds block further additions of this landmark
-        landmarks_added.insert(landmark->identifier());
       }
     }
   }
@@ -80,15 +75,32 @@ LocalMap::LocalMap(FramePointerVector& frames_,
   //ds check if we have to sparsify the landmarks TODO implement, check how to trim appearance vector as well
   if (_landmarks.size() > maximum_number_of_landmarks) {
     LOG_INFO(std::cerr << "LocalMap::LocalMap|" << _identifier
-                       << "|pruning landmarks from: " << landmarks_added.size() << " to: " << maximum_number_of_landmarks << std::endl)
+                       << "|pruning landmarks from: " << _landmarks.size() << " to: " << maximum_number_of_landmarks << std::endl)
 
     //ds TODO free unused landmark states
   }
 
   //ds check for low item counts
-  if (_parameters->minimum_number_of_landmarks > landmarks_added.size()) {
-    LOG_WARNING(std::cerr << "LocalMap::LocalMap|creating local map with low landmark number: " << landmarks_added.size() << std::endl)
+  if (_parameters->minimum_number_of_landmarks > _landmarks.size()) {
+    LOG_WARNING(std::cerr << "LocalMap::LocalMap|creating local map with low landmark number: " << _landmarks.size() << std::endl)
+  }
+}
+
+LocalMap::LocalMap(const Identifier& identifier_,
+                   const TransformMatrix3D& local_map_to_world_,
+                   const LocalMapParameters* parameters_,
+                   LocalMap* local_map_root_,
+                   LocalMap* local_map_previous_): _identifier(identifier_),
+                                                   _root(local_map_root_),
+                                                   _previous(local_map_previous_),
+                                                   _next(nullptr),
+                                                   _keyframe(nullptr),
+                                                   _parameters(parameters_) {
+  clear();
+  if (local_map_previous_) {
+    _previous->setNext(this);
   }
+  setLocalMapToWorld(local_map_to_world_, false);
 }
 
 LocalMap::~LocalMap() {
@@ -111,6 +123,31 @@ void LocalMap::update(const TransformMatrix3D& local_map_to_world_) {
   }
 }
 
+void LocalMap::releaseAppearances() {
+  for (LandmarkStateMapElement& landmark_state: _landmarks) {
+    Landmark* landmark = landmark_state.second.landmark;
+    for (Landmark::HBSTMatchableMemoryMap::iterator iterator = landmark->_appearance_map.begin(); iterator != landmark->_appearance_map.end();) {
+      if (iterator->second.local_map_identifier == _identifier) {
+        delete iterator->second.matchable;
+        iterator = landmark->_appearance_map.erase(iterator);
+      } else {
+        ++iterator;
+      }
+    }
+  }
+  _appearances.clear();
+}
+
+const size_t LocalMap::memoryUsageBytes() const {
+  size_t bytes = sizeof(LocalMap);
+  bytes += _frames.capacity()*sizeof(Frame*);
+  bytes += _landmarks.size()*(sizeof(LandmarkStateMapElement)+sizeof(bool));
+  for (const ClosureConstraint& closure: _closures) {
+    bytes += sizeof(ClosureConstraint)+closure.landmark_correspondences.capacity()*sizeof(Closure::Correspondence*);
+  }
+  return bytes;
+}
+
 void LocalMap::replace(Landmark* landmark_old_, Landmark* landmark_new_) {
 
   //ds remove the old landmark from the local map and check for failure
@@ -142,4 +179,21 @@ void LocalMap::setLocalMapToWorld(const TransformMatrix3D& local_map_to_world_,
     }
   }
 }
+
+void LocalMap::updateLandmarkCoordinatesInWorld() {
+  for (LandmarkStateMapElement& element: _landmarks) {
+
+    //ds skip landmarks that are present in a more recent local map (which determines their coordinates)
+    bool is_most_recent = true;
+    for (const LocalMap* local_map: element.second.landmark->localMaps()) {
+      if (local_map->identifier() > _identifier) {
+        is_most_recent = false;
+        break;
+      }
+    }
+    if (is_most_recent) {
+      element.second.updateCoordinatesInWorld(_local_map_to_world);
+    }
+  }
+}
 }
@@ -44,18 +44,31 @@ public: EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     PointCoordinates coordinates_in_local_map;
   };
 
-  typedef std::pair<const Identifier, LandmarkState> LandmarkStateMapElement;
-  typedef std::map<const Identifier, LandmarkState, std::less<Identifier>, Eigen::aligned_allocator<LandmarkStateMapElement> > LandmarkStateMap;
+  typedef IdentifierMap<LandmarkState, Eigen::aligned_allocator<std::pair<Identifier, LandmarkState>>> LandmarkStateMap;
+  typedef LandmarkStateMap::Element LandmarkStateMapElement;
 
 //ds object handling
 protected:
 
   //! @brief constructs a local map that lives in the reference frame of the consumed frames
+  //! @param[in] identifier_ identifier of the local map, unique in its WorldMap
   //! @param[in] frames_ the collection of frames to be contained in the local map (same track)
   //! @param[in] local_map_root_ the first local map in the same track
   //! @param[in] local_map_previous_ the preceding local map in the same track
   //! @param[in] minimum_number_of_landmarks_ target minimum number of landmarks to contain in local map
-  LocalMap(FramePointerVector& frames_,
+  LocalMap(const Identifier& identifier_,
+           FramePointerVector& frames_,
+           const LocalMapParameters* parameters_,
+           LocalMap* local_map_root_ = nullptr,
+           LocalMap* local_map_previous_ = nullptr);
+
+  //! @brief constructs an empty local map at the provided pose (frames, keyframe and landmarks are set by the WorldMap, e.g. when loading a map file)
+  //! @param[in] identifier_ identifier of the local map, unique in its WorldMap
+  //! @param[in] local_map_to_world_ the local map pose with respect to the world map coordinate frame
+  //! @param[in] local_map_root_ the first local map in the same track
+  //! @param[in] local_map_previous_ the preceding local map in the same track
+  LocalMap(const Identifier& identifier_,
+           const TransformMatrix3D& local_map_to_world_,
            const LocalMapParameters* parameters_,
            LocalMap* local_map_root_ = nullptr,
            LocalMap* local_map_previous_ = nullptr);
@@ -91,6 +104,15 @@ public:
   //! @param[in] landmark_new_ landmark to replace the currently present landmark_old_ in this local map
   void replace(Landmark* landmark_old_, Landmark* landmark_new_);
 
+  //! @brief frees the appearances created for this local map that have not been consumed by a place database
+  void releaseAppearances();
+
+  //! @brief estimated memory footprint of the local map including its landmark states and closures (without appearances)
+  const size_t memoryUsageBytes() const;
+
+  //! @brief estimated memory footprint of the appearances not yet consumed by a place database
+  inline const size_t appearancesMemoryUsageBytes() const {return _appearances.capacity()*sizeof(HBSTMatchable*)+_appearances.size()*sizeof(HBSTMatchable);}
+
 //ds getters/setters
 public:
 
@@ -100,7 +122,12 @@ public:
   inline const TransformMatrix3D& worldToLocalMap() const {return _world_to_local_map;}
   void setLocalMapToWorld(const TransformMatrix3D& local_map_to_world_, const bool update_landmark_world_coordinates_ = false);
 
+  //! @brief updates the world coordinates of the landmarks which have this local map as their most recent local map
+  //! @brief several local maps can be updated concurrently, since every landmark is written by exactly one local map
+  void updateLandmarkCoordinatesInWorld();
+
   inline LocalMap* root() {return _root;}
+  inline const LocalMap* root() const {return _root;}
   void setRoot(LocalMap* root_) {_root = root_;}
   inline LocalMap* previous() {return _previous;}
   void setPrevious(LocalMap* local_map_) {_previous = local_map_;}
@@ -109,15 +136,13 @@ public:
   inline Frame* keyframe() const {return _keyframe;}
   inline const FramePointerVector& frames() const {return _frames;}
   inline LandmarkStateMap& landmarks() {return _landmarks;}
+  inline const LandmarkStateMap& landmarks() const {return _landmarks;}
   inline AppearanceVector& appearances() {return _appearances;}
   inline const AppearanceVector& appearances() const {return _appearances;}
 
   //ds TODO purge this
   inline const ClosureConstraintVector& closures() const {return _closures;}
 
-  //ds reset allocated object counter
-  static void reset() {_instances = 0;}
-
 //ds attributes
 protected:
 
@@ -160,10 +185,6 @@ private:
 
   //! @brief configurable parameters
   const LocalMapParameters* _parameters;
-
-  //! @brief inner instance count - incremented upon constructor call (also unsuccessful calls)
-  static Count _instances;
-
 };
 
 typedef std::vector<LocalMap*> LocalMapPointerVector;
@@ -0,0 +1,315 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "srrg_system_utils/system_utils.h"
+
+namespace proslam {
+
+std::atomic<int32_t> Logger::_level(LoggingLevel::Debug);
+std::atomic<bool> Logger::_is_asynchronous(false);
+std::atomic<size_t> Logger::_number_of_dropped_messages(0);
+
+namespace {
+
+//ds a queued message (without description for output outside of log records)
+struct Message {
+  std::chrono::system_clock::time_point time;
+  const char* description = nullptr;
+  std::string text;
+};
+
+//ds bounded, lock-free ring buffer for multiple producers and a single consumer
+//ds every slot carries a sequence number telling whether it is free for the producer or filled for the consumer of a position
+class MessageQueue {
+public:
+
+  MessageQueue(const size_t& capacity_): _slots(_toPowerOfTwo(capacity_)),
+                                         _mask(_slots.size()-1),
+                                         _position_push(0),
+                                         _position_pop(0) {
+    for (size_t index = 0; index < _slots.size(); ++index) {
+      _slots[index].sequence.store(index, std::memory_order_relaxed);
+    }
+  }
+
+  //ds moves a message into the queue (any thread), the message is left untouched if the queue is full
+  bool push(Message& message_) {
+    size_t position = _position_push.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = _slots[position & _mask];
+      const int64_t difference = static_cast<int64_t>(slot.sequence.load(std::memory_order_acquire))-static_cast<int64_t>(position);
+      if (difference == 0) {
+
+        //ds claim the slot (position is updated on failure)
+        if (_position_push.compare_exchange_weak(position, position+1, std::memory_order_relaxed)) {
+          slot.message = std::move(message_);
+          slot.sequence.store(position+1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = _position_push.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  //ds moves the oldest message out of the queue (consumer thread only)
+  bool pop(Message& message_) {
+    const size_t position = _position_pop.load(std::memory_order_relaxed);
+    Slot& slot = _slots[position & _mask];
+    if (slot.sequence.load(std::memory_order_acquire) != position+1) {
+      return false;
+    }
+    message_ = std::move(slot.message);
+    slot.sequence.store(position+_slots.size(), std::memory_order_release);
+    _position_pop.store(position+1, std::memory_order_release);
+    return true;
+  }
+
+  //ds number of claimed and consumed positions (monotonically increasing)
+  const size_t numberOfPushedMessages() const {return _position_push.load(std::memory_order_acquire);}
+  const size_t numberOfPoppedMessages() const {return _position_pop.load(std::memory_order_acquire);}
+
+protected:
+
+  struct Slot {
+    std::atomic<size_t> sequence;
+    Message message;
+  };
+
+  static const size_t _toPowerOfTwo(const size_t& capacity_) {
+    size_t capacity = 2;
+    while (capacity < capacity_) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  std::vector<Slot> _slots;
+  const size_t _mask;
+  std::atomic<size_t> _position_push;
+  std::atomic<size_t> _position_pop;
+};
+
+//ds log record of the calling thread (nested records are merged into the outermost)
+struct ThreadRecord {
+  int32_t depth = 0;
+  Message message;
+};
+thread_local ThreadRecord thread_record;
+
+//ds asynchronous output: queue, original std::cerr buffer and output thread
+std::unique_ptr<MessageQueue> queue;
+std::streambuf* buffer_original = nullptr;
+std::thread output_thread;
+std::atomic<bool> is_output_thread_running(false);
+
+//ds serializes the output of the output thread and direct output to the original buffer
+std::mutex output_mutex;
+
+//ds blocks until all messages queued before the call are written (output_mutex must be acquired afterwards)
+void waitForQueuedMessages() {
+  const size_t number_of_pushed_messages = queue->numberOfPushedMessages();
+  while (queue->numberOfPoppedMessages() < number_of_pushed_messages) {
+    std::this_thread::yield();
+  }
+}
+
+void writeMessage(const Message& message_) {
+  if (message_.description) {
+
+    //ds format the timestamp of the record
+    const std::time_t time_seconds = std::chrono::system_clock::to_time_t(message_.time);
+    const long microseconds = std::chrono::duration_cast<std::chrono::microseconds>(message_.time.time_since_epoch()).count()%1000000;
+    std::tm calendar;
+    localtime_r(&time_seconds, &calendar);
+    char prefix[64];
+    const size_t length = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &calendar);
+    const int32_t length_prefix = length+std::snprintf(prefix+length, sizeof(prefix)-length, ".%06ld|%s|", microseconds, message_.description);
+    buffer_original->sputn(prefix, std::min(length_prefix, static_cast<int32_t>(sizeof(prefix)-1)));
+  }
+  buffer_original->sputn(message_.text.data(), message_.text.size());
+}
+
+//ds output thread: writes the queued messages and reports dropped ones
+void writeMessages() {
+  size_t number_of_reported_dropped_messages = 0;
+  Message message;
+  while (true) {
+    const bool is_running = is_output_thread_running.load(std::memory_order_acquire);
+    size_t number_of_written_messages = 0;
+    {
+      std::lock_guard<std::mutex> lock(output_mutex);
+      while (queue->pop(message)) {
+        writeMessage(message);
+        ++number_of_written_messages;
+      }
+
+      //ds report message loss once the queue has been drained
+      const size_t number_of_dropped_messages = Logger::numberOfDroppedMessages();
+      if (number_of_dropped_messages > number_of_reported_dropped_messages) {
+        message.time        = std::chrono::system_clock::now();
+        message.description = "WARNING";
+        message.text        = "Logger::writeMessages|dropped messages (queue full): "+
+                              std::to_string(number_of_dropped_messages-number_of_reported_dropped_messages)+"\n";
+        writeMessage(message);
+        number_of_reported_dropped_messages = number_of_dropped_messages;
+      }
+      if (number_of_written_messages > 0) {
+        buffer_original->pubsync();
+      }
+    }
+
+    //ds terminate only after a final pass over the queue
+    if (!is_running) {
+      break;
+    }
+    if (number_of_written_messages == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+//ds std::cerr buffer in asynchronous mode (no put area: every output reaches xsputn or overflow)
+class ReroutingBuffer: public std::streambuf {
+protected:
+
+  std::streamsize xsputn(const char* data_, std::streamsize size_) override {
+
+    //ds part of a log record: capture in the record of this thread
+    if (thread_record.depth > 0) {
+      thread_record.message.text.append(data_, size_);
+      return size_;
+    }
+
+    //ds plain output: write in order with the previously queued messages
+    waitForQueuedMessages();
+    std::lock_guard<std::mutex> lock(output_mutex);
+    return buffer_original->sputn(data_, size_);
+  }
+
+  int overflow(int character_) override {
+    if (character_ == traits_type::eof()) {
+      return traits_type::not_eof(character_);
+    }
+    const char character = traits_type::to_char_type(character_);
+    return (xsputn(&character, 1) == 1)? character_: traits_type::eof();
+  }
+
+  int sync() override {
+    if (thread_record.depth > 0) {
+      return 0;
+    }
+    std::lock_guard<std::mutex> lock(output_mutex);
+    return buffer_original->pubsync();
+  }
+};
+std::unique_ptr<ReroutingBuffer> rerouting_buffer;
+
+//ds writes pending messages at exit if the asynchronous output has not been stopped
+struct AsynchronousOutputGuard {
+  ~AsynchronousOutputGuard() {Logger::stopAsynchronous();}
+} asynchronous_output_guard;
+}
+
+Logger::Record::Record(const char* description_): _is_queued(Logger::isAsynchronous()) {
+  if (_is_queued) {
+    if (thread_record.depth++ == 0) {
+      thread_record.message.time        = std::chrono::system_clock::now();
+      thread_record.message.description = description_;
+      thread_record.message.text.clear();
+    }
+  } else {
+    std::cerr << srrg_core::getTimestamp() << "|" << description_ << "|";
+  }
+}
+
+Logger::Record::~Record() {
+  if (_is_queued && --thread_record.depth == 0) {
+    if (!queue->push(thread_record.message)) {
+      _number_of_dropped_messages.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+void Logger::startAsynchronous(const size_t& capacity_) {
+  if (isAsynchronous()) {
+    return;
+  }
+  queue.reset(new MessageQueue(capacity_));
+  rerouting_buffer.reset(new ReroutingBuffer());
+  is_output_thread_running.store(true, std::memory_order_release);
+  output_thread = std::thread(writeMessages);
+
+  //ds reroute the standard error output
+  buffer_original = std::cerr.rdbuf(rerouting_buffer.get());
+  _is_asynchronous.store(true, std::memory_order_release);
+}
+
+void Logger::stopAsynchronous() {
+  if (!isAsynchronous()) {
+    return;
+  }
+  _is_asynchronous.store(false, std::memory_order_release);
+  std::cerr.rdbuf(buffer_original);
+
+  //ds the output thread writes the remaining messages before terminating
+  is_output_thread_running.store(false, std::memory_order_release);
+  output_thread.join();
+  rerouting_buffer.reset();
+  queue.reset();
+}
+
+void Logger::print(const char* format_, ...) {
+  va_list arguments;
+  va_list arguments_copy;
+  va_start(arguments, format_);
+  va_copy(arguments_copy, arguments);
+  char buffer[512];
+  const int32_t length = std::vsnprintf(buffer, sizeof(buffer), format_, arguments);
+  if (length >= static_cast<int32_t>(sizeof(buffer))) {
+
+    //ds long message: format again into a sufficiently large buffer
+    std::string text(length+1, '\0');
+    std::vsnprintf(&text[0], text.size(), format_, arguments_copy);
+    std::cerr.write(text.data(), length);
+  } else if (length > 0) {
+    std::cerr.write(buffer, length);
+  }
+  va_end(arguments_copy);
+  va_end(arguments);
+}
+
+const LoggingLevel toLoggingLevel(const std::string& name_) {
+  if (name_ == "DEBUG") {
+    return LoggingLevel::Debug;
+  } else if (name_ == "INFO") {
+    return LoggingLevel::Info;
+  } else if (name_ == "WARNING") {
+    return LoggingLevel::Warning;
+  } else if (name_ == "ERROR") {
+    return LoggingLevel::Error;
+  } else {
+    throw std::runtime_error("invalid logging level: "+name_);
+  }
+}
+
+const std::string toString(const LoggingLevel& level_) {
+  switch (level_) {
+    case LoggingLevel::Debug:   {return "DEBUG";}
+    case LoggingLevel::Info:    {return "INFO";}
+    case LoggingLevel::Warning: {return "WARNING";}
+    default:                    {return "ERROR";}
+  }
+}
+}
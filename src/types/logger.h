@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <iostream>
+
+namespace proslam {
+
+  //ds log levels
+  enum LoggingLevel {Debug   = 0,
+                     Info    = 1,
+                     Warning = 2,
+                     Error   = 3};
+
+//! @class logging backend of the LOG_* macros: runtime level filtering and optional asynchronous output
+//! in asynchronous mode std::cerr is rerouted: output of a log record is captured per thread and pushed as one message
+//! into a lock-free ring buffer, a background thread formats the timestamps and performs the I/O (the caller never blocks)
+//! messages are dropped (and counted) if the ring buffer is full, output to std::cerr outside of log records is written
+//! synchronously after all queued messages (e.g. reports), such that the order of the output is preserved
+class Logger {
+
+//ds exported types
+public:
+
+  //! @brief scope of a single log record (created by LOG_GENERIC), all output to std::cerr in the scope belongs to the record
+  class Record {
+  public:
+
+    //! @brief opens a log record
+    //! @param[in] description_ level description printed in front of the message (static string)
+    Record(const char* description_);
+
+    //! @brief closes the log record, queuing it in asynchronous mode
+    ~Record();
+
+    //! @brief prohibit copying (a record is closed exactly once)
+    Record(const Record&) = delete;
+    Record& operator=(const Record&) = delete;
+
+  protected:
+
+    //! @brief set if the record is captured for the output thread (asynchronous mode at the time of opening)
+    const bool _is_queued;
+  };
+
+//ds functionality
+public:
+
+  //! @brief starts the asynchronous output: allocates the ring buffer, reroutes std::cerr and launches the output thread
+  //! @param[in] capacity_ maximum number of queued messages (rounded up to a power of 2)
+  static void startAsynchronous(const size_t& capacity_ = 8192);
+
+  //! @brief writes all queued messages, stops the output thread and restores std::cerr (no effect if not started)
+  static void stopAsynchronous();
+
+  //! @brief printf-style output to std::cerr (used in log records instead of std::printf, which bypasses std::cerr)
+  static void print(const char* format_, ...) __attribute__((format(printf, 1, 2)));
+
+//ds getters/setters
+public:
+
+  //! @brief minimum level of the records to output (the LOG_* macros disabled at compile time by SRRG_PROSLAM_LOG_LEVEL remain disabled)
+  static inline void setLevel(const LoggingLevel& level_) {_level.store(level_, std::memory_order_relaxed);}
+  static inline const LoggingLevel level() {return static_cast<LoggingLevel>(_level.load(std::memory_order_relaxed));}
+  static inline const bool isEnabled(const LoggingLevel& level_) {return level_ >= _level.load(std::memory_order_relaxed);}
+
+  static inline const bool isAsynchronous() {return _is_asynchronous.load(std::memory_order_acquire);}
+
+  //! @brief number of messages dropped because the ring buffer was full
+  static inline const size_t numberOfDroppedMessages() {return _number_of_dropped_messages.load(std::memory_order_relaxed);}
+
+//ds attributes
+protected:
+
+  static std::atomic<int32_t> _level;
+  static std::atomic<bool> _is_asynchronous;
+  static std::atomic<size_t> _number_of_dropped_messages;
+};
+
+//! @brief parses a logging level from its name (DEBUG, INFO, WARNING or ERROR)
+//! @throws std::runtime_error for an invalid name
+const LoggingLevel toLoggingLevel(const std::string& name_);
+
+//! @brief name of a logging level (inverse of toLoggingLevel)
+const std::string toString(const LoggingLevel& level_);
+
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <limits>
+#include <ostream>
+#include <unordered_map>
+#include "definitions.h"
+
+namespace proslam {
+
+//! @brief binary map file layout (version 1), written and read by the WorldMap
+//! the file consists of a header followed by flat arrays of fixed size records (sections), which are referenced by offsets in the header
+//! all records are 8 byte aligned plain data, such that a memory-mapped file can be accessed in place without parsing
+//! objects reference each other by their index in the respective section, geometry is always stored in double precision (native byte order)
+namespace map_file {
+
+//! @brief file signature and format version (increment on any layout change)
+static constexpr char magic[8]     = {'P', 'R', 'O', 'S', 'L', 'A', 'M', 'M'};
+static constexpr uint32_t version  = 1;
+
+//! @brief index value for absent references (e.g. the previous frame of a root frame)
+static constexpr uint64_t invalid_index = std::numeric_limits<uint64_t>::max();
+
+//! @brief stored descriptor bytes per appearance (padded to keep the records aligned)
+static constexpr uint64_t descriptor_size_bytes = (SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS/8+7)/8*8;
+
+//! @brief file header, located at the beginning of the file
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t descriptor_size_bits;
+  uint64_t file_size_bytes;
+
+  //ds number of records per section
+  uint64_t number_of_frames;
+  uint64_t number_of_landmarks;
+  uint64_t number_of_local_maps;
+  uint64_t number_of_local_map_frames;
+  uint64_t number_of_landmark_states;
+  uint64_t number_of_appearances;
+  uint64_t number_of_closures;
+
+  //ds section offsets in bytes from the beginning of the file
+  uint64_t offset_frames;
+  uint64_t offset_landmarks;
+  uint64_t offset_local_maps;
+  uint64_t offset_local_map_frames;
+  uint64_t offset_landmark_states;
+  uint64_t offset_appearances;
+  uint64_t offset_closures;
+};
+
+//! @brief frame (pose only, framepoints are not stored)
+struct FrameRecord {
+  uint64_t index_previous;
+  uint64_t index_root;
+  uint64_t index_local_map;
+  double timestamp_image_left_seconds;
+  double robot_to_world[12];
+  double frame_to_local_map[12];
+  uint32_t status;
+  uint8_t is_keyframe;
+  uint8_t is_track_broken;
+  uint8_t padding[2];
+};
+
+//! @brief landmark position estimate
+struct LandmarkRecord {
+  double world_coordinates[3];
+  uint64_t number_of_updates;
+  uint64_t number_of_recoveries;
+};
+
+//! @brief local map with ranges into the local map frame, landmark state, appearance and closure sections
+struct LocalMapRecord {
+  double local_map_to_world[12];
+  uint64_t index_root;
+  uint64_t index_previous;
+  uint64_t index_keyframe;
+  uint64_t begin_frames;
+  uint64_t number_of_frames;
+  uint64_t begin_landmark_states;
+  uint64_t number_of_landmark_states;
+  uint64_t begin_appearances;
+  uint64_t number_of_appearances;
+  uint64_t begin_closures;
+  uint64_t number_of_closures;
+};
+
+//! @brief landmark snapshot in a local map
+struct LandmarkStateRecord {
+  uint64_t index_landmark;
+  double coordinates_in_local_map[3];
+};
+
+//! @brief landmark appearance captured in a local map (bit i of the descriptor is stored in bit i%8 of byte i/8)
+struct AppearanceRecord {
+  uint64_t index_landmark;
+  uint8_t descriptor[descriptor_size_bytes];
+};
+
+//! @brief loop closure constraint of a local map (landmark correspondences are not stored)
+struct ClosureRecord {
+  uint64_t index_reference;
+  double relation[12];
+  double omega;
+};
+
+static_assert(sizeof(Header)%8 == 0, "map_file::Header is not 8 byte aligned");
+static_assert(sizeof(FrameRecord)%8 == 0, "map_file::FrameRecord is not 8 byte aligned");
+static_assert(sizeof(LandmarkRecord)%8 == 0, "map_file::LandmarkRecord is not 8 byte aligned");
+static_assert(sizeof(LocalMapRecord)%8 == 0, "map_file::LocalMapRecord is not 8 byte aligned");
+static_assert(sizeof(LandmarkStateRecord)%8 == 0, "map_file::LandmarkStateRecord is not 8 byte aligned");
+static_assert(sizeof(AppearanceRecord)%8 == 0, "map_file::AppearanceRecord is not 8 byte aligned");
+static_assert(sizeof(ClosureRecord)%8 == 0, "map_file::ClosureRecord is not 8 byte aligned");
+
+//! @brief stores an isometry as row-major 3x4 matrix
+inline void setTransform(const TransformMatrix3D& transform_, double* values_) {
+  for (uint32_t row = 0; row < 3; ++row) {
+    for (uint32_t col = 0; col < 4; ++col) {
+      values_[4*row+col] = transform_.matrix()(row, col);
+    }
+  }
+}
+
+//! @brief restores an isometry from a row-major 3x4 matrix
+inline const TransformMatrix3D getTransform(const double* values_) {
+  TransformMatrix3D transform(TransformMatrix3D::Identity());
+  for (uint32_t row = 0; row < 3; ++row) {
+    for (uint32_t col = 0; col < 4; ++col) {
+      transform.matrix()(row, col) = values_[4*row+col];
+    }
+  }
+  return transform;
+}
+
+//! @brief section index of an object
+//! @return index or invalid_index if the object is not stored (e.g. nullptr)
+template<typename ObjectType_>
+inline const uint64_t getIndex(const std::unordered_map<const ObjectType_*, uint64_t>& indices_, const ObjectType_* object_) {
+  const typename std::unordered_map<const ObjectType_*, uint64_t>::const_iterator iterator = indices_.find(object_);
+  return (iterator != indices_.end())? iterator->second: invalid_index;
+}
+
+//! @brief writes a section of records
+template<typename RecordType_>
+inline void writeSection(std::ostream& stream_, const std::vector<RecordType_>& records_) {
+  if (!records_.empty()) {
+    stream_.write(reinterpret_cast<const char*>(records_.data()), records_.size()*sizeof(RecordType_));
+  }
+}
+} //namespace map_file
+} //namespace proslam
@@ -0,0 +1,192 @@
+#pragma once
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace proslam {
+
+//! @class read-only memory mapping of a complete file (e.g. trajectories), processed pages can be released while streaming through it
+//! the mapping is only as long valid as the object exists - parsing below operates directly on the mapped characters
+class MappedFile {
+
+//ds object handling
+public:
+
+  //! @brief maps the complete file, check isOpen for success
+  //! @param[in] file_name_ file to map
+  MappedFile(const std::string& file_name_) {
+    _file_descriptor = open(file_name_.c_str(), O_RDONLY);
+    if (_file_descriptor < 0) {
+      return;
+    }
+    struct stat file_status;
+    if (fstat(_file_descriptor, &file_status) != 0) {
+      return;
+    }
+    _size_bytes = file_status.st_size;
+    if (_size_bytes > 0) {
+      void* data = mmap(nullptr, _size_bytes, PROT_READ, MAP_PRIVATE, _file_descriptor, 0);
+      if (data == MAP_FAILED) {
+        _size_bytes = 0;
+        return;
+      }
+      madvise(data, _size_bytes, MADV_SEQUENTIAL);
+      _data = static_cast<const char*>(data);
+    }
+    _is_open = true;
+  }
+  ~MappedFile() {
+    if (_data) {
+      munmap(const_cast<char*>(_data), _size_bytes);
+    }
+    if (_file_descriptor >= 0) {
+      close(_file_descriptor);
+    }
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+//ds functionality
+public:
+
+  //! @brief drops the pages before the cursor from memory (they must not be accessed anymore)
+  //! @param[in] cursor_ current parsing position in the mapping
+  void release(const char* cursor_) {
+    const size_t page_size_bytes = sysconf(_SC_PAGESIZE);
+    const size_t size_bytes      = (cursor_-_data)/page_size_bytes*page_size_bytes;
+    if (size_bytes > _size_bytes_released) {
+      madvise(const_cast<char*>(_data)+_size_bytes_released, size_bytes-_size_bytes_released, MADV_DONTNEED);
+      _size_bytes_released = size_bytes;
+    }
+  }
+
+//ds getters/setters
+public:
+
+  const bool isOpen() const {return _is_open;}
+  const char* begin() const {return _data;}
+  const char* end() const {return _data+_size_bytes;}
+
+//ds attributes
+protected:
+
+  int32_t _file_descriptor     = -1;
+  const char* _data            = nullptr;
+  size_t _size_bytes           = 0;
+  size_t _size_bytes_released  = 0;
+  bool _is_open                = false;
+};
+
+//! @brief advances the cursor over spaces and tabs
+inline void skipSpaces(const char*& cursor_, const char* end_) {
+  while (cursor_ < end_ && (*cursor_ == ' ' || *cursor_ == '\t')) {
+    ++cursor_;
+  }
+}
+
+//! @brief parses a floating point number (optional sign, fraction and exponent) without copying or locale handling
+//! @param[in,out] cursor_ parsing position, advanced behind the number on success
+//! @param[in] end_ end of the parsable range
+//! @param[out] value_ parsed value
+//! @return true if a number has been parsed
+inline const bool parseNumber(const char*& cursor_, const char* end_, double& value_) {
+
+  //ds exactly representable powers of ten
+  static const double powers_of_ten[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char* cursor = cursor_;
+  const bool is_negative = (cursor < end_ && *cursor == '-');
+  if (cursor < end_ && (*cursor == '-' || *cursor == '+')) {
+    ++cursor;
+  }
+
+  //ds accumulate up to 19 significant digits in an integer mantissa
+  uint64_t mantissa = 0;
+  int32_t exponent  = 0;
+  uint32_t number_of_significant_digits = 0;
+  bool has_digits  = false;
+  bool is_fraction = false;
+  while (cursor < end_) {
+    if (*cursor >= '0' && *cursor <= '9') {
+      has_digits = true;
+      if (number_of_significant_digits < 19) {
+        mantissa = 10*mantissa+(*cursor-'0');
+        if (mantissa > 0) {
+          ++number_of_significant_digits;
+        }
+        if (is_fraction) {
+          --exponent;
+        }
+      } else if (!is_fraction) {
+        ++exponent;
+      }
+    } else if (*cursor == '.' && !is_fraction) {
+      is_fraction = true;
+    } else {
+      break;
+    }
+    ++cursor;
+  }
+  if (!has_digits) {
+    return false;
+  }
+
+  //ds optional exponent
+  if (cursor < end_ && (*cursor == 'e' || *cursor == 'E')) {
+    const char* cursor_exponent = cursor+1;
+    const bool is_exponent_negative = (cursor_exponent < end_ && *cursor_exponent == '-');
+    if (cursor_exponent < end_ && (*cursor_exponent == '-' || *cursor_exponent == '+')) {
+      ++cursor_exponent;
+    }
+    int32_t exponent_explicit = 0;
+    bool has_exponent_digits  = false;
+    while (cursor_exponent < end_ && *cursor_exponent >= '0' && *cursor_exponent <= '9') {
+      exponent_explicit   = std::min(10*exponent_explicit+(*cursor_exponent-'0'), 100000);
+      has_exponent_digits = true;
+      ++cursor_exponent;
+    }
+    if (has_exponent_digits) {
+      exponent += (is_exponent_negative)? -exponent_explicit: exponent_explicit;
+      cursor    = cursor_exponent;
+    }
+  }
+
+  //ds scale with a single rounding step (correctly rounded for up to 15 significant digits)
+  if (exponent >= -22 && exponent <= 22) {
+    value_ = (exponent < 0)? mantissa/powers_of_ten[-exponent]: mantissa*powers_of_ten[exponent];
+    if (is_negative) {
+      value_ = -value_;
+    }
+  } else {
+
+    //ds rare, extreme exponents: fall back to the standard conversion of the token (sign included)
+    value_ = std::strtod(std::string(cursor_, cursor).c_str(), nullptr);
+  }
+  cursor_ = cursor;
+  return true;
+}
+
+//! @brief parses an unsigned decimal integer
+//! @param[in,out] cursor_ parsing position, advanced behind the number on success
+//! @param[in] end_ end of the parsable range
+//! @param[out] value_ parsed value
+//! @return true if at least one digit has been parsed
+inline const bool parseInteger(const char*& cursor_, const char* end_, uint64_t& value_) {
+  const char* cursor = cursor_;
+  value_ = 0;
+  while (cursor < end_ && *cursor >= '0' && *cursor <= '9') {
+    value_ = 10*value_+(*cursor-'0');
+    ++cursor;
+  }
+  if (cursor == cursor_) {
+    return false;
+  }
+  cursor_ = cursor;
+  return true;
+}
+} //namespace proslam
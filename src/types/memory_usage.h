@@ -0,0 +1,41 @@
+#pragma once
+#include "definitions.h"
+
+namespace proslam {
+
+//! @struct estimated memory footprint of the SLAM system, broken down by subsystem (all values in bytes)
+//! the estimates cover the data owned by the respective containers (element sizes times capacities),
+//! allocator overhead and memory of third party libraries (e.g. g2o caches) are approximated or not included
+struct MemoryUsage {
+
+  //! @brief total estimated memory footprint
+  inline const size_t total() const {
+    return frames+images+framepoints+landmarks+local_maps+appearances+place_databases+pose_graph;
+  }
+
+  //! @brief frame structures including keypoints, descriptors and point bookkeeping (WorldMap)
+  size_t frames = 0;
+
+  //! @brief intensity images retained by frames (WorldMap)
+  size_t images = 0;
+
+  //! @brief framepoint arenas including their descriptors and visualization data (WorldMap)
+  size_t framepoints = 0;
+
+  //! @brief landmark structures including measurements and pending descriptors (WorldMap)
+  size_t landmarks = 0;
+
+  //! @brief local map structures including their landmark states and closures (LocalMap)
+  size_t local_maps = 0;
+
+  //! @brief appearance bookkeeping of landmarks and appearances of local maps not yet added to a place database (LocalMap)
+  size_t appearances = 0;
+
+  //! @brief appearances stored in the place databases (Relocalizer)
+  size_t place_databases = 0;
+
+  //! @brief vertices and edges of the pose graphs (GraphOptimizer)
+  size_t pose_graph = 0;
+};
+
+}
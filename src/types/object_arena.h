@@ -0,0 +1,80 @@
+#pragma once
+#include <utility>
+#include "definitions.h"
+
+namespace proslam {
+
+//! @class block-wise object storage with stable addresses and bulk release
+//! objects are constructed contiguously in fixed size blocks (no relocation, pointers stay valid until clear)
+//! released blocks are kept and reused, such that a steady state of create/clear cycles performs no heap allocations
+template<typename ObjectType_, size_t number_of_objects_per_block_ = 256>
+class ObjectArena {
+
+//ds object handling
+public:
+
+  ObjectArena() {}
+
+  //! @brief destroys all objects and frees all blocks
+  ~ObjectArena() {
+    release();
+  }
+
+  //! @brief prohibit copying (objects are referenced by address)
+  ObjectArena(const ObjectArena&) = delete;
+  ObjectArena& operator=(const ObjectArena&) = delete;
+
+//ds functionality
+public:
+
+  //! @brief constructs a new object in the next free slot
+  //! @param[in] arguments_ constructor arguments of the object
+  //! @return pointer to the object (valid until clear is called)
+  template<typename... Arguments_>
+  ObjectType_* create(Arguments_&&... arguments_) {
+    const size_t index_block = _number_of_objects/number_of_objects_per_block_;
+    if (index_block == _blocks.size()) {
+      _blocks.push_back(_allocator.allocate(number_of_objects_per_block_));
+    }
+    ObjectType_* object = _blocks[index_block]+_number_of_objects%number_of_objects_per_block_;
+    ::new (static_cast<void*>(object)) ObjectType_(std::forward<Arguments_>(arguments_)...);
+    ++_number_of_objects;
+    return object;
+  }
+
+  //! @brief destroys all objects in reverse order of creation (the memory blocks are kept for reuse)
+  void clear() {
+    while (_number_of_objects > 0) {
+      --_number_of_objects;
+      (_blocks[_number_of_objects/number_of_objects_per_block_]+_number_of_objects%number_of_objects_per_block_)->~ObjectType_();
+    }
+  }
+
+  //! @brief destroys all objects and frees all memory blocks
+  void release() {
+    clear();
+    for (ObjectType_* block: _blocks) {
+      _allocator.deallocate(block, number_of_objects_per_block_);
+    }
+    std::vector<ObjectType_*>().swap(_blocks);
+  }
+
+//ds getters/setters
+public:
+
+  inline const size_t& size() const {return _number_of_objects;}
+  inline const size_t capacity() const {return _blocks.size()*number_of_objects_per_block_;}
+
+//ds attributes
+protected:
+
+  //! @brief object memory blocks of number_of_objects_per_block_ each (aligned through Eigen's allocator)
+  std::vector<ObjectType_*> _blocks;
+
+  //! @brief number of constructed objects (objects occupy the first slots in block order)
+  size_t _number_of_objects = 0;
+
+  //! @brief block allocator
+  Eigen::aligned_allocator<ObjectType_> _allocator;
+};
+} //namespace proslam
@@ -1,5 +1,6 @@
 #include "parameters.h"
 #include "yaml-cpp/yaml.h"
+#include "trajectory_writer.h"
 
 namespace proslam {
 
@@ -25,6 +26,23 @@ std::string ParameterCollection::banner =
 "-equalize-histogram (-eh):               equalize stereo image histogram before processing\n"
 "-recover-landmarks (-rl):                enables landmark track recovery\n"
 "-disable-bundle-adjustment (-dba):       disables periodic bundle adjustment for landmarks and frames\n"
+"-load-map (-lm)                <string>: loads a binary map file before processing\n"
+"-save-map (-sm)                <string>: saves the map to a binary map file after processing\n"
+"-merge-map (-mm)               <string>: merges a binary map file into the map loaded with -load-map (repeatable)\n"
+"-localization-only (-lo):                tracks against the map loaded with -load-map without modifying it\n"
+"-pipelined-processing (-pp):             extracts the features of the next frames while tracking the current one (stereo only)\n"
+"-prefetch (-pf)                <count>:  decodes and preprocesses up to <count> frames ahead in a reader thread\n"
+"-latency-budget (-lb)          <real>:   real-time mode: drops stale frames and sheds load to stay within <real> seconds per frame\n"
+"-target-frame-rate (-tfr)      <real>:   scales the number of keypoints with the measured stage timings to process at <real> Hz\n"
+"-stage-trace (-str)            <string>: writes the per-frame processing time of every stage to a CSV file after processing\n"
+"-trajectory-stream (-ts)       <string>: appends the poses to a file while processing, rewriting the poses moved by optimization\n"
+"-trajectory-stream-format (-tsf) <string>: format of the streamed trajectory (select one: KITTI, TUM, BINARY)\n"
+"-log-level (-ll)              <string>: minimum level of the printed log messages (select one: DEBUG, INFO, WARNING, ERROR)\n"
+"-asynchronous-logging (-al):             formats and prints log messages in a background thread (the caller never blocks on output)\n"
+"-processing-thread (-pt):                ROS node: callbacks only queue the latest image pair, which is processed in a worker thread\n"
+"-publishing-rate (-pr)         <real>:   ROS node: rate (Hz) at which the current pose and the trajectory are published (0: disabled)\n"
+"-image-viewer-rate (-ivr)      <real>:   maximum rate (Hz) at which the image viewer displays frames (0: every processed frame)\n"
+"-image-viewer-scale (-ivs)     <real>:   display scale of the image viewer in (0, 1] (renders images and overlays at reduced resolution)\n"
 DOUBLE_BAR;
 
 //! @brief macro wrapping the YAML node parsing for a single parameter
@@ -66,6 +84,33 @@ void CommandLineParameters::print() const {
   std::cerr << "-equalize-histogram (-eh)          " << option_equalize_histogram << std::endl;
   std::cerr << "-recover-landmarks (-rl)           " << option_recover_landmarks << std::endl;
   std::cerr << "-disable-bundle-adjustment (-dba)  " << option_disable_bundle_adjustment << std::endl;
+  std::cerr << "-localization-only (-lo)           " << option_localization_only << std::endl;
+  std::cerr << "-pipelined-processing (-pp)        " << option_enable_pipelining << std::endl;
+  std::cerr << "-prefetch (-pf)                    " << number_of_prefetched_frames << std::endl;
+  std::cerr << "-latency-budget (-lb)              " << latency_budget_seconds << std::endl;
+  std::cerr << "-target-frame-rate (-tfr)          " << target_frame_rate_hz << std::endl;
+  std::cerr << "-log-level (-ll)                   " << toString(logging_level) << std::endl;
+  std::cerr << "-asynchronous-logging (-al)        " << option_enable_asynchronous_logging << std::endl;
+  std::cerr << "-processing-thread (-pt)           " << option_enable_processing_thread << std::endl;
+  std::cerr << "-publishing-rate (-pr)             " << publishing_rate_hz << std::endl;
+  std::cerr << "-image-viewer-rate (-ivr)          " << image_viewer_refresh_rate_hz << std::endl;
+  std::cerr << "-image-viewer-scale (-ivs)         " << image_viewer_scale << std::endl;
+  if (map_file_name_load.length() > 0) {
+  std::cerr << "-load-map (-lm)                   '" << map_file_name_load << "'" << std::endl;
+  }
+  if (map_file_name_save.length() > 0) {
+  std::cerr << "-save-map (-sm)                   '" << map_file_name_save << "'" << std::endl;
+  }
+  for (const std::string& map_file_name_merge: map_file_names_merge) {
+  std::cerr << "-merge-map (-mm)                  '" << map_file_name_merge << "'" << std::endl;
+  }
+  if (stage_trace_file_name.length() > 0) {
+  std::cerr << "-stage-trace (-str)               '" << stage_trace_file_name << "'" << std::endl;
+  }
+  if (trajectory_stream_file_name.length() > 0) {
+  std::cerr << "-trajectory-stream (-ts)          '" << trajectory_stream_file_name << "'" << std::endl;
+  std::cerr << "-trajectory-stream-format (-tsf)   " << trajectory_stream_format << std::endl;
+  }
   if (dataset_file_name.length() > 0) {
   std::cerr << "-dataset                          '" << dataset_file_name  << "'" << std::endl;
   }
@@ -76,20 +121,32 @@ void AlignerParameters::print() const {
   std::cerr << "AlignerParameters::print|maximum_error_kernel: " << maximum_error_kernel << std::endl;
   std::cerr << "AlignerParameters::print|minimum_number_of_inliers: " << minimum_number_of_inliers << std::endl;
   std::cerr << "AlignerParameters::print|minimum_inlier_ratio: " << minimum_inlier_ratio << std::endl;
+  std::cerr << "AlignerParameters::print|number_of_linearization_threads: " << number_of_linearization_threads << std::endl;
+  std::cerr << "AlignerParameters::print|minimum_number_of_measurements_per_thread: " << minimum_number_of_measurements_per_thread << std::endl;
+  std::cerr << "AlignerParameters::print|enable_coarse_to_fine_estimation: " << enable_coarse_to_fine_estimation << std::endl;
+  std::cerr << "AlignerParameters::print|coarse_number_of_measurements: " << coarse_number_of_measurements << std::endl;
+  std::cerr << "AlignerParameters::print|coarse_number_of_hypotheses: " << coarse_number_of_hypotheses << std::endl;
+  std::cerr << "AlignerParameters::print|coarse_outlier_rejection_factor: " << coarse_outlier_rejection_factor << std::endl;
 }
 
 void LandmarkParameters::print() const {
   std::cerr << "LandmarkParameters::print|minimum_number_of_forced_updates: " << minimum_number_of_forced_updates << std::endl;
+  std::cerr << "LandmarkParameters::print|enable_incremental_estimation: " << enable_incremental_estimation << std::endl;
+  std::cerr << "LandmarkParameters::print|maximum_number_of_measurements: " << maximum_number_of_measurements << std::endl;
 }
 
 void LocalMapParameters::print() const {
   std::cerr << "LocalMapParameters::print|minimum_number_of_landmarks: " << minimum_number_of_landmarks << std::endl;
+  std::cerr << "LocalMapParameters::print|maximum_number_of_appearances_per_landmark: " << maximum_number_of_appearances_per_landmark << std::endl;
 }
 
 void WorldMapParameters::print() const {
   std::cerr << "WorldMapParameters::print|minimum_distance_traveled_for_local_map: " << minimum_distance_traveled_for_local_map << std::endl;
   std::cerr << "WorldMapParameters::print|minimum_degrees_rotated_for_local_map: " << minimum_degrees_rotated_for_local_map << std::endl;
   std::cerr << "WorldMapParameters::print|minimum_number_of_frames_for_local_map: " << minimum_number_of_frames_for_local_map << std::endl;
+  std::cerr << "WorldMapParameters::print|number_of_frames_with_full_data: " << number_of_frames_with_full_data << std::endl;
+  std::cerr << "WorldMapParameters::print|maximum_frame_memory_megabytes: " << maximum_frame_memory_megabytes << std::endl;
+  std::cerr << "WorldMapParameters::print|landmark_index_voxel_size_meters: " << landmark_index_voxel_size_meters << std::endl;
   landmark->print();
   local_map->print();
 }
@@ -98,6 +155,14 @@ void BaseFramePointGeneratorParameters::print() const {
   std::cerr << "BaseFramepointGeneratorParameters::print|target_number_of_keypoints_tolerance: " << target_number_of_keypoints_tolerance << std::endl;
   std::cerr << "BaseFramepointGeneratorParameters::print|detector_threshold_minimum: " << detector_threshold_minimum << std::endl;
   std::cerr << "BaseFramepointGeneratorParameters::print|detector_threshold_maximum_change: " << detector_threshold_maximum_change << std::endl;
+  std::cerr << "BaseFramepointGeneratorParameters::print|minimum_keypoint_target_scale: " << minimum_keypoint_target_scale << std::endl;
+  std::cerr << "BaseFramepointGeneratorParameters::print|number_of_detection_threads: " << number_of_detection_threads << std::endl;
+  std::cerr << "BaseFramepointGeneratorParameters::print|keypoint_detection_backend: " << keypoint_detection_backend << std::endl;
+  std::cerr << "BaseFramepointGeneratorParameters::print|detection_pyramid_level: " << detection_pyramid_level << std::endl;
+  std::cerr << "BaseFramepointGeneratorParameters::print|enable_lazy_detection: " << enable_lazy_detection << std::endl;
+  std::cerr << "BaseFramepointGeneratorParameters::print|lazy_detection_saturation_ratio: " << lazy_detection_saturation_ratio << std::endl;
+  std::cerr << "BaseFramepointGeneratorParameters::print|enable_adaptive_tracking_windows: " << enable_adaptive_tracking_windows << std::endl;
+  std::cerr << "BaseFramepointGeneratorParameters::print|adaptive_tracking_window_sigma_factor: " << adaptive_tracking_window_sigma_factor << std::endl;
   std::cerr << "BaseFramepointGeneratorParameters::print|matching_distance_tracking_threshold: " << matching_distance_tracking_threshold << std::endl;
   std::cerr << "BaseFramepointGeneratorParameters::print|enable_keypoint_binning: " << enable_keypoint_binning << std::endl;
   std::cerr << "BaseFramepointGeneratorParameters::print|bin_size_pixels: " << bin_size_pixels << std::endl;
@@ -106,10 +171,13 @@ void BaseFramePointGeneratorParameters::print() const {
 void StereoFramePointGeneratorParameters::print() const {
   std::cerr << "StereoFramepointGeneratorParameters::print|maximum_matching_distance_triangulation: " << maximum_matching_distance_triangulation << std::endl;
   std::cerr << "StereoFramepointGeneratorParameters::print|minimum_disparity_pixels: " << minimum_disparity_pixels << std::endl;
+  std::cerr << "StereoFramepointGeneratorParameters::print|enable_concurrent_stream_processing: " << enable_concurrent_stream_processing << std::endl;
   BaseFramePointGeneratorParameters::print();
 }
 
 void DepthFramePointGeneratorParameters::print() const {
+  std::cerr << "DepthFramePointGeneratorParameters::print|enable_registered_depth: " << enable_registered_depth << std::endl;
+  std::cerr << "DepthFramePointGeneratorParameters::print|number_of_registration_threads: " << number_of_registration_threads << std::endl;
   BaseFramePointGeneratorParameters::print();
 }
 
@@ -125,6 +193,12 @@ BaseTrackerParameters::BaseTrackerParameters(const LoggingLevel& logging_level_)
 void BaseTrackerParameters::print() const {
   std::cerr << "BaseTrackerParameters::print|minimum_number_of_landmarks_to_track: " << minimum_number_of_landmarks_to_track << std::endl;
   std::cerr << "BaseTrackerParameters::print|maximum_number_of_landmark_recoveries: " << maximum_number_of_landmark_recoveries << std::endl;
+  std::cerr << "BaseTrackerParameters::print|maximum_number_of_frames_for_map_recovery: " << maximum_number_of_frames_for_map_recovery << std::endl;
+  std::cerr << "BaseTrackerParameters::print|number_of_landmark_update_threads: " << number_of_landmark_update_threads << std::endl;
+  std::cerr << "BaseTrackerParameters::print|enable_deferred_landmark_updates: " << enable_deferred_landmark_updates << std::endl;
+  std::cerr << "BaseTrackerParameters::print|minimum_number_of_updates_for_deferral: " << minimum_number_of_updates_for_deferral << std::endl;
+  std::cerr << "BaseTrackerParameters::print|motion_guess_standard_deviation_translation_meters: " << motion_guess_standard_deviation_translation_meters << std::endl;
+  std::cerr << "BaseTrackerParameters::print|motion_guess_standard_deviation_rotation_radians: " << motion_guess_standard_deviation_rotation_radians << std::endl;
   aligner->print();
 }
 
@@ -141,14 +215,26 @@ void RelocalizerParameters::print() const {
   std::cerr << "RelocalizerParameters::print|preliminary_minimum_matching_ratio: " << preliminary_minimum_matching_ratio << std::endl;
   std::cerr << "RelocalizerParameters::print|minimum_number_of_matches_per_landmark: " << minimum_number_of_matched_landmarks << std::endl;
   std::cerr << "RelocalizerParameters::print|minimum_matches_per_correspondence: " << minimum_matches_per_correspondence << std::endl;
+  std::cerr << "RelocalizerParameters::print|enable_asynchronous_relocalization: " << enable_asynchronous_relocalization << std::endl;
+  std::cerr << "RelocalizerParameters::print|number_of_registration_threads: " << number_of_registration_threads << std::endl;
+  std::cerr << "RelocalizerParameters::print|stop_at_first_valid_closure: " << stop_at_first_valid_closure << std::endl;
+  std::cerr << "RelocalizerParameters::print|enable_place_pruning: " << enable_place_pruning << std::endl;
+  std::cerr << "RelocalizerParameters::print|maximum_number_of_places: " << maximum_number_of_places << std::endl;
+  std::cerr << "RelocalizerParameters::print|number_of_query_threads: " << number_of_query_threads << std::endl;
   aligner->print();
 }
 
 void GraphOptimizerParameters::print() const {
   std::cerr << "GraphOptimizerParameters::print|identifier_space: " << identifier_space << std::endl;
   std::cerr << "GraphOptimizerParameters::print|number_of_frames_per_bundle_adjustment: " << number_of_frames_per_bundle_adjustment << std::endl;
+  std::cerr << "GraphOptimizerParameters::print|number_of_local_maps_for_bundle_adjustment: " << number_of_local_maps_for_bundle_adjustment << std::endl;
   std::cerr << "GraphOptimizerParameters::print|base_information_frame: " << base_information_frame << std::endl;
   std::cerr << "GraphOptimizerParameters::print|enable_robust_kernel_for_landmark_measurements: " << enable_robust_kernel_for_landmarks << std::endl;
+  std::cerr << "GraphOptimizerParameters::print|enable_keyframe_pose_graph: " << enable_keyframe_pose_graph << std::endl;
+  std::cerr << "GraphOptimizerParameters::print|enable_asynchronous_optimization: " << enable_asynchronous_optimization << std::endl;
+  std::cerr << "GraphOptimizerParameters::print|number_of_local_map_update_threads: " << number_of_local_map_update_threads << std::endl;
+  std::cerr << "GraphOptimizerParameters::print|minimum_local_map_correction_translation_meters: " << minimum_local_map_correction_translation_meters << std::endl;
+  std::cerr << "GraphOptimizerParameters::print|minimum_local_map_correction_rotation_radians: " << minimum_local_map_correction_rotation_radians << std::endl;
 }
 
 void ImageViewerParameters::print() const {
@@ -248,6 +334,30 @@ void ParameterCollection::parseFromCommandLine(const int32_t& argc_, char ** arg
       number_of_checked_parameters++;
       if (number_of_checked_parameters == argc_) {break;}
       command_line_parameters->topic_camera_info_right = argv_[number_of_checked_parameters];
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-load-map") || !std::strcmp(argv_[number_of_checked_parameters], "-lm")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->map_file_name_load = argv_[number_of_checked_parameters];
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-save-map") || !std::strcmp(argv_[number_of_checked_parameters], "-sm")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->map_file_name_save = argv_[number_of_checked_parameters];
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-merge-map") || !std::strcmp(argv_[number_of_checked_parameters], "-mm")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->map_file_names_merge.push_back(argv_[number_of_checked_parameters]);
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-stage-trace") || !std::strcmp(argv_[number_of_checked_parameters], "-str")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->stage_trace_file_name = argv_[number_of_checked_parameters];
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-trajectory-stream") || !std::strcmp(argv_[number_of_checked_parameters], "-ts")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->trajectory_stream_file_name = argv_[number_of_checked_parameters];
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-trajectory-stream-format") || !std::strcmp(argv_[number_of_checked_parameters], "-tsf")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->trajectory_stream_format = argv_[number_of_checked_parameters];
     } else if (!std::strcmp(argv_[number_of_checked_parameters], "-h") || !std::strcmp(argv_[number_of_checked_parameters], "--h")) {
       std::cerr << banner << std::endl;
       throw std::runtime_error("help requested");
@@ -270,6 +380,42 @@ void ParameterCollection::parseFromCommandLine(const int32_t& argc_, char ** arg
       command_line_parameters->option_use_odometry = true;
     } else if (!std::strcmp(argv_[number_of_checked_parameters], "-recover-landmarks") || !std::strcmp(argv_[number_of_checked_parameters], "-rl")) {
       command_line_parameters->option_recover_landmarks = true;
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-localization-only") || !std::strcmp(argv_[number_of_checked_parameters], "-lo")) {
+      command_line_parameters->option_localization_only = true;
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-pipelined-processing") || !std::strcmp(argv_[number_of_checked_parameters], "-pp")) {
+      command_line_parameters->option_enable_pipelining = true;
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-prefetch") || !std::strcmp(argv_[number_of_checked_parameters], "-pf")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->number_of_prefetched_frames = std::stoul(argv_[number_of_checked_parameters]);
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-latency-budget") || !std::strcmp(argv_[number_of_checked_parameters], "-lb")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->latency_budget_seconds = std::stod(argv_[number_of_checked_parameters]);
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-target-frame-rate") || !std::strcmp(argv_[number_of_checked_parameters], "-tfr")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->target_frame_rate_hz = std::stod(argv_[number_of_checked_parameters]);
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-log-level") || !std::strcmp(argv_[number_of_checked_parameters], "-ll")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->logging_level = toLoggingLevel(argv_[number_of_checked_parameters]);
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-asynchronous-logging") || !std::strcmp(argv_[number_of_checked_parameters], "-al")) {
+      command_line_parameters->option_enable_asynchronous_logging = true;
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-processing-thread") || !std::strcmp(argv_[number_of_checked_parameters], "-pt")) {
+      command_line_parameters->option_enable_processing_thread = true;
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-publishing-rate") || !std::strcmp(argv_[number_of_checked_parameters], "-pr")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->publishing_rate_hz = std::stod(argv_[number_of_checked_parameters]);
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-image-viewer-rate") || !std::strcmp(argv_[number_of_checked_parameters], "-ivr")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->image_viewer_refresh_rate_hz = std::stod(argv_[number_of_checked_parameters]);
+    } else if (!std::strcmp(argv_[number_of_checked_parameters], "-image-viewer-scale") || !std::strcmp(argv_[number_of_checked_parameters], "-ivs")) {
+      number_of_checked_parameters++;
+      if (number_of_checked_parameters == argc_) {break;}
+      command_line_parameters->image_viewer_scale = std::stod(argv_[number_of_checked_parameters]);
     } else if (!std::strcmp(argv_[number_of_checked_parameters], "-configuration") || !std::strcmp(argv_[number_of_checked_parameters], "-c")) {
       number_of_checked_parameters++;
     } else {
@@ -282,7 +428,9 @@ void ParameterCollection::parseFromCommandLine(const int32_t& argc_, char ** arg
   setMode(command_line_parameters->tracker_mode);
 
   //ds propagate duplicated values (generic)
-  image_viewer_parameters->tracker_mode = command_line_parameters->tracker_mode;
+  image_viewer_parameters->tracker_mode            = command_line_parameters->tracker_mode;
+  image_viewer_parameters->maximum_refresh_rate_hz = command_line_parameters->image_viewer_refresh_rate_hz;
+  image_viewer_parameters->image_scale             = command_line_parameters->image_viewer_scale;
 
   //ds validate input parameters and exit on failure
   validateParameters();
@@ -324,13 +472,36 @@ void ParameterCollection::parseFromFile(const std::string& filename_) {
     PARSE_PARAMETER(configuration, command_line, command_line_parameters, option_equalize_histogram, bool)
     PARSE_PARAMETER(configuration, command_line, command_line_parameters, option_recover_landmarks, bool)
     PARSE_PARAMETER(configuration, command_line, command_line_parameters, option_disable_bundle_adjustment, bool)
+    PARSE_PARAMETER(configuration, command_line, command_line_parameters, option_localization_only, bool)
+    PARSE_PARAMETER(configuration, command_line, command_line_parameters, option_enable_pipelining, bool)
+    PARSE_PARAMETER(configuration, command_line, command_line_parameters, number_of_prefetched_frames, Count)
+    PARSE_PARAMETER(configuration, command_line, command_line_parameters, latency_budget_seconds, real)
+    PARSE_PARAMETER(configuration, command_line, command_line_parameters, target_frame_rate_hz, real)
+    PARSE_PARAMETER(configuration, command_line, command_line_parameters, option_enable_asynchronous_logging, bool)
+    PARSE_PARAMETER(configuration, command_line, command_line_parameters, option_enable_processing_thread, bool)
+    PARSE_PARAMETER(configuration, command_line, command_line_parameters, publishing_rate_hz, real)
+    PARSE_PARAMETER(configuration, command_line, command_line_parameters, image_viewer_refresh_rate_hz, real)
+    PARSE_PARAMETER(configuration, command_line, command_line_parameters, image_viewer_scale, real)
+
+    //ds parse logging level as string (optional)
+    if (configuration["command_line"]["logging_level"]) {
+      ++number_of_parameters_detected;
+      command_line_parameters->logging_level = toLoggingLevel(configuration["command_line"]["logging_level"].as<std::string>());
+      ++number_of_parameters_parsed;
+    }
 
     //Types
     PARSE_PARAMETER(configuration, world_map, world_map_parameters, minimum_distance_traveled_for_local_map, real)
     PARSE_PARAMETER(configuration, world_map, world_map_parameters, minimum_degrees_rotated_for_local_map, real)
     PARSE_PARAMETER(configuration, world_map, world_map_parameters, minimum_number_of_frames_for_local_map, Count)
+    PARSE_PARAMETER(configuration, world_map, world_map_parameters, number_of_frames_with_full_data, Count)
+    PARSE_PARAMETER(configuration, world_map, world_map_parameters, maximum_frame_memory_megabytes, real)
+    PARSE_PARAMETER(configuration, world_map, world_map_parameters, landmark_index_voxel_size_meters, real)
     PARSE_PARAMETER(configuration, landmark, world_map_parameters->landmark, minimum_number_of_forced_updates, Count)
+    PARSE_PARAMETER(configuration, landmark, world_map_parameters->landmark, enable_incremental_estimation, bool)
+    PARSE_PARAMETER(configuration, landmark, world_map_parameters->landmark, maximum_number_of_measurements, Count)
     PARSE_PARAMETER(configuration, local_map, world_map_parameters->local_map, minimum_number_of_landmarks, Count)
+    PARSE_PARAMETER(configuration, local_map, world_map_parameters->local_map, maximum_number_of_appearances_per_landmark, Count)
 
     //ds mode specific parameters
     BaseFramePointGeneratorParameters* framepoint_generation_parameters = 0;
@@ -344,6 +515,7 @@ void ParameterCollection::parseFromFile(const std::string& filename_) {
         PARSE_PARAMETER(configuration, stereo_framepoint_generation, stereo_framepoint_generator_parameters, maximum_matching_distance_triangulation, int32_t)
         PARSE_PARAMETER(configuration, stereo_framepoint_generation, stereo_framepoint_generator_parameters, minimum_disparity_pixels, real)
         PARSE_PARAMETER(configuration, stereo_framepoint_generation, stereo_framepoint_generator_parameters, maximum_epipolar_search_offset_pixels, int32_t)
+        PARSE_PARAMETER(configuration, stereo_framepoint_generation, stereo_framepoint_generator_parameters, enable_concurrent_stream_processing, bool)
         break;
       }
       case CommandLineParameters::TrackerMode::RGB_DEPTH: {
@@ -353,6 +525,8 @@ void ParameterCollection::parseFromFile(const std::string& filename_) {
         //FramepointGeneration (SPECIFIC)
         PARSE_PARAMETER(configuration, depth_framepoint_generation, depth_framepoint_generator_parameters, maximum_depth_near_meters, real)
         PARSE_PARAMETER(configuration, depth_framepoint_generation, depth_framepoint_generator_parameters, maximum_depth_far_meters, real)
+        PARSE_PARAMETER(configuration, depth_framepoint_generation, depth_framepoint_generator_parameters, enable_registered_depth, bool)
+        PARSE_PARAMETER(configuration, depth_framepoint_generation, depth_framepoint_generator_parameters, number_of_registration_threads, uint32_t)
         break;
       }
       default: {
@@ -367,8 +541,14 @@ void ParameterCollection::parseFromFile(const std::string& filename_) {
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, detector_threshold_minimum, int32_t)
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, detector_threshold_maximum, int32_t)
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, detector_threshold_maximum_change, real)
+    PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, minimum_keypoint_target_scale, real)
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, number_of_detectors_vertical, int32_t)
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, number_of_detectors_horizontal, int32_t)
+    PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, number_of_detection_threads, uint32_t)
+    PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, keypoint_detection_backend, std::string)
+    PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, detection_pyramid_level, uint32_t)
+    PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, enable_lazy_detection, bool)
+    PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, lazy_detection_saturation_ratio, real)
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, matching_distance_tracking_threshold, int32_t)
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, maximum_reliable_depth_meters, real)
 
@@ -378,7 +558,15 @@ void ParameterCollection::parseFromFile(const std::string& filename_) {
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, minimum_projection_tracking_distance_pixels, int32_t)
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, maximum_projection_tracking_distance_pixels, int32_t)
     PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, tunnel_vision_ratio, real)
+    PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, enable_adaptive_tracking_windows, bool)
+    PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, adaptive_tracking_window_sigma_factor, real)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, motion_guess_standard_deviation_translation_meters, real)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, motion_guess_standard_deviation_rotation_radians, real)
     PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, maximum_number_of_landmark_recoveries, Count)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, maximum_number_of_frames_for_map_recovery, Count)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, number_of_landmark_update_threads, Count)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, enable_deferred_landmark_updates, bool)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, minimum_number_of_updates_for_deferral, Count)
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, enable_keypoint_binning, bool)
     PARSE_PARAMETER(configuration, base_framepoint_generation, framepoint_generation_parameters, bin_size_pixels, Count)
     PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, minimum_delta_angular_for_movement, real)
@@ -389,6 +577,12 @@ void ParameterCollection::parseFromFile(const std::string& filename_) {
     PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, aligner->maximum_number_of_iterations, Count)
     PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, aligner->minimum_number_of_inliers, Count)
     PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, aligner->minimum_inlier_ratio, real)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, aligner->number_of_linearization_threads, Count)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, aligner->minimum_number_of_measurements_per_thread, Count)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, aligner->enable_coarse_to_fine_estimation, bool)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, aligner->coarse_number_of_measurements, Count)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, aligner->coarse_number_of_hypotheses, Count)
+    PARSE_PARAMETER(configuration, base_tracking, tracker_parameters, aligner->coarse_outlier_rejection_factor, real)
 
     //ds parse desired motion model as string
     const std::string& motion_model = configuration["base_tracking"]["motion_model"].as<std::string>();
@@ -397,6 +591,8 @@ void ParameterCollection::parseFromFile(const std::string& filename_) {
       tracker_parameters->motion_model = Parameters::MotionModel::NONE;
     } else if (motion_model == "CONSTANT_VELOCITY") {
       tracker_parameters->motion_model = Parameters::MotionModel::CONSTANT_VELOCITY;
+    } else if (motion_model == "CAMERA_ODOMETRY") {
+      tracker_parameters->motion_model = Parameters::MotionModel::CAMERA_ODOMETRY;
     } else {
       LOG_ERROR(std::cerr << "ParameterCollection::parseFromFile|invalid motion model: " << motion_model << std::endl)
       throw std::runtime_error("invalid motion model");
@@ -409,12 +605,20 @@ void ParameterCollection::parseFromFile(const std::string& filename_) {
     PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, preliminary_minimum_matching_ratio, real)
     PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, minimum_number_of_matched_landmarks, Count)
     PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, minimum_matches_per_correspondence, Count)
+    PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, enable_asynchronous_relocalization, bool)
+    PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, number_of_registration_threads, Count)
+    PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, stop_at_first_valid_closure, bool)
+    PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, enable_place_pruning, bool)
+    PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, maximum_number_of_places, Count)
+    PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, number_of_query_threads, Count)
     PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, aligner->error_delta_for_convergence, real)
     PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, aligner->maximum_error_kernel, real)
     PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, aligner->damping, real)
     PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, aligner->maximum_number_of_iterations, Count)
     PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, aligner->minimum_number_of_inliers, Count)
     PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, aligner->minimum_inlier_ratio, real)
+    PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, aligner->number_of_linearization_threads, Count)
+    PARSE_PARAMETER(configuration, relocalization, relocalizer_parameters, aligner->minimum_number_of_measurements_per_thread, Count)
 
     //Factor Graph Optimization
     PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, enable_full_bundle_adjustment, bool)
@@ -423,11 +627,17 @@ void ParameterCollection::parseFromFile(const std::string& filename_) {
     PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, maximum_number_of_iterations, Count)
     PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, identifier_space, real)
     PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, number_of_frames_per_bundle_adjustment, Count)
+    PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, number_of_local_maps_for_bundle_adjustment, Count)
     PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, base_information_frame, real)
     PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, free_translation_for_poses, bool)
     PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, base_information_frame_factor_for_translation, real)
     PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, enable_robust_kernel_for_poses, bool)
     PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, enable_robust_kernel_for_landmarks, bool)
+    PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, enable_keyframe_pose_graph, bool)
+    PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, enable_asynchronous_optimization, bool)
+    PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, number_of_local_map_update_threads, Count)
+    PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, minimum_local_map_correction_translation_meters, real)
+    PARSE_PARAMETER(configuration, graph_optimization, graph_optimizer_parameters, minimum_local_map_correction_rotation_radians, real)
 
     //ds done
     LOG_INFO(std::cerr << "ParameterCollection::parseFromFile|successfully loaded configuration from file: " << filename_ << std::endl)
@@ -448,6 +658,103 @@ void ParameterCollection::validateParameters() {
     LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|empty value entered for parameter: -topic-image-right (-ir) (enter -h for help)" << std::endl)
     throw std::runtime_error("empty value entered for parameter: -topic-image-right");
   }
+
+  //ds localization requires a map
+  if (command_line_parameters->option_localization_only && command_line_parameters->map_file_name_load.length() == 0) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|-localization-only (-lo) requires a map file: -load-map (-lm) (enter -h for help)" << std::endl)
+    throw std::runtime_error("no map file entered for parameter: -localization-only");
+  }
+
+  //ds map merging requires a base map and the place recognition
+  if (!command_line_parameters->map_file_names_merge.empty()) {
+    if (command_line_parameters->map_file_name_load.length() == 0) {
+      LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|-merge-map (-mm) requires a map file: -load-map (-lm) (enter -h for help)" << std::endl)
+      throw std::runtime_error("no map file entered for parameter: -merge-map");
+    }
+    if (command_line_parameters->option_disable_relocalization) {
+      LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|-merge-map (-mm) cannot be used with -open-loop (-ol) (enter -h for help)" << std::endl)
+      throw std::runtime_error("invalid combination of parameters: -merge-map and -open-loop");
+    }
+  }
+
+  //ds pipelined processing extracts stereo features ahead of tracking, which is not possible with tracking dependent detection
+  if (command_line_parameters->option_enable_pipelining) {
+    if (command_line_parameters->tracker_mode != CommandLineParameters::TrackerMode::RGB_STEREO) {
+      LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|-pipelined-processing (-pp) is only available for stereo tracking (enter -h for help)" << std::endl)
+      throw std::runtime_error("invalid combination of parameters: -pipelined-processing and -depth-mode");
+    }
+    if (stereo_framepoint_generator_parameters->enable_lazy_detection) {
+      LOG_WARNING(std::cerr << "ParameterCollection::validateParameters|-pipelined-processing (-pp): disabling lazy detection" << std::endl)
+      stereo_framepoint_generator_parameters->enable_lazy_detection = false;
+    }
+  }
+
+  //ds publishing rate must not be negative
+  if (command_line_parameters->publishing_rate_hz < 0) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|invalid value entered for parameter: -publishing-rate (-pr): "
+                        << command_line_parameters->publishing_rate_hz << " (enter -h for help)" << std::endl)
+    throw std::runtime_error("invalid value entered for parameter: -publishing-rate");
+  }
+
+  //ds the trajectory stream format must be known
+  try {
+    toTrajectoryFormat(command_line_parameters->trajectory_stream_format);
+  } catch (const std::runtime_error& /*exception*/) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|invalid value entered for parameter: -trajectory-stream-format (-tsf): "
+                        << command_line_parameters->trajectory_stream_format << " (enter -h for help)" << std::endl)
+    throw std::runtime_error("invalid value entered for parameter: -trajectory-stream-format");
+  }
+
+  //ds image viewer refresh rate must not be negative and the display scale can only reduce the resolution
+  if (command_line_parameters->image_viewer_refresh_rate_hz < 0) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|invalid value entered for parameter: -image-viewer-rate (-ivr): "
+                        << command_line_parameters->image_viewer_refresh_rate_hz << " (enter -h for help)" << std::endl)
+    throw std::runtime_error("invalid value entered for parameter: -image-viewer-rate");
+  }
+  if (command_line_parameters->image_viewer_scale <= 0 || command_line_parameters->image_viewer_scale > 1) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|invalid value entered for parameter: -image-viewer-scale (-ivs): "
+                        << command_line_parameters->image_viewer_scale << " (enter -h for help)" << std::endl)
+    throw std::runtime_error("invalid value entered for parameter: -image-viewer-scale");
+  }
+
+  //ds real-time mode requires a positive latency budget
+  if (command_line_parameters->latency_budget_seconds < 0) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|invalid value entered for parameter: -latency-budget (-lb): "
+                        << command_line_parameters->latency_budget_seconds << " (enter -h for help)" << std::endl)
+    throw std::runtime_error("invalid value entered for parameter: -latency-budget");
+  }
+
+  //ds keypoint budget control adjusts the detection of the current frame, which runs ahead in pipelined processing
+  if (command_line_parameters->target_frame_rate_hz < 0) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|invalid value entered for parameter: -target-frame-rate (-tfr): "
+                        << command_line_parameters->target_frame_rate_hz << " (enter -h for help)" << std::endl)
+    throw std::runtime_error("invalid value entered for parameter: -target-frame-rate");
+  }
+  if (command_line_parameters->target_frame_rate_hz > 0 && command_line_parameters->option_enable_pipelining) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|-target-frame-rate (-tfr) cannot be combined with -pipelined-processing (-pp) (enter -h for help)" << std::endl)
+    throw std::runtime_error("-target-frame-rate cannot be combined with -pipelined-processing");
+  }
+  const BaseFramePointGeneratorParameters* framepoint_generation_parameters = (command_line_parameters->tracker_mode == CommandLineParameters::TrackerMode::RGB_STEREO)?
+                                                                              static_cast<const BaseFramePointGeneratorParameters*>(stereo_framepoint_generator_parameters):
+                                                                              static_cast<const BaseFramePointGeneratorParameters*>(depth_framepoint_generator_parameters);
+  if (framepoint_generation_parameters &&
+      (framepoint_generation_parameters->minimum_keypoint_target_scale <= 0 || framepoint_generation_parameters->minimum_keypoint_target_scale > 1)) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|invalid value entered for parameter: minimum_keypoint_target_scale: "
+                        << framepoint_generation_parameters->minimum_keypoint_target_scale << " (expected: (0, 1])" << std::endl)
+    throw std::runtime_error("invalid value entered for parameter: minimum_keypoint_target_scale");
+  }
+
+  //ds map recovery queries the spatial landmark index
+  if (world_map_parameters->landmark_index_voxel_size_meters < 0) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|invalid value entered for parameter: landmark_index_voxel_size_meters: "
+                        << world_map_parameters->landmark_index_voxel_size_meters << " (expected: >= 0)" << std::endl)
+    throw std::runtime_error("invalid value entered for parameter: landmark_index_voxel_size_meters");
+  }
+  if (stereo_tracker_parameters && stereo_tracker_parameters->maximum_number_of_frames_for_map_recovery > 0 &&
+      world_map_parameters->landmark_index_voxel_size_meters == 0) {
+    LOG_ERROR(std::cerr << "ParameterCollection::validateParameters|maximum_number_of_frames_for_map_recovery requires landmark_index_voxel_size_meters > 0" << std::endl)
+    throw std::runtime_error("maximum_number_of_frames_for_map_recovery requires landmark_index_voxel_size_meters > 0");
+  }
 }
 
 void ParameterCollection::setMode(const CommandLineParameters::TrackerMode& mode_) {
@@ -57,6 +57,20 @@ public:
   std::string dataset_file_name       = "";
   std::string configuration_file_name = "";
 
+  //! @brief binary map files to load before processing and to save after processing (disabled if empty)
+  std::string map_file_name_load      = "";
+  std::string map_file_name_save      = "";
+
+  //! @brief additional binary map files that are merged into the loaded map before processing (in the provided order)
+  std::vector<std::string> map_file_names_merge;
+
+  //! @brief per-frame stage timing trace (CSV) written after processing (disabled if empty)
+  std::string stage_trace_file_name   = "";
+
+  //! @brief trajectory streamed to a file while processing (disabled if empty) and its format (KITTI, TUM or BINARY)
+  std::string trajectory_stream_file_name = "";
+  std::string trajectory_stream_format    = "KITTI";
+
   //! @brief options
   bool option_use_gui                   = false;
   bool option_disable_relocalization    = false;
@@ -67,6 +81,39 @@ public:
   bool option_recover_landmarks         = true;
   bool option_disable_bundle_adjustment = true;
   bool option_save_pose_graph           = false;
+
+  //! @brief localization only: tracks against the fixed map loaded with -load-map, re-anchoring the track at loop closures
+  //! @brief the loaded map is not modified (no local maps are added to the place database, no landmark merging or map optimization)
+  bool option_localization_only         = false;
+
+  //! @brief pipelined processing (stereo only): image preprocessing and feature extraction of the next frames run in a worker thread
+  //! @brief while the current frame is tracked and integrated into the map (identical results, lazy detection is disabled)
+  bool option_enable_pipelining         = false;
+
+  //! @brief playback: number of frames a reader thread decodes and preprocesses ahead of processing (0: read on the processing thread)
+  Count number_of_prefetched_frames     = 0;
+
+  //! @brief real-time mode: per-frame latency budget (0: disabled, every frame is processed regardless of its delay)
+  //! @brief stale input frames are dropped in favour of the newest one, exceeded budgets temporarily degrade the processing
+  real latency_budget_seconds           = 0;
+
+  //! @brief keypoint budget control: frame rate the processing is held at by scaling the target number of keypoints (0: disabled)
+  //! @brief the scale is derived from the measured stage timings, see BaseFramePointGeneratorParameters::minimum_keypoint_target_scale
+  real target_frame_rate_hz             = 0;
+
+  //! @brief asynchronous logging: log messages are queued by the calling threads and printed by a background thread (see Logger)
+  //! @brief the minimum level of the printed messages is set by logging_level
+  bool option_enable_asynchronous_logging = false;
+
+  //! @brief ROS node: the image callbacks only queue the latest image pair (older pairs are dropped), a worker thread processes it
+  bool option_enable_processing_thread  = false;
+
+  //! @brief ROS node: rate at which the current pose and the trajectory are published (0: disabled)
+  real publishing_rate_hz               = 0;
+
+  //! @brief image viewer: maximum rate of the displayed frames (0: every processed frame) and display scale (e.g. 0.5: half resolution)
+  real image_viewer_refresh_rate_hz     = 0;
+  real image_viewer_scale               = 1;
 };
 
 //! @class generic aligner parameters, present in modules with aligner units
@@ -96,6 +143,24 @@ public:
 
   //! @brief the minimum ratio of inliers to outliers required for a valid alignment
   real minimum_inlier_ratio          = 0.5;
+
+  //! @brief maximum number of threads used for the linearization (1: serial)
+  Count number_of_linearization_threads = 1;
+
+  //! @brief minimum number of measurements linearized by one thread (smaller problems use fewer threads)
+  Count minimum_number_of_measurements_per_thread = 250;
+
+  //! @brief coarse to fine estimation: solve on a distributed subset with minimal set hypotheses first, then refine on all inliers
+  bool enable_coarse_to_fine_estimation = false;
+
+  //! @brief coarse to fine estimation: approximate size of the distributed measurement subset
+  Count coarse_number_of_measurements = 150;
+
+  //! @brief coarse to fine estimation: number of minimal set hypotheses evaluated in addition to the prior
+  Count coarse_number_of_hypotheses = 10;
+
+  //! @brief coarse to fine estimation: measurements with an error above this factor times the maximum error kernel are rejected
+  real coarse_outlier_rejection_factor = 4;
 };
 
 //! @class landmark parameters
@@ -110,6 +175,13 @@ public:
 
   //! @brief minimum number of measurements before optimization is filtering
   Count minimum_number_of_forced_updates = 2;
+
+  //! @brief incremental estimation: measurements leaving a bounded history are accumulated into a fixed size information block
+  //! @brief with their last robust weight - the cost and memory of an update are independent of the track length
+  bool enable_incremental_estimation = false;
+
+  //! @brief incremental estimation: number of most recent measurements kept for robust re-weighting
+  Count maximum_number_of_measurements = 25;
 };
 
 //! @class local map parameters
@@ -127,6 +199,10 @@ public:
 
   //! @brief target maximum number of landmarks for local map creation
   Count maximum_number_of_landmarks = 1000;
+
+  //! @brief maximum number of appearances (descriptors) added per landmark to a local map and thereby to the place database (0: all)
+  //! @brief the appearances are selected as medoid and the most diverse exemplars of the landmark's descriptors since the last local map
+  Count maximum_number_of_appearances_per_landmark = 0;
 };
 
 //! @class world map parameters
@@ -149,6 +225,17 @@ public:
   real minimum_degrees_rotated_for_local_map   = 0.5;
   Count minimum_number_of_frames_for_local_map = 4;
 
+  //! @brief sliding window: number of most recent frames keeping their full data (images, keypoints, descriptors, framepoints)
+  //! @brief older frames are reduced to pose, timestamp and links - except keyframes of local maps (0: all frames keep full data)
+  Count number_of_frames_with_full_data = 0;
+
+  //! @brief sliding window: memory ceiling for the full frame data in megabytes (0: unbounded)
+  //! @brief if exceeded, keyframes and then frames of the window are reduced as well (oldest first)
+  real maximum_frame_memory_megabytes = 0;
+
+  //! @brief spatial landmark index: voxel edge length of the hash over the landmark world coordinates (0: index disabled)
+  real landmark_index_voxel_size_meters = 0;
+
   //! @brief landmark generation parameters
   LandmarkParameters* landmark;
 
@@ -175,10 +262,30 @@ public:
   uint32_t detector_threshold_maximum       = 100;
   real detector_threshold_maximum_change    = 0.1;
 
+  //! @brief keypoint budget control (target_frame_rate_hz): lowest scale of the target number of keypoints (tracking stability)
+  real minimum_keypoint_target_scale = 0.3;
+
   //! @brief detector number per image dimension
   uint32_t number_of_detectors_vertical   = 1;
   uint32_t number_of_detectors_horizontal = 1;
 
+  //! @brief number of worker threads the detector grid is distributed over (1: serial detection)
+  uint32_t number_of_detection_threads = 1;
+
+  //! @brief keypoint detection backend: CPU (cv::FastFeatureDetector) or CUDA (cv::cuda::FastFeatureDetector, requires OpenCV CUDA modules)
+  std::string keypoint_detection_backend = "CPU";
+
+  //! @brief image pyramid level for keypoint detection and projective tracking (0: full resolution, n: images downsampled by 2^n)
+  //! @brief keypoints are refined, described and triangulated at full resolution - detector, bin and tracking sizes are defined at this level
+  uint32_t detection_pyramid_level = 0;
+
+  //! @brief lazy detection while tracking: keypoints in detector regions saturated by predicted tracks are only described
+  //! @brief if they lie close to a predicted track (remaining keypoints are described on demand, e.g. for tracking recovery)
+  bool enable_lazy_detection = false;
+
+  //! @brief ratio of predicted tracks over the number of bins of a detector region above which the region is considered saturated
+  real lazy_detection_saturation_ratio = 0.8;
+
   //! @brief number of camera image streams (required for detector regions)
   uint32_t number_of_cameras = 1;
 
@@ -186,8 +293,13 @@ public:
   int32_t minimum_projection_tracking_distance_pixels = 15;
   int32_t maximum_projection_tracking_distance_pixels = 50;
 
-  //! @brief dynamic thresholds for descriptor matching
-  int32_t matching_distance_tracking_threshold = 0.2*SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS;
+  //! @brief adaptive projective tracking: per point search windows derived from the motion guess uncertainty and the point depth
+  //! @brief windows are bounded by the minimum and the currently active projection tracking distance (not used for tracking by appearance)
+  bool enable_adaptive_tracking_windows      = false;
+  real adaptive_tracking_window_sigma_factor = 3;
+
+  //! @brief dynamic thresholds for descriptor matching (negative: 20% of the extracted descriptor bits, set in configure)
+  int32_t matching_distance_tracking_threshold = -1;
 
   //! @brief maximum reliable depth with chosen sensor (stereo, depth, sonar, ..)
   real maximum_reliable_depth_meters = 15;
@@ -207,14 +319,17 @@ public:
   //! @brief parameter printing function
   virtual void print() const;
 
-  //! @brief stereo: triangulation configuration
-  int32_t maximum_matching_distance_triangulation = 0.2*SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS;
+  //! @brief stereo: triangulation configuration (negative: 20% of the extracted descriptor bits, set in configure)
+  int32_t maximum_matching_distance_triangulation = -1;
 
   //! @brief minimum considered disparity for triangulation
   real minimum_disparity_pixels = 1;
 
   //! @brief maximum checked epipolar line offsets
   int32_t maximum_epipolar_search_offset_pixels  = 0;
+
+  //! @brief process left and right image stream (detection and descriptor extraction) concurrently
+  bool enable_concurrent_stream_processing = false;
 };
 
 //! @class framepoint generation parameters for a rgbd camera setup
@@ -230,6 +345,12 @@ public:
   //! @brief depth sensor configuration
   real maximum_depth_near_meters = 5;
   real maximum_depth_far_meters  = 20;
+
+  //! @brief skips depth reprojection if the depth image is already registered to the intensity image (shared intrinsics, no offset)
+  bool enable_registered_depth = false;
+
+  //! @brief number of worker threads the depth registration is distributed over (1: serial)
+  uint32_t number_of_registration_threads = 1;
 };
 
 //! @class base tracker parameters
@@ -256,10 +377,22 @@ public:
   //! @brief point tracking thresholds
   real tunnel_vision_ratio = 0.75;
 
+  //! @brief landmark position updates: number of threads refining the landmarks of a frame (1: serial)
+  Count number_of_landmark_update_threads = 1;
+
+  //! @brief landmark position updates: refinements of landmarks with at least minimum_number_of_updates_for_deferral updates
+  //! @brief are computed by a background worker on a snapshot and applied before the next update (while tracking the next frame)
+  bool enable_deferred_landmark_updates        = false;
+  Count minimum_number_of_updates_for_deferral = 10;
+
   //! @brief framepoint track recovery
   bool enable_landmark_recovery               = true;
   Count maximum_number_of_landmark_recoveries = 10;
 
+  //! @brief map recovery: landmarks in view (spatial landmark index) lost within this number of frames are recovered as well (0: disabled)
+  //! @brief extends the recovery from the lost points of the previous frame to short occlusions, requires the landmark index
+  Count maximum_number_of_frames_for_map_recovery = 0;
+
   //! @brief pose optimization
   real minimum_delta_angular_for_movement       = 0.001;
   real minimum_delta_translational_for_movement = 0.01;
@@ -267,6 +400,11 @@ public:
   //! @brief desired motion model (if any)
   MotionModel motion_model = MotionModel::CONSTANT_VELOCITY;
 
+  //! @brief motion guess uncertainty per frame (standard deviations), used for adaptive tracking windows
+  //! @brief constant velocity: expected change in motion between frames, camera odometry: used if no odometry covariance is provided
+  real motion_guess_standard_deviation_translation_meters = 0.05;
+  real motion_guess_standard_deviation_rotation_radians   = 0.005;
+
   //! @brief parameters of aligner unit
   AlignerParameters* aligner;
 };
@@ -307,8 +445,8 @@ public:
   //! @brief parameter printing function
   virtual void print() const;
 
-  //! @brief maximum descriptor distance for a valid match
-  real maximum_descriptor_distance = 0.1*SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS;
+  //! @brief maximum descriptor distance for a valid match (negative: 10% of the extracted descriptor bits, set in configure)
+  real maximum_descriptor_distance = -1;
 
   //! @brief minimum query interspace
   Count preliminary_minimum_interspace_queries = 10;
@@ -322,6 +460,25 @@ public:
   //! @brief correspondence retrieval
   Count minimum_matches_per_correspondence = 0;
 
+  //! @brief run closure detection and registration in a background thread, the closures are applied in a subsequent processing call
+  //! @brief every local map is queued for the thread, the results are applied in creation order once it is idle
+  bool enable_asynchronous_relocalization = false;
+
+  //! @brief number of threads verifying closure candidates in parallel, each with its own aligner (1: serial)
+  Count number_of_registration_threads = 1;
+
+  //! @brief stop the verification of further candidates once a valid closure is found (candidates are verified by descending matching ratio)
+  bool stop_at_first_valid_closure = false;
+
+  //! @brief place database pruning: local maps closing a loop with a database entry are not added (the place is already represented)
+  bool enable_place_pruning = false;
+
+  //! @brief place database capacity in local maps (0: unbounded), once reached further local maps are only matched
+  Count maximum_number_of_places = 0;
+
+  //! @brief number of threads querying the place databases of different tracks in parallel (1: serial)
+  Count number_of_query_threads = 1;
+
   //! @brief parameters of aligner unit
   AlignerParameters* aligner;
 };
@@ -357,6 +514,11 @@ public:
   //! @brief determines window size for bundle adjustment
   Count number_of_frames_per_bundle_adjustment = 100;
 
+  //! @brief local bundle adjustment: optimize the frames of the most recent local maps (and their landmarks) at every new local map
+  //! @brief older frames are removed from the graph with the oldest remaining frame fixed, loop closures trigger a pose graph optimization of the complete map
+  //! @brief runs synchronously, 0: periodic bundle adjustment over the last number_of_frames_per_bundle_adjustment frames
+  Count number_of_local_maps_for_bundle_adjustment = 0;
+
   //! @brief base frame weight in pose graph (assuming 1 for landmarks)
   real base_information_frame = 1e5;
 
@@ -371,6 +533,19 @@ public:
 
   //! @brief enable robust kernel for landmark measurements
   bool enable_robust_kernel_for_landmarks = false;
+
+  //! @brief pose graph with keyframe vertices only, intermediate frames are updated relative to their keyframes after an optimization
+  bool enable_keyframe_pose_graph = false;
+
+  //! @brief optimize a snapshot of the graph in a background thread while tracking continues (the result is applied at the next safe point)
+  bool enable_asynchronous_optimization = false;
+
+  //! @brief post-optimization map update: number of threads moving the landmarks of the corrected local maps (1: serial)
+  Count number_of_local_map_update_threads = 1;
+
+  //! @brief post-optimization map update: local maps whose pose changed less than this are not moved (landmarks keep their coordinates)
+  real minimum_local_map_correction_translation_meters = 1e-4;
+  real minimum_local_map_correction_rotation_radians   = 1e-5;
 };
 
 //! @class image viewer parameters
@@ -389,6 +564,12 @@ public:
 
   //! @brief tracker mode (propagated)
   CommandLineParameters::TrackerMode tracker_mode = CommandLineParameters::TrackerMode::RGB_STEREO;
+
+  //! @brief maximum rate of the frame snapshots taken for display, other frames are skipped by the processing thread (0: every frame, propagated)
+  real maximum_refresh_rate_hz = 0;
+
+  //! @brief scale of the displayed image, overlays are rendered at this resolution (propagated)
+  real image_scale = 1;
 };
 
 //! @class map viewer parameters
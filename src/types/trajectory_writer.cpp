@@ -0,0 +1,212 @@
+#include "trajectory_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "map_file.h"
+
+namespace proslam {
+
+namespace {
+
+//ds fixed widths of the text formats (rotations and quaternions are bounded by 1, translations and timestamps by 1e10)
+constexpr int32_t width_unit  = 12;
+constexpr int32_t width_large = 20;
+
+//ds writes a fixed width number followed by a space
+//ds values exceeding the field (e.g. a diverged estimate) are saturated at its limits to keep the record size fixed
+bool is_saturation_reported = false;
+void formatNumber(const double& value_, const int32_t& width_, char*& target_) {
+  const double maximum = std::pow(10.0, width_-10)-1;
+  const double minimum = -(std::pow(10.0, width_-11)-1);
+  double value = value_;
+  if (value > maximum || value < minimum) {
+    if (!is_saturation_reported) {
+      LOG_WARNING(std::cerr << "TrajectoryWriter::formatNumber|value exceeds the fixed field width: " << value_
+                            << " (saturating, further occurrences are not reported)" << std::endl)
+      is_saturation_reported = true;
+    }
+    value = std::min(std::max(value, minimum), maximum);
+  }
+  char buffer[64];
+  const int32_t length = std::snprintf(buffer, sizeof(buffer), "%*.9f ", width_, value);
+  std::memcpy(target_, buffer, length);
+  target_ += length;
+}
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& file_name_, const Format& format_): _file_name(file_name_),
+                                                                                        _format(format_) {
+  switch (_format) {
+    case Format::KITTI: {
+      _record_size_bytes = 9*(width_unit+1)+3*(width_large+1)+1;
+      break;
+    }
+    case Format::TUM: {
+      _record_size_bytes = 4*(width_large+1)+4*(width_unit+1)+1;
+      break;
+    }
+    default: {
+      _header_size_bytes = sizeof(trajectory_file::Header);
+      _record_size_bytes = sizeof(trajectory_file::Record);
+      break;
+    }
+  }
+
+  //ds create the output file (overwriting)
+  _file_descriptor = open(_file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (_file_descriptor < 0) {
+    throw std::runtime_error("TrajectoryWriter::TrajectoryWriter|unable to create file: "+_file_name);
+  }
+  if (_format == Format::Binary) {
+    trajectory_file::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, trajectory_file::magic, sizeof(header.magic));
+    header.version           = trajectory_file::version;
+    header.record_size_bytes = sizeof(trajectory_file::Record);
+    _write(reinterpret_cast<const char*>(&header), sizeof(header), 0);
+  }
+  LOG_INFO(std::cerr << "TrajectoryWriter::TrajectoryWriter|streaming trajectory to: '" << _file_name << "'" << std::endl)
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+  if (_file_descriptor >= 0) {
+    close(_file_descriptor);
+  }
+  LOG_INFO(std::cerr << "TrajectoryWriter::~TrajectoryWriter|written frames: " << _frame_identifiers.size()
+                     << " rewritten records: " << _number_of_rewritten_records << " to: '" << _file_name << "'" << std::endl)
+}
+
+void TrajectoryWriter::update(const WorldMap* world_map_, const bool& include_current_frame_) {
+  double robot_to_world[12];
+
+  //ds if existing frames might have moved - rewrite the consecutive ranges of moved frames
+  if (world_map_->revision() != _revision_map) {
+    _revision_map = world_map_->revision();
+    _buffer.clear();
+    Index index_record       = 0;
+    Index index_record_moved = 0;
+    for (const FramePointerMapElement& frame: world_map_->frames()) {
+      if (index_record == _frame_identifiers.size()) {
+        break;
+      }
+      if (frame.first != _frame_identifiers[index_record]) {
+        throw std::runtime_error("TrajectoryWriter::update|map frames do not match the written records at frame: "+std::to_string(frame.first));
+      }
+      map_file::setTransform(frame.second->robotToWorld(), robot_to_world);
+      double* robot_to_world_written = &_written_poses[12*index_record];
+      if (std::memcmp(robot_to_world, robot_to_world_written, sizeof(robot_to_world)) != 0) {
+        if (_buffer.empty()) {
+          index_record_moved = index_record;
+        }
+        std::memcpy(robot_to_world_written, robot_to_world, sizeof(robot_to_world));
+        _buffer.resize(_buffer.size()+_record_size_bytes);
+        _formatRecord(frame.second, robot_to_world, _buffer.data()+_buffer.size()-_record_size_bytes);
+        ++_number_of_rewritten_records;
+      } else if (!_buffer.empty()) {
+        _writeRecords(index_record_moved, index_record-index_record_moved);
+      }
+      ++index_record;
+    }
+    if (!_buffer.empty()) {
+      _writeRecords(index_record_moved, index_record-index_record_moved);
+    }
+  }
+
+  //ds append the finalized frames (the current frame is still refined by tracking)
+  _buffer.clear();
+  const Index index_record_first       = _frame_identifiers.size();
+  const Identifier identifier_frame_next = (_frame_identifiers.empty())? 0: _frame_identifiers.back()+1;
+  for (FramePointerMap::const_iterator iterator = world_map_->frames().lower_bound(identifier_frame_next);
+       iterator != world_map_->frames().end(); ++iterator) {
+    if (iterator->second == world_map_->currentFrame() && !include_current_frame_) {
+      break;
+    }
+    map_file::setTransform(iterator->second->robotToWorld(), robot_to_world);
+    _frame_identifiers.push_back(iterator->first);
+    _written_poses.insert(_written_poses.end(), robot_to_world, robot_to_world+12);
+    _buffer.resize(_buffer.size()+_record_size_bytes);
+    _formatRecord(iterator->second, robot_to_world, _buffer.data()+_buffer.size()-_record_size_bytes);
+  }
+  if (!_buffer.empty()) {
+    _writeRecords(index_record_first, _frame_identifiers.size()-index_record_first);
+  }
+}
+
+void TrajectoryWriter::_formatRecord(const Frame* frame_, const double* robot_to_world_, char* record_) const {
+  char* target = record_;
+  switch (_format) {
+    case Format::KITTI: {
+      for (uint32_t index = 0; index < 12; ++index) {
+        formatNumber(robot_to_world_[index], (index%4 == 3)? width_large: width_unit, target);
+      }
+      *target = '\n';
+      break;
+    }
+    case Format::TUM: {
+      Eigen::Matrix3d rotation;
+      for (uint32_t row = 0; row < 3; ++row) {
+        for (uint32_t col = 0; col < 3; ++col) {
+          rotation(row, col) = robot_to_world_[4*row+col];
+        }
+      }
+      const Eigen::Quaterniond orientation(rotation);
+      formatNumber(frame_->timestampImageLeftSeconds(), width_large, target);
+      formatNumber(robot_to_world_[3], width_large, target);
+      formatNumber(robot_to_world_[7], width_large, target);
+      formatNumber(robot_to_world_[11], width_large, target);
+      formatNumber(orientation.x(), width_unit, target);
+      formatNumber(orientation.y(), width_unit, target);
+      formatNumber(orientation.z(), width_unit, target);
+      formatNumber(orientation.w(), width_unit, target);
+      *target = '\n';
+      break;
+    }
+    default: {
+      trajectory_file::Record record;
+      std::memset(&record, 0, sizeof(record));
+      record.frame_identifier             = frame_->identifier();
+      record.timestamp_image_left_seconds = frame_->timestampImageLeftSeconds();
+      std::memcpy(record.robot_to_world, robot_to_world_, sizeof(record.robot_to_world));
+      std::memcpy(record_, &record, sizeof(record));
+      break;
+    }
+  }
+}
+
+void TrajectoryWriter::_writeRecords(const Index& index_record_, const Count& number_of_records_) {
+  assert(_buffer.size() == number_of_records_*_record_size_bytes);
+  _write(_buffer.data(), _buffer.size(), _header_size_bytes+index_record_*_record_size_bytes);
+  _buffer.clear();
+}
+
+void TrajectoryWriter::_write(const char* data_, const size_t& size_bytes_, const size_t& offset_bytes_) {
+  size_t size_bytes_written = 0;
+  while (size_bytes_written < size_bytes_) {
+    const ssize_t result = pwrite(_file_descriptor, data_+size_bytes_written, size_bytes_-size_bytes_written, offset_bytes_+size_bytes_written);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("TrajectoryWriter::_write|unable to write to file: "+_file_name+" ("+std::strerror(errno)+")");
+    }
+    size_bytes_written += result;
+  }
+}
+
+const TrajectoryWriter::Format toTrajectoryFormat(const std::string& name_) {
+  if (name_ == "KITTI") {
+    return TrajectoryWriter::Format::KITTI;
+  } else if (name_ == "TUM") {
+    return TrajectoryWriter::Format::TUM;
+  } else if (name_ == "BINARY") {
+    return TrajectoryWriter::Format::Binary;
+  } else {
+    throw std::runtime_error("invalid trajectory format: "+name_);
+  }
+}
+}
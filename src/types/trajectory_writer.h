@@ -0,0 +1,126 @@
+#pragma once
+#include "world_map.h"
+
+namespace proslam {
+
+//! @brief binary trajectory file layout (version 1), written by the TrajectoryWriter
+//! the file consists of a header followed by one fixed size record per frame in identifier order (native byte order)
+namespace trajectory_file {
+
+//! @brief file signature and format version (increment on any layout change)
+static constexpr char magic[8]    = {'P', 'R', 'O', 'S', 'L', 'A', 'M', 'T'};
+static constexpr uint32_t version = 1;
+
+//! @brief file header, located at the beginning of the file
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size_bytes;
+};
+
+//! @brief frame pose
+struct Record {
+  uint64_t frame_identifier;
+  double timestamp_image_left_seconds;
+  double robot_to_world[12];
+};
+
+static_assert(sizeof(Header)%8 == 0, "trajectory_file::Header is not 8 byte aligned");
+static_assert(sizeof(Record)%8 == 0, "trajectory_file::Record is not 8 byte aligned");
+} //namespace trajectory_file
+
+//! @class streaming trajectory output: appends the poses of finalized frames to a file while processing
+//! and rewrites the records of frames moved since they have been written (e.g. by optimization or track merging)
+//! all formats use fixed size records (text formats with fixed width numbers), such that records can be rewritten in place
+//! records are written without user space buffering, the file always contains the trajectory up to the last update
+class TrajectoryWriter {
+
+//ds exported types
+public:
+
+  //! @brief output formats
+  enum Format {KITTI  = 0, //ds text: row-major 3x4 robot to world isometry per line
+               TUM    = 1, //ds text: timestamp x y z qx qy qz qw per line
+               Binary = 2}; //ds trajectory_file records
+
+//ds object management
+public:
+
+  //! @brief creates the output file (overwriting)
+  //! @param[in] file_name_ output file
+  //! @param[in] format_ output format
+  //! @throws std::runtime_error if the file cannot be created
+  TrajectoryWriter(const std::string& file_name_, const Format& format_);
+
+  //! @brief closes the output file (without writing pending frames, see update)
+  ~TrajectoryWriter();
+
+  //! @brief prohibit copying (the writer owns the file)
+  TrajectoryWriter(const TrajectoryWriter&) = delete;
+  TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+//ds functionality
+public:
+
+  //! @brief appends the frames finalized since the last call and, if the map revision changed, rewrites the records of moved frames
+  //! @param[in] world_map_ map containing the already written frames in identical order
+  //! @param[in] include_current_frame_ the current frame is considered finalized (e.g. after processing)
+  //! @throws std::runtime_error if writing fails
+  void update(const WorldMap* world_map_, const bool& include_current_frame_ = false);
+
+//ds getters/setters
+public:
+
+  const std::string& fileName() const {return _file_name;}
+  const Format& format() const {return _format;}
+  const Count numberOfWrittenFrames() const {return _frame_identifiers.size();}
+  const Count& numberOfRewrittenRecords() const {return _number_of_rewritten_records;}
+
+//ds helpers
+protected:
+
+  //! @brief formats the record of a frame (record size bytes)
+  //! @param[in] frame_ frame to store
+  //! @param[in] robot_to_world_ pose of the frame (row-major 3x4)
+  //! @param[out] record_ target buffer
+  void _formatRecord(const Frame* frame_, const double* robot_to_world_, char* record_) const;
+
+  //! @brief writes records to the file
+  //! @param[in] index_record_ index of the first record
+  //! @param[in] number_of_records_ number of consecutive records in the buffer
+  void _writeRecords(const Index& index_record_, const Count& number_of_records_);
+
+  //! @brief writes data at a file position
+  void _write(const char* data_, const size_t& size_bytes_, const size_t& offset_bytes_);
+
+//ds attributes
+protected:
+
+  //! @brief output file and format
+  const std::string _file_name;
+  const Format _format;
+  int32_t _file_descriptor = -1;
+
+  //! @brief file layout
+  size_t _header_size_bytes = 0;
+  size_t _record_size_bytes = 0;
+
+  //! @brief identifiers and written poses (row-major 3x4) of the written frames, in record order
+  std::vector<Identifier> _frame_identifiers;
+  std::vector<double> _written_poses;
+
+  //! @brief map revision at the last update
+  Count _revision_map = 0;
+
+  //! @brief formatting buffer for consecutive records
+  std::vector<char> _buffer;
+
+  //ds informative only
+  Count _number_of_rewritten_records = 0;
+};
+
+//! @brief parses a trajectory format from its name (KITTI, TUM or BINARY)
+//! @throws std::runtime_error for an invalid name
+const TrajectoryWriter::Format toTrajectoryFormat(const std::string& name_);
+
+}
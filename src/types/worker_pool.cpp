@@ -0,0 +1,66 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+namespace proslam {
+
+WorkerPool::WorkerPool(const Count& number_of_workers_) {
+  _workers.reserve(number_of_workers_);
+  for (Count index_worker = 0; index_worker < number_of_workers_; ++index_worker) {
+    _workers.push_back(std::thread([this] {_work();}));
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _is_stopped = true;
+  }
+  _condition_jobs.notify_all();
+  for (std::thread& worker: _workers) {
+    worker.join();
+  }
+}
+
+void WorkerPool::_run(Job& job_) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _jobs.push_back(&job_);
+  _condition_jobs.notify_all();
+
+  //ds the calling thread keeps claiming tasks of its own job - this guarantees progress if all workers are busy (or nested)
+  while (job_.index_next_task < job_.number_of_tasks) {
+    _runTask(&job_, lock);
+  }
+  _condition_completion.wait(lock, [&job_] {return job_.number_of_completed_tasks == job_.number_of_tasks;});
+}
+
+void WorkerPool::_runTask(Job* job_, std::unique_lock<std::mutex>& lock_) {
+  const Index index_task = job_->index_next_task;
+  ++job_->index_next_task;
+
+  //ds fully claimed jobs are not offered anymore
+  if (job_->index_next_task == job_->number_of_tasks) {
+    _jobs.erase(std::find(_jobs.begin(), _jobs.end(), job_));
+  }
+  lock_.unlock();
+  job_->execute(job_->function, index_task);
+  lock_.lock();
+
+  //ds the job may be released by its submitter as soon as the last completion is visible
+  ++job_->number_of_completed_tasks;
+  if (job_->number_of_completed_tasks == job_->number_of_tasks) {
+    _condition_completion.notify_all();
+  }
+}
+
+void WorkerPool::_work() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    _condition_jobs.wait(lock, [this] {return _is_stopped || !_jobs.empty();});
+    if (_is_stopped) {
+      return;
+    }
+    _runTask(_jobs.front(), lock);
+  }
+}
+} //namespace proslam
@@ -0,0 +1,102 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include "definitions.h"
+
+namespace proslam {
+
+//! @class persistent set of worker threads executing the parallel loops of the processing units (owned by the SLAMAssembly)
+//! a loop is submitted as a number of tasks, which are claimed by the idle workers and the calling thread, run blocks until all are done
+//! loops may be submitted concurrently by multiple threads and from within a task (the submitting thread always contributes to its own loop)
+class WorkerPool {
+
+//ds object handling
+public:
+
+  //! @brief starts the workers
+  //! @param[in] number_of_workers_ number of threads in addition to the submitting ones (0: all tasks run on the submitting thread)
+  WorkerPool(const Count& number_of_workers_);
+
+  //! @brief stops and joins the workers (no loop may be running)
+  ~WorkerPool();
+
+  //! @brief prohibit copying (the workers reference the instance)
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+//ds functionality
+public:
+
+  //! @brief calls function_(index_task) for every index_task in [0, number_of_tasks_) and returns once all calls have been completed
+  //! @param[in] number_of_tasks_ number of tasks, typically the number of ranges a loop is partitioned into
+  //! @param[in] function_ callable taking the task index, tasks have to be independent and must not throw
+  template<typename Function_>
+  void run(const Count& number_of_tasks_, const Function_& function_) {
+    if (_workers.empty() || number_of_tasks_ < 2) {
+      for (Index index_task = 0; index_task < number_of_tasks_; ++index_task) {
+        function_(index_task);
+      }
+      return;
+    }
+    Job job([](const void* function_, const Index& index_task_) {(*static_cast<const Function_*>(function_))(index_task_);},
+            &function_,
+            number_of_tasks_);
+    _run(job);
+  }
+
+//ds getters/setters
+public:
+
+  const Count numberOfWorkers() const {return _workers.size();}
+
+//ds helpers
+protected:
+
+  //! @brief loop in flight: tasks are claimed in index order under the mutex
+  struct Job {
+    Job(void (*execute_)(const void*, const Index&), const void* function_, const Count& number_of_tasks_): execute(execute_),
+                                                                                                           function(function_),
+                                                                                                           number_of_tasks(number_of_tasks_) {}
+    void (*execute)(const void*, const Index&);
+    const void* function;
+    const Count number_of_tasks;
+    Index index_next_task           = 0;
+    Count number_of_completed_tasks = 0;
+  };
+
+  //! @brief publishes the job, processes its tasks on the calling thread as well and waits for the completion of the remaining ones
+  void _run(Job& job_);
+
+  //! @brief claims and executes the next task of the job (the lock is released during execution)
+  void _runTask(Job* job_, std::unique_lock<std::mutex>& lock_);
+
+  //! @brief worker thread loop
+  void _work();
+
+//ds attributes
+protected:
+
+  std::vector<std::thread> _workers;
+
+  //! @brief jobs with unclaimed tasks, in submission order
+  std::deque<Job*> _jobs;
+  std::mutex _mutex;
+  std::condition_variable _condition_jobs;
+  std::condition_variable _condition_completion;
+  bool _is_stopped = false;
+};
+
+//! @brief runs the tasks on the pool if available, otherwise serially on the calling thread (e.g. units used outside of an assembly)
+template<typename Function_>
+inline void runTasks(WorkerPool* worker_pool_, const Count& number_of_tasks_, const Function_& function_) {
+  if (worker_pool_) {
+    worker_pool_->run(number_of_tasks_, function_);
+  } else {
+    for (Index index_task = 0; index_task < number_of_tasks_; ++index_task) {
+      function_(index_task);
+    }
+  }
+}
+} //namespace proslam
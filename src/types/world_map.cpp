@@ -2,11 +2,19 @@
 
 #include <fstream>
 #include <iomanip>
+#include <cstring>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "map_file.h"
 
 namespace proslam {
 using namespace srrg_core;
 
-WorldMap::WorldMap(const WorldMapParameters* parameters_): _parameters(parameters_) {
+WorldMap::WorldMap(const WorldMapParameters* parameters_): _landmark_index(parameters_->landmark_index_voxel_size_meters),
+                                                            _parameters(parameters_) {
   LOG_INFO(std::cerr << "WorldMap::WorldMap|constructing" << std::endl)
   clear();
   LOG_INFO(std::cerr << "WorldMap::WorldMap|constructed" << std::endl)
@@ -45,6 +53,13 @@ void WorldMap::clear() {
   _frames.clear();
   _local_maps.clear();
   _currently_tracked_landmarks.clear();
+  _frames_with_full_data.clear();
+  _keyframes_with_full_data.clear();
+  _memory_keyframes_with_full_data_bytes = 0;
+  _transient_landmarks.clear();
+  _identifiers_removed_landmarks.clear();
+  _landmark_index.clear();
+  ++_revision;
 }
 
 Frame* WorldMap::createFrame(const TransformMatrix3D& robot_to_world_,
@@ -52,7 +67,7 @@ Frame* WorldMap::createFrame(const TransformMatrix3D& robot_to_world_,
 
   //ds update current frame
   _previous_frame = _current_frame;
-  _current_frame  = new Frame(this, _previous_frame, 0, robot_to_world_, timestamp_image_left_seconds_);
+  _current_frame  = new Frame(_identifier_next_frame++, this, _previous_frame, 0, robot_to_world_, timestamp_image_left_seconds_);
 
   //ds check if the frame has a predecessor
   if (_previous_frame) {
@@ -68,16 +83,55 @@ Frame* WorldMap::createFrame(const TransformMatrix3D& robot_to_world_,
   _frames.insert(std::make_pair(_current_frame->identifier(), _current_frame));
   _frame_queue_for_local_map.push_back(_current_frame);
 
+  //ds release the data of old frames if running in sliding window mode
+  if (_parameters->number_of_frames_with_full_data > 0 || _is_localization_only) {
+    _frames_with_full_data.push_back(_current_frame);
+    _reduceFrames();
+  }
+  if (_is_localization_only) {
+    _releaseTransientLandmarks();
+
+    //ds reclaim the storage of released landmarks at the frame boundary (compaction invalidates landmark map iterators)
+    if (_landmarks.isSparse()) {
+      _landmarks.compact();
+    }
+  }
+
   //ds done
   return _current_frame;
 }
 
 Landmark* WorldMap::createLandmark(FramePoint* origin_) {
-  Landmark* landmark = new Landmark(origin_, _parameters->landmark);
+  Landmark* landmark = new Landmark(_identifier_next_landmark++, origin_, _parameters->landmark);
   _landmarks.insert(std::make_pair(landmark->identifier(), landmark));
+  if (_is_localization_only) {
+    _transient_landmarks.push_back(landmark);
+  }
+  _landmark_index.update(landmark);
   return landmark;
 }
 
+void WorldMap::updateLandmarkIndex() {
+  if (!_landmark_index.isEnabled()) {
+    return;
+  }
+
+  //ds moved landmarks (optimization, anchoring, merged tracks): rebuild - removals and landmark merges are applied incrementally
+  if (_revision != _revision_landmark_index) {
+    _landmark_index.clear();
+    for (LandmarkPointerMapElement& element: _landmarks) {
+      _landmark_index.update(element.second);
+    }
+    _revision_landmark_index = _revision;
+    return;
+  }
+
+  //ds tracked landmarks: re-binned only if their revision changed
+  for (Landmark* landmark: _currently_tracked_landmarks) {
+    _landmark_index.update(landmark);
+  }
+}
+
 const bool WorldMap::createLocalMap(const bool& drop_framepoints_) {
   if (_previous_frame == 0) {
     return false;
@@ -97,8 +151,11 @@ const bool WorldMap::createLocalMap(const bool& drop_framepoints_) {
       _frame_queue_for_local_map.size() > _parameters->minimum_number_of_frames_for_local_map)                          ||
      (_frame_queue_for_local_map.size() > _parameters->minimum_number_of_frames_for_local_map && _local_maps.size() < 5)) {
 
+    CHRONOMETER_START(local_map_generation)
+
     //ds create the new keyframe and add it to the keyframe database
-    _current_local_map = new LocalMap(_frame_queue_for_local_map,
+    _current_local_map = new LocalMap(_identifier_next_local_map++,
+                                      _frame_queue_for_local_map,
                                       _parameters->local_map,
                                       _root_local_map,
                                       _current_local_map);
@@ -114,6 +171,7 @@ const bool WorldMap::createLocalMap(const bool& drop_framepoints_) {
 
     //ds reset generation properties
     resetWindowForLocalMapCreation(drop_framepoints_);
+    CHRONOMETER_STOP(local_map_generation)
 
     //ds local map generated
     return true;
@@ -152,12 +210,23 @@ void WorldMap::addLoopClosure(LocalMap* query_,
                               const Closure::CorrespondencePointerVector& landmark_correspondences_,
                               const real& information_) {
 
-  //ds check if we relocalized after a lost track
-  if (_frames.at(0)->root() != _current_frame->root()) {
-    assert(_current_frame->localMap() == query_);
+  //ds check if we relocalized after a lost track (or in another loaded map)
+  if (query_->keyframe()->root() != reference_->keyframe()->root()) {
+
+    //ds check if the closure connects the current track to the one it lost (must be evaluated before the roots change)
+    const bool is_recovering_track = (_current_frame                                                        &&
+                                      _last_frame_before_track_break                                        &&
+                                      _last_local_map_before_track_break                                    &&
+                                      query_->keyframe()->root() == _current_frame->root()                  &&
+                                      _last_frame_before_track_break->root() == reference_->keyframe()->root());
 
-    //ds rudely link the current frame into the list (proper map merging will be coming soon!)
-    setTrack(_current_frame);
+    //ds move the query track onto the reference track
+    mergeTracks(query_, reference_, query_to_reference_);
+
+    //ds link the query into the list of the lost track
+    if (is_recovering_track) {
+      setTrack(query_->keyframe());
+    }
   }
 
   //ds add loop closure information to the world map
@@ -168,6 +237,227 @@ void WorldMap::addLoopClosure(LocalMap* query_,
   ++_number_of_closures;
 }
 
+void WorldMap::mergeTracks(LocalMap* query_, const LocalMap* reference_, const TransformMatrix3D& query_to_reference_) {
+  const Frame* root_frame_query        = query_->keyframe()->root();
+  const LocalMap* root_local_map_query = query_->root();
+  const Frame* root_frame_reference    = reference_->keyframe()->root();
+  LocalMap* root_local_map_reference   = nullptr;
+  for (LocalMap* local_map: _local_maps) {
+    if (local_map == reference_->root()) {
+      root_local_map_reference = local_map;
+      break;
+    }
+  }
+  assert(root_local_map_reference);
+  if (root_frame_query == root_frame_reference) {
+    return;
+  }
+
+  //ds rigid correction from the query world into the reference world (the query local map is placed according to the closure)
+  const TransformMatrix3D world_query_to_world_reference = reference_->localMapToWorld()*query_to_reference_*query_->worldToLocalMap();
+
+  //ds move and re-root all frames of the query track and collect the still tracked landmarks
+  std::set<Landmark*> landmarks_query;
+  for (FramePointerMapElement& element: _frames) {
+    Frame* frame = element.second;
+    if (frame->root() == root_frame_query) {
+      frame->setRobotToWorld(world_query_to_world_reference*frame->robotToWorld());
+      frame->setRoot(root_frame_reference);
+      for (FramePoint* point: frame->points()) {
+        if (point->landmark()) {
+          landmarks_query.insert(point->landmark());
+        }
+      }
+    }
+  }
+
+  //ds move and re-root all local maps of the query track and collect their landmarks
+  Count number_of_local_maps_merged = 0;
+  for (LocalMap* local_map: _local_maps) {
+    if (local_map->root() == root_local_map_query) {
+      local_map->setLocalMapToWorld(world_query_to_world_reference*local_map->localMapToWorld());
+      local_map->setRoot(root_local_map_reference);
+      for (LocalMap::LandmarkStateMapElement& landmark_state: local_map->landmarks()) {
+        landmarks_query.insert(landmark_state.second.landmark);
+      }
+      ++number_of_local_maps_merged;
+    }
+  }
+  for (Landmark* landmark: landmarks_query) {
+    landmark->transform(world_query_to_world_reference);
+  }
+
+  //ds if the current track has been moved, continue tracking in the reference coordinate frame
+  if (_root_frame == root_frame_query) {
+    _root_frame    = root_frame_reference;
+    robot_to_world = world_query_to_world_reference*robot_to_world;
+  }
+  if (_root_local_map == root_local_map_query) {
+    _root_local_map = root_local_map_reference;
+  }
+  ++_number_of_merged_tracks;
+  ++_revision;
+  LOG_INFO(std::cerr << "WorldMap::mergeTracks|merged track of root [Frame] " << root_frame_query->identifier()
+                     << " into track of root [Frame] " << root_frame_reference->identifier()
+                     << " (local maps: " << number_of_local_maps_merged << " landmarks: " << landmarks_query.size() << ")" << std::endl)
+}
+
+void WorldMap::removeCurrentLocalMap() {
+  if (!_current_local_map) {
+    return;
+  }
+  LocalMap* local_map = _current_local_map;
+  assert(!_local_maps.empty() && _local_maps.back() == local_map);
+
+  //ds unlink frames
+  for (Frame* frame: local_map->frames()) {
+    if (frame->localMap() == local_map) {
+      frame->setLocalMap(nullptr);
+      frame->setFrameToLocalMap(TransformMatrix3D::Identity());
+    }
+  }
+  if (local_map->keyframe()) {
+    local_map->keyframe()->setIsKeyframe(false);
+  }
+
+  //ds free the appearances that have been created for this local map (not consumed by the place database) and unlink landmarks
+  local_map->releaseAppearances();
+  for (LocalMap::LandmarkStateMapElement& landmark_state: local_map->landmarks()) {
+    landmark_state.second.landmark->_local_maps.erase(local_map);
+  }
+
+  //ds unlink local map
+  _current_local_map = local_map->previous();
+  if (_current_local_map) {
+    _current_local_map->setNext(nullptr);
+  }
+  if (_root_local_map == local_map) {
+    _root_local_map = nullptr;
+  }
+  if (_last_local_map_before_track_break == local_map) {
+    _last_local_map_before_track_break = _current_local_map;
+  }
+  _local_maps.pop_back();
+  delete local_map;
+}
+
+void WorldMap::anchorTrack(const TransformMatrix3D& world_previous_to_world_) {
+
+  //ds move all frames that are still used for tracking (older frames keep their estimate)
+  for (Frame* frame: _frames_with_full_data) {
+    frame->setRobotToWorld(world_previous_to_world_*frame->robotToWorld());
+  }
+  if (_frames_with_full_data.empty() && _current_frame) {
+    _current_frame->setRobotToWorld(world_previous_to_world_*_current_frame->robotToWorld());
+  }
+
+  //ds move the landmarks of the track
+  for (Landmark* landmark: _transient_landmarks) {
+    landmark->transform(world_previous_to_world_);
+  }
+  robot_to_world = world_previous_to_world_*robot_to_world;
+  ++_revision;
+}
+
+void WorldMap::_releaseTransientLandmarks() {
+  Index index_kept = 0;
+  bool is_released = false;
+  for (Landmark* landmark: _transient_landmarks) {
+    if (landmark->isReleased()) {
+
+      //ds removals do not move the remaining geometry: one removal revision per call (transient landmarks are in identifier order)
+      if (!is_released) {
+        _identifiers_removed_landmarks.clear();
+        ++_revision_removals;
+        is_released = true;
+      }
+      _identifiers_removed_landmarks.push_back(landmark->identifier());
+      _landmarks.erase(landmark->identifier());
+      _landmark_index.remove(landmark);
+      delete landmark;
+    } else {
+      _transient_landmarks[index_kept] = landmark;
+      ++index_kept;
+    }
+  }
+  _transient_landmarks.resize(index_kept);
+}
+
+void WorldMap::_reduceFrames() {
+
+  //ds move the oldest frames out of the window - stopping at the first frame still required for local map generation
+  while (_frames_with_full_data.size() > std::max(_parameters->number_of_frames_with_full_data, static_cast<Count>(2)) &&
+         !_isQueuedForLocalMap(_frames_with_full_data.front())) {
+    Frame* frame = _frames_with_full_data.front();
+    _frames_with_full_data.pop_front();
+
+    //ds keyframes keep their data (for relocalization and visualization) as long as the memory ceiling permits
+    if (frame->isKeyframe()) {
+      _keyframes_with_full_data.push_back(frame);
+      _memory_keyframes_with_full_data_bytes += frame->memoryUsageBytes();
+    } else {
+      frame->reduce();
+    }
+  }
+
+  //ds check memory ceiling
+  if (_parameters->maximum_frame_memory_megabytes <= 0) {
+    return;
+  }
+  const size_t maximum_memory_bytes = _parameters->maximum_frame_memory_megabytes*1e6;
+  size_t memory_window_bytes = 0;
+  for (const Frame* frame: _frames_with_full_data) {
+    memory_window_bytes += frame->memoryUsageBytes();
+  }
+
+  //ds reduce the oldest keyframes first
+  while (memory_window_bytes+_memory_keyframes_with_full_data_bytes > maximum_memory_bytes && !_keyframes_with_full_data.empty()) {
+    Frame* keyframe = _keyframes_with_full_data.front();
+    _keyframes_with_full_data.pop_front();
+    _memory_keyframes_with_full_data_bytes -= std::min(keyframe->memoryUsageBytes(), _memory_keyframes_with_full_data_bytes);
+    keyframe->reduce();
+  }
+
+  //ds shrink the window if still exceeding the ceiling (required frames excluded)
+  while (memory_window_bytes > maximum_memory_bytes &&
+         _frames_with_full_data.size() > 2    &&
+         !_isQueuedForLocalMap(_frames_with_full_data.front())) {
+    Frame* frame = _frames_with_full_data.front();
+    _frames_with_full_data.pop_front();
+    memory_window_bytes -= std::min(frame->memoryUsageBytes(), memory_window_bytes);
+    frame->reduce();
+  }
+  if (memory_window_bytes+_memory_keyframes_with_full_data_bytes > maximum_memory_bytes) {
+    LOG_WARNING(std::cerr << "WorldMap::_reduceFrames|unable to meet frame memory ceiling (MB): " << _parameters->maximum_frame_memory_megabytes
+                          << " current (MB): " << (memory_window_bytes+_memory_keyframes_with_full_data_bytes)/1e6
+                          << " (frames required for local map generation: " << _frame_queue_for_local_map.size() << ")" << std::endl)
+  }
+}
+
+void WorldMap::getMemoryUsage(MemoryUsage& memory_usage_, const bool& include_appearances_) const {
+  memory_usage_.frames += sizeof(WorldMap)+_frames.size()*(sizeof(FramePointerMapElement)+sizeof(bool));
+  for (const FramePointerMapElement& frame: _frames) {
+    frame.second->getMemoryUsage(memory_usage_.frames, memory_usage_.images, memory_usage_.framepoints);
+  }
+  memory_usage_.landmarks += _landmarks.size()*(sizeof(LandmarkPointerMapElement)+sizeof(bool))+_landmark_index.memoryUsageBytes();
+  for (const LandmarkPointerMapElement& landmark: _landmarks) {
+    memory_usage_.landmarks += landmark.second->memoryUsageBytes();
+    if (include_appearances_) {
+      memory_usage_.appearances += landmark.second->appearancesMemoryUsageBytes();
+    }
+  }
+  for (const Landmark* landmark: _transient_landmarks) {
+    memory_usage_.landmarks += sizeof(Landmark*)+landmark->memoryUsageBytes();
+  }
+  memory_usage_.local_maps += _local_maps.capacity()*sizeof(LocalMap*);
+  for (const LocalMap* local_map: _local_maps) {
+    memory_usage_.local_maps += local_map->memoryUsageBytes();
+    if (include_appearances_) {
+      memory_usage_.appearances += local_map->appearancesMemoryUsageBytes();
+    }
+  }
+}
+
 void WorldMap::writeTrajectoryKITTI(const std::string& filename_) const {
 
   //ds construct filename
@@ -189,8 +479,8 @@ void WorldMap::writeTrajectoryKITTI(const std::string& filename_) const {
   //ds for each frame (assuming continuous, sequential indexing)
   for (const FramePointerMapElement frame: _frames) {
 
-    //ds buffer transform
-    const TransformMatrix3D& robot_to_world = frame.second->robotToWorld();
+    //ds buffer transform (output is always written in double precision)
+    const Eigen::Isometry3d robot_to_world(frame.second->robotToWorld().cast<double>());
 
     //ds dump transform according to KITTI format
     for (uint8_t u = 0; u < 3; ++u) {
@@ -225,9 +515,9 @@ void WorldMap::writeTrajectoryTUM(const std::string& filename_) const {
   //ds for each frame (assuming continuous, sequential indexing)
   for (const FramePointerMapElement frame: _frames) {
 
-    //ds buffer transform
-    const TransformMatrix3D& robot_to_world = frame.second->robotToWorld();
-    const Quaternion orientation = Quaternion(robot_to_world.linear());
+    //ds buffer transform (output is always written in double precision)
+    const Eigen::Isometry3d robot_to_world(frame.second->robotToWorld().cast<double>());
+    const Eigen::Quaterniond orientation(robot_to_world.linear());
 
     //ds dump transform according to TUM format
     outfile_trajectory << frame.second->timestampImageLeftSeconds() << " ";
@@ -244,6 +534,402 @@ void WorldMap::writeTrajectoryTUM(const std::string& filename_) const {
   LOG_INFO(std::cerr << "WorldMap::WorldMap|saved trajectory (TUM format) to: " << filename_tum << std::endl)
 }
 
+void WorldMap::writeMap(const std::string& file_name_) const {
+  LOG_INFO(std::cerr << "WorldMap::writeMap|saving map to file: " << file_name_ << std::endl)
+  const double time_begin_seconds = srrg_core::getTime();
+
+  //ds index all objects in storage order (references are stored as section indices)
+  std::unordered_map<const Frame*, uint64_t> frame_indices;
+  frame_indices.reserve(_frames.size());
+  for (const FramePointerMapElement& frame: _frames) {
+    frame_indices.insert(std::make_pair(frame.second, frame_indices.size()));
+  }
+  std::unordered_map<const Landmark*, uint64_t> landmark_indices;
+  landmark_indices.reserve(_landmarks.size());
+  for (const LandmarkPointerMapElement& landmark: _landmarks) {
+    landmark_indices.insert(std::make_pair(landmark.second, landmark_indices.size()));
+  }
+  std::unordered_map<const LocalMap*, uint64_t> local_map_indices;
+  std::unordered_map<Identifier, uint64_t> local_map_indices_by_identifier;
+  local_map_indices.reserve(_local_maps.size());
+  local_map_indices_by_identifier.reserve(_local_maps.size());
+  for (const LocalMap* local_map: _local_maps) {
+    local_map_indices_by_identifier.insert(std::make_pair(local_map->identifier(), local_map_indices.size()));
+    local_map_indices.insert(std::make_pair(local_map, local_map_indices.size()));
+  }
+
+  //ds frames
+  std::vector<map_file::FrameRecord> frame_records(_frames.size());
+  for (const FramePointerMapElement& frame: _frames) {
+    map_file::FrameRecord& record = frame_records[frame_indices.at(frame.second)];
+    std::memset(&record, 0, sizeof(record));
+    record.index_previous               = map_file::getIndex(frame_indices, frame.second->previous());
+    record.index_root                   = map_file::getIndex(frame_indices, frame.second->root());
+    record.index_local_map              = map_file::getIndex(local_map_indices, frame.second->localMap());
+    record.timestamp_image_left_seconds = frame.second->timestampImageLeftSeconds();
+    record.status                       = frame.second->status();
+    record.is_keyframe                  = frame.second->isKeyframe();
+    record.is_track_broken              = frame.second->isTrackBroken();
+    map_file::setTransform(frame.second->robotToWorld(), record.robot_to_world);
+    map_file::setTransform(frame.second->frameToLocalMap(), record.frame_to_local_map);
+  }
+
+  //ds landmarks
+  std::vector<map_file::LandmarkRecord> landmark_records(_landmarks.size());
+  for (const LandmarkPointerMapElement& landmark: _landmarks) {
+    map_file::LandmarkRecord& record = landmark_records[landmark_indices.at(landmark.second)];
+    for (uint32_t u = 0; u < 3; ++u) {
+      record.world_coordinates[u] = landmark.second->coordinates()(u);
+    }
+    record.number_of_updates    = landmark.second->numberOfUpdates();
+    record.number_of_recoveries = landmark.second->numberOfRecoveries();
+  }
+
+  //ds landmark appearances grouped by the local map they have been captured in
+  std::vector<std::vector<map_file::AppearanceRecord>> appearance_records_per_local_map(_local_maps.size());
+  for (const LandmarkPointerMapElement& landmark: _landmarks) {
+    for (const Landmark::HBSTMatchableMemoryMap::value_type& appearance: landmark.second->appearances()) {
+      //ds local map identifiers are not positions in _local_maps (removed local maps, cleared or merged maps)
+      const std::unordered_map<Identifier, uint64_t>::const_iterator iterator_local_map = local_map_indices_by_identifier.find(appearance.second.local_map_identifier);
+      if (iterator_local_map == local_map_indices_by_identifier.end()) {
+        LOG_ERROR(std::cerr << "WorldMap::writeMap|appearance of landmark ID: " << landmark.first
+                            << " references unknown local map ID: " << appearance.second.local_map_identifier << std::endl)
+        throw std::runtime_error("WorldMap::writeMap|appearance references an unknown local map");
+      }
+      map_file::AppearanceRecord record;
+      std::memset(&record, 0, sizeof(record));
+      record.index_landmark = landmark_indices.at(landmark.second);
+      for (uint32_t bit = 0; bit < SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS; ++bit) {
+        record.descriptor[bit/8] |= appearance.second.matchable->descriptor[bit] << bit%8;
+      }
+      appearance_records_per_local_map[iterator_local_map->second].push_back(record);
+    }
+  }
+
+  //ds local maps with their frames, landmark states, appearances and closures
+  std::vector<map_file::LocalMapRecord> local_map_records(_local_maps.size());
+  std::vector<uint64_t> local_map_frame_records;
+  std::vector<map_file::LandmarkStateRecord> landmark_state_records;
+  std::vector<map_file::AppearanceRecord> appearance_records;
+  std::vector<map_file::ClosureRecord> closure_records;
+  for (LocalMap* local_map: _local_maps) {
+    const uint64_t index_local_map = local_map_indices.at(local_map);
+    map_file::LocalMapRecord& record = local_map_records[index_local_map];
+    map_file::setTransform(local_map->localMapToWorld(), record.local_map_to_world);
+    record.index_root     = map_file::getIndex(local_map_indices, local_map->root());
+    record.index_previous = map_file::getIndex(local_map_indices, local_map->previous());
+    record.index_keyframe = map_file::getIndex(frame_indices, local_map->keyframe());
+
+    record.begin_frames = local_map_frame_records.size();
+    for (const Frame* frame: local_map->frames()) {
+      local_map_frame_records.push_back(frame_indices.at(frame));
+    }
+    record.number_of_frames = local_map_frame_records.size()-record.begin_frames;
+
+    record.begin_landmark_states = landmark_state_records.size();
+    for (const LocalMap::LandmarkStateMapElement& landmark_state: local_map->landmarks()) {
+      const uint64_t index_landmark = map_file::getIndex(landmark_indices, landmark_state.second.landmark);
+      if (index_landmark == map_file::invalid_index) {
+        LOG_WARNING(std::cerr << "WorldMap::writeMap|skipping unknown landmark in local map: " << local_map->identifier() << std::endl)
+        continue;
+      }
+      map_file::LandmarkStateRecord record_landmark_state;
+      record_landmark_state.index_landmark = index_landmark;
+      for (uint32_t u = 0; u < 3; ++u) {
+        record_landmark_state.coordinates_in_local_map[u] = landmark_state.second.coordinates_in_local_map(u);
+      }
+      landmark_state_records.push_back(record_landmark_state);
+    }
+    record.number_of_landmark_states = landmark_state_records.size()-record.begin_landmark_states;
+
+    record.begin_appearances = appearance_records.size();
+    appearance_records.insert(appearance_records.end(),
+                              appearance_records_per_local_map[index_local_map].begin(),
+                              appearance_records_per_local_map[index_local_map].end());
+    record.number_of_appearances = appearance_records.size()-record.begin_appearances;
+
+    record.begin_closures = closure_records.size();
+    for (const LocalMap::ClosureConstraint& closure: local_map->closures()) {
+      map_file::ClosureRecord record_closure;
+      record_closure.index_reference = map_file::getIndex(local_map_indices, closure.local_map);
+      record_closure.omega           = closure.omega;
+      map_file::setTransform(closure.relation, record_closure.relation);
+      closure_records.push_back(record_closure);
+    }
+    record.number_of_closures = closure_records.size()-record.begin_closures;
+  }
+
+  //ds assemble header with section layout
+  map_file::Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, map_file::magic, sizeof(header.magic));
+  header.version                    = map_file::version;
+  header.descriptor_size_bits       = SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS;
+  header.number_of_frames           = frame_records.size();
+  header.number_of_landmarks        = landmark_records.size();
+  header.number_of_local_maps       = local_map_records.size();
+  header.number_of_local_map_frames = local_map_frame_records.size();
+  header.number_of_landmark_states  = landmark_state_records.size();
+  header.number_of_appearances      = appearance_records.size();
+  header.number_of_closures         = closure_records.size();
+  header.offset_frames              = sizeof(header);
+  header.offset_landmarks           = header.offset_frames+frame_records.size()*sizeof(map_file::FrameRecord);
+  header.offset_local_maps          = header.offset_landmarks+landmark_records.size()*sizeof(map_file::LandmarkRecord);
+  header.offset_local_map_frames    = header.offset_local_maps+local_map_records.size()*sizeof(map_file::LocalMapRecord);
+  header.offset_landmark_states     = header.offset_local_map_frames+local_map_frame_records.size()*sizeof(uint64_t);
+  header.offset_appearances         = header.offset_landmark_states+landmark_state_records.size()*sizeof(map_file::LandmarkStateRecord);
+  header.offset_closures            = header.offset_appearances+appearance_records.size()*sizeof(map_file::AppearanceRecord);
+  header.file_size_bytes            = header.offset_closures+closure_records.size()*sizeof(map_file::ClosureRecord);
+
+  //ds write sections in layout order
+  std::ofstream outfile_map(file_name_, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!outfile_map.good()) {
+    throw std::runtime_error("WorldMap::writeMap|unable to open file: "+file_name_);
+  }
+  outfile_map.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  map_file::writeSection(outfile_map, frame_records);
+  map_file::writeSection(outfile_map, landmark_records);
+  map_file::writeSection(outfile_map, local_map_records);
+  map_file::writeSection(outfile_map, local_map_frame_records);
+  map_file::writeSection(outfile_map, landmark_state_records);
+  map_file::writeSection(outfile_map, appearance_records);
+  map_file::writeSection(outfile_map, closure_records);
+  outfile_map.close();
+  if (!outfile_map.good()) {
+    throw std::runtime_error("WorldMap::writeMap|unable to write file: "+file_name_);
+  }
+  LOG_INFO(std::cerr << "WorldMap::writeMap|saved frames: " << header.number_of_frames
+                     << " landmarks: " << header.number_of_landmarks
+                     << " local maps: " << header.number_of_local_maps
+                     << " appearances: " << header.number_of_appearances
+                     << " (" << header.file_size_bytes/1e6 << " MB, duration (s): " << srrg_core::getTime()-time_begin_seconds << ")" << std::endl)
+}
+
+void WorldMap::readMap(const std::string& file_name_, const Camera* camera_left_, const Camera* camera_right_) {
+  LOG_INFO(std::cerr << "WorldMap::readMap|loading map from file: " << file_name_ << std::endl)
+  const double time_begin_seconds = srrg_core::getTime();
+  if (_current_frame) {
+    throw std::runtime_error("WorldMap::readMap|map files can only be loaded before tracking");
+  }
+
+  //ds additional maps are appended as separate tracks (local map references in the file are relative to the first loaded local map)
+  const uint64_t offset_local_maps = _local_maps.size();
+
+  //ds map the complete file read-only
+  const int32_t file_descriptor = open(file_name_.c_str(), O_RDONLY);
+  if (file_descriptor < 0) {
+    throw std::runtime_error("WorldMap::readMap|unable to open file: "+file_name_);
+  }
+  struct stat file_status;
+  if (fstat(file_descriptor, &file_status) != 0 || static_cast<size_t>(file_status.st_size) < sizeof(map_file::Header)) {
+    close(file_descriptor);
+    throw std::runtime_error("WorldMap::readMap|invalid file: "+file_name_);
+  }
+  const size_t file_size_bytes = file_status.st_size;
+  void* file_memory = mmap(nullptr, file_size_bytes, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+  close(file_descriptor);
+  if (file_memory == MAP_FAILED) {
+    throw std::runtime_error("WorldMap::readMap|unable to map file: "+file_name_);
+  }
+  const char* data = static_cast<const char*>(file_memory);
+
+  //ds validate header and section layout
+  const map_file::Header& header = *reinterpret_cast<const map_file::Header*>(data);
+  auto is_section_valid = [&header](const uint64_t& offset_, const uint64_t& number_of_records_, const uint64_t& record_size_bytes_) {
+    return (offset_%8 == 0 && offset_ <= header.file_size_bytes && number_of_records_ <= (header.file_size_bytes-offset_)/record_size_bytes_);
+  };
+  std::string error_message;
+  if (std::memcmp(header.magic, map_file::magic, sizeof(header.magic)) != 0) {
+    error_message = "not a map file";
+  } else if (header.version != map_file::version) {
+    error_message = "unsupported map file version: "+std::to_string(header.version)+" (expected: "+std::to_string(map_file::version)+")";
+  } else if (header.descriptor_size_bits != SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS) {
+    error_message = "incompatible descriptor size (bits): "+std::to_string(header.descriptor_size_bits)+" (expected: "+std::to_string(SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS)+")";
+  } else if (header.file_size_bytes != file_size_bytes                                                                               ||
+             !is_section_valid(header.offset_frames, header.number_of_frames, sizeof(map_file::FrameRecord))                         ||
+             !is_section_valid(header.offset_landmarks, header.number_of_landmarks, sizeof(map_file::LandmarkRecord))                ||
+             !is_section_valid(header.offset_local_maps, header.number_of_local_maps, sizeof(map_file::LocalMapRecord))              ||
+             !is_section_valid(header.offset_local_map_frames, header.number_of_local_map_frames, sizeof(uint64_t))                  ||
+             !is_section_valid(header.offset_landmark_states, header.number_of_landmark_states, sizeof(map_file::LandmarkStateRecord)) ||
+             !is_section_valid(header.offset_appearances, header.number_of_appearances, sizeof(map_file::AppearanceRecord))          ||
+             !is_section_valid(header.offset_closures, header.number_of_closures, sizeof(map_file::ClosureRecord))) {
+    error_message = "corrupted file (truncated or invalid section layout)";
+  }
+  if (!error_message.empty()) {
+    munmap(file_memory, file_size_bytes);
+    throw std::runtime_error("WorldMap::readMap|"+error_message+": "+file_name_);
+  }
+  const map_file::FrameRecord* frame_records                 = reinterpret_cast<const map_file::FrameRecord*>(data+header.offset_frames);
+  const map_file::LandmarkRecord* landmark_records           = reinterpret_cast<const map_file::LandmarkRecord*>(data+header.offset_landmarks);
+  const map_file::LocalMapRecord* local_map_records          = reinterpret_cast<const map_file::LocalMapRecord*>(data+header.offset_local_maps);
+  const uint64_t* local_map_frame_records                    = reinterpret_cast<const uint64_t*>(data+header.offset_local_map_frames);
+  const map_file::LandmarkStateRecord* landmark_state_records = reinterpret_cast<const map_file::LandmarkStateRecord*>(data+header.offset_landmark_states);
+  const map_file::AppearanceRecord* appearance_records       = reinterpret_cast<const map_file::AppearanceRecord*>(data+header.offset_appearances);
+  const map_file::ClosureRecord* closure_records             = reinterpret_cast<const map_file::ClosureRecord*>(data+header.offset_closures);
+
+  //ds references must point to preceding objects (or inside the sections for ranges), otherwise the file is rejected
+  //ds all references are validated before anything is allocated, a rejected file leaves the current (e.g. previously loaded) map untouched
+  auto are_references_valid = [&]() {
+    for (uint64_t index = 0; index < header.number_of_frames; ++index) {
+      const map_file::FrameRecord& record = frame_records[index];
+      if (!((record.index_previous == map_file::invalid_index || record.index_previous < index) &&
+            record.index_root <= index                                                          &&
+            (record.index_local_map == map_file::invalid_index || record.index_local_map < header.number_of_local_maps))) {
+        return false;
+      }
+    }
+    for (uint64_t index = 0; index < header.number_of_local_maps; ++index) {
+      const map_file::LocalMapRecord& record = local_map_records[index];
+      if (!(record.index_root <= index                                                              &&
+            (record.index_previous == map_file::invalid_index || record.index_previous < index)     &&
+            record.index_keyframe < header.number_of_frames                                         &&
+            record.begin_frames+record.number_of_frames <= header.number_of_local_map_frames        &&
+            record.begin_landmark_states+record.number_of_landmark_states <= header.number_of_landmark_states &&
+            record.begin_appearances+record.number_of_appearances <= header.number_of_appearances   &&
+            record.begin_closures+record.number_of_closures <= header.number_of_closures)) {
+        return false;
+      }
+      for (uint64_t u = record.begin_frames; u < record.begin_frames+record.number_of_frames; ++u) {
+        if (local_map_frame_records[u] >= header.number_of_frames) {return false;}
+      }
+      for (uint64_t u = record.begin_landmark_states; u < record.begin_landmark_states+record.number_of_landmark_states; ++u) {
+        if (landmark_state_records[u].index_landmark >= header.number_of_landmarks) {return false;}
+      }
+      for (uint64_t u = record.begin_appearances; u < record.begin_appearances+record.number_of_appearances; ++u) {
+        if (appearance_records[u].index_landmark >= header.number_of_landmarks) {return false;}
+      }
+      for (uint64_t u = record.begin_closures; u < record.begin_closures+record.number_of_closures; ++u) {
+        if (closure_records[u].index_reference >= index) {return false;}
+      }
+    }
+    return true;
+  };
+  if (!are_references_valid()) {
+    munmap(file_memory, file_size_bytes);
+    throw std::runtime_error("WorldMap::readMap|corrupted file (invalid reference): "+file_name_);
+  }
+
+  //ds landmarks
+  std::vector<Landmark*> landmarks(header.number_of_landmarks);
+  _landmarks.reserve(header.number_of_landmarks);
+  for (uint64_t index = 0; index < header.number_of_landmarks; ++index) {
+    const map_file::LandmarkRecord& record = landmark_records[index];
+    Landmark* landmark = new Landmark(_identifier_next_landmark++,
+                                      PointCoordinates(record.world_coordinates[0], record.world_coordinates[1], record.world_coordinates[2]),
+                                      record.number_of_updates,
+                                      _parameters->landmark);
+    landmark->setNumberOfRecoveries(record.number_of_recoveries);
+    _landmarks.insert(std::make_pair(landmark->identifier(), landmark));
+    landmarks[index] = landmark;
+  }
+
+  //ds frames (without framepoints)
+  std::vector<Frame*> frames(header.number_of_frames);
+  _frames.reserve(header.number_of_frames);
+  for (uint64_t index = 0; index < header.number_of_frames; ++index) {
+    const map_file::FrameRecord& record = frame_records[index];
+    Frame* previous = (record.index_previous != map_file::invalid_index)? frames[record.index_previous]: nullptr;
+    Frame* frame    = new Frame(_identifier_next_frame++, this, previous, nullptr, TransformMatrix3D::Identity(), record.timestamp_image_left_seconds);
+    frame->setCameraLeft(camera_left_);
+    frame->setCameraRight(camera_right_);
+    frame->setRobotToWorld(map_file::getTransform(record.robot_to_world));
+    frame->setRoot((record.index_root == index)? frame: frames[record.index_root]);
+    frame->setStatus(static_cast<Frame::Status>(record.status));
+    frame->setIsKeyframe(record.is_keyframe);
+    frame->_is_track_broken = record.is_track_broken;
+    frame->_is_reduced      = true;
+    if (previous) {
+      previous->setNext(frame);
+    }
+    _frames.insert(std::make_pair(frame->identifier(), frame));
+    frames[index] = frame;
+  }
+
+  //ds local maps
+  _local_maps.reserve(offset_local_maps+header.number_of_local_maps);
+  for (uint64_t index = 0; index < header.number_of_local_maps; ++index) {
+    const map_file::LocalMapRecord& record = local_map_records[index];
+    LocalMap* root     = (record.index_root < index)? _local_maps[offset_local_maps+record.index_root]: nullptr;
+    LocalMap* previous = (record.index_previous != map_file::invalid_index)? _local_maps[offset_local_maps+record.index_previous]: nullptr;
+    LocalMap* local_map = new LocalMap(_identifier_next_local_map++, map_file::getTransform(record.local_map_to_world), _parameters->local_map, root, previous);
+    if (!root) {
+      local_map->setRoot(local_map);
+    }
+    _local_maps.push_back(local_map);
+
+    //ds frames and keyframe
+    local_map->_frames.reserve(record.number_of_frames);
+    for (uint64_t u = record.begin_frames; u < record.begin_frames+record.number_of_frames; ++u) {
+      local_map->_frames.push_back(frames[local_map_frame_records[u]]);
+    }
+    local_map->_keyframe = frames[record.index_keyframe];
+
+    //ds landmark snapshots
+    local_map->_landmarks.reserve(record.number_of_landmark_states);
+    for (uint64_t u = record.begin_landmark_states; u < record.begin_landmark_states+record.number_of_landmark_states; ++u) {
+      const map_file::LandmarkStateRecord& record_landmark_state = landmark_state_records[u];
+      Landmark* landmark = landmarks[record_landmark_state.index_landmark];
+      const PointCoordinates coordinates_in_local_map(record_landmark_state.coordinates_in_local_map[0],
+                                                      record_landmark_state.coordinates_in_local_map[1],
+                                                      record_landmark_state.coordinates_in_local_map[2]);
+      local_map->_landmarks.insert(std::make_pair(landmark->identifier(), LocalMap::LandmarkState(landmark, coordinates_in_local_map)));
+      landmark->_local_maps.insert(local_map);
+    }
+
+    //ds appearances (consumed by the place database like the appearances of a new local map)
+    local_map->_appearances.reserve(record.number_of_appearances);
+    for (uint64_t u = record.begin_appearances; u < record.begin_appearances+record.number_of_appearances; ++u) {
+      const map_file::AppearanceRecord& record_appearance = appearance_records[u];
+      Landmark* landmark = landmarks[record_appearance.index_landmark];
+      HBSTMatchable::Descriptor descriptor;
+      for (uint32_t bit = 0; bit < SRRG_PROSLAM_DESCRIPTOR_SIZE_BITS; ++bit) {
+        descriptor[bit] = (record_appearance.descriptor[bit/8] >> bit%8) & 1;
+      }
+      HBSTMatchable* matchable = new HBSTMatchable(landmark, descriptor, local_map->identifier());
+      landmark->_appearance_map.insert(std::make_pair(matchable, Landmark::Appearance(matchable, local_map->identifier())));
+      local_map->_appearances.push_back(matchable);
+    }
+
+    //ds closures (references are always preceding local maps)
+    for (uint64_t u = record.begin_closures; u < record.begin_closures+record.number_of_closures; ++u) {
+      const map_file::ClosureRecord& record_closure = closure_records[u];
+      local_map->addCorrespondence(_local_maps[offset_local_maps+record_closure.index_reference],
+                                   map_file::getTransform(record_closure.relation),
+                                   Closure::CorrespondencePointerVector(),
+                                   record_closure.omega);
+    }
+  }
+
+  //ds link frames to their local maps
+  for (uint64_t index = 0; index < header.number_of_frames; ++index) {
+    const map_file::FrameRecord& record = frame_records[index];
+    if (record.index_local_map != map_file::invalid_index) {
+      frames[index]->setLocalMap(_local_maps[offset_local_maps+record.index_local_map]);
+      frames[index]->setFrameToLocalMap(map_file::getTransform(record.frame_to_local_map));
+    }
+  }
+  munmap(file_memory, file_size_bytes);
+
+  //ds continue as after a track break: new frames start a new track, which is connected to the loaded one at the first closure
+  if (!frames.empty()) {
+    _last_frame_before_track_break = frames.back();
+    setRobotToWorld(frames.back()->robotToWorld());
+  }
+  if (_local_maps.size() > offset_local_maps) {
+    _last_local_map_before_track_break = _local_maps.back();
+    _current_local_map                 = _local_maps.back();
+  }
+  _root_frame     = nullptr;
+  _current_frame  = nullptr;
+  _previous_frame = nullptr;
+  _root_local_map = nullptr;
+  LOG_INFO(std::cerr << "WorldMap::readMap|loaded frames: " << _frames.size()
+                     << " landmarks: " << _landmarks.size()
+                     << " local maps: " << _local_maps.size()
+                     << " appearances: " << header.number_of_appearances
+                     << " (duration (s): " << srrg_core::getTime()-time_begin_seconds << ")" << std::endl)
+}
+
 void WorldMap::breakTrack(Frame* frame_) {
 
   //ds if the track is not already broken
@@ -268,7 +954,7 @@ void WorldMap::breakTrack(Frame* frame_) {
 void WorldMap::setTrack(Frame* frame_) {
   assert(frame_->localMap());
   assert(_last_local_map_before_track_break);
-  LOG_INFO(std::printf("WorldMap::setTrack|RELOCALIZED - connecting [Frame] < [LocalMap]: [%06lu] < [%06lu] with [%06lu] < [%06lu]\n",
+  LOG_INFO(Logger::print("WorldMap::setTrack|RELOCALIZED - connecting [Frame] < [LocalMap]: [%06lu] < [%06lu] with [%06lu] < [%06lu]\n",
               _last_frame_before_track_break->identifier(), _last_local_map_before_track_break->identifier(), frame_->identifier(), frame_->localMap()->identifier()))
 
   //ds return to original roots
@@ -292,6 +978,9 @@ void WorldMap::setTrack(Frame* frame_) {
 void WorldMap::mergeLandmarks(const LocalMap::ClosureConstraintVector& closures_) {
   CHRONOMETER_START(landmark_merging)
 
+  //ds an index that is up to date is kept up to date incrementally (absorbed landmarks are removed, references re-binned)
+  const bool is_landmark_index_current = (_revision_landmark_index == _revision);
+
   //ds keep track of the best merged references
   //ds we need to do this since we're processing multiple closures here,
   //ds which possibly contain different query-reference correspondences
@@ -368,6 +1057,9 @@ void WorldMap::mergeLandmarks(const LocalMap::ClosureConstraintVector& closures_
   //ds map of merged landmark identfiers in case of multi-merges
   std::map<Identifier, Identifier> merged_landmark_identifiers;
 
+  //ds local maps whose landmark states were replaced (compacted once merging is complete)
+  std::set<LocalMap*> local_maps_merged;
+
   //ds for each entry: <query, reference>
   for (const std::pair<Identifier, std::pair<Identifier, Count>>& pair: landmark_queries_to_references_filtered) {
     Landmark* landmark_query     = nullptr;
@@ -379,7 +1071,7 @@ void WorldMap::mergeLandmarks(const LocalMap::ClosureConstraintVector& closures_
     } catch (const std::out_of_range& /*ex*/) {
 
       //ds this means the query has already been merged, we skip further processing
-      LOG_WARNING(std::cerr << "WorldMap::mergeLandmarks|already merged landmark ID: " << landmark_query->identifier() << std::endl)
+      LOG_WARNING(std::cerr << "WorldMap::mergeLandmarks|already merged landmark ID: " << pair.first << std::endl)
       continue;
     }
 
@@ -426,6 +1118,7 @@ void WorldMap::mergeLandmarks(const LocalMap::ClosureConstraintVector& closures_
 
     //ds perform merge (does not free landmark memory)
     landmark_reference->merge(landmark_query);
+    local_maps_merged.insert(landmark_reference->_local_maps.begin(), landmark_reference->_local_maps.end());
 
     //ds update bookkeeping and free absorbed landmark
     merged_landmark_identifiers.insert(std::make_pair(landmark_query->identifier(), landmark_reference->identifier()));
@@ -436,11 +1129,29 @@ void WorldMap::mergeLandmarks(const LocalMap::ClosureConstraintVector& closures_
     } else {
 
       //ds free landmark memory
+      _landmark_index.remove(landmark_query);
       delete landmark_query;
     }
+    _landmark_index.update(landmark_reference);
   }
   LOG_DEBUG(std::cerr << "WorldMap::mergeLandmarks|merged landmarks: " << merged_landmark_identifiers.size() << std::endl)
   _number_of_merged_landmarks += merged_landmark_identifiers.size();
+
+  //ds reclaim the storage of erased landmarks - no iteration over the landmark maps is in progress here
+  if (_landmarks.isSparse()) {
+    _landmarks.compact();
+  }
+  for (LocalMap* local_map: local_maps_merged) {
+    if (local_map->_landmarks.isSparse()) {
+      local_map->_landmarks.compact();
+    }
+  }
+  if (!merged_landmark_identifiers.empty()) {
+    ++_revision;
+    if (is_landmark_index_current) {
+      _revision_landmark_index = _revision;
+    }
+  }
   CHRONOMETER_STOP(landmark_merging)
 }
 }
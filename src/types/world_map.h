@@ -1,5 +1,8 @@
 #pragma once
+#include <deque>
 #include "local_map.h"
+#include "landmark_index.h"
+#include "memory_usage.h"
 
 namespace proslam {
 
@@ -35,6 +38,13 @@ public:
   //ds resets the window for the local map generation
   void resetWindowForLocalMapCreation(const bool& drop_framepoints_ = false);
 
+  //! @brief removes the current local map without a trace, freeing its appearances (e.g. after it served as relocalization query in localization only mode)
+  void removeCurrentLocalMap();
+
+  //! @brief moves the current track (frames with full data and transient landmarks) into another coordinate frame
+  //! @param[in] world_previous_to_world_ transform from the current estimate into the world map coordinate frame (e.g. obtained by a loop closure)
+  void anchorTrack(const TransformMatrix3D& world_previous_to_world_);
+
   //! @brief adds a loop closure constraint between 2 local maps
   //! @param[in] query_ query local map
   //! @param[in] reference_ reference local map (fixed, closed against)
@@ -47,6 +57,12 @@ public:
                       const Closure::CorrespondencePointerVector& landmark_correspondences_,
                       const real& information_ = 1);
 
+  //! @brief moves a complete track (frames, local maps and landmarks) into the coordinate frame of another track and re-roots it there
+  //! @param[in] query_ local map of the track to be moved
+  //! @param[in] reference_ local map of the track that is kept fixed
+  //! @param[in] query_to_reference_ query to reference transform (e.g. obtained by a loop closure)
+  void mergeTracks(LocalMap* query_, const LocalMap* reference_, const TransformMatrix3D& query_to_reference_);
+
   //! @brief dump trajectory to file (in KITTI benchmark format: 4x4 isometries per line and TUM benchmark format: timestamp x z y and qx qy qz qw per line)
   //! @param[in] filename_ text file in which the poses are saved to
   void writeTrajectoryKITTI(const std::string& filename_ = "") const;
@@ -88,6 +104,20 @@ public:
     }
   }
 
+  //! @brief saves the map (frames, landmarks, local maps, closures and landmark appearances) to a binary map file
+  //! @param[in] file_name_ map file name
+  //! @throws std::runtime_error if the file cannot be written
+  void writeMap(const std::string& file_name_) const;
+
+  //! @brief loads a binary map file into this world map, tracking continues as after a track break from the last loaded frame
+  //! @brief maps loaded into a non-empty world map are appended as separate tracks (merged on the first closure between them)
+  //! @brief the file is memory-mapped and all structures are built in a single pass, loaded frames carry no framepoints (reduced)
+  //! @param[in] file_name_ map file name
+  //! @param[in] camera_left_ left camera assigned to the loaded frames (optional)
+  //! @param[in] camera_right_ right camera assigned to the loaded frames (optional)
+  //! @throws std::runtime_error if the file cannot be read or is not compatible (the current map is left untouched)
+  void readMap(const std::string& file_name_, const Camera* camera_left_ = nullptr, const Camera* camera_right_ = nullptr);
+
   //! @brief this function does what you think it does
   //! @param[in] frame_ frame at which the track was broken
   void breakTrack(Frame* frame_);
@@ -111,6 +141,14 @@ public:
   const LandmarkPointerVector& currentlyTrackedLandmarks() const {return _currently_tracked_landmarks;}
   void mergeLandmarks(const LocalMap::ClosureConstraintVector& closures_);
 
+  //! @brief spatial landmark index (disabled if landmark_index_voxel_size_meters is 0), see updateLandmarkIndex
+  LandmarkIndex& landmarkIndex() {return _landmark_index;}
+  const LandmarkIndex& landmarkIndex() const {return _landmark_index;}
+
+  //! @brief brings the spatial landmark index up to date: rebuilt completely if the map geometry changed (see revision),
+  //! @brief otherwise the currently tracked landmarks (updated by tracking) are re-binned if they moved
+  void updateLandmarkIndex();
+
   LocalMap* currentLocalMap() {return _current_local_map;}
   const LocalMapPointerVector& localMaps() const {return _local_maps;}
 
@@ -120,6 +158,7 @@ public:
   const bool relocalized() const {return _relocalized;}
   const Count& numberOfClosures() const {return _number_of_closures;}
   const Count& numberOfMergedLandmarks() const {return _number_of_merged_landmarks;}
+  const Count& numberOfMergedTracks() const {return _number_of_merged_tracks;}
 
   //ds visualization only
   const FramePointerMap& frames() const {return _frames;}
@@ -128,14 +167,56 @@ public:
 
   const WorldMapParameters* parameters() const {return _parameters;}
 
+  //! @brief localization only mode: landmarks created from now on are transient and are freed once they are no longer referenced
+  //! @brief frames are reduced as in sliding window mode (enforced with the minimum window if not configured)
+  void setIsLocalizationOnly(const bool& is_localization_only_) {_is_localization_only = is_localization_only_;}
+  const bool& isLocalizationOnly() const {return _is_localization_only;}
+
+  //! @brief enables the allocation of framepoint visualization data for all frames created afterwards (e.g. if an ImageViewer is active)
+  void setIsVisualizationDataEnabled(const bool& is_visualization_data_enabled_) {_is_visualization_data_enabled = is_visualization_data_enabled_;}
+  const bool& isVisualizationDataEnabled() const {return _is_visualization_data_enabled;}
+
+  //! @brief number of landmarks created in this map so far (= identifier of the next landmark)
+  const Identifier& numberOfCreatedLandmarks() const {return _identifier_next_landmark;}
+
+  //! @brief revision of the map geometry: increased whenever existing frames or landmarks are moved (optimization, merging, anchoring)
+  //! @brief appending frames and landmarks does not change the revision, consumers caching map data (e.g. the MapViewer) rebuild on a change
+  const Count& revision() const {return _revision;}
+  void increaseRevision() {++_revision;}
+
+  //! @brief revision of landmark removals that leave the remaining geometry untouched (released transient landmarks in localization only mode)
+  //! @brief increased once per removal, consumers caching map data can drop identifiersRemovedLandmarks() instead of rebuilding
+  const Count& revisionRemovals() const {return _revision_removals;}
+
+  //! @brief identifiers of the landmarks removed with the last increase of revisionRemovals() (ascending)
+  const std::vector<Identifier>& identifiersRemovedLandmarks() const {return _identifiers_removed_landmarks;}
+
+  //! @brief accumulates the estimated memory footprint of all frames, landmarks and local maps
+  //! @param[in,out] memory_usage_ frames, images, framepoints, landmarks, local_maps and appearances are incremented
+  //! @param[in] include_appearances_ appearances are modified by a running relocalization and have to be skipped meanwhile
+  void getMemoryUsage(MemoryUsage& memory_usage_, const bool& include_appearances_ = true) const;
+
 //ds helpers
 public:
 
   //ds obtain angular values from rotation matrix - used for the local map generation criteria in rotation
   static const Vector3 toOrientationRodrigues(const Matrix3& rotation_matrix_) {
-    cv::Vec<real, 3> rotation_angles;
-    cv::Rodrigues(srrg_core::toCv(rotation_matrix_), rotation_angles);
-    return srrg_core::fromCv(rotation_angles);
+    const Eigen::AngleAxis<real> rotation(rotation_matrix_);
+    return rotation.angle()*rotation.axis();
+  }
+
+protected:
+
+  //! @brief reduces the oldest frames that left the sliding window (and enforces the frame memory ceiling if set)
+  //! @brief frames still queued for local map generation and the last 2 frames are never reduced
+  void _reduceFrames();
+
+  //! @brief frees transient landmarks that are no longer referenced by any framepoint (localization only mode)
+  void _releaseTransientLandmarks();
+
+  //! @brief true if the frame is still required for the generation of the next local map
+  inline const bool _isQueuedForLocalMap(const Frame* frame_) const {
+    return (!_frame_queue_for_local_map.empty() && frame_->identifier() >= _frame_queue_for_local_map.front()->identifier());
   }
 
 protected:
@@ -172,9 +253,39 @@ protected:
   LocalMap* _last_local_map_before_track_break = nullptr;
   LocalMap* _root_local_map                    = nullptr;
 
+  //ds sliding window: frames with full data in creation order and keyframes that left the window (kept as long as the memory ceiling permits)
+  std::deque<Frame*> _frames_with_full_data;
+  std::deque<Frame*> _keyframes_with_full_data;
+  size_t _memory_keyframes_with_full_data_bytes = 0;
+
+  //ds localization only: landmarks created on top of the loaded map, freed once released by their frames
+  bool _is_localization_only = false;
+  LandmarkPointerVector _transient_landmarks;
+
+  //! @brief identifier generation for the map objects (per map instead of global, such that multiple maps can be processed concurrently)
+  Identifier _identifier_next_frame     = 0;
+  Identifier _identifier_next_landmark  = 0;
+  Identifier _identifier_next_local_map = 0;
+
+  //! @brief framepoint visualization data allocation switch
+  bool _is_visualization_data_enabled = false;
+
   //ds informative only
   CREATE_CHRONOMETER(landmark_merging)
+  CREATE_CHRONOMETER(local_map_generation)
   Count _number_of_merged_landmarks = 0;
+  Count _number_of_merged_tracks    = 0;
+
+  //! @brief map geometry revision (see revision())
+  Count _revision = 0;
+
+  //! @brief removal revision and the landmarks removed with its last increase (see revisionRemovals())
+  Count _revision_removals = 0;
+  std::vector<Identifier> _identifiers_removed_landmarks;
+
+  //! @brief spatial landmark index and the map geometry revision it has been built for
+  LandmarkIndex _landmark_index;
+  Count _revision_landmark_index = 0;
 
 private:
 
@@ -1,11 +1,12 @@
 #include "image_viewer.h"
 
+#include <algorithm>
+#include "srrg_system_utils/system_utils.h"
 #include "types/landmark.h"
 
 namespace proslam {
 
-ImageViewer::ImageViewer(ImageViewerParameters* parameters_): _parameters(parameters_),
-                                                              _current_frame(0) {
+ImageViewer::ImageViewer(ImageViewerParameters* parameters_): _parameters(parameters_) {
   LOG_DEBUG(std::cerr << "ImageViewer::ImageViewer|constructed" << std::endl)
 }
 
@@ -19,34 +20,77 @@ void ImageViewer::configure() {
 
 void ImageViewer::update(const Frame* frame_) {
 
-  //ds start data transfer (this will lock the calling thread if the GUI is busy) - released when the function is quit
-  std::lock_guard<std::mutex> lock(_mutex_data_exchange);
-
-  //ds release previous image
-  _current_image.release();
-
-  //ds update handle
-  _current_frame = frame_;
-
-  //ds set current image
-  cv::cvtColor(frame_->intensityImageLeft(), _current_image, CV_GRAY2RGB);
+  //ds skip the frame if the refresh rate would be exceeded
+  if (_parameters->maximum_refresh_rate_hz > 0) {
+    const double time_seconds = srrg_core::getTime();
+    if (time_seconds-_time_last_snapshot_seconds < 1/_parameters->maximum_refresh_rate_hz) {
+      return;
+    }
+    _time_last_snapshot_seconds = time_seconds;
+  }
 
-  //ds buffer secondary image (if existing and desired)
-  if (!_current_image_secondary.empty()                                         &&
-      _parameters->tracker_mode == CommandLineParameters::TrackerMode::RGB_DEPTH) {
+  //ds start data transfer (the GUI only locks for swapping the buffers) - released when the function is quit
+  std::lock_guard<std::mutex> lock(_mutex_data_exchange);
 
-    //ds upscale depth image to make it more visible
-    _current_image_secondary = frame_->intensityImageRight().clone()*5;
+  //ds share the images (frames do not modify their images after creation)
+  _snapshot_back.image = frame_->intensityImageLeft();
+  if (_parameters->tracker_mode == CommandLineParameters::TrackerMode::RGB_DEPTH) {
+    _snapshot_back.image_secondary = frame_->intensityImageRight();
   }
+  _snapshot_back.tracking_distance_pixels = frame_->projectionTrackingDistancePixels();
+
+  //ds copy the overlay data (framepoint links are modified by the processing thread)
+  _snapshot_back.points.clear();
+  _snapshot_back.points.reserve(frame_->points().size());
+  for (const FramePoint* point: frame_->points()) {
+    FramePointSnapshot point_snapshot;
+    point_snapshot.keypoint            = point->keypointLeft().pt;
+    point_snapshot.has_previous        = (point->previous() != nullptr);
+    point_snapshot.keypoint_previous   = (point_snapshot.has_previous)? point->previous()->keypointLeft().pt: cv::Point2f();
+    point_snapshot.projection_estimate = point->projectionEstimateLeft();
+    point_snapshot.track_length        = point->trackLength();
+    point_snapshot.has_landmark        = (point->landmark() != nullptr);
+    point_snapshot.is_in_loop_closure  = (point_snapshot.has_landmark                          &&
+                                         (point->landmark()->isInLoopClosureQuery()            ||
+                                          point->landmark()->isInLoopClosureReference()));
+    _snapshot_back.points.push_back(point_snapshot);
+  }
+  _is_snapshot_available = true;
 }
 
 void ImageViewer::draw() {
 
-  //ds lock data transfer while drawing
-  std::lock_guard<std::mutex> lock(_mutex_data_exchange);
+  //ds swap in the new snapshot (if any) - the rendering does not block updates
+  {
+    std::lock_guard<std::mutex> lock(_mutex_data_exchange);
+    if (_is_snapshot_available) {
+      std::swap(_snapshot_front, _snapshot_back);
+      _is_snapshot_available = false;
+
+      //ds release our references to the previously displayed frame images
+      _snapshot_back.image.release();
+      _snapshot_back.image_secondary.release();
+    } else {
+
+      //ds nothing new to render, keep the windows responsive
+      if (!_current_image.empty()) {
+        cv::waitKey(1);
+      }
+      return;
+    }
+  }
 
   //ds if a valid image is set
-  if (!_current_image.empty()) {
+  if (!_snapshot_front.image.empty()) {
+
+    //ds set current image - scaling the intensity image before the color conversion
+    if (_parameters->image_scale < 1) {
+      cv::Mat image_scaled;
+      cv::resize(_snapshot_front.image, image_scaled, cv::Size(), _parameters->image_scale, _parameters->image_scale, cv::INTER_AREA);
+      cv::cvtColor(image_scaled, _current_image, CV_GRAY2RGB);
+    } else {
+      cv::cvtColor(_snapshot_front.image, _current_image, CV_GRAY2RGB);
+    }
 
     //ds draw framepoints
     _drawPoints();
@@ -56,8 +100,11 @@ void ImageViewer::draw() {
 
     //ds display the image(s)
     cv::imshow(_parameters->window_title.c_str(), _current_image);
-    if (!_current_image_secondary.empty()                                         &&
-        _parameters->tracker_mode == CommandLineParameters::TrackerMode::RGB_DEPTH) {
+    if (!_snapshot_front.image_secondary.empty()) {
+
+      //ds upscale depth image to make it more visible
+      cv::resize(_snapshot_front.image_secondary, _current_image_secondary, cv::Size(), _parameters->image_scale, _parameters->image_scale, cv::INTER_NEAREST);
+      _current_image_secondary *= 5;
       cv::imshow(_parameters->window_title_secondary.c_str(), _current_image_secondary);
     }
     cv::waitKey(1);
@@ -80,55 +127,53 @@ void ImageViewer::saveToDisk() {
 }
 
 void ImageViewer::_drawPoints() {
-  if (_current_frame) {
+  const float scale = _parameters->image_scale;
 
-    //ds for all points in the current frame
-    for (const FramePoint* point: _current_frame->points()) {
+  //ds for all points in the current frame
+  for (const FramePointSnapshot& point: _snapshot_front.points) {
 
-      //ds if the point is linked to a landmark
-      if (point->landmark()) {
-        cv::Scalar color = CV_COLOR_CODE_BLUE;
+    //ds if the point is linked to a landmark
+    if (point.has_landmark) {
+      cv::Scalar color = CV_COLOR_CODE_BLUE;
 
-        //ds check if the landmark is part of a loop closure
-        if (point->landmark()->isInLoopClosureQuery() || point->landmark()->isInLoopClosureReference()) {
-          color = CV_COLOR_CODE_DARKGREEN;
-        }
+      //ds check if the landmark is part of a loop closure
+      if (point.is_in_loop_closure) {
+        color = CV_COLOR_CODE_DARKGREEN;
+      }
 
-        //ds draw the point
-        cv::circle(_current_image, point->keypointLeft().pt, 2, color, -1);
+      //ds draw the point
+      cv::circle(_current_image, point.keypoint*scale, 2, color, -1);
 
-        //ds draw track length
-        cv::putText(_current_image, std::to_string(point->trackLength()), point->keypointLeft().pt+cv::Point2f(5, 5), cv::FONT_HERSHEY_SCRIPT_SIMPLEX, 0.25, CV_COLOR_CODE_RED);
-      } else {
+      //ds draw track length
+      cv::putText(_current_image, std::to_string(point.track_length), point.keypoint*scale+cv::Point2f(5, 5), cv::FONT_HERSHEY_SCRIPT_SIMPLEX, 0.25, CV_COLOR_CODE_RED);
+    } else {
 
-        //ds new point
-        cv::circle(_current_image, point->keypointLeft().pt, 2, CV_COLOR_CODE_GREEN, -1);
-      }
+      //ds new point
+      cv::circle(_current_image, point.keypoint*scale, 2, CV_COLOR_CODE_GREEN, -1);
     }
   }
 }
 
 void ImageViewer::_drawTracking() {
-  if (_current_frame) {
-    const uint32_t& tracking_distance_pixels = _current_frame->projectionTrackingDistancePixels();
+  const float scale = _parameters->image_scale;
+  const int32_t tracking_distance_pixels = std::max(1, static_cast<int32_t>(_snapshot_front.tracking_distance_pixels*scale));
 
-    //ds for all points in the current frame
-    for (const FramePoint* point: _current_frame->points()) {
-      if (point->previous()) {
+  //ds for all points in the current frame
+  for (const FramePointSnapshot& point: _snapshot_front.points) {
+    if (point.has_previous) {
 
-        //ds for points without landmark, draw a little green dot
-        if (!point->landmark()) {
-          cv::circle(_current_image, point->keypointLeft().pt, 2, CV_COLOR_CODE_GREEN, -1);
-          cv::line(_current_image, point->keypointLeft().pt, point->previous()->keypointLeft().pt, CV_COLOR_CODE_GREEN);
-        }
+      //ds for points without landmark, draw a little green dot
+      if (!point.has_landmark) {
+        cv::circle(_current_image, point.keypoint*scale, 2, CV_COLOR_CODE_GREEN, -1);
+        cv::line(_current_image, point.keypoint*scale, point.keypoint_previous*scale, CV_COLOR_CODE_GREEN);
+      }
 
-        //ds draw projected point and error
-        cv::circle(_current_image, point->projectionEstimateLeft(), 4, CV_COLOR_CODE_BLUE, 1);
+      //ds draw projected point and error
+      cv::circle(_current_image, point.projection_estimate*scale, 4, CV_COLOR_CODE_BLUE, 1);
 
-        //ds draw tracking line and circle
-        cv::circle(_current_image, point->keypointLeft().pt, tracking_distance_pixels, CV_COLOR_CODE_GREEN);
-        cv::line(_current_image, point->keypointLeft().pt, point->previous()->keypointLeft().pt, CV_COLOR_CODE_GREEN);
-      }
+      //ds draw tracking line and circle
+      cv::circle(_current_image, point.keypoint*scale, tracking_distance_pixels, CV_COLOR_CODE_GREEN);
+      cv::line(_current_image, point.keypoint*scale, point.keypoint_previous*scale, CV_COLOR_CODE_GREEN);
     }
   }
 }
@@ -5,19 +5,44 @@
 namespace proslam {
 
 //! @class a simple 2D opencv input image viewer class for processing display
+//! update takes a lightweight snapshot of the frame (shared image and framepoint overlay data) at a capped rate,
+//! the rendering of the overlays and the display are performed by draw in the GUI thread
 class ImageViewer {
 
+//ds exported types
+public:
+
+  //! @brief overlay data of a framepoint
+  struct FramePointSnapshot {
+    cv::Point2f keypoint;
+    cv::Point2f keypoint_previous;
+    cv::Point2f projection_estimate;
+    Count track_length;
+    bool has_previous;
+    bool has_landmark;
+    bool is_in_loop_closure;
+  };
+
+  //! @brief displayed frame data (images are shared with the frame, not copied)
+  struct Snapshot {
+    cv::Mat image;
+    cv::Mat image_secondary;
+    uint32_t tracking_distance_pixels = 0;
+    std::vector<FramePointSnapshot> points;
+  };
+
 //ds object life
 PROSLAM_MAKE_PROCESSING_CLASS(ImageViewer)
 
 //ds access
 public:
 
-  //! @brief GUI update function, copies framepoints from provided frame into thread-safe, drawable containers  - LOCKING
+  //! @brief GUI update function, copies the overlay data of the provided frame into the back buffer - LOCKING
+  //! @brief frames arriving faster than the maximum refresh rate are skipped without locking
   //! @param[in] frame_ the frame to display
   void update(const Frame* frame_);
 
-  //! @brief draw function - LOCKING
+  //! @brief draw function, swaps in the latest snapshot and renders it outside of the lock (nothing is rendered without a new snapshot) - LOCKING
   void draw();
 
   //! @brief saves current image to disk
@@ -38,8 +63,13 @@ protected:
   //! @brief mutex for data exchange, owned by the viewer
   std::mutex _mutex_data_exchange;
 
-  //! @brief current frame handle (drawn in draw function)
-  const Frame* _current_frame;
+  //! @brief snapshot buffers: back buffer written by update, front buffer rendered by draw (swapped if a new snapshot is available)
+  Snapshot _snapshot_back;
+  Snapshot _snapshot_front;
+  bool _is_snapshot_available = false;
+
+  //! @brief time of the last taken snapshot (for the refresh rate limit)
+  double _time_last_snapshot_seconds = 0;
 
   //! @brief currently displayed image
   cv::Mat _current_image;
@@ -1,5 +1,9 @@
+//ds vertex buffer object functions (OpenGL 1.5)
+#define GL_GLEXT_PROTOTYPES
 #include "map_viewer.h"
 
+#include <algorithm>
+#include <cstddef>
 #include "srrg_gl_helpers/opengl_primitives.h"
 
 namespace proslam {
@@ -9,13 +13,13 @@ using namespace srrg_core_viewers;
 
 MapViewer::MapViewer(MapViewerParameters* parameters_): _parameters(parameters_),
                                                         _world_map(0),
-                                                        _current_frame(0),
                                                         _option_stepwise_playback(true),
                                                         _requested_playback_steps(0),
                                                         _camera_left_to_robot(TransformMatrix3D::Identity()),
                                                         _world_to_robot_origin(TransformMatrix3D::Identity()),
                                                         _robot_viewpoint(TransformMatrix3D::Identity()),
-                                                        _world_to_robot(TransformMatrix3D::Identity()) {
+                                                        _world_to_robot(TransformMatrix3D::Identity()),
+                                                        _world_to_robot_snapshot(TransformMatrix3D::Identity()) {
   setWindowTitle(_parameters->window_title.c_str());
 //  setFPSIsDisplayed(true);
 
@@ -38,6 +42,12 @@ MapViewer::MapViewer(MapViewerParameters* parameters_): _parameters(parameters_)
 
 MapViewer::~MapViewer() {
   LOG_DEBUG(std::cerr << "MapViewer::~MapViewer|destroying" << std::endl)
+
+  //ds free the vertex buffer in our context
+  if (_landmark_buffer) {
+    makeCurrent();
+    glDeleteBuffers(1, &_landmark_buffer);
+  }
   LOG_DEBUG(std::cerr << "MapViewer::~MapViewer|destroyed" << std::endl)
 }
 
@@ -47,19 +57,242 @@ void MapViewer::configure() {
 
 void MapViewer::update(const Frame* frame_) {
 
-  //ds start drawing - during that we cannot exchange the container content
+  //ds during the update the snapshot cannot be consumed (draw continues with the previous one)
   std::lock_guard<std::mutex> lock(_mutex_data_exchange);
+  if (!_world_map) {
+    return;
+  }
+
+  //ds moved map elements (optimization, merging) require a rebuild, other changes are appends
+  //ds released landmarks are dropped from the snapshot - unless more than one removal happened since the last update
+  const Count number_of_removals = _world_map->revisionRemovals()-_revision_removals_map;
+  const bool is_map_changed = (!_is_snapshot_initialized || _world_map->revision() != _revision_map || number_of_removals > 1);
+  if (!is_map_changed && number_of_removals == 1) {
+    _removeLandmarkVertices(_world_map->identifiersRemovedLandmarks());
+  }
+
+  //ds keyframe and closure states of existing frames change with local map creation and loop closing
+  const bool is_frame_state_changed = (is_map_changed                                          ||
+                                       _world_map->localMaps().size() != _number_of_local_maps ||
+                                       _world_map->numberOfClosures() != _number_of_closures   );
+  _updateLandmarks(is_map_changed);
+  _updateFrames(is_frame_state_changed);
+  _revision_map            = _world_map->revision();
+  _revision_removals_map   = _world_map->revisionRemovals();
+  _number_of_local_maps    = _world_map->localMaps().size();
+  _number_of_closures      = _world_map->numberOfClosures();
+  _is_snapshot_initialized = true;
 
   //ds update the current frame
-  _current_frame = frame_;
+  _framepoint_vertices.clear();
+  _is_robot_position_available = false;
+  if (frame_) {
+    _framepoint_vertices.reserve(frame_->points().size());
+    for (const FramePoint* point: frame_->points()) {
+      _framepoint_vertices.push_back(PointVertex(point->worldCoordinates(), Vector3(0.75, 0.75, 0.75)));
+    }
+    _world_to_robot_snapshot     = frame_->worldToRobot();
+    _is_robot_position_available = true;
+  }
+}
+
+void MapViewer::_updateLandmarks(const bool& is_rebuild_required_) {
+  if (is_rebuild_required_) {
+    _landmark_vertices.clear();
+    _landmark_vertex_identifiers.clear();
+    _indices_updated_landmark_vertices.clear();
+    _identifier_next_landmark_vertex = 0;
+    _is_landmark_buffer_outdated     = true;
+  } else {
+
+    //ds refresh the landmarks moved by tracking: the currently tracked ones and the previously tracked ones (deferred position updates)
+    auto refresh = [this](const Landmark* landmark_) {
+      const std::vector<Identifier>::const_iterator iterator = std::lower_bound(_landmark_vertex_identifiers.begin(),
+                                                                                _landmark_vertex_identifiers.end(),
+                                                                                landmark_->identifier());
+      if (iterator != _landmark_vertex_identifiers.end() && *iterator == landmark_->identifier()) {
+        const Index index = iterator-_landmark_vertex_identifiers.begin();
+        for (uint32_t u = 0; u < 3; ++u) {
+          _landmark_vertices[index].coordinates[u] = landmark_->coordinates()(u);
+        }
+        _indices_updated_landmark_vertices.push_back(index);
+      }
+    };
+    for (const Identifier& identifier: _identifiers_previously_tracked_landmarks) {
+      LandmarkPointerMap::const_iterator iterator = _world_map->landmarks().find(identifier);
+      if (iterator != _world_map->landmarks().end()) {
+        refresh(iterator->second);
+      }
+    }
+    for (const Landmark* landmark: _world_map->currentlyTrackedLandmarks()) {
+      refresh(landmark);
+    }
+
+    //ds fall back to a full upload if the snapshot is not consumed (e.g. hidden window)
+    if (_indices_updated_landmark_vertices.size() > _landmark_vertices.size()) {
+      _indices_updated_landmark_vertices.clear();
+      _is_landmark_buffer_outdated = true;
+    }
+  }
+
+  //ds append new landmarks, specific coloring for closure landmarks
+  for (LandmarkPointerMap::const_iterator iterator = _world_map->landmarks().lower_bound(_identifier_next_landmark_vertex);
+       iterator != _world_map->landmarks().end(); ++iterator) {
+    const Landmark* landmark = iterator->second;
+    Vector3 color_rgb(0.5, 0.5, 0.5);
+    if (landmark->isInLoopClosureQuery()) {
+      color_rgb = Vector3(0, 1.0, 0);
+    } else if (landmark->isInLoopClosureReference()) {
+      color_rgb = Vector3(0, 0.5, 0);
+    }
+    _landmark_vertices.push_back(PointVertex(landmark->coordinates(), color_rgb));
+    _landmark_vertex_identifiers.push_back(iterator->first);
+    _identifier_next_landmark_vertex = iterator->first+1;
+  }
+
+  //ds highlight the currently seen landmarks
+  _tracked_landmark_vertices.clear();
+  _identifiers_previously_tracked_landmarks.clear();
+  for (const Landmark* landmark: _world_map->currentlyTrackedLandmarks()) {
+    _tracked_landmark_vertices.push_back(PointVertex(landmark->coordinates(), Vector3(0, 0, 1)));
+    _identifiers_previously_tracked_landmarks.push_back(landmark->identifier());
+  }
+}
+
+void MapViewer::_removeLandmarkVertices(const std::vector<Identifier>& identifiers_removed_landmarks_) {
+  if (identifiers_removed_landmarks_.empty()) {
+    return;
+  }
+
+  //ds removed landmarks are recent ones (transient): compact the vertices from the first removed one on
+  const Index index_first = std::lower_bound(_landmark_vertex_identifiers.begin(),
+                                             _landmark_vertex_identifiers.end(),
+                                             identifiers_removed_landmarks_.front())-_landmark_vertex_identifiers.begin();
+  std::vector<Identifier>::const_iterator iterator_removed = identifiers_removed_landmarks_.begin();
+  Index index_kept = index_first;
+  for (Index index = index_first; index < _landmark_vertex_identifiers.size(); ++index) {
+
+    //ds both identifier sequences are ascending
+    const Identifier& identifier = _landmark_vertex_identifiers[index];
+    while (iterator_removed != identifiers_removed_landmarks_.end() && *iterator_removed < identifier) {
+      ++iterator_removed;
+    }
+    if (iterator_removed != identifiers_removed_landmarks_.end() && *iterator_removed == identifier) {
+      continue;
+    }
+    _landmark_vertex_identifiers[index_kept] = identifier;
+    _landmark_vertices[index_kept]           = _landmark_vertices[index];
+    ++index_kept;
+  }
+  _landmark_vertex_identifiers.resize(index_kept);
+  _landmark_vertices.resize(index_kept);
+  _index_first_shifted_landmark_vertex = std::min(_index_first_shifted_landmark_vertex, index_first);
+}
+
+void MapViewer::_updateFrames(const bool& is_rebuild_required_) {
+  Identifier identifier_first = 0;
+  if (is_rebuild_required_) {
+    _frames.clear();
+    _is_frame_snapshot_outdated = true;
+  } else if (!_frames.empty()) {
+
+    //ds the most recent frame may have been refined since the last update
+    identifier_first = _frames.back().identifier;
+    _frames.pop_back();
+    _index_first_updated_frame = std::min(_index_first_updated_frame, _frames.size());
+  }
+
+  //ds append new frames
+  for (FramePointerMap::const_iterator iterator = _world_map->frames().lower_bound(identifier_first);
+       iterator != _world_map->frames().end(); ++iterator) {
+    _frames.push_back(_getFrameSnapshot(iterator->second));
+  }
+
+  //ds the local map generating head
+  _frames_for_local_map.clear();
+  for (const Frame* frame_for_local_map: _world_map->frameQueueForLocalMap()) {
+    _frames_for_local_map.push_back(_getFrameSnapshot(frame_for_local_map));
+  }
+}
+
+const MapViewer::FrameSnapshot MapViewer::_getFrameSnapshot(const Frame* frame_) const {
+  FrameSnapshot frame;
+  frame.camera_to_world              = (frame_->robotToWorld()*_camera_left_to_robot).cast<float>().matrix();
+  frame.camera_to_world_ground_truth = (frame_->robotToWorldGroundTruth()*_camera_left_to_robot).cast<float>().matrix();
+  frame.identifier                   = frame_->identifier();
+  frame.is_keyframe                  = frame_->isKeyframe();
+
+  //ds check if the frame is closed and if so highlight it accordingly
+  frame.is_closed = (frame_->isKeyframe() && frame_->localMap() && !frame_->localMap()->closures().empty());
+  return frame;
+}
+
+void MapViewer::_consumeSnapshot() {
+  _uploadLandmarkVertices();
+  _tracked_landmark_vertices_drawn = _tracked_landmark_vertices;
+  _framepoint_vertices_drawn       = _framepoint_vertices;
+
+  //ds take over the changed frames only
+  if (_is_frame_snapshot_outdated) {
+    _frames_drawn = _frames;
+  } else {
+    _frames_drawn.resize(std::min(_index_first_updated_frame, _frames_drawn.size()));
+    _frames_drawn.insert(_frames_drawn.end(), _frames.begin()+_frames_drawn.size(), _frames.end());
+  }
+  _index_first_updated_frame  = _frames.size();
+  _is_frame_snapshot_outdated = false;
+  _frames_for_local_map_drawn = _frames_for_local_map;
+
+  //ds check if we can get a position update
+  if (_is_robot_position_available) {
+    _world_to_robot = _world_to_robot_snapshot;
+  }
+}
+
+void MapViewer::_uploadLandmarkVertices() {
+  if (!_landmark_buffer) {
+    glGenBuffers(1, &_landmark_buffer);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, _landmark_buffer);
+  if (_is_landmark_buffer_outdated || _landmark_vertices.size() > _landmark_buffer_capacity) {
+
+    //ds reallocate with headroom for appending and upload all vertices
+    _landmark_buffer_capacity = std::max(2*_landmark_vertices.size(), static_cast<size_t>(1024));
+    glBufferData(GL_ARRAY_BUFFER, _landmark_buffer_capacity*sizeof(PointVertex), nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, _landmark_vertices.size()*sizeof(PointVertex), _landmark_vertices.data());
+  } else {
+
+    //ds vertices behind a removal have been shifted and are uploaded in one piece with the appended ones
+    const size_t index_first_changed = std::min(_number_of_uploaded_landmark_vertices, _index_first_shifted_landmark_vertex);
+
+    //ds upload the refreshed vertices (appended ones are uploaded in one piece below)
+    for (const Index& index: _indices_updated_landmark_vertices) {
+      if (index < index_first_changed) {
+        glBufferSubData(GL_ARRAY_BUFFER, index*sizeof(PointVertex), sizeof(PointVertex), &_landmark_vertices[index]);
+      }
+    }
+
+    //ds upload the appended (and shifted) vertices
+    if (_landmark_vertices.size() > index_first_changed) {
+      glBufferSubData(GL_ARRAY_BUFFER,
+                      index_first_changed*sizeof(PointVertex),
+                      (_landmark_vertices.size()-index_first_changed)*sizeof(PointVertex),
+                      &_landmark_vertices[index_first_changed]);
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  _number_of_uploaded_landmark_vertices = _landmark_vertices.size();
+  _indices_updated_landmark_vertices.clear();
+  _index_first_shifted_landmark_vertex = std::numeric_limits<size_t>::max();
+  _is_landmark_buffer_outdated = false;
 }
 
-void MapViewer::_drawFrame(const Frame* frame_, const Vector3& color_rgb_) const {
+void MapViewer::_drawFrame(const FrameSnapshot& frame_, const Vector3& color_rgb_) const {
   glPushMatrix();
-  glMultMatrixf((frame_->robotToWorld()*_camera_left_to_robot).cast<float>().data());
+  glMultMatrixf(frame_.camera_to_world.data());
 
   //ds check if the frame is closed and if so highlight it accordingly
-  if (frame_->isKeyframe() && !frame_->localMap()->closures().empty()) {
+  if (frame_.is_closed) {
     glColor3f(0.0, 1.0, 0.0);
   } else {
     glColor3f(color_rgb_.x(), color_rgb_.y(), color_rgb_.z());
@@ -71,9 +304,8 @@ void MapViewer::_drawFrame(const Frame* frame_, const Vector3& color_rgb_) const
 
   //ds draw pure odometry pose in red
   if (_parameters->ground_truth_drawn) {
-    const TransformMatrix3D camera_to_world_ground_truth = frame_->robotToWorldGroundTruth()*_camera_left_to_robot;
     glPushMatrix();
-    glMultMatrixf(camera_to_world_ground_truth.cast<float>().data());
+    glMultMatrixf(frame_.camera_to_world_ground_truth.data());
     glColor3f(1, 0, 0);
     drawPyramidWireframe(_parameters->object_scale, _parameters->object_scale);
     glPopMatrix();
@@ -81,95 +313,83 @@ void MapViewer::_drawFrame(const Frame* frame_, const Vector3& color_rgb_) const
 }
 
 void MapViewer::_drawLandmarks() const {
-  glBegin(GL_POINTS);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
 
   //ds highlight the currently seen landmarks
-  for (const Landmark* landmark: _world_map->currentlyTrackedLandmarks()) {
-    glColor3f(0, 0, 1);
-    glVertex3f(landmark->coordinates().x(), landmark->coordinates().y(), landmark->coordinates().z());
+  _drawPoints(_tracked_landmark_vertices_drawn);
+
+  //ds draw permanent landmarks from the vertex buffer
+  if (_number_of_uploaded_landmark_vertices > 0) {
+    glBindBuffer(GL_ARRAY_BUFFER, _landmark_buffer);
+    glVertexPointer(3, GL_FLOAT, sizeof(PointVertex), reinterpret_cast<const GLvoid*>(offsetof(PointVertex, coordinates)));
+    glColorPointer(3, GL_FLOAT, sizeof(PointVertex), reinterpret_cast<const GLvoid*>(offsetof(PointVertex, color_rgb)));
+    glDrawArrays(GL_POINTS, 0, _number_of_uploaded_landmark_vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
   }
 
-  //ds draw permanent landmarks
-  for (const LandmarkPointerMapElement& landmark: _world_map->landmarks()) {
-
-    //ds specific coloring for closure landmarks
-    if (landmark.second->isInLoopClosureQuery()) {
-      glColor3f(0, 1.0, 0);
-    } else if (landmark.second->isInLoopClosureReference()) {
-      glColor3f(0, 0.5, 0);
-    } else {
-      glColor3f(0.5, 0.5, 0.5);
-    }
-    glVertex3f(landmark.second->coordinates().x(), landmark.second->coordinates().y(), landmark.second->coordinates().z());
-  }
-  glEnd();
+  //ds also draw the framepoints of the current frame
+  _drawPoints(_framepoint_vertices_drawn);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
 }
 
-void MapViewer::_drawFramepoints() const {
-  glBegin(GL_POINTS);
-  if (_current_frame) {
-    for (const FramePoint* point: _current_frame->points()) {
-      glColor3f(0.75, 0.75, 0.75);
-      glVertex3f(point->worldCoordinates().x(), point->worldCoordinates().y(), point->worldCoordinates().z());
-    }
+void MapViewer::_drawPoints(const PointVertexVector& vertices_) const {
+  if (vertices_.empty()) {
+    return;
   }
-  glEnd();
+  glVertexPointer(3, GL_FLOAT, sizeof(PointVertex), vertices_[0].coordinates);
+  glColorPointer(3, GL_FLOAT, sizeof(PointVertex), vertices_[0].color_rgb);
+  glDrawArrays(GL_POINTS, 0, vertices_.size());
 }
 
 void MapViewer::draw(){
 
-  //ds start drawing - during that we cannot exchange the container content
-  std::lock_guard<std::mutex> lock(_mutex_data_exchange);
-
-  //ds if we got a valid handle
-  if (_world_map) {
-
-    //ds no specific lighting
-    glDisable(GL_LIGHTING);
-    glDisable(GL_BLEND);
+  //ds take over the latest snapshot unless it is being written - otherwise we keep drawing the previous one
+  {
+    std::unique_lock<std::mutex> lock(_mutex_data_exchange, std::try_to_lock);
+    if (lock.owns_lock()) {
+      _consumeSnapshot();
+    }
+  }
 
-    //ds set viewpoint
-    TransformMatrix3D world_to_robot(_world_to_robot_origin);
-    if(_parameters->follow_robot) {
+  //ds no specific lighting
+  glDisable(GL_LIGHTING);
+  glDisable(GL_BLEND);
 
-      //ds check if we can get a position update (previous frame is only touched in a map update phase - thread-safe otherwise)
-      if (_current_frame) {
-        _world_to_robot = _current_frame->worldToRobot();
-      }
+  //ds set viewpoint
+  TransformMatrix3D world_to_robot(_world_to_robot_origin);
+  if(_parameters->follow_robot) {
 
-      //ds set ego perspective head
-      world_to_robot = _robot_viewpoint*_world_to_robot;
-    }
-    glPushMatrix();
-    glMultMatrixf(world_to_robot.cast<float>().data());
-    glPointSize(_parameters->point_size);
-    glLineWidth(_parameters->object_scale);
+    //ds set ego perspective head
+    world_to_robot = _robot_viewpoint*_world_to_robot;
+  }
+  glPushMatrix();
+  glMultMatrixf(world_to_robot.cast<float>().data());
+  glPointSize(_parameters->point_size);
+  glLineWidth(_parameters->object_scale);
 
-    //ds draw the local map generating head
-    for (const Frame* frame_for_local_map: _world_map->frameQueueForLocalMap()) {
-      _drawFrame(frame_for_local_map, Vector3(0, 0, 1));
-    }
+  //ds draw the local map generating head
+  for (const FrameSnapshot& frame_for_local_map: _frames_for_local_map_drawn) {
+    _drawFrame(frame_for_local_map, Vector3(0, 0, 1));
+  }
 
-    //ds for all frames in the map - obtain the current root
-    for (const FramePointerMapElement& frame_element: _world_map->frames()) {
+  //ds for all frames in the map
+  for (const FrameSnapshot& frame: _frames_drawn) {
 
-      //ds check if we have a keyframe and drawing is enabled
-      if (frame_element.second->isKeyframe()) {
-        _drawFrame(frame_element.second, Vector3(0.5, 0.5, 1));
-      } else if (_parameters->frames_drawn) {
-        _drawFrame(frame_element.second, Vector3(0.75, 0.75, 1));
-      }
+    //ds check if we have a keyframe and drawing is enabled
+    if (frame.is_keyframe) {
+      _drawFrame(frame, Vector3(0.5, 0.5, 1));
+    } else if (_parameters->frames_drawn) {
+      _drawFrame(frame, Vector3(0.75, 0.75, 1));
     }
+  }
 
-    //ds if desired, draw landmarks into map
-    if (_parameters->landmarks_drawn) {
-      _drawLandmarks();
-
-      //ds also draw the framepoints of the current frame
-      _drawFramepoints();
-    }
-    glPopMatrix();
+  //ds if desired, draw landmarks into map
+  if (_parameters->landmarks_drawn) {
+    _drawLandmarks();
   }
+  glPopMatrix();
 }
 
 void MapViewer::keyPressEvent(QKeyEvent* event_){
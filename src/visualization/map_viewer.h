@@ -1,25 +1,57 @@
 #pragma once
 #include <mutex>
 #include <atomic>
+#include <limits>
 #include <QtGlobal>
 #include "srrg_core_viewers/simple_viewer.h"
 #include "types/world_map.h"
 
 namespace proslam {
 
+//! @class map viewer with retained rendering: update copies the map changes since the previous update into a snapshot,
+//! which is consumed by draw without accessing the map (landmarks are kept in an incrementally filled vertex buffer)
 class MapViewer: public srrg_core_viewers::SimpleViewer {
 
+//ds exported types
+public:
+
+  //! @brief interleaved point vertex (layout of the vertex buffer)
+  struct PointVertex {
+    PointVertex(const PointCoordinates& coordinates_, const Vector3& color_rgb_): coordinates{static_cast<float>(coordinates_.x()),
+                                                                                             static_cast<float>(coordinates_.y()),
+                                                                                             static_cast<float>(coordinates_.z())},
+                                                                                 color_rgb{static_cast<float>(color_rgb_.x()),
+                                                                                           static_cast<float>(color_rgb_.y()),
+                                                                                           static_cast<float>(color_rgb_.z())} {}
+    float coordinates[3];
+    float color_rgb[3];
+  };
+  typedef std::vector<PointVertex> PointVertexVector;
+
+  //! @brief drawable copy of a frame
+  struct FrameSnapshot {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Eigen::Matrix4f camera_to_world;
+    Eigen::Matrix4f camera_to_world_ground_truth;
+    Identifier identifier;
+    bool is_keyframe;
+    bool is_closed;
+  };
+  typedef std::vector<FrameSnapshot, Eigen::aligned_allocator<FrameSnapshot>> FrameSnapshotVector;
+
 //ds object life
 PROSLAM_MAKE_PROCESSING_CLASS(MapViewer)
 
 //ds access
 public:
 
-  //! @brief GUI update function, copies framepoints from provided frame into thread-safe, drawable containers  - LOCKING
+  //! @brief GUI update function, copies the map changes since the last call and the provided frame into the drawable snapshot - LOCKING
+  //! @brief frames and landmarks are appended, only landmarks tracked in the last two calls are refreshed unless the map revision changed
   //! @param[in] frame_ the frame to display
   void update(const Frame* frame_);
 
-  //! @brief manual data transfer locking (generally used to block the GUI from drawing during critical operations e.g. global map updates)
+  //! @brief manual data transfer locking (generally used to block the snapshot exchange during critical operations e.g. global map updates)
+  //! @brief the GUI keeps drawing the previous snapshot meanwhile
   void lock() {_mutex_data_exchange.lock();}
 
   //! @brief manual data transfer unlocking (enables the GUI to freely draw again)
@@ -50,7 +82,7 @@ public:
 //ds helpers
 protected:
 
-  //! @brief Qt standard draw function - LOCKING
+  //! @brief Qt standard draw function, takes over the latest snapshot if it is not being written (never blocks) - LOCKING
   virtual void draw();
 
   //! @brief Qt key event handling
@@ -59,16 +91,39 @@ protected:
   //! @brief Qt help string
   virtual QString helpString() const;
 
+  //! @brief copies appended and moved landmarks into the vertex mirror (or all landmarks if a rebuild is required)
+  //! @param[in] is_rebuild_required_
+  void _updateLandmarks(const bool& is_rebuild_required_);
+
+  //! @brief drops the vertices of removed landmarks, the vertices behind the first removed one are shifted (and re-uploaded)
+  //! @param[in] identifiers_removed_landmarks_ removed landmark identifiers (ascending)
+  void _removeLandmarkVertices(const std::vector<Identifier>& identifiers_removed_landmarks_);
+
+  //! @brief copies appended frames and the most recent frame into the frame snapshot (or all frames if a rebuild is required)
+  //! @param[in] is_rebuild_required_
+  void _updateFrames(const bool& is_rebuild_required_);
+
+  //! @brief drawable copy of a frame
+  //! @param[in] frame_
+  const FrameSnapshot _getFrameSnapshot(const Frame* frame_) const;
+
+  //! @brief takes over the snapshot changes into the drawn state and the vertex buffer (GUI thread, data exchange mutex held)
+  void _consumeSnapshot();
+
+  //! @brief updates the vertex buffer with the appended and refreshed landmark vertices (reallocating it if required)
+  void _uploadLandmarkVertices();
+
   //! @brief draws frame in the map, differentiating between local map anchors and regular frames
   //! @param[in] frame_
   //! @param[in] color_rgb_
-  void _drawFrame(const Frame* frame_, const Vector3& color_rgb_) const;
+  void _drawFrame(const FrameSnapshot& frame_, const Vector3& color_rgb_) const;
 
   //! @brief draws landmark in different states in the map
   void _drawLandmarks() const;
 
-  //! @brief draws framepoints for the currently active frame
-  void _drawFramepoints() const;
+  //! @brief draws a small set of points from client memory (vertex arrays must be enabled)
+  //! @param[in] vertices_
+  void _drawPoints(const PointVertexVector& vertices_) const;
 
 //ds attributes
 protected:
@@ -76,12 +131,9 @@ protected:
   //! @brief mutex for data exchange, owned by the viewer
   std::mutex _mutex_data_exchange;
 
-  //! @brief map context (drawn with draw and updated with update method)
+  //! @brief map context (copied into the snapshot by the update method)
   const WorldMap* _world_map;
 
-  //! @brief current frame handle (drawn in draw function)
-  const Frame* _current_frame;
-
   //! @brief enable stepwise playback
   std::atomic<bool> _option_stepwise_playback;
 
@@ -99,5 +151,57 @@ protected:
 
   //! @brief current robot position
   TransformMatrix3D _world_to_robot;
+
+//ds snapshot (written by update in the processing thread, consumed by draw) - guarded by _mutex_data_exchange
+protected:
+
+  //! @brief map state at the last update, a change triggers a rebuild of the snapshot
+  Count _revision_map                = 0;
+  Count _revision_removals_map       = 0;
+  size_t _number_of_local_maps       = 0;
+  Count _number_of_closures          = 0;
+  bool _is_snapshot_initialized      = false;
+
+  //! @brief landmark vertices in identifier order (mirror of the vertex buffer) and their identifiers
+  PointVertexVector _landmark_vertices;
+  std::vector<Identifier> _landmark_vertex_identifiers;
+  Identifier _identifier_next_landmark_vertex = 0;
+
+  //! @brief landmark vertices refreshed since the last consumption or a required full upload
+  std::vector<Index> _indices_updated_landmark_vertices;
+
+  //! @brief first landmark vertex shifted by a removal since the last consumption (all vertices from there on are uploaded)
+  size_t _index_first_shifted_landmark_vertex = std::numeric_limits<size_t>::max();
+  bool _is_landmark_buffer_outdated = true;
+
+  //! @brief tracked landmarks of the last update (their positions may still change by deferred updates)
+  std::vector<Identifier> _identifiers_previously_tracked_landmarks;
+
+  //! @brief per update vertex sets: currently tracked landmarks and framepoints of the current frame
+  PointVertexVector _tracked_landmark_vertices;
+  PointVertexVector _framepoint_vertices;
+
+  //! @brief frame snapshot in identifier order, frames starting from the index changed since the last consumption
+  FrameSnapshotVector _frames;
+  Index _index_first_updated_frame = 0;
+  bool _is_frame_snapshot_outdated = true;
+  FrameSnapshotVector _frames_for_local_map;
+
+  //! @brief current robot position at the last update
+  TransformMatrix3D _world_to_robot_snapshot;
+  bool _is_robot_position_available = false;
+
+//ds drawn state (GUI thread only)
+protected:
+
+  //! @brief landmark vertex buffer, allocated with headroom for appending
+  GLuint _landmark_buffer                      = 0;
+  size_t _landmark_buffer_capacity             = 0;
+  size_t _number_of_uploaded_landmark_vertices = 0;
+
+  PointVertexVector _tracked_landmark_vertices_drawn;
+  PointVertexVector _framepoint_vertices_drawn;
+  FrameSnapshotVector _frames_drawn;
+  FrameSnapshotVector _frames_for_local_map_drawn;
 };
 }